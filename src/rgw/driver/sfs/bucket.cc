@@ -19,18 +19,26 @@
 #include <driver/sfs/sqlite/dbconn.h>
 #include <driver/sfs/sqlite/sqlite_buckets.h>
 #include <driver/sfs/sqlite/sqlite_multipart.h>
+#include <driver/sfs/sqlite/sqlite_notifications.h>
 #include <fmt/core.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <fstream>
+#include <iterator>
 #include <limits>
+#include <optional>
 #include <string>
 
 #include "common/Formatter.h"
+#include "driver/sfs/bucket_dirs.h"
 #include "driver/sfs/multipart.h"
+#include "driver/sfs/notification.h"
 #include "driver/sfs/object.h"
 #include "driver/sfs/object_state.h"
+#include "driver/sfs/sfs_gc.h"
 #include "driver/sfs/sfs_log.h"
+#include "driver/sfs/sfs_usage.h"
 #include "driver/sfs/sqlite/objects/object_definitions.h"
 #include "driver/sfs/sqlite/sqlite_list.h"
 #include "driver/sfs/sqlite/sqlite_versioned_objects.h"
@@ -175,7 +183,7 @@ int SFSBucket::list(
   if (params.ns == RGW_OBJ_NS_MULTIPART) {
     // Ignore params.access_list_filter. A filter for multipart "meta"
     // objects that SFS doesn't have.
-    sfs::sqlite::SQLiteMultipart multipart(store->db_conn);
+    const auto& multipart = store->metadata->multipart();
     std::vector<sfs::sqlite::DBMultipart> multiparts =
         multipart.list_multiparts_by_bucket_id(
             get_bucket_id(), params.prefix, params.marker.name, "", max,
@@ -199,15 +207,18 @@ int SFSBucket::list(
     return 0;
   }
 
-  sfs::sqlite::SQLiteList list(store->db_conn);
+  const auto& list = store->metadata->list();
   std::string start_with(params.marker.name);
   if (!params.delim.empty()) {
     // Having a marker and delimiter means that the user wants to skip
     // a whole common prefix. Since we compare names ASCII greater
     // than style, append characters to make this the "greatest"
-    // prefixed name
-    auto delim_pos = start_with.find(params.delim);
-    if (delim_pos != params.delim.npos) {
+    // prefixed name. Only a delimiter after the prefix makes one.
+    const auto delim_pos =
+        start_with.starts_with(params.prefix)
+            ? start_with.find(params.delim, params.prefix.size())
+            : std::string::npos;
+    if (delim_pos != std::string::npos) {
       start_with.append(
           sfs::S3_MAX_OBJECT_NAME_BYTES - delim_pos,
           std::numeric_limits<char>::max()
@@ -215,18 +226,54 @@ int SFSBucket::list(
     }
   }
 
+  // Since we don't support per-object ownership (a bucket ACL
+  // feature), apply the bucket owner to every object.
+  // See: https://docs.aws.amazon.com/AmazonS3/latest/userguide/about-object-ownership.html
+  // TODO(irq0) make conditional when SAL gains support for that
+  const RGWUserInfo& owner = bucket->get_owner();
+
+  // Entries go straight from the query into results.objs, or to
+  // params.entry_cb while the statement is still stepping. They are
+  // rolled up into common prefixes and stamped with the owner on the
+  // way.
+  std::optional<sfs::sqlite::CommonPrefixRollup> rollup;
+  if (!params.delim.empty()) {
+    rollup.emplace(params.prefix, params.delim, results.common_prefixes);
+  }
+  size_t num_listed = 0;
+  size_t num_returned = 0;
+  rgw_obj_key last_key;
+  if (!params.entry_cb) {
+    results.objs.reserve(max);
+  }
+  const auto visit = [&](rgw_bucket_dir_entry&& e) {
+    num_listed++;
+    if (rollup.has_value() && !rollup->add(e)) {
+      return;
+    }
+    num_returned++;
+    last_key = rgw_obj_key(e.key.name, e.key.instance);
+    e.meta.owner = owner.user_id.id;
+    e.meta.owner_display_name = owner.display_name;
+    if (params.entry_cb) {
+      params.entry_cb(std::move(e));
+    } else {
+      results.objs.emplace_back(std::move(e));
+    }
+  };
+
   // Version listing on unversioned buckets is equivalent to object listing
   const bool want_list_versions =
       versioning_enabled() ? params.list_versions : false;
   const bool listing_succeeded = [&]() {
     if (want_list_versions) {
       return list.versions(
-          get_bucket_id(), params.prefix, start_with, max, results.objs,
-          &results.is_truncated
+          get_bucket_id(), params.prefix, start_with, params.marker.name,
+          params.marker.instance, max, visit, &results.is_truncated
       );
     } else {
       return list.objects(
-          get_bucket_id(), params.prefix, start_with, max, results.objs,
+          get_bucket_id(), params.prefix, start_with, max, visit,
           &results.is_truncated
       );
     }
@@ -235,73 +282,50 @@ int SFSBucket::list(
     lsfs_info(dpp) << fmt::format(
                           "list (prefix:{}, start_after:{}, "
                           "max:{}) failed.",
-                          params.prefix, start_with, max, results.objs.size(),
-                          results.next_marker, results.is_truncated
+                          params.prefix, start_with, max
                       )
                    << dendl;
     return -ERR_INTERNAL_ERROR;
   }
 
-  if (!params.delim.empty()) {
-    std::vector<rgw_bucket_dir_entry> new_results;
-    auto next_marker = list.roll_up_common_prefixes(
-        params.prefix, params.delim, results.objs, results.common_prefixes,
-        new_results
+  // Is there actually more after the rolled up common prefix? We
+  // can't tell from the original object query. Ask again for
+  // anything after the prefix.
+  if (rollup.has_value() && !results.common_prefixes.empty()) {
+    std::vector<rgw_bucket_dir_entry> objects_after;
+    std::string query = rollup->get_next_marker();
+    query.append(
+        sfs::S3_MAX_OBJECT_NAME_BYTES - query.size(),
+        std::numeric_limits<char>::max()
     );
-
-    // Is there actually more after the rolled up common prefix? We
-    // can't tell from the original object query. Ask again for
-    // anything after the prefix.
-    if (!results.common_prefixes.empty()) {
-      std::vector<rgw_bucket_dir_entry> objects_after;
-      std::string query = next_marker;
-      query.append(
-          sfs::S3_MAX_OBJECT_NAME_BYTES - query.size(),
-          std::numeric_limits<char>::max()
-      );
-      list.objects(get_bucket_id(), params.prefix, query, 1, objects_after);
-      results.is_truncated = objects_after.size() > 0;
-    }
+    list.objects(get_bucket_id(), params.prefix, query, 1, objects_after);
+    results.is_truncated = objects_after.size() > 0;
+  }
+  if (rollup.has_value()) {
     lsfs_debug(dpp) << fmt::format(
                            "common prefix rollup #objs:{} -> #objs:{}, "
                            "#prefix:{}, more:{}",
-                           results.objs.size(), new_results.size(),
+                           num_listed, num_returned,
                            results.common_prefixes.size(), results.is_truncated
                        )
                     << dendl;
-
-    results.objs = new_results;
   }
   if (results.is_truncated) {
     if (results.common_prefixes.empty()) {
-      const auto& last = results.objs.back();
-      results.next_marker = rgw_obj_key(last.key.name, last.key.instance);
+      results.next_marker = last_key;
     } else {
       const std::string& last = std::prev(results.common_prefixes.end())->first;
       results.next_marker = rgw_obj_key(last);
     }
   }
 
-  // Since we don't support per-object ownership (a bucket ACL
-  // feature), apply the bucket owner to every object.
-  // See: https://docs.aws.amazon.com/AmazonS3/latest/userguide/about-object-ownership.html
-  // TODO(irq0) make conditional when SAL gains support for that
-  sfs::sqlite::SQLiteBuckets buckets(store->db_conn);
-  const auto maybe_owner = buckets.get_owner(get_bucket_id());
-  if (maybe_owner.has_value()) {
-    for (auto& obj : results.objs) {
-      obj.meta.owner = maybe_owner->first;
-      obj.meta.owner_display_name = maybe_owner->second;
-    }
-  }
-
   lsfs_debug(dpp)
       << fmt::format(
              "success (prefix:{}, start_after:{}, "
              "max:{} delim:{}). #objs_returned:{} "
-             "?owner:{} ?versionlist:{} #common_pref:{} next:{} have_more:{}",
-             params.prefix, start_with, max, params.delim, results.objs.size(),
-             maybe_owner.has_value(), want_list_versions,
+             "owner:{} ?versionlist:{} #common_pref:{} next:{} have_more:{}",
+             params.prefix, start_with, max, params.delim, num_returned,
+             owner.user_id.id, want_list_versions,
              results.common_prefixes.size(), results.next_marker,
              results.is_truncated
          )
@@ -309,6 +333,38 @@ int SFSBucket::list(
   return 0;
 }
 
+int SFSBucket::delete_objects(
+    const DoutPrefixProvider* dpp, std::vector<DeleteObjectsEntry>& entries,
+    optional_yield /* y */
+) {
+  std::vector<rgw_obj_key> keys;
+  keys.reserve(entries.size());
+  std::ranges::transform(
+      entries, std::back_inserter(keys),
+      [](const DeleteObjectsEntry& entry) { return entry.key; }
+  );
+  std::vector<sfs::Bucket::DeleteResult> results;
+  if (!bucket->delete_objects(keys, versioning_enabled(), results)) {
+    lsfs_info(dpp) << fmt::format(
+                          "deleting {} objects from bucket {} failed",
+                          entries.size(), get_name()
+                      )
+                   << dendl;
+    return -ERR_INTERNAL_ERROR;
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    entries[i].result = 0;
+    entries[i].delete_marker = results[i].delete_marker;
+    entries[i].version_id = results[i].version_id;
+  }
+  lsfs_debug(dpp) << fmt::format(
+                         "deleted {} objects from bucket {}", entries.size(),
+                         get_name()
+                     )
+                  << dendl;
+  return 0;
+}
+
 int SFSBucket::remove_bucket(
     const DoutPrefixProvider* dpp, bool delete_children,
     bool /*forward_to_master*/, req_info* /*req_info*/, optional_yield y
@@ -333,7 +389,7 @@ int SFSBucket::remove_bucket(
   }
 
   // at this point bucket should be empty and we're good to go
-  sfs::sqlite::SQLiteBuckets db_buckets(store->db_conn);
+  const auto& db_buckets = store->metadata->buckets();
   auto db_bucket = db_buckets.get_bucket(get_bucket_id());
   if (!db_bucket.has_value()) {
     lsfs_verb(dpp) << __func__ << ": Bucket metadata was not found." << dendl;
@@ -343,6 +399,9 @@ int SFSBucket::remove_bucket(
   db_bucket->mtime = ceph::real_time::clock::now();
   db_buckets.store_bucket(*db_bucket);
   store->_delete_bucket(get_name());
+  // with a data directory of its own the bucket's data goes all at once
+  store->bucket_dirs->trash(get_bucket_id());
+  store->gc->enqueue(sfs::sqlite::GCJournalKind::BUCKET, get_bucket_id());
   return 0;
 }
 
@@ -372,8 +431,7 @@ int SFSBucket::set_acl(
   acls.encode(aclp_bl);
   attrs[RGW_ATTR_ACL] = aclp_bl;
 
-  sfs::get_meta_buckets(get_store().db_conn)
-      ->store_bucket(get_db_op_bucket_info());
+  get_store().metadata->buckets().store_bucket(get_db_op_bucket_info());
 
   store->_refresh_buckets_safe();
   return 0;
@@ -395,7 +453,7 @@ int SFSBucket::
     check_empty(const DoutPrefixProvider* dpp, optional_yield /*y*/) {
   /** Check in the backing store if this bucket is empty */
   // check if there are still objects owned by the bucket
-  sfs::sqlite::SQLiteBuckets db_buckets(store->db_conn);
+  const auto& db_buckets = store->metadata->buckets();
   if (!db_buckets.bucket_empty(get_bucket_id())) {
     lsfs_debug(dpp) << __func__ << ": Bucket Not Empty." << dendl;
     return -ENOTEMPTY;
@@ -434,8 +492,7 @@ int SFSBucket::merge_and_store_attrs(
     acls.decode(lval);
   }
 
-  sfs::get_meta_buckets(get_store().db_conn)
-      ->store_bucket(get_db_op_bucket_info());
+  get_store().metadata->buckets().store_bucket(get_db_op_bucket_info());
 
   store->_refresh_buckets_safe();
   return 0;
@@ -444,10 +501,9 @@ int SFSBucket::merge_and_store_attrs(
 // try_resolve_mp_from_oid tries to parse an integer id from oid to
 // find an MP upload, returning object_name and upload_id
 static bool try_resolve_mp_from_oid(
-    sfs::sqlite::DBConnRef dbconn, const std::string& oid,
+    const sfs::MultipartBackend& mpdb, const std::string& oid,
     std::string& out_object_name, std::string& out_upload_id
 ) {
-  sfs::sqlite::SQLiteMultipart mpdb(dbconn);
   std::string err;
   const int id = strict_strtol(oid, 10, &err);
   if ((id == 0) && !err.empty()) {
@@ -478,7 +534,7 @@ std::unique_ptr<MultipartUpload> SFSBucket::get_multipart_upload(
   // ID into the MP table and resolve that to a upload id here.
   if (!with_upload_id.has_value() &&
       try_resolve_mp_from_oid(
-          store->db_conn, with_oid, next_oid, next_upload_id
+          store->metadata->multipart(), with_oid, next_oid, next_upload_id
       )) {
     ldout(store->ceph_context(), SFS_LOG_DEBUG)
         << fmt::format(
@@ -550,20 +606,30 @@ int SFSBucket::try_refresh_info(
 }
 
 int SFSBucket::read_usage(
-    const DoutPrefixProvider* dpp, uint64_t /*start_epoch*/,
-    uint64_t /*end_epoch*/, uint32_t /*max_entries*/, bool* /*is_truncated*/,
-    RGWUsageIter& /*usage_iter*/,
-    std::map<rgw_user_bucket, rgw_usage_log_entry>& /*usage*/
+    const DoutPrefixProvider* dpp, uint64_t start_epoch, uint64_t end_epoch,
+    uint32_t max_entries, bool* is_truncated, RGWUsageIter& usage_iter,
+    std::map<rgw_user_bucket, rgw_usage_log_entry>& usage
 ) {
-  lsfs_warn(dpp) << __func__ << ": TODO" << dendl;
-  return -ENOTSUP;
+  // usage is charged to the bucket owner, see rgw_log.cc
+  sfs::UsageBackend::Range range;
+  range.owner = get_info().owner.to_str();
+  range.bucket = get_name();
+  range.start_epoch = start_epoch;
+  range.end_epoch = end_epoch;
+  return sfs::read_usage(
+      dpp, *store->usage_backend, range, max_entries, is_truncated,
+      usage_iter, usage
+  );
 }
 int SFSBucket::trim_usage(
-    const DoutPrefixProvider* dpp, uint64_t /*start_epoch*/,
-    uint64_t /*end_epoch*/
+    const DoutPrefixProvider* dpp, uint64_t start_epoch, uint64_t end_epoch
 ) {
-  lsfs_warn(dpp) << __func__ << ": TODO" << dendl;
-  return -ENOTSUP;
+  sfs::UsageBackend::Range range;
+  range.owner = get_info().owner.to_str();
+  range.bucket = get_name();
+  range.start_epoch = start_epoch;
+  range.end_epoch = end_epoch;
+  return sfs::trim_usage(dpp, *store->usage_backend, range);
 }
 
 int SFSBucket::rebuild_index(const DoutPrefixProvider* dpp) {
@@ -571,6 +637,64 @@ int SFSBucket::rebuild_index(const DoutPrefixProvider* dpp) {
   return -ENOTSUP;
 }
 
+int SFSBucket::read_topics(
+    rgw_pubsub_bucket_topics& notifications,
+    RGWObjVersionTracker* objv_tracker, optional_yield /*y*/,
+    const DoutPrefixProvider* dpp
+) {
+  sfs::sqlite::SQLiteNotifications db_notifications(store->db_conn);
+  const auto db_topics = db_notifications.get_bucket_topics(get_bucket_id());
+  if (!db_topics.has_value()) {
+    return -ENOENT;
+  }
+  const int ret = decode_topics(db_topics->topics, notifications);
+  if (ret < 0) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to decode notifications of bucket {}",
+                         get_name()
+                     )
+                  << dendl;
+    return ret;
+  }
+  if (objv_tracker) {
+    objv_tracker->read_version.ver = db_topics->version;
+  }
+  return 0;
+}
+
+int SFSBucket::write_topics(
+    const rgw_pubsub_bucket_topics& notifications,
+    RGWObjVersionTracker* objv_tracker, optional_yield /*y*/,
+    const DoutPrefixProvider* /*dpp*/
+) {
+  std::optional<uint64_t> expected_version;
+  if (objv_tracker && objv_tracker->read_version.ver > 0) {
+    expected_version = objv_tracker->read_version.ver;
+  }
+  sfs::sqlite::SQLiteNotifications db_notifications(store->db_conn);
+  const auto version = db_notifications.store_bucket_topics(
+      get_bucket_id(), encode_topics(notifications), expected_version
+  );
+  if (version == 0) {
+    return -ECANCELED;
+  }
+  if (objv_tracker) {
+    objv_tracker->read_version.ver = version;
+  }
+  return 0;
+}
+
+int SFSBucket::remove_topics(
+    RGWObjVersionTracker* /*objv_tracker*/, optional_yield /*y*/,
+    const DoutPrefixProvider* /*dpp*/
+) {
+  sfs::sqlite::SQLiteNotifications db_notifications(store->db_conn);
+  if (!db_notifications.remove_bucket_topics(get_bucket_id())) {
+    return -ENOENT;
+  }
+  return 0;
+}
+
 int SFSBucket::check_quota(
     const DoutPrefixProvider* dpp, RGWQuota& quota, uint64_t obj_size,
     optional_yield /*y*/, bool /*check_size_only*/
@@ -586,12 +710,30 @@ int SFSBucket::check_quota(
 }
 
 int SFSBucket::read_stats(
-    const DoutPrefixProvider* /*dpp*/,
+    const DoutPrefixProvider* dpp,
     const bucket_index_layout_generation& /*idx_layout*/, int /*shard_id*/,
     std::string* /*bucket_ver*/, std::string* /*master_ver*/,
-    std::map<RGWObjCategory, RGWStorageStats>& /*stats*/,
+    std::map<RGWObjCategory, RGWStorageStats>& stats,
     std::string* /*max_marker*/, bool* /*syncstopped*/
 ) {
+  const auto& bucketdb = store->metadata->buckets();
+  auto db_stats = bucketdb.get_stats(get_bucket_id());
+  if (!db_stats.has_value()) {
+    lsfs_verb(dpp) << fmt::format(
+                          "unable to obtain stats for bucket {} (id {}) -- "
+                          "no such bucket!",
+                          get_name(), get_bucket_id()
+                      )
+                   << dendl;
+    return -ERR_NO_SUCH_BUCKET;
+  }
+  // size is the logical size, size_utilized what is stored on disk after
+  // compression
+  auto& main = stats[RGWObjCategory::Main];
+  main.category = RGWObjCategory::Main;
+  main.size = main.size_rounded = db_stats->size;
+  main.size_utilized = db_stats->physical_size;
+  main.num_objects = db_stats->obj_count;
   return 0;
 }
 int SFSBucket::read_stats_async(
@@ -614,7 +756,7 @@ int SFSBucket::update_container_stats(const DoutPrefixProvider* dpp) {
                          get_bucket_id()
                      )
                   << dendl;
-  sfs::sqlite::SQLiteBuckets bucketdb(store->db_conn);
+  const auto& bucketdb = store->metadata->buckets();
   auto stats = bucketdb.get_stats(get_bucket_id());
 
   if (!stats.has_value()) {
@@ -649,8 +791,7 @@ int SFSBucket::put_info(
     return -ERR_NOT_IMPLEMENTED;
   }
 
-  sfs::get_meta_buckets(get_store().db_conn)
-      ->store_bucket(get_db_op_bucket_info());
+  get_store().metadata->buckets().store_bucket(get_db_op_bucket_info());
 
   store->_refresh_buckets_safe();
   return 0;
@@ -78,6 +78,14 @@ class SFSBucket : public StoreBucket {
       const DoutPrefixProvider* dpp, ListParams&, int, ListResults&,
       optional_yield y
   ) override;
+  virtual bool supports_delete_objects() const override { return true; }
+  /**
+   * Delete many objects in one database transaction.
+   */
+  virtual int delete_objects(
+      const DoutPrefixProvider* dpp, std::vector<DeleteObjectsEntry>& entries,
+      optional_yield y
+  ) override;
   /**
    * Remove this bucket.
    */
@@ -146,6 +154,21 @@ class SFSBucket : public StoreBucket {
   ) override;
   virtual int rebuild_index(const DoutPrefixProvider* dpp) override;
 
+  virtual int read_topics(
+      rgw_pubsub_bucket_topics& notifications,
+      RGWObjVersionTracker* objv_tracker, optional_yield y,
+      const DoutPrefixProvider* dpp
+  ) override;
+  virtual int write_topics(
+      const rgw_pubsub_bucket_topics& notifications,
+      RGWObjVersionTracker* objv_tracker, optional_yield y,
+      const DoutPrefixProvider* dpp
+  ) override;
+  virtual int remove_topics(
+      RGWObjVersionTracker* objv_tracker, optional_yield y,
+      const DoutPrefixProvider* dpp
+  ) override;
+
   /**
    * Obtain multipart upload, which may or may not previously exist.
    */
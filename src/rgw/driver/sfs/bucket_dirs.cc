@@ -0,0 +1,247 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/bucket_dirs.h"
+
+#include <fmt/format.h>
+
+#include <system_error>
+#include <vector>
+
+#include "common/perf_counters.h"
+#include "rgw/driver/sfs/content_store.h"
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_objects.h"
+#include "rgw/driver/sfs/uuid_path.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw_sal_sfs.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal::sfs {
+
+BucketDirs::BucketDirs(CephContext* _cct, SFStore* _store)
+    : cct(_cct),
+      store(_store),
+      enabled(cct->_conf.get_val<bool>("rgw_sfs_bucket_data_dirs")),
+      files_per_sec(cct->_conf.get_val<uint64_t>("rgw_sfs_trash_files_per_sec")
+      ),
+      window_start(ceph::mono_clock::now()) {
+  const auto& db_buckets = store->metadata->buckets();
+  const auto bucket_ids = db_buckets.get_bucket_data_dirs();
+  own_dirs.insert(bucket_ids.begin(), bucket_ids.end());
+}
+
+BucketDirs::~BucketDirs() {
+  {
+    std::lock_guard l{lock};
+    down_flag = true;
+    cond.notify_all();
+  }
+  if (worker && worker->is_started()) {
+    worker->join();
+  }
+}
+
+/*
+ * As with SFSGC, the worker is only started once the store is fully
+ * constructed, since BucketDirs is its prefix provider for logging.
+ */
+void BucketDirs::initialize() {
+  worker = std::make_unique<Worker>(this);
+  worker->create("rgw_sfs_trash");
+}
+
+std::filesystem::path BucketDirs::data_root(const std::string& bucket_id
+) const {
+  if (!has_own_dir(bucket_id)) {
+    return {};
+  }
+  return std::filesystem::path(BUCKETS_DIR) / bucket_id;
+}
+
+std::filesystem::path BucketDirs::object_data_root(const uuid_d& uuid) const {
+  {
+    std::lock_guard l{lock};
+    if (own_dirs.empty()) {
+      return {};
+    }
+  }
+  const auto& db_objects = store->metadata->objects();
+  const auto object = db_objects.get_object(uuid);
+  if (!object.has_value()) {
+    return {};
+  }
+  return data_root(object->bucket_id);
+}
+
+bool BucketDirs::has_own_dir(const std::string& bucket_id) const {
+  std::lock_guard l{lock};
+  return own_dirs.contains(bucket_id);
+}
+
+void BucketDirs::create(const std::string& bucket_id) {
+  if (!enabled) {
+    return;
+  }
+  const auto path = store->get_data_path() / BUCKETS_DIR / bucket_id;
+  std::error_code ec;
+  std::filesystem::create_directories(path, ec);
+  if (ec) {
+    lsfs_err(this) << fmt::format(
+                          "failed to create data directory {}: {}. bucket "
+                          "uses the shared layout.",
+                          path.string(), ec.message()
+                      )
+                   << dendl;
+    return;
+  }
+  const auto& db_buckets = store->metadata->buckets();
+  db_buckets.add_bucket_data_dir(bucket_id);
+  std::lock_guard l{lock};
+  own_dirs.insert(bucket_id);
+}
+
+void BucketDirs::trash(const std::string& bucket_id) {
+  if (!has_own_dir(bucket_id)) {
+    return;
+  }
+  const auto src = store->get_data_path() / BUCKETS_DIR / bucket_id;
+  const auto trash_path = store->get_data_path() / TRASH_DIR;
+  std::error_code ec;
+  std::filesystem::create_directories(trash_path, ec);
+  // the name must not clash with what is left of an earlier removal
+  const auto dst = trash_path / fmt::format(
+                                    "{}.{}", bucket_id,
+                                    UUIDPath::create().get_uuid().to_string()
+                                );
+  std::filesystem::rename(src, dst, ec);
+  if (ec) {
+    if (ec != std::errc::no_such_file_or_directory) {
+      lsfs_err(this) << fmt::format(
+                            "failed to move data directory {} to the trash: "
+                            "{}",
+                            src.string(), ec.message()
+                        )
+                     << dendl;
+    }
+    return;
+  }
+  lsfs_debug(this) << fmt::format("moved {} to {}", src.string(), dst.string())
+                   << dendl;
+  std::lock_guard l{lock};
+  wakeup = true;
+  cond.notify_all();
+}
+
+void BucketDirs::forget(const std::string& bucket_id) {
+  std::lock_guard l{lock};
+  own_dirs.erase(bucket_id);
+}
+
+bool BucketDirs::empty_trash() {
+  const auto trash_path = store->get_data_path() / TRASH_DIR;
+  std::vector<std::filesystem::path> entries;
+  std::error_code ec;
+  for (auto it = std::filesystem::directory_iterator(trash_path, ec);
+       !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+    entries.push_back(it->path());
+  }
+  for (const auto& entry : entries) {
+    if (!remove_trash_entry(entry)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BucketDirs::remove_trash_entry(const std::filesystem::path& entry) {
+  lsfs_debug(this) << fmt::format("removing {}", entry.string()) << dendl;
+  std::error_code ec;
+  for (auto it = std::filesystem::recursive_directory_iterator(entry, ec);
+       !ec && it != std::filesystem::recursive_directory_iterator();
+       it.increment(ec)) {
+    if (going_down()) {
+      return false;
+    }
+    std::error_code type_ec;
+    if (!it->is_regular_file(type_ec)) {
+      continue;
+    }
+    // data files may share content with other versions
+    store->content_store->remove(it->path());
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_sfs_trash_files);
+    }
+    pace();
+  }
+  // only directories are left
+  std::filesystem::remove_all(entry, ec);
+  if (ec) {
+    lsfs_warn(this) << fmt::format(
+                           "failed to remove {}: {}", entry.string(),
+                           ec.message()
+                       )
+                    << dendl;
+  }
+  return true;
+}
+
+void BucketDirs::pace() {
+  if (files_per_sec == 0) {
+    return;
+  }
+  if (++window_files < files_per_sec) {
+    return;
+  }
+  const auto window_end = window_start + std::chrono::seconds(1);
+  const auto now = ceph::mono_clock::now();
+  if (window_end > now) {
+    std::unique_lock locker{lock};
+    cond.wait_for(locker, window_end - now, [this] { return going_down(); });
+  }
+  window_start = ceph::mono_clock::now();
+  window_files = 0;
+}
+
+bool BucketDirs::wait_for(std::chrono::milliseconds duration) {
+  std::unique_lock locker{lock};
+  cond.wait_for(locker, duration, [this] {
+    return going_down() || wakeup;
+  });
+  wakeup = false;
+  return !going_down();
+}
+
+std::ostream& BucketDirs::gen_prefix(std::ostream& out) const {
+  return out << "bucket dirs: ";
+}
+
+void* BucketDirs::Worker::entry() {
+  while (!dirs->going_down()) {
+    try {
+      if (!dirs->empty_trash()) {
+        break;
+      }
+    } catch (const std::system_error& e) {
+      lsfs_err_for(dirs, "BucketDirs")
+          << fmt::format("emptying the trash failed: {}", e.what()) << dendl;
+    }
+    // whatever lands in the trash wakes us up, this is just a safety net
+    dirs->wait_for(std::chrono::minutes(10));
+  }
+  return nullptr;
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "common/Thread.h"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "include/uuid.h"
+#include "rgw_sal.h"
+
+namespace rgw::sal {
+class SFStore;
+}
+
+namespace rgw::sal::sfs {
+
+/// BucketDirs implements the per-bucket data layout
+/// (rgw_sfs_bucket_data_dirs).
+///
+/// Buckets created while it is enabled keep the xx/yy fan-out of their
+/// object data below buckets/<bucket id> in the data path, instead of
+/// sharing the top level one. Removing such a bucket renames its
+/// directory into trash/ and the garbage collector then drops its rows
+/// in bulk, without deleting data object by object. A background
+/// thread removes what is in the trash, paced to
+/// rgw_sfs_trash_files_per_sec.
+///
+/// Parts of in-progress multipart uploads stay in the shared fan-out.
+class BucketDirs : public DoutPrefixProvider {
+  CephContext* cct;
+  SFStore* store;
+  const bool enabled;
+  const uint64_t files_per_sec;
+  std::atomic<bool> down_flag = {false};
+
+  mutable ceph::mutex lock = ceph::make_mutex("BucketDirs");
+  ceph::condition_variable cond;
+  // buckets with a data directory of their own, under lock
+  std::set<std::string> own_dirs;
+  // something was put in the trash, under lock
+  bool wakeup = false;
+
+  // pacing window
+  ceph::mono_time window_start;
+  uint64_t window_files{0};
+
+  class Worker : public Thread {
+    BucketDirs* dirs = nullptr;
+
+   public:
+    explicit Worker(BucketDirs* _dirs) : dirs(_dirs) {}
+    void* entry() override;
+  };
+  std::unique_ptr<Worker> worker;
+
+  bool going_down() const { return down_flag; }
+  /// Sleep for `duration`, until shutdown or until woken. Returns false
+  /// on shutdown.
+  bool wait_for(std::chrono::milliseconds duration);
+  /// Account for a removed file, sleeping to stay within files_per_sec.
+  void pace();
+  /// Remove a directory in the trash. Returns false on shutdown.
+  bool remove_trash_entry(const std::filesystem::path& entry);
+
+ public:
+  static constexpr std::string_view BUCKETS_DIR = "buckets";
+  static constexpr std::string_view TRASH_DIR = "trash";
+
+  BucketDirs(CephContext* _cct, SFStore* _store);
+  BucketDirs(const BucketDirs&) = delete;
+  BucketDirs& operator=(const BucketDirs&) = delete;
+  ~BucketDirs();
+
+  /// Start the trash remover.
+  void initialize();
+
+  /// Directory holding the object data of `bucket_id`, relative to the
+  /// data path. Empty for buckets sharing the top level fan-out.
+  std::filesystem::path data_root(const std::string& bucket_id) const;
+  /// data_root() of the bucket object `uuid` belongs to.
+  std::filesystem::path object_data_root(const uuid_d& uuid) const;
+  bool has_own_dir(const std::string& bucket_id) const;
+
+  /// Give the new bucket `bucket_id` a data directory of its own, if
+  /// the layout is enabled.
+  void create(const std::string& bucket_id);
+  /// Move the data directory of the removed bucket `bucket_id` into the
+  /// trash.
+  void trash(const std::string& bucket_id);
+  /// Forget `bucket_id` once the garbage collector dropped its rows.
+  void forget(const std::string& bucket_id);
+  /// Remove everything in the trash. Returns false on shutdown.
+  bool empty_trash();
+
+  CephContext* get_cct() const override { return cct; }
+  unsigned get_subsys() const override { return ceph_subsys_rgw_sfs; }
+  std::ostream& gen_prefix(std::ostream& out) const override;
+
+  std::string get_cls_name() const { return "BucketDirs"; }
+};
+
+}  // namespace rgw::sal::sfs
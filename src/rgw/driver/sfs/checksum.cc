@@ -0,0 +1,55 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "driver/sfs/checksum.h"
+
+#include <fmt/format.h>
+
+#include <charconv>
+
+namespace rgw::sal::sfs {
+
+static constexpr std::string_view CRC32C_PREFIX = "crc32c:";
+
+std::string format_crc32c(uint32_t crc) {
+  return fmt::format("{}{:08x}", CRC32C_PREFIX, crc);
+}
+
+std::string format_composite_crc32c(const std::vector<uint32_t>& part_crcs) {
+  Crc32c crc;
+  ceph::bufferlist bl;
+  for (const auto part_crc : part_crcs) {
+    const char be[4] = {
+        static_cast<char>(part_crc >> 24), static_cast<char>(part_crc >> 16),
+        static_cast<char>(part_crc >> 8), static_cast<char>(part_crc)};
+    bl.append(be, sizeof(be));
+  }
+  crc.update(bl);
+  return fmt::format("{}-{}", format_crc32c(crc.value()), part_crcs.size());
+}
+
+std::optional<uint32_t> parse_crc32c(const std::string& checksum) {
+  if (!checksum.starts_with(CRC32C_PREFIX)) {
+    return std::nullopt;
+  }
+  const char* const first = checksum.data() + CRC32C_PREFIX.size();
+  const char* const last = checksum.data() + checksum.size();
+  uint32_t crc = 0;
+  const auto res = std::from_chars(first, last, crc, 16);
+  if (res.ec != std::errc() || res.ptr != last || last - first != 8) {
+    return std::nullopt;
+  }
+  return crc;
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,50 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "include/buffer.h"
+
+namespace rgw::sal::sfs {
+
+/// Running CRC32C (Castagnoli) of object data, the same checksum S3
+/// calls crc32c. Uses ceph_crc32c(), which is SSE4.2 or ARMv8 CRC
+/// accelerated where available.
+class Crc32c {
+  // raw crc state, without the final inversion
+  uint32_t state{~0u};
+
+ public:
+  void update(const ceph::bufferlist& data) { state = data.crc32c(state); }
+  uint32_t value() const { return ~state; }
+};
+
+/// Checksums are stored in DBVersionedObject::checksum as
+/// "crc32c:<hex>" for objects written in one go and as
+/// "crc32c:<hex>-<parts>" for multipart uploads, where <hex> is the
+/// crc32c of the parts' big-endian crc32c values (an S3 composite
+/// checksum). They cover the data as stored, i.e. after compression
+/// and encryption.
+std::string format_crc32c(uint32_t crc);
+std::string format_composite_crc32c(const std::vector<uint32_t>& part_crcs);
+
+/// Parse a full object checksum. Returns nullopt for composite or
+/// unknown checksums.
+std::optional<uint32_t> parse_crc32c(const std::string& checksum);
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,240 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "driver/sfs/content_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include <system_error>
+
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sfs_metadata.h"
+#include "rgw/driver/sfs/sqlite/sqlite_content.h"
+#include "rgw_common.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal::sfs {
+
+// hex sha256
+static constexpr size_t HASH_LEN = CEPH_CRYPTO_SHA256_DIGESTSIZE * 2;
+
+void ContentHasher::update(const ceph::bufferlist& data) {
+  for (const auto& bp : data.buffers()) {
+    sha.Update(
+        reinterpret_cast<const unsigned char*>(bp.c_str()), bp.length()
+    );
+  }
+}
+
+std::string ContentHasher::final() {
+  unsigned char digest[CEPH_CRYPTO_SHA256_DIGESTSIZE];
+  sha.Final(digest);
+  char hex[HASH_LEN + 1];
+  buf_to_hex(digest, CEPH_CRYPTO_SHA256_DIGESTSIZE, hex);
+  return std::string(hex, HASH_LEN);
+}
+
+// content refs are counted in the SQLite transaction that stores the
+// version, which the rocksdb metadata backend has no part in
+static bool dedup_enabled(CephContext* cct) {
+  if (!cct->_conf.get_val<bool>("rgw_sfs_dedup")) {
+    return false;
+  }
+  if (!metadata_in_sqlite(cct)) {
+    const NoDoutPrefix ndp(cct, dout_subsys);
+    lsfs_warn(&ndp) << "deduplication is not available with "
+                       "rgw_sfs_metadata_backend=rocksdb, ignoring "
+                       "rgw_sfs_dedup"
+                    << dendl;
+    return false;
+  }
+  return true;
+}
+
+ContentStore::ContentStore(
+    CephContext* _cct, const std::filesystem::path& _data_path,
+    sqlite::DBConnRef _conn
+)
+    : cct(_cct),
+      data_path(_data_path),
+      conn(_conn),
+      enabled(dedup_enabled(_cct)),
+      min_size(_cct->_conf.get_val<Option::size_t>("rgw_sfs_dedup_min_size")) {
+}
+
+std::filesystem::path ContentStore::content_path(const std::string& hash) {
+  return std::filesystem::path("content") / hash.substr(0, 2) / hash;
+}
+
+bool ContentStore::link_existing(
+    const DoutPrefixProvider* dpp, const std::filesystem::path& relpath,
+    const std::string& hash, uint64_t size
+) const {
+  const auto content = data_path / content_path(hash);
+  struct stat st;
+  if (::stat(content.c_str(), &st) < 0) {
+    return false;
+  }
+  if (static_cast<uint64_t>(st.st_size) != size) {
+    lsfs_warn(dpp) << fmt::format(
+                          "content file {} has size {}, expected {}. "
+                          "not deduplicating.",
+                          content.string(), st.st_size, size
+                      )
+                   << dendl;
+    return false;
+  }
+
+  // link next to the data file, then replace it. The data file is
+  // never missing, whatever fails.
+  const auto path = data_path / relpath;
+  auto tmp_path = path;
+  tmp_path += ".content";
+  if (::link(content.c_str(), tmp_path.c_str()) < 0) {
+    // ENOENT: removed by gc since we looked
+    lsfs_debug(dpp) << fmt::format(
+                           "failed to link content {} to {}: {}",
+                           content.string(), tmp_path.string(),
+                           cpp_strerror(errno)
+                       )
+                    << dendl;
+    return false;
+  }
+  if (::rename(tmp_path.c_str(), path.c_str()) < 0) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to rename {} to {}: {}. not deduplicating.",
+                         tmp_path.string(), path.string(), cpp_strerror(errno)
+                     )
+                  << dendl;
+    ::unlink(tmp_path.c_str());
+    return false;
+  }
+
+  lsfs_debug(dpp) << fmt::format(
+                         "data file {} shares content {}", relpath.string(),
+                         hash
+                     )
+                  << dendl;
+  return true;
+}
+
+bool ContentStore::tag(
+    const DoutPrefixProvider* dpp, int fd, const std::string& hash
+) const {
+  if (::fsetxattr(fd, HASH_XATTR, hash.data(), hash.size(), 0) < 0) {
+    // e.g. no user xattrs on this filesystem
+    lsfs_debug(dpp) << fmt::format(
+                           "failed to set content xattr on fd:{}: {}. "
+                           "not deduplicating.",
+                           fd, cpp_strerror(errno)
+                       )
+                    << dendl;
+    return false;
+  }
+  return true;
+}
+
+bool ContentStore::publish(
+    const DoutPrefixProvider* dpp, const std::filesystem::path& relpath,
+    const std::string& hash, uint64_t size
+) const {
+  const auto content = data_path / content_path(hash);
+  std::error_code ec;
+  std::filesystem::create_directories(content.parent_path(), ec);
+  if (ec) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to create content directory {}: {}. "
+                         "not deduplicating.",
+                         content.parent_path().string(), ec.message()
+                     )
+                  << dendl;
+    return false;
+  }
+  const auto path = data_path / relpath;
+  if (::link(path.c_str(), content.c_str()) < 0) {
+    // EEXIST: content of another size is in the way
+    lsfs_debug(dpp) << fmt::format(
+                           "failed to publish {} as content {}: {}",
+                           path.string(), content.string(), cpp_strerror(errno)
+                       )
+                    << dendl;
+    return false;
+  }
+  const int dir_fd = ::open(content.parent_path().c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    ::fsync(dir_fd);
+    ::close(dir_fd);
+  }
+  lsfs_debug(dpp) << fmt::format(
+                         "published {} as content {} ({} bytes)",
+                         relpath.string(), hash, size
+                     )
+                  << dendl;
+  return true;
+}
+
+void ContentStore::remove(const std::filesystem::path& path) const {
+  char hash_buf[HASH_LEN];
+  const ssize_t len =
+      ::getxattr(path.c_str(), HASH_XATTR, hash_buf, sizeof(hash_buf));
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+  if (len != static_cast<ssize_t>(HASH_LEN)) {
+    // not shared
+    return;
+  }
+
+  const NoDoutPrefix ndp(cct, dout_subsys);
+  const DoutPrefixProvider* dpp = &ndp;
+  const std::string hash(hash_buf, HASH_LEN);
+  const auto content = data_path / content_path(hash);
+  std::lock_guard l(refs_lock);
+  struct stat st;
+  if (::stat(content.c_str(), &st) < 0) {
+    // never published, or gone already
+    return;
+  }
+  // the content file itself holds one link
+  uint64_t refcount = st.st_nlink - 1;
+  if (refcount == 0) {
+    if (::unlink(content.c_str()) < 0 && errno != ENOENT) {
+      lsfs_err(dpp) << fmt::format(
+                           "failed to remove content file {}: {}",
+                           content.string(), cpp_strerror(errno)
+                       )
+                    << dendl;
+      return;
+    }
+    lsfs_debug(dpp) << fmt::format("removed unreferenced content {}", hash)
+                    << dendl;
+  }
+  try {
+    sqlite::SQLiteContent dbcontent(conn);
+    dbcontent.set_refcount(hash, refcount);
+  } catch (const std::system_error& e) {
+    lsfs_warn(dpp) << fmt::format(
+                          "failed to update references to content {}: {}. "
+                          "ignoring.",
+                          hash, e.what()
+                      )
+                   << dendl;
+  }
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <sys/types.h>
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+#include "common/ceph_crypto.h"
+#include "common/dout.h"
+#include "include/buffer.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+
+namespace rgw::sal::sfs {
+
+/// Incremental sha256 of an object's data, as written in order.
+class ContentHasher {
+  ceph::crypto::SHA256 sha;
+
+ public:
+  void update(const ceph::bufferlist& data);
+  /// Finish hashing. Returns the hex digest.
+  std::string final();
+};
+
+/// ContentStore deduplicates object data by content (rgw_sfs_dedup).
+///
+/// Data files are published below <data path>/content, named after the
+/// sha256 of their data. A new version with the same content becomes a
+/// hard link to the published file instead of a copy of its own.
+///
+/// Every published inode carries its hash in an xattr, so the hash of
+/// a version's data file can be found when the version is deleted.
+/// The content table counts the versions linking to each file. A
+/// writer links to the content and commits its version, counting the
+/// reference in the same transaction, all under lock(). Releases take
+/// the lock too, so they always find the table in step with the
+/// inode's link count; the published file is removed with the last
+/// link.
+class ContentStore {
+  CephContext* const cct;
+  const std::filesystem::path data_path;
+  sqlite::DBConnRef conn;
+  const bool enabled;
+  const uint64_t min_size;
+  // held from linking to content until the reference is committed, and
+  // by releases
+  mutable std::mutex refs_lock;
+
+ public:
+  static constexpr const char* HASH_XATTR = "user.s3gw.sfs.content";
+
+  ContentStore(
+      CephContext* cct, const std::filesystem::path& data_path,
+      sqlite::DBConnRef conn
+  );
+  ContentStore(const ContentStore&) = delete;
+  ContentStore& operator=(const ContentStore&) = delete;
+
+  /// Path of the published file for `hash`, relative to the data path.
+  static std::filesystem::path content_path(const std::string& hash);
+
+  /// true if writers should hash data for deduplication
+  bool is_enabled() const { return enabled; }
+  /// true if an object of `size` bytes is worth deduplicating
+  bool wants(uint64_t size) const {
+    return enabled && size > 0 && size >= min_size;
+  }
+
+  /// Lock out releases while linking to content. Hold it until the
+  /// version is committed with its reference (Object::metadata_finish)
+  /// or its data file is unlinked again.
+  std::unique_lock<std::mutex> lock() const {
+    return std::unique_lock(refs_lock);
+  }
+
+  /// Replace the data file at `relpath` by a link to the published file
+  /// for `hash`, if there is one. Returns true if the data file now
+  /// shares the published content; the caller's copy can be discarded.
+  /// Needs lock().
+  bool link_existing(
+      const DoutPrefixProvider* dpp, const std::filesystem::path& relpath,
+      const std::string& hash, uint64_t size
+  ) const;
+
+  /// Tag the data file open as `fd` with its content hash. Must be
+  /// done before it is synced and published.
+  bool tag(const DoutPrefixProvider* dpp, int fd, const std::string& hash)
+      const;
+
+  /// Publish the synced data file at `relpath` as the content for
+  /// `hash`. If that fails, e.g. because a file of another size is in
+  /// the way, the data file simply is not shared. Returns true if
+  /// published. Needs lock().
+  bool publish(
+      const DoutPrefixProvider* dpp, const std::filesystem::path& relpath,
+      const std::string& hash, uint64_t size
+  ) const;
+
+  /// Remove the data file at `path`, releasing its reference to the
+  /// published content if it has one. Shared data files must be removed
+  /// through here and never be truncated. Takes lock().
+  void remove(const std::filesystem::path& path) const;
+
+  const std::string get_cls_name() const { return "content_store"; }
+};
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,120 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/data_cache.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace rgw::sal::sfs {
+
+DataCache::DataCache(
+    uint64_t _max_bytes, uint64_t _max_object_size, size_t num_shards
+)
+    : max_bytes(_max_bytes), max_object_size(_max_object_size) {
+  if (num_shards == 0) {
+    num_shards = std::max(1u, std::thread::hardware_concurrency());
+  }
+  shards.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; ++i) {
+    shards.push_back(std::make_unique<Shard>());
+  }
+}
+
+std::optional<bufferlist> DataCache::get(
+    uint version_id, const uuid_d& object_id, const ceph::real_time& mtime
+) {
+  if (!is_enabled()) {
+    return std::nullopt;
+  }
+  auto& shard = shard_for(version_id);
+  std::lock_guard guard(shard.lock);
+  auto it = shard.entries.find(version_id);
+  if (it == shard.entries.end()) {
+    ++misses;
+    return std::nullopt;
+  }
+  if (it->second.object_id != object_id || it->second.mtime != mtime) {
+    erase_locked(shard, it);
+    ++misses;
+    return std::nullopt;
+  }
+  it->second.referenced = true;
+  ++hits;
+  return it->second.data;
+}
+
+void DataCache::put(
+    uint version_id, const uuid_d& object_id, const ceph::real_time& mtime,
+    const bufferlist& data
+) {
+  const uint64_t size = data.length();
+  if (!wants(size) || size > max_bytes) {
+    return;
+  }
+  auto& shard = shard_for(version_id);
+  std::lock_guard guard(shard.lock);
+  auto it = shard.entries.find(version_id);
+  if (it != shard.entries.end()) {
+    erase_locked(shard, it);
+  }
+  if (!make_room_locked(shard, size)) {
+    return;
+  }
+  auto pos = shard.clock.insert(shard.clock.end(), version_id);
+  shard.entries.emplace(
+      version_id, Entry{object_id, mtime, data, true, pos}
+  );
+  bytes += size;
+}
+
+void DataCache::erase(uint version_id) {
+  if (!is_enabled()) {
+    return;
+  }
+  auto& shard = shard_for(version_id);
+  std::lock_guard guard(shard.lock);
+  auto it = shard.entries.find(version_id);
+  if (it != shard.entries.end()) {
+    erase_locked(shard, it);
+  }
+}
+
+void DataCache::erase_locked(
+    Shard& shard, std::unordered_map<uint, Entry>::iterator it
+) {
+  bytes -= it->second.data.length();
+  shard.clock.erase(it->second.clock_pos);
+  shard.entries.erase(it);
+}
+
+bool DataCache::make_room_locked(Shard& shard, uint64_t needed) {
+  // Other shards may hold most of the budget. Only evict what this
+  // shard has and give up on the insert if that is not enough.
+  while (bytes.load() + needed > max_bytes) {
+    if (shard.clock.empty()) {
+      return false;
+    }
+    const uint victim = shard.clock.front();
+    auto it = shard.entries.find(victim);
+    if (it->second.referenced) {
+      it->second.referenced = false;
+      shard.clock.splice(shard.clock.end(), shard.clock, shard.clock.begin());
+      continue;
+    }
+    erase_locked(shard, it);
+  }
+  return true;
+}
+
+}  // namespace rgw::sal::sfs
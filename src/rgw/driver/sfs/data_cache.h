@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "common/ceph_time.h"
+#include "include/buffer.h"
+#include "include/uuid.h"
+
+namespace rgw::sal::sfs {
+
+/// In-memory copies of small object versions, keyed by version id.
+///
+/// A version's data never changes once committed. Entries carry the
+/// object uuid and mtime of the version they were filled from, so an
+/// entry outliving its version (a reused id) misses instead of serving
+/// stale data. Deletes erase entries early to give back the memory.
+///
+/// Entries are spread over shards, each with its own lock and CLOCK
+/// eviction. All shards share one byte budget.
+class DataCache {
+  struct Entry {
+    uuid_d object_id;
+    ceph::real_time mtime;
+    bufferlist data;
+    bool referenced{true};
+    std::list<uint>::iterator clock_pos;
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<uint, Entry> entries;
+    // CLOCK order, hand at the front
+    std::list<uint> clock;
+  };
+
+  const uint64_t max_bytes;
+  const uint64_t max_object_size;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::atomic_uint64_t bytes{0};
+  std::atomic_uint64_t hits{0};
+  std::atomic_uint64_t misses{0};
+
+  Shard& shard_for(uint version_id) const {
+    return *shards[version_id % shards.size()];
+  }
+  void erase_locked(Shard& shard, std::unordered_map<uint, Entry>::iterator it);
+  /// Evict from `shard` until `needed` more bytes fit the budget.
+  bool make_room_locked(Shard& shard, uint64_t needed);
+
+ public:
+  /// `num_shards` 0 picks one per core.
+  DataCache(uint64_t max_bytes, uint64_t max_object_size, size_t num_shards);
+  DataCache(const DataCache&) = delete;
+  DataCache& operator=(const DataCache&) = delete;
+
+  bool is_enabled() const { return max_bytes > 0 && max_object_size > 0; }
+  /// Whether versions of `size` bytes are cached at all
+  bool wants(uint64_t size) const {
+    return is_enabled() && size <= max_object_size;
+  }
+
+  /// The data of version `version_id` of object `object_id` last
+  /// modified at `mtime`, sharing the cached buffers.
+  std::optional<bufferlist> get(
+      uint version_id, const uuid_d& object_id, const ceph::real_time& mtime
+  );
+  void put(
+      uint version_id, const uuid_d& object_id, const ceph::real_time& mtime,
+      const bufferlist& data
+  );
+  void erase(uint version_id);
+
+  uint64_t get_bytes() const { return bytes.load(); }
+  uint64_t get_hits() const { return hits.load(); }
+  uint64_t get_misses() const { return misses.load(); }
+};
+
+}  // namespace rgw::sal::sfs
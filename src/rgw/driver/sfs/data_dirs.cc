@@ -0,0 +1,240 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "driver/sfs/data_dirs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <charconv>
+
+#include "common/ceph_time.h"
+#include "rgw/driver/sfs/sfs_log.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal::sfs {
+
+static std::optional<size_t> parse_fanout(const std::string& component) {
+  if (component.size() != 2) {
+    return std::nullopt;
+  }
+  size_t value = 0;
+  const auto res = std::from_chars(
+      component.data(), component.data() + component.size(), value, 16
+  );
+  if (res.ec != std::errc() || res.ptr != component.data() + component.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+DataDirs::DataDirs(const std::filesystem::path& _data_path, bool _use_openat)
+    : data_path(_data_path), use_openat(_use_openat) {
+  for (auto& k : known) {
+    k.store(0);
+  }
+  for (auto& fd : first_level_fds) {
+    fd.store(-1);
+  }
+}
+
+DataDirs::~DataDirs() {
+  for (auto& fd : first_level_fds) {
+    const int f = fd.exchange(-1);
+    if (f >= 0) {
+      ::close(f);
+    }
+  }
+  for (const int f : retired_fds) {
+    ::close(f);
+  }
+}
+
+std::optional<DataDirs::Split> DataDirs::split(
+    const std::filesystem::path& relpath
+) {
+  auto it = relpath.begin();
+  if (it == relpath.end()) {
+    return std::nullopt;
+  }
+  const auto first = parse_fanout(it->string());
+  if (!first.has_value() || ++it == relpath.end()) {
+    return std::nullopt;
+  }
+  const auto second = parse_fanout(it->string());
+  if (!second.has_value()) {
+    return std::nullopt;
+  }
+  std::filesystem::path rel_first;
+  for (; it != relpath.end(); ++it) {
+    rel_first /= *it;
+  }
+  // we need at least yy/<leaf dir>/<file>
+  if (std::distance(rel_first.begin(), rel_first.end()) < 3) {
+    return std::nullopt;
+  }
+  return Split{*first, *second, rel_first};
+}
+
+bool DataDirs::is_known(size_t idx) const {
+  return known[idx / 64].load(std::memory_order_relaxed) &
+         (uint64_t{1} << (idx % 64));
+}
+
+void DataDirs::set_known(size_t idx, bool value) {
+  const uint64_t bit = uint64_t{1} << (idx % 64);
+  if (value) {
+    known[idx / 64].fetch_or(bit, std::memory_order_relaxed);
+  } else {
+    known[idx / 64].fetch_and(~bit, std::memory_order_relaxed);
+  }
+}
+
+int DataDirs::first_level_fd(size_t first) {
+  if (!use_openat) {
+    return -1;
+  }
+  int fd = first_level_fds[first].load();
+  if (fd >= 0) {
+    return fd;
+  }
+  const auto path = data_path / fmt::format("{:02x}", first);
+  fd = ::open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  int expected = -1;
+  if (!first_level_fds[first].compare_exchange_strong(expected, fd)) {
+    // raced with another writer
+    ::close(fd);
+    return expected;
+  }
+  return fd;
+}
+
+std::error_code DataDirs::create_fanout(const Split& s) {
+  std::error_code ec;
+  std::filesystem::create_directories(
+      data_path / fmt::format("{:02x}", s.first) /
+          fmt::format("{:02x}", s.second),
+      ec
+  );
+  return ec;
+}
+
+void DataDirs::precreate(CephContext* cct) {
+  const NoDoutPrefix ndp(cct, dout_subsys);
+  const DoutPrefixProvider* dpp = &ndp;
+  const auto started = ceph::mono_clock::now();
+  for (size_t first = 0; first < FANOUT; first++) {
+    for (size_t second = 0; second < FANOUT; second++) {
+      const auto ec = create_fanout(Split{first, second, {}});
+      if (ec) {
+        lsfs_warn(dpp)
+            << fmt::format(
+                   "failed to create fan-out directory {:02x}/{:02x} in {}: "
+                   "{}. it will be created on demand.",
+                   first, second, data_path.string(), ec.message()
+               )
+            << dendl;
+        continue;
+      }
+      set_known(first * FANOUT + second, true);
+    }
+  }
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      ceph::mono_clock::now() - started
+  );
+  lsfs_startup(dpp) << fmt::format(
+                           "created data fan-out directories in {} in {}ms",
+                           data_path.string(), elapsed.count()
+                       )
+                    << dendl;
+}
+
+std::error_code DataDirs::ensure_parent(const std::filesystem::path& relpath) {
+  std::error_code ec;
+  const auto s = split(relpath);
+  if (!s.has_value()) {
+    std::filesystem::create_directories(
+        data_path / relpath.parent_path(), ec
+    );
+    return ec;
+  }
+
+  const size_t idx = s->first * FANOUT + s->second;
+  if (!is_known(idx)) {
+    ec = create_fanout(*s);
+    if (ec) {
+      return ec;
+    }
+    set_known(idx, true);
+  }
+
+  int ret;
+  const int dirfd = first_level_fd(s->first);
+  if (dirfd >= 0) {
+    ret = ::mkdirat(dirfd, s->rel_first.parent_path().c_str(), 0777);
+  } else {
+    ret = ::mkdir((data_path / relpath.parent_path()).c_str(), 0777);
+  }
+  if (ret == 0 || errno == EEXIST) {
+    return ec;
+  }
+  if (errno == ENOENT) {
+    // Something removed the fan-out directory underneath us, or the
+    // leaf is more than one level deep. Take the slow path.
+    forget(relpath);
+    std::filesystem::create_directories(
+        data_path / relpath.parent_path(), ec
+    );
+    if (!ec) {
+      set_known(idx, true);
+    }
+    return ec;
+  }
+  return std::error_code(errno, std::system_category());
+}
+
+int DataDirs::open(
+    const std::filesystem::path& relpath, int flags, mode_t mode
+) {
+  const auto s = split(relpath);
+  if (s.has_value()) {
+    const int dirfd = first_level_fd(s->first);
+    if (dirfd >= 0) {
+      return ::openat(dirfd, s->rel_first.c_str(), flags, mode);
+    }
+  }
+  return ::open((data_path / relpath).c_str(), flags, mode);
+}
+
+void DataDirs::forget(const std::filesystem::path& relpath) {
+  const auto s = split(relpath);
+  if (!s.has_value()) {
+    return;
+  }
+  set_known(s->first * FANOUT + s->second, false);
+  const int fd = first_level_fds[s->first].exchange(-1);
+  if (fd >= 0) {
+    // other threads may still be using it. close on destruction.
+    std::lock_guard l(retired_fds_lock);
+    retired_fds.push_back(fd);
+  }
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,91 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <sys/types.h>
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#include "common/dout.h"
+
+namespace rgw::sal::sfs {
+
+/// DataDirs keeps track of the UUIDPath fan-out directories (xx/yy)
+/// below the data path that are known to exist. Creating the directory
+/// for a new data file then takes a single mkdir() of the leaf instead
+/// of a create_directories() that stats every path component.
+///
+/// Optionally (rgw_sfs_data_dirs_openat) files are created and opened
+/// relative to cached fds of the first level fan-out directories.
+class DataDirs {
+ public:
+  static constexpr size_t FANOUT = 256;
+
+ private:
+  const std::filesystem::path data_path;
+  const bool use_openat;
+  // one bit per xx/yy fan-out directory known to exist
+  std::array<std::atomic<uint64_t>, FANOUT * FANOUT / 64> known;
+  // O_PATH fds of the first level fan-out directories, -1 if not open
+  std::array<std::atomic<int>, FANOUT> first_level_fds;
+  // fds dropped by forget(), closed on destruction
+  std::mutex retired_fds_lock;
+  std::vector<int> retired_fds;
+
+  struct Split {
+    size_t first;
+    size_t second;
+    // path relative to the first level directory
+    std::filesystem::path rel_first;
+  };
+  static std::optional<Split> split(const std::filesystem::path& relpath);
+
+  bool is_known(size_t idx) const;
+  void set_known(size_t idx, bool value);
+  int first_level_fd(size_t first);
+  std::error_code create_fanout(const Split& s);
+
+ public:
+  DataDirs(const std::filesystem::path& data_path, bool use_openat);
+  DataDirs(const DataDirs&) = delete;
+  DataDirs& operator=(const DataDirs&) = delete;
+  ~DataDirs();
+
+  /// Create all fan-out directories below the data path. Used at store
+  /// initialization when rgw_sfs_data_dirs_precreate is set.
+  void precreate(CephContext* cct);
+
+  /// Make sure the directory containing relpath exists. relpath is
+  /// relative to the data path and follows the UUIDPath layout. Paths
+  /// that do not follow it fall back to create_directories().
+  std::error_code ensure_parent(const std::filesystem::path& relpath);
+
+  /// open(2) relpath (relative to the data path). Returns the fd or -1
+  /// with errno set.
+  int open(const std::filesystem::path& relpath, int flags, mode_t mode = 0);
+
+  /// Forget cached state for the fan-out directory holding relpath.
+  /// Call this if a fan-out directory may have been removed.
+  void forget(const std::filesystem::path& relpath);
+
+  const std::string get_cls_name() const { return "data_dirs"; }
+};
+
+}  // namespace rgw::sal::sfs
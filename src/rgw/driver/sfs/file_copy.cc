@@ -0,0 +1,67 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/file_copy.h"
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace rgw::sal::sfs {
+
+int clone_file_range(int src_fd, int dst_fd, uint64_t dst_offset) {
+  // src_length 0 clones up to the source's EOF
+  struct file_clone_range clone = {
+      .src_fd = src_fd, .src_offset = 0, .src_length = 0,
+      .dest_offset = dst_offset};
+  if (::ioctl(dst_fd, FICLONERANGE, &clone) < 0) {
+    return -errno;
+  }
+  return 0;
+}
+
+int copy_file_data(int src_fd, int dst_fd, uint64_t dst_offset, uint64_t size) {
+  loff_t src_off = 0;
+  loff_t dst_off = dst_offset;
+  uint64_t remaining = size;
+  while (remaining > 0) {
+    const ssize_t ret =
+        ::copy_file_range(src_fd, &src_off, dst_fd, &dst_off, remaining, 0);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    if (ret == 0) {
+      // source shorter than expected
+      return -EIO;
+    }
+    remaining -= ret;
+  }
+  return 0;
+}
+
+int clone_or_copy_range(
+    int src_fd, int dst_fd, uint64_t dst_offset, uint64_t size
+) {
+  if (clone_file_range(src_fd, dst_fd, dst_offset) == 0) {
+    return 0;
+  }
+  return copy_file_data(src_fd, dst_fd, dst_offset, size);
+}
+
+}  // namespace rgw::sal::sfs
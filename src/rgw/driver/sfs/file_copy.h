@@ -0,0 +1,36 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace rgw::sal::sfs {
+
+/// Share the extents of the whole file `src_fd` with `dst_fd` at
+/// `dst_offset` (reflink, XFS/btrfs). Returns 0 or a negative errno;
+/// filesystems without reflink support and unaligned offsets fail.
+int clone_file_range(int src_fd, int dst_fd, uint64_t dst_offset);
+
+/// Copy `size` bytes of `src_fd` into `dst_fd` at `dst_offset` with
+/// copy_file_range(), which may still copy server-side. Returns 0 or a
+/// negative errno.
+int copy_file_data(int src_fd, int dst_fd, uint64_t dst_offset, uint64_t size);
+
+/// Copy the whole file `src_fd` into `dst_fd` at `dst_offset`, cloning
+/// if possible and copying otherwise. Returns 0 or a negative errno.
+int clone_or_copy_range(
+    int src_fd, int dst_fd, uint64_t dst_offset, uint64_t size
+);
+
+}  // namespace rgw::sal::sfs
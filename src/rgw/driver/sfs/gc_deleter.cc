@@ -0,0 +1,67 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/gc_deleter.h"
+
+#include <algorithm>
+
+#include "common/Thread.h"
+
+namespace rgw::sal::sfs {
+
+GCDeleterPool::GCDeleterPool(unsigned num_threads) {
+  num_threads = std::max(num_threads, 1u);
+  threads.reserve(num_threads);
+  for (unsigned i = 0; i < num_threads; ++i) {
+    threads.push_back(
+        make_named_thread("sfs_gc_delete", &GCDeleterPool::run, this)
+    );
+  }
+}
+
+GCDeleterPool::~GCDeleterPool() {
+  {
+    std::lock_guard l(lock);
+    stopping = true;
+  }
+  cond.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void GCDeleterPool::submit(std::function<void()> task) {
+  {
+    std::lock_guard l(lock);
+    tasks.push(std::move(task));
+  }
+  cond.notify_one();
+}
+
+void GCDeleterPool::run() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock l(lock);
+      cond.wait(l, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,161 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace rgw::sal::sfs {
+
+/// Threads the garbage collector deletes data files with. They live as
+/// long as the GC, so that the database connections they open (one per
+/// thread, see DBConn::get_storage()) are reused.
+class GCDeleterPool {
+  std::mutex lock;
+  std::condition_variable cond;
+  std::queue<std::function<void()>> tasks;
+  bool stopping{false};
+  std::vector<std::thread> threads;
+
+  void run();
+
+ public:
+  explicit GCDeleterPool(unsigned num_threads);
+  GCDeleterPool(const GCDeleterPool&) = delete;
+  GCDeleterPool& operator=(const GCDeleterPool&) = delete;
+  ~GCDeleterPool();
+
+  size_t size() const { return threads.size(); }
+  void submit(std::function<void()> task);
+};
+
+/// GCDataDeletion deletes the data of a batch of GC items on a
+/// GCDeleterPool, so that the caller can go on (e.g. removing the next
+/// batch from the database) in the meantime.
+///
+/// Items are grouped by the fan-out directory returned by `dir_of`; a
+/// group is always handled by a single thread, in order, so that
+/// removing emptied directories does not race with other deletions in
+/// the same directory. `should_stop` is checked after each deleted
+/// item; once it returns true, no thread starts deleting another one.
+/// So at least one item is deleted, but a thread may not get to any.
+template <typename Item>
+class GCDataDeletion {
+ public:
+  using DirFn = std::function<std::filesystem::path(const Item&)>;
+  using DeleteFn = std::function<void(const Item&)>;
+  using StopFn = std::function<bool()>;
+
+ private:
+  std::vector<Item> items;
+  // [begin, end) ranges of items sharing a directory
+  std::vector<std::pair<size_t, size_t>> groups;
+  // per item, written by the thread handling its group only
+  std::vector<uint8_t> deleted;
+  std::atomic<size_t> next_group{0};
+  std::atomic<bool> stopped{false};
+  DeleteFn delete_item;
+  StopFn should_stop;
+
+  std::mutex lock;
+  std::condition_variable cond;
+  size_t running{0};
+
+  void run() {
+    for (size_t group = next_group++; group < groups.size();
+         group = next_group++) {
+      for (size_t i = groups[group].first; i < groups[group].second; ++i) {
+        if (stopped) {
+          break;
+        }
+        delete_item(items[i]);
+        deleted[i] = 1;
+        if (should_stop()) {
+          stopped = true;
+        }
+      }
+    }
+    std::lock_guard l(lock);
+    if (--running == 0) {
+      cond.notify_all();
+    }
+  }
+
+  void join() {
+    std::unique_lock l(lock);
+    cond.wait(l, [this] { return running == 0; });
+  }
+
+ public:
+  GCDataDeletion(
+      GCDeleterPool& pool, std::vector<Item>&& _items, const DirFn& dir_of,
+      DeleteFn _delete_item, StopFn _should_stop
+  )
+      : delete_item(std::move(_delete_item)),
+        should_stop(std::move(_should_stop)) {
+    std::vector<std::pair<std::filesystem::path, size_t>> dirs;
+    dirs.reserve(_items.size());
+    for (size_t i = 0; i < _items.size(); ++i) {
+      dirs.emplace_back(dir_of(_items[i]), i);
+    }
+    std::stable_sort(
+        dirs.begin(), dirs.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; }
+    );
+    items.reserve(_items.size());
+    for (size_t i = 0; i < dirs.size(); ++i) {
+      if (i == 0 || dirs[i].first != dirs[i - 1].first) {
+        groups.emplace_back(i, i);
+      }
+      items.push_back(std::move(_items[dirs[i].second]));
+      groups.back().second = i + 1;
+    }
+    deleted.assign(items.size(), 0);
+
+    const size_t num_tasks = std::min(pool.size(), groups.size());
+    running = num_tasks;
+    for (size_t i = 0; i < num_tasks; ++i) {
+      pool.submit([this] { run(); });
+    }
+  }
+  GCDataDeletion(const GCDataDeletion&) = delete;
+  GCDataDeletion& operator=(const GCDataDeletion&) = delete;
+  ~GCDataDeletion() { join(); }
+
+  /// Wait for the deletion to finish. Items that were not deleted are
+  /// appended to `remaining`. Returns the number of items deleted.
+  size_t wait(std::vector<Item>& remaining) {
+    join();
+    size_t count = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+      if (deleted[i]) {
+        ++count;
+      } else {
+        remaining.push_back(std::move(items[i]));
+      }
+    }
+    items.clear();
+    return count;
+  }
+};
+
+}  // namespace rgw::sal::sfs
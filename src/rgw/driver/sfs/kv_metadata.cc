@@ -0,0 +1,2604 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/kv_metadata.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "include/encoding.h"
+#include "rgw/driver/sfs/multipart_types.h"
+#include "rgw/driver/sfs/object_state.h"
+#include "rgw/driver/sfs/sqlite/sqlite_object_tags.h"
+#include "rgw/driver/sfs/version_type.h"
+
+namespace rgw::sal::sfs {
+
+using sqlite::DBDeletedMultipartItems;
+using sqlite::DBDeletedObjectItems;
+using sqlite::DBExpiredVersionItems;
+using sqlite::DBMultipart;
+using sqlite::DBMultipartPart;
+using sqlite::DBObject;
+using sqlite::DBObjectsCommittedVersions;
+using sqlite::DBObjectsListItems;
+using sqlite::DBObjectsUpdate;
+using sqlite::DBObjectTagSet;
+using sqlite::DBOPBucketInfo;
+using sqlite::DBOPUserInfo;
+using sqlite::DBVersionedObject;
+using sqlite::DBVersionedObjectPart;
+
+// user id -> DBOPUserInfo
+static const std::string USERS_PREFIX = "users";
+// access key -> user id
+static const std::string ACCESS_KEYS_PREFIX = "access_keys";
+// email, user id -> empty
+static const std::string USER_EMAILS_PREFIX = "user_emails";
+// bucket id -> DBOPBucketInfo
+static const std::string BUCKETS_PREFIX = "buckets";
+// bucket id -> empty
+static const std::string BUCKET_DATA_DIRS_PREFIX = "bucket_data_dirs";
+// uuid -> DBObject
+static const std::string OBJECTS_PREFIX = "objects";
+// bucket id, uuid -> empty. all objects of a bucket
+static const std::string BUCKET_OBJECTS_PREFIX = "bucket_objects";
+// bucket id, name -> uuid of the last object stored with the name.
+// listings iterate it
+static const std::string OBJECT_NAMES_PREFIX = "object_names";
+// uuid, version id -> DBVersionedObject. versions of an object by id
+static const std::string VERSIONS_PREFIX = "versions";
+// version id -> uuid. all versions by id
+static const std::string VERSION_OBJECTS_PREFIX = "version_objects";
+// version_id string, version id -> empty
+static const std::string VERSION_IDS_PREFIX = "version_ids";
+// inverted size, version id -> uuid. deleted versions, largest first
+static const std::string DELETED_VERSIONS_PREFIX = "deleted_versions";
+// version id, part number -> DBVersionedObjectPart
+static const std::string PARTS_MANIFESTS_PREFIX = "parts_manifests";
+// upload id -> DBMultipart
+static const std::string MULTIPARTS_PREFIX = "multiparts";
+// multipart id -> upload id
+static const std::string MULTIPART_IDS_PREFIX = "multipart_ids";
+// bucket id, meta_str, upload id -> empty
+static const std::string BUCKET_MULTIPARTS_PREFIX = "bucket_multiparts";
+// upload id, part id -> DBMultipartPart
+static const std::string MULTIPART_PARTS_PREFIX = "multipart_parts";
+// upload id, part number -> part id
+static const std::string MULTIPART_PART_NUMS_PREFIX = "multipart_part_nums";
+// counter name -> last id handed out
+static const std::string COUNTERS_PREFIX = "counters";
+
+static const std::string VERSIONS_COUNTER = "versions";
+static const std::string PARTS_MANIFESTS_COUNTER = "parts_manifests";
+static const std::string MULTIPARTS_COUNTER = "multiparts";
+static const std::string MULTIPART_PARTS_COUNTER = "multipart_parts";
+
+// separates the parts of a key. ids, names and version ids never
+// contain it
+static constexpr char KEY_SEPARATOR = '\0';
+
+namespace {
+
+std::string join_key(const std::string& first, const std::string& second) {
+  std::string key = first;
+  key += KEY_SEPARATOR;
+  key += second;
+  return key;
+}
+
+// numbers are zero padded hex, so they sort numerically
+std::string number_key(uint64_t number) {
+  return fmt::format("{:016x}", number);
+}
+
+uint64_t parse_number_key(std::string_view key) {
+  return std::stoull(std::string(key), nullptr, 16);
+}
+
+// the part of key after its last separator
+std::string_view last_key_part(const std::string& key) {
+  const auto pos = key.rfind(KEY_SEPARATOR);
+  return pos == std::string::npos ? std::string_view(key)
+                                  : std::string_view(key).substr(pos + 1);
+}
+
+std::string version_key(const uuid_d& object_id, uint id) {
+  return join_key(object_id.to_string(), number_key(id));
+}
+
+// largest versions sort first
+std::string deleted_version_key(const DBVersionedObject& version) {
+  return join_key(
+      number_key(
+          std::numeric_limits<uint64_t>::max() -
+          static_cast<uint64_t>(version.size)
+      ),
+      number_key(version.id)
+  );
+}
+
+std::string part_num_key(uint32_t part_num) {
+  return fmt::format("{:08x}", part_num);
+}
+
+std::string bucket_multipart_key(const DBMultipart& mp) {
+  return join_key(join_key(mp.bucket_id, mp.meta_str), mp.upload_id);
+}
+
+void check(int ret, std::string_view what) {
+  if (ret < 0) {
+    throw std::system_error(
+        -ret, std::generic_category(), fmt::format("metadata db {}", what)
+    );
+  }
+}
+
+// Values are ceph encoded, records with a version header so fields can
+// be added later.
+
+void encode_record(const std::string& value, bufferlist& bl) {
+  using ceph::encode;
+  encode(value, bl);
+}
+
+void decode_record(std::string& value, bufferlist::const_iterator& it) {
+  using ceph::decode;
+  decode(value, it);
+}
+
+void encode_record(const uint64_t& value, bufferlist& bl) {
+  using ceph::encode;
+  encode(value, bl);
+}
+
+void decode_record(uint64_t& value, bufferlist::const_iterator& it) {
+  using ceph::decode;
+  decode(value, it);
+}
+
+void encode_record(const uuid_d& value, bufferlist& bl) {
+  using ceph::encode;
+  encode(value, bl);
+}
+
+void decode_record(uuid_d& value, bufferlist::const_iterator& it) {
+  using ceph::decode;
+  decode(value, it);
+}
+
+void encode_record(const DBOPUserInfo& user, bufferlist& bl) {
+  ENCODE_START(1, 1, bl);
+  encode(user.uinfo, bl);
+  encode(user.user_version, bl);
+  encode(user.user_attrs, bl);
+  ENCODE_FINISH(bl);
+}
+
+void decode_record(DBOPUserInfo& user, bufferlist::const_iterator& it) {
+  DECODE_START(1, it);
+  decode(user.uinfo, it);
+  decode(user.user_version, it);
+  decode(user.user_attrs, it);
+  DECODE_FINISH(it);
+}
+
+void encode_record(const DBOPBucketInfo& bucket, bufferlist& bl) {
+  ENCODE_START(1, 1, bl);
+  encode(bucket.binfo, bl);
+  encode(bucket.battrs, bl);
+  encode(bucket.deleted, bl);
+  encode(bucket.mtime, bl);
+  ENCODE_FINISH(bl);
+}
+
+void decode_record(DBOPBucketInfo& bucket, bufferlist::const_iterator& it) {
+  DECODE_START(1, it);
+  decode(bucket.binfo, it);
+  decode(bucket.battrs, it);
+  decode(bucket.deleted, it);
+  decode(bucket.mtime, it);
+  DECODE_FINISH(it);
+}
+
+void encode_record(const DBObject& object, bufferlist& bl) {
+  ENCODE_START(1, 1, bl);
+  encode(object.uuid, bl);
+  encode(object.bucket_id, bl);
+  encode(object.name, bl);
+  ENCODE_FINISH(bl);
+}
+
+void decode_record(DBObject& object, bufferlist::const_iterator& it) {
+  DECODE_START(1, it);
+  decode(object.uuid, it);
+  decode(object.bucket_id, it);
+  decode(object.name, it);
+  DECODE_FINISH(it);
+}
+
+void encode_record(const DBVersionedObject& version, bufferlist& bl) {
+  ENCODE_START(1, 1, bl);
+  encode(static_cast<uint32_t>(version.id), bl);
+  encode(version.object_id, bl);
+  encode(version.checksum, bl);
+  encode(static_cast<uint64_t>(version.size), bl);
+  encode(static_cast<uint64_t>(version.physical_size), bl);
+  encode(version.create_time, bl);
+  encode(version.delete_time, bl);
+  encode(version.commit_time, bl);
+  encode(version.mtime, bl);
+  encode(static_cast<uint32_t>(version.object_state), bl);
+  encode(version.version_id, bl);
+  encode(version.etag, bl);
+  encode(version.attrs, bl);
+  encode(static_cast<uint32_t>(version.version_type), bl);
+  ENCODE_FINISH(bl);
+}
+
+void decode_record(DBVersionedObject& version, bufferlist::const_iterator& it) {
+  DECODE_START(1, it);
+  uint32_t id;
+  decode(id, it);
+  version.id = id;
+  decode(version.object_id, it);
+  decode(version.checksum, it);
+  uint64_t size;
+  decode(size, it);
+  version.size = size;
+  decode(size, it);
+  version.physical_size = size;
+  decode(version.create_time, it);
+  decode(version.delete_time, it);
+  decode(version.commit_time, it);
+  decode(version.mtime, it);
+  uint32_t state;
+  decode(state, it);
+  version.object_state = static_cast<ObjectState>(state);
+  decode(version.version_id, it);
+  decode(version.etag, it);
+  decode(version.attrs, it);
+  uint32_t type;
+  decode(type, it);
+  version.version_type = static_cast<VersionType>(type);
+  DECODE_FINISH(it);
+}
+
+void encode_record(const DBVersionedObjectPart& part, bufferlist& bl) {
+  ENCODE_START(1, 1, bl);
+  encode(static_cast<uint32_t>(part.id), bl);
+  encode(static_cast<uint32_t>(part.versioned_object_id), bl);
+  encode(part.part_num, bl);
+  encode(static_cast<int32_t>(part.part_id), bl);
+  encode(part.offset, bl);
+  encode(part.size, bl);
+  ENCODE_FINISH(bl);
+}
+
+void decode_record(
+    DBVersionedObjectPart& part, bufferlist::const_iterator& it
+) {
+  DECODE_START(1, it);
+  uint32_t id;
+  decode(id, it);
+  part.id = id;
+  decode(id, it);
+  part.versioned_object_id = id;
+  decode(part.part_num, it);
+  int32_t part_id;
+  decode(part_id, it);
+  part.part_id = part_id;
+  decode(part.offset, it);
+  decode(part.size, it);
+  DECODE_FINISH(it);
+}
+
+void encode_record(const DBMultipart& mp, bufferlist& bl) {
+  ENCODE_START(1, 1, bl);
+  encode(static_cast<int32_t>(mp.id), bl);
+  encode(mp.bucket_id, bl);
+  encode(mp.upload_id, bl);
+  encode(static_cast<uint32_t>(mp.state), bl);
+  encode(mp.state_change_time, bl);
+  encode(mp.object_name, bl);
+  encode(mp.path_uuid, bl);
+  encode(mp.meta_str, bl);
+  encode(mp.owner_id, bl);
+  encode(mp.mtime, bl);
+  encode(mp.attrs, bl);
+  encode(mp.placement, bl);
+  ENCODE_FINISH(bl);
+}
+
+void decode_record(DBMultipart& mp, bufferlist::const_iterator& it) {
+  DECODE_START(1, it);
+  int32_t id;
+  decode(id, it);
+  mp.id = id;
+  decode(mp.bucket_id, it);
+  decode(mp.upload_id, it);
+  uint32_t state;
+  decode(state, it);
+  mp.state = static_cast<MultipartState>(state);
+  decode(mp.state_change_time, it);
+  decode(mp.object_name, it);
+  decode(mp.path_uuid, it);
+  decode(mp.meta_str, it);
+  decode(mp.owner_id, it);
+  decode(mp.mtime, it);
+  decode(mp.attrs, it);
+  decode(mp.placement, it);
+  DECODE_FINISH(it);
+}
+
+void encode_record(const DBMultipartPart& part, bufferlist& bl) {
+  ENCODE_START(1, 1, bl);
+  encode(static_cast<int32_t>(part.id), bl);
+  encode(part.upload_id, bl);
+  encode(part.part_num, bl);
+  encode(part.size, bl);
+  encode(part.etag, bl);
+  encode(part.mtime, bl);
+  encode(part.compression, bl);
+  encode(part.crc32c, bl);
+  ENCODE_FINISH(bl);
+}
+
+void decode_record(DBMultipartPart& part, bufferlist::const_iterator& it) {
+  DECODE_START(1, it);
+  int32_t id;
+  decode(id, it);
+  part.id = id;
+  decode(part.upload_id, it);
+  decode(part.part_num, it);
+  decode(part.size, it);
+  decode(part.etag, it);
+  decode(part.mtime, it);
+  decode(part.compression, it);
+  decode(part.crc32c, it);
+  DECODE_FINISH(it);
+}
+
+template <typename T>
+bufferlist to_bufferlist(const T& value) {
+  bufferlist bl;
+  encode_record(value, bl);
+  return bl;
+}
+
+template <typename T>
+T from_bufferlist(const bufferlist& bl) {
+  T value;
+  auto it = bl.cbegin();
+  decode_record(value, it);
+  return value;
+}
+
+// (commit_time, id) orders versions from oldest to latest
+bool older(const DBVersionedObject& lhs, const DBVersionedObject& rhs) {
+  return std::tie(lhs.commit_time, lhs.id) < std::tie(rhs.commit_time, rhs.id);
+}
+
+bool newer(const DBVersionedObject& lhs, const DBVersionedObject& rhs) {
+  return older(rhs, lhs);
+}
+
+/// The latest of versions for which pred holds, nullptr if none does
+template <typename Pred>
+const DBVersionedObject* latest_version(
+    const std::vector<DBVersionedObject>& versions, const Pred& pred
+) {
+  const DBVersionedObject* latest = nullptr;
+  for (const auto& version : versions) {
+    if (pred(version) && (latest == nullptr || older(*latest, version))) {
+      latest = &version;
+    }
+  }
+  return latest;
+}
+
+bool is_committed(const DBVersionedObject& version) {
+  return version.object_state == ObjectState::COMMITTED;
+}
+
+bool is_not_deleted(const DBVersionedObject& version) {
+  return version.object_state != ObjectState::DELETED;
+}
+
+bool has_tags(const DBVersionedObject& version, const DBObjectTagSet& tags) {
+  if (tags.empty()) {
+    return true;
+  }
+  if (version.version_type != VersionType::REGULAR) {
+    return false;
+  }
+  const auto version_tags = sqlite::decode_object_tags(version.attrs);
+  return std::ranges::all_of(tags, [&](const auto& tag) {
+    return std::ranges::find(version_tags, tag) != version_tags.end();
+  });
+}
+
+bool in_states(ObjectState state, const std::vector<ObjectState>& states) {
+  return std::ranges::find(states, state) != states.end();
+}
+
+// in progress uploads, the ones that can be aborted
+bool abortable(MultipartState state) {
+  return state >= MultipartState::INIT && state < MultipartState::COMPLETE;
+}
+
+bool done_or_aborted(MultipartState state) {
+  return state == MultipartState::DONE || state == MultipartState::ABORTED;
+}
+
+uint16_t to_dentry_flag(VersionType type, bool latest) {
+  uint16_t result = rgw_bucket_dir_entry::FLAG_VER;
+  if (latest) {
+    result |= rgw_bucket_dir_entry::FLAG_CURRENT;
+  }
+  if (type == VersionType::DELETE_MARKER) {
+    result |= rgw_bucket_dir_entry::FLAG_DELETE_MARKER;
+  }
+  return result;
+}
+
+}  // namespace
+
+class KVMetadata::Store {
+ public:
+  using Transaction = KeyValueDB::Transaction;
+
+  std::unique_ptr<KeyValueDB> db;
+  // held by calls that read before they write, until they submit, so
+  // their reads stay valid
+  mutable ceph::mutex write_lock = ceph::make_mutex("sfs::KVMetadata");
+  // last id handed out per counter. guarded by write_lock
+  mutable std::map<std::string, uint64_t> counters;
+
+  explicit Store(std::unique_ptr<KeyValueDB> _db) : db(std::move(_db)) {
+    scan(COUNTERS_PREFIX, "", "", [&](const std::string& key, auto& it) {
+      counters[key] = from_bufferlist<uint64_t>(it.value());
+      return true;
+    });
+  }
+
+  ~Store() { db->close(); }
+
+  template <typename T>
+  std::optional<T> get(const std::string& prefix, const std::string& key)
+      const {
+    bufferlist bl;
+    const int ret = db->get(prefix, key, &bl);
+    if (ret == -ENOENT) {
+      return std::nullopt;
+    }
+    check(ret, "read");
+    return from_bufferlist<T>(bl);
+  }
+
+  bool exists(const std::string& prefix, const std::string& key) const {
+    bufferlist bl;
+    const int ret = db->get(prefix, key, &bl);
+    if (ret == -ENOENT) {
+      return false;
+    }
+    check(ret, "read");
+    return true;
+  }
+
+  /// Visit the keys of prefix from `from` on, as long as they start
+  /// with key_prefix and visit returns true
+  template <typename Visit>
+  void scan(
+      const std::string& prefix, const std::string& from,
+      const std::string& key_prefix, const Visit& visit
+  ) const {
+    auto it = db->get_iterator(prefix);
+    it->lower_bound(std::max(from, key_prefix));
+    for (; it->valid(); it->next()) {
+      const auto key = it->key();
+      if (!key.starts_with(key_prefix) || !visit(key, *it)) {
+        break;
+      }
+    }
+  }
+
+  /// Values of the keys of prefix starting with key_prefix
+  template <typename T>
+  std::vector<T> values(
+      const std::string& prefix, const std::string& key_prefix
+  ) const {
+    std::vector<T> result;
+    scan(prefix, "", key_prefix, [&](const std::string&, auto& it) {
+      result.push_back(from_bufferlist<T>(it.value()));
+      return true;
+    });
+    return result;
+  }
+
+  Transaction transaction() const { return db->get_transaction(); }
+
+  void submit(Transaction t) const {
+    check(db->submit_transaction(t), "write");
+  }
+
+  template <typename T>
+  void set(
+      Transaction t, const std::string& prefix, const std::string& key,
+      const T& value
+  ) const {
+    t->set(prefix, key, to_bufferlist(value));
+  }
+
+  void set_empty(
+      Transaction t, const std::string& prefix, const std::string& key
+  ) const {
+    t->set(prefix, key, bufferlist());
+  }
+
+  /// Hand out the next id of counter. Needs write_lock, the counter is
+  /// persisted in t
+  uint64_t next_id(Transaction t, const std::string& counter) const {
+    const auto id = ++counters[counter];
+    set(t, COUNTERS_PREFIX, counter, id);
+    return id;
+  }
+
+  // objects
+
+  std::optional<DBObject> get_object(const uuid_d& uuid) const {
+    return get<DBObject>(OBJECTS_PREFIX, uuid.to_string());
+  }
+
+  std::optional<DBObject> get_object(
+      const std::string& bucket_id, const std::string& name
+  ) const {
+    const auto uuid =
+        get<uuid_d>(OBJECT_NAMES_PREFIX, join_key(bucket_id, name));
+    if (!uuid.has_value()) {
+      return std::nullopt;
+    }
+    return get_object(*uuid);
+  }
+
+  /// Up to max uuids of the objects of bucket_id
+  std::vector<uuid_d> bucket_objects(
+      const std::string& bucket_id,
+      size_t max = std::numeric_limits<size_t>::max()
+  ) const {
+    std::vector<uuid_d> uuids;
+    if (max == 0) {
+      return uuids;
+    }
+    scan(
+        BUCKET_OBJECTS_PREFIX, "", join_key(bucket_id, ""),
+        [&](const std::string& key, auto&) {
+          uuid_d uuid;
+          uuid.parse(std::string(last_key_part(key)).c_str());
+          uuids.push_back(uuid);
+          return uuids.size() < max;
+        }
+    );
+    return uuids;
+  }
+
+  void put_object(
+      Transaction t, const DBObject& object, const std::optional<DBObject>& old
+  ) const {
+    if (old.has_value() &&
+        (old->bucket_id != object.bucket_id || old->name != object.name)) {
+      remove_object_keys(t, *old);
+    }
+    set(t, OBJECTS_PREFIX, object.uuid.to_string(), object);
+    set_empty(
+        t, BUCKET_OBJECTS_PREFIX,
+        join_key(object.bucket_id, object.uuid.to_string())
+    );
+    set(t, OBJECT_NAMES_PREFIX, join_key(object.bucket_id, object.name),
+        object.uuid);
+  }
+
+  void remove_object(Transaction t, const DBObject& object) const {
+    remove_object_keys(t, object);
+    t->rmkey(OBJECTS_PREFIX, object.uuid.to_string());
+  }
+
+  // versions
+
+  std::optional<DBVersionedObject> get_version(uint id) const {
+    const auto object_id = get<uuid_d>(VERSION_OBJECTS_PREFIX, number_key(id));
+    if (!object_id.has_value()) {
+      return std::nullopt;
+    }
+    return get<DBVersionedObject>(
+        VERSIONS_PREFIX, version_key(*object_id, id)
+    );
+  }
+
+  /// All versions of an object, ordered by id
+  std::vector<DBVersionedObject> object_versions(const uuid_d& object_id
+  ) const {
+    return values<DBVersionedObject>(
+        VERSIONS_PREFIX, join_key(object_id.to_string(), "")
+    );
+  }
+
+  /// Store version, keeping the indexes of old in step
+  void put_version(
+      Transaction t, const DBVersionedObject& version,
+      const std::optional<DBVersionedObject>& old
+  ) const {
+    if (old.has_value()) {
+      remove_version_keys(t, *old);
+    }
+    set(t, VERSIONS_PREFIX, version_key(version.object_id, version.id),
+        version);
+    set(t, VERSION_OBJECTS_PREFIX, number_key(version.id), version.object_id);
+    if (!version.version_id.empty()) {
+      set_empty(
+          t, VERSION_IDS_PREFIX,
+          join_key(version.version_id, number_key(version.id))
+      );
+    }
+    if (version.object_state == ObjectState::DELETED) {
+      set(t, DELETED_VERSIONS_PREFIX, deleted_version_key(version),
+          version.object_id);
+    }
+  }
+
+  /// Add version with a new id, returns the id
+  uint insert_version(Transaction t, DBVersionedObject version) const {
+    version.id = static_cast<uint>(next_id(t, VERSIONS_COUNTER));
+    put_version(t, version, std::nullopt);
+    return version.id;
+  }
+
+  /// Remove version along with its parts manifest
+  void remove_version(Transaction t, const DBVersionedObject& version) const {
+    remove_version_keys(t, version);
+    remove_parts_manifest(t, version.id);
+  }
+
+  /// Soft delete version for the garbage collector
+  void delete_version(
+      Transaction t, const DBVersionedObject& version,
+      const ceph::real_time& now, bool update_mtime
+  ) const {
+    auto deleted = version;
+    deleted.object_state = ObjectState::DELETED;
+    deleted.delete_time = now;
+    if (update_mtime) {
+      deleted.mtime = now;
+    }
+    put_version(t, deleted, version);
+  }
+
+  void put_parts_manifest(
+      Transaction t, uint id, const std::vector<DBVersionedObjectPart>& parts
+  ) const {
+    remove_parts_manifest(t, id);
+    for (auto part : parts) {
+      part.id = static_cast<uint>(next_id(t, PARTS_MANIFESTS_COUNTER));
+      part.versioned_object_id = id;
+      set(t, PARTS_MANIFESTS_PREFIX,
+          join_key(number_key(id), part_num_key(part.part_num)), part);
+    }
+  }
+
+  void remove_parts_manifest(Transaction t, uint id) const {
+    scan(
+        PARTS_MANIFESTS_PREFIX, "", join_key(number_key(id), ""),
+        [&](const std::string& key, auto&) {
+          t->rmkey(PARTS_MANIFESTS_PREFIX, key);
+          return true;
+        }
+    );
+  }
+
+  /// Remove the objects of removed versions that have no regular
+  /// versions left, with their delete markers
+  void remove_emptied_objects(
+      Transaction t, const DBDeletedObjectItems& removed
+  ) const {
+    std::set<uint> removed_ids;
+    std::set<uuid_d> object_ids;
+    for (const auto& item : removed) {
+      removed_ids.insert(sqlite::get_version_id(item));
+      object_ids.insert(sqlite::get_uuid(item));
+    }
+    for (const auto& object_id : object_ids) {
+      std::vector<DBVersionedObject> left;
+      for (auto& version : object_versions(object_id)) {
+        if (!removed_ids.contains(version.id)) {
+          left.push_back(std::move(version));
+        }
+      }
+      if (std::ranges::any_of(left, [](const auto& version) {
+            return version.version_type == VersionType::REGULAR;
+          })) {
+        continue;
+      }
+      for (const auto& delete_marker : left) {
+        remove_version(t, delete_marker);
+      }
+      const auto object = get_object(object_id);
+      if (object.has_value()) {
+        remove_object(t, *object);
+      }
+    }
+  }
+
+  // multipart uploads
+
+  std::optional<DBMultipart> get_multipart(const std::string& upload_id
+  ) const {
+    if (upload_id.empty()) {
+      return std::nullopt;
+    }
+    return get<DBMultipart>(MULTIPARTS_PREFIX, upload_id);
+  }
+
+  /// Uploads of bucket_id ordered by meta_str, from meta_str marker on
+  template <typename Visit>
+  void scan_bucket_multiparts(
+      const std::string& bucket_id, const std::string& marker,
+      const Visit& visit
+  ) const {
+    const auto key_prefix = join_key(bucket_id, "");
+    scan(
+        BUCKET_MULTIPARTS_PREFIX, key_prefix + marker, key_prefix,
+        [&](const std::string& key, auto&) {
+          const auto mp = get_multipart(std::string(last_key_part(key)));
+          return !mp.has_value() || visit(*mp);
+        }
+    );
+  }
+
+  void put_multipart(Transaction t, const DBMultipart& mp) const {
+    set(t, MULTIPARTS_PREFIX, mp.upload_id, mp);
+    set(t, MULTIPART_IDS_PREFIX,
+        number_key(static_cast<uint64_t>(mp.id)), mp.upload_id);
+    set_empty(t, BUCKET_MULTIPARTS_PREFIX, bucket_multipart_key(mp));
+  }
+
+  void remove_multipart(Transaction t, const DBMultipart& mp) const {
+    t->rmkey(MULTIPARTS_PREFIX, mp.upload_id);
+    t->rmkey(MULTIPART_IDS_PREFIX, number_key(static_cast<uint64_t>(mp.id)));
+    t->rmkey(BUCKET_MULTIPARTS_PREFIX, bucket_multipart_key(mp));
+  }
+
+  /// Set the state of mp and when it changed
+  void change_state(
+      Transaction t, DBMultipart mp, MultipartState state
+  ) const {
+    mp.state = state;
+    mp.state_change_time = ceph::real_clock::now();
+    put_multipart(t, mp);
+  }
+
+  /// Parts of an upload, ordered by id
+  std::vector<DBMultipartPart> parts(const std::string& upload_id) const {
+    return values<DBMultipartPart>(
+        MULTIPART_PARTS_PREFIX, join_key(upload_id, "")
+    );
+  }
+
+  std::optional<DBMultipartPart> get_part(
+      const std::string& upload_id, uint32_t part_num
+  ) const {
+    const auto id = get<uint64_t>(
+        MULTIPART_PART_NUMS_PREFIX, join_key(upload_id, part_num_key(part_num))
+    );
+    if (!id.has_value()) {
+      return std::nullopt;
+    }
+    return get<DBMultipartPart>(
+        MULTIPART_PARTS_PREFIX, join_key(upload_id, number_key(*id))
+    );
+  }
+
+  void put_part(Transaction t, const DBMultipartPart& part) const {
+    const auto id = static_cast<uint64_t>(part.id);
+    set(t, MULTIPART_PARTS_PREFIX, join_key(part.upload_id, number_key(id)),
+        part);
+    set(t, MULTIPART_PART_NUMS_PREFIX,
+        join_key(part.upload_id, part_num_key(part.part_num)), id);
+  }
+
+  void remove_part(Transaction t, const DBMultipartPart& part) const {
+    t->rmkey(
+        MULTIPART_PARTS_PREFIX,
+        join_key(part.upload_id, number_key(static_cast<uint64_t>(part.id)))
+    );
+    t->rmkey(
+        MULTIPART_PART_NUMS_PREFIX,
+        join_key(part.upload_id, part_num_key(part.part_num))
+    );
+  }
+
+  /// Remove up to max_items parts of uploads, lowest ids first, and the
+  /// uploads left without parts. Without any parts to remove, all
+  /// uploads go.
+  DBDeletedMultipartItems remove_parts_of(
+      Transaction t, const std::vector<DBMultipart>& uploads, uint max_items
+  ) const {
+    std::vector<std::pair<DBMultipartPart, const DBMultipart*>> candidates;
+    std::map<std::string, size_t> left;
+    for (const auto& mp : uploads) {
+      auto mp_parts = parts(mp.upload_id);
+      left[mp.upload_id] = mp_parts.size();
+      for (auto& part : mp_parts) {
+        candidates.emplace_back(std::move(part), &mp);
+      }
+    }
+    DBDeletedMultipartItems removed;
+    if (candidates.empty()) {
+      for (const auto& mp : uploads) {
+        remove_multipart(t, mp);
+      }
+      return removed;
+    }
+    std::ranges::sort(candidates, [](const auto& lhs, const auto& rhs) {
+      return lhs.first.id < rhs.first.id;
+    });
+    if (candidates.size() > max_items) {
+      candidates.resize(max_items);
+    }
+    for (const auto& [part, mp] : candidates) {
+      remove_part(t, part);
+      removed.emplace_back(mp->upload_id, mp->path_uuid, part.id);
+      if (--left[mp->upload_id] == 0) {
+        remove_multipart(t, *mp);
+      }
+    }
+    return removed;
+  }
+
+ private:
+  void remove_object_keys(Transaction t, const DBObject& object) const {
+    t->rmkey(
+        BUCKET_OBJECTS_PREFIX,
+        join_key(object.bucket_id, object.uuid.to_string())
+    );
+    // the name may have moved on to a newer object
+    const auto name_key = join_key(object.bucket_id, object.name);
+    const auto named = get<uuid_d>(OBJECT_NAMES_PREFIX, name_key);
+    if (named.has_value() && *named == object.uuid) {
+      t->rmkey(OBJECT_NAMES_PREFIX, name_key);
+    }
+  }
+
+  void remove_version_keys(
+      Transaction t, const DBVersionedObject& version
+  ) const {
+    t->rmkey(VERSIONS_PREFIX, version_key(version.object_id, version.id));
+    t->rmkey(VERSION_OBJECTS_PREFIX, number_key(version.id));
+    if (!version.version_id.empty()) {
+      t->rmkey(
+          VERSION_IDS_PREFIX,
+          join_key(version.version_id, number_key(version.id))
+      );
+    }
+    if (version.object_state == ObjectState::DELETED) {
+      t->rmkey(DELETED_VERSIONS_PREFIX, deleted_version_key(version));
+    }
+  }
+};
+
+class KVMetadata::Users : public UsersBackend {
+  const Store& store;
+
+ public:
+  explicit Users(const Store& _store) : store(_store) {}
+
+  std::optional<DBOPUserInfo> get_user_by_email(const std::string& email
+  ) const override {
+    std::optional<DBOPUserInfo> user;
+    store.scan(
+        USER_EMAILS_PREFIX, "", join_key(email, ""),
+        [&](const std::string& key, auto&) {
+          user = get_user(std::string(last_key_part(key)));
+          return !user.has_value();
+        }
+    );
+    return user;
+  }
+
+  std::optional<DBOPUserInfo> get_user_by_access_key(const std::string& key
+  ) const override {
+    const auto user_id = store.get<std::string>(ACCESS_KEYS_PREFIX, key);
+    if (!user_id.has_value()) {
+      return std::nullopt;
+    }
+    return get_user(*user_id);
+  }
+
+  std::optional<DBOPUserInfo> get_user(const std::string& userid
+  ) const override {
+    return store.get<DBOPUserInfo>(USERS_PREFIX, userid);
+  }
+
+  std::vector<std::string> get_user_ids() const override {
+    std::vector<std::string> ids;
+    store.scan(USERS_PREFIX, "", "", [&](const std::string& key, auto&) {
+      ids.push_back(key);
+      return true;
+    });
+    return ids;
+  }
+
+  void store_user(const DBOPUserInfo& user) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    const auto& user_id = user.uinfo.user_id.id;
+    const auto old = get_user(user_id);
+    if (old.has_value()) {
+      remove_keys(t, *old);
+    }
+    store.set(t, USERS_PREFIX, user_id, user);
+    for (const auto& [key, access_key] : user.uinfo.access_keys) {
+      store.set(t, ACCESS_KEYS_PREFIX, key, user_id);
+    }
+    if (!user.uinfo.user_email.empty()) {
+      store.set_empty(
+          t, USER_EMAILS_PREFIX, join_key(user.uinfo.user_email, user_id)
+      );
+    }
+    store.submit(t);
+  }
+
+  void remove_user(const std::string& userid) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto old = get_user(userid);
+    if (!old.has_value()) {
+      return;
+    }
+    auto t = store.transaction();
+    remove_keys(t, *old);
+    t->rmkey(USERS_PREFIX, userid);
+    store.submit(t);
+  }
+
+ private:
+  void remove_keys(Store::Transaction t, const DBOPUserInfo& user) const {
+    for (const auto& [key, access_key] : user.uinfo.access_keys) {
+      t->rmkey(ACCESS_KEYS_PREFIX, key);
+    }
+    if (!user.uinfo.user_email.empty()) {
+      t->rmkey(
+          USER_EMAILS_PREFIX,
+          join_key(user.uinfo.user_email, user.uinfo.user_id.id)
+      );
+    }
+  }
+};
+
+class KVMetadata::Buckets : public BucketsBackend {
+  const Store& store;
+
+ public:
+  explicit Buckets(const Store& _store) : store(_store) {}
+
+  std::optional<DBOPBucketInfo> get_bucket(const std::string& bucket_id
+  ) const override {
+    return store.get<DBOPBucketInfo>(BUCKETS_PREFIX, bucket_id);
+  }
+
+  std::vector<DBOPBucketInfo> get_bucket_by_name(
+      const std::string& bucket_name
+  ) const override {
+    auto buckets = get_buckets();
+    std::erase_if(buckets, [&](const auto& bucket) {
+      return bucket.binfo.bucket.name != bucket_name;
+    });
+    return buckets;
+  }
+
+  std::optional<std::pair<std::string, std::string>> get_owner(
+      const std::string& bucket_id
+  ) const override {
+    const auto bucket = get_bucket(bucket_id);
+    if (!bucket.has_value()) {
+      return std::nullopt;
+    }
+    const auto owner = store.get<DBOPUserInfo>(
+        USERS_PREFIX, bucket->binfo.owner.id
+    );
+    if (!owner.has_value()) {
+      return std::nullopt;
+    }
+    return std::make_pair(
+        owner->uinfo.user_id.id, owner->uinfo.display_name
+    );
+  }
+
+  void store_bucket(const DBOPBucketInfo& bucket) const override {
+    auto t = store.transaction();
+    store.set(t, BUCKETS_PREFIX, bucket.binfo.bucket.bucket_id, bucket);
+    store.submit(t);
+  }
+
+  void remove_bucket(const std::string& bucket_id) const override {
+    auto t = store.transaction();
+    t->rmkey(BUCKETS_PREFIX, bucket_id);
+    store.submit(t);
+  }
+
+  std::vector<std::string> get_bucket_ids() const override {
+    return names(get_buckets());
+  }
+
+  std::vector<std::string> get_bucket_ids(const std::string& user_id
+  ) const override {
+    return names(get_buckets(user_id));
+  }
+
+  std::vector<DBOPBucketInfo> get_buckets() const override {
+    return store.values<DBOPBucketInfo>(BUCKETS_PREFIX, "");
+  }
+
+  std::vector<DBOPBucketInfo> get_buckets(const std::string& user_id
+  ) const override {
+    auto buckets = get_buckets();
+    std::erase_if(buckets, [&](const auto& bucket) {
+      return bucket.binfo.owner.id != user_id;
+    });
+    return buckets;
+  }
+
+  std::vector<std::string> get_deleted_buckets_ids() const override {
+    std::vector<std::string> ids;
+    for (const auto& bucket : get_buckets()) {
+      if (bucket.deleted) {
+        ids.push_back(bucket.binfo.bucket.bucket_id);
+      }
+    }
+    return ids;
+  }
+
+  bool bucket_empty(const std::string& bucket_id) const override {
+    for (const auto& uuid : store.bucket_objects(bucket_id)) {
+      for (const auto& version : store.object_versions(uuid)) {
+        if (is_committed(version) &&
+            version.version_type == VersionType::REGULAR) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  std::optional<DBDeletedObjectItems> delete_bucket_transact(
+      const std::string& bucket_id, uint max_objects, bool& bucket_deleted
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    bucket_deleted = false;
+    auto t = store.transaction();
+    std::vector<DBVersionedObject> versions;
+    const auto uuids = store.bucket_objects(bucket_id);
+    for (const auto& uuid : uuids) {
+      for (auto& version : store.object_versions(uuid)) {
+        versions.push_back(std::move(version));
+      }
+    }
+    std::ranges::stable_sort(versions, [](const auto& lhs, const auto& rhs) {
+      return lhs.size > rhs.size;
+    });
+    if (versions.size() > max_objects) {
+      versions.resize(max_objects);
+    }
+    DBDeletedObjectItems removed;
+    std::map<uuid_d, size_t> removed_per_object;
+    for (const auto& version : versions) {
+      store.remove_version(t, version);
+      removed.emplace_back(version.object_id, version.id, bucket_id);
+      removed_per_object[version.object_id]++;
+    }
+    // objects go once all their versions did
+    size_t objects_left = uuids.size();
+    for (const auto& [uuid, count] : removed_per_object) {
+      if (store.object_versions(uuid).size() == count) {
+        const auto object = store.get_object(uuid);
+        if (object.has_value()) {
+          store.remove_object(t, *object);
+        }
+        objects_left--;
+      }
+    }
+    if (objects_left == 0 && !has_multiparts(bucket_id)) {
+      t->rmkey(BUCKETS_PREFIX, bucket_id);
+      bucket_deleted = true;
+    }
+    store.submit(t);
+    return removed;
+  }
+
+  std::optional<size_t> drop_bucket_rows_transact(
+      const std::string& bucket_id, uint max_objects, bool& bucket_deleted
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    bucket_deleted = false;
+    auto t = store.transaction();
+    const auto uuids = store.bucket_objects(bucket_id, max_objects);
+    if (!uuids.empty()) {
+      for (const auto& uuid : uuids) {
+        for (const auto& version : store.object_versions(uuid)) {
+          store.remove_version(t, version);
+        }
+        const auto object = store.get_object(uuid);
+        if (object.has_value()) {
+          store.remove_object(t, *object);
+        }
+      }
+      store.submit(t);
+      return uuids.size();
+    }
+    // multipart uploads keep the bucket around
+    if (!has_multiparts(bucket_id)) {
+      t->rmkey(BUCKETS_PREFIX, bucket_id);
+      t->rmkey(BUCKET_DATA_DIRS_PREFIX, bucket_id);
+      store.submit(t);
+      bucket_deleted = true;
+    }
+    return 0;
+  }
+
+  void add_bucket_data_dir(const std::string& bucket_id) const override {
+    auto t = store.transaction();
+    store.set_empty(t, BUCKET_DATA_DIRS_PREFIX, bucket_id);
+    store.submit(t);
+  }
+
+  std::vector<std::string> get_bucket_data_dirs() const override {
+    std::vector<std::string> ids;
+    store.scan(
+        BUCKET_DATA_DIRS_PREFIX, "", "",
+        [&](const std::string& key, auto&) {
+          ids.push_back(key);
+          return true;
+        }
+    );
+    return ids;
+  }
+
+  const std::optional<Stats> get_stats(const std::string& bucket_id
+  ) const override {
+    Stats stats{0, 0, 0};
+    for (const auto& uuid : store.bucket_objects(bucket_id)) {
+      for (const auto& version : store.object_versions(uuid)) {
+        if (is_committed(version)) {
+          stats.obj_count++;
+          stats.size += version.size;
+          stats.physical_size += version.physical_size;
+        }
+      }
+    }
+    return stats;
+  }
+
+ private:
+  static std::vector<std::string> names(
+      const std::vector<DBOPBucketInfo>& buckets
+  ) {
+    std::vector<std::string> result;
+    result.reserve(buckets.size());
+    for (const auto& bucket : buckets) {
+      result.push_back(bucket.binfo.bucket.name);
+    }
+    return result;
+  }
+
+  bool has_multiparts(const std::string& bucket_id) const {
+    bool found = false;
+    store.scan_bucket_multiparts(bucket_id, "", [&](const DBMultipart&) {
+      found = true;
+      return false;
+    });
+    return found;
+  }
+};
+
+class KVMetadata::Objects : public ObjectsBackend {
+  const Store& store;
+
+ public:
+  explicit Objects(const Store& _store) : store(_store) {}
+
+  std::vector<DBObject> get_objects(const std::string& bucket_id
+  ) const override {
+    std::vector<DBObject> objects;
+    for (const auto& uuid : store.bucket_objects(bucket_id)) {
+      auto object = store.get_object(uuid);
+      if (object.has_value()) {
+        objects.push_back(std::move(*object));
+      }
+    }
+    return objects;
+  }
+
+  std::optional<DBObject> get_object(const uuid_d& uuid) const override {
+    return store.get_object(uuid);
+  }
+
+  std::optional<DBObject> get_object(
+      const std::string& bucket_id, const std::string& object_name
+  ) const override {
+    return store.get_object(bucket_id, object_name);
+  }
+
+  void store_object(const DBObject& object) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    store.put_object(t, object, store.get_object(object.uuid));
+    store.submit(t);
+  }
+
+  void remove_object(const uuid_d& uuid) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto object = store.get_object(uuid);
+    if (!object.has_value()) {
+      return;
+    }
+    auto t = store.transaction();
+    store.remove_object(t, *object);
+    store.submit(t);
+  }
+};
+
+class KVMetadata::VersionedObjects : public VersionedObjectsBackend {
+  const Store& store;
+
+ public:
+  explicit VersionedObjects(const Store& _store) : store(_store) {}
+
+  std::optional<DBVersionedObject> get_versioned_object(
+      uint id, bool filter_deleted
+  ) const override {
+    auto version = store.get_version(id);
+    if (version.has_value() && filter_deleted && !is_not_deleted(*version)) {
+      return std::nullopt;
+    }
+    return version;
+  }
+
+  std::optional<DBVersionedObject> get_versioned_object(
+      const std::string& version_id, bool filter_deleted
+  ) const override {
+    std::vector<uint> ids;
+    store.scan(
+        VERSION_IDS_PREFIX, "", join_key(version_id, ""),
+        [&](const std::string& key, auto&) {
+          ids.push_back(static_cast<uint>(parse_number_key(last_key_part(key)))
+          );
+          return true;
+        }
+    );
+    ceph_assert(ids.size() <= 1);
+    if (ids.empty()) {
+      return std::nullopt;
+    }
+    return get_versioned_object(ids.front(), filter_deleted);
+  }
+
+  std::optional<DBVersionedObject> get_committed_versioned_object(
+      const std::string& bucket_id, const std::string& object_name,
+      const std::string& version_id
+  ) const override {
+    const auto object = store.get_object(bucket_id, object_name);
+    if (!object.has_value()) {
+      return std::nullopt;
+    }
+    const auto versions = store.object_versions(object->uuid);
+    if (version_id.empty()) {
+      const auto latest = latest_version(versions, is_committed);
+      return latest == nullptr ? std::nullopt
+                               : std::make_optional(*latest);
+    }
+    std::optional<DBVersionedObject> found;
+    for (const auto& version : versions) {
+      if (is_committed(version) && version.version_id == version_id) {
+        ceph_assert(!found.has_value());
+        found = version;
+      }
+    }
+    return found;
+  }
+
+  DBObjectsListItems list_last_versioned_objects(const std::string& bucket_id
+  ) const override {
+    std::vector<std::pair<DBObject, DBVersionedObject>> lasts;
+    for (const auto& uuid : store.bucket_objects(bucket_id)) {
+      const auto object = store.get_object(uuid);
+      const auto versions = store.object_versions(uuid);
+      const auto last = latest_version(versions, is_not_deleted);
+      if (object.has_value() && last != nullptr) {
+        lasts.emplace_back(*object, *last);
+      }
+    }
+    std::ranges::stable_sort(lasts, [](const auto& lhs, const auto& rhs) {
+      return lhs.second.create_time < rhs.second.create_time;
+    });
+    DBObjectsListItems items;
+    items.reserve(lasts.size());
+    for (auto& [object, version] : lasts) {
+      items.emplace_back(
+          object.uuid, object.name, version.version_id,
+          std::make_unique<ceph::real_time>(version.commit_time),
+          std::make_unique<uint>(version.id), version.size, version.etag,
+          version.mtime, version.delete_time, version.attrs,
+          version.version_type, version.object_state
+      );
+    }
+    return items;
+  }
+
+  uint insert_versioned_object(const DBVersionedObject& object
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    const auto id = store.insert_version(t, object);
+    store.submit(t);
+    return id;
+  }
+
+  void store_versioned_object(const DBVersionedObject& object
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto old = store.get_version(object.id);
+    if (!old.has_value()) {
+      return;
+    }
+    auto t = store.transaction();
+    store.put_version(t, object, old);
+    store.submit(t);
+  }
+
+  // Deduplication is off with this backend, see metadata_in_sqlite(),
+  // so content_hash is always empty.
+  bool store_versioned_object_if_state(
+      const DBVersionedObject& object, std::vector<ObjectState> allowed_states,
+      const std::vector<DBVersionedObjectPart>& parts,
+      const std::string& /*content_hash*/
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    if (!put_if_state(t, object, allowed_states, parts)) {
+      return false;
+    }
+    store.submit(t);
+    return true;
+  }
+
+  void remove_versioned_object(uint id) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto version = store.get_version(id);
+    if (!version.has_value()) {
+      return;
+    }
+    auto t = store.transaction();
+    store.remove_version(t, *version);
+    store.submit(t);
+  }
+
+  bool store_versioned_object_delete_committed_transact_if_state(
+      const DBVersionedObject& object, std::vector<ObjectState> allowed_states,
+      uint* num_deleted, const std::vector<DBVersionedObjectPart>& parts,
+      const std::string& /*content_hash*/
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    if (num_deleted != nullptr) {
+      *num_deleted = 0;
+    }
+    auto t = store.transaction();
+    if (!put_if_state(t, object, allowed_states, parts)) {
+      return false;
+    }
+    // soft delete all other _COMMITTED_ versions. Leave OPEN versions
+    // alone, as they may be an in progress write racing us.
+    uint deleted = 0;
+    for (const auto& version : store.object_versions(object.object_id)) {
+      if (version.id != object.id && is_committed(version)) {
+        auto soft_deleted = version;
+        soft_deleted.object_state = ObjectState::DELETED;
+        store.put_version(t, soft_deleted, version);
+        deleted++;
+      }
+    }
+    store.submit(t);
+    if (num_deleted != nullptr) {
+      *num_deleted = deleted;
+    }
+    return true;
+  }
+
+  std::vector<uint> get_versioned_object_ids(bool filter_deleted
+  ) const override {
+    std::vector<uint> ids;
+    store.scan(
+        VERSION_OBJECTS_PREFIX, "", "",
+        [&](const std::string& key, auto&) {
+          const auto id = static_cast<uint>(parse_number_key(key));
+          if (!filter_deleted || get_versioned_object(id, true).has_value()) {
+            ids.push_back(id);
+          }
+          return true;
+        }
+    );
+    return ids;
+  }
+
+  std::vector<uint> get_versioned_object_ids(
+      const uuid_d& object_id, bool filter_deleted
+  ) const override {
+    std::vector<uint> ids;
+    for (const auto& version : store.object_versions(object_id)) {
+      if (!filter_deleted || is_not_deleted(version)) {
+        ids.push_back(version.id);
+      }
+    }
+    return ids;
+  }
+
+  std::vector<DBVersionedObject> get_versioned_objects(
+      const uuid_d& object_id, bool filter_deleted
+  ) const override {
+    auto versions = store.object_versions(object_id);
+    if (filter_deleted) {
+      std::erase_if(versions, [](const auto& version) {
+        return !is_not_deleted(version);
+      });
+      std::ranges::stable_sort(versions, [](const auto& lhs, const auto& rhs) {
+        return lhs.commit_time > rhs.commit_time;
+      });
+    }
+    return versions;
+  }
+
+  // the version with the highest id, as the SQLite query returns
+  std::optional<DBVersionedObject> get_last_versioned_object(
+      const uuid_d& object_id, bool filter_deleted
+  ) const override {
+    auto versions = store.object_versions(object_id);
+    for (auto version = versions.rbegin(); version != versions.rend();
+         ++version) {
+      if (!filter_deleted || is_not_deleted(*version)) {
+        return *version;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<DBVersionedObject> delete_version_and_get_previous_transact(
+      const uuid_d& object_id, uint id
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto removed = store.get_version(id);
+    if (!removed.has_value()) {
+      return std::nullopt;
+    }
+    auto t = store.transaction();
+    store.remove_version(t, *removed);
+    auto versions = store.object_versions(object_id);
+    std::erase_if(versions, [&](const auto& version) {
+      return version.id == id;
+    });
+    store.submit(t);
+    const auto previous = latest_version(versions, is_not_deleted);
+    return previous == nullptr ? std::nullopt : std::make_optional(*previous);
+  }
+
+  std::optional<DBVersionedObject> create_new_versioned_object_transact(
+      const std::string& bucket_id, const std::string& object_name,
+      const std::string& version_id
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    auto object = store.get_object(bucket_id, object_name);
+    if (!object.has_value()) {
+      object = DBObject{};
+      object->uuid.generate_random();
+      object->bucket_id = bucket_id;
+      object->name = object_name;
+      store.put_object(t, *object, std::nullopt);
+    }
+    DBVersionedObject version{};
+    version.object_id = object->uuid;
+    version.object_state = ObjectState::OPEN;
+    version.version_type = VersionType::REGULAR;
+    version.version_id = version_id;
+    version.create_time = ceph::real_clock::now();
+    version.id = store.insert_version(t, version);
+    store.submit(t);
+    return version;
+  }
+
+  bool add_delete_marker_transact(
+      const uuid_d& object_id, const std::string& delete_marker_id,
+      uint* out_id
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto versions = store.object_versions(object_id);
+    const auto last = latest_version(versions, is_not_deleted);
+    if (last == nullptr || last->version_type != VersionType::REGULAR ||
+        (last->object_state != ObjectState::COMMITTED &&
+         last->object_state != ObjectState::OPEN)) {
+      return false;
+    }
+    auto t = store.transaction();
+    const auto id = store.insert_version(
+        t, make_delete_marker(*last, delete_marker_id, ceph::real_clock::now())
+    );
+    store.submit(t);
+    if (out_id) {
+      *out_id = id;
+    }
+    return true;
+  }
+
+  std::optional<DBDeletedObjectItems> remove_deleted_versions_transact(
+      uint max_objects
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    std::vector<DBVersionedObject> versions;
+    if (max_objects > 0) {
+      store.scan(
+          DELETED_VERSIONS_PREFIX, "", "",
+          [&](const std::string& key, auto&) {
+            const auto version = store.get_version(
+                static_cast<uint>(parse_number_key(last_key_part(key)))
+            );
+            if (version.has_value()) {
+              versions.push_back(*version);
+            }
+            return versions.size() < max_objects;
+          }
+      );
+    }
+    return remove_deleted(versions);
+  }
+
+  std::optional<DBDeletedObjectItems> remove_deleted_object_versions_transact(
+      const uuid_d& object_id, uint max_objects
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto versions = store.object_versions(object_id);
+    std::erase_if(versions, [](const auto& version) {
+      return is_not_deleted(version);
+    });
+    if (versions.size() > max_objects) {
+      versions.resize(max_objects);
+    }
+    return remove_deleted(versions);
+  }
+
+  int count_deleted_versions() const override {
+    int count = 0;
+    store.scan(
+        DELETED_VERSIONS_PREFIX, "", "",
+        [&](const std::string&, auto&) {
+          count++;
+          return true;
+        }
+    );
+    return count;
+  }
+
+  int set_all_open_versions_to_deleted() const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    const auto now = ceph::real_clock::now();
+    int changed = 0;
+    store.scan(VERSIONS_PREFIX, "", "", [&](const std::string&, auto& it) {
+      const auto version = from_bufferlist<DBVersionedObject>(it.value());
+      if (version.object_state == ObjectState::OPEN) {
+        store.delete_version(t, version, now, false);
+        changed++;
+      }
+      return true;
+    });
+    store.submit(t);
+    return changed;
+  }
+
+  bool store_parts_manifest(
+      uint id, const std::vector<DBVersionedObjectPart>& parts
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    store.put_parts_manifest(t, id, parts);
+    store.submit(t);
+    return true;
+  }
+
+  std::vector<DBVersionedObjectPart> get_parts_manifest(uint id
+  ) const override {
+    return store.values<DBVersionedObjectPart>(
+        PARTS_MANIFESTS_PREFIX, join_key(number_key(id), "")
+    );
+  }
+
+  std::vector<DBVersionedObject> get_committed_versions_after(
+      uint after, uint max
+  ) const override {
+    std::vector<DBVersionedObject> versions;
+    if (max == 0) {
+      return versions;
+    }
+    store.scan(
+        VERSION_OBJECTS_PREFIX, number_key(static_cast<uint64_t>(after) + 1),
+        "",
+        [&](const std::string& key, auto& it) {
+          const auto object_id = from_bufferlist<uuid_d>(it.value());
+          const auto version = store.get<DBVersionedObject>(
+              VERSIONS_PREFIX, join_key(object_id.to_string(), key)
+          );
+          if (version.has_value() && is_committed(*version) &&
+              version->version_type == VersionType::REGULAR) {
+            versions.push_back(*version);
+          }
+          return versions.size() < max;
+        }
+    );
+    return versions;
+  }
+
+  bool update_objects_transact(
+      const std::string& bucket_id, const std::vector<std::string>& names,
+      const std::function<DBObjectsUpdate(const DBObjectsCommittedVersions&)>&
+          plan
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    DBObjectsCommittedVersions objects;
+    for (const auto& name : names) {
+      const auto object = store.get_object(bucket_id, name);
+      if (!object.has_value() || objects.contains(name)) {
+        continue;
+      }
+      auto versions = store.object_versions(object->uuid);
+      std::erase_if(versions, [](const auto& version) {
+        return !is_committed(version);
+      });
+      if (versions.empty()) {
+        continue;
+      }
+      std::ranges::sort(versions, newer);
+      objects[name] = {*object, std::move(versions)};
+    }
+
+    const auto update = plan(objects);
+    auto t = store.transaction();
+    const auto now = ceph::real_clock::now();
+    for (const auto id : update.delete_ids) {
+      const auto version = store.get_version(id);
+      if (version.has_value()) {
+        store.delete_version(t, *version, now, true);
+      }
+    }
+    for (const auto id : update.remove_ids) {
+      const auto version = store.get_version(id);
+      if (version.has_value()) {
+        store.remove_version(t, *version);
+      }
+    }
+    for (const auto& object : update.new_objects) {
+      store.put_object(t, object, store.get_object(object.uuid));
+    }
+    for (const auto& version : update.new_versions) {
+      store.insert_version(t, version);
+    }
+    store.submit(t);
+    return true;
+  }
+
+  DBExpiredVersionItems expire_current_versions_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const DBObjectTagSet& tags
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto candidates = select_lc_candidates(
+        bucket_id, prefix, after, max,
+        [&](const DBVersionedObject& version, const auto& versions) {
+          return is_current_expired(version, versions, cutoff) &&
+                 has_tags(version, tags);
+        }
+    );
+    return soft_delete(candidates);
+  }
+
+  DBExpiredVersionItems add_delete_markers_to_expired_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const std::function<std::string()>& new_version_id,
+      const DBObjectTagSet& tags
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto candidates = select_lc_candidates(
+        bucket_id, prefix, after, max,
+        [&](const DBVersionedObject& version, const auto& versions) {
+          return is_current_expired(version, versions, cutoff) &&
+                 has_tags(version, tags);
+        }
+    );
+    DBExpiredVersionItems items;
+    if (candidates.empty()) {
+      return items;
+    }
+    auto t = store.transaction();
+    const auto now = ceph::real_clock::now();
+    for (const auto& version : candidates) {
+      store.insert_version(
+          t, make_delete_marker(version, new_version_id(), now)
+      );
+      items.emplace_back(version.id, version.object_id);
+    }
+    store.submit(t);
+    return items;
+  }
+
+  DBExpiredVersionItems expire_noncurrent_versions_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const DBObjectTagSet& tags
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto candidates = select_lc_candidates(
+        bucket_id, prefix, after, max,
+        [&](const DBVersionedObject& version, const auto& versions) {
+          // the next committed version, by (commit_time, id)
+          const DBVersionedObject* successor = nullptr;
+          for (const auto& other : versions) {
+            if (is_committed(other) && older(version, other) &&
+                (successor == nullptr || older(other, *successor))) {
+              successor = &other;
+            }
+          }
+          return successor != nullptr && successor->mtime <= cutoff &&
+                 has_tags(version, tags);
+        }
+    );
+    return soft_delete(candidates);
+  }
+
+  DBExpiredVersionItems expire_lone_delete_markers_transact(
+      const std::string& bucket_id, const std::string& prefix, uint after,
+      uint max
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto candidates = select_lc_candidates(
+        bucket_id, prefix, after, max,
+        [&](const DBVersionedObject& version, const auto& versions) {
+          return version.version_type == VersionType::DELETE_MARKER &&
+                 std::ranges::none_of(versions, [&](const auto& other) {
+                   return other.id != version.id && is_not_deleted(other);
+                 });
+        }
+    );
+    return soft_delete(candidates);
+  }
+
+ private:
+  /// Store object if its stored version is in allowed_states, along with
+  /// a non-empty parts manifest. Needs write_lock.
+  bool put_if_state(
+      Store::Transaction t, const DBVersionedObject& object,
+      const std::vector<ObjectState>& allowed_states,
+      const std::vector<DBVersionedObjectPart>& parts
+  ) const {
+    const auto old = store.get_version(object.id);
+    if (!old.has_value() || !in_states(old->object_state, allowed_states)) {
+      return false;
+    }
+    store.put_version(t, object, old);
+    if (!parts.empty()) {
+      store.put_parts_manifest(t, object.id, parts);
+    }
+    return true;
+  }
+
+  static DBVersionedObject make_delete_marker(
+      const DBVersionedObject& version, const std::string& version_id,
+      const ceph::real_time& now
+  ) {
+    auto delete_marker = version;
+    delete_marker.version_type = VersionType::DELETE_MARKER;
+    delete_marker.object_state = ObjectState::COMMITTED;
+    delete_marker.commit_time = now;
+    delete_marker.delete_time = now;
+    delete_marker.mtime = now;
+    delete_marker.version_id = version_id;
+    return delete_marker;
+  }
+
+  /// Remove deleted versions and the objects they leave empty. Needs
+  /// write_lock.
+  DBDeletedObjectItems remove_deleted(
+      const std::vector<DBVersionedObject>& versions
+  ) const {
+    DBDeletedObjectItems removed;
+    if (versions.empty()) {
+      return removed;
+    }
+    auto t = store.transaction();
+    for (const auto& version : versions) {
+      // versions of objects that are gone already are left alone
+      const auto object = store.get_object(version.object_id);
+      if (!object.has_value()) {
+        continue;
+      }
+      store.remove_version(t, version);
+      removed.emplace_back(version.object_id, version.id, object->bucket_id);
+    }
+    store.remove_emptied_objects(t, removed);
+    store.submit(t);
+    return removed;
+  }
+
+  static bool is_current_expired(
+      const DBVersionedObject& version,
+      const std::vector<DBVersionedObject>& versions,
+      const ceph::real_time& cutoff
+  ) {
+    return version.version_type == VersionType::REGULAR &&
+           version.mtime <= cutoff &&
+           latest_version(versions, is_committed) == &version;
+  }
+
+  /// Up to max committed versions with an id greater than after, of
+  /// the objects of bucket_id whose name starts with prefix, for which
+  /// pred(version, all versions of its object) holds. Ordered by id.
+  template <typename Pred>
+  std::vector<DBVersionedObject> select_lc_candidates(
+      const std::string& bucket_id, const std::string& prefix, uint after,
+      uint max, const Pred& pred
+  ) const {
+    std::vector<DBVersionedObject> candidates;
+    store.scan(
+        OBJECT_NAMES_PREFIX, "", join_key(bucket_id, prefix),
+        [&](const std::string&, auto& it) {
+          const auto versions =
+              store.object_versions(from_bufferlist<uuid_d>(it.value()));
+          for (const auto& version : versions) {
+            if (is_committed(version) && version.id > after &&
+                pred(version, versions)) {
+              candidates.push_back(version);
+            }
+          }
+          return true;
+        }
+    );
+    std::ranges::sort(candidates, [](const auto& lhs, const auto& rhs) {
+      return lhs.id < rhs.id;
+    });
+    if (candidates.size() > max) {
+      candidates.resize(max);
+    }
+    return candidates;
+  }
+
+  /// Soft delete candidates for the garbage collector. Needs write_lock.
+  DBExpiredVersionItems soft_delete(
+      const std::vector<DBVersionedObject>& candidates
+  ) const {
+    DBExpiredVersionItems items;
+    if (candidates.empty()) {
+      return items;
+    }
+    auto t = store.transaction();
+    const auto now = ceph::real_clock::now();
+    for (const auto& version : candidates) {
+      store.delete_version(t, version, now, true);
+      items.emplace_back(version.id, version.object_id);
+    }
+    store.submit(t);
+    return items;
+  }
+};
+
+/// Unlike sqlite::SQLiteList, which lists an object if none of its
+/// committed versions is a delete marker and sums their sizes, objects()
+/// lists an object if its latest committed version is a regular one,
+/// with the size of that version.
+class KVMetadata::List : public ListBackend {
+  const Store& store;
+
+ public:
+  explicit List(const Store& _store) : store(_store) {}
+
+  bool objects(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name, size_t max,
+      std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available
+  ) const override {
+    out.reserve(out.size() + max);
+    return objects(
+        bucket_id, prefix, start_after_object_name, max,
+        [&out](rgw_bucket_dir_entry&& e) { out.emplace_back(std::move(e)); },
+        out_more_available
+    );
+  }
+
+  bool objects(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name, size_t max,
+      const EntryVisitor& visit, bool* out_more_available
+  ) const override {
+    ceph_assert(!bucket_id.empty());
+    if (out_more_available) {
+      *out_more_available = false;
+    }
+    size_t count = 0;
+    scan_names(
+        bucket_id, prefix, start_after_object_name,
+        [&](const std::string& name, const uuid_d& uuid) {
+          const auto versions = store.object_versions(uuid);
+          const auto latest = latest_version(versions, is_committed);
+          if (latest == nullptr ||
+              latest->version_type != VersionType::REGULAR) {
+            return true;
+          }
+          if (count >= max) {
+            if (out_more_available) {
+              *out_more_available = true;
+            }
+            return false;
+          }
+          rgw_bucket_dir_entry e;
+          e.key.name = name;
+          e.meta.mtime = latest->mtime;
+          e.meta.etag = latest->etag;
+          e.meta.size = latest->size;
+          e.meta.accounted_size = e.meta.size;
+          visit(std::move(e));
+          count++;
+          return true;
+        }
+    );
+    return true;
+  }
+
+  bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name, size_t max,
+      std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available
+  ) const override {
+    return versions(
+        bucket_id, prefix, start_after_object_name, "", max, out,
+        out_more_available
+    );
+  }
+
+  bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name,
+      const std::string& start_after_version_id, size_t max,
+      std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available
+  ) const override {
+    out.reserve(out.size() + max);
+    return versions(
+        bucket_id, prefix, start_after_object_name, start_after_object_name,
+        start_after_version_id, max,
+        [&out](rgw_bucket_dir_entry&& e) { out.emplace_back(std::move(e)); },
+        out_more_available
+    );
+  }
+
+  bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name,
+      const std::string& key_marker,
+      const std::string& start_after_version_id, size_t max,
+      const EntryVisitor& visit, bool* out_more_available
+  ) const override {
+    ceph_assert(!bucket_id.empty());
+    if (out_more_available) {
+      *out_more_available = false;
+    }
+    size_t count = 0;
+    bool more = false;
+
+    // With a version id marker the listing resumes inside the marker
+    // object: first its versions older than the marker, then the
+    // following names.
+    if (!key_marker.empty() && !start_after_version_id.empty() &&
+        key_marker.starts_with(prefix)) {
+      // listings show versions without version id as "null"
+      const std::string marker_version_id =
+          start_after_version_id == "null" ? "" : start_after_version_id;
+      const auto object = store.get_object(bucket_id, key_marker);
+      if (object.has_value()) {
+        const auto committed = committed_newest_first(object->uuid);
+        const auto marker = std::ranges::find_if(
+            committed,
+            [&](const auto& version) {
+              return version.version_id == marker_version_id;
+            }
+        );
+        if (marker != committed.end()) {
+          for (auto version = std::next(marker); version != committed.end();
+               ++version) {
+            if (!visit_version(
+                    key_marker, *version, committed, max, count, visit
+                )) {
+              more = true;
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    if (!more) {
+      scan_names(
+          bucket_id, prefix, start_after_object_name,
+          [&](const std::string& name, const uuid_d& uuid) {
+            const auto committed = committed_newest_first(uuid);
+            for (const auto& version : committed) {
+              if (!visit_version(name, version, committed, max, count, visit)) {
+                more = true;
+                return false;
+              }
+            }
+            return true;
+          }
+      );
+    }
+    if (more && out_more_available) {
+      *out_more_available = true;
+    }
+    return true;
+  }
+
+ private:
+  /// Visit the objects of bucket_id whose name starts with prefix, after
+  /// start_after, in name order, until visit returns false
+  template <typename Visit>
+  void scan_names(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after, const Visit& visit
+  ) const {
+    const auto bucket_prefix = join_key(bucket_id, "");
+    store.scan(
+        OBJECT_NAMES_PREFIX, bucket_prefix + start_after,
+        bucket_prefix + prefix,
+        [&](const std::string& key, auto& it) {
+          const auto name = key.substr(bucket_prefix.size());
+          if (name == start_after) {
+            return true;
+          }
+          return visit(name, from_bufferlist<uuid_d>(it.value()));
+        }
+    );
+  }
+
+  std::vector<DBVersionedObject> committed_newest_first(const uuid_d& uuid
+  ) const {
+    auto versions = store.object_versions(uuid);
+    std::erase_if(versions, [](const auto& version) {
+      return !is_committed(version);
+    });
+    std::ranges::sort(versions, newer);
+    return versions;
+  }
+
+  /// Visit version of name unless max entries were visited already,
+  /// then return false
+  static bool visit_version(
+      const std::string& name, const DBVersionedObject& version,
+      const std::vector<DBVersionedObject>& committed, size_t max,
+      size_t& count, const EntryVisitor& visit
+  ) {
+    if (count >= max) {
+      return false;
+    }
+    rgw_bucket_dir_entry e;
+    e.key.name = name;
+    e.key.instance = version.version_id;
+    e.meta.mtime = version.mtime;
+    e.meta.etag = version.etag;
+    e.meta.size = version.size;
+    e.meta.accounted_size = e.meta.size;
+    // committed is newest first
+    e.flags = to_dentry_flag(
+        version.version_type, version.id == committed.front().id
+    );
+    visit(std::move(e));
+    count++;
+    return true;
+  }
+};
+
+class KVMetadata::Multipart : public MultipartBackend {
+  const Store& store;
+
+ public:
+  explicit Multipart(const Store& _store) : store(_store) {}
+
+  std::optional<std::vector<DBMultipart>> list_multiparts(
+      const std::string& bucket_name, const std::string& prefix,
+      const std::string& marker, const std::string& delim,
+      const int& max_uploads, bool* is_truncated
+  ) const override {
+    const auto bucket_id = find_bucket_id(bucket_name);
+    if (!bucket_id.has_value()) {
+      return std::nullopt;
+    }
+    return list_multiparts_by_bucket_id(
+        *bucket_id, prefix, marker, delim, max_uploads, is_truncated, false
+    );
+  }
+
+  std::vector<DBMultipart> list_multiparts_by_bucket_id(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& marker, const std::string& /*delim*/,
+      const int& max_uploads, bool* is_truncated, bool get_all
+  ) const override {
+    ceph_assert(max_uploads >= 0);
+    const auto max = static_cast<size_t>(max_uploads);
+    const auto start_state =
+        get_all ? MultipartState::NONE : MultipartState::INIT;
+    const auto end_state =
+        get_all ? MultipartState::LAST_VALUE : MultipartState::INPROGRESS;
+    std::vector<DBMultipart> uploads;
+    store.scan_bucket_multiparts(bucket_id, marker, [&](const DBMultipart& mp) {
+      if (mp.state < start_state || mp.state > end_state ||
+          !mp.object_name.starts_with(prefix)) {
+        return true;
+      }
+      if (uploads.size() == max) {
+        if (is_truncated) {
+          *is_truncated = true;
+        }
+        return false;
+      }
+      uploads.push_back(mp);
+      return true;
+    });
+    return uploads;
+  }
+
+  int abort_multiparts(const std::string& bucket_name) const override {
+    const auto bucket_id = find_bucket_id(bucket_name);
+    if (!bucket_id.has_value()) {
+      return -ERR_NO_SUCH_BUCKET;
+    }
+    return abort_multiparts_by_bucket_id(*bucket_id);
+  }
+
+  int abort_multiparts_by_bucket_id(const std::string& bucket_id
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    int aborted = 0;
+    store.scan_bucket_multiparts(bucket_id, "", [&](const DBMultipart& mp) {
+      if (abortable(mp.state)) {
+        store.change_state(t, mp, MultipartState::ABORTED);
+        aborted++;
+      }
+      return true;
+    });
+    store.submit(t);
+    return aborted;
+  }
+
+  std::vector<std::string> abort_multiparts_initiated_before_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint max
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    std::vector<DBMultipart> uploads;
+    store.scan_bucket_multiparts(bucket_id, "", [&](const DBMultipart& mp) {
+      if (abortable(mp.state) && mp.mtime <= cutoff &&
+          mp.object_name.starts_with(prefix)) {
+        uploads.push_back(mp);
+      }
+      return true;
+    });
+    std::ranges::sort(uploads, [](const auto& lhs, const auto& rhs) {
+      return lhs.id < rhs.id;
+    });
+    if (uploads.size() > max) {
+      uploads.resize(max);
+    }
+    std::vector<std::string> upload_ids;
+    if (uploads.empty()) {
+      return upload_ids;
+    }
+    auto t = store.transaction();
+    for (const auto& mp : uploads) {
+      store.change_state(t, mp, MultipartState::ABORTED);
+      upload_ids.push_back(mp.upload_id);
+    }
+    store.submit(t);
+    return upload_ids;
+  }
+
+  std::optional<DBMultipart> get_multipart(const std::string& upload_id
+  ) const override {
+    return store.get_multipart(upload_id);
+  }
+
+  std::optional<DBMultipart> get_multipart(int id) const override {
+    ceph_assert(id >= 0);
+    const auto upload_id = store.get<std::string>(
+        MULTIPART_IDS_PREFIX, number_key(static_cast<uint64_t>(id))
+    );
+    if (!upload_id.has_value()) {
+      return std::nullopt;
+    }
+    return store.get_multipart(*upload_id);
+  }
+
+  uint insert(const DBMultipart& mp) const override {
+    std::lock_guard lock(store.write_lock);
+    if (store.exists(MULTIPARTS_PREFIX, mp.upload_id)) {
+      throw std::system_error(
+          EEXIST, std::generic_category(),
+          fmt::format("multipart upload {} exists", mp.upload_id)
+      );
+    }
+    auto t = store.transaction();
+    auto stored = mp;
+    stored.id = static_cast<int>(store.next_id(t, MULTIPARTS_COUNTER));
+    store.put_multipart(t, stored);
+    store.submit(t);
+    return static_cast<uint>(stored.id);
+  }
+
+  std::vector<DBMultipartPart> list_parts(
+      const std::string& upload_id, int num_parts, int marker,
+      int* next_marker, bool* truncated
+  ) const override {
+    ceph_assert(num_parts >= 0);
+    const auto max = static_cast<size_t>(num_parts);
+    std::vector<DBMultipartPart> parts;
+    const auto key_prefix = join_key(upload_id, "");
+    store.scan(
+        MULTIPART_PARTS_PREFIX,
+        key_prefix + number_key(static_cast<uint64_t>(std::max(marker, 0))),
+        key_prefix,
+        [&](const std::string&, auto& it) {
+          auto part = from_bufferlist<DBMultipartPart>(it.value());
+          if (!part.etag.has_value()) {
+            return true;
+          }
+          if (parts.size() == max) {
+            // we got a next marker on the extra part
+            if (truncated) {
+              *truncated = true;
+            }
+            if (next_marker) {
+              *next_marker = part.id;
+            }
+            return false;
+          }
+          parts.push_back(std::move(part));
+          return true;
+        }
+    );
+    return parts;
+  }
+
+  std::vector<DBMultipartPart> get_parts(const std::string& upload_id
+  ) const override {
+    std::vector<DBMultipartPart> parts;
+    store.scan(
+        MULTIPART_PART_NUMS_PREFIX, "", join_key(upload_id, ""),
+        [&](const std::string&, auto& it) {
+          const auto id = from_bufferlist<uint64_t>(it.value());
+          const auto part = store.get<DBMultipartPart>(
+              MULTIPART_PARTS_PREFIX, join_key(upload_id, number_key(id))
+          );
+          if (part.has_value()) {
+            parts.push_back(*part);
+          }
+          return true;
+        }
+    );
+    return parts;
+  }
+
+  std::optional<DBMultipartPart> get_part(
+      const std::string& upload_id, uint32_t part_num
+  ) const override {
+    return store.get_part(upload_id, part_num);
+  }
+
+  std::optional<DBMultipartPart> create_or_reset_part(
+      const std::string& upload_id, uint32_t part_num, std::string* error_str
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto mp = store.get_multipart(upload_id);
+    if (!mp.has_value() || (mp->state != MultipartState::INIT &&
+                            mp->state != MultipartState::INPROGRESS)) {
+      if (error_str) {
+        *error_str = "could not find upload";
+      }
+      return std::nullopt;
+    }
+    auto t = store.transaction();
+    // set multipart upload as being in progress
+    if (mp->state == MultipartState::INIT) {
+      store.change_state(t, *mp, MultipartState::INPROGRESS);
+    }
+    auto part = store.get_part(upload_id, part_num);
+    if (part.has_value()) {
+      // reset part entry
+      part->size = 0;
+      part->etag = std::nullopt;
+      part->mtime = std::nullopt;
+      part->compression = std::nullopt;
+      part->crc32c = std::nullopt;
+    } else {
+      part = DBMultipartPart{
+          .id = static_cast<int>(store.next_id(t, MULTIPART_PARTS_COUNTER)),
+          .upload_id = upload_id,
+          .part_num = part_num,
+          .size = 0,
+          .etag = std::nullopt,
+          .mtime = std::nullopt,
+          .compression = std::nullopt,
+          .crc32c = std::nullopt,
+      };
+    }
+    store.put_part(t, *part);
+    store.submit(t);
+    return part;
+  }
+
+  bool finish_part(
+      const std::string& upload_id, uint32_t part_num, const std::string& etag,
+      uint64_t bytes_written,
+      const std::optional<RGWCompressionInfo>& compression,
+      std::optional<uint32_t> crc32c
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto part = store.get_part(upload_id, part_num);
+    if (!part.has_value() || part->etag.has_value()) {
+      return false;
+    }
+    part->etag = etag;
+    part->mtime = ceph::real_clock::now();
+    part->size = bytes_written;
+    part->compression = compression;
+    part->crc32c = crc32c;
+    auto t = store.transaction();
+    store.put_part(t, *part);
+    store.submit(t);
+    return true;
+  }
+
+  bool abort(const std::string& upload_id) const override {
+    return change_state_if(
+        upload_id, abortable, MultipartState::ABORTED
+    );
+  }
+
+  bool mark_complete(const std::string& upload_id, bool* duplicate)
+      const override {
+    ceph_assert(duplicate != nullptr);
+    std::lock_guard lock(store.write_lock);
+    const auto mp = store.get_multipart(upload_id);
+    if (!mp.has_value()) {
+      return false;
+    }
+    if (mp->state >= MultipartState::INIT &&
+        mp->state <= MultipartState::INPROGRESS) {
+      auto t = store.transaction();
+      store.change_state(t, *mp, MultipartState::COMPLETE);
+      store.submit(t);
+      *duplicate = false;
+    } else {
+      *duplicate = mp->state >= MultipartState::COMPLETE;
+    }
+    return true;
+  }
+
+  bool mark_aggregating(const std::string& upload_id) const override {
+    return change_state_if(
+        upload_id,
+        [](MultipartState state) { return state == MultipartState::COMPLETE; },
+        MultipartState::AGGREGATING
+    );
+  }
+
+  bool mark_done(const std::string& upload_id) const override {
+    return change_state_if(
+        upload_id,
+        [](MultipartState state) {
+          return state == MultipartState::AGGREGATING;
+        },
+        MultipartState::DONE
+    );
+  }
+
+  void remove_parts(const std::string& upload_id) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    for (const auto& part : store.parts(upload_id)) {
+      store.remove_part(t, part);
+    }
+    store.submit(t);
+  }
+
+  // The parts go too, SQLite would refuse to remove uploads that have
+  // some.
+  void remove_multiparts_by_bucket_id(const std::string& bucket_id
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    auto t = store.transaction();
+    store.scan_bucket_multiparts(bucket_id, "", [&](const DBMultipart& mp) {
+      for (const auto& part : store.parts(mp.upload_id)) {
+        store.remove_part(t, part);
+      }
+      store.remove_multipart(t, mp);
+      return true;
+    });
+    store.submit(t);
+  }
+
+  std::optional<DBDeletedMultipartItems>
+  remove_multiparts_by_bucket_id_transact(
+      const std::string& bucket_id, uint max_items
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    std::vector<DBMultipart> uploads;
+    store.scan_bucket_multiparts(bucket_id, "", [&](const DBMultipart& mp) {
+      uploads.push_back(mp);
+      return true;
+    });
+    auto t = store.transaction();
+    auto removed = store.remove_parts_of(t, uploads, max_items);
+    store.submit(t);
+    return removed;
+  }
+
+  std::optional<DBDeletedMultipartItems>
+  remove_done_or_aborted_multiparts_transact(uint max_items) const override {
+    std::lock_guard lock(store.write_lock);
+    std::vector<DBMultipart> uploads;
+    store.scan(MULTIPARTS_PREFIX, "", "", [&](const std::string&, auto& it) {
+      auto mp = from_bufferlist<DBMultipart>(it.value());
+      if (done_or_aborted(mp.state)) {
+        uploads.push_back(std::move(mp));
+      }
+      return true;
+    });
+    auto t = store.transaction();
+    auto removed = store.remove_parts_of(t, uploads, max_items);
+    store.submit(t);
+    return removed;
+  }
+
+  std::optional<DBDeletedMultipartItems>
+  remove_done_or_aborted_multipart_transact(
+      const std::string& upload_id, uint max_items
+  ) const override {
+    std::lock_guard lock(store.write_lock);
+    const auto mp = store.get_multipart(upload_id);
+    if (!mp.has_value() || !done_or_aborted(mp->state)) {
+      return DBDeletedMultipartItems{};
+    }
+    auto t = store.transaction();
+    auto removed = store.remove_parts_of(t, {*mp}, max_items);
+    store.submit(t);
+    return removed;
+  }
+
+ private:
+  std::optional<std::string> find_bucket_id(const std::string& bucket_name
+  ) const {
+    std::optional<std::string> bucket_id;
+    store.scan(BUCKETS_PREFIX, "", "", [&](const std::string& key, auto& it) {
+      const auto bucket = from_bufferlist<DBOPBucketInfo>(it.value());
+      if (!bucket.deleted && bucket.binfo.bucket.name == bucket_name) {
+        bucket_id = key;
+        return false;
+      }
+      return true;
+    });
+    return bucket_id;
+  }
+
+  template <typename Pred>
+  bool change_state_if(
+      const std::string& upload_id, const Pred& pred, MultipartState state
+  ) const {
+    std::lock_guard lock(store.write_lock);
+    const auto mp = store.get_multipart(upload_id);
+    if (!mp.has_value() || !pred(mp->state)) {
+      return false;
+    }
+    auto t = store.transaction();
+    store.change_state(t, *mp, state);
+    store.submit(t);
+    return true;
+  }
+};
+
+KVMetadata::KVMetadata(std::unique_ptr<KeyValueDB> _db)
+    : store(std::make_unique<Store>(std::move(_db))),
+      users_impl(std::make_unique<Users>(*store)),
+      buckets_impl(std::make_unique<Buckets>(*store)),
+      objects_impl(std::make_unique<Objects>(*store)),
+      versioned_objects_impl(std::make_unique<VersionedObjects>(*store)),
+      list_impl(std::make_unique<List>(*store)),
+      multipart_impl(std::make_unique<Multipart>(*store)) {}
+
+KVMetadata::~KVMetadata() = default;
+
+std::unique_ptr<KVMetadata> KVMetadata::open(
+    CephContext* cct, const std::filesystem::path& path
+) {
+  std::filesystem::create_directories(path);
+  std::unique_ptr<KeyValueDB> db(
+      KeyValueDB::create(cct, "rocksdb", path.string())
+  );
+  if (!db) {
+    throw std::system_error(
+        ENOTSUP, std::generic_category(), "rocksdb is not available"
+    );
+  }
+  check(db->init(), "init");
+  std::ostringstream err;
+  const int ret = db->create_and_open(err);
+  if (ret < 0) {
+    throw std::system_error(
+        -ret, std::generic_category(),
+        fmt::format(
+            "failed to open metadata db {}: {}", path.string(), err.str()
+        )
+    );
+  }
+  return std::make_unique<KVMetadata>(std::move(db));
+}
+
+const UsersBackend& KVMetadata::users() const {
+  return *users_impl;
+}
+
+const BucketsBackend& KVMetadata::buckets() const {
+  return *buckets_impl;
+}
+
+const ObjectsBackend& KVMetadata::objects() const {
+  return *objects_impl;
+}
+
+const VersionedObjectsBackend& KVMetadata::versioned_objects() const {
+  return *versioned_objects_impl;
+}
+
+const ListBackend& KVMetadata::list() const {
+  return *list_impl;
+}
+
+const MultipartBackend& KVMetadata::multipart() const {
+  return *multipart_impl;
+}
+
+}  // namespace rgw::sal::sfs
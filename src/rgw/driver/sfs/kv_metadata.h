@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include "common/ceph_context.h"
+#include "kv/KeyValueDB.h"
+#include "rgw/driver/sfs/metadata_backend.h"
+
+namespace rgw::sal::sfs {
+
+/// Users, buckets, objects, versions and multipart uploads in a RocksDB
+/// KeyValueDB of their own instead of the SQLite metadata database.
+///
+/// Records are keyed so that what SQLite answers with an index range
+/// scan is a prefix iteration here: object names by bucket, versions by
+/// object and id, multipart uploads by bucket and meta_str, parts by
+/// upload. Secondary indexes (access keys, version ids, deleted
+/// versions by size, ...) are kept in the same WriteBatch as the record
+/// they point to, so each call changes the database atomically. Calls
+/// that read before they write hold a writer lock, readers don't lock.
+///
+/// Features built on SQL over these records are not available with this
+/// backend: object tag indexes, prefix stats and deduplicated content.
+/// Lifecycle state, the GC journal, notifications and usage stay in
+/// SQLite.
+class KVMetadata : public MetadataBackend {
+  // the database, its writer lock and id counters, shared by the rest
+  class Store;
+  class Users;
+  class Buckets;
+  class Objects;
+  class VersionedObjects;
+  class List;
+  class Multipart;
+
+  std::unique_ptr<Store> store;
+  std::unique_ptr<Users> users_impl;
+  std::unique_ptr<Buckets> buckets_impl;
+  std::unique_ptr<Objects> objects_impl;
+  std::unique_ptr<VersionedObjects> versioned_objects_impl;
+  std::unique_ptr<List> list_impl;
+  std::unique_ptr<Multipart> multipart_impl;
+
+ public:
+  explicit KVMetadata(std::unique_ptr<KeyValueDB> _db);
+  ~KVMetadata() override;
+
+  KVMetadata(const KVMetadata&) = delete;
+  KVMetadata& operator=(const KVMetadata&) = delete;
+
+  /// Open the database in directory path, creating it if needed
+  static std::unique_ptr<KVMetadata> open(
+      CephContext* cct, const std::filesystem::path& path
+  );
+
+  const UsersBackend& users() const override;
+  const BucketsBackend& buckets() const override;
+  const ObjectsBackend& objects() const override;
+  const VersionedObjectsBackend& versioned_objects() const override;
+  const ListBackend& list() const override;
+  const MultipartBackend& multipart() const override;
+
+  bool in_sqlite() const override { return false; }
+};
+
+}  // namespace rgw::sal::sfs
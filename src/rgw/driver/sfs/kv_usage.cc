@@ -0,0 +1,338 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/kv_usage.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "include/encoding.h"
+
+namespace rgw::sal::sfs {
+
+// the only prefix of the database, it has the merge operator
+static const std::string USAGE_PREFIX = "U";
+// separates the parts of a key. owners, buckets and categories never
+// contain it
+static constexpr char KEY_SEPARATOR = '\0';
+
+namespace {
+
+struct UsageKey {
+  std::string owner;
+  std::string bucket;
+  int64_t epoch;
+  std::string payer;
+  std::string category;
+};
+
+// epochs are zero padded hex, so keys of a bucket sort by hour
+std::string encode_key(const sqlite::DBUsage& row) {
+  return fmt::format(
+      "{1}{0}{2}{0}{3:016x}{0}{4}{0}{5}", KEY_SEPARATOR, row.owner,
+      row.bucket, static_cast<uint64_t>(row.epoch), row.payer, row.category
+  );
+}
+
+std::optional<UsageKey> decode_key(const std::string& key) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  for (size_t pos = key.find(KEY_SEPARATOR); pos != std::string::npos;
+       pos = key.find(KEY_SEPARATOR, start)) {
+    parts.push_back(key.substr(start, pos - start));
+    start = pos + 1;
+  }
+  parts.push_back(key.substr(start));
+  if (parts.size() != 5) {
+    return std::nullopt;
+  }
+  UsageKey result;
+  result.owner = std::move(parts[0]);
+  result.bucket = std::move(parts[1]);
+  try {
+    result.epoch = static_cast<int64_t>(std::stoull(parts[2], nullptr, 16));
+  } catch (const std::logic_error&) {
+    return std::nullopt;
+  }
+  result.payer = std::move(parts[3]);
+  result.category = std::move(parts[4]);
+  return result;
+}
+
+/// Key prefix of the rows of an owner and optionally a bucket
+std::string key_prefix(
+    const std::string& owner, const std::optional<std::string>& bucket
+) {
+  std::string prefix = owner + KEY_SEPARATOR;
+  if (bucket.has_value()) {
+    prefix += *bucket + KEY_SEPARATOR;
+  }
+  return prefix;
+}
+
+struct UsageCounters {
+  uint64_t bytes_sent{0};
+  uint64_t bytes_received{0};
+  uint64_t ops{0};
+  uint64_t successful_ops{0};
+
+  void add(const UsageCounters& other) {
+    bytes_sent += other.bytes_sent;
+    bytes_received += other.bytes_received;
+    ops += other.ops;
+    successful_ops += other.successful_ops;
+  }
+
+  void encode(bufferlist& bl) const {
+    using ceph::encode;
+    encode(bytes_sent, bl);
+    encode(bytes_received, bl);
+    encode(ops, bl);
+    encode(successful_ops, bl);
+  }
+
+  void decode(bufferlist::const_iterator& it) {
+    using ceph::decode;
+    decode(bytes_sent, it);
+    decode(bytes_received, it);
+    decode(ops, it);
+    decode(successful_ops, it);
+  }
+
+  static UsageCounters from(const char* data, size_t len) {
+    bufferlist bl;
+    bl.append(data, len);
+    return from(bl);
+  }
+
+  static UsageCounters from(const bufferlist& bl) {
+    UsageCounters counters;
+    auto it = bl.cbegin();
+    counters.decode(it);
+    return counters;
+  }
+
+  std::string to_string() const {
+    bufferlist bl;
+    encode(bl);
+    return bl.to_str();
+  }
+};
+
+/// Adds the counters of a flush to the stored ones, inside RocksDB
+class UsageMergeOperator : public KeyValueDB::MergeOperator {
+ public:
+  void merge_nonexistent(
+      const char* rdata, size_t rlen, std::string* new_value
+  ) override {
+    *new_value = std::string(rdata, rlen);
+  }
+
+  void merge(
+      const char* ldata, size_t llen, const char* rdata, size_t rlen,
+      std::string* new_value
+  ) override {
+    auto counters = UsageCounters::from(ldata, llen);
+    counters.add(UsageCounters::from(rdata, rlen));
+    *new_value = counters.to_string();
+  }
+
+  const char* name() const override { return "sfs_usage_add"; }
+};
+
+// keys of range that match its owner and bucket, in order. stops when
+// visit returns false
+template <typename Visit>
+void for_each_key(
+    KeyValueDB& db, const UsageBackend::Range& range, const std::string& from,
+    const Visit& visit
+) {
+  auto it = db.get_iterator(USAGE_PREFIX);
+  std::string start = from;
+  if (range.owner.has_value()) {
+    start = std::max(start, key_prefix(*range.owner, range.bucket));
+  }
+  it->lower_bound(start);
+  for (; it->valid(); it->next()) {
+    const auto key = decode_key(it->key());
+    if (!key.has_value()) {
+      continue;
+    }
+    if (range.owner.has_value() && key->owner != *range.owner) {
+      break;
+    }
+    if (range.bucket.has_value() && key->bucket != *range.bucket) {
+      if (range.owner.has_value()) {
+        break;
+      }
+      continue;
+    }
+    const auto epoch = static_cast<uint64_t>(key->epoch);
+    if (epoch < range.start_epoch || epoch >= range.end_epoch) {
+      continue;
+    }
+    if (!visit(*key, *it)) {
+      break;
+    }
+  }
+}
+
+void check(int ret, std::string_view what) {
+  if (ret < 0) {
+    throw std::system_error(
+        -ret, std::generic_category(), fmt::format("usage db {}", what)
+    );
+  }
+}
+
+}  // namespace
+
+KVUsage::KVUsage(std::unique_ptr<KeyValueDB> _db) : db(std::move(_db)) {}
+
+KVUsage::~KVUsage() {
+  db->close();
+}
+
+std::unique_ptr<KVUsage> KVUsage::open(
+    CephContext* cct, const std::filesystem::path& path
+) {
+  std::filesystem::create_directories(path);
+  std::unique_ptr<KeyValueDB> db(
+      KeyValueDB::create(cct, "rocksdb", path.string())
+  );
+  if (!db) {
+    throw std::system_error(
+        ENOTSUP, std::generic_category(), "rocksdb is not available"
+    );
+  }
+  check(
+      db->set_merge_operator(
+          USAGE_PREFIX, std::make_shared<UsageMergeOperator>()
+      ),
+      "merge operator"
+  );
+  check(db->init(), "init");
+  std::ostringstream err;
+  const int ret = db->create_and_open(err);
+  if (ret < 0) {
+    throw std::system_error(
+        -ret, std::generic_category(),
+        fmt::format("failed to open usage db {}: {}", path.string(), err.str())
+    );
+  }
+  return std::make_unique<KVUsage>(std::move(db));
+}
+
+void KVUsage::add_usage(const sqlite::DBUsageList& rows) const {
+  if (rows.empty()) {
+    return;
+  }
+  auto transaction = db->get_transaction();
+  for (const auto& row : rows) {
+    UsageCounters counters;
+    counters.bytes_sent = static_cast<uint64_t>(row.bytes_sent);
+    counters.bytes_received = static_cast<uint64_t>(row.bytes_received);
+    counters.ops = static_cast<uint64_t>(row.ops);
+    counters.successful_ops = static_cast<uint64_t>(row.successful_ops);
+    bufferlist bl;
+    counters.encode(bl);
+    transaction->merge(USAGE_PREFIX, encode_key(row), bl);
+  }
+  check(db->submit_transaction_sync(transaction), "write");
+}
+
+sqlite::DBUsageList KVUsage::read_usage(
+    const Range& range, const Marker& marker, uint32_t max, bool& truncated
+) const {
+  truncated = false;
+  sqlite::DBUsageList usage;
+  if (max == 0) {
+    return usage;
+  }
+  // rows of the current pair by payer and category
+  std::map<std::pair<std::string, std::string>, sqlite::DBUsage> current;
+  Marker current_pair;
+  uint32_t pairs = 0;
+  const auto flush = [&]() {
+    for (auto& [payer_category, row] : current) {
+      usage.push_back(std::move(row));
+    }
+    current.clear();
+  };
+  // sorts after all keys of the marker pair and before the next pair
+  const std::string from =
+      marker.first.empty() && marker.second.empty()
+          ? ""
+          : key_prefix(marker.first, std::nullopt) + marker.second + '\x01';
+  for_each_key(
+      *db, range, from,
+      [&](const UsageKey& key, KeyValueDB::IteratorImpl& it) {
+        if (pairs == 0 || current_pair.first != key.owner ||
+            current_pair.second != key.bucket) {
+          flush();
+          if (pairs == max) {
+            truncated = true;
+            return false;
+          }
+          pairs++;
+          current_pair = {key.owner, key.bucket};
+        }
+        const auto counters = UsageCounters::from(it.value());
+        // keys of a pair are ordered by hour, the first one is kept
+        const sqlite::DBUsage first{
+            key.owner, key.bucket, key.epoch, key.payer, key.category,
+            0,         0,          0,         0};
+        auto row =
+            current.try_emplace({key.payer, key.category}, first).first;
+        row->second.bytes_sent += static_cast<int64_t>(counters.bytes_sent);
+        row->second.bytes_received +=
+            static_cast<int64_t>(counters.bytes_received);
+        row->second.ops += static_cast<int64_t>(counters.ops);
+        row->second.successful_ops +=
+            static_cast<int64_t>(counters.successful_ops);
+        return true;
+      }
+  );
+  flush();
+  return usage;
+}
+
+uint64_t KVUsage::trim_usage(const Range& range) const {
+  auto transaction = db->get_transaction();
+  uint64_t removed = 0;
+  for_each_key(
+      *db, range, "",
+      [&](const UsageKey& key, KeyValueDB::IteratorImpl&) {
+        transaction->rmkey(
+            USAGE_PREFIX,
+            encode_key(sqlite::DBUsage{key.owner, key.bucket, key.epoch,
+                                       key.payer, key.category, 0, 0, 0, 0})
+        );
+        removed++;
+        return true;
+      }
+  );
+  check(db->submit_transaction_sync(transaction), "trim");
+  return removed;
+}
+
+}  // namespace rgw::sal::sfs
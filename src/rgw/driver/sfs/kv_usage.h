@@ -0,0 +1,54 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include "common/ceph_context.h"
+#include "kv/KeyValueDB.h"
+#include "rgw/driver/sfs/usage_backend.h"
+
+namespace rgw::sal::sfs {
+
+/// Usage in a RocksDB KeyValueDB of its own, so usage writes don't
+/// queue behind the single SQLite writer. Rows are keyed by owner,
+/// bucket, hour, payer and category, so reads for an owner or bucket
+/// are prefix iterations. Flushes are a single WriteBatch of merge
+/// operations that add to the stored counters, without reading them
+/// first. Whole-store reads and trims iterate all rows.
+class KVUsage : public UsageBackend {
+  std::unique_ptr<KeyValueDB> db;
+
+ public:
+  explicit KVUsage(std::unique_ptr<KeyValueDB> _db);
+  ~KVUsage();
+
+  KVUsage(const KVUsage&) = delete;
+  KVUsage& operator=(const KVUsage&) = delete;
+
+  /// Open the database in directory path, creating it if needed
+  static std::unique_ptr<KVUsage> open(
+      CephContext* cct, const std::filesystem::path& path
+  );
+
+  void add_usage(const sqlite::DBUsageList& rows) const override;
+  sqlite::DBUsageList read_usage(
+      const Range& range, const Marker& marker, uint32_t max,
+      bool& truncated
+  ) const override;
+  uint64_t trim_usage(const Range& range) const override;
+};
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,445 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rgw/driver/sfs/sqlite/buckets/bucket_definitions.h"
+#include "rgw/driver/sfs/sqlite/buckets/multipart_definitions.h"
+#include "rgw/driver/sfs/sqlite/object_tags/object_tags_definitions.h"
+#include "rgw/driver/sfs/sqlite/objects/object_definitions.h"
+#include "rgw/driver/sfs/sqlite/users/users_definitions.h"
+#include "rgw/driver/sfs/sqlite/versioned_object/versioned_object_definitions.h"
+#include "rgw_common.h"
+
+namespace rgw::sal::sfs {
+
+// Storage of users, buckets, objects, versions and multipart uploads.
+// The interfaces are those of the SQLite classes (sqlite::SQLiteUsers
+// and friends), which are one implementation. KVMetadata keeps the same
+// records in a RocksDB KeyValueDB. rgw_sfs_metadata_backend picks one,
+// see make_metadata_backend(). Implementations throw std::system_error
+// on failure.
+
+class UsersBackend {
+ public:
+  virtual ~UsersBackend() = default;
+
+  virtual std::optional<sqlite::DBOPUserInfo> get_user_by_email(
+      const std::string& email
+  ) const = 0;
+  virtual std::optional<sqlite::DBOPUserInfo> get_user_by_access_key(
+      const std::string& key
+  ) const = 0;
+  virtual std::optional<sqlite::DBOPUserInfo> get_user(
+      const std::string& userid
+  ) const = 0;
+  virtual std::vector<std::string> get_user_ids() const = 0;
+
+  /// Store user, replacing the stored one and its access keys
+  virtual void store_user(const sqlite::DBOPUserInfo& user) const = 0;
+  virtual void remove_user(const std::string& userid) const = 0;
+};
+
+class BucketsBackend {
+ public:
+  struct Stats {
+    size_t size;
+    // bytes stored on disk, after compression
+    size_t physical_size;
+    uint64_t obj_count;
+  };
+
+  virtual ~BucketsBackend() = default;
+
+  virtual std::optional<sqlite::DBOPBucketInfo> get_bucket(
+      const std::string& bucket_id
+  ) const = 0;
+  virtual std::vector<sqlite::DBOPBucketInfo> get_bucket_by_name(
+      const std::string& bucket_name
+  ) const = 0;
+  /// Bucket ownership as a pair of (user id, display name), nullopt if
+  /// the bucket or its owner don't exist
+  virtual std::optional<std::pair<std::string, std::string>> get_owner(
+      const std::string& bucket_id
+  ) const = 0;
+
+  virtual void store_bucket(const sqlite::DBOPBucketInfo& bucket) const = 0;
+  virtual void remove_bucket(const std::string& bucket_id) const = 0;
+
+  /// Names of all buckets, or of those of user_id. The metadata API
+  /// lists them as bucket keys.
+  virtual std::vector<std::string> get_bucket_ids() const = 0;
+  virtual std::vector<std::string> get_bucket_ids(const std::string& user_id
+  ) const = 0;
+
+  virtual std::vector<sqlite::DBOPBucketInfo> get_buckets() const = 0;
+  virtual std::vector<sqlite::DBOPBucketInfo> get_buckets(
+      const std::string& user_id
+  ) const = 0;
+
+  virtual std::vector<std::string> get_deleted_buckets_ids() const = 0;
+
+  /// True if no object of the bucket has a committed regular version
+  virtual bool bucket_empty(const std::string& bucket_id) const = 0;
+  /// Remove up to max_objects versions of the bucket, largest first,
+  /// and the objects left without versions. The bucket goes once it has
+  /// no objects and no multipart uploads left, then bucket_deleted is
+  /// set. Returns the versions removed, nullopt if the database stayed
+  /// busy.
+  virtual std::optional<sqlite::DBDeletedObjectItems> delete_bucket_transact(
+      const std::string& bucket_id, uint max_objects, bool& bucket_deleted
+  ) const = 0;
+  /// Drop up to max_objects objects of a bucket with all their versions,
+  /// for buckets whose data is not deleted object by object. The bucket
+  /// itself is removed once it has no objects left. Returns the number
+  /// of objects dropped.
+  virtual std::optional<size_t> drop_bucket_rows_transact(
+      const std::string& bucket_id, uint max_objects, bool& bucket_deleted
+  ) const = 0;
+
+  virtual void add_bucket_data_dir(const std::string& bucket_id) const = 0;
+  virtual std::vector<std::string> get_bucket_data_dirs() const = 0;
+  /// Count and sizes of the committed versions of the bucket
+  virtual const std::optional<Stats> get_stats(const std::string& bucket_id
+  ) const = 0;
+};
+
+class ObjectsBackend {
+ public:
+  virtual ~ObjectsBackend() = default;
+
+  virtual std::vector<sqlite::DBObject> get_objects(
+      const std::string& bucket_id
+  ) const = 0;
+  virtual std::optional<sqlite::DBObject> get_object(const uuid_d& uuid
+  ) const = 0;
+  virtual std::optional<sqlite::DBObject> get_object(
+      const std::string& bucket_id, const std::string& object_name
+  ) const = 0;
+
+  virtual void store_object(const sqlite::DBObject& object) const = 0;
+  virtual void remove_object(const uuid_d& uuid) const = 0;
+};
+
+/// Object versions. Unless said otherwise, the latest version of an
+/// object is the one with the greatest (commit_time, id).
+class VersionedObjectsBackend {
+ public:
+  virtual ~VersionedObjectsBackend() = default;
+
+  virtual std::optional<sqlite::DBVersionedObject> get_versioned_object(
+      uint id, bool filter_deleted = true
+  ) const = 0;
+  virtual std::optional<sqlite::DBVersionedObject> get_versioned_object(
+      const std::string& version_id, bool filter_deleted = true
+  ) const = 0;
+  /// The committed version version_id of an object, the latest committed
+  /// one if version_id is empty
+  virtual std::optional<sqlite::DBVersionedObject>
+  get_committed_versioned_object(
+      const std::string& bucket_id, const std::string& object_name,
+      const std::string& version_id
+  ) const = 0;
+  /// The latest version not deleted of each object of the bucket
+  virtual sqlite::DBObjectsListItems list_last_versioned_objects(
+      const std::string& bucket_id
+  ) const = 0;
+
+  virtual uint insert_versioned_object(const sqlite::DBVersionedObject& object
+  ) const = 0;
+  virtual void store_versioned_object(const sqlite::DBVersionedObject& object
+  ) const = 0;
+  /// Store `object` if it is in one of `allowed_states`. A non-empty
+  /// `parts` manifest is stored in the same transaction, and so is a
+  /// reference to `content_hash` if the data is deduplicated.
+  virtual bool store_versioned_object_if_state(
+      const sqlite::DBVersionedObject& object,
+      std::vector<ObjectState> allowed_states,
+      const std::vector<sqlite::DBVersionedObjectPart>& parts = {},
+      const std::string& content_hash = ""
+  ) const = 0;
+  virtual void remove_versioned_object(uint id) const = 0;
+  /// Like store_versioned_object_if_state(), soft deleting the other
+  /// committed versions too. `num_deleted` is set to their number.
+  virtual bool store_versioned_object_delete_committed_transact_if_state(
+      const sqlite::DBVersionedObject& object,
+      std::vector<ObjectState> allowed_states, uint* num_deleted = nullptr,
+      const std::vector<sqlite::DBVersionedObjectPart>& parts = {},
+      const std::string& content_hash = ""
+  ) const = 0;
+
+  virtual std::vector<uint> get_versioned_object_ids(
+      bool filter_deleted = true
+  ) const = 0;
+  virtual std::vector<uint> get_versioned_object_ids(
+      const uuid_d& object_id, bool filter_deleted = true
+  ) const = 0;
+  virtual std::vector<sqlite::DBVersionedObject> get_versioned_objects(
+      const uuid_d& object_id, bool filter_deleted = true
+  ) const = 0;
+
+  virtual std::optional<sqlite::DBVersionedObject> get_last_versioned_object(
+      const uuid_d& object_id, bool filter_deleted = true
+  ) const = 0;
+
+  /// Remove version id and return the latest version not deleted of the
+  /// object left
+  virtual std::optional<sqlite::DBVersionedObject>
+  delete_version_and_get_previous_transact(const uuid_d& object_id, uint id)
+      const = 0;
+
+  /// Add an open version to the object, creating the object if needed
+  virtual std::optional<sqlite::DBVersionedObject>
+  create_new_versioned_object_transact(
+      const std::string& bucket_id, const std::string& object_name,
+      const std::string& version_id
+  ) const = 0;
+
+  /// Put a delete marker on top of the object if its latest version not
+  /// deleted is an open or committed regular one
+  virtual bool add_delete_marker_transact(
+      const uuid_d& object_id, const std::string& delete_marker_id,
+      uint* out_id = nullptr
+  ) const = 0;
+
+  /// Remove up to max_objects deleted versions, largest first. Objects
+  /// left without regular versions go along with their delete markers.
+  virtual std::optional<sqlite::DBDeletedObjectItems>
+  remove_deleted_versions_transact(uint max_objects) const = 0;
+  /// Like remove_deleted_versions_transact(), for the versions of
+  /// object `object_id` only.
+  virtual std::optional<sqlite::DBDeletedObjectItems>
+  remove_deleted_object_versions_transact(
+      const uuid_d& object_id, uint max_objects
+  ) const = 0;
+  /// Number of versions waiting for the garbage collector.
+  virtual int count_deleted_versions() const = 0;
+
+  virtual int set_all_open_versions_to_deleted() const = 0;
+
+  /// Store the parts manifest of version `id`, replacing any previous one.
+  /// Returns false if the database stayed busy.
+  virtual bool store_parts_manifest(
+      uint id, const std::vector<sqlite::DBVersionedObjectPart>& parts
+  ) const = 0;
+  /// Return the parts manifest of version `id` ordered by part number.
+  /// Empty if the version data is a single file.
+  virtual std::vector<sqlite::DBVersionedObjectPart> get_parts_manifest(
+      uint id
+  ) const = 0;
+
+  /// Return up to `max` committed regular versions with an id greater
+  /// than `after`, ordered by id.
+  virtual std::vector<sqlite::DBVersionedObject> get_committed_versions_after(
+      uint after, uint max
+  ) const = 0;
+
+  /// Look up the committed versions of objects `names` of `bucket_id`,
+  /// let `plan` decide what to change and write that, all in one
+  /// transaction. `plan` runs again if the transaction is retried.
+  /// Returns false if the database stayed busy.
+  virtual bool update_objects_transact(
+      const std::string& bucket_id, const std::vector<std::string>& names,
+      const std::function<
+          sqlite::DBObjectsUpdate(const sqlite::DBObjectsCommittedVersions&)>&
+          plan
+  ) const = 0;
+
+  // Lifecycle expiration. Each call looks at the committed versions of
+  // objects in `bucket_id` whose name starts with `prefix`, changes up to
+  // `max` of those with an id greater than `after` in a single transaction
+  // and returns them ordered by id. Fewer than `max` means done. Where
+  // given, only versions carrying all of `tags` qualify.
+
+  /// Soft delete current regular versions last modified at or before
+  /// `cutoff`.
+  virtual sqlite::DBExpiredVersionItems expire_current_versions_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const sqlite::DBObjectTagSet& tags = {}
+  ) const = 0;
+  /// Put a delete marker on top of current regular versions last modified
+  /// at or before `cutoff`. `new_version_id` names the delete markers.
+  virtual sqlite::DBExpiredVersionItems add_delete_markers_to_expired_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const std::function<std::string()>& new_version_id,
+      const sqlite::DBObjectTagSet& tags = {}
+  ) const = 0;
+  /// Soft delete noncurrent versions whose successor was created at or
+  /// before `cutoff`.
+  virtual sqlite::DBExpiredVersionItems expire_noncurrent_versions_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const sqlite::DBObjectTagSet& tags = {}
+  ) const = 0;
+  /// Soft delete delete markers that are the only version of their object
+  /// left.
+  virtual sqlite::DBExpiredVersionItems expire_lone_delete_markers_transact(
+      const std::string& bucket_id, const std::string& prefix, uint after,
+      uint max
+  ) const = 0;
+};
+
+/// Bucket listings. Entries come ordered by name, versions of a name
+/// newest first.
+class ListBackend {
+ public:
+  /// Receives list entries while the listing is still going
+  using EntryVisitor = std::function<void(rgw_bucket_dir_entry&&)>;
+
+  virtual ~ListBackend() = default;
+
+  /// Committed objects of the bucket whose name starts with prefix, up
+  /// to max of them after start_after_object_name. Sets
+  /// out_more_available if there are more.
+  virtual bool objects(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name, size_t max,
+      std::vector<rgw_bucket_dir_entry>& out,
+      bool* out_more_available = nullptr
+  ) const = 0;
+  virtual bool objects(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name, size_t max,
+      const EntryVisitor& visit, bool* out_more_available = nullptr
+  ) const = 0;
+
+  /// Committed versions of the objects, as objects() does
+  virtual bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name, size_t max,
+      std::vector<rgw_bucket_dir_entry>& out,
+      bool* out_more_available = nullptr
+  ) const = 0;
+  /// versions() resuming after version start_after_version_id of object
+  /// start_after_object_name. "null" stands for the version without
+  /// version id.
+  virtual bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name,
+      const std::string& start_after_version_id, size_t max,
+      std::vector<rgw_bucket_dir_entry>& out,
+      bool* out_more_available = nullptr
+  ) const = 0;
+  /// versions(), handing each entry to visit. The older versions of
+  /// key_marker come first; the following names start after
+  /// start_after_object_name, which may be past key_marker to skip the
+  /// rest of a common prefix.
+  virtual bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name,
+      const std::string& key_marker,
+      const std::string& start_after_version_id, size_t max,
+      const EntryVisitor& visit, bool* out_more_available = nullptr
+  ) const = 0;
+};
+
+/// Multipart uploads and their parts. See sqlite::SQLiteMultipart for
+/// the parameters.
+class MultipartBackend {
+ public:
+  virtual ~MultipartBackend() = default;
+
+  virtual std::optional<std::vector<sqlite::DBMultipart>> list_multiparts(
+      const std::string& bucket_name, const std::string& prefix,
+      const std::string& marker, const std::string& delim,
+      const int& max_uploads, bool* is_truncated
+  ) const = 0;
+  virtual std::vector<sqlite::DBMultipart> list_multiparts_by_bucket_id(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& marker, const std::string& delim,
+      const int& max_uploads, bool* is_truncated, bool get_all
+  ) const = 0;
+
+  virtual int abort_multiparts(const std::string& bucket_name) const = 0;
+  virtual int abort_multiparts_by_bucket_id(const std::string& bucket_id
+  ) const = 0;
+  virtual std::vector<std::string> abort_multiparts_initiated_before_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint max
+  ) const = 0;
+
+  virtual std::optional<sqlite::DBMultipart> get_multipart(
+      const std::string& upload_id
+  ) const = 0;
+  virtual std::optional<sqlite::DBMultipart> get_multipart(int id) const = 0;
+  virtual uint insert(const sqlite::DBMultipart& mp) const = 0;
+
+  virtual std::vector<sqlite::DBMultipartPart> list_parts(
+      const std::string& upload_id, int num_parts, int marker,
+      int* next_marker, bool* truncated
+  ) const = 0;
+  virtual std::vector<sqlite::DBMultipartPart> get_parts(
+      const std::string& upload_id
+  ) const = 0;
+  virtual std::optional<sqlite::DBMultipartPart> get_part(
+      const std::string& upload_id, uint32_t part_num
+  ) const = 0;
+  virtual std::optional<sqlite::DBMultipartPart> create_or_reset_part(
+      const std::string& upload_id, uint32_t part_num, std::string* error_str
+  ) const = 0;
+  virtual bool finish_part(
+      const std::string& upload_id, uint32_t part_num, const std::string& etag,
+      uint64_t bytes_written,
+      const std::optional<RGWCompressionInfo>& compression = std::nullopt,
+      std::optional<uint32_t> crc32c = std::nullopt
+  ) const = 0;
+
+  virtual bool abort(const std::string& upload_id) const = 0;
+  virtual bool mark_complete(const std::string& upload_id, bool* duplicate)
+      const = 0;
+  virtual bool mark_aggregating(const std::string& upload_id) const = 0;
+  virtual bool mark_done(const std::string& upload_id) const = 0;
+
+  virtual void remove_parts(const std::string& upload_id) const = 0;
+  virtual void remove_multiparts_by_bucket_id(const std::string& bucket_id
+  ) const = 0;
+  virtual std::optional<sqlite::DBDeletedMultipartItems>
+  remove_multiparts_by_bucket_id_transact(
+      const std::string& bucket_id, uint max_items
+  ) const = 0;
+  virtual std::optional<sqlite::DBDeletedMultipartItems>
+  remove_done_or_aborted_multiparts_transact(uint max_items) const = 0;
+  virtual std::optional<sqlite::DBDeletedMultipartItems>
+  remove_done_or_aborted_multipart_transact(
+      const std::string& upload_id, uint max_items
+  ) const = 0;
+};
+
+/// All of the above, from one store
+class MetadataBackend {
+ public:
+  virtual ~MetadataBackend() = default;
+
+  virtual const UsersBackend& users() const = 0;
+  virtual const BucketsBackend& buckets() const = 0;
+  virtual const ObjectsBackend& objects() const = 0;
+  virtual const VersionedObjectsBackend& versioned_objects() const = 0;
+  virtual const ListBackend& list() const = 0;
+  virtual const MultipartBackend& multipart() const = 0;
+
+  /// True if the records live in the SQLite metadata database, so the
+  /// features built on SQL queries and triggers over them work:
+  /// object tag indexes, prefix stats and deduplicated content refs.
+  virtual bool in_sqlite() const = 0;
+};
+
+}  // namespace rgw::sal::sfs
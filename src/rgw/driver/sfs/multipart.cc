@@ -21,10 +21,13 @@
 #include <filesystem>
 #include <fstream>
 
+#include "rgw/driver/sfs/checksum.h"
 #include "rgw/driver/sfs/fmt.h"
 #include "rgw/driver/sfs/multipart_types.h"
+#include "rgw/driver/sfs/sfs_gc.h"
 #include "rgw/driver/sfs/sfs_log.h"
 #include "rgw/driver/sfs/sqlite/buckets/multipart_definitions.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
 #include "rgw_obj_manifest.h"
 #include "rgw_sal_sfs.h"
 #include "writer.h"
@@ -49,7 +52,7 @@ SFSMultipartUploadV2::SFSMultipartUploadV2(
       mtime(_mtime),
       meta_str("_meta" + _oid + "." + _upload_id) {
   // load required data from db, if available.
-  sfs::sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
   auto mp = mpdb.get_multipart(upload_id);
   if (mp.has_value()) {
     placement = mp->placement;
@@ -61,7 +64,7 @@ std::unique_ptr<rgw::sal::Object> SFSMultipartUploadV2::get_meta_obj() {
   auto mmo =
       std::make_unique<SFSMultipartMetaObject>(store, key, bucket, bucketref);
 
-  sfs::sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
   auto mp = mpdb.get_multipart(upload_id);
   ceph_assert(mp.has_value());
   mmo->set_attrs(mp->attrs);
@@ -81,7 +84,7 @@ int SFSMultipartUploadV2::init(
                   << ", owner: " << acl_owner.get_display_name()
                   << ", attrs: " << attrs << dendl;
 
-  sfs::sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
   auto mp = mpdb.get_multipart(upload_id);
   if (mp.has_value()) {
     lsfs_err(dpp) << fmt::format(
@@ -147,7 +150,7 @@ int SFSMultipartUploadV2::list_parts(
   ceph_assert(marker >= 0);
   ceph_assert(num_parts >= 0);
 
-  sfs::sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
 
   auto entries =
       mpdb.list_parts(upload_id, num_parts, marker, next_marker, truncated);
@@ -167,8 +170,12 @@ int SFSMultipartUploadV2::abort(
 ) {
   lsfs_debug(dpp) << "upload_id: " << upload_id << dendl;
 
-  sfs::sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
   auto res = mpdb.abort(upload_id);
+  if (res) {
+    store->multipart_states->set_state(upload_id, MultipartState::ABORTED);
+    store->gc->enqueue(sfs::sqlite::GCJournalKind::MULTIPART, upload_id);
+  }
 
   lsfs_debug(dpp) << "upload_id: " << upload_id << ", aborted: " << res
                   << dendl;
@@ -176,153 +183,18 @@ int SFSMultipartUploadV2::abort(
   return (res ? 0 : -ERR_NO_SUCH_UPLOAD);
 }
 
-int SFSMultipartUploadV2::complete(
-    const DoutPrefixProvider* dpp, optional_yield /*y*/, CephContext* cct,
-    std::map<int, std::string>& part_etags,
-    std::list<rgw_obj_index_key>& /*remove_objs*/, uint64_t& accounted_size,
-    bool& /*compressed*/, RGWCompressionInfo& /*cs_info*/, off_t& /*ofs*/,
-    std::string& tag, ACLOwner& acl_owner, uint64_t olh_epoch,
-    rgw::sal::Object* target_obj
+int SFSMultipartUploadV2::aggregate_parts(
+    const DoutPrefixProvider* dpp, CephContext* cct,
+    const sqlite::DBMultipart& mp,
+    const std::map<int, sqlite::DBMultipartPart>& to_complete,
+    rgw::sal::Object* target_obj, ObjectRef& objref, size_t& accounted_bytes
 ) {
-  lsfs_debug(dpp) << fmt::format(
-                         "upload_id: {}, accounted_size: {}, tag: {}, "
-                         "owner: {}, olh_epoch: {}"
-                         ", target_obj: {}",
-                         upload_id, accounted_size, tag,
-                         acl_owner.get_display_name(), olh_epoch,
-                         target_obj->get_key()
-                     )
-                  << dendl;
-  lsfs_debug(dpp) << "part_etags: " << part_etags << dendl;
-
-  sfs::sqlite::SQLiteMultipart mpdb(store->db_conn);
-  bool duplicate = false;
-  auto res = mpdb.mark_complete(upload_id, &duplicate);
-  if (!res) {
-    lsfs_verb(dpp) << fmt::format(
-                          "unable to find on-going multipart upload id {}",
-                          upload_id
-                      )
-                   << dendl;
-    return -ERR_NO_SUCH_UPLOAD;
-  } else if (duplicate) {
-    lsfs_debug(dpp)
-        << fmt::format(
-               "multipart id {} already completed, returning success!",
-               upload_id
-           )
-        << dendl;
-    return 0;
-  }
-
-  auto current_parts = mpdb.get_parts(upload_id);
-  if (current_parts.size() != part_etags.size()) {
-    return -ERR_INVALID_PART;
-  }
-
-  auto mp = mpdb.get_multipart(upload_id);
-  ceph_assert(mp.has_value());
-  ceph_assert(mp->upload_id == upload_id);
-  ceph_assert(mp->state == sfs::MultipartState::COMPLETE);
-
-  // validate parts & build final etag
-
-  // we can only have at most 10k parts
-  if (part_etags.size() > 10000) {
-    return -ERR_INVALID_PART;
-  }
-
-  std::map<int, sqlite::DBMultipartPart> to_complete;
-  std::map<int, sqlite::DBMultipartPart> parts_map;
-  for (const auto& p : current_parts) {
-    parts_map[p.part_num] = p;
-  }
-
-  ETagBuilder hash;
-  uint64_t expected_size = 0;
-  // by nature, the `part_etags` map is an ordered container; all parts are
-  // already provided sorted.
-  for (auto it = part_etags.cbegin(); it != part_etags.cend(); ++it) {
-    auto& k = it->first;
-    auto& v = it->second;
-
-    auto p = parts_map.find(k);
-    if (p == parts_map.end()) {
-      lsfs_verb(dpp
-      ) << fmt::format("client-specified part {} does not exist!", k)
-        << dendl;
-      return -ERR_INVALID_PART;
-    }
-    auto part = p->second;
-    if (!part.is_finished()) {
-      lsfs_verb(dpp
-      ) << fmt::format("client-specified part {} is not finished yet!", k)
-        << dendl;
-      return -ERR_INVALID_PART;
-
-    } else if (!part.etag.has_value()) {
-      lsfs_err(dpp
-      ) << fmt::format("BUG: Part {} is finished and should have an etag!", k)
-        << dendl;
-      return -ERR_INTERNAL_ERROR;
-    }
-
-    ceph_assert(part.etag.has_value());
-    auto part_etag = part.etag.value();
-    auto etag = rgw_string_unquote(v);
-    if (part_etag != etag) {
-      lsfs_info(dpp)
-          << fmt::format(
-                 "client-specified part {} etag mismatch; expected {}, got {}",
-                 k, part_etag, etag
-             )
-          << dendl;
-      return -ERR_INVALID_PART;
-    }
-    hash.update(etag);
-
-    if ((part.size < 5 * 1024 * 1024) &&
-        (std::distance(it, part_etags.cend()) > 1)) {
-      lsfs_debug(dpp
-      ) << fmt::format("part {} is too small and not the last part!", k)
-        << dendl;
-      return -ERR_TOO_SMALL;
-    }
-
-    to_complete[k] = p->second;
-  }
-
-  if (store->filesystem_stats_avail_bytes.load() < expected_size) {
-    lsfs_err(dpp) << fmt::format(
-                         "filesystem stat reservation check hit. "
-                         "avail_bytes: {}, avail_pct: "
-                         "{}, total_bytes: {}, expected size: {}",
-                         store->filesystem_stats_avail_bytes,
-                         store->filesystem_stats_avail_percent,
-                         store->filesystem_stats_total_bytes, expected_size
-                     )
-                  << dendl;
-    return -ERR_QUOTA_EXCEEDED;
-  }
-
-  // calculate final etag
-  std::string etag = fmt::format("{}-{}", hash.final(), part_etags.size());
-
-  lsfs_debug(dpp
-  ) << fmt::format("upload_id: {}, final etag: {}", upload_id, etag)
-    << dendl;
-
-  // start aggregating final object
-  res = mpdb.mark_aggregating(upload_id);
-  ceph_assert(res == true);
-
   std::string mp_combine_fn = gen_rand_alphanumeric_plain(cct, 16);
   mp_combine_fn.append(".m");
-  std::filesystem::path objpath = store->get_data_path() /
-                                  UUIDPath(mp->path_uuid).to_path() /
-                                  mp_combine_fn;
-  std::error_code ec;
-  std::filesystem::create_directories(objpath.parent_path(), ec);
+  const std::filesystem::path obj_relpath =
+      UUIDPath(mp.path_uuid).to_path() / mp_combine_fn;
+  std::filesystem::path objpath = store->get_data_path() / obj_relpath;
+  std::error_code ec = store->data_dirs->ensure_parent(obj_relpath);
   if (ec) {
     lsfs_err(dpp)
         << fmt::format(
@@ -332,7 +204,9 @@ int SFSMultipartUploadV2::complete(
         << dendl;
     return -ERR_INTERNAL_ERROR;
   }
-  int objfd = ::open(objpath.c_str(), O_WRONLY | O_BINARY | O_CREAT, 0600);
+  int objfd = store->data_dirs->open(
+      obj_relpath, O_WRONLY | O_BINARY | O_CREAT, 0600
+  );
   if (objfd < 0) {
     lsfs_err(dpp) << fmt::format(
                          "unable to open object file {} to write: {}", objpath,
@@ -342,10 +216,8 @@ int SFSMultipartUploadV2::complete(
     return -ERR_INTERNAL_ERROR;
   }
 
-  size_t accounted_bytes = 0;
-
   for (const auto& [part_num, part] : to_complete) {
-    MultipartPartPath partpath(mp->path_uuid, part.id);
+    MultipartPartPath partpath(mp.path_uuid, part.id);
     std::filesystem::path path = store->get_data_path() / partpath.to_path();
 
     ceph_assert(std::filesystem::exists(path));
@@ -421,25 +293,24 @@ int SFSMultipartUploadV2::complete(
 
   lsfs_debug(dpp)
       << fmt::format(
-             "finished building final object file at {}, size: {}, etag: {}",
-             objpath, final_obj_size, etag
+             "finished building final object file at {}, size: {}",
+             objpath, final_obj_size
          )
       << dendl;
 
   // NOTE(jecluis): this is the annoying bit: we have the final object having
-  // been built at the path described by `mp->obj_uuid`, but we need to have it
-  // as a new version of the object of `mp->obj_name`. We will need to create a
+  // been built at the path described by `mp.obj_uuid`, but we need to have it
+  // as a new version of the object of `mp.obj_name`. We will need to create a
   // new object, or a new version, and move the file to its location as if we
   // were writing directly to it.
 
-  ObjectRef objref;
   try {
     objref = bucketref->create_version(target_obj->get_key());
   } catch (const std::system_error& e) {
     lsfs_err(dpp)
         << fmt::format(
                "error while fetching obj ref from bucket: {}, oid: {}: {}",
-               bucketref->get_bucket_id(), mp->object_name, e.what()
+               bucketref->get_bucket_id(), mp.object_name, e.what()
            )
         << dendl;
     std::filesystem::remove(objpath, ec);
@@ -457,7 +328,7 @@ int SFSMultipartUploadV2::complete(
   ) << fmt::format("moving final object from {} to {}", objpath, destpath)
     << dendl;
 
-  std::filesystem::create_directories(destpath.parent_path(), ec);
+  ec = store->data_dirs->ensure_parent(objref->get_storage_path());
   if (ec) {
     lsfs_debug(dpp)
         << fmt::format(
@@ -481,6 +352,328 @@ int SFSMultipartUploadV2::complete(
     return -ERR_INTERNAL_ERROR;
   }
 
+  return 0;
+}
+
+int SFSMultipartUploadV2::link_parts(
+    const DoutPrefixProvider* dpp, const sqlite::DBMultipart& mp,
+    const std::map<int, sqlite::DBMultipartPart>& to_complete,
+    rgw::sal::Object* target_obj, ObjectRef& objref, size_t& accounted_bytes,
+    std::vector<sqlite::DBVersionedObjectPart>& manifest
+) {
+  manifest.clear();
+  manifest.reserve(to_complete.size());
+  for (const auto& [part_num, part] : to_complete) {
+    MultipartPartPath partpath(mp.path_uuid, part.id);
+    std::filesystem::path path = store->get_data_path() / partpath.to_path();
+
+    std::error_code ec;
+    auto partsize = std::filesystem::file_size(path, ec);
+    if (ec) {
+      lsfs_err(dpp) << fmt::format(
+                           "unable to stat part file {}: {}", path,
+                           ec.message()
+                       )
+                    << dendl;
+      return -ERR_INTERNAL_ERROR;
+    }
+    if (partsize != part.size) {
+      lsfs_info(dpp) << fmt::format(
+                            "part size mismatch, expected {}, found: {}",
+                            part.size, partsize
+                        )
+                     << dendl;
+      return -ERR_INVALID_PART;
+    }
+
+    sqlite::DBVersionedObjectPart entry;
+    entry.part_num = part_num;
+    entry.part_id = part.id;
+    entry.offset = accounted_bytes;
+    entry.size = partsize;
+    manifest.push_back(entry);
+    accounted_bytes += partsize;
+  }
+
+  try {
+    objref = bucketref->create_version(target_obj->get_key());
+  } catch (const std::system_error& e) {
+    lsfs_err(dpp)
+        << fmt::format(
+               "error while fetching obj ref from bucket: {}, oid: {}: {}",
+               bucketref->get_bucket_id(), mp.object_name, e.what()
+           )
+        << dendl;
+    return -ERR_INTERNAL_ERROR;
+  }
+  if (!objref) {
+    // See aggregate_parts(): possibly a conflicting in-flight transaction,
+    // the client may retry.
+    return -ERR_INTERNAL_ERROR;
+  }
+
+  const std::filesystem::path srcpath =
+      store->get_data_path() / UUIDPath(mp.path_uuid).to_path();
+  const std::filesystem::path destpath =
+      store->get_data_path() / objref->get_parts_path();
+  lsfs_debug(dpp) << fmt::format(
+                         "linking {} parts from {} to {}", manifest.size(),
+                         srcpath, destpath
+                     )
+                  << dendl;
+
+  std::error_code ec =
+      store->data_dirs->ensure_parent(objref->get_parts_path());
+  if (ec) {
+    lsfs_err(dpp)
+        << fmt::format(
+               "failed to create directories for destination parts {}: {}",
+               destpath, ec.message()
+           )
+        << dendl;
+    return -ERR_INTERNAL_ERROR;
+  }
+
+  // All parts of the upload are part of the final object (see the part count
+  // check in complete()), so the whole upload directory moves in one go.
+  if (::rename(srcpath.c_str(), destpath.c_str()) < 0) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to rename parts directory from {} to {}: {}",
+                         srcpath, destpath, cpp_strerror(errno)
+                     )
+                  << dendl;
+    return -ERR_INTERNAL_ERROR;
+  }
+  const auto dir_fd = ::open(destpath.parent_path().c_str(), O_RDONLY);
+  if (dir_fd < 0 || ::fsync(dir_fd) < 0) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed fsyncing dir {}: {}. ignoring.",
+                         destpath.parent_path(), cpp_strerror(errno)
+                     )
+                  << dendl;
+  }
+  if (dir_fd >= 0) {
+    ::close(dir_fd);
+  }
+  return 0;
+}
+
+void SFSMultipartUploadV2::unlink_parts(
+    const DoutPrefixProvider* dpp, const sqlite::DBMultipart& mp,
+    const Object& objref
+) {
+  const std::filesystem::path srcpath =
+      store->get_data_path() / UUIDPath(mp.path_uuid).to_path();
+  const std::filesystem::path destpath =
+      store->get_data_path() / objref.get_parts_path();
+  // best effort, a failed complete leaves the upload in place
+  if (::rename(destpath.c_str(), srcpath.c_str()) < 0) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to move parts directory {} back to {}: {}",
+                         destpath, srcpath, cpp_strerror(errno)
+                     )
+                  << dendl;
+  }
+}
+
+int SFSMultipartUploadV2::complete(
+    const DoutPrefixProvider* dpp, optional_yield /*y*/, CephContext* cct,
+    std::map<int, std::string>& part_etags,
+    std::list<rgw_obj_index_key>& /*remove_objs*/, uint64_t& accounted_size,
+    bool& compressed, RGWCompressionInfo& cs_info, off_t& /*ofs*/,
+    std::string& tag, ACLOwner& acl_owner, uint64_t olh_epoch,
+    rgw::sal::Object* target_obj
+) {
+  lsfs_debug(dpp) << fmt::format(
+                         "upload_id: {}, accounted_size: {}, tag: {}, "
+                         "owner: {}, olh_epoch: {}"
+                         ", target_obj: {}",
+                         upload_id, accounted_size, tag,
+                         acl_owner.get_display_name(), olh_epoch,
+                         target_obj->get_key()
+                     )
+                  << dendl;
+  lsfs_debug(dpp) << "part_etags: " << part_etags << dendl;
+
+  const auto& mpdb = store->metadata->multipart();
+  bool duplicate = false;
+  auto res = mpdb.mark_complete(upload_id, &duplicate);
+  if (!res) {
+    lsfs_verb(dpp) << fmt::format(
+                          "unable to find on-going multipart upload id {}",
+                          upload_id
+                      )
+                   << dendl;
+    return -ERR_NO_SUCH_UPLOAD;
+  } else if (duplicate) {
+    lsfs_debug(dpp)
+        << fmt::format(
+               "multipart id {} already completed, returning success!",
+               upload_id
+           )
+        << dendl;
+    return 0;
+  }
+  store->multipart_states->set_state(upload_id, MultipartState::COMPLETE);
+
+  auto current_parts = mpdb.get_parts(upload_id);
+  if (current_parts.size() != part_etags.size()) {
+    return -ERR_INVALID_PART;
+  }
+
+  auto mp = mpdb.get_multipart(upload_id);
+  ceph_assert(mp.has_value());
+  ceph_assert(mp->upload_id == upload_id);
+  ceph_assert(mp->state == sfs::MultipartState::COMPLETE);
+
+  // validate parts & build final etag
+
+  // we can only have at most 10k parts
+  if (part_etags.size() > 10000) {
+    return -ERR_INVALID_PART;
+  }
+
+  std::map<int, sqlite::DBMultipartPart> to_complete;
+  std::map<int, sqlite::DBMultipartPart> parts_map;
+  for (const auto& p : current_parts) {
+    parts_map[p.part_num] = p;
+  }
+
+  ETagBuilder hash;
+  uint64_t expected_size = 0;
+  // by nature, the `part_etags` map is an ordered container; all parts are
+  // already provided sorted.
+  for (auto it = part_etags.cbegin(); it != part_etags.cend(); ++it) {
+    auto& k = it->first;
+    auto& v = it->second;
+
+    auto p = parts_map.find(k);
+    if (p == parts_map.end()) {
+      lsfs_verb(dpp
+      ) << fmt::format("client-specified part {} does not exist!", k)
+        << dendl;
+      return -ERR_INVALID_PART;
+    }
+    auto part = p->second;
+    if (!part.is_finished()) {
+      lsfs_verb(dpp
+      ) << fmt::format("client-specified part {} is not finished yet!", k)
+        << dendl;
+      return -ERR_INVALID_PART;
+
+    } else if (!part.etag.has_value()) {
+      lsfs_err(dpp
+      ) << fmt::format("BUG: Part {} is finished and should have an etag!", k)
+        << dendl;
+      return -ERR_INTERNAL_ERROR;
+    }
+
+    ceph_assert(part.etag.has_value());
+    auto part_etag = part.etag.value();
+    auto etag = rgw_string_unquote(v);
+    if (part_etag != etag) {
+      lsfs_info(dpp)
+          << fmt::format(
+                 "client-specified part {} etag mismatch; expected {}, got {}",
+                 k, part_etag, etag
+             )
+          << dendl;
+      return -ERR_INVALID_PART;
+    }
+    hash.update(etag);
+
+    const uint64_t part_size = part.compression.has_value()
+                                   ? part.compression->orig_size
+                                   : part.size;
+    if ((part_size < 5 * 1024 * 1024) &&
+        (std::distance(it, part_etags.cend()) > 1)) {
+      lsfs_debug(dpp
+      ) << fmt::format("part {} is too small and not the last part!", k)
+        << dendl;
+      return -ERR_TOO_SMALL;
+    }
+
+    // Chain the parts' compression blocks into the final object's, as
+    // the parts are laid out one after the other.
+    const bool part_compressed = part.compression.has_value();
+    if (!to_complete.empty() &&
+        (part_compressed != compressed ||
+         (part_compressed &&
+          part.compression->compression_type != cs_info.compression_type))) {
+      lsfs_info(dpp) << fmt::format(
+                            "compression of part {} differs from previous "
+                            "parts",
+                            k
+                        )
+                     << dendl;
+      return -ERR_INVALID_PART;
+    }
+    if (part_compressed) {
+      uint64_t new_ofs = ObjectData::physical_size(cs_info);
+      for (const auto& block : part.compression->blocks) {
+        compression_block cb;
+        cb.old_ofs = block.old_ofs + cs_info.orig_size;
+        cb.new_ofs = new_ofs;
+        cb.len = block.len;
+        cs_info.blocks.push_back(cb);
+        new_ofs = cb.new_ofs + cb.len;
+      }
+      cs_info.compression_type = part.compression->compression_type;
+      cs_info.orig_size += part.compression->orig_size;
+      compressed = true;
+    }
+
+    // copying writes the parts as they are on disk
+    expected_size += part.size;
+    to_complete[k] = p->second;
+  }
+
+  // linking parts into a manifest takes no extra data space, copying
+  // them does
+  const bool link_manifest =
+      cct->_conf.get_val<bool>("rgw_sfs_multipart_manifest");
+  SpaceReservation space_reservation(*store->space_ledger);
+  if (!space_reservation.reserve(link_manifest ? 0 : expected_size)) {
+    lsfs_err(dpp) << fmt::format(
+                         "filesystem space reservation check hit. "
+                         "reservable_bytes: {}, avail_bytes: {}, avail_pct: "
+                         "{}, total_bytes: {}, expected size: {}",
+                         store->space_ledger->get_available(),
+                         store->filesystem_stats_avail_bytes,
+                         store->filesystem_stats_avail_percent,
+                         store->filesystem_stats_total_bytes, expected_size
+                     )
+                  << dendl;
+    return -ERR_QUOTA_EXCEEDED;
+  }
+
+  // calculate final etag
+  std::string etag = fmt::format("{}-{}", hash.final(), part_etags.size());
+
+  lsfs_debug(dpp
+  ) << fmt::format("upload_id: {}, final etag: {}", upload_id, etag)
+    << dendl;
+
+  // start aggregating final object
+  res = mpdb.mark_aggregating(upload_id);
+  ceph_assert(res == true);
+
+  ObjectRef objref;
+  size_t accounted_bytes = 0;
+  std::vector<sqlite::DBVersionedObjectPart> manifest;
+  const int ret = link_manifest ? link_parts(
+                                       dpp, *mp, to_complete, target_obj,
+                                       objref, accounted_bytes, manifest
+                                   )
+                                 : aggregate_parts(
+                                       dpp, cct, *mp, to_complete, target_obj,
+                                       objref, accounted_bytes
+                                   );
+  if (ret < 0) {
+    return ret;
+  }
+  space_reservation.commit(link_manifest ? 0 : expected_size);
+
   // for object-locking enabled buckets, set the bucket's object-locking
   // profile when not defined on the MP part
   if (bucketref->get_info().obj_lock_enabled() &&
@@ -515,19 +708,38 @@ int SFSMultipartUploadV2::complete(
     encode(manifest, mp->attrs[RGW_ATTR_MANIFEST]);
   }
 
+  if (compressed) {
+    encode(cs_info, mp->attrs[RGW_ATTR_COMPRESSION]);
+  }
+  accounted_size = compressed ? cs_info.orig_size : accounted_bytes;
+
   objref->update_attrs(mp->attrs);
   bufferlist etag_bl;
   etag_bl.append(etag.c_str(), etag.size());
   objref->set_attr(RGW_ATTR_ETAG, etag_bl);
   objref->update_meta(
-      {.size = accounted_bytes,
+      {.size = accounted_size,
        .etag = etag,
        .mtime = ceph::real_time::clock::now(),
        .delete_at = ceph::real_time()}
   );
+  // composite checksum, if every part's crc32c is known
+  std::vector<uint32_t> part_crcs;
+  for (const auto& [part_num, part] : to_complete) {
+    if (!part.crc32c.has_value()) {
+      part_crcs.clear();
+      break;
+    }
+    part_crcs.push_back(*part.crc32c);
+  }
+  if (!part_crcs.empty()) {
+    objref->set_checksum(format_composite_crc32c(part_crcs));
+  }
   try {
+    // the parts manifest is committed with the version, so a version
+    // is never visible without its manifest
     res = objref->metadata_finish(
-        store, bucketref->get_info().versioning_enabled()
+        store, bucketref->get_info().versioning_enabled(), manifest
     );
   } catch (const std::system_error& e) {
     lsfs_err(dpp) << fmt::format(
@@ -535,17 +747,21 @@ int SFSMultipartUploadV2::complete(
                          e.what()
                      )
                   << dendl;
-    return -ERR_INTERNAL_ERROR;
+    res = false;
   }
   if (!res) {
     lsfs_err(dpp) << fmt::format("failed to update db object {}", objref->name)
                   << dendl;
+    if (link_manifest) {
+      unlink_parts(dpp, *mp, *objref);
+    }
     return -ERR_INTERNAL_ERROR;
   }
 
   // mark multipart upload done
   res = mpdb.mark_done(upload_id);
   ceph_assert(res);
+  store->gc->enqueue(sfs::sqlite::GCJournalKind::MULTIPART, upload_id);
 
   return 0;
 }
@@ -557,7 +773,7 @@ int SFSMultipartUploadV2::get_info(
   lsfs_debug(dpp) << fmt::format("upload_id: {}, obj: {}", upload_id, get_key())
                   << dendl;
 
-  sfs::sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
   auto mp = mpdb.get_multipart(upload_id);
   if (!mp.has_value()) {
     lsfs_debug(dpp
@@ -624,7 +840,7 @@ int SFSMultipartUploadV2::list_multiparts(
          )
       << dendl;
 
-  sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
   auto entries = mpdb.list_multiparts(
       bucket_name, prefix, marker, delim, max_uploads, is_truncated
   );
@@ -666,7 +882,7 @@ int SFSMultipartUploadV2::abort_multiparts(
   auto bucket_name = bucket->get_name();
   lsfs_debug_for(dpp, cls) << fmt::format("bucket: {}", bucket_name) << dendl;
 
-  sqlite::SQLiteMultipart mpdb(store->db_conn);
+  const auto& mpdb = store->metadata->multipart();
   auto num_aborted = mpdb.abort_multiparts(bucket_name);
   if (num_aborted < 0) {
     lsfs_verb_for(dpp, cls) << fmt::format(
@@ -677,6 +893,9 @@ int SFSMultipartUploadV2::abort_multiparts(
                             << dendl;
     return -ERR_NO_SUCH_BUCKET;
   }
+  store->multipart_states->set_bucket_state(
+      bucket->get_bucket_id(), MultipartState::ABORTED
+  );
   lsfs_debug_for(dpp, cls) << fmt::format(
                                   "aborted {} multipart uploads on bucket {}",
                                   num_aborted, bucket_name
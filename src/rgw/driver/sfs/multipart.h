@@ -83,7 +83,8 @@ class SFSMultipartPartV2 : public StoreMultipartPart {
   SFSMultipartPartV2(const sqlite::DBMultipartPart& part)
       : upload_id(part.upload_id),
         part_num(part.part_num),
-        len(part.size),
+        len(part.compression.has_value() ? part.compression->orig_size
+                                         : part.size),
         etag(part.etag.value()),
         mtime(part.mtime.value()) {}
 
@@ -106,6 +107,29 @@ class SFSMultipartUploadV2 : public StoreMultipartUpload {
 
   const std::string meta_str;
 
+  // Builds the final object by concatenating all parts into a single data
+  // file, placed at the new version's storage path.
+  int aggregate_parts(
+      const DoutPrefixProvider* dpp, CephContext* cct,
+      const sqlite::DBMultipart& mp,
+      const std::map<int, sqlite::DBMultipartPart>& to_complete,
+      rgw::sal::Object* target_obj, ObjectRef& objref, size_t& accounted_bytes
+  );
+  // Builds the final object without copying data: the upload's parts
+  // directory is moved under the new version. The part manifest is
+  // returned in `manifest`, to be committed with the version.
+  int link_parts(
+      const DoutPrefixProvider* dpp, const sqlite::DBMultipart& mp,
+      const std::map<int, sqlite::DBMultipartPart>& to_complete,
+      rgw::sal::Object* target_obj, ObjectRef& objref, size_t& accounted_bytes,
+      std::vector<sqlite::DBVersionedObjectPart>& manifest
+  );
+  // Undo link_parts(): move the parts back where the upload expects them
+  void unlink_parts(
+      const DoutPrefixProvider* dpp, const sqlite::DBMultipart& mp,
+      const Object& objref
+  );
+
  public:
   SFSMultipartUploadV2(
       rgw::sal::SFStore* _store, SFSBucket* _bucket, sfs::BucketRef _bucketref,
@@ -168,9 +192,9 @@ class SFSMultipartUploadV2 : public StoreMultipartUpload {
    *
    * @param part_etags Map of client-provided part num to part etag
    * @param remove_objs ??
-   * @param accounted_size ??
-   * @param compressed ??
-   * @param cs_info ??
+   * @param accounted_size Output, the final object's (uncompressed) size.
+   * @param compressed Output, whether the parts were compressed.
+   * @param cs_info Output, the parts' compression info chained together.
    * @param ofs ??
    * @param tag ??
    * @param owner expected bucket owner
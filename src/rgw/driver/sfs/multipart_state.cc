@@ -0,0 +1,79 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/multipart_state.h"
+
+#include <algorithm>
+
+namespace rgw::sal::sfs {
+
+MultipartUploadStateRef MultipartUploadStates::acquire(
+    const std::string& upload_id
+) {
+  std::lock_guard l(lock);
+  auto& weak = states[upload_id];
+  if (auto entry = weak.lock()) {
+    return entry;
+  }
+  auto entry = std::make_shared<MultipartUploadState>();
+  weak = entry;
+
+  if (states.size() > prune_threshold) {
+    std::erase_if(states, [](const auto& item) {
+      return item.second.expired();
+    });
+    prune_threshold = std::max<size_t>(64, states.size() * 2);
+  }
+  return entry;
+}
+
+void MultipartUploadStates::set_bucket_id(
+    const MultipartUploadStateRef& entry, const std::string& bucket_id
+) {
+  std::lock_guard l(lock);
+  entry->bucket_id = bucket_id;
+}
+
+void MultipartUploadStates::set_state(
+    const std::string& upload_id, MultipartState state
+) {
+  std::lock_guard l(lock);
+  auto it = states.find(upload_id);
+  if (it == states.end()) {
+    return;
+  }
+  if (auto entry = it->second.lock()) {
+    entry->set_state(state);
+  } else {
+    states.erase(it);
+  }
+}
+
+void MultipartUploadStates::set_bucket_state(
+    const std::string& bucket_id, MultipartState state
+) {
+  std::lock_guard l(lock);
+  for (const auto& [upload_id, weak] : states) {
+    auto entry = weak.lock();
+    if (entry && entry->bucket_id == bucket_id) {
+      entry->set_state(state);
+    }
+  }
+}
+
+size_t MultipartUploadStates::size() const {
+  std::lock_guard l(lock);
+  return states.size();
+}
+
+}  // namespace rgw::sal::sfs
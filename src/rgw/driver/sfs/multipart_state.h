@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "rgw/driver/sfs/multipart_types.h"
+
+namespace rgw::sal::sfs {
+
+/// In-memory state of a multipart upload that has part writers in
+/// flight. Writers check it for every chunk instead of querying the
+/// database; abort and complete update it after updating the database.
+class MultipartUploadState {
+  std::atomic<MultipartState> state{MultipartState::INPROGRESS};
+  // set once by MultipartUploadStates::set_bucket_id(), under its lock
+  std::string bucket_id;
+
+  friend class MultipartUploadStates;
+
+ public:
+  MultipartState get_state() const {
+    return state.load(std::memory_order_acquire);
+  }
+  void set_state(MultipartState new_state) {
+    state.store(new_state, std::memory_order_release);
+  }
+  /// true while parts may still be written
+  bool is_writable() const { return get_state() == MultipartState::INPROGRESS; }
+};
+
+using MultipartUploadStateRef = std::shared_ptr<MultipartUploadState>;
+
+/// Registry of MultipartUploadState by upload id. Entries live as long as
+/// some writer holds a reference.
+///
+/// A writer must acquire() its entry *before* reading the upload's state
+/// from the database. Any state change committed after that read is then
+/// visible through the entry.
+class MultipartUploadStates {
+  mutable std::mutex lock;
+  std::unordered_map<std::string, std::weak_ptr<MultipartUploadState>> states;
+  // expired entries are pruned once the map grows past this
+  size_t prune_threshold{64};
+
+ public:
+  MultipartUploadStates() = default;
+  MultipartUploadStates(const MultipartUploadStates&) = delete;
+  MultipartUploadStates& operator=(const MultipartUploadStates&) = delete;
+
+  /// Return the entry for `upload_id`, creating it if needed.
+  MultipartUploadStateRef acquire(const std::string& upload_id);
+  /// Record the bucket an entry belongs to, for set_bucket_state().
+  void set_bucket_id(
+      const MultipartUploadStateRef& entry, const std::string& bucket_id
+  );
+
+  /// Update the state of `upload_id`, if tracked.
+  void set_state(const std::string& upload_id, MultipartState state);
+  /// Update the state of all tracked uploads of bucket `bucket_id`.
+  void set_bucket_state(const std::string& bucket_id, MultipartState state);
+
+  /// Number of tracked uploads, including expired entries not yet pruned.
+  size_t size() const;
+};
+
+}  // namespace rgw::sal::sfs
@@ -39,9 +39,13 @@ class MultipartPartPath : public UUIDPath {
  public:
   MultipartPartPath(const uuid_d& uuid, int32_t num) : UUIDPath(uuid) {
     ceph_assert(num >= 0);
+    partpath = UUIDPath::to_path() / part_filename(num);
+  }
+
+  static std::string part_filename(int32_t num) {
     std::string filename = std::to_string(num);
     filename.append(".p");
-    partpath = UUIDPath::to_path() / filename;
+    return filename;
   }
 
   virtual std::filesystem::path to_path() const override { return partpath; }
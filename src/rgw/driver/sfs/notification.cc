@@ -0,0 +1,255 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "notification.h"
+
+#include <fmt/format.h>
+
+#include <boost/algorithm/hex.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <iterator>
+
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sfs_notify.h"
+#include "rgw/driver/sfs/sqlite/sqlite_notifications.h"
+#include "rgw_arn.h"
+#include "rgw_common.h"
+#include "rgw_sal_sfs.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal {
+
+SFSNotification::SFSNotification(
+    SFStore* _store, Object* _obj, Object* _src_obj, req_state* s,
+    rgw::notify::EventType _type, const std::string* _object_name
+)
+    : StoreNotification(_obj, _src_obj, _type),
+      store(_store),
+      bucket(s->bucket.get()),
+      object_name(_object_name),
+      user_id(s->user ? s->user->get_id().id : ""),
+      req_id(s->req_id),
+      x_meta_map(s->info.x_meta_map),
+      req_tagset(&s->tagset) {}
+
+SFSNotification::SFSNotification(
+    SFStore* _store, Object* _obj, Object* _src_obj,
+    rgw::notify::EventType _type, Bucket* _bucket,
+    const std::string& _user_id, const std::string& _req_id
+)
+    : StoreNotification(_obj, _src_obj, _type),
+      store(_store),
+      bucket(_bucket),
+      object_name(nullptr),
+      user_id(_user_id),
+      req_id(_req_id),
+      req_tagset(nullptr) {}
+
+std::string SFSNotification::object_key() const {
+  return object_name ? *object_name : obj->get_name();
+}
+
+Object* SFSNotification::attrs_object(const DoutPrefixProvider* dpp) {
+  Object* attrs_obj = src_obj ? src_obj : obj;
+  if (attrs_obj->get_attrs().empty()) {
+    if (!attrs_obj->get_bucket()) {
+      attrs_obj->set_bucket(bucket);
+    }
+    const int ret = attrs_obj->get_obj_attrs(null_yield, dpp);
+    if (ret < 0) {
+      lsfs_debug(dpp) << fmt::format(
+                             "no attributes for notification of {}: {}",
+                             attrs_obj->get_name(), ret
+                         )
+                      << dendl;
+      return nullptr;
+    }
+  }
+  return attrs_obj;
+}
+
+meta_map_t SFSNotification::get_metadata(const DoutPrefixProvider* dpp) {
+  if (!x_meta_map.empty()) {
+    return x_meta_map;
+  }
+  meta_map_t metadata;
+  const auto attrs_obj = attrs_object(dpp);
+  if (!attrs_obj) {
+    return metadata;
+  }
+  for (const auto& [name, value] : attrs_obj->get_attrs()) {
+    if (boost::algorithm::starts_with(name, RGW_ATTR_META_PREFIX)) {
+      std::string_view key(name);
+      key.remove_prefix(sizeof(RGW_ATTR_PREFIX) - 1);
+      metadata.emplace(key, value.to_str().c_str());
+    }
+  }
+  return metadata;
+}
+
+KeyMultiValueMap SFSNotification::get_tags(
+    const DoutPrefixProvider* dpp, const RGWObjTags* req_tags
+) {
+  if (req_tags && !req_tags->empty()) {
+    return req_tags->get_tags();
+  }
+  if (req_tagset && !req_tagset->empty()) {
+    return req_tagset->get_tags();
+  }
+  const auto attrs_obj = attrs_object(dpp);
+  if (!attrs_obj) {
+    return {};
+  }
+  const auto& attrs = attrs_obj->get_attrs();
+  const auto it = attrs.find(RGW_ATTR_TAGS);
+  if (it == attrs.end()) {
+    return {};
+  }
+  RGWObjTags obj_tags;
+  try {
+    auto bl_iter = it->second.cbegin();
+    obj_tags.decode(bl_iter);
+  } catch (const ceph::buffer::error&) {
+    return {};
+  }
+  return obj_tags.get_tags();
+}
+
+bool SFSNotification::matches_filter(
+    const DoutPrefixProvider* dpp, const rgw_pubsub_topic_filter& filter,
+    const RGWObjTags* req_tags
+) {
+  if (!match(filter.events, event_type)) {
+    return false;
+  }
+  if (!match(filter.s3_filter.key_filter, object_key())) {
+    return false;
+  }
+  if (!filter.s3_filter.metadata_filter.kv.empty() &&
+      !match(filter.s3_filter.metadata_filter, get_metadata(dpp))) {
+    return false;
+  }
+  if (!filter.s3_filter.tag_filter.kv.empty() &&
+      !match(filter.s3_filter.tag_filter, get_tags(dpp, req_tags))) {
+    return false;
+  }
+  return true;
+}
+
+int SFSNotification::publish_reserve(
+    const DoutPrefixProvider* dpp, RGWObjTags* obj_tags
+) {
+  if (!bucket) {
+    return 0;
+  }
+  rgw_pubsub_bucket_topics bucket_topics;
+  const int ret = bucket->read_topics(bucket_topics, nullptr, null_yield, dpp);
+  if (ret == -ENOENT) {
+    return 0;
+  }
+  if (ret < 0) {
+    return ret;
+  }
+  for (const auto& [name, filter] : bucket_topics.topics) {
+    if (matches_filter(dpp, filter, obj_tags)) {
+      lsfs_debug(dpp) << fmt::format(
+                             "notification {} on topic {} matches {} of {}",
+                             filter.s3_id, filter.topic.name,
+                             rgw::notify::to_string(event_type), object_key()
+                         )
+                      << dendl;
+      matches.push_back(filter);
+    }
+  }
+  return 0;
+}
+
+int SFSNotification::publish_commit(
+    const DoutPrefixProvider* dpp, uint64_t size,
+    const ceph::real_time& mtime, const std::string& etag,
+    const std::string& version
+) {
+  if (matches.empty()) {
+    return 0;
+  }
+  rgw_pubsub_s3_event event;
+  event.eventTime = mtime;
+  event.eventName = rgw::notify::to_event_string(event_type);
+  event.userIdentity = user_id;
+  event.x_amz_request_id = req_id;
+  event.x_amz_id_2 = store->get_host_id();
+  event.bucket_name = bucket->get_name();
+  event.bucket_ownerIdentity =
+      bucket->get_owner() ? bucket->get_owner()->get_id().id : "";
+  const auto& region = store->get_zone()->get_zonegroup().get_api_name();
+  rgw::ARN bucket_arn(bucket->get_key());
+  bucket_arn.region = region;
+  event.bucket_arn = to_string(bucket_arn);
+  event.object_key = object_key();
+  event.object_size = size;
+  event.object_etag = etag;
+  event.object_versionId = version;
+  event.awsRegion = region;
+  // timestamp as per key sequence id, hex encoded
+  const utime_t ts(ceph::real_clock::now());
+  boost::algorithm::hex(
+      reinterpret_cast<const char*>(&ts),
+      reinterpret_cast<const char*>(&ts) + sizeof(utime_t),
+      std::back_inserter(event.object_sequencer)
+  );
+  set_event_id(event.id, etag, ts);
+  event.bucket_id = bucket->get_bucket_id();
+  event.x_meta_map = get_metadata(dpp);
+  event.tags = get_tags(dpp, nullptr);
+
+  const auto now = ceph::real_clock::now();
+  sfs::sqlite::DBNotificationEvents events;
+  events.reserve(matches.size());
+  for (const auto& filter : matches) {
+    if (filter.topic.dest.push_endpoint.empty()) {
+      continue;
+    }
+    event.configurationId = filter.s3_id;
+    event.opaque_data = filter.topic.opaque_data;
+    bufferlist bl;
+    encode(event, bl);
+    sfs::sqlite::DBNotificationEvent db_event;
+    db_event.id = 0;
+    db_event.push_endpoint = filter.topic.dest.push_endpoint;
+    db_event.push_endpoint_args = filter.topic.dest.push_endpoint_args;
+    db_event.arn_topic = filter.topic.dest.arn_topic;
+    db_event.event.assign(bl.c_str(), bl.c_str() + bl.length());
+    db_event.enqueue_time = now;
+    db_event.next_attempt = now;
+    db_event.attempts = 0;
+    events.push_back(std::move(db_event));
+  }
+  try {
+    sfs::sqlite::SQLiteNotifications db_notifications(store->db_conn);
+    db_notifications.enqueue_events(events);
+  } catch (const std::system_error& e) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to queue notifications for {}: {}",
+                         object_key(), e.what()
+                     )
+                  << dendl;
+    return -EIO;
+  }
+  if (store->notification_sender) {
+    store->notification_sender->wake();
+  }
+  return 0;
+}
+
+}  // namespace rgw::sal
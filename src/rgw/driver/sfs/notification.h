@@ -14,33 +14,95 @@
 #ifndef RGW_STORE_SFS_NOTIFICATION_H
 #define RGW_STORE_SFS_NOTIFICATION_H
 
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#include "rgw_pubsub.h"
 #include "rgw_sal.h"
 #include "rgw_sal_store.h"
 
 namespace rgw::sal {
 
+class SFStore;
+
+/// Topic configurations are stored encoded, see sqlite::DBTopics.
+template <typename T>
+std::vector<char> encode_topics(const T& topics) {
+  bufferlist bl;
+  encode(topics, bl);
+  return std::vector<char>(bl.c_str(), bl.c_str() + bl.length());
+}
+
+template <typename T>
+int decode_topics(const std::vector<char>& blob, T& topics) {
+  bufferlist bl;
+  bl.append(blob.data(), blob.size());
+  try {
+    auto iter = bl.cbegin();
+    decode(topics, iter);
+  } catch (const ceph::buffer::error&) {
+    return -EIO;
+  }
+  return 0;
+}
+
+/// Bucket notifications. publish_reserve() picks the notification
+/// configurations of the bucket that match the event, publish_commit()
+/// queues one event per match in the SFS database. Delivery to the
+/// endpoints happens in the background, see sfs::SFSNotificationSender,
+/// so requests don't wait for endpoints.
 class SFSNotification : public StoreNotification {
+  SFStore* store;
+  Bucket* bucket;
+  // key to report instead of the object's, e.g. for multipart uploads
+  const std::string* const object_name;
+  const std::string user_id;
+  const std::string req_id;
+  // from the request, if any
+  meta_map_t x_meta_map;
+  const RGWObjTags* const req_tagset;
+  // configurations matched in publish_reserve()
+  std::vector<rgw_pubsub_topic_filter> matches;
+
+  std::string object_key() const;
+  /// Object used for metadata and tags. The source object for copies.
+  Object* attrs_object(const DoutPrefixProvider* dpp);
+  meta_map_t get_metadata(const DoutPrefixProvider* dpp);
+  KeyMultiValueMap get_tags(
+      const DoutPrefixProvider* dpp, const RGWObjTags* req_tags
+  );
+  bool matches_filter(
+      const DoutPrefixProvider* dpp, const rgw_pubsub_topic_filter& filter,
+      const RGWObjTags* req_tags
+  );
+
  public:
-  SFSNotification(Object* obj, Object* src_obj, rgw::notify::EventType type)
-      : StoreNotification(obj, src_obj, type) {}
+  /// For requests
+  SFSNotification(
+      SFStore* _store, Object* _obj, Object* _src_obj, req_state* s,
+      rgw::notify::EventType _type, const std::string* _object_name
+  );
+  /// For background work like lifecycle
+  SFSNotification(
+      SFStore* _store, Object* _obj, Object* _src_obj,
+      rgw::notify::EventType _type, Bucket* _bucket,
+      const std::string& _user_id, const std::string& _req_id
+  );
 
   ~SFSNotification() = default;
 
   virtual int publish_reserve(
       const DoutPrefixProvider* dpp, RGWObjTags* obj_tags = nullptr
-  ) override {
-    return 0;
-  }
+  ) override;
 
   virtual int publish_commit(
       const DoutPrefixProvider* dpp, uint64_t size,
       const ceph::real_time& mtime, const std::string& etag,
       const std::string& version
-  ) override {
-    return 0;
-  }
+  ) override;
 };
 
 }  // namespace rgw::sal
 
-#endif  // RGW_STORE_SFS_NOTIFICATION_H
\ No newline at end of file
+#endif  // RGW_STORE_SFS_NOTIFICATION_H
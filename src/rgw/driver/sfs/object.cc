@@ -16,6 +16,8 @@
 #include <fmt/chrono.h>
 #include <fmt/format.h>
 
+#include "driver/sfs/checksum.h"
+#include "driver/sfs/file_copy.h"
 #include "driver/sfs/multipart.h"
 #include "driver/sfs/sfs_log.h"
 #include "driver/sfs/sqlite/sqlite_versioned_objects.h"
@@ -120,10 +122,29 @@ int SFSObject::SFSReadOp::prepare(
     return -ENOENT;
   }
 
-  objdata = source->store->get_data_path() / objref->get_storage_path();
-  if (!std::filesystem::exists(objdata)) {
-    lsfs_verb(dpp) << "object data not found at " << objdata << dendl;
-    return -ENOENT;
+  const auto& cache = source->store->data_cache;
+  if (cache->wants(objref->get_meta().size)) {
+    cached_data = cache->get(
+        objref->version_id, objref->path.get_uuid(), objref->get_meta().mtime
+    );
+  }
+
+  if (!cached_data.has_value()) {
+    objdata = sfs::ObjectData::load(source->store, *objref);
+    if (!objdata.has_value()) {
+      lsfs_verb(dpp) << "object data not found at "
+                     << source->store->get_data_path() /
+                            objref->get_storage_path()
+                     << dendl;
+      return -ENOENT;
+    }
+  }
+
+  // cached data was verified when it was read
+  if (!cached_data.has_value() &&
+      source->store->ctx()->_conf.get_val<bool>("rgw_sfs_verify_checksums")) {
+    // composite multipart checksums are not verified
+    expected_crc = sfs::parse_crc32c(objref->get_checksum());
   }
 
   lsfs_debug(dpp)
@@ -168,18 +189,61 @@ int SFSObject::SFSReadOp::read(
                   << ", size: " << source->get_obj_size() << ", offset: " << ofs
                   << ", end: " << end << ", len: " << len << dendl;
 
-  ceph_assert(std::filesystem::exists(objdata));
+  if (cached_data.has_value()) {
+    bl.substr_of(*cached_data, ofs, len);
+    return len;
+  }
+  ceph_assert(objdata.has_value());
 
   std::string error;
-  int ret = bl.pread_file(objdata.c_str(), ofs, len, &error);
+  int ret = objdata->read(ofs, len, bl, &error);
   if (ret < 0) {
-    lsfs_err(dpp) << "failed to read object from file " << objdata
-                  << ". Returning EIO." << dendl;
+    lsfs_err(dpp) << "failed to read object " << objref->get_storage_path()
+                  << ": " << error << ". Returning EIO." << dendl;
     return -EIO;
   }
+  if (expected_crc.has_value() && ofs == 0 &&
+      static_cast<uint64_t>(len) == objdata->size()) {
+    sfs::Crc32c crc;
+    crc.update(bl);
+    ret = verify_crc(dpp, crc);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  if (ofs == 0 && static_cast<uint64_t>(len) == objdata->size()) {
+    maybe_cache(bl);
+  }
   return len;
 }
 
+void SFSObject::SFSReadOp::maybe_cache(const bufferlist& data) const {
+  const auto& cache = source->store->data_cache;
+  if (cache->wants(data.length())) {
+    cache->put(
+        objref->version_id, objref->path.get_uuid(), objref->get_meta().mtime,
+        data
+    );
+  }
+}
+
+int SFSObject::SFSReadOp::verify_crc(
+    const DoutPrefixProvider* dpp, const sfs::Crc32c& crc
+) const {
+  if (crc.value() == *expected_crc) {
+    return 0;
+  }
+  lsfs_err(dpp) << fmt::format(
+                       "checksum mismatch reading object {} at {}: "
+                       "expected {}, got {}. returning EIO.",
+                       objref->name, objref->get_storage_path().string(),
+                       sfs::format_crc32c(*expected_crc),
+                       sfs::format_crc32c(crc.value())
+                   )
+                << dendl;
+  return -EIO;
+}
+
 // async read
 int SFSObject::SFSReadOp::iterate(
     const DoutPrefixProvider* dpp, int64_t ofs, int64_t end, RGWGetDataCB* cb,
@@ -192,24 +256,60 @@ int SFSObject::SFSReadOp::iterate(
                   << ", size: " << source->get_obj_size() << ", offset: " << ofs
                   << ", end: " << end << ", len: " << len << dendl;
 
-  ceph_assert(std::filesystem::exists(objdata));
+  if (cached_data.has_value()) {
+    bufferlist bl;
+    bl.substr_of(*cached_data, ofs, len);
+    const int ret = cb->handle_data(bl, 0, len);
+    if (ret < 0) {
+      lsfs_warn(dpp) << "failed to return object data: " << ret << dendl;
+      return -EIO;
+    }
+    return len;
+  }
+  ceph_assert(objdata.has_value());
   std::string error;
 
+  const bool whole_object =
+      ofs == 0 && static_cast<uint64_t>(len) == objdata->size();
+  // Verify whole object reads as the data goes by. The last chunk is
+  // only handed out once the checksum matched.
+  std::optional<sfs::Crc32c> crc;
+  if (expected_crc.has_value() && whole_object) {
+    crc.emplace();
+  }
+  // collects the data of small objects for the data cache
+  std::optional<bufferlist> fill;
+  if (whole_object && source->store->data_cache->wants(len)) {
+    fill.emplace();
+  }
+
   const uint64_t max_chunk_size = 10485760;  // 10MB
   uint64_t missing = len;
   while (missing > 0) {
     uint64_t size = std::min(missing, max_chunk_size);
     bufferlist bl;
-    int ret = bl.pread_file(objdata.c_str(), ofs, size, &error);
+    int ret = objdata->read(ofs, size, bl, &error);
     if (ret < 0) {
-      lsfs_err(dpp) << "failed to read object from file '" << objdata
-                    << ", offset: " << ofs << ", size: " << size << ": "
+      lsfs_err(dpp) << "failed to read object '" << objref->get_storage_path()
+                    << "', offset: " << ofs << ", size: " << size << ": "
                     << error << dendl;
       return -EIO;
     }
     missing -= size;
     lsfs_debug(dpp) << "return " << size << "/" << len << ", offset: " << ofs
                     << ", missing: " << missing << dendl;
+    if (crc.has_value()) {
+      crc->update(bl);
+      if (missing == 0) {
+        ret = verify_crc(dpp, *crc);
+        if (ret < 0) {
+          return ret;
+        }
+      }
+    }
+    if (fill.has_value()) {
+      fill->append(bl);
+    }
     ret = cb->handle_data(bl, 0, size);
     if (ret < 0) {
       lsfs_warn(dpp) << "failed to return object data: " << ret << dendl;
@@ -218,6 +318,9 @@ int SFSObject::SFSReadOp::iterate(
 
     ofs += size;
   }
+  if (fill.has_value()) {
+    maybe_cache(*fill);
+  }
   return len;
 }
 
@@ -280,6 +383,192 @@ int SFSObject::delete_object(
   return del.delete_obj(dpp, y);
 }
 
+int SFSObject::link_object_data(
+    const DoutPrefixProvider* dpp, const sfs::ObjectData& srcdata,
+    const sfs::Object& dstref,
+    std::vector<sfs::sqlite::DBVersionedObjectPart>& manifest
+) const {
+  const std::filesystem::path data_path = store->get_data_path();
+  const std::filesystem::path dst_relpath = srcdata.is_manifest()
+                                                ? dstref.get_parts_path()
+                                                : dstref.get_storage_path();
+  const std::filesystem::path dstpath = data_path / dst_relpath;
+  std::error_code ec = store->data_dirs->ensure_parent(dst_relpath);
+  if (ec) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to create directory hierarchy {} for {}: {}",
+                         dstpath.parent_path().string(), dstref.name,
+                         ec.message()
+                     )
+                  << dendl;
+    return -ERR_INTERNAL_ERROR;
+  }
+
+  if (!srcdata.is_manifest()) {
+    const auto& srcpath = srcdata.get_segments().front().path;
+    if (::link(srcpath.c_str(), dstpath.c_str()) < 0) {
+      lsfs_debug(dpp) << fmt::format(
+                             "unable to link {} to {}: {}. copying instead.",
+                             srcpath.string(), dstpath.string(),
+                             cpp_strerror(errno)
+                         )
+                      << dendl;
+      return -ERR_INTERNAL_ERROR;
+    }
+    lsfs_debug(dpp) << fmt::format(
+                           "linked {} to {}", srcpath.string(), dstpath.string()
+                       )
+                    << dendl;
+    return 0;
+  }
+
+  std::filesystem::create_directory(dstpath, ec);
+  for (const auto& segment : srcdata.get_segments()) {
+    if (ec) {
+      break;
+    }
+    const auto target = dstpath / segment.path.filename();
+    if (::link(segment.path.c_str(), target.c_str()) < 0) {
+      ec.assign(errno, std::system_category());
+    }
+  }
+  if (ec) {
+    lsfs_debug(dpp) << fmt::format(
+                           "unable to link parts of {} to {}: {}. copying "
+                           "instead.",
+                           objref->name, dstpath.string(), ec.message()
+                       )
+                    << dendl;
+    std::filesystem::remove_all(dstpath, ec);
+    return -ERR_INTERNAL_ERROR;
+  }
+  const auto& db_versions = store->metadata->versioned_objects();
+  manifest = db_versions.get_parts_manifest(objref->version_id);
+  lsfs_debug(dpp) << fmt::format(
+                         "linked {} parts to {}", srcdata.get_segments().size(),
+                         dstpath.string()
+                     )
+                  << dendl;
+  return 0;
+}
+
+int SFSObject::copy_object_data(
+    const DoutPrefixProvider* dpp, const sfs::ObjectData& srcdata,
+    const sfs::Object& dstref
+) const {
+  const std::filesystem::path dstpath =
+      store->get_data_path() / dstref.get_storage_path();
+  const std::error_code ec =
+      store->data_dirs->ensure_parent(dstref.get_storage_path());
+  if (ec) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to create directory hierarchy {} for {}: {}",
+                         dstpath.parent_path().string(), dstref.name,
+                         ec.message()
+                     )
+                  << dendl;
+    return -ERR_INTERNAL_ERROR;
+  }
+  // Open O_CREAT+O_EXCL as dstref is always a new version without a
+  // file yet
+  const int dst_fd = store->data_dirs->open(
+      dstref.get_storage_path(), O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0600
+  );
+  if (dst_fd < 0) {
+    lsfs_err(dpp) << fmt::format(
+                         "unable to open dst obj {} file {} for writing: {}",
+                         dstref.name, dstpath.string(), cpp_strerror(errno)
+                     )
+                  << dendl;
+    return -ERR_INTERNAL_ERROR;
+  }
+
+  // Multipart objects stored as a parts manifest are copied into a
+  // single file.
+  for (const auto& segment : srcdata.get_segments()) {
+    const int src_fd = ::open(segment.path.c_str(), O_RDONLY | O_BINARY);
+    if (src_fd < 0) {
+      lsfs_err(dpp) << fmt::format(
+                           "unable to open src obj {} file {} for reading: {}",
+                           objref->name, segment.path.string(),
+                           cpp_strerror(errno)
+                       )
+                    << dendl;
+      ::close(dst_fd);
+      return -ERR_INTERNAL_ERROR;
+    }
+
+    lsfs_debug(dpp) << fmt::format(
+                           "copying {} fd:{} -> {} fd:{}",
+                           segment.path.string(), src_fd, dstpath.string(),
+                           dst_fd
+                       )
+                    << dendl;
+
+    int ret = sfs::clone_or_copy_range(
+        src_fd, dst_fd, segment.offset, segment.size
+    );
+    if (ret < 0) {
+      lsfs_err(dpp) << fmt::format(
+                           "failed to copy file from {} to {}: {}",
+                           segment.path.string(), dstpath.string(),
+                           cpp_strerror(ret)
+                       )
+                    << dendl;
+      ::close(src_fd);
+      ::close(dst_fd);
+      return -ERR_INTERNAL_ERROR;
+    }
+    ret = ::close(src_fd);
+    if (ret < 0) {
+      lsfs_err(dpp) << fmt::format(
+                           "failed closing src fd:{} fn:{}: {}", src_fd,
+                           segment.path.string(), cpp_strerror(ret)
+                       )
+                    << dendl;
+    }
+  }
+  int ret = ::close(dst_fd);
+  if (ret < 0) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed closing dst fd:{} fn:{}: {}", dst_fd,
+                         dstpath.string(), cpp_strerror(ret)
+                     )
+                  << dendl;
+  }
+
+  return 0;
+}
+
+Attrs SFSObject::make_copy_attrs(AttrsMod attrs_mod, const Attrs& attrs)
+    const {
+  const Attrs& src_attrs = objref->get_attrs();
+  Attrs dst_attrs;
+  switch (attrs_mod) {
+    case ATTRSMOD_REPLACE:
+      dst_attrs = attrs;
+      break;
+    case ATTRSMOD_MERGE:
+      dst_attrs = attrs;
+      dst_attrs.insert(src_attrs.begin(), src_attrs.end());
+      break;
+    case ATTRSMOD_NONE:
+    default:
+      dst_attrs = src_attrs;
+      break;
+  }
+  // the data is copied as is, so are the attributes describing it
+  const auto etag = src_attrs.find(RGW_ATTR_ETAG);
+  if (etag != src_attrs.end() && dst_attrs[RGW_ATTR_ETAG].length() == 0) {
+    dst_attrs[RGW_ATTR_ETAG] = etag->second;
+  }
+  const auto compression = src_attrs.find(RGW_ATTR_COMPRESSION);
+  if (compression != src_attrs.end()) {
+    dst_attrs[RGW_ATTR_COMPRESSION] = compression->second;
+  }
+  return dst_attrs;
+}
+
 int SFSObject::copy_object(
     User* /*user*/, req_info* /*info*/, const rgw_zone_id& /*source_zone*/,
     rgw::sal::Object* dst_object, rgw::sal::Bucket* dst_bucket,
@@ -287,7 +576,7 @@ int SFSObject::copy_object(
     ceph::real_time* /*src_mtime*/, ceph::real_time* mtime,
     const ceph::real_time* mod_ptr, const ceph::real_time* unmod_ptr,
     bool /*high_precision_time*/, const char* if_match, const char* if_nomatch,
-    AttrsMod /*attrs_mod*/, bool /*copy_if_newer*/, Attrs& /*attrs*/,
+    AttrsMod attrs_mod, bool /*copy_if_newer*/, Attrs& attrs,
     RGWObjCategory /*category*/, uint64_t /*olh_epoch*/,
     boost::optional<ceph::real_time> /*delete_at*/, std::string* /*version_id*/,
     std::string* /*tag*/, std::string* etag, void (*)(off_t, void*),
@@ -322,14 +611,11 @@ int SFSObject::copy_object(
       store->get_bucket_ref(dst_bucket->get_name());
   ceph_assert(dst_bucket_ref);
 
-  const std::filesystem::path srcpath =
-      store->get_data_path() / objref->get_storage_path();
-
-  const int src_fd = ::open(srcpath.c_str(), O_RDONLY | O_BINARY);
-  if (src_fd < 0) {
+  const auto srcdata = sfs::ObjectData::load(store, *objref);
+  if (!srcdata.has_value()) {
     lsfs_err(dpp) << fmt::format(
-                         "unable to open src obj {} file {} for reading: {}",
-                         objref->name, srcpath.string(), cpp_strerror(errno)
+                         "unable to find data of src obj {} at {}",
+                         objref->name, objref->get_storage_path().string()
                      )
                   << dendl;
     return -ERR_INTERNAL_ERROR;
@@ -338,81 +624,57 @@ int SFSObject::copy_object(
   const sfs::ObjectRef dstref =
       dst_bucket_ref->create_version(dst_object->get_key());
   if (!dstref) {
-    ::close(src_fd);
-    return -ERR_INTERNAL_ERROR;
-  }
-  const std::filesystem::path dstpath =
-      store->get_data_path() / dstref->get_storage_path();
-  std::error_code ec;
-  std::filesystem::create_directories(dstpath.parent_path(), ec);
-  if (ec) {
-    lsfs_err(dpp) << fmt::format(
-                         "failed to create directory hierarchy {} for {}: {}",
-                         dstpath.parent_path().string(), dstref->name,
-                         ec.message()
-                     )
-                  << dendl;
-    ::close(src_fd);
     return -ERR_INTERNAL_ERROR;
   }
-  // Open O_CREAT+O_EXCL as dstref is always a new version without a
-  // file yet
-  const int dst_fd =
-      ::open(dstpath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0600);
-  if (dst_fd < 0) {
-    lsfs_err(dpp) << fmt::format(
-                         "unable to open dst obj {} file {} for writing: {}",
-                         dstref->name, dstpath.string(), cpp_strerror(errno)
-                     )
-                  << dendl;
-    ::close(src_fd);
-    return -ERR_INTERNAL_ERROR;
+  // A copy onto itself only rewrites metadata (e.g. x-amz-metadata-directive
+  // REPLACE); the new version can share the existing data files.
+  const bool self_copy = src_bucket->get_name() == dst_bucket->get_name() &&
+                         get_name() == dst_object->get_name();
+  int ret = -1;
+  std::vector<sfs::sqlite::DBVersionedObjectPart> manifest;
+  if (self_copy) {
+    ret = link_object_data(dpp, *srcdata, *dstref, manifest);
   }
-
-  lsfs_debug(dpp) << fmt::format(
-                         "copying {} fd:{} -> {} fd:{}", srcpath.string(),
-                         src_fd, dstpath.string(), dst_fd
-                     )
-                  << dendl;
-
-  int ret = ::copy_file_range(
-      src_fd, nullptr, dst_fd, nullptr, objref->get_meta().size, 0
-  );
   if (ret < 0) {
-    lsfs_err(dpp) << fmt::format(
-                         "failed to copy file from {} to {}: {}",
-                         srcpath.string(), dstpath.string(), cpp_strerror(errno)
-                     )
-                  << dendl;
-    ::close(src_fd);
-    ::close(dst_fd);
-    return -ERR_INTERNAL_ERROR;
+    ret = copy_object_data(dpp, *srcdata, *dstref);
   }
-  ret = ::close(src_fd);
   if (ret < 0) {
+    return ret;
+  }
+
+  auto dest_meta = objref->get_meta();
+  dest_meta.mtime = ceph::real_clock::now();
+  dstref->update_attrs(make_copy_attrs(attrs_mod, attrs));
+  dstref->update_meta(dest_meta);
+  // the data is an exact copy, and so is its checksum
+  dstref->set_checksum(objref->get_checksum());
+  bool finished = false;
+  try {
+    finished = dstref->metadata_finish(
+        store, dst_bucket_ref->get_info().versioning_enabled(), manifest
+    );
+  } catch (const std::system_error& e) {
     lsfs_err(dpp) << fmt::format(
-                         "failed closing src fd:{} fn:{}: {}", src_fd,
-                         srcpath.string(), cpp_strerror(ret)
+                         "failed to finish copy of {} to {}: {}", objref->name,
+                         dstref->name, e.what()
                      )
                   << dendl;
   }
-  ret = ::close(dst_fd);
-  if (ret < 0) {
+  if (!finished) {
+    const std::filesystem::path dstpath =
+        store->get_data_path() / (manifest.empty() ? dstref->get_storage_path()
+                                                   : dstref->get_parts_path());
+    std::error_code ec;
+    std::filesystem::remove_all(dstpath, ec);
     lsfs_err(dpp) << fmt::format(
-                         "failed closing dst fd:{} fn:{}: {}", dst_fd,
-                         dstpath.string(), cpp_strerror(ret)
+                         "copy of {} to {} not committed, removed {}: {}",
+                         objref->name, dstref->name, dstpath.string(),
+                         ec ? ec.message() : "ok"
                      )
                   << dendl;
+    return -ERR_INTERNAL_ERROR;
   }
 
-  auto dest_meta = objref->get_meta();
-  dest_meta.mtime = ceph::real_clock::now();
-  dstref->update_attrs(objref->get_attrs());
-  dstref->update_meta(dest_meta);
-  dstref->metadata_finish(
-      store, dst_bucket_ref->get_info().versioning_enabled()
-  );
-
   // return values for CopyObjectResult response
   if (etag != nullptr) {
     *etag = dstref->get_meta().etag;
@@ -653,8 +915,12 @@ void SFSObject::_refresh_meta_from_object(
     sfs::ObjectRef obj_to_refresh, bool update_version_id_from_metadata
 ) {
   ceph_assert(obj_to_refresh);
-  // fill values from objref
-  set_obj_size(obj_to_refresh->get_meta().size);
+  // fill values from objref. Reads address the data as stored, so the
+  // object size of compressed objects is their compressed size;
+  // RGWGetObj_Decompress maps logical ranges onto compressed blocks.
+  set_obj_size(sfs::ObjectData::physical_size(
+      obj_to_refresh->get_attrs(), obj_to_refresh->get_meta().size
+  ));
   set_attrs(obj_to_refresh->get_attrs());
   state.accounted_size = obj_to_refresh->get_meta().size;
   state.mtime = obj_to_refresh->get_meta().mtime;
@@ -19,6 +19,8 @@
 #include <filesystem>
 
 #include "rgw/driver/sfs/bucket.h"
+#include "rgw/driver/sfs/checksum.h"
+#include "rgw/driver/sfs/object_data.h"
 #include "rgw/driver/sfs/types.h"
 #include "rgw_sal.h"
 #include "rgw_sal_store.h"
@@ -43,6 +45,26 @@ class SFSObject : public StoreObject {
       bool update_version_id_from_metadata = false
   );
 
+  // Make `dstref`'s data share `srcdata`'s files through hard links. Data
+  // files are never modified once committed, so this is safe as long as
+  // both versions live on the same filesystem.
+  // The parts manifest of linked multipart data is returned in
+  // `manifest`, to be committed with `dstref`.
+  int link_object_data(
+      const DoutPrefixProvider* dpp, const sfs::ObjectData& srcdata,
+      const sfs::Object& dstref,
+      std::vector<sfs::sqlite::DBVersionedObjectPart>& manifest
+  ) const;
+  // Copy `srcdata` into a single data file for `dstref`, cloning extents
+  // where the filesystem supports it.
+  int copy_object_data(
+      const DoutPrefixProvider* dpp, const sfs::ObjectData& srcdata,
+      const sfs::Object& dstref
+  ) const;
+  // Attributes of a copy of this object, `attrs` being the request's
+  // attributes applied according to `attrs_mod` (as RGWRados does)
+  Attrs make_copy_attrs(AttrsMod attrs_mod, const Attrs& attrs) const;
+
  public:
   /**
    * reads an object's contents.
@@ -51,8 +73,16 @@ class SFSObject : public StoreObject {
    private:
     SFSObject* source;
     sfs::ObjectRef objref;
-    std::filesystem::path objdata;
+    std::optional<sfs::ObjectData> objdata;
+    // crc32c to verify whole object reads against
+    // (rgw_sfs_verify_checksums)
+    std::optional<uint32_t> expected_crc;
+    // the data, if found in the data cache. objdata is not loaded then.
+    std::optional<bufferlist> cached_data;
     int handle_conditionals(const DoutPrefixProvider* dpp) const;
+    int verify_crc(const DoutPrefixProvider* dpp, const sfs::Crc32c& crc) const;
+    /// Add the object's data to the data cache after a whole object read
+    void maybe_cache(const bufferlist& data) const;
 
    public:
     SFSReadOp(SFSObject* _source);
@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "driver/sfs/object_data.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+#include "rgw/driver/sfs/multipart_types.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw_sal_sfs.h"
+
+namespace rgw::sal::sfs {
+
+std::optional<ObjectData> ObjectData::load(SFStore* store, const Object& obj) {
+  ObjectData result;
+  std::error_code ec;
+  const auto path = store->get_data_path() / obj.get_storage_path();
+  const auto size = std::filesystem::file_size(path, ec);
+  if (!ec) {
+    result.segments.push_back(Segment{path, 0, size});
+    return result;
+  }
+
+  const auto& db_versions = store->metadata->versioned_objects();
+  const auto parts = db_versions.get_parts_manifest(obj.version_id);
+  if (parts.empty()) {
+    return std::nullopt;
+  }
+  const auto parts_path = store->get_data_path() / obj.get_parts_path();
+  result.manifest = true;
+  result.segments.reserve(parts.size());
+  for (const auto& part : parts) {
+    result.segments.push_back(Segment{
+        parts_path / MultipartPartPath::part_filename(part.part_id),
+        part.offset, part.size});
+  }
+  return result;
+}
+
+std::optional<RGWCompressionInfo> ObjectData::compression_info(
+    const rgw::sal::Attrs& attrs
+) {
+  const auto it = attrs.find(RGW_ATTR_COMPRESSION);
+  if (it == attrs.end()) {
+    return std::nullopt;
+  }
+  RGWCompressionInfo cs_info;
+  try {
+    auto bl_it = it->second.cbegin();
+    decode(cs_info, bl_it);
+  } catch (const ceph::buffer::error&) {
+    return std::nullopt;
+  }
+  if (cs_info.compression_type == "none") {
+    return std::nullopt;
+  }
+  return cs_info;
+}
+
+uint64_t ObjectData::physical_size(
+    const rgw::sal::Attrs& attrs, uint64_t logical_size
+) {
+  const auto cs_info = compression_info(attrs);
+  return cs_info.has_value() ? physical_size(*cs_info) : logical_size;
+}
+
+uint64_t ObjectData::physical_size(const RGWCompressionInfo& cs_info) {
+  if (cs_info.blocks.empty()) {
+    return 0;
+  }
+  return cs_info.blocks.back().new_ofs + cs_info.blocks.back().len;
+}
+
+uint64_t ObjectData::size() const {
+  if (segments.empty()) {
+    return 0;
+  }
+  return segments.back().offset + segments.back().size;
+}
+
+int ObjectData::read(
+    uint64_t ofs, uint64_t len, bufferlist& bl, std::string* error
+) const {
+  // first segment ending after ofs
+  auto it = std::upper_bound(
+      segments.cbegin(), segments.cend(), ofs,
+      [](uint64_t o, const Segment& s) { return o < s.offset + s.size; }
+  );
+  while (len > 0) {
+    if (it == segments.cend()) {
+      if (error) {
+        *error = fmt::format("read past end of object data at {}", ofs);
+      }
+      return -EIO;
+    }
+    const uint64_t seg_ofs = ofs - it->offset;
+    const uint64_t n = std::min(len, it->size - seg_ofs);
+    const int ret = bl.pread_file(it->path.c_str(), seg_ofs, n, error);
+    if (ret < 0) {
+      return ret;
+    }
+    ofs += n;
+    len -= n;
+    ++it;
+  }
+  return 0;
+}
+
+}  // namespace rgw::sal::sfs
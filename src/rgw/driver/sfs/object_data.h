@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "include/buffer.h"
+#include "rgw/driver/sfs/types.h"
+#include "rgw_compression_types.h"
+
+namespace rgw::sal {
+class SFStore;
+}
+
+namespace rgw::sal::sfs {
+
+/// ObjectData describes where the payload of an object version lives on
+/// disk. Most versions are a single file at Object::get_storage_path().
+/// Multipart uploads completed without copying keep their part files in
+/// Object::get_parts_path() and are read in manifest order.
+class ObjectData {
+ public:
+  struct Segment {
+    std::filesystem::path path;
+    /// logical offset of the segment within the object
+    uint64_t offset;
+    uint64_t size;
+  };
+
+ private:
+  std::vector<Segment> segments;
+  bool manifest{false};
+
+ public:
+  ObjectData() = default;
+
+  /// Locate the data of `obj`. Returns nullopt if neither a data file
+  /// nor a parts manifest exists.
+  static std::optional<ObjectData> load(SFStore* store, const Object& obj);
+
+  const std::vector<Segment>& get_segments() const { return segments; }
+  /// true if the data is stored as a parts manifest
+  bool is_manifest() const { return manifest; }
+  uint64_t size() const;
+
+  /// Compression info of an object with attributes `attrs`, or nullopt
+  /// if its data is stored uncompressed.
+  static std::optional<RGWCompressionInfo> compression_info(
+      const rgw::sal::Attrs& attrs
+  );
+  /// Number of bytes stored on disk for an object of `logical_size`
+  /// bytes with attributes `attrs`.
+  static uint64_t physical_size(
+      const rgw::sal::Attrs& attrs, uint64_t logical_size
+  );
+  /// Number of bytes stored on disk according to `cs_info`.
+  static uint64_t physical_size(const RGWCompressionInfo& cs_info);
+
+  /// Read `len` bytes starting at logical offset `ofs` into `bl`,
+  /// crossing segment boundaries as needed. Returns 0 or a negative
+  /// error, with a description in `error`.
+  int read(uint64_t ofs, uint64_t len, bufferlist& bl, std::string* error)
+      const;
+};
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,746 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/sfs_backup.h"
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sqlite3.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "include/scope_guard.h"
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace fs = std::filesystem;
+
+namespace rgw::sal::sfs {
+
+// WAL file format, see https://www.sqlite.org/fileformat2.html#walformat
+static constexpr size_t WAL_HEADER_SIZE = 32;
+static constexpr size_t WAL_FRAME_HEADER_SIZE = 24;
+static constexpr uint32_t WAL_MAGIC = 0x377f0682;
+static constexpr size_t DB_HEADER_SIZE = 100;
+
+// a generation is complete once its snapshot has this name
+static const std::string SNAPSHOT_FILENAME = "snapshot.db";
+static const std::string SEGMENTS_DIRNAME = "wal";
+static const std::string TMP_SUFFIX = ".tmp";
+
+namespace {
+
+uint32_t get_be32(const unsigned char* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint32_t get_le32(const unsigned char* p) {
+  return (static_cast<uint32_t>(p[3]) << 24) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[1]) << 8) | static_cast<uint32_t>(p[0]);
+}
+
+const unsigned char* as_bytes(const std::string& data, size_t offset) {
+  return reinterpret_cast<const unsigned char*>(data.data() + offset);
+}
+
+/// The WAL checksum of SQLite over data, continuing from s. The magic
+/// number of the WAL says whether the words are big endian.
+void wal_checksum(
+    bool big_endian, const unsigned char* data, size_t len, uint32_t s[2]
+) {
+  for (size_t i = 0; i + 8 <= len; i += 8) {
+    const uint32_t x0 = big_endian ? get_be32(data + i) : get_le32(data + i);
+    const uint32_t x1 =
+        big_endian ? get_be32(data + i + 4) : get_le32(data + i + 4);
+    s[0] += x0 + s[1];
+    s[1] += x1 + s[0];
+  }
+}
+
+struct WalHeader {
+  bool big_endian;
+  uint32_t page_size;
+  uint32_t salt1;
+  uint32_t salt2;
+  uint32_t checksum[2];
+};
+
+/// The header of a WAL, if it is valid
+std::optional<WalHeader> parse_wal_header(const std::string& data) {
+  if (data.size() < WAL_HEADER_SIZE) {
+    return std::nullopt;
+  }
+  const auto h = as_bytes(data, 0);
+  const uint32_t magic = get_be32(h);
+  if ((magic & ~1U) != WAL_MAGIC) {
+    return std::nullopt;
+  }
+  WalHeader header;
+  header.big_endian = (magic & 1U) != 0;
+  header.page_size = get_be32(h + 8);
+  header.salt1 = get_be32(h + 16);
+  header.salt2 = get_be32(h + 20);
+  header.checksum[0] = 0;
+  header.checksum[1] = 0;
+  wal_checksum(header.big_endian, h, 24, header.checksum);
+  if (header.checksum[0] != get_be32(h + 24) ||
+      header.checksum[1] != get_be32(h + 28)) {
+    return std::nullopt;
+  }
+  if (header.page_size < 512 || header.page_size > 65536 ||
+      (header.page_size & (header.page_size - 1)) != 0) {
+    return std::nullopt;
+  }
+  return header;
+}
+
+/// Up to len bytes of file at offset
+std::string read_at(std::ifstream& file, uint64_t offset, size_t len) {
+  std::string data(len, '\0');
+  file.clear();
+  file.seekg(static_cast<std::streamoff>(offset));
+  file.read(data.data(), static_cast<std::streamsize>(len));
+  data.resize(static_cast<size_t>(std::max<std::streamsize>(file.gcount(), 0))
+  );
+  return data;
+}
+
+[[noreturn]] void throw_errno(std::string_view what, const fs::path& path) {
+  throw std::system_error(
+      errno, std::system_category(), fmt::format("{} {}", what, path.string())
+  );
+}
+
+void sync_dir(const fs::path& dir) {
+  const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+}
+
+/// Write data to path durably, replacing it at once
+void write_file(const fs::path& path, const std::string& data) {
+  const fs::path tmp_path = path.string() + TMP_SUFFIX;
+  const int fd =
+      ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    throw_errno("failed to create", tmp_path);
+  }
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t ret =
+        ::write(fd, data.data() + written, data.size() - written);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      const int err = errno;
+      ::close(fd);
+      errno = err;
+      throw_errno("failed to write", tmp_path);
+    }
+    written += static_cast<size_t>(ret);
+  }
+  if (::fsync(fd) < 0) {
+    const int err = errno;
+    ::close(fd);
+    errno = err;
+    throw_errno("failed to sync", tmp_path);
+  }
+  ::close(fd);
+  fs::rename(tmp_path, path);
+  sync_dir(path.parent_path());
+}
+
+void check(int rc, sqlite3* db, std::string_view what) {
+  if (rc != SQLITE_OK) {
+    throw std::system_error(
+        EIO, std::generic_category(),
+        fmt::format(
+            "{}: {}", what, db ? sqlite3_errmsg(db) : sqlite3_errstr(rc)
+        )
+    );
+  }
+}
+
+sqlite3* open_connection(const fs::path& path) {
+  sqlite3* db = nullptr;
+  const int rc =
+      sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr);
+  if (rc != SQLITE_OK) {
+    const std::string message = db ? sqlite3_errmsg(db) : sqlite3_errstr(rc);
+    sqlite3_close(db);
+    throw std::system_error(
+        EIO, std::generic_category(),
+        fmt::format("failed to open {}: {}", path.string(), message)
+    );
+  }
+  sqlite3_busy_timeout(db, 10000);
+  return db;
+}
+
+struct GenerationEntry {
+  std::string name;
+  bool complete;
+};
+
+/// Generations in backup_path, oldest first
+std::vector<GenerationEntry> list_generations(const fs::path& backup_path) {
+  std::vector<GenerationEntry> generations;
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(backup_path, ec)) {
+    const auto name = entry.path().filename().string();
+    if (!entry.is_directory() || name.size() != 16 ||
+        name.find_first_not_of("0123456789abcdef") != std::string::npos) {
+      continue;
+    }
+    generations.push_back(
+        {name, fs::exists(entry.path() / SNAPSHOT_FILENAME)}
+    );
+  }
+  std::sort(
+      generations.begin(), generations.end(),
+      [](const auto& a, const auto& b) { return a.name < b.name; }
+  );
+  return generations;
+}
+
+}  // namespace
+
+SFSBackup::SFSBackup(
+    CephContext* _cct, sqlite::DBConnRef _conn, const fs::path& _backup_path
+)
+    : cct(_cct),
+      conn(std::move(_conn)),
+      db_path(sqlite::DBConn::getDBPath(_cct)),
+      wal_path(db_path.string() + "-wal"),
+      backup_path(_backup_path),
+      wal_interval(cct->_conf.get_val<std::chrono::milliseconds>(
+          "rgw_sfs_backup_wal_interval"
+      )),
+      snapshot_interval(cct->_conf.get_val<std::chrono::seconds>(
+          "rgw_sfs_backup_snapshot_interval"
+      )),
+      snapshot_step_pages(static_cast<int>(std::clamp<uint64_t>(
+          cct->_conf.get_val<uint64_t>("rgw_sfs_backup_snapshot_step_pages"),
+          1, std::numeric_limits<int>::max()
+      ))),
+      snapshot_step_delay(cct->_conf.get_val<std::chrono::milliseconds>(
+          "rgw_sfs_backup_snapshot_step_delay"
+      )),
+      keep_generations(std::max<uint64_t>(
+          1, cct->_conf.get_val<uint64_t>("rgw_sfs_backup_generations")
+      )),
+      checkpoint_frames(
+          cct->_conf.get_val<int64_t>("rgw_sfs_wal_checkpoint_passive_frames")
+      ) {
+  fs::create_directories(backup_path);
+  reader = open_connection(db_path);
+  try {
+    checkpointer = open_connection(db_path);
+  } catch (const std::system_error&) {
+    sqlite3_close(reader);
+    throw;
+  }
+}
+
+SFSBackup::~SFSBackup() {
+  {
+    std::lock_guard l{lock};
+    down_flag = true;
+    cond.notify_all();
+  }
+  if (worker && worker->is_started()) {
+    worker->join();
+  }
+  // what was committed until now
+  if (current.has_value()) {
+    try {
+      ship();
+    } catch (const std::system_error& e) {
+      lsfs_err(this) << fmt::format("final WAL copy failed: {}", e.what())
+                     << dendl;
+    }
+  }
+  end_read();
+  sqlite3_close(checkpointer);
+  sqlite3_close(reader);
+}
+
+/*
+ * Like SFSScrubber, the worker is only started once the store is fully
+ * constructed, since the backup is its prefix provider for logging.
+ */
+void SFSBackup::initialize() {
+  worker = std::make_unique<Worker>(this);
+  worker->create("rgw_sfs_backup");
+}
+
+bool SFSBackup::wait_for(std::chrono::milliseconds duration) {
+  std::unique_lock locker{lock};
+  cond.wait_for(locker, duration, [this] { return going_down(); });
+  return !going_down();
+}
+
+void SFSBackup::begin_read() {
+  if (sqlite3_get_autocommit(reader) == 0) {
+    return;
+  }
+  check(
+      sqlite3_exec(
+          reader, "BEGIN; SELECT count(*) FROM sqlite_master;", nullptr,
+          nullptr, nullptr
+      ),
+      reader, "failed to start read transaction"
+  );
+}
+
+void SFSBackup::end_read() {
+  if (sqlite3_get_autocommit(reader) != 0) {
+    return;
+  }
+  const int rc = sqlite3_exec(reader, "COMMIT;", nullptr, nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    lsfs_warn(this) << fmt::format(
+                           "failed to end read transaction: {}",
+                           sqlite3_errmsg(reader)
+                       )
+                    << dendl;
+  }
+}
+
+/*
+ * SQLite only starts over at the beginning of the WAL once all frames
+ * in it are checkpointed, and then increments salt1. Frames are only
+ * checkpointed by maybe_checkpoint(), up to what the read transaction
+ * sees, and copy_wal() copies at least that far. So the WAL can only be
+ * started over once between two copies, with all its frames copied.
+ * Unless a commit checkpointed it past rgw_sfs_backup_wal_max_frames,
+ * DBConn counts those.
+ */
+bool SFSBackup::copy_wal(Generation& gen) {
+  if (gen.forced_checkpoints != conn->forced_wal_checkpoints) {
+    return false;
+  }
+  std::ifstream wal(wal_path, std::ios::binary);
+  if (!wal) {
+    return true;
+  }
+  const auto header = parse_wal_header(read_at(wal, 0, WAL_HEADER_SIZE));
+  if (!header.has_value()) {
+    // empty, or just being started over
+    return true;
+  }
+  WalCursor& cursor = gen.cursor;
+  if (!cursor.started || header->salt1 != cursor.salt1 ||
+      header->salt2 != cursor.salt2) {
+    if (cursor.started && header->salt1 != cursor.salt1 + 1) {
+      return false;
+    }
+    cursor = WalCursor{
+        true, header->salt1, header->salt2, 0,
+        {header->checksum[0], header->checksum[1]}};
+  }
+
+  // frames up to the last commit frame go into the segment
+  const size_t frame_size = WAL_FRAME_HEADER_SIZE + header->page_size;
+  std::string segment;
+  WalCursor next = cursor;
+  uint64_t frames = 0;
+  for (;;) {
+    const auto frame = read_at(
+        wal, WAL_HEADER_SIZE + next.frame * frame_size, frame_size
+    );
+    if (frame.size() != frame_size) {
+      break;
+    }
+    const auto f = as_bytes(frame, 0);
+    if (get_be32(f + 8) != cursor.salt1 || get_be32(f + 12) != cursor.salt2) {
+      break;
+    }
+    uint32_t checksum[2] = {next.checksum[0], next.checksum[1]};
+    wal_checksum(header->big_endian, f, 8, checksum);
+    wal_checksum(
+        header->big_endian, f + WAL_FRAME_HEADER_SIZE, header->page_size,
+        checksum
+    );
+    if (checksum[0] != get_be32(f + 16) || checksum[1] != get_be32(f + 20)) {
+      break;
+    }
+    next.frame++;
+    next.checksum[0] = checksum[0];
+    next.checksum[1] = checksum[1];
+    segment += frame;
+    // the database size after a commit, 0 for other frames
+    if (get_be32(f + 4) != 0) {
+      frames += next.frame - cursor.frame;
+      cursor = next;
+    }
+  }
+  segment.resize(frames * frame_size);
+  if (segment.empty()) {
+    return true;
+  }
+
+  write_file(
+      gen.path / SEGMENTS_DIRNAME / fmt::format("{:016x}", gen.next_segment),
+      segment
+  );
+  gen.next_segment++;
+  std::lock_guard l{lock};
+  if (status.generation == gen.name) {
+    status.segments++;
+    status.frames += frames;
+    status.last_segment = ceph::real_clock::now();
+  }
+  return true;
+}
+
+void SFSBackup::maybe_checkpoint(const Generation& gen) {
+  if (static_cast<int64_t>(gen.cursor.frame) <= checkpoint_frames) {
+    return;
+  }
+  int total_frames = 0;
+  int checkpointed_frames = 0;
+  const int rc = sqlite3_wal_checkpoint_v2(
+      checkpointer, nullptr, SQLITE_CHECKPOINT_PASSIVE, &total_frames,
+      &checkpointed_frames
+  );
+  lsfs_debug(this) << fmt::format(
+                          "WAL checkpoint returned {} ({}), total_frames={}, "
+                          "checkpointed_frames={}",
+                          rc, sqlite3_errstr(rc), total_frames,
+                          checkpointed_frames
+                      )
+                   << dendl;
+}
+
+void SFSBackup::snapshot() {
+  const auto now = ceph::real_clock::now();
+  // generations sort by name, keep that when the clock goes back
+  auto start = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          now.time_since_epoch()
+      )
+          .count()
+  );
+  const auto generations = list_generations(backup_path);
+  if (!generations.empty()) {
+    start = std::max(
+        start, std::stoull(generations.back().name, nullptr, 16) + 1
+    );
+  }
+  Generation gen;
+  gen.name = fmt::format("{:016x}", start);
+  gen.path = backup_path / gen.name;
+  fs::create_directories(gen.path / SEGMENTS_DIRNAME);
+  const fs::path tmp_path = (gen.path / SNAPSHOT_FILENAME).string() +
+                            TMP_SUFFIX;
+
+  // before the read transaction, the snapshot has at least the frames
+  // checkpointed until here
+  gen.forced_checkpoints = conn->forced_wal_checkpoints;
+  const auto read_guard = make_scope_guard([this] { end_read(); });
+  begin_read();
+  sqlite3* dest_db = nullptr;
+  const int open_rc = sqlite3_open_v2(
+      tmp_path.c_str(), &dest_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+      nullptr
+  );
+  const auto dest = std::unique_ptr<sqlite3, decltype(&sqlite3_close)>(
+      dest_db, sqlite3_close
+  );
+  check(open_rc, dest.get(), "failed to create snapshot");
+  auto state =
+      std::unique_ptr<sqlite3_backup, decltype(&sqlite3_backup_finish)>(
+          sqlite3_backup_init(dest.get(), "main", reader, "main"),
+          sqlite3_backup_finish
+      );
+  if (!state) {
+    check(sqlite3_errcode(dest.get()), dest.get(), "failed to start snapshot");
+  }
+
+  // the read transaction keeps the copied pages consistent, no matter
+  // how long the snapshot takes. the previous generation stays current
+  // meanwhile.
+  auto next_copy = ceph::real_clock::now() + wal_interval;
+  for (;;) {
+    const int rc = sqlite3_backup_step(state.get(), snapshot_step_pages);
+    if (rc == SQLITE_DONE) {
+      break;
+    }
+    if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+      check(rc, dest.get(), "snapshot failed");
+    }
+    if (current.has_value() && ceph::real_clock::now() >= next_copy) {
+      if (copy_wal(*current)) {
+        maybe_checkpoint(*current);
+      } else {
+        current.reset();
+      }
+      next_copy = ceph::real_clock::now() + wal_interval;
+    }
+    if (!wait_for(snapshot_step_delay)) {
+      state.reset();
+      std::error_code ec;
+      fs::remove_all(gen.path, ec);
+      return;
+    }
+  }
+  check(sqlite3_backup_finish(state.release()), dest.get(), "snapshot failed");
+  fs::rename(tmp_path, gen.path / SNAPSHOT_FILENAME);
+  sync_dir(gen.path);
+
+  {
+    std::lock_guard l{lock};
+    status = Status();
+    status.generation = gen.name;
+    status.last_snapshot = now;
+  }
+  next_snapshot = now + snapshot_interval;
+  // frames committed to the WAL since the snapshot started
+  copy_wal(gen);
+  maybe_checkpoint(gen);
+  current = std::move(gen);
+  lsfs_debug(this) << fmt::format(
+                          "started backup generation {}", current->name
+                      )
+                   << dendl;
+  remove_old_generations();
+}
+
+void SFSBackup::ship() {
+  if (!current.has_value()) {
+    snapshot();
+    return;
+  }
+  bool complete = false;
+  {
+    const auto read_guard = make_scope_guard([this] { end_read(); });
+    begin_read();
+    complete = copy_wal(*current);
+    if (complete) {
+      maybe_checkpoint(*current);
+    }
+  }
+  if (!complete) {
+    lsfs_warn(this) << fmt::format(
+                           "WAL frames missing from generation {}, starting a "
+                           "new one",
+                           current->name
+                       )
+                    << dendl;
+    current.reset();
+    snapshot();
+  }
+}
+
+void SFSBackup::remove_old_generations() {
+  auto generations = list_generations(backup_path);
+  uint64_t kept = 0;
+  for (auto it = generations.rbegin(); it != generations.rend(); ++it) {
+    const bool is_current = current.has_value() && it->name == current->name;
+    if (is_current || (it->complete && kept < keep_generations)) {
+      kept++;
+      continue;
+    }
+    std::error_code ec;
+    fs::remove_all(backup_path / it->name, ec);
+    if (ec) {
+      lsfs_warn(this) << fmt::format(
+                             "failed to remove backup generation {}: {}",
+                             it->name, ec.message()
+                         )
+                      << dendl;
+    }
+  }
+}
+
+SFSBackup::Status SFSBackup::get_status() const {
+  std::lock_guard l{lock};
+  return status;
+}
+
+std::ostream& SFSBackup::gen_prefix(std::ostream& out) const {
+  return out << "backup: ";
+}
+
+void* SFSBackup::Worker::entry() {
+  while (!backup->going_down()) {
+    try {
+      if (!backup->current.has_value() ||
+          ceph::real_clock::now() >= backup->next_snapshot) {
+        backup->snapshot();
+      } else {
+        backup->ship();
+      }
+    } catch (const std::system_error& e) {
+      lsfs_err_for(backup, "SFSBackup")
+          << fmt::format("backup failed: {}", e.what()) << dendl;
+    }
+    if (!backup->wait_for(backup->wal_interval)) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * The snapshot has the same pages as the database had, so writing the
+ * pages of the WAL frames over it in order, like a checkpoint does,
+ * gives the database as of the last commit. Frames from before the
+ * snapshot are written too, they hold the pages the snapshot has.
+ */
+std::string restore_backup(
+    const fs::path& backup_path, const fs::path& db_path,
+    const std::string& generation
+) {
+  std::string name = generation;
+  if (name.empty()) {
+    for (const auto& gen : list_generations(backup_path)) {
+      if (gen.complete) {
+        name = gen.name;
+      }
+    }
+    if (name.empty()) {
+      throw std::runtime_error(
+          fmt::format("no complete backup in {}", backup_path.string())
+      );
+    }
+  }
+  const auto gen_path = backup_path / name;
+  if (!fs::exists(gen_path / SNAPSHOT_FILENAME)) {
+    throw std::runtime_error(
+        fmt::format("backup generation {} has no snapshot", name)
+    );
+  }
+
+  const fs::path tmp_path = db_path.string() + ".restore";
+  fs::copy_file(
+      gen_path / SNAPSHOT_FILENAME, tmp_path,
+      fs::copy_options::overwrite_existing
+  );
+  std::vector<fs::path> segments;
+  for (const auto& entry :
+       fs::directory_iterator(gen_path / SEGMENTS_DIRNAME)) {
+    if (entry.path().extension() != TMP_SUFFIX) {
+      segments.push_back(entry.path());
+    }
+  }
+  std::sort(segments.begin(), segments.end());
+
+  uint64_t db_pages = 0;
+  {
+    std::fstream db(tmp_path, std::ios::in | std::ios::out | std::ios::binary);
+    std::string header(DB_HEADER_SIZE, '\0');
+    db.read(header.data(), static_cast<std::streamsize>(header.size()));
+    if (!db) {
+      throw std::runtime_error(
+          fmt::format("backup generation {} has a broken snapshot", name)
+      );
+    }
+    const auto h = as_bytes(header, 0);
+    // big endian, 1 stands for 65536
+    const uint32_t page_size_field =
+        (static_cast<uint32_t>(h[16]) << 8) | static_cast<uint32_t>(h[17]);
+    const uint64_t page_size = page_size_field == 1 ? 65536 : page_size_field;
+    const size_t frame_size = WAL_FRAME_HEADER_SIZE + page_size;
+    for (const auto& path : segments) {
+      std::ifstream file(path, std::ios::binary);
+      const std::string segment(
+          (std::istreambuf_iterator<char>(file)),
+          std::istreambuf_iterator<char>()
+      );
+      if (segment.empty() || segment.size() % frame_size != 0) {
+        throw std::runtime_error(
+            fmt::format("broken WAL segment {}", path.string())
+        );
+      }
+      for (size_t offset = 0; offset < segment.size(); offset += frame_size) {
+        const auto f = as_bytes(segment, offset);
+        const uint32_t page = get_be32(f);
+        const uint32_t commit_pages = get_be32(f + 4);
+        db.seekp(static_cast<std::streamoff>((page - 1) * page_size));
+        db.write(
+            segment.data() + offset + WAL_FRAME_HEADER_SIZE,
+            static_cast<std::streamsize>(page_size)
+        );
+        if (commit_pages != 0) {
+          db_pages = commit_pages;
+        }
+      }
+    }
+    db.flush();
+    if (!db) {
+      throw std::runtime_error(
+          fmt::format("failed to write {}", tmp_path.string())
+      );
+    }
+    if (db_pages > 0) {
+      db.close();
+      fs::resize_file(tmp_path, db_pages * page_size);
+    }
+  }
+
+  // the restored database is only put in place if SQLite is happy with it
+  {
+    sqlite3* check_db = nullptr;
+    const int rc = sqlite3_open_v2(
+        tmp_path.c_str(), &check_db, SQLITE_OPEN_READWRITE, nullptr
+    );
+    const auto restored = std::unique_ptr<sqlite3, decltype(&sqlite3_close)>(
+        check_db, sqlite3_close
+    );
+    check(rc, restored.get(), "failed to open restored database");
+    std::string result;
+    check(
+        sqlite3_exec(
+            restored.get(), "PRAGMA quick_check;",
+            [](void* out, int, char** values, char**) {
+              *static_cast<std::string*>(out) += values[0] ? values[0] : "";
+              return 0;
+            },
+            &result, nullptr
+        ),
+        restored.get(), "failed to check restored database"
+    );
+    if (result != "ok") {
+      throw std::runtime_error(
+          fmt::format("restored database is corrupt: {}", result)
+      );
+    }
+  }
+
+  std::error_code ec;
+  fs::remove(db_path.string() + "-wal", ec);
+  fs::remove(db_path.string() + "-shm", ec);
+  fs::rename(tmp_path, db_path);
+  return name;
+}
+
+}  // namespace rgw::sal::sfs
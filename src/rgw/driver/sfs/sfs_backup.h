@@ -0,0 +1,176 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "common/Thread.h"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "common/dout.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+
+struct sqlite3;
+
+namespace rgw::sal::sfs {
+
+/// SFSBackup continuously backs up the metadata database into
+/// rgw_sfs_backup_path. The backup is kept in generations, directories
+/// named after their start time. A generation holds a base snapshot of
+/// the database, copied with sqlite3_backup a few pages at a time, and
+/// WAL segments: the frames committed to the WAL since, as SQLite wrote
+/// them. Every rgw_sfs_backup_wal_interval the worker copies newly
+/// committed frames into a segment, so at most that much is lost.
+/// restore_backup() puts snapshot and segments back together.
+///
+/// The worker copies the WAL file, it doesn't add work to writes. It
+/// takes over WAL checkpoints from the connections though, see
+/// DBConn: SQLite only starts over at the beginning of the WAL once all
+/// frames are checkpointed, and the worker only checkpoints frames it
+/// has already copied. Should the WAL still grow past
+/// rgw_sfs_backup_wal_max_frames, a commit checkpoints it anyway and the
+/// worker starts a new generation.
+class SFSBackup : public DoutPrefixProvider {
+ public:
+  struct Status {
+    std::string generation;
+    uint64_t segments{0};
+    uint64_t frames{0};
+    ceph::real_time last_snapshot;
+    ceph::real_time last_segment;
+  };
+
+ private:
+  /// Where copying continues in the WAL
+  struct WalCursor {
+    bool started{false};
+    uint32_t salt1{0};
+    uint32_t salt2{0};
+    /// next frame to copy
+    uint64_t frame{0};
+    /// running checksum of the frames before it
+    uint32_t checksum[2]{0, 0};
+  };
+
+  struct Generation {
+    std::string name;
+    std::filesystem::path path;
+    WalCursor cursor;
+    uint64_t next_segment{0};
+    /// DBConn::forced_wal_checkpoints when the generation was started
+    uint64_t forced_checkpoints{0};
+  };
+
+  CephContext* cct;
+  const sqlite::DBConnRef conn;
+  const std::filesystem::path db_path;
+  const std::filesystem::path wal_path;
+  const std::filesystem::path backup_path;
+  const std::chrono::milliseconds wal_interval;
+  const std::chrono::seconds snapshot_interval;
+  const int snapshot_step_pages;
+  const std::chrono::milliseconds snapshot_step_delay;
+  const uint64_t keep_generations;
+  const int64_t checkpoint_frames;
+
+  std::atomic<bool> down_flag = {false};
+  mutable ceph::mutex lock = ceph::make_mutex("SFSBackup");
+  ceph::condition_variable cond;
+  // under lock
+  Status status;
+
+  // only used by the worker. reader holds the read transactions, the
+  // snapshot and the WAL copy see the same database through it.
+  // checkpointer can't be the same connection, a checkpoint doesn't
+  // run while the connection has a transaction open.
+  sqlite3* reader = nullptr;
+  sqlite3* checkpointer = nullptr;
+  std::optional<Generation> current;
+  ceph::real_time next_snapshot;
+
+  class Worker : public Thread {
+    SFSBackup* backup = nullptr;
+
+   public:
+    explicit Worker(SFSBackup* _backup) : backup(_backup) {}
+    void* entry() override;
+  };
+  std::unique_ptr<Worker> worker;
+
+  bool going_down() const { return down_flag; }
+  /// Sleep until duration passed or shutdown. Returns false on shutdown.
+  bool wait_for(std::chrono::milliseconds duration);
+
+  void begin_read();
+  void end_read();
+  /// Copy committed frames of the WAL after gen's cursor into a new
+  /// segment of gen. Needs a read transaction on reader. Returns false
+  /// if frames are missing, the WAL was started over more than once
+  /// since the last copy or checkpointed by a commit.
+  bool copy_wal(Generation& gen);
+  /// Checkpoint the frames the read transaction on reader sees, if the
+  /// WAL is long enough
+  void maybe_checkpoint(const Generation& gen);
+  /// Remove all but the newest keep_generations complete generations
+  void remove_old_generations();
+
+ public:
+  /// Opens its own connections to the database of _conn. Throws
+  /// std::system_error if that fails.
+  SFSBackup(
+      CephContext* _cct, sqlite::DBConnRef _conn,
+      const std::filesystem::path& _backup_path
+  );
+  ~SFSBackup();
+
+  SFSBackup(const SFSBackup&) = delete;
+  SFSBackup& operator=(const SFSBackup&) = delete;
+
+  /// Start the worker. It takes a snapshot first.
+  void initialize();
+
+  /// Start a new generation with a snapshot of the database. WAL frames
+  /// committed meanwhile go to the previous generation. Throws
+  /// std::system_error.
+  void snapshot();
+  /// Copy newly committed WAL frames to the current generation and
+  /// checkpoint them. Starts a new generation if there is none or
+  /// frames are missing. Throws std::system_error.
+  void ship();
+
+  Status get_status() const;
+
+  CephContext* get_cct() const override { return cct; }
+  unsigned get_subsys() const override { return ceph_subsys_rgw_sfs; }
+  std::ostream& gen_prefix(std::ostream& out) const override;
+
+  std::string get_cls_name() const { return "SFSBackup"; }
+};
+
+/// Rebuild the database at db_path from generation in backup_path, the
+/// newest complete one if empty. Existing WAL and shared memory files
+/// of db_path are removed. Returns the generation used. Throws
+/// std::system_error, or std::runtime_error if the backup is unusable.
+std::string restore_backup(
+    const std::filesystem::path& backup_path,
+    const std::filesystem::path& db_path, const std::string& generation = ""
+);
+
+}  // namespace rgw::sal::sfs
@@ -17,11 +17,14 @@
 #include <driver/sfs/sqlite/buckets/multipart_definitions.h>
 
 #include <filesystem>
+#include <iterator>
 
 #include "common/Clock.h"
 #include "driver/sfs/types.h"
 #include "multipart_types.h"
+#include "rgw/driver/sfs/bucket_dirs.h"
 #include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sqlite/sqlite_gc_journal.h"
 #include "rgw/driver/sfs/sqlite/sqlite_multipart.h"
 #include "rgw/driver/sfs/sqlite/sqlite_objects.h"
 #include "rgw/rgw_perf_counters.h"
@@ -32,8 +35,14 @@
 
 namespace rgw::sal::sfs {
 
-SFSGC::SFSGC(CephContext* _cctx, SFStore* _store) : cct(_cctx), store(_store) {
+SFSGC::SFSGC(CephContext* _cctx, SFStore* _store)
+    : cct(_cctx),
+      store(_store),
+      journal_enabled(cct->_conf.get_val<bool>("rgw_sfs_gc_journal")) {
   worker = std::make_unique<GCWorker>(this, cct, this);
+  deleter_pool = std::make_unique<GCDeleterPool>(
+      cct->_conf.get_val<uint64_t>("rgw_sfs_gc_delete_threads")
+  );
 }
 
 SFSGC::~SFSGC() {
@@ -47,59 +56,166 @@ SFSGC::~SFSGC() {
 int SFSGC::process() {
   // This is the method that does the garbage collection.
   initial_process_time = ceph_clock_now();
+  deleted_items = 0;
   perfcounter->inc(l_rgw_sfs_gc_count);
+  // entries queued from here on may refer to work the scan misses
+  sqlite::SQLiteGCJournal journal(store->db_conn);
+  const int journal_last_id = journal.get_last_id();
 
-  // start by deleting possible pending objects data in the filesystem
-  // this could be stopped in a previous execution due to max exec time elapsed
-  auto time_to_process_more = delete_pending_objects_data();
-  if (!time_to_process_more) {
+  const auto exit_state = process_steps();
+  perfcounter->set(
+      l_rgw_sfs_gc_process_exit, static_cast<uint64_t>(exit_state)
+  );
+  if (exit_state == sfs_gc_process_exit_state::finished) {
+    journal.remove_entries_up_to(journal_last_id);
+  }
+
+  const double elapsed = ceph_clock_now() - initial_process_time;
+  if (elapsed > 0) {
     perfcounter->set(
-        l_rgw_sfs_gc_process_exit,
-        static_cast<uint64_t>(
-            sfs_gc_process_exit_state::delete_pending_objects_data
-        )
+        l_rgw_sfs_gc_delete_rate,
+        static_cast<uint64_t>(static_cast<double>(deleted_items) / elapsed)
     );
-    return 0;
+  }
+  update_backlog();
+  return 0;
+}
+
+sfs_gc_process_exit_state SFSGC::process_steps() {
+  // start by deleting possible pending objects data in the filesystem
+  // this could be stopped in a previous execution due to max exec time elapsed
+  if (!delete_pending_objects_data()) {
+    return sfs_gc_process_exit_state::delete_pending_objects_data;
   }
   // now delete possible pending multiparts data
-  time_to_process_more = delete_pending_multiparts_data();
-  if (!time_to_process_more) {
-    perfcounter->set(
-        l_rgw_sfs_gc_process_exit,
-        static_cast<uint64_t>(
-            sfs_gc_process_exit_state::delete_pending_multiparts_data
-        )
-    );
-    return 0;
+  if (!delete_pending_multiparts_data()) {
+    return sfs_gc_process_exit_state::delete_pending_multiparts_data;
   }
   // process deleted buckets
-  time_to_process_more = process_deleted_buckets();
-  if (!time_to_process_more) {
-    perfcounter->set(
-        l_rgw_sfs_gc_process_exit,
-        static_cast<uint64_t>(sfs_gc_process_exit_state::process_deleted_buckets
-        )
-    );
-    return 0;
+  if (!process_deleted_buckets()) {
+    return sfs_gc_process_exit_state::process_deleted_buckets;
   }
   // process deleted objects
-  time_to_process_more = process_deleted_objects();
-  if (!time_to_process_more) {
-    perfcounter->set(
-        l_rgw_sfs_gc_process_exit,
-        static_cast<uint64_t>(sfs_gc_process_exit_state::process_deleted_objects
-        )
-    );
-    return 0;
+  if (!process_deleted_objects()) {
+    return sfs_gc_process_exit_state::process_deleted_objects;
   }
-
   // process done or aborted multiparts
-  time_to_process_more = process_done_and_aborted_multiparts();
-  perfcounter->set(
-      l_rgw_sfs_gc_process_exit,
-      static_cast<uint64_t>(sfs_gc_process_exit_state::finished)
-  );
-  return 0;
+  process_done_and_aborted_multiparts();
+  return sfs_gc_process_exit_state::finished;
+}
+
+bool SFSGC::process_journal() {
+  common::PerfGuard elapsed(perfcounter, l_rgw_sfs_gc_journal_elapsed);
+  initial_process_time = ceph_clock_now();
+  // leftovers of a previous run first
+  if (!delete_pending_objects_data() || !delete_pending_multiparts_data()) {
+    return false;
+  }
+
+  sqlite::SQLiteGCJournal journal(store->db_conn);
+  for (;;) {
+    const auto entries =
+        journal.get_entries(max_objects_to_delete_per_iteration);
+    if (entries.empty()) {
+      return true;
+    }
+    std::vector<int> done;
+    done.reserve(entries.size());
+    bool time_to_process_more = true;
+    for (const auto& entry : entries) {
+      time_to_process_more = process_journal_entry(entry);
+      if (!time_to_process_more) {
+        // the entry is processed again next time
+        break;
+      }
+      done.push_back(entry.id);
+    }
+    journal.remove_entries(done);
+    perfcounter->inc(l_rgw_sfs_gc_journal_entries, done.size());
+    if (!time_to_process_more) {
+      lsfs_debug(this) << "Exit due to max process time reached." << dendl;
+      return false;
+    }
+  }
+}
+
+bool SFSGC::process_journal_entry(const sqlite::DBGCJournalEntry& entry) {
+  switch (entry.kind) {
+    case sqlite::GCJournalKind::OBJECT: {
+      uuid_d uuid;
+      if (!uuid.parse(entry.ref.c_str())) {
+        lsfs_warn(this) << "ignoring journal entry for invalid object uuid "
+                        << entry.ref << dendl;
+        return true;
+      }
+      const auto& db_versions = store->metadata->versioned_objects();
+      for (;;) {
+        pending_objects_to_delete =
+            db_versions.remove_deleted_object_versions_transact(
+                uuid, max_objects_to_delete_per_iteration
+            );
+        if (!pending_objects_to_delete.has_value() ||
+            pending_objects_to_delete->empty()) {
+          return true;
+        }
+        if (!delete_pending_objects_data()) {
+          return false;
+        }
+      }
+    }
+    case sqlite::GCJournalKind::MULTIPART: {
+      const auto& db_multipart = store->metadata->multipart();
+      for (;;) {
+        pending_multiparts_to_delete =
+            db_multipart.remove_done_or_aborted_multipart_transact(
+                entry.ref, max_objects_to_delete_per_iteration
+            );
+        if (!pending_multiparts_to_delete.has_value() ||
+            pending_multiparts_to_delete->empty()) {
+          return true;
+        }
+        if (!delete_pending_multiparts_data()) {
+          return false;
+        }
+      }
+    }
+    case sqlite::GCJournalKind::BUCKET:
+      return process_deleted_buckets();
+    default:
+      return true;
+  }
+}
+
+void SFSGC::enqueue(sqlite::GCJournalKind kind, const std::string& ref) {
+  if (!journal_enabled) {
+    return;
+  }
+  try {
+    sqlite::SQLiteGCJournal journal(store->db_conn);
+    journal.enqueue(kind, ref);
+  } catch (const std::system_error& e) {
+    lsfs_warn(this) << "failed to queue gc work for " << ref << ": "
+                    << e.what() << dendl;
+    return;
+  }
+  worker->wake();
+}
+
+void SFSGC::enqueue(
+    sqlite::GCJournalKind kind, const std::vector<std::string>& refs
+) {
+  if (!journal_enabled || refs.empty()) {
+    return;
+  }
+  try {
+    sqlite::SQLiteGCJournal journal(store->db_conn);
+    journal.enqueue(kind, refs);
+  } catch (const std::system_error& e) {
+    lsfs_warn(this) << "failed to queue gc work for " << refs.size()
+                    << " entries: " << e.what() << dendl;
+    return;
+  }
+  worker->wake();
 }
 
 bool SFSGC::going_down() {
@@ -142,7 +258,7 @@ std::ostream& SFSGC::gen_prefix(std::ostream& out) const {
 bool SFSGC::process_deleted_buckets() {
   common::PerfGuard elapsed(perfcounter, l_rgw_sfs_gc_deleted_buckets_elapsed);
   // permanently delete removed buckets and their objects and versions
-  sqlite::SQLiteBuckets db_buckets(store->db_conn);
+  const auto& db_buckets = store->metadata->buckets();
   auto deleted_buckets = db_buckets.get_deleted_buckets_ids();
   lsfs_debug(this) << "deleted buckets found = " << deleted_buckets.size()
                    << dendl;
@@ -182,20 +298,40 @@ bool SFSGC::process_deleted_objects() {
     // process deleted objects now in batches
     time_to_process_more = process_deleted_objects_batch(more_objects);
   }
-  return time_to_process_more;
+  // the data of the last batch is still pending
+  return time_to_process_more && delete_pending_objects_data();
 }
 
+// The data of the previous batch is deleted while the next batch is
+// removed from the database.
 bool SFSGC::process_deleted_objects_batch(bool& more_objects) {
   more_objects = true;
-  sqlite::SQLiteVersionedObjects db_versions(store->db_conn);
-  pending_objects_to_delete = db_versions.remove_deleted_versions_transact(
-      max_objects_to_delete_per_iteration
-  );
-  if (pending_objects_to_delete.has_value() &&
-      (*pending_objects_to_delete).empty()) {
-    more_objects = false;
+  auto deletion = start_objects_data_deletion();
+  const auto& db_versions = store->metadata->versioned_objects();
+  std::optional<sqlite::DBDeletedObjectItems> next_batch;
+  try {
+    next_batch = db_versions.remove_deleted_versions_transact(
+        max_objects_to_delete_per_iteration
+    );
+  } catch (const std::system_error&) {
+    // keep track of what the running deletion did not get to
+    finish_data_deletion(std::move(deletion), pending_objects_to_delete);
+    throw;
   }
-  return delete_pending_objects_data();
+  const bool all_deleted =
+      finish_data_deletion(std::move(deletion), pending_objects_to_delete);
+  if (next_batch.has_value()) {
+    more_objects = !next_batch->empty();
+    std::move(
+        next_batch->begin(), next_batch->end(),
+        std::back_inserter(*pending_objects_to_delete)
+    );
+  }
+  if (!all_deleted || process_time_elapsed()) {
+    lsfs_debug(this) << "Exit due to max process time reached." << dendl;
+    return false;
+  }
+  return true;
 }
 
 bool SFSGC::process_done_and_aborted_multiparts() {
@@ -209,79 +345,156 @@ bool SFSGC::process_done_and_aborted_multiparts() {
     time_to_process_more =
         process_done_and_aborted_multiparts_batch(all_parts_deleted);
   }
-  return time_to_process_more;
+  // the data of the last batch is still pending
+  return time_to_process_more && delete_pending_multiparts_data();
 }
 
+// As with objects, the previous batch's part files are deleted while the
+// next batch is removed from the database.
 bool SFSGC::process_done_and_aborted_multiparts_batch(bool& all_parts_deleted) {
   all_parts_deleted = false;
-  sqlite::SQLiteMultipart db_multipart(store->db_conn);
-  pending_multiparts_to_delete =
-      db_multipart.remove_done_or_aborted_multiparts_transact(
-          max_objects_to_delete_per_iteration
-      );
-  if (pending_multiparts_to_delete.has_value() &&
-      (*pending_multiparts_to_delete).empty()) {
-    all_parts_deleted = true;
+  auto deletion = start_multiparts_data_deletion();
+  const auto& db_multipart = store->metadata->multipart();
+  std::optional<sqlite::DBDeletedMultipartItems> next_batch;
+  try {
+    next_batch = db_multipart.remove_done_or_aborted_multiparts_transact(
+        max_objects_to_delete_per_iteration
+    );
+  } catch (const std::system_error&) {
+    // keep track of what the running deletion did not get to
+    finish_data_deletion(std::move(deletion), pending_multiparts_to_delete);
+    throw;
   }
-  return delete_pending_multiparts_data();
+  const bool all_deleted =
+      finish_data_deletion(std::move(deletion), pending_multiparts_to_delete);
+  if (next_batch.has_value()) {
+    all_parts_deleted = next_batch->empty();
+    std::move(
+        next_batch->begin(), next_batch->end(),
+        std::back_inserter(*pending_multiparts_to_delete)
+    );
+  }
+  if (!all_deleted || process_time_elapsed()) {
+    lsfs_debug(this) << "Exit due to max process time reached." << dendl;
+    return false;
+  }
+  return true;
 }
 
 bool SFSGC::delete_pending_objects_data() {
   common::PerfGuard elapsed(
       perfcounter, l_rgw_sfs_gc_pending_objects_data_elapsed
   );
-  // delete objects in a loop and check if the max process time has reached
-  // for every object.
-  if (pending_objects_to_delete.has_value()) {
-    for (auto it = (*pending_objects_to_delete).begin();
-         it != (*pending_objects_to_delete).end();) {
-      Object::delete_version_data(
-          store, sqlite::get_uuid((*it)), sqlite::get_version_id((*it))
-      );
-      it = (*pending_objects_to_delete).erase(it);
-      if (process_time_elapsed()) {
-        lsfs_debug(this) << "Exit due to max process time reached." << dendl;
-        return false;  // had no time to delete everything
-      }
-    }
+  const bool all_deleted = finish_data_deletion(
+      start_objects_data_deletion(), pending_objects_to_delete
+  );
+  if (!all_deleted) {
+    lsfs_debug(this) << "Exit due to max process time reached." << dendl;
   }
-  return true;  // all objects were successfully deleted
+  return all_deleted;
 }
 
 bool SFSGC::delete_pending_multiparts_data() {
   common::PerfGuard elapsed(
       perfcounter, l_rgw_sfs_gc_pending_multiparts_data_elapsed
   );
+  const bool all_deleted = finish_data_deletion(
+      start_multiparts_data_deletion(), pending_multiparts_to_delete
+  );
+  if (!all_deleted) {
+    lsfs_debug(this) << "Exit due to max process time reached." << dendl;
+  }
+  return all_deleted;
+}
+
+std::unique_ptr<GCDataDeletion<sqlite::DBDeletedObjectItem>>
+SFSGC::start_objects_data_deletion() {
+  sqlite::DBDeletedObjectItems items;
+  if (pending_objects_to_delete.has_value()) {
+    items.swap(*pending_objects_to_delete);
+  } else {
+    pending_objects_to_delete.emplace();
+  }
+  return std::make_unique<GCDataDeletion<sqlite::DBDeletedObjectItem>>(
+      *deleter_pool, std::move(items),
+      [this](const sqlite::DBDeletedObjectItem& item) {
+        return store->bucket_dirs->data_root(sqlite::get_bucket_id(item)) /
+               UUIDPath(sqlite::get_uuid(item)).to_path().parent_path();
+      },
+      [this](const sqlite::DBDeletedObjectItem& item) {
+        Object::delete_version_data(
+            store, sqlite::get_uuid(item), sqlite::get_version_id(item),
+            store->bucket_dirs->data_root(sqlite::get_bucket_id(item))
+        );
+      },
+      [this] { return process_time_elapsed(); }
+  );
+}
+
+std::unique_ptr<GCDataDeletion<sqlite::DBDeletedMultipartItem>>
+SFSGC::start_multiparts_data_deletion() {
+  sqlite::DBDeletedMultipartItems items;
+  if (pending_multiparts_to_delete.has_value()) {
+    items.swap(*pending_multiparts_to_delete);
+  } else {
+    pending_multiparts_to_delete.emplace();
+  }
+  return std::make_unique<GCDataDeletion<sqlite::DBDeletedMultipartItem>>(
+      *deleter_pool, std::move(items),
+      [](const sqlite::DBDeletedMultipartItem& item) {
+        return UUIDPath(sqlite::get_path_uuid(item)).to_path().parent_path();
+      },
+      [this](const sqlite::DBDeletedMultipartItem& item) {
+        MultipartPartPath pp(
+            sqlite::get_path_uuid(item), sqlite::get_part_id(item)
+        );
+        std::error_code ec;
+        std::filesystem::remove(store->get_data_path() / pp.to_path(), ec);
+      },
+      [this] { return process_time_elapsed(); }
+  );
+}
+
+template <typename Item>
+bool SFSGC::finish_data_deletion(
+    std::unique_ptr<GCDataDeletion<Item>> deletion,
+    std::optional<std::vector<Item>>& pending
+) {
+  std::vector<Item> remaining;
+  const auto count = deletion->wait(remaining);
+  deleted_items += count;
+  perfcounter->inc(l_rgw_sfs_gc_deleted_items, count);
+  if (!pending.has_value()) {
+    pending.emplace();
+  }
+  // keep what was not deleted in front, it was removed from the db first
+  std::move(pending->begin(), pending->end(), std::back_inserter(remaining));
+  pending->swap(remaining);
+  return pending->empty();
+}
+
+void SFSGC::update_backlog() const {
+  const auto& db_versions = store->metadata->versioned_objects();
+  uint64_t backlog = db_versions.count_deleted_versions();
+  if (pending_objects_to_delete.has_value()) {
+    backlog += pending_objects_to_delete->size();
+  }
   if (pending_multiparts_to_delete.has_value()) {
-    // delete multiparts in a loop and check if the max process time has reached
-    // for every part.
-    for (auto it = (*pending_multiparts_to_delete).begin();
-         it != (*pending_multiparts_to_delete).end();) {
-      MultipartPartPath pp(
-          sqlite::get_path_uuid((*it)), sqlite::get_part_id((*it))
-      );
-      auto p = store->get_data_path() / pp.to_path();
-      if (std::filesystem::exists(p)) {
-        std::filesystem::remove(p);
-      }
-      it = (*pending_multiparts_to_delete).erase(it);
-      // check that we didn't exceed the max before keep going
-      if (process_time_elapsed()) {
-        lsfs_debug(this) << "Exit due to max process time reached." << dendl;
-        return false;  // had no time to delete everything
-      }
-    }
+    backlog += pending_multiparts_to_delete->size();
   }
-  return true;  // all objects were successfully deleted
+  perfcounter->set(l_rgw_sfs_gc_backlog, backlog);
 }
 
 bool SFSGC::abort_bucket_multiparts(const std::string& bucket_id) {
   common::PerfGuard elapsed(
       perfcounter, l_rgw_sfs_gc_abort_bucket_multiparts_elapsed
   );
-  sqlite::SQLiteMultipart db_mp(store->db_conn);
+  const auto& db_mp = store->metadata->multipart();
   int ret = db_mp.abort_multiparts_by_bucket_id(bucket_id);
   ceph_assert(ret >= 0);
+  store->multipart_states->set_bucket_state(
+      bucket_id, MultipartState::ABORTED
+  );
 
   // check that we didn't exceed the max before keep going
   if (process_time_elapsed()) {
@@ -294,7 +507,7 @@ bool SFSGC::abort_bucket_multiparts(const std::string& bucket_id) {
 bool SFSGC::delete_bucket_multiparts(
     const std::string& bucket_id, bool& all_parts_deleted
 ) {
-  sqlite::SQLiteMultipart db_mp(store->db_conn);
+  const auto& db_mp = store->metadata->multipart();
   pending_multiparts_to_delete = db_mp.remove_multiparts_by_bucket_id_transact(
       bucket_id, max_objects_to_delete_per_iteration
   );
@@ -304,7 +517,21 @@ bool SFSGC::delete_bucket_multiparts(
 }
 
 bool SFSGC::delete_bucket(const std::string& bucket_id, bool& bucket_deleted) {
-  sqlite::SQLiteBuckets db_buckets(store->db_conn);
+  const auto& db_buckets = store->metadata->buckets();
+  if (store->bucket_dirs->has_own_dir(bucket_id)) {
+    // the data went to the trash with the bucket directory, only the
+    // rows are left
+    const auto dropped = db_buckets.drop_bucket_rows_transact(
+        bucket_id, max_objects_to_delete_per_iteration, bucket_deleted
+    );
+    if (dropped.has_value()) {
+      deleted_items += *dropped;
+    }
+    if (bucket_deleted) {
+      store->bucket_dirs->forget(bucket_id);
+    }
+    return !process_time_elapsed();
+  }
   // deletes the db bucket (and all it's objects and versions) first in a
   // transaction.
   // The call return the objects (and versions) that need to be deleted from
@@ -327,34 +554,44 @@ SFSGC::GCWorker::GCWorker(
     : dpp(_dpp), cct(_cct), gc(_gc) {}
 
 void* SFSGC::GCWorker::entry() {
+  // the full scan runs right away and then every rgw_gc_processor_period;
+  // journal entries are processed as they are queued in between
+  auto next_full_scan = ceph::mono_clock::now();
   do {
-    utime_t start = ceph_clock_now();
-    lsfs_startup(dpp) << "start" << dendl;
-
     if (!gc->suspended()) {
-      common::PerfGuard elapsed(perfcounter, l_rgw_sfs_gc_processing_time);
-      int r = gc->process();
-      if (r < 0) {
-        lsfs_err(dpp) << "ERROR: garbage collection process() returned error r="
-                      << r << dendl;
+      if (ceph::mono_clock::now() >= next_full_scan) {
+        const auto start = ceph::mono_clock::now();
+        lsfs_startup(dpp) << "start" << dendl;
+        common::PerfGuard elapsed(perfcounter, l_rgw_sfs_gc_processing_time);
+        int r = gc->process();
+        if (r < 0) {
+          lsfs_err(dpp)
+              << "ERROR: garbage collection process() returned error r=" << r
+              << dendl;
+        }
+        lsfs_shutdown(dpp) << "stop" << dendl;
+        const auto period =
+            std::chrono::seconds(cct->_conf->rgw_gc_processor_period);
+        next_full_scan = start + period;
+        if (next_full_scan <= ceph::mono_clock::now()) {
+          // in case the GC iteration took more time than the period
+          next_full_scan = ceph::mono_clock::now() + period;
+        }
+      } else if (!gc->process_journal()) {
+        // out of time, go on with the rest right away
+        std::lock_guard l{lock};
+        wakeup = true;
       }
-      lsfs_shutdown(dpp) << "stop" << dendl;
     }
 
     if (gc->going_down()) break;
 
-    utime_t end = ceph_clock_now();
-    end -= start;
-    int secs = cct->_conf->rgw_gc_processor_period;
-    secs -= end.sec();
-    if (secs <= 0) {
-      // in case the GC iteration took more time than the period
-      secs = cct->_conf->rgw_gc_processor_period;
-      ;
-    }
-
     std::unique_lock locker{lock};
-    cond.wait_for(locker, std::chrono::seconds(secs));
+    const auto now = ceph::mono_clock::now();
+    if (!wakeup && next_full_scan > now) {
+      cond.wait_for(locker, next_full_scan - now);
+    }
+    wakeup = false;
   } while (!gc->going_down());
 
   return nullptr;
@@ -365,4 +602,10 @@ void SFSGC::GCWorker::stop() {
   cond.notify_all();
 }
 
+void SFSGC::GCWorker::wake() {
+  std::lock_guard l{lock};
+  wakeup = true;
+  cond.notify_all();
+}
+
 }  //  namespace rgw::sal::sfs
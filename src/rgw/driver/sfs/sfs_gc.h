@@ -15,6 +15,9 @@
 
 #include <memory>
 
+#include "rgw/driver/sfs/gc_deleter.h"
+#include "rgw/driver/sfs/sqlite/gc/gc_journal_definitions.h"
+#include "rgw/rgw_perf_counters.h"
 #include "rgw_sal.h"
 #include "rgw_sal_sfs.h"
 
@@ -30,6 +33,10 @@ class SFSGC : public DoutPrefixProvider {
   std::chrono::milliseconds max_process_time;
   utime_t initial_process_time;
   uint64_t max_objects_to_delete_per_iteration;
+  const bool journal_enabled;
+  std::unique_ptr<GCDeleterPool> deleter_pool;
+  // deletion throughput of the current run
+  uint64_t deleted_items{0};
 
   class GCWorker : public Thread {
     const DoutPrefixProvider* dpp = nullptr;
@@ -37,6 +44,8 @@ class SFSGC : public DoutPrefixProvider {
     SFSGC* gc = nullptr;
     ceph::mutex lock = ceph::make_mutex("GCWorker");
     ceph::condition_variable cond;
+    // journal entries were queued, under lock
+    bool wakeup = false;
 
     std::string get_cls_name() const { return "GCWorker"; }
 
@@ -45,6 +54,7 @@ class SFSGC : public DoutPrefixProvider {
 
     void* entry() override;
     void stop();
+    void wake();
   };
 
   std::unique_ptr<GCWorker> worker = nullptr;
@@ -53,7 +63,18 @@ class SFSGC : public DoutPrefixProvider {
   SFSGC(CephContext*, SFStore*);
   ~SFSGC();
 
+  /// Full scan for deleted buckets, versions and finished multipart
+  /// uploads. Clears the journal on completion.
   int process();
+  /// Reclaim what the journal points at. Returns false if it ran out of
+  /// time before the journal was empty.
+  bool process_journal();
+  /// Queue reclaim work for `ref` in the journal and wake the worker.
+  /// The full scan picks up the work if this fails.
+  void enqueue(sqlite::GCJournalKind kind, const std::string& ref);
+  void enqueue(
+      sqlite::GCJournalKind kind, const std::vector<std::string>& refs
+  );
 
   bool going_down();
   void initialize();
@@ -69,6 +90,8 @@ class SFSGC : public DoutPrefixProvider {
   std::string get_cls_name() const { return "SFSGC"; }
 
  private:
+  // Runs the GC steps in order, returning the step that ran out of time
+  sfs_gc_process_exit_state process_steps();
   // Return false if it was forced to exit because max process time was met
   // which means there are still objects to be deleted
   bool process_deleted_buckets();
@@ -84,6 +107,22 @@ class SFSGC : public DoutPrefixProvider {
   bool process_done_and_aborted_multiparts_batch(bool& all_parts_deleted);
   bool delete_bucket(const std::string& bucket_id, bool& bucket_deleted);
   bool process_time_elapsed() const;
+  bool process_journal_entry(const sqlite::DBGCJournalEntry& entry);
+
+  // Start deleting the data of pending_objects_to_delete, which is left
+  // empty.
+  std::unique_ptr<GCDataDeletion<sqlite::DBDeletedObjectItem>>
+  start_objects_data_deletion();
+  std::unique_ptr<GCDataDeletion<sqlite::DBDeletedMultipartItem>>
+  start_multiparts_data_deletion();
+  // Wait for `deletion`, putting back what it did not delete into
+  // `pending`. Returns true if everything was deleted.
+  template <typename Item>
+  bool finish_data_deletion(
+      std::unique_ptr<GCDataDeletion<Item>> deletion,
+      std::optional<std::vector<Item>>& pending
+  );
+  void update_backlog() const;
 
   std::optional<sqlite::DBDeletedObjectItems> pending_objects_to_delete;
   std::optional<sqlite::DBDeletedMultipartItems> pending_multiparts_to_delete;
@@ -13,12 +13,43 @@
  */
 #include "sfs_lc.h"
 
+#include <optional>
 #include <vector>
 
+#include "rgw/driver/sfs/multipart_state.h"
+#include "rgw/driver/sfs/sfs_gc.h"
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/types.h"
+#include "rgw_perf_counters.h"
 #include "sqlite/sqlite_lifecycle.h"
+#include "sqlite/sqlite_multipart.h"
+#include "sqlite/sqlite_versioned_objects.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
 
 namespace rgw::sal::sfs {
 
+namespace {
+
+/// Whether expire_bucket() can carry out `op` on its own.
+bool is_native_op(const lc_op& op) {
+  return op.transitions.empty() && op.noncur_transitions.empty() &&
+         op.rule_flags == 0;
+}
+
+// tag filter of op, matched against the object_tags index
+sqlite::DBObjectTagSet tag_filter(const lc_op& op) {
+  sqlite::DBObjectTagSet tags;
+  if (op.obj_tags) {
+    for (const auto& [key, value] : op.obj_tags->get_tags()) {
+      tags.emplace_back(key, value);
+    }
+  }
+  return tags;
+}
+
+}  // namespace
+
 SFSLifecycle::SFSLifecycle(SFStore* _st) : store(_st) {}
 
 int SFSLifecycle::get_entry(
@@ -114,4 +145,212 @@ std::unique_ptr<LCSerializer> SFSLifecycle::get_serializer(
   );
 }
 
+int SFSLifecycle::expire_bucket(
+    const DoutPrefixProvider* dpp, Bucket* bucket,
+    RGWLifecycleConfiguration& config, const std::function<bool()>& should_stop
+) {
+  CephContext* cct = store->ceph_context();
+  if (!cct->_conf.get_val<bool>("rgw_sfs_lc_native")) {
+    return -ENOTSUP;
+  }
+  if (bucket->get_info().obj_lock_enabled()) {
+    lsfs_debug(dpp) << fmt::format(
+                           "bucket {} has object lock, expiring per object",
+                           bucket->get_name()
+                       )
+                    << dendl;
+    return -ENOTSUP;
+  }
+  auto& prefix_map = config.get_prefix_map();
+  for (const auto& [prefix, op] : prefix_map) {
+    if (op.status && !is_native_op(op)) {
+      lsfs_debug(dpp) << fmt::format(
+                             "rule {} of bucket {} needs per object "
+                             "processing",
+                             op.id, bucket->get_name()
+                         )
+                      << dendl;
+      return -ENOTSUP;
+    }
+  }
+
+  const std::string bucket_id = bucket->get_bucket_id();
+  const bool versioned = bucket->versioned();
+  const auto& db_versions = store->metadata->versioned_objects();
+  uint current = 0;
+  uint noncurrent = 0;
+  uint delete_markers = 0;
+  uint multiparts = 0;
+  try {
+    for (const auto& rule : prefix_map) {
+      const std::string& prefix = rule.first;
+      const lc_op& op = rule.second;
+      if (!op.status) {
+        continue;
+      }
+      const auto tags = tag_filter(op);
+      std::optional<ceph::real_time> current_cutoff;
+      if (op.expiration > 0) {
+        current_cutoff = expiration_cutoff(op.expiration);
+      } else if (op.expiration_date &&
+                 ceph::real_clock::now() >= *op.expiration_date) {
+        current_cutoff = ceph::real_clock::now();
+      }
+      bool done = true;
+      if (current_cutoff && versioned) {
+        done = expire_batches(
+            [&](uint after, uint max) {
+              return db_versions.add_delete_markers_to_expired_transact(
+                  bucket_id, prefix, *current_cutoff, after, max,
+                  [cct]() { return generate_new_version_id(cct); }, tags
+              );
+            },
+            false, l_rgw_lc_expire_current, current, should_stop
+        );
+      } else if (current_cutoff) {
+        done = expire_batches(
+            [&](uint after, uint max) {
+              return db_versions.expire_current_versions_transact(
+                  bucket_id, prefix, *current_cutoff, after, max, tags
+              );
+            },
+            true, l_rgw_lc_expire_current, current, should_stop
+        );
+      }
+      // like RGWLC, a current expiration also removes delete markers
+      // with nothing left behind them. Delete markers carry no tags, so
+      // a tag filter never matches them.
+      if (done && tags.empty() && (op.dm_expiration || current_cutoff)) {
+        done = expire_batches(
+            [&](uint after, uint max) {
+              return db_versions.expire_lone_delete_markers_transact(
+                  bucket_id, prefix, after, max
+              );
+            },
+            true, l_rgw_lc_expire_dm, delete_markers, should_stop
+        );
+      }
+      if (done && op.noncur_expiration > 0) {
+        const auto cutoff = expiration_cutoff(op.noncur_expiration);
+        done = expire_batches(
+            [&](uint after, uint max) {
+              return db_versions.expire_noncurrent_versions_transact(
+                  bucket_id, prefix, cutoff, after, max, tags
+              );
+            },
+            true, l_rgw_lc_expire_noncurrent, noncurrent, should_stop
+        );
+      }
+      if (done && op.mp_expiration > 0) {
+        done = abort_multiparts(
+            bucket_id, prefix, op.mp_expiration, multiparts, should_stop
+        );
+      }
+      if (!done) {
+        lsfs_info(dpp) << fmt::format(
+                              "lifecycle budget expired for bucket {}",
+                              bucket->get_name()
+                          )
+                       << dendl;
+        break;
+      }
+    }
+  } catch (const std::system_error& e) {
+    lsfs_err(dpp) << fmt::format(
+                         "failed to expire objects in bucket {}: {}",
+                         bucket->get_name(), e.what()
+                     )
+                  << dendl;
+    return -EIO;
+  }
+
+  lsfs_info(dpp) << fmt::format(
+                        "bucket {}: expired {} current and {} noncurrent "
+                        "versions, {} delete markers, aborted {} multipart "
+                        "uploads",
+                        bucket->get_name(), current, noncurrent,
+                        delete_markers, multiparts
+                    )
+                 << dendl;
+  return 0;
+}
+
+bool SFSLifecycle::expire_batches(
+    const ExpireBatch& batch, bool reclaim, int counter, uint& count,
+    const std::function<bool()>& should_stop
+) {
+  const uint max = store->ceph_context()->_conf.get_val<uint64_t>(
+      "rgw_sfs_lc_expiration_batch_size"
+  );
+  uint after = 0;
+  for (;;) {
+    const auto items = batch(after, max);
+    if (!items.empty()) {
+      after = items.back().first;
+      count += items.size();
+      if (perfcounter) {
+        perfcounter->inc(counter, items.size());
+      }
+      if (reclaim) {
+        std::vector<std::string> uuids;
+        uuids.reserve(items.size());
+        for (const auto& item : items) {
+          uuids.emplace_back(item.second.to_string());
+        }
+        store->gc->enqueue(sqlite::GCJournalKind::OBJECT, uuids);
+      }
+    }
+    if (items.size() < max) {
+      return true;
+    }
+    if (should_stop()) {
+      return false;
+    }
+  }
+}
+
+bool SFSLifecycle::abort_multiparts(
+    const std::string& bucket_id, const std::string& prefix, int days,
+    uint& count, const std::function<bool()>& should_stop
+) {
+  const uint max = store->ceph_context()->_conf.get_val<uint64_t>(
+      "rgw_sfs_lc_expiration_batch_size"
+  );
+  const auto cutoff = expiration_cutoff(days);
+  const auto& db_multipart = store->metadata->multipart();
+  for (;;) {
+    const auto upload_ids =
+        db_multipart.abort_multiparts_initiated_before_transact(
+            bucket_id, prefix, cutoff, max
+        );
+    for (const auto& upload_id : upload_ids) {
+      store->multipart_states->set_state(upload_id, MultipartState::ABORTED);
+    }
+    store->gc->enqueue(sqlite::GCJournalKind::MULTIPART, upload_ids);
+    count += upload_ids.size();
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_abort_mpu, upload_ids.size());
+    }
+    if (upload_ids.size() < max) {
+      return true;
+    }
+    if (should_stop()) {
+      return false;
+    }
+  }
+}
+
+ceph::real_time SFSLifecycle::expiration_cutoff(int days) const {
+  const auto debug_interval =
+      store->ceph_context()->_conf->rgw_lc_debug_interval;
+  utime_t base_time = ceph_clock_now();
+  double day_seconds = 24 * 60 * 60;
+  if (debug_interval <= 0) {
+    base_time = base_time.round_to_day();
+  } else {
+    day_seconds = debug_interval;
+  }
+  return base_time.to_real_time() - make_timespan(days * day_seconds);
+}
+
 }  // namespace rgw::sal::sfs
@@ -14,11 +14,13 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <mutex>
 
 #include "rgw_lc.h"
 #include "rgw_sal.h"
 #include "rgw_sal_sfs.h"
+#include "rgw/driver/sfs/sqlite/versioned_object/versioned_object_definitions.h"
 
 namespace rgw::sal::sfs {
 
@@ -49,6 +51,8 @@ class SFSLifecycle : public StoreLifecycle {
  public:
   SFSLifecycle(SFStore* _st);
 
+  std::string get_cls_name() const { return "lifecycle"; }
+
   using StoreLifecycle::get_entry;
   virtual int get_entry(
       const std::string& oid, const std::string& marker,
@@ -71,6 +75,35 @@ class SFSLifecycle : public StoreLifecycle {
       const std::string& lock_name, const std::string& oid,
       const std::string& cookie
   ) override;
+  /// Expire with batched updates on the metadata database. Tag filters
+  /// are matched against the object_tags index. Rules with transitions,
+  /// and buckets with object lock, are left to the generic per-object
+  /// processing.
+  virtual int expire_bucket(
+      const DoutPrefixProvider* dpp, Bucket* bucket,
+      RGWLifecycleConfiguration& config,
+      const std::function<bool()>& should_stop
+  ) override;
+
+ private:
+  using ExpireBatch =
+      std::function<sqlite::DBExpiredVersionItems(uint after, uint max)>;
+
+  /// Run `batch` until it runs dry. Returns false if `should_stop` cut it
+  /// short. The objects of changed versions are queued for the garbage
+  /// collector if `reclaim` is set.
+  bool expire_batches(
+      const ExpireBatch& batch, bool reclaim, int counter, uint& count,
+      const std::function<bool()>& should_stop
+  );
+  /// Abort multipart uploads of `rule` initiated more than `days` ago.
+  bool abort_multiparts(
+      const std::string& bucket_id, const std::string& prefix, int days,
+      uint& count, const std::function<bool()>& should_stop
+  );
+  /// Versions last modified at or before the returned time are `days` old
+  /// in the sense of RGWLC, honouring rgw_lc_debug_interval.
+  ceph::real_time expiration_cutoff(int days) const;
 };
 
 }  // namespace rgw::sal::sfs
@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/sfs_metadata.h"
+
+#include <string>
+
+#include "rgw/driver/sfs/kv_metadata.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_list.h"
+#include "rgw/driver/sfs/sqlite/sqlite_multipart.h"
+#include "rgw/driver/sfs/sqlite/sqlite_objects.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+
+namespace rgw::sal::sfs {
+
+// directory of the rocksdb metadata backend in the data path
+static const std::string METADATA_DB_DIRNAME = "metadata.rocksdb";
+
+namespace {
+
+/// The SQLite classes over the metadata database connection
+class SQLiteMetadata : public MetadataBackend {
+  sqlite::SQLiteUsers users_db;
+  sqlite::SQLiteBuckets buckets_db;
+  sqlite::SQLiteObjects objects_db;
+  sqlite::SQLiteVersionedObjects versioned_objects_db;
+  sqlite::SQLiteList list_db;
+  sqlite::SQLiteMultipart multipart_db;
+
+ public:
+  explicit SQLiteMetadata(sqlite::DBConnRef conn)
+      : users_db(conn),
+        buckets_db(conn),
+        objects_db(conn),
+        versioned_objects_db(conn),
+        list_db(conn),
+        multipart_db(conn) {}
+
+  const UsersBackend& users() const override { return users_db; }
+  const BucketsBackend& buckets() const override { return buckets_db; }
+  const ObjectsBackend& objects() const override { return objects_db; }
+  const VersionedObjectsBackend& versioned_objects() const override {
+    return versioned_objects_db;
+  }
+  const ListBackend& list() const override { return list_db; }
+  const MultipartBackend& multipart() const override { return multipart_db; }
+
+  bool in_sqlite() const override { return true; }
+};
+
+}  // namespace
+
+std::unique_ptr<MetadataBackend> make_metadata_backend(
+    CephContext* cct, sqlite::DBConnRef conn,
+    const std::filesystem::path& data_path
+) {
+  if (!metadata_in_sqlite(cct)) {
+    return KVMetadata::open(cct, data_path / METADATA_DB_DIRNAME);
+  }
+  return std::make_unique<SQLiteMetadata>(conn);
+}
+
+bool metadata_in_sqlite(CephContext* cct) {
+  return cct->_conf.get_val<std::string>("rgw_sfs_metadata_backend") !=
+         "rocksdb";
+}
+
+}  // namespace rgw::sal::sfs
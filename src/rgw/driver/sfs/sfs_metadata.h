@@ -0,0 +1,36 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/metadata_backend.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+
+namespace rgw::sal::sfs {
+
+/// The metadata backend set by rgw_sfs_metadata_backend. The rocksdb
+/// one lives in data_path. Throws std::system_error if it can't be
+/// opened.
+std::unique_ptr<MetadataBackend> make_metadata_backend(
+    CephContext* cct, sqlite::DBConnRef conn,
+    const std::filesystem::path& data_path
+);
+
+/// True if rgw_sfs_metadata_backend keeps the metadata in SQLite
+bool metadata_in_sqlite(CephContext* cct);
+
+}  // namespace rgw::sal::sfs
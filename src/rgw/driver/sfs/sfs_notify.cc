@@ -0,0 +1,266 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/sfs_notify.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <boost/asio/io_context.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+#include <spawn/spawn.hpp>
+#include <vector>
+
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sqlite/sqlite_notifications.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw_common.h"
+#include "rgw_pubsub.h"
+#include "rgw_sal_sfs.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal::sfs {
+
+// how long the worker sleeps when nothing is queued, in case a wakeup
+// was missed
+static constexpr std::chrono::seconds NOTIFY_IDLE_INTERVAL{10};
+// upper bound on cached endpoints, the cache is dropped when exceeded
+static constexpr size_t NOTIFY_MAX_ENDPOINTS = 64;
+// retry delays double up to this many times
+static constexpr uint NOTIFY_MAX_BACKOFF_SHIFT = 10;
+
+SFSNotificationSender::SFSNotificationSender(
+    CephContext* _cct, SFStore* _store
+)
+    : cct(_cct),
+      store(_store),
+      batch_size(std::max<uint64_t>(
+          1, cct->_conf.get_val<uint64_t>("rgw_sfs_notification_batch_size")
+      )),
+      max_attempts(std::max<uint64_t>(
+          1, cct->_conf.get_val<uint64_t>("rgw_sfs_notification_max_attempts")
+      )),
+      retry_interval(cct->_conf.get_val<std::chrono::milliseconds>(
+          "rgw_sfs_notification_retry_interval"
+      )),
+      timeout(cct->_conf.get_val<std::chrono::milliseconds>(
+          "rgw_sfs_notification_timeout"
+      )) {}
+
+SFSNotificationSender::~SFSNotificationSender() {
+  {
+    std::lock_guard l{lock};
+    down_flag = true;
+    cond.notify_all();
+  }
+  if (worker && worker->is_started()) {
+    worker->join();
+  }
+}
+
+/*
+ * Like SFSScrubber, the worker is only started once the store is fully
+ * constructed, since the sender is its prefix provider for logging.
+ */
+void SFSNotificationSender::initialize() {
+  worker = std::make_unique<Worker>(this);
+  worker->create("rgw_sfs_notify");
+}
+
+void SFSNotificationSender::wake() {
+  std::lock_guard l{lock};
+  wakeup = true;
+  cond.notify_all();
+}
+
+bool SFSNotificationSender::wait_for(std::chrono::milliseconds duration) {
+  std::unique_lock locker{lock};
+  cond.wait_for(locker, duration, [this] { return wakeup || going_down(); });
+  wakeup = false;
+  return !going_down();
+}
+
+std::shared_ptr<RGWPubSubEndpoint> SFSNotificationSender::get_endpoint(
+    const sqlite::DBNotificationEvent& event
+) {
+  const auto key = fmt::format(
+      "{}\n{}\n{}", event.push_endpoint, event.push_endpoint_args,
+      event.arn_topic
+  );
+  auto it = endpoints.find(key);
+  if (it == endpoints.end()) {
+    if (endpoints.size() >= NOTIFY_MAX_ENDPOINTS) {
+      endpoints.clear();
+    }
+    auto endpoint = RGWPubSubEndpoint::create(
+        event.push_endpoint, event.arn_topic,
+        RGWHTTPArgs(event.push_endpoint_args, this), cct
+    );
+    it = endpoints.emplace(key, std::move(endpoint)).first;
+  }
+  return it->second;
+}
+
+bool SFSNotificationSender::send(
+    const sqlite::DBNotificationEvent& event, optional_yield y
+) {
+  rgw_pubsub_s3_event s3_event;
+  try {
+    bufferlist bl;
+    bl.append(event.event.data(), event.event.size());
+    auto bl_iter = bl.cbegin();
+    decode(s3_event, bl_iter);
+  } catch (const ceph::buffer::error& e) {
+    lsfs_err(this) << fmt::format(
+                          "dropping undecodable notification event {}: {}",
+                          event.id, e.what()
+                      )
+                   << dendl;
+    return true;
+  }
+  try {
+    const auto endpoint = get_endpoint(event);
+    const int ret = endpoint->send_to_completion_async(cct, s3_event, y);
+    if (ret < 0) {
+      lsfs_debug(this) << fmt::format(
+                              "push of event {} to {} failed: {}", event.id,
+                              event.push_endpoint, ret
+                          )
+                       << dendl;
+      if (perfcounter) {
+        perfcounter->inc(l_rgw_pubsub_push_failed);
+      }
+      return false;
+    }
+  } catch (const RGWPubSubEndpoint::configuration_error& e) {
+    lsfs_err(this) << fmt::format(
+                          "dropping notification event {} for {}: {}",
+                          event.id, event.push_endpoint, e.what()
+                      )
+                   << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_pubsub_push_failed);
+    }
+    return true;
+  }
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_pubsub_push_ok);
+  }
+  return true;
+}
+
+size_t SFSNotificationSender::send_batch() {
+  sqlite::SQLiteNotifications db_notifications(store->db_conn);
+  const auto now = ceph::real_clock::now();
+  const auto events = db_notifications.get_due_events(now, batch_size);
+  // events by endpoint, in queue order
+  std::map<std::string, std::vector<const sqlite::DBNotificationEvent*>>
+      queues;
+  for (const auto& event : events) {
+    queues[event.push_endpoint].push_back(&event);
+  }
+
+  std::vector<int64_t> done;
+  // failed events by the number of attempts made, which sets the delay
+  std::map<uint, std::vector<int64_t>> retries;
+  // not tried before the deadline
+  std::vector<int64_t> postponed;
+  const auto deadline = ceph::mono_clock::now() + timeout;
+  // the coroutines all run on this thread, no locking needed
+  boost::asio::io_context io_context;
+  for (const auto& [endpoint, queue] : queues) {
+    spawn::spawn(
+        io_context,
+        [&, &queue = queue](yield_context yield) {
+          for (const auto* event : queue) {
+            if (going_down()) {
+              return;
+            }
+            if (ceph::mono_clock::now() >= deadline) {
+              postponed.push_back(event->id);
+              continue;
+            }
+            if (send(*event, optional_yield(io_context, yield))) {
+              done.push_back(event->id);
+            } else if (event->attempts + 1 >= max_attempts) {
+              lsfs_warn(this)
+                  << fmt::format(
+                         "dropping notification event {} for {} after {} "
+                         "attempts",
+                         event->id, event->push_endpoint, max_attempts
+                     )
+                  << dendl;
+              if (perfcounter) {
+                perfcounter->inc(l_rgw_pubsub_event_lost);
+              }
+              done.push_back(event->id);
+            } else {
+              retries[event->attempts].push_back(event->id);
+            }
+          }
+        },
+        boost::context::protected_fixedsize_stack{128 * 1024}
+    );
+  }
+  io_context.run();
+
+  db_notifications.remove_events(done);
+  for (const auto& [attempts, ids] : retries) {
+    const auto delay =
+        retry_interval * (1U << std::min(attempts, NOTIFY_MAX_BACKOFF_SHIFT));
+    db_notifications.reschedule_events(
+        ids, ceph::real_clock::now() +
+                 std::chrono::duration_cast<ceph::timespan>(delay)
+    );
+  }
+  if (!postponed.empty()) {
+    lsfs_debug(this) << fmt::format(
+                            "postponing {} notification events after {}ms",
+                            postponed.size(), timeout.count()
+                        )
+                     << dendl;
+    db_notifications.postpone_events(
+        postponed,
+        ceph::real_clock::now() +
+            std::chrono::duration_cast<ceph::timespan>(retry_interval)
+    );
+  }
+  return events.size();
+}
+
+std::ostream& SFSNotificationSender::gen_prefix(std::ostream& out) const {
+  return out << "notify: ";
+}
+
+void* SFSNotificationSender::Worker::entry() {
+  while (!sender->going_down()) {
+    size_t sent = 0;
+    try {
+      sent = sender->send_batch();
+    } catch (const std::system_error& e) {
+      lsfs_err_for(sender, "SFSNotificationSender")
+          << fmt::format("sending notifications failed: {}", e.what())
+          << dendl;
+    }
+    if (sent < sender->batch_size &&
+        !sender->wait_for(std::min<std::chrono::milliseconds>(
+            sender->retry_interval, NOTIFY_IDLE_INTERVAL
+        ))) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,105 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "common/Thread.h"
+#include "common/async/yield_context.h"
+#include "common/ceph_mutex.h"
+#include "rgw/driver/rados/rgw_pubsub_push.h"
+#include "rgw/driver/sfs/sqlite/notifications/notification_definitions.h"
+#include "rgw_sal.h"
+
+namespace rgw::sal {
+class SFStore;
+}
+
+namespace rgw::sal::sfs {
+
+/// SFSNotificationSender delivers the bucket notification events that
+/// SFSNotification::publish_commit() queues in the database. It takes
+/// due events in batches, oldest first, and pushes them to their
+/// endpoints. Endpoints are served concurrently, the events of one
+/// endpoint in order, so a slow endpoint does not hold up the others.
+/// Delivered events are removed together. Failed deliveries are retried
+/// with exponential backoff until rgw_sfs_notification_max_attempts,
+/// then dropped. The queue survives restarts.
+class SFSNotificationSender : public DoutPrefixProvider {
+  CephContext* cct;
+  SFStore* store;
+  std::atomic<bool> down_flag = {false};
+
+  const uint batch_size;
+  const uint max_attempts;
+  const std::chrono::milliseconds retry_interval;
+  const std::chrono::milliseconds timeout;
+
+  ceph::mutex lock = ceph::make_mutex("SFSNotificationSender");
+  ceph::condition_variable cond;
+  // events were queued, under lock
+  bool wakeup = false;
+
+  // endpoints are kept across batches, only used by the worker. Shared
+  // with the deliveries in progress, which outlive a cache flush.
+  std::map<std::string, std::shared_ptr<RGWPubSubEndpoint>> endpoints;
+
+  class Worker : public Thread {
+    SFSNotificationSender* sender = nullptr;
+
+   public:
+    explicit Worker(SFSNotificationSender* _sender) : sender(_sender) {}
+    void* entry() override;
+  };
+  std::unique_ptr<Worker> worker;
+
+  bool going_down() const { return down_flag; }
+  /// Sleep until woken, duration passed or shutdown. Returns false on
+  /// shutdown.
+  bool wait_for(std::chrono::milliseconds duration);
+  /// Endpoint of event, created on first use. Throws
+  /// RGWPubSubEndpoint::configuration_error.
+  std::shared_ptr<RGWPubSubEndpoint> get_endpoint(
+      const sqlite::DBNotificationEvent& event
+  );
+  /// Deliver event. Returns false if it should be retried.
+  bool send(const sqlite::DBNotificationEvent& event, optional_yield y);
+
+ public:
+  SFSNotificationSender(CephContext* _cct, SFStore* _store);
+  ~SFSNotificationSender();
+
+  /// Start the worker.
+  void initialize();
+  /// Have the worker look for new events now.
+  void wake();
+
+  /// Deliver the next batch of due events. No new push is started after
+  /// rgw_sfs_notification_timeout; the events not tried by then are
+  /// postponed without counting an attempt. Returns the number of events
+  /// taken from the queue, delivered or not.
+  size_t send_batch();
+
+  CephContext* get_cct() const override { return cct; }
+  unsigned get_subsys() const override { return ceph_subsys_rgw_sfs; }
+  std::ostream& gen_prefix(std::ostream& out) const override;
+
+  std::string get_cls_name() const { return "SFSNotificationSender"; }
+};
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/sfs_rest_prefix_stats.h"
+
+#include <fmt/format.h>
+
+#include "rgw_sal_sfs.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal::sfs {
+
+void dump_prefix_usage(
+    ceph::Formatter* f, const std::string& bucket_name,
+    const sqlite::SQLitePrefixStats::Usage& usage
+) {
+  f->open_object_section("prefix_stats");
+  f->dump_string("bucket", bucket_name);
+  f->dump_string("prefix", usage.prefix);
+  f->dump_unsigned("objects", usage.obj_count);
+  f->dump_unsigned("size", usage.size);
+  f->open_array_section("children");
+  for (const auto& child : usage.children) {
+    f->open_object_section("child");
+    f->dump_string("prefix", child.prefix);
+    f->dump_unsigned("objects", child.obj_count);
+    f->dump_unsigned("size", child.size);
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+}
+
+}  // namespace rgw::sal::sfs
+
+class RGWOp_SFS_PrefixStats_Get : public RGWRESTOp {
+ public:
+  RGWOp_SFS_PrefixStats_Get() {}
+
+  int check_caps(const RGWUserCaps& caps) override {
+    return caps.check_cap("buckets", RGW_CAP_READ);
+  }
+  void execute(optional_yield y) override;
+
+  const char* name() const override { return "get_prefix_stats"; }
+};
+
+void RGWOp_SFS_PrefixStats_Get::execute(optional_yield /*y*/) {
+  std::string bucket_name;
+  std::string prefix;
+  RESTArgs::get_string(s, "bucket", bucket_name, &bucket_name);
+  RESTArgs::get_string(s, "prefix", prefix, &prefix);
+
+  // only registered by SFStore
+  auto sfs = static_cast<rgw::sal::SFStore*>(driver);
+  if (sfs->db_conn->prefix_stats_depth == 0) {
+    s->err.message =
+        "prefix stats are disabled, see rgw_sfs_prefix_stats_depth";
+    op_ret = -ERR_NOT_IMPLEMENTED;
+    return;
+  }
+  const auto bucket = sfs->get_bucket_ref(bucket_name);
+  if (!bucket) {
+    op_ret = -ERR_NO_SUCH_BUCKET;
+    return;
+  }
+  rgw::sal::sfs::sqlite::SQLitePrefixStats prefix_stats(sfs->db_conn);
+  const auto usage = prefix_stats.get_usage(bucket->get_bucket_id(), prefix);
+  if (!usage.has_value()) {
+    s->err.message = fmt::format(
+        "prefix must be empty or end with '{}' and be at most {} levels deep",
+        sfs->db_conn->prefix_stats_delimiter, sfs->db_conn->prefix_stats_depth
+    );
+    op_ret = -EINVAL;
+    return;
+  }
+
+  flusher.start(0);
+  rgw::sal::sfs::dump_prefix_usage(s->formatter, bucket_name, *usage);
+  flusher.flush();
+}
+
+RGWOp* RGWHandler_SFS_PrefixStats::op_get() {
+  return new RGWOp_SFS_PrefixStats_Get;
+}
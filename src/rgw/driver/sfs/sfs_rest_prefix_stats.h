@@ -0,0 +1,57 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <string>
+
+#include "common/Formatter.h"
+#include "rgw/driver/sfs/sqlite/sqlite_prefix_stats.h"
+#include "rgw_rest.h"
+#include "rgw_rest_s3.h"
+
+namespace rgw::sal::sfs {
+
+/// Dump the usage of a bucket prefix and its child prefixes
+void dump_prefix_usage(
+    ceph::Formatter* f, const std::string& bucket_name,
+    const sqlite::SQLitePrefixStats::Usage& usage
+);
+
+}  // namespace rgw::sal::sfs
+
+/// Admin API for prefix stats, needs the buckets=read cap:
+/// GET /admin/prefix-stats?bucket=<name>&prefix=<prefix>
+class RGWHandler_SFS_PrefixStats : public RGWHandler_Auth_S3 {
+ protected:
+  RGWOp* op_get() override;
+
+ public:
+  using RGWHandler_Auth_S3::RGWHandler_Auth_S3;
+  ~RGWHandler_SFS_PrefixStats() override = default;
+
+  int read_permissions(RGWOp*, optional_yield) override { return 0; }
+};
+
+class RGWRESTMgr_SFS_PrefixStats : public RGWRESTMgr {
+ public:
+  RGWRESTMgr_SFS_PrefixStats() = default;
+  ~RGWRESTMgr_SFS_PrefixStats() override = default;
+
+  RGWHandler_REST* get_handler(
+      rgw::sal::Driver*, req_state*,
+      const rgw::auth::StrategyRegistry& auth_registry, const std::string&
+  ) override {
+    return new RGWHandler_SFS_PrefixStats(auth_registry);
+  }
+};
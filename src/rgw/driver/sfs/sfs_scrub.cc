@@ -0,0 +1,372 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/sfs_scrub.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <filesystem>
+
+#include "common/perf_counters.h"
+#include "rgw/driver/sfs/bucket_dirs.h"
+#include "rgw/driver/sfs/checksum.h"
+#include "rgw/driver/sfs/object_data.h"
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sqlite/sqlite_scrub.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/driver/sfs/types.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw_sal_sfs.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal::sfs {
+
+// size of the reads used to verify checksums
+static constexpr uint64_t SCRUB_READ_SIZE = 4_M;
+// number of findings kept for the status page
+static constexpr size_t SCRUB_MAX_FINDINGS = 100;
+static constexpr std::chrono::seconds SCRUB_MIN_BACKOFF{1};
+static constexpr std::chrono::seconds SCRUB_MAX_BACKOFF{60};
+
+SFSScrubber::SFSScrubber(CephContext* _cct, SFStore* _store)
+    : cct(_cct),
+      store(_store),
+      bytes_per_sec(cct->_conf.get_val<Option::size_t>(
+          "rgw_sfs_scrub_bytes_per_sec"
+      )),
+      max_request_latency(cct->_conf.get_val<std::chrono::milliseconds>(
+          "rgw_sfs_scrub_max_request_latency"
+      )),
+      window_start(ceph::mono_clock::now()),
+      last_latency_sample(ceph::mono_clock::now()) {
+  const sqlite::SQLiteScrub db_scrub(store->db_conn);
+  const auto state = db_scrub.get_state();
+  status.last_version_id = state.last_version_id;
+  status.last_pass_end = state.last_pass_end;
+}
+
+SFSScrubber::~SFSScrubber() {
+  {
+    std::lock_guard l{lock};
+    down_flag = true;
+    cond.notify_all();
+  }
+  if (worker && worker->is_started()) {
+    worker->join();
+  }
+}
+
+/*
+ * As with SFSGC, the worker is only started once the store is fully
+ * constructed, since the scrubber is its prefix provider for logging.
+ */
+void SFSScrubber::initialize() {
+  const auto period =
+      cct->_conf.get_val<std::chrono::seconds>("rgw_sfs_scrub_period");
+  if (period.count() == 0) {
+    lsfs_info(this) << "scrubbing disabled" << dendl;
+    return;
+  }
+  worker = std::make_unique<Worker>(this);
+  worker->create("rgw_scrub");
+}
+
+bool SFSScrubber::wait_for(std::chrono::milliseconds duration) {
+  std::unique_lock locker{lock};
+  cond.wait_for(locker, duration, [this] { return going_down(); });
+  return !going_down();
+}
+
+void SFSScrubber::pace(uint64_t bytes) {
+  if (bytes_per_sec == 0) {
+    return;
+  }
+  window_bytes += bytes;
+  const auto elapsed = ceph::mono_clock::now() - window_start;
+  const auto budgeted = std::chrono::duration_cast<ceph::timespan>(
+      std::chrono::duration<double>(
+          static_cast<double>(window_bytes) / static_cast<double>(bytes_per_sec)
+      )
+  );
+  if (budgeted > elapsed) {
+    wait_for(std::chrono::duration_cast<std::chrono::milliseconds>(
+        budgeted - elapsed
+    ));
+  }
+  // start a new window every few seconds so that idle time is not
+  // banked for later bursts
+  if (ceph::mono_clock::now() - window_start > std::chrono::seconds(5)) {
+    window_start = ceph::mono_clock::now();
+    window_bytes = 0;
+  }
+}
+
+std::chrono::milliseconds SFSScrubber::foreground_latency() {
+  if (perfcounter == nullptr) {
+    return std::chrono::milliseconds(0);
+  }
+  const auto now = ceph::mono_clock::now();
+  if (now - last_latency_sample < std::chrono::seconds(1)) {
+    return last_latency;
+  }
+  last_latency_sample = now;
+
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+  for (const auto idx : {l_rgw_get_lat, l_rgw_put_lat}) {
+    const auto [c, s] = perfcounter->get_tavg_ns(idx);
+    count += c;
+    sum_ns += s;
+  }
+  const auto delta_count = count - last_latency_count;
+  const auto delta_sum_ns = sum_ns - last_latency_sum_ns;
+  last_latency_count = count;
+  last_latency_sum_ns = sum_ns;
+  last_latency = delta_count == 0
+                     ? std::chrono::milliseconds(0)
+                     : std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::nanoseconds(delta_sum_ns / delta_count)
+                       );
+  return last_latency;
+}
+
+bool SFSScrubber::back_off() {
+  if (max_request_latency.count() == 0) {
+    return !going_down();
+  }
+  std::chrono::milliseconds backoff = SCRUB_MIN_BACKOFF;
+  while (!going_down()) {
+    const auto latency = foreground_latency();
+    if (latency <= max_request_latency) {
+      break;
+    }
+    lsfs_debug(this) << fmt::format(
+                            "request latency {}ms over {}ms, pausing for {}ms",
+                            latency.count(), max_request_latency.count(),
+                            backoff.count()
+                        )
+                     << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_sfs_scrub_backoffs);
+    }
+    if (!wait_for(backoff)) {
+      break;
+    }
+    backoff =
+        std::min<std::chrono::milliseconds>(backoff * 2, SCRUB_MAX_BACKOFF);
+  }
+  return !going_down();
+}
+
+SFSScrubber::Result SFSScrubber::scrub_version(
+    const sqlite::DBVersionedObject& version
+) {
+  std::unique_ptr<Object> obj(Object::create_from_db_version("", version));
+  obj->data_root = store->bucket_dirs->object_data_root(version.object_id);
+  const auto objdata = ObjectData::load(store, *obj);
+  if (!objdata.has_value()) {
+    return Result::MISSING;
+  }
+
+  uint64_t on_disk = 0;
+  for (const auto& segment : objdata->get_segments()) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(segment.path, ec);
+    if (ec) {
+      return Result::MISSING;
+    }
+    if (size != segment.size) {
+      return Result::SIZE_MISMATCH;
+    }
+    on_disk += size;
+  }
+  if (on_disk != version.physical_size) {
+    return Result::SIZE_MISMATCH;
+  }
+
+  const auto expected = parse_crc32c(version.checksum);
+  if (!expected.has_value()) {
+    return Result::OK;
+  }
+  Crc32c crc;
+  for (uint64_t ofs = 0; ofs < on_disk; ofs += SCRUB_READ_SIZE) {
+    if (!back_off()) {
+      return Result::OK;
+    }
+    const auto len = std::min(SCRUB_READ_SIZE, on_disk - ofs);
+    bufferlist bl;
+    std::string error;
+    if (objdata->read(ofs, len, bl, &error) < 0) {
+      lsfs_debug(this) << fmt::format(
+                              "reading version {} failed: {}", version.id, error
+                          )
+                       << dendl;
+      return Result::MISSING;
+    }
+    crc.update(bl);
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_sfs_scrub_bytes, bl.length());
+    }
+    pace(bl.length());
+  }
+  return crc.value() == *expected ? Result::OK : Result::CHECKSUM_MISMATCH;
+}
+
+void SFSScrubber::report(
+    const sqlite::DBVersionedObject& version, Result result
+) {
+  std::unique_ptr<Object> obj(Object::create_from_db_version("", version));
+  obj->data_root = store->bucket_dirs->object_data_root(version.object_id);
+  const auto path = store->get_data_path() / obj->get_storage_path();
+  lsfs_err(this) << fmt::format(
+                        "version {} (object {}, version_id '{}', {}): ",
+                        version.id, version.object_id.to_string(),
+                        version.version_id, path.string()
+                    )
+                 << result << dendl;
+  if (perfcounter) {
+    switch (result) {
+      case Result::MISSING:
+        perfcounter->inc(l_rgw_sfs_scrub_missing);
+        break;
+      case Result::SIZE_MISMATCH:
+        perfcounter->inc(l_rgw_sfs_scrub_size_mismatch);
+        break;
+      case Result::CHECKSUM_MISMATCH:
+        perfcounter->inc(l_rgw_sfs_scrub_checksum_mismatch);
+        break;
+      default:
+        break;
+    }
+  }
+  std::lock_guard l{lock};
+  status.findings.push_back(
+      Finding{version.id, path.string(), result, ceph::real_clock::now()}
+  );
+  while (status.findings.size() > SCRUB_MAX_FINDINGS) {
+    status.findings.pop_front();
+  }
+}
+
+bool SFSScrubber::scrub_batch() {
+  const sqlite::SQLiteScrub db_scrub(store->db_conn);
+  const auto& db_versions = store->metadata->versioned_objects();
+  auto state = db_scrub.get_state();
+  const auto batch_size =
+      cct->_conf.get_val<uint64_t>("rgw_sfs_scrub_batch_size");
+
+  const auto versions = db_versions.get_committed_versions_after(
+      state.last_version_id, static_cast<uint>(batch_size)
+  );
+  if (versions.empty()) {
+    lsfs_info(this) << fmt::format(
+                           "pass complete, last version {}",
+                           state.last_version_id
+                       )
+                    << dendl;
+    state.last_version_id = 0;
+    state.last_pass_end = ceph::real_clock::now();
+    db_scrub.store_state(state);
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_sfs_scrub_passes);
+    }
+    std::lock_guard l{lock};
+    status.last_version_id = state.last_version_id;
+    status.last_pass_end = state.last_pass_end;
+    return false;
+  }
+
+  for (const auto& version : versions) {
+    if (!back_off()) {
+      break;
+    }
+    const auto result = scrub_version(version);
+    if (going_down()) {
+      // the version may not have been fully checked
+      break;
+    }
+    if (result != Result::OK) {
+      // the version may have been deleted while we were reading it
+      const auto current = db_versions.get_versioned_object(version.id);
+      if (current.has_value() &&
+          current->object_state == ObjectState::COMMITTED) {
+        report(version, result);
+      }
+    }
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_sfs_scrub_objects);
+    }
+    state.last_version_id = version.id;
+  }
+  db_scrub.store_state(state);
+  std::lock_guard l{lock};
+  status.last_version_id = state.last_version_id;
+  return !going_down();
+}
+
+SFSScrubber::Status SFSScrubber::get_status() const {
+  std::lock_guard l{lock};
+  return status;
+}
+
+std::ostream& SFSScrubber::gen_prefix(std::ostream& out) const {
+  return out << "scrub: ";
+}
+
+void* SFSScrubber::Worker::entry() {
+  const auto period =
+      scrubber->cct->_conf.get_val<std::chrono::seconds>("rgw_sfs_scrub_period"
+      );
+  while (!scrubber->going_down()) {
+    const auto state = scrubber->get_status();
+    if (state.last_version_id == 0) {
+      // no pass in progress, wait for the next one to be due
+      const auto due = state.last_pass_end + period;
+      const auto now = ceph::real_clock::now();
+      const auto until_due =
+          std::chrono::duration_cast<std::chrono::milliseconds>(due - now);
+      if (due > now && !scrubber->wait_for(until_due)) {
+        break;
+      }
+    }
+    try {
+      while (scrubber->scrub_batch()) {
+      }
+    } catch (const std::system_error& e) {
+      lsfs_err_for(scrubber, "SFSScrubber")
+          << fmt::format("scrub pass failed: {}", e.what()) << dendl;
+      // try again later
+      scrubber->wait_for(std::chrono::minutes(1));
+    }
+  }
+  return nullptr;
+}
+
+std::ostream& operator<<(std::ostream& out, SFSScrubber::Result result) {
+  switch (result) {
+    case SFSScrubber::Result::OK:
+      return out << "ok";
+    case SFSScrubber::Result::MISSING:
+      return out << "data missing";
+    case SFSScrubber::Result::SIZE_MISMATCH:
+      return out << "size mismatch";
+    case SFSScrubber::Result::CHECKSUM_MISMATCH:
+      return out << "checksum mismatch";
+    default:
+      return out << "unknown";
+  }
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,128 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "common/Thread.h"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "rgw/driver/sfs/sqlite/versioned_object/versioned_object_definitions.h"
+#include "rgw_sal.h"
+
+namespace rgw::sal {
+class SFStore;
+}
+
+namespace rgw::sal::sfs {
+
+/// SFSScrubber walks committed object versions in the background and
+/// checks that their data exists, has the expected size and matches
+/// the recorded checksum. Problems are counted in perf counters, logged
+/// and listed on the status page.
+///
+/// The position within the current pass is stored in the database
+/// after every batch, so a pass resumes where it stopped after a
+/// restart. Data reads are paced to rgw_sfs_scrub_bytes_per_sec and the
+/// scrubber pauses while foreground GET/PUT latency is above
+/// rgw_sfs_scrub_max_request_latency.
+class SFSScrubber : public DoutPrefixProvider {
+ public:
+  enum class Result { OK, MISSING, SIZE_MISMATCH, CHECKSUM_MISMATCH };
+
+  struct Finding {
+    uint version_id;
+    std::string path;
+    Result result;
+    ceph::real_time when;
+  };
+
+  struct Status {
+    uint last_version_id;
+    ceph::real_time last_pass_end;
+    std::deque<Finding> findings;
+  };
+
+ private:
+  CephContext* cct;
+  SFStore* store;
+  std::atomic<bool> down_flag = {false};
+
+  const uint64_t bytes_per_sec;
+  const std::chrono::milliseconds max_request_latency;
+  // pacing window
+  ceph::mono_time window_start;
+  uint64_t window_bytes{0};
+  // foreground latency sampling
+  ceph::mono_time last_latency_sample;
+  uint64_t last_latency_count{0};
+  uint64_t last_latency_sum_ns{0};
+  std::chrono::milliseconds last_latency{0};
+
+  mutable ceph::mutex lock = ceph::make_mutex("SFSScrubber");
+  ceph::condition_variable cond;
+  // for the status page, under lock
+  Status status;
+
+  class Worker : public Thread {
+    SFSScrubber* scrubber = nullptr;
+
+   public:
+    explicit Worker(SFSScrubber* _scrubber) : scrubber(_scrubber) {}
+    void* entry() override;
+  };
+  std::unique_ptr<Worker> worker;
+
+  bool going_down() const { return down_flag; }
+  /// Sleep for `duration` or until shutdown. Returns false on shutdown.
+  bool wait_for(std::chrono::milliseconds duration);
+  /// Account for `bytes` read, sleeping to stay within bytes_per_sec.
+  void pace(uint64_t bytes);
+  /// Average GET/PUT latency since the previous sample.
+  std::chrono::milliseconds foreground_latency();
+  /// Sleep while foreground latency is too high. Returns false on
+  /// shutdown.
+  bool back_off();
+  void report(const sqlite::DBVersionedObject& version, Result result);
+
+ public:
+  SFSScrubber(CephContext* _cct, SFStore* _store);
+  ~SFSScrubber();
+
+  /// Start the worker, unless scrubbing is disabled.
+  void initialize();
+
+  /// Check the next batch of versions of the current pass, starting a
+  /// new pass if none is in progress. Returns false once the pass is
+  /// complete.
+  bool scrub_batch();
+  /// Check the data of one version.
+  Result scrub_version(const sqlite::DBVersionedObject& version);
+
+  Status get_status() const;
+
+  CephContext* get_cct() const override { return cct; }
+  unsigned get_subsys() const override { return ceph_subsys_rgw_sfs; }
+  std::ostream& gen_prefix(std::ostream& out) const override;
+
+  std::string get_cls_name() const { return "SFSScrubber"; }
+};
+
+std::ostream& operator<<(std::ostream& out, SFSScrubber::Result result);
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,139 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/sfs_usage.h"
+
+#include <fmt/format.h>
+
+#include <string>
+#include <system_error>
+
+#include "rgw/driver/sfs/kv_usage.h"
+#include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sqlite/sqlite_usage.h"
+
+#define dout_subsys ceph_subsys_rgw_sfs
+
+namespace rgw::sal::sfs {
+
+// directory of the rocksdb usage backend in the data path
+static const std::string USAGE_DB_DIRNAME = "usage.rocksdb";
+// read_iter holds the last owner and bucket returned
+static constexpr char USAGE_MARKER_SEPARATOR = '\n';
+
+static UsageBackend::Marker decode_marker(const std::string& marker) {
+  const auto pos = marker.find(USAGE_MARKER_SEPARATOR);
+  if (pos == std::string::npos) {
+    return {};
+  }
+  return {marker.substr(0, pos), marker.substr(pos + 1)};
+}
+
+std::unique_ptr<UsageBackend> make_usage_backend(
+    CephContext* cct, sqlite::DBConnRef conn,
+    const std::filesystem::path& data_path
+) {
+  const auto backend =
+      cct->_conf.get_val<std::string>("rgw_sfs_usage_backend");
+  if (backend == "rocksdb") {
+    return KVUsage::open(cct, data_path / USAGE_DB_DIRNAME);
+  }
+  return std::make_unique<sqlite::SQLiteUsage>(conn);
+}
+
+void log_usage(
+    const UsageBackend& backend,
+    const std::map<rgw_user_bucket, RGWUsageBatch>& usage_info
+) {
+  sqlite::DBUsageList rows;
+  for (const auto& [user_bucket, batch] : usage_info) {
+    for (const auto& [time, entry] : batch.m) {
+      for (const auto& [category, data] : entry.usage_map) {
+        rows.push_back(sqlite::DBUsage{
+            entry.owner.to_str(), entry.bucket,
+            static_cast<int64_t>(entry.epoch), entry.payer.to_str(), category,
+            static_cast<int64_t>(data.bytes_sent),
+            static_cast<int64_t>(data.bytes_received),
+            static_cast<int64_t>(data.ops),
+            static_cast<int64_t>(data.successful_ops)});
+      }
+    }
+  }
+  backend.add_usage(rows);
+}
+
+int read_usage(
+    const DoutPrefixProvider* dpp, const UsageBackend& backend,
+    const UsageBackend::Range& range, uint32_t max_entries,
+    bool* is_truncated, RGWUsageIter& usage_iter,
+    std::map<rgw_user_bucket, rgw_usage_log_entry>& usage
+) {
+  usage.clear();
+  bool truncated = false;
+  sqlite::DBUsageList rows;
+  try {
+    rows = backend.read_usage(
+        range, decode_marker(usage_iter.read_iter), max_entries, truncated
+    );
+  } catch (const std::system_error& e) {
+    lsfs_err_for(dpp, "usage")
+        << fmt::format("failed to read usage: {}", e.what()) << dendl;
+    return -EIO;
+  }
+  for (const auto& row : rows) {
+    rgw_usage_log_entry& entry = usage[rgw_user_bucket(row.owner, row.bucket)];
+    if (entry.owner.empty()) {
+      entry.owner.from_str(row.owner);
+      entry.payer.from_str(row.payer);
+      entry.bucket = row.bucket;
+      entry.epoch = row.epoch;
+    }
+    rgw_usage_data data;
+    data.bytes_sent = row.bytes_sent;
+    data.bytes_received = row.bytes_received;
+    data.ops = row.ops;
+    data.successful_ops = row.successful_ops;
+    entry.usage_map[row.category].aggregate(data);
+    entry.total_usage.aggregate(data);
+  }
+  if (truncated && !rows.empty()) {
+    usage_iter.read_iter = fmt::format(
+        "{}{}{}", rows.back().owner, USAGE_MARKER_SEPARATOR,
+        rows.back().bucket
+    );
+  } else {
+    usage_iter.read_iter.clear();
+  }
+  if (is_truncated) {
+    *is_truncated = truncated;
+  }
+  return 0;
+}
+
+int trim_usage(
+    const DoutPrefixProvider* dpp, const UsageBackend& backend,
+    const UsageBackend::Range& range
+) {
+  try {
+    const auto removed = backend.trim_usage(range);
+    lsfs_debug_for(dpp, "usage")
+        << fmt::format("trimmed {} usage rows", removed) << dendl;
+  } catch (const std::system_error& e) {
+    lsfs_err_for(dpp, "usage")
+        << fmt::format("failed to trim usage: {}", e.what()) << dendl;
+    return -EIO;
+  }
+  return 0;
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,56 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/usage_backend.h"
+#include "rgw_rados.h"
+#include "rgw_sal.h"
+
+namespace rgw::sal::sfs {
+
+/// The usage backend set by rgw_sfs_usage_backend. The rocksdb one
+/// lives in data_path. Throws std::system_error if it can't be opened.
+std::unique_ptr<UsageBackend> make_usage_backend(
+    CephContext* cct, sqlite::DBConnRef conn,
+    const std::filesystem::path& data_path
+);
+
+/// Store a flush of the usage logger. The logger already sums requests
+/// per owner, bucket and hour in memory, so this is one transaction per
+/// rgw_usage_log_tick_interval, not per request.
+void log_usage(
+    const UsageBackend& backend,
+    const std::map<rgw_user_bucket, RGWUsageBatch>& usage_info
+);
+
+/// Read usage for the usage admin API. Continues after usage_iter and
+/// updates it, max_entries limits the owner/bucket pairs returned.
+int read_usage(
+    const DoutPrefixProvider* dpp, const UsageBackend& backend,
+    const UsageBackend::Range& range, uint32_t max_entries,
+    bool* is_truncated, RGWUsageIter& usage_iter,
+    std::map<rgw_user_bucket, rgw_usage_log_entry>& usage
+);
+
+int trim_usage(
+    const DoutPrefixProvider* dpp, const UsageBackend& backend,
+    const UsageBackend::Range& range
+);
+
+}  // namespace rgw::sal::sfs
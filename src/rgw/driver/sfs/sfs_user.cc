@@ -12,7 +12,7 @@
  * Foundation. See file COPYING.
  */
 #include "rgw/driver/sfs/sfs_log.h"
-#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/db_users.h"
 #include "rgw_sal_sfs.h"
 
 #define dout_subsys ceph_subsys_rgw_sfs
@@ -29,8 +29,8 @@ int SFStore::get_user_by_access_key(
     std::unique_ptr<User>* user
 ) {
   int err = 0;
-  rgw::sal::sfs::sqlite::SQLiteUsers sqlite_users(db_conn);
-  auto db_user = sqlite_users.get_user_by_access_key(key);
+  const auto& db_users = metadata->users();
+  auto db_user = db_users.get_user_by_access_key(key);
   if (db_user) {
     user->reset(new SFSUser(db_user->uinfo, this));
   } else {
@@ -45,8 +45,8 @@ int SFStore::get_user_by_email(
     optional_yield /*y*/, std::unique_ptr<User>* user
 ) {
   int err = 0;
-  rgw::sal::sfs::sqlite::SQLiteUsers sqlite_users(db_conn);
-  auto db_user = sqlite_users.get_user_by_email(email);
+  const auto& db_users = metadata->users();
+  auto db_user = db_users.get_user_by_email(email);
   if (db_user) {
     user->reset(new SFSUser(db_user->uinfo, this));
   } else {
@@ -0,0 +1,114 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "rgw/driver/sfs/space_ledger.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace rgw::sal::sfs {
+
+SpaceLedger::SpaceLedger(uint64_t _min_space_left, uint64_t _chunk_bytes)
+    : min_space_left(_min_space_left),
+      chunk_bytes(std::max<uint64_t>(_chunk_bytes, 1)),
+      avail_bytes(std::numeric_limits<uint64_t>::max()) {}
+
+uint64_t SpaceLedger::get_available() const {
+  const uint64_t avail = avail_bytes.load();
+  const uint64_t used = written_bytes.load() + reserved_bytes.load();
+  return avail > used ? avail - used : 0;
+}
+
+bool SpaceLedger::try_reserve(uint64_t bytes) {
+  uint64_t reserved = reserved_bytes.load();
+  while (true) {
+    const uint64_t avail = avail_bytes.load();
+    const uint64_t used = written_bytes.load() + reserved;
+    if (avail < used || avail - used < min_space_left ||
+        avail - used - min_space_left < bytes) {
+      return false;
+    }
+    if (reserved_bytes.compare_exchange_weak(reserved, reserved + bytes)) {
+      return true;
+    }
+  }
+}
+
+void SpaceLedger::release(uint64_t bytes) {
+  reserved_bytes -= bytes;
+}
+
+void SpaceLedger::commit(uint64_t reserved, uint64_t written) {
+  // account the written bytes first, so that for a moment they are
+  // counted twice rather than not at all
+  written_bytes += written;
+  reserved_bytes -= reserved;
+}
+
+void SpaceLedger::update(uint64_t avail, uint64_t written_before) {
+  avail_bytes = avail;
+  // the sample includes everything written before it was taken
+  written_bytes -= written_before;
+}
+
+SpaceReservation::SpaceReservation(SpaceReservation&& other) noexcept
+    : ledger(std::exchange(other.ledger, nullptr)),
+      bytes(std::exchange(other.bytes, 0)) {}
+
+SpaceReservation& SpaceReservation::operator=(SpaceReservation&& other
+) noexcept {
+  if (this != &other) {
+    release();
+    ledger = std::exchange(other.ledger, nullptr);
+    bytes = std::exchange(other.bytes, 0);
+  }
+  return *this;
+}
+
+bool SpaceReservation::reserve(uint64_t total) {
+  if (total <= bytes) {
+    return true;
+  }
+  if (ledger == nullptr || !ledger->try_reserve(total - bytes)) {
+    return false;
+  }
+  bytes = total;
+  return true;
+}
+
+bool SpaceReservation::extend(uint64_t total) {
+  if (total <= bytes) {
+    return true;
+  }
+  const uint64_t chunk =
+      ledger != nullptr ? ledger->get_chunk_bytes() : uint64_t{0};
+  const uint64_t step = std::max(total - bytes, chunk);
+  return reserve(bytes + step) || reserve(total);
+}
+
+void SpaceReservation::commit(uint64_t written) {
+  if (ledger != nullptr) {
+    ledger->commit(bytes, written);
+  }
+  bytes = 0;
+}
+
+void SpaceReservation::release() {
+  if (ledger != nullptr && bytes > 0) {
+    ledger->release(bytes);
+  }
+  bytes = 0;
+}
+
+}  // namespace rgw::sal::sfs
@@ -0,0 +1,94 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace rgw::sal::sfs {
+
+/// Admission control for data writes. Tracks the space promised to
+/// writes in flight and written since the last statfs sample, so that
+/// concurrent uploads can't all pass a free space check that only one
+/// of them fits.
+///
+/// The statfs updater calls update() periodically. Space freed by
+/// deletes and overwrites only shows up there.
+class SpaceLedger {
+  // never admit writes that would leave less than this
+  const uint64_t min_space_left;
+  // reservations grow in steps of at least this many bytes
+  const uint64_t chunk_bytes;
+  // available bytes as of the last statfs sample
+  std::atomic_uint64_t avail_bytes;
+  // held by writes in flight
+  std::atomic_uint64_t reserved_bytes{0};
+  // written since the last statfs sample
+  std::atomic_uint64_t written_bytes{0};
+
+ public:
+  SpaceLedger(uint64_t min_space_left, uint64_t chunk_bytes);
+  SpaceLedger(const SpaceLedger&) = delete;
+  SpaceLedger& operator=(const SpaceLedger&) = delete;
+
+  /// Reserve `bytes`, if that leaves at least min_space_left.
+  bool try_reserve(uint64_t bytes);
+  /// Return reserved bytes unused.
+  void release(uint64_t bytes);
+  /// `written` of `reserved` bytes are now on disk, the rest is
+  /// returned.
+  void commit(uint64_t reserved, uint64_t written);
+
+  /// Bytes written since the last sample. Read this before sampling
+  /// statfs and pass it on to update().
+  uint64_t get_written() const { return written_bytes.load(); }
+  /// Reconcile with a statfs sample taken after get_written()
+  /// returned `written_before`.
+  void update(uint64_t avail, uint64_t written_before);
+
+  uint64_t get_chunk_bytes() const { return chunk_bytes; }
+  uint64_t get_reserved() const { return reserved_bytes.load(); }
+  /// Bytes left for new reservations, min_space_left included
+  uint64_t get_available() const;
+};
+
+/// Space held by a single writer. Released on destruction unless
+/// committed.
+class SpaceReservation {
+  SpaceLedger* ledger{nullptr};
+  uint64_t bytes{0};
+
+ public:
+  SpaceReservation() = default;
+  explicit SpaceReservation(SpaceLedger& _ledger) : ledger(&_ledger) {}
+  SpaceReservation(const SpaceReservation&) = delete;
+  SpaceReservation& operator=(const SpaceReservation&) = delete;
+  SpaceReservation(SpaceReservation&& other) noexcept;
+  SpaceReservation& operator=(SpaceReservation&& other) noexcept;
+  ~SpaceReservation() { release(); }
+
+  /// Make sure at least `total` bytes are reserved. False if there
+  /// isn't enough space.
+  bool reserve(uint64_t total);
+  /// Like reserve(), for writes of unknown size: grow by at least the
+  /// ledger's chunk size, or whatever is left if that is enough.
+  bool extend(uint64_t total);
+  /// `written` bytes made it to disk; give back the reservation.
+  void commit(uint64_t written);
+  void release();
+
+  uint64_t get_bytes() const { return bytes; }
+};
+
+}  // namespace rgw::sal::sfs
@@ -35,7 +35,8 @@ using BlobTypes = std::tuple<
     std::map<std::string, RGWAccessKey>, std::map<std::string, RGWSubUser>,
     RGWUserCaps, std::list<std::string>, std::map<int, std::string>,
     RGWQuotaInfo, std::set<std::string>, RGWBucketWebsiteConf,
-    std::map<std::string, uint32_t>, RGWObjectLock, rgw_sync_policy_info>;
+    std::map<std::string, uint32_t>, RGWObjectLock, rgw_sync_policy_info,
+    RGWCompressionInfo>;
 
 template <typename T>
 inline constexpr bool is_sqlite_blob =
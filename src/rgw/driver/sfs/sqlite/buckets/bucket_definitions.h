@@ -75,8 +75,15 @@ struct DBOPBucketInfo {
   DBOPBucketInfo& operator=(const DBOPBucketInfo& other) = default;
 };
 
-using DBDeletedObjectItem =
-    std::tuple<decltype(DBObject::uuid), decltype(DBVersionedObject::id)>;
+// a bucket keeping its data below a directory of its own
+// (rgw_sfs_bucket_data_dirs)
+struct DBBucketDataDir {
+  std::string bucket_id;
+};
+
+using DBDeletedObjectItem = std::tuple<
+    decltype(DBObject::uuid), decltype(DBVersionedObject::id),
+    decltype(DBObject::bucket_id)>;
 
 using DBDeletedObjectItems = std::vector<DBDeletedObjectItem>;
 
@@ -90,4 +97,10 @@ inline decltype(DBVersionedObject::id) get_version_id(
 ) {
   return std::get<1>(item);
 }
+
+inline decltype(DBObject::bucket_id) get_bucket_id(
+    const DBDeletedObjectItem& item
+) {
+  return std::get<2>(item);
+}
 }  // namespace rgw::sal::sfs::sqlite
@@ -17,6 +17,7 @@
 
 #include "rgw/driver/sfs/multipart_types.h"
 #include "rgw/rgw_common.h"
+#include "rgw/rgw_compression_types.h"
 
 namespace rgw::sal::sfs::sqlite {
 
@@ -29,6 +30,10 @@ struct DBMultipartPart {
   uint64_t size;
   std::optional<std::string> etag;
   std::optional<ceph::real_time> mtime;
+  // set if the part was compressed, size is then the compressed size
+  std::optional<RGWCompressionInfo> compression;
+  // crc32c of the part data as stored, if known
+  std::optional<uint32_t> crc32c;
 
   inline bool is_finished() const { return etag.has_value(); }
 };
@@ -0,0 +1,29 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace rgw::sal::sfs::sqlite {
+
+/// A deduplicated data file, shared by all versions with the same
+/// content. refcount counts the versions linking to it.
+struct DBContent {
+  std::string hash;  // primary key, hex sha256 of the data
+  uint64_t size;
+  uint64_t refcount;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
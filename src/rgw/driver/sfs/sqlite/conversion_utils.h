@@ -15,6 +15,7 @@
 
 #include "rgw/driver/sfs/sqlite/sqlite_orm.h"
 #include "rgw_acl.h"
+#include "rgw_compression_types.h"
 #include "rgw_common.h"
 
 namespace blob_utils {
@@ -42,7 +43,7 @@ namespace rgw::sal::sfs::sqlite {
 // decoding it from/to a bufferlist
 using TypesDecodeIsNOTInCephNamespace = std::tuple<
     RGWAccessControlPolicy, RGWQuotaInfo, RGWObjectLock, RGWUserCaps, ACLOwner,
-    rgw_placement_rule>;
+    rgw_placement_rule, RGWCompressionInfo>;
 
 /// Returns if a type has its encode/decode methods in the ceph namespace.
 template <typename T>
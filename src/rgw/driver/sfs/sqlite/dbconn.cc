@@ -19,9 +19,12 @@
 #include <filesystem>
 #include <memory>
 #include <system_error>
+#include <vector>
 
 #include "common/dout.h"
 #include "rgw/driver/sfs/sfs_log.h"
+#include "rgw/driver/sfs/sqlite/sqlite_object_tags.h"
+#include "rgw/driver/sfs/sqlite/sqlite_prefix_stats.h"
 
 #define dout_subsys ceph_subsys_rgw_sfs
 
@@ -73,6 +76,35 @@ static int sqlite_wal_hook_callback(
   return SQLITE_OK;
 }
 
+static int sqlite_backup_wal_hook_callback(
+    void* ctx, sqlite3* db, const char* zDb, int frames
+) {
+  const auto conn = static_cast<DBConn*>(ctx);
+  const auto max_frames =
+      conn->cct->_conf.get_val<int64_t>("rgw_sfs_backup_wal_max_frames");
+  if (max_frames <= 0 || frames <= max_frames) {
+    // SFSBackup checkpoints, once it has copied the frames
+    return SQLITE_OK;
+  }
+  lsubdout(conn->cct, rgw_sfs, SFS_LOG_WARN)
+      << "[SQLITE] WAL has " << frames
+      << " frames, more than rgw_sfs_backup_wal_max_frames=" << max_frames
+      << ", checkpointing before the backup copied them" << dendl;
+  // counted first, so that the backup can't copy a WAL started over
+  // without noticing
+  conn->forced_wal_checkpoints++;
+  int total_frames = 0;
+  int checkpointed_frames = 0;
+  const int rc = sqlite3_wal_checkpoint_v2(
+      db, zDb, SQLITE_CHECKPOINT_TRUNCATE, &total_frames, &checkpointed_frames
+  );
+  lsubdout(conn->cct, rgw_sfs, SFS_LOG_DEBUG)
+      << "[SQLITE] WAL checkpoint (truncate) returned " << rc << " ("
+      << sqlite3_errstr(rc) << "), total_frames=" << total_frames
+      << ", checkpointed_frames=" << checkpointed_frames << dendl;
+  return SQLITE_OK;
+}
+
 static int sqlite_profile_callback(
     unsigned int reason, void* ctx, void* vstatement, void* runtime_ptr
 ) {
@@ -118,11 +150,34 @@ static int sqlite_profile_callback(
   return 0;
 }
 
+// prefix stats are kept by triggers on the SQLite objects and versions
+// tables, which stay empty with the rocksdb metadata backend
+static uint get_prefix_stats_depth(CephContext* cct) {
+  const auto depth = static_cast<uint>(
+      cct->_conf.get_val<uint64_t>("rgw_sfs_prefix_stats_depth")
+  );
+  if (depth > 0 &&
+      cct->_conf.get_val<std::string>("rgw_sfs_metadata_backend") ==
+          "rocksdb") {
+    const NoDoutPrefix ndp(cct, dout_subsys);
+    lsfs_warn(&ndp) << "prefix stats are not available with "
+                       "rgw_sfs_metadata_backend=rocksdb, ignoring "
+                       "rgw_sfs_prefix_stats_depth"
+                    << dendl;
+    return 0;
+  }
+  return depth;
+}
+
 DBConn::DBConn(CephContext* _cct)
     : main_thread(std::this_thread::get_id()),
       storage_pool_mutex(),
       cct(_cct),
-      profile_enabled(_cct->_conf.get_val<bool>("rgw_sfs_sqlite_profile")) {
+      profile_enabled(_cct->_conf.get_val<bool>("rgw_sfs_sqlite_profile")),
+      prefix_stats_delimiter(
+          _cct->_conf.get_val<std::string>("rgw_sfs_prefix_stats_delimiter")
+      ),
+      prefix_stats_depth(get_prefix_stats_depth(_cct)) {
   maybe_rename_database_file();
   sqlite3_config(SQLITE_CONFIG_LOG, &sqlite_error_callback, cct);
   // get_storage() relies on there already being an entry in the pool
@@ -159,8 +214,13 @@ DBConn::DBConn(CephContext* _cct)
             .c_str(),
         0, 0, 0
     );
-    if (!cct->_conf.get_val<bool>("rgw_sfs_wal_checkpoint_use_sqlite_default"
-        )) {
+    if (!cct->_conf.get_val<std::string>("rgw_sfs_backup_path").empty()) {
+      // replaces the autocheckpoint, SFSBackup checkpoints unless the WAL
+      // grows past rgw_sfs_backup_wal_max_frames
+      sqlite3_wal_hook(db, sqlite_backup_wal_hook_callback, this);
+    } else if (!cct->_conf.get_val<bool>(
+                   "rgw_sfs_wal_checkpoint_use_sqlite_default"
+               )) {
       sqlite3_wal_hook(db, sqlite_wal_hook_callback, this->cct);
     }
     if (this->profile_enabled) {
@@ -168,12 +228,30 @@ DBConn::DBConn(CephContext* _cct)
           db, SQLITE_TRACE_PROFILE, &sqlite_profile_callback, this->cct
       );
     }
+    if (this->prefix_stats_ready && this->prefix_stats_depth > 0) {
+      install_prefix_stats_triggers(
+          db, this->prefix_stats_delimiter, this->prefix_stats_depth
+      );
+    }
   };
   storage->open_forever();
   storage->busy_timeout(5000);
+  const int db_version = storage->pragma.user_version();
   maybe_upgrade_metadata();
   check_metadata_is_compatible();
   storage->sync_schema();
+  // object_tags is new in v15, fill it from the existing attrs
+  if (db_version > 0 && db_version < 15) {
+    backfill_object_tags(*this);
+  }
+  // the triggers refer to tables sync_schema may just have created
+  if (prefix_stats_depth > 0) {
+    install_prefix_stats_triggers(
+        first_sqlite_conn(), prefix_stats_delimiter, prefix_stats_depth
+    );
+  }
+  sync_prefix_stats(*this);
+  prefix_stats_ready = true;
 }
 
 StorageRef DBConn::get_storage() {
@@ -413,6 +491,53 @@ static int upgrade_metadata_from_v4(sqlite3* db, std::string* errmsg) {
   return 0;
 }
 
+static int upgrade_metadata_from_v6(sqlite3* db, std::string* errmsg) {
+  const std::vector<std::pair<std::string_view, std::string>> statements = {
+      {VERSIONED_OBJECTS_TABLE,
+       fmt::format(
+           "ALTER TABLE {} ADD COLUMN physical_size INTEGER NOT NULL DEFAULT 0",
+           VERSIONED_OBJECTS_TABLE
+       )},
+      {VERSIONED_OBJECTS_TABLE,
+       fmt::format(
+           "UPDATE {} SET physical_size = size", VERSIONED_OBJECTS_TABLE
+       )},
+      {MULTIPARTS_PARTS_TABLE,
+       fmt::format(
+           "ALTER TABLE {} ADD COLUMN compression BLOB", MULTIPARTS_PARTS_TABLE
+       )},
+  };
+  for (const auto& [table, statement] : statements) {
+    auto rc = sqlite3_exec(db, statement.c_str(), nullptr, nullptr, nullptr);
+    if (rc != SQLITE_OK) {
+      if (errmsg != nullptr) {
+        *errmsg = fmt::format(
+            "Error updating '{}' table: {}", table, sqlite3_errmsg(db)
+        );
+      }
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int upgrade_metadata_from_v8(sqlite3* db, std::string* errmsg) {
+  const auto statement = fmt::format(
+      "ALTER TABLE {} ADD COLUMN crc32c INTEGER", MULTIPARTS_PARTS_TABLE
+  );
+  auto rc = sqlite3_exec(db, statement.c_str(), nullptr, nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    if (errmsg != nullptr) {
+      *errmsg = fmt::format(
+          "Error updating '{}' table: {}", MULTIPARTS_PARTS_TABLE,
+          sqlite3_errmsg(db)
+      );
+    }
+    return -1;
+  }
+  return 0;
+}
+
 static void upgrade_metadata(
     CephContext* cct, StorageRef storage, sqlite3* db
 ) {
@@ -432,7 +557,23 @@ static void upgrade_metadata(
       rc = upgrade_metadata_from_v2(db, &errmsg);
     } else if (cur_version == 4) {
       rc = upgrade_metadata_from_v4(db, &errmsg);
+    } else if (cur_version == 6) {
+      rc = upgrade_metadata_from_v6(db, &errmsg);
+    } else if (cur_version == 8) {
+      rc = upgrade_metadata_from_v8(db, &errmsg);
     }
+    // v5 -> v6: new versioned_object_parts table, created by sync_schema
+    // v7 -> v8: new content table, created by sync_schema
+    // v9 -> v10: new scrub table, created by sync_schema
+    // v10 -> v11: new gc_journal table, created by sync_schema
+    // v11 -> v12: new bucket_data_dirs table, created by sync_schema
+    // v12 -> v13: new vobjs_objid_commit_time_id_idx, created by sync_schema
+    // v13 -> v14: new prefix_stats tables, created by sync_schema
+    // v14 -> v15: new object_tags table, created by sync_schema and
+    // backfilled in the DBConn constructor
+    // v15 -> v16: new topics, bucket_topics and notification_events
+    // tables, created by sync_schema
+    // v16 -> v17: new usage table, created by sync_schema
 
     if (rc < 0) {
       auto err = fmt::format(
@@ -17,6 +17,7 @@
 #include <sqlite3.h>
 #include <utime.h>
 
+#include <atomic>
 #include <filesystem>
 #include <ios>
 #include <memory>
@@ -26,10 +27,17 @@
 #include "buckets/multipart_definitions.h"
 #include "common/ceph_mutex.h"
 #include "common/dout.h"
+#include "content/content_definitions.h"
 #include "dbapi.h"
+#include "gc/gc_journal_definitions.h"
 #include "lifecycle/lifecycle_definitions.h"
+#include "notifications/notification_definitions.h"
+#include "object_tags/object_tags_definitions.h"
 #include "objects/object_definitions.h"
+#include "prefix_stats/prefix_stats_definitions.h"
+#include "usage/usage_definitions.h"
 #include "rgw/rgw_perf_counters.h"
+#include "scrub/scrub_definitions.h"
 #include "sqlite_orm.h"
 #include "users/users_definitions.h"
 #include "versioned_object/versioned_object_definitions.h"
@@ -37,7 +45,7 @@
 namespace rgw::sal::sfs::sqlite {
 
 /// current db version.
-constexpr int SFS_METADATA_VERSION = 5;
+constexpr int SFS_METADATA_VERSION = 17;
 /// minimum required version to upgrade db.
 constexpr int SFS_METADATA_MIN_VERSION = 4;
 
@@ -49,11 +57,24 @@ constexpr std::string_view USERS_TABLE = "users";
 constexpr std::string_view BUCKETS_TABLE = "buckets";
 constexpr std::string_view OBJECTS_TABLE = "objects";
 constexpr std::string_view VERSIONED_OBJECTS_TABLE = "versioned_objects";
+constexpr std::string_view VERSIONED_OBJECT_PARTS_TABLE =
+    "versioned_object_parts";
 constexpr std::string_view ACCESS_KEYS = "access_keys";
 constexpr std::string_view LC_HEAD_TABLE = "lc_head";
 constexpr std::string_view LC_ENTRIES_TABLE = "lc_entries";
 constexpr std::string_view MULTIPARTS_TABLE = "multiparts";
 constexpr std::string_view MULTIPARTS_PARTS_TABLE = "multiparts_parts";
+constexpr std::string_view CONTENT_TABLE = "content";
+constexpr std::string_view SCRUB_TABLE = "scrub";
+constexpr std::string_view GC_JOURNAL_TABLE = "gc_journal";
+constexpr std::string_view BUCKET_DATA_DIRS_TABLE = "bucket_data_dirs";
+constexpr std::string_view PREFIX_STATS_TABLE = "prefix_stats";
+constexpr std::string_view PREFIX_STATS_CONFIG_TABLE = "prefix_stats_config";
+constexpr std::string_view OBJECT_TAGS_TABLE = "object_tags";
+constexpr std::string_view TOPICS_TABLE = "topics";
+constexpr std::string_view BUCKET_TOPICS_TABLE = "bucket_topics";
+constexpr std::string_view NOTIFICATION_EVENTS_TABLE = "notification_events";
+constexpr std::string_view USAGE_TABLE = "usage";
 
 class sqlite_sync_exception : public std::exception {
   std::string _message;
@@ -84,6 +105,18 @@ inline auto _make_storage(const std::string& path) {
       sqlite_orm::make_index(
           "vobjs_object_id_idx", &DBVersionedObject::object_id
       ),
+      sqlite_orm::make_index(
+          "vobjs_objid_commit_time_id_idx", &DBVersionedObject::object_id,
+          &DBVersionedObject::commit_time, &DBVersionedObject::id
+      ),
+      sqlite_orm::make_index(
+          "vobj_parts_vobjid_idx", &DBVersionedObjectPart::versioned_object_id
+      ),
+      sqlite_orm::make_index(
+          "object_tags_bucketid_key_value_idx", &DBObjectTag::bucket_id,
+          &DBObjectTag::key, &DBObjectTag::value
+      ),
+      sqlite_orm::make_index("usage_epoch_idx", &DBUsage::epoch),
       sqlite_orm::make_table(
           std::string(USERS_TABLE),
           sqlite_orm::make_column(
@@ -164,6 +197,10 @@ inline auto _make_storage(const std::string& path) {
           sqlite_orm::make_column("object_id", &DBVersionedObject::object_id),
           sqlite_orm::make_column("checksum", &DBVersionedObject::checksum),
           sqlite_orm::make_column("size", &DBVersionedObject::size),
+          sqlite_orm::make_column(
+              "physical_size", &DBVersionedObject::physical_size,
+              sqlite_orm::default_value(0)
+          ),
           sqlite_orm::make_column(
               "create_time", &DBVersionedObject::create_time
           ),
@@ -186,6 +223,31 @@ inline auto _make_storage(const std::string& path) {
           sqlite_orm::foreign_key(&DBVersionedObject::object_id)
               .references(&DBObject::uuid)
       ),
+      sqlite_orm::make_table(
+          std::string(VERSIONED_OBJECT_PARTS_TABLE),
+          sqlite_orm::make_column(
+              "id", &DBVersionedObjectPart::id,
+              sqlite_orm::primary_key().autoincrement()
+          ),
+          sqlite_orm::make_column(
+              "versioned_object_id", &DBVersionedObjectPart::versioned_object_id
+          ),
+          sqlite_orm::make_column(
+              "part_num", &DBVersionedObjectPart::part_num
+          ),
+          sqlite_orm::make_column("part_id", &DBVersionedObjectPart::part_id),
+          sqlite_orm::make_column(
+              "obj_offset", &DBVersionedObjectPart::offset
+          ),
+          sqlite_orm::make_column("size", &DBVersionedObjectPart::size),
+          sqlite_orm::unique(
+              &DBVersionedObjectPart::versioned_object_id,
+              &DBVersionedObjectPart::part_num
+          ),
+          sqlite_orm::foreign_key(&DBVersionedObjectPart::versioned_object_id)
+              .references(&DBVersionedObject::id)
+              .on_delete.cascade()
+      ),
       sqlite_orm::make_table(
           std::string(ACCESS_KEYS),
           sqlite_orm::make_column(
@@ -249,11 +311,141 @@ inline auto _make_storage(const std::string& path) {
           sqlite_orm::make_column("size", &DBMultipartPart::size),
           sqlite_orm::make_column("etag", &DBMultipartPart::etag),
           sqlite_orm::make_column("mtime", &DBMultipartPart::mtime),
+          sqlite_orm::make_column(
+              "compression", &DBMultipartPart::compression
+          ),
+          sqlite_orm::make_column("crc32c", &DBMultipartPart::crc32c),
           sqlite_orm::unique(
               &DBMultipartPart::upload_id, &DBMultipartPart::part_num
           ),
           sqlite_orm::foreign_key(&DBMultipartPart::upload_id)
               .references(&DBMultipart::upload_id)
+      ),
+      sqlite_orm::make_table(
+          std::string(CONTENT_TABLE),
+          sqlite_orm::make_column(
+              "hash", &DBContent::hash, sqlite_orm::primary_key()
+          ),
+          sqlite_orm::make_column("size", &DBContent::size),
+          sqlite_orm::make_column("refcount", &DBContent::refcount)
+      ),
+      sqlite_orm::make_table(
+          std::string(SCRUB_TABLE),
+          sqlite_orm::make_column(
+              "id", &DBScrubState::id, sqlite_orm::primary_key()
+          ),
+          sqlite_orm::make_column(
+              "last_version_id", &DBScrubState::last_version_id
+          ),
+          sqlite_orm::make_column(
+              "last_pass_end", &DBScrubState::last_pass_end
+          )
+      ),
+      sqlite_orm::make_table(
+          std::string(GC_JOURNAL_TABLE),
+          sqlite_orm::make_column(
+              "id", &DBGCJournalEntry::id,
+              sqlite_orm::primary_key().autoincrement()
+          ),
+          sqlite_orm::make_column("kind", &DBGCJournalEntry::kind),
+          sqlite_orm::make_column("ref", &DBGCJournalEntry::ref),
+          sqlite_orm::make_column(
+              "enqueue_time", &DBGCJournalEntry::enqueue_time
+          )
+      ),
+      sqlite_orm::make_table(
+          std::string(BUCKET_DATA_DIRS_TABLE),
+          sqlite_orm::make_column(
+              "bucket_id", &DBBucketDataDir::bucket_id,
+              sqlite_orm::primary_key()
+          )
+      ),
+      sqlite_orm::make_table(
+          std::string(PREFIX_STATS_TABLE),
+          sqlite_orm::make_column("bucket_id", &DBPrefixStats::bucket_id),
+          sqlite_orm::make_column("prefix", &DBPrefixStats::prefix),
+          sqlite_orm::make_column("obj_count", &DBPrefixStats::obj_count),
+          sqlite_orm::make_column("size", &DBPrefixStats::size),
+          sqlite_orm::primary_key(
+              &DBPrefixStats::bucket_id, &DBPrefixStats::prefix
+          )
+      ),
+      sqlite_orm::make_table(
+          std::string(PREFIX_STATS_CONFIG_TABLE),
+          sqlite_orm::make_column(
+              "id", &DBPrefixStatsConfig::id, sqlite_orm::primary_key()
+          ),
+          sqlite_orm::make_column(
+              "delimiter", &DBPrefixStatsConfig::delimiter
+          ),
+          sqlite_orm::make_column("depth", &DBPrefixStatsConfig::depth)
+      ),
+      sqlite_orm::make_table(
+          std::string(OBJECT_TAGS_TABLE),
+          sqlite_orm::make_column("version_id", &DBObjectTag::version_id),
+          sqlite_orm::make_column("bucket_id", &DBObjectTag::bucket_id),
+          sqlite_orm::make_column("key", &DBObjectTag::key),
+          sqlite_orm::make_column("value", &DBObjectTag::value),
+          sqlite_orm::primary_key(
+              &DBObjectTag::version_id, &DBObjectTag::key, &DBObjectTag::value
+          ),
+          sqlite_orm::foreign_key(&DBObjectTag::version_id)
+              .references(&DBVersionedObject::id)
+              .on_delete.cascade()
+      ),
+      sqlite_orm::make_table(
+          std::string(TOPICS_TABLE),
+          sqlite_orm::make_column(
+              "tenant", &DBTopics::tenant, sqlite_orm::primary_key()
+          ),
+          sqlite_orm::make_column("topics", &DBTopics::topics),
+          sqlite_orm::make_column("version", &DBTopics::version)
+      ),
+      sqlite_orm::make_table(
+          std::string(BUCKET_TOPICS_TABLE),
+          sqlite_orm::make_column(
+              "bucket_id", &DBBucketTopics::bucket_id, sqlite_orm::primary_key()
+          ),
+          sqlite_orm::make_column("topics", &DBBucketTopics::topics),
+          sqlite_orm::make_column("version", &DBBucketTopics::version)
+      ),
+      sqlite_orm::make_table(
+          std::string(NOTIFICATION_EVENTS_TABLE),
+          sqlite_orm::make_column(
+              "id", &DBNotificationEvent::id,
+              sqlite_orm::primary_key().autoincrement()
+          ),
+          sqlite_orm::make_column(
+              "push_endpoint", &DBNotificationEvent::push_endpoint
+          ),
+          sqlite_orm::make_column(
+              "push_endpoint_args", &DBNotificationEvent::push_endpoint_args
+          ),
+          sqlite_orm::make_column("arn_topic", &DBNotificationEvent::arn_topic),
+          sqlite_orm::make_column("event", &DBNotificationEvent::event),
+          sqlite_orm::make_column(
+              "enqueue_time", &DBNotificationEvent::enqueue_time
+          ),
+          sqlite_orm::make_column(
+              "next_attempt", &DBNotificationEvent::next_attempt
+          ),
+          sqlite_orm::make_column("attempts", &DBNotificationEvent::attempts)
+      ),
+      sqlite_orm::make_table(
+          std::string(USAGE_TABLE),
+          sqlite_orm::make_column("owner", &DBUsage::owner),
+          sqlite_orm::make_column("bucket", &DBUsage::bucket),
+          sqlite_orm::make_column("epoch", &DBUsage::epoch),
+          sqlite_orm::make_column("payer", &DBUsage::payer),
+          sqlite_orm::make_column("category", &DBUsage::category),
+          sqlite_orm::make_column("bytes_sent", &DBUsage::bytes_sent),
+          sqlite_orm::make_column("bytes_received", &DBUsage::bytes_received),
+          sqlite_orm::make_column("ops", &DBUsage::ops),
+          sqlite_orm::make_column("successful_ops", &DBUsage::successful_ops),
+          sqlite_orm::primary_key(
+              &DBUsage::owner, &DBUsage::bucket, &DBUsage::epoch,
+              &DBUsage::payer, &DBUsage::category
+          )
       )
   );
 }
@@ -273,10 +465,18 @@ class DBConn {
   std::vector<sqlite3*> sqlite_conns;
   const std::thread::id main_thread;
   mutable std::shared_mutex storage_pool_mutex;
+  // set once prefix_stats is in sync, from then on new connections
+  // get the prefix stats triggers
+  bool prefix_stats_ready{false};
 
  public:
   CephContext* const cct;
   const bool profile_enabled;
+  const std::string prefix_stats_delimiter;
+  const uint prefix_stats_depth;
+  /// WAL checkpoints forced past rgw_sfs_backup_wal_max_frames while
+  /// backups are enabled. SFSBackup misses frames whenever this changes.
+  std::atomic<uint64_t> forced_wal_checkpoints{0};
 
   DBConn(CephContext* _cct);
   virtual ~DBConn() = default;
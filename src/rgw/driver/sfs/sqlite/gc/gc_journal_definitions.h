@@ -0,0 +1,47 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/ceph_time.h"
+#include "rgw/driver/sfs/sqlite/bindings/enum.h"
+#include "rgw/driver/sfs/sqlite/bindings/real_time.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+/// What a GC journal entry's `ref` refers to.
+enum class GCJournalKind {
+  // versions of object `ref` (uuid) were deleted
+  OBJECT = 0,
+  // multipart upload `ref` was completed or aborted
+  MULTIPART,
+  // bucket `ref` was deleted
+  BUCKET,
+  LAST_VALUE = BUCKET
+};
+
+/// Reclaim work queued for the garbage collector by the operation that
+/// created it.
+struct DBGCJournalEntry {
+  int id;
+  GCJournalKind kind;
+  std::string ref;
+  ceph::real_time enqueue_time;
+};
+
+using DBGCJournalEntries = std::vector<DBGCJournalEntry>;
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,58 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/ceph_time.h"
+#include "rgw/driver/sfs/sqlite/bindings/real_time.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Notification topics of a tenant, an encoded rgw_pubsub_topics.
+/// version grows with every write, for RGWObjVersionTracker.
+struct DBTopics {
+  std::string tenant;
+  std::vector<char> topics;
+  uint64_t version;
+};
+
+/// Notification configuration of a bucket, an encoded
+/// rgw_pubsub_bucket_topics.
+struct DBBucketTopics {
+  std::string bucket_id;
+  std::vector<char> topics;
+  uint64_t version;
+};
+
+/// A notification event waiting to be delivered to the endpoint of its
+/// topic. The endpoint is copied from the topic when the event is
+/// queued, like the RADOS persistent queues do.
+struct DBNotificationEvent {
+  int64_t id;
+  std::string push_endpoint;
+  std::string push_endpoint_args;
+  std::string arn_topic;
+  // encoded rgw_pubsub_s3_event
+  std::vector<char> event;
+  ceph::real_time enqueue_time;
+  ceph::real_time next_attempt;
+  uint attempts;
+};
+
+using DBNotificationEvents = std::vector<DBNotificationEvent>;
+
+}  // namespace rgw::sal::sfs::sqlite
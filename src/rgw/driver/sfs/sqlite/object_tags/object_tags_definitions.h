@@ -0,0 +1,36 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rgw::sal::sfs::sqlite {
+
+/// One tag of a regular object version, decoded from RGW_ATTR_TAGS in
+/// its attrs. bucket_id is the bucket of the version's object, copied
+/// here so tag lookups within a bucket don't need to join objects.
+/// Rows go away with their version (ON DELETE CASCADE).
+struct DBObjectTag {
+  uint version_id;
+  std::string bucket_id;
+  std::string key;
+  std::string value;
+};
+
+/// Tag key and value pairs, as in an RGWObjTags tag map.
+using DBObjectTagSet = std::vector<std::pair<std::string, std::string>>;
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,43 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Usage of a bucket prefix: the objects whose name, cut after the
+/// configured number of delimiters, equals `prefix` and whose latest
+/// committed version is not a delete marker, with the size of that
+/// version. Maintained by triggers on versioned_objects, see
+/// sqlite_prefix_stats.h.
+struct DBPrefixStats {
+  std::string bucket_id;
+  std::string prefix;
+  int64_t obj_count;
+  int64_t size;
+};
+
+using DBPrefixStatsList = std::vector<DBPrefixStats>;
+
+/// Delimiter and depth the prefix_stats table was computed with. There
+/// is a single row.
+struct DBPrefixStatsConfig {
+  int id;  // primary key, always 0
+  std::string delimiter;
+  uint depth;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
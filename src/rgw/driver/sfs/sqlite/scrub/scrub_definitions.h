@@ -0,0 +1,30 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include "common/ceph_time.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Progress of the background data scrubber (SFSScrubber). There is a
+/// single row.
+struct DBScrubState {
+  int id;  // primary key, always 0
+  // id of the last versioned object checked in the current pass, 0 if
+  // no pass is in progress
+  uint last_version_id;
+  ceph::real_time last_pass_end;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
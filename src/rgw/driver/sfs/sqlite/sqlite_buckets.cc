@@ -145,7 +145,7 @@ std::optional<DBDeletedObjectItems> SQLiteBuckets::delete_bucket_transact(
     auto transaction = storage->transaction_guard();
     // first get all the objects and versions for that bucket
     ret_values = storage->select(
-        columns(&DBObject::uuid, &DBVersionedObject::id),
+        columns(&DBObject::uuid, &DBVersionedObject::id, &DBObject::bucket_id),
         inner_join<DBObject>(
             on(is_equal(&DBObject::uuid, &DBVersionedObject::object_id))
         ),
@@ -185,6 +185,55 @@ std::optional<DBDeletedObjectItems> SQLiteBuckets::delete_bucket_transact(
   return retry.run();
 }
 
+std::optional<size_t> SQLiteBuckets::drop_bucket_rows_transact(
+    const std::string& bucket_id, uint max_objects, bool& bucket_deleted
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<size_t> retry([&]() -> size_t {
+    bucket_deleted = false;
+    auto transaction = storage->transaction_guard();
+    const auto uuids = storage->select(
+        &DBObject::uuid, where(is_equal(&DBObject::bucket_id, bucket_id)),
+        limit(max_objects)
+    );
+    if (!uuids.empty()) {
+      // parts manifests go along through on delete cascade
+      storage->remove_all<DBVersionedObject>(
+          where(in(&DBVersionedObject::object_id, uuids))
+      );
+      storage->remove_all<DBObject>(where(in(&DBObject::uuid, uuids)));
+      transaction.commit();
+      return uuids.size();
+    }
+    try {
+      storage->remove<DBBucket>(bucket_id);
+      storage->remove_all<DBBucketDataDir>(
+          where(is_equal(&DBBucketDataDir::bucket_id, bucket_id))
+      );
+      bucket_deleted = true;
+    } catch (const std::system_error& e) {
+      // multipart uploads are still around
+      if (e.code().value() != SQLITE_CONSTRAINT_FOREIGNKEY &&
+          e.code().value() != SQLITE_CONSTRAINT) {
+        throw(e);
+      }
+    }
+    transaction.commit();
+    return 0;
+  });
+  return retry.run();
+}
+
+void SQLiteBuckets::add_bucket_data_dir(const std::string& bucket_id) const {
+  auto storage = conn->get_storage();
+  storage->replace(DBBucketDataDir{bucket_id});
+}
+
+std::vector<std::string> SQLiteBuckets::get_bucket_data_dirs() const {
+  auto storage = conn->get_storage();
+  return storage->select(&DBBucketDataDir::bucket_id);
+}
+
 const std::optional<SQLiteBuckets::Stats> SQLiteBuckets::get_stats(
     const std::string& bucket_id
 ) const {
@@ -193,7 +242,8 @@ const std::optional<SQLiteBuckets::Stats> SQLiteBuckets::get_stats(
 
   auto res = storage->select(
       columns(
-          count(&DBVersionedObject::object_id), sum(&DBVersionedObject::size)
+          count(&DBVersionedObject::object_id), sum(&DBVersionedObject::size),
+          sum(&DBVersionedObject::physical_size)
       ),
       inner_join<DBObject>(
           on(is_equal(&DBObject::uuid, &DBVersionedObject::object_id))
@@ -212,6 +262,8 @@ const std::optional<SQLiteBuckets::Stats> SQLiteBuckets::get_stats(
     // Therefore we need to check whether it's a nullptr or not.
     auto size = std::get<1>(res[0]).get();
     stats->size = (size ? *size : 0);
+    auto physical_size = std::get<2>(res[0]).get();
+    stats->physical_size = (physical_size ? *physical_size : 0);
   }
 
   return stats;
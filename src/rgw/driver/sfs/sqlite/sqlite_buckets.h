@@ -15,51 +15,60 @@
 
 #include "buckets/bucket_conversions.h"
 #include "dbconn.h"
+#include "rgw/driver/sfs/metadata_backend.h"
 
 namespace rgw::sal::sfs::sqlite {
 
-class SQLiteBuckets {
+class SQLiteBuckets : public BucketsBackend {
   DBConnRef conn;
 
  public:
   explicit SQLiteBuckets(DBConnRef _conn);
-  virtual ~SQLiteBuckets() = default;
+  ~SQLiteBuckets() override = default;
 
   SQLiteBuckets(const SQLiteBuckets&) = delete;
   SQLiteBuckets& operator=(const SQLiteBuckets&) = delete;
 
-  struct Stats {
-    size_t size;
-    uint64_t obj_count;
-  };
-
-  std::optional<DBOPBucketInfo> get_bucket(const std::string& bucket_id) const;
+  std::optional<DBOPBucketInfo> get_bucket(const std::string& bucket_id
+  ) const override;
   std::vector<DBOPBucketInfo> get_bucket_by_name(const std::string& bucket_name
-  ) const;
+  ) const override;
   /// get_onwer returns bucket ownership information as a pair of
   /// (user id, display name) or nullopt
   std::optional<std::pair<std::string, std::string>> get_owner(
       const std::string& bucket_id
-  ) const;
+  ) const override;
 
-  void store_bucket(const DBOPBucketInfo& bucket) const;
-  void remove_bucket(const std::string& bucket_id) const;
+  void store_bucket(const DBOPBucketInfo& bucket) const override;
+  void remove_bucket(const std::string& bucket_id) const override;
 
-  std::vector<std::string> get_bucket_ids() const;
-  std::vector<std::string> get_bucket_ids(const std::string& user_id) const;
+  std::vector<std::string> get_bucket_ids() const override;
+  std::vector<std::string> get_bucket_ids(const std::string& user_id
+  ) const override;
 
-  std::vector<DBOPBucketInfo> get_buckets() const;
-  std::vector<DBOPBucketInfo> get_buckets(const std::string& user_id) const;
+  std::vector<DBOPBucketInfo> get_buckets() const override;
+  std::vector<DBOPBucketInfo> get_buckets(const std::string& user_id
+  ) const override;
 
-  std::vector<std::string> get_deleted_buckets_ids() const;
+  std::vector<std::string> get_deleted_buckets_ids() const override;
 
-  bool bucket_empty(const std::string& bucket_id) const;
+  bool bucket_empty(const std::string& bucket_id) const override;
   std::optional<DBDeletedObjectItems> delete_bucket_transact(
       const std::string& bucket_id, uint max_objects, bool& bucket_deleted
-  ) const;
+  ) const override;
+  /// Drop up to max_objects objects of a bucket with all their versions,
+  /// for buckets whose data is not deleted object by object. The bucket
+  /// itself is removed once it has no objects left. Returns the number
+  /// of objects dropped.
+  std::optional<size_t> drop_bucket_rows_transact(
+      const std::string& bucket_id, uint max_objects, bool& bucket_deleted
+  ) const override;
+
+  void add_bucket_data_dir(const std::string& bucket_id) const override;
+  std::vector<std::string> get_bucket_data_dirs() const override;
   const std::optional<SQLiteBuckets::Stats> get_stats(
       const std::string& bucket_id
-  ) const;
+  ) const override;
 };
 
 }  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,76 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "sqlite_content.h"
+
+#include "retry.h"
+
+using namespace sqlite_orm;
+namespace rgw::sal::sfs::sqlite {
+
+uint64_t add_content_ref(
+    StorageRef storage, const std::string& hash, uint64_t size
+) {
+  auto content = storage->get_pointer<DBContent>(hash);
+  if (!content) {
+    storage->replace(DBContent{hash, size, 1});
+    return 1;
+  }
+  const uint64_t refcount = content->refcount + 1;
+  storage->update_all(
+      set(c(&DBContent::refcount) = refcount),
+      where(is_equal(&DBContent::hash, hash))
+  );
+  return refcount;
+}
+
+SQLiteContent::SQLiteContent(DBConnRef _conn) : conn(_conn) {}
+
+std::optional<DBContent> SQLiteContent::get_content(const std::string& hash
+) const {
+  auto storage = conn->get_storage();
+  auto content = storage->get_pointer<DBContent>(hash);
+  std::optional<DBContent> ret_value;
+  if (content) {
+    ret_value = *content;
+  }
+  return ret_value;
+}
+
+uint64_t SQLiteContent::add_ref(const std::string& hash, uint64_t size)
+    const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<uint64_t> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    const uint64_t refcount = add_content_ref(storage, hash, size);
+    transaction.commit();
+    return refcount;
+  });
+  auto result = retry.run();
+  return result.has_value() ? *result : 0;
+}
+
+void SQLiteContent::set_refcount(const std::string& hash, uint64_t refcount)
+    const {
+  auto storage = conn->get_storage();
+  if (refcount == 0) {
+    storage->remove<DBContent>(hash);
+  } else {
+    storage->update_all(
+        set(c(&DBContent::refcount) = refcount),
+        where(is_equal(&DBContent::hash, hash))
+    );
+  }
+}
+
+}  // namespace rgw::sal::sfs::sqlite
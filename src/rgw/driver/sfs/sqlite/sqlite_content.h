@@ -0,0 +1,49 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include "content/content_definitions.h"
+#include "dbconn.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Count one more reference to `hash`, adding the entry if needed. Runs
+/// in the caller's transaction, so the reference is counted together
+/// with the version holding it. Returns the new reference count.
+uint64_t add_content_ref(
+    StorageRef storage, const std::string& hash, uint64_t size
+);
+
+class SQLiteContent {
+  DBConnRef conn;
+
+ public:
+  explicit SQLiteContent(DBConnRef _conn);
+  virtual ~SQLiteContent() = default;
+
+  SQLiteContent(const SQLiteContent&) = delete;
+  SQLiteContent& operator=(const SQLiteContent&) = delete;
+
+  std::optional<DBContent> get_content(const std::string& hash) const;
+
+  /// Count one more reference to `hash`, adding the entry if needed.
+  /// Returns the new reference count.
+  uint64_t add_ref(const std::string& hash, uint64_t size) const;
+
+  /// Set the reference count of `hash`. The entry is removed when it
+  /// drops to zero.
+  void set_refcount(const std::string& hash, uint64_t refcount) const;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
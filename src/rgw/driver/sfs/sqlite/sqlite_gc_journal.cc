@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "sqlite_gc_journal.h"
+
+#include "retry.h"
+
+using namespace sqlite_orm;
+namespace rgw::sal::sfs::sqlite {
+
+SQLiteGCJournal::SQLiteGCJournal(DBConnRef _conn) : conn(_conn) {}
+
+void SQLiteGCJournal::enqueue(GCJournalKind kind, const std::string& ref)
+    const {
+  auto storage = conn->get_storage();
+  DBGCJournalEntry entry{0, kind, ref, ceph::real_clock::now()};
+  RetrySQLiteBusy<int> retry([&]() { return storage->insert(entry); });
+  retry.run();
+}
+
+void SQLiteGCJournal::enqueue(
+    GCJournalKind kind, const std::vector<std::string>& refs
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    const auto now = ceph::real_clock::now();
+    for (const auto& ref : refs) {
+      storage->insert(DBGCJournalEntry{0, kind, ref, now});
+    }
+    transaction.commit();
+    return true;
+  });
+  retry.run();
+}
+
+DBGCJournalEntries SQLiteGCJournal::get_entries(uint max) const {
+  auto storage = conn->get_storage();
+  return storage->get_all<DBGCJournalEntry>(
+      order_by(&DBGCJournalEntry::id), limit(max)
+  );
+}
+
+int SQLiteGCJournal::get_last_id() const {
+  auto storage = conn->get_storage();
+  const auto last = storage->max(&DBGCJournalEntry::id);
+  return last ? *last : 0;
+}
+
+void SQLiteGCJournal::remove_entries(const std::vector<int>& ids) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    storage->remove_all<DBGCJournalEntry>(
+        where(in(&DBGCJournalEntry::id, ids))
+    );
+    return true;
+  });
+  retry.run();
+}
+
+void SQLiteGCJournal::remove_entries_up_to(int id) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    storage->remove_all<DBGCJournalEntry>(
+        where(lesser_or_equal(&DBGCJournalEntry::id, id))
+    );
+    return true;
+  });
+  retry.run();
+}
+
+}  // namespace rgw::sal::sfs::sqlite
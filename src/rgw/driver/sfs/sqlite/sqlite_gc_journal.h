@@ -0,0 +1,43 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include "dbconn.h"
+#include "gc/gc_journal_definitions.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+class SQLiteGCJournal {
+  DBConnRef conn;
+
+ public:
+  explicit SQLiteGCJournal(DBConnRef _conn);
+  virtual ~SQLiteGCJournal() = default;
+
+  SQLiteGCJournal(const SQLiteGCJournal&) = delete;
+  SQLiteGCJournal& operator=(const SQLiteGCJournal&) = delete;
+
+  void enqueue(GCJournalKind kind, const std::string& ref) const;
+  /// Enqueue one entry per ref, in a single transaction.
+  void enqueue(GCJournalKind kind, const std::vector<std::string>& refs) const;
+  /// Oldest `max` entries, in the order they were enqueued.
+  DBGCJournalEntries get_entries(uint max) const;
+  /// Id of the newest entry, 0 if the journal is empty.
+  int get_last_id() const;
+  void remove_entries(const std::vector<int>& ids) const;
+  /// Remove all entries up to and including `id`.
+  void remove_entries_up_to(int id) const;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -30,53 +30,67 @@ bool SQLiteList::objects(
     const std::string& bucket_id, const std::string& prefix,
     const std::string& start_after_object_name, size_t max,
     std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available
+) const {
+  out.reserve(out.size() + max);
+  return objects(
+      bucket_id, prefix, start_after_object_name, max,
+      [&out](rgw_bucket_dir_entry&& e) { out.emplace_back(std::move(e)); },
+      out_more_available
+  );
+}
+
+bool SQLiteList::objects(
+    const std::string& bucket_id, const std::string& prefix,
+    const std::string& start_after_object_name, size_t max,
+    const EntryVisitor& visit, bool* out_more_available
 ) const {
   ceph_assert(!bucket_id.empty());
 
   // more available logic: request one more than max. if we get that
   // much set out_more_available, but return only up to max
   ceph_assert(max < std::numeric_limits<size_t>::max());
-  const size_t query_limit = max + 1;
+  const uint32_t query_limit = max + 1;
+  if (out_more_available) {
+    *out_more_available = false;
+  }
 
   // ListBucket does not care about versions/instances. don't populate
   // key.instance
-  auto storage = conn->get_storage();
-  auto rows = storage->select(
-      columns(
-          &DBObject::name, &DBVersionedObject::mtime, &DBVersionedObject::etag,
-          sum(&DBVersionedObject::size)
-      ),
-      inner_join<DBVersionedObject>(
-          on(is_equal(&DBObject::uuid, &DBVersionedObject::object_id))
-      ),
-      where(
-          is_equal(&DBVersionedObject::object_state, ObjectState::COMMITTED) and
-          is_equal(&DBObject::bucket_id, bucket_id) and
-          greater_than(&DBObject::name, start_after_object_name) and
-          prefix_to_like(&DBObject::name, prefix)
-      ),
-      group_by(&DBVersionedObject::object_id)
-          .having(is_equal(
-              sqlite_orm::max(&DBVersionedObject::version_type),
-              VersionType::REGULAR
-          )),
-      order_by(&DBObject::name), limit(query_limit)
-  );
-  ceph_assert(rows.size() <= static_cast<size_t>(query_limit));
-  const size_t return_limit = std::min(max, rows.size());
-  out.reserve(return_limit);
-  for (size_t i = 0; i < return_limit; i++) {
-    const auto& row = rows[i];
+  dbapi::sqlite::database db = conn->get();
+  auto rows = db << R"sql(
+      SELECT o.name, vo.mtime, vo.etag, SUM(vo.size)
+      FROM objects as o
+      INNER JOIN versioned_objects as vo
+      ON (o.uuid = vo.object_id)
+      WHERE vo.object_state = ?
+      AND o.bucket_id = ?
+      AND o.name > ?
+      AND o.name LIKE ? ESCAPE CHAR(7)
+      GROUP BY vo.object_id
+      HAVING MAX(vo.version_type) = ?
+      ORDER BY o.name ASC
+      LIMIT ?;)sql"
+                 << ObjectState::COMMITTED << bucket_id
+                 << start_after_object_name
+                 << prefix_to_escaped_like(prefix, '\a') << VersionType::REGULAR
+                 << query_limit;
+  size_t count = 0;
+  for (std::tuple<std::string, ceph::real_time, std::string, int64_t> row :
+       rows) {
+    if (count >= max) {
+      if (out_more_available) {
+        *out_more_available = true;
+      }
+      break;
+    }
     rgw_bucket_dir_entry e;
-    e.key.name = std::get<0>(row);
+    e.key.name = std::move(std::get<0>(row));
     e.meta.mtime = std::get<1>(row);
-    e.meta.etag = std::get<2>(row);
-    e.meta.size = static_cast<uint64_t>(*std::get<3>(row));
+    e.meta.etag = std::move(std::get<2>(row));
+    e.meta.size = static_cast<uint64_t>(std::get<3>(row));
     e.meta.accounted_size = e.meta.size;
-    out.emplace_back(e);
-  }
-  if (out_more_available) {
-    *out_more_available = rows.size() == query_limit;
+    visit(std::move(e));
+    count++;
   }
   return true;
 }
@@ -92,10 +106,64 @@ static uint16_t to_dentry_flag(VersionType vt, bool latest) {
   return result;
 }
 
+/// Visits up to max - count rows, returns false if rows were left
+template <typename Rows>
+static bool visit_version_rows(
+    Rows& rows, size_t max, size_t& count,
+    const SQLiteList::EntryVisitor& visit
+) {
+  for (std::tuple<
+           std::string, std::string, ceph::real_time, std::string, int64_t,
+           VersionType, bool>
+           row : rows) {
+    if (count >= max) {
+      return false;
+    }
+    rgw_bucket_dir_entry e;
+    e.key.name = std::move(std::get<0>(row));
+    e.key.instance = std::move(std::get<1>(row));
+    e.meta.mtime = std::get<2>(row);
+    e.meta.etag = std::move(std::get<3>(row));
+    e.meta.size = std::get<4>(row);
+    e.meta.accounted_size = e.meta.size;
+    e.flags = to_dentry_flag(std::get<5>(row), std::get<6>(row));
+    visit(std::move(e));
+    count++;
+  }
+  return true;
+}
+
 bool SQLiteList::versions(
     const std::string& bucket_id, const std::string& prefix,
     const std::string& start_after_object_name, size_t max,
     std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available
+) const {
+  return versions(
+      bucket_id, prefix, start_after_object_name, "", max, out,
+      out_more_available
+  );
+}
+
+bool SQLiteList::versions(
+    const std::string& bucket_id, const std::string& prefix,
+    const std::string& start_after_object_name,
+    const std::string& start_after_version_id, size_t max,
+    std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available
+) const {
+  out.reserve(out.size() + max);
+  return versions(
+      bucket_id, prefix, start_after_object_name, start_after_object_name,
+      start_after_version_id, max,
+      [&out](rgw_bucket_dir_entry&& e) { out.emplace_back(std::move(e)); },
+      out_more_available
+  );
+}
+
+bool SQLiteList::versions(
+    const std::string& bucket_id, const std::string& prefix,
+    const std::string& start_after_object_name, const std::string& key_marker,
+    const std::string& start_after_version_id, size_t max,
+    const EntryVisitor& visit, bool* out_more_available
 ) const {
   ceph_assert(!bucket_id.empty());
 
@@ -104,6 +172,61 @@ bool SQLiteList::versions(
   ceph_assert(max < std::numeric_limits<size_t>::max());
   const uint32_t query_limit = max + 1;
   dbapi::sqlite::database db = conn->get();
+  if (out_more_available) {
+    *out_more_available = false;
+  }
+  size_t count = 0;
+
+  // With a version id marker the listing resumes inside the marker
+  // object: first return its versions older than the marker, by
+  // (commit_time, id) as in the ORDER BY below, then continue with the
+  // following names. Both are range scans on
+  // vobjs_objid_commit_time_id_idx. An unknown version id yields no
+  // rows here and the listing continues after the marker name.
+  if (!key_marker.empty() && !start_after_version_id.empty()) {
+    // listings show versions without version id as "null"
+    const std::string marker_version_id =
+        start_after_version_id == "null" ? "" : start_after_version_id;
+    auto rows = db << R"sql(
+        SELECT
+           o.name, vo.version_id, vo.mtime, vo.etag, vo.size, vo.version_type,
+           (vo.id = ( SELECT id FROM versioned_objects
+             WHERE object_id = o.uuid
+             AND object_state = ?
+             ORDER BY commit_time desc, id desc
+             LIMIT 1
+           )) AS is_latest
+        FROM objects as o
+        INNER JOIN versioned_objects as vo
+        ON (o.uuid = vo.object_id)
+        WHERE vo.object_state = ?
+        AND o.bucket_id = ?
+        AND o.name = ?
+        AND o.name LIKE ? ESCAPE CHAR(7)
+        AND (vo.commit_time, vo.id) < (
+          SELECT commit_time, id FROM versioned_objects
+          WHERE object_id = o.uuid
+          AND object_state = ?
+          AND version_id = ?
+          ORDER BY commit_time DESC, id DESC
+          LIMIT 1
+        )
+        ORDER BY vo.commit_time DESC,
+          vo.id DESC
+        LIMIT ?;)sql"
+                 << ObjectState::COMMITTED << ObjectState::COMMITTED
+                 << bucket_id << key_marker
+                 << prefix_to_escaped_like(prefix, '\a')
+                 << ObjectState::COMMITTED << marker_version_id
+                 << query_limit;
+    if (!visit_version_rows(rows, max, count, visit)) {
+      if (out_more_available) {
+        *out_more_available = true;
+      }
+      return true;
+    }
+  }
+
   auto rows = db << R"sql(
       SELECT
          o.name, vo.version_id, vo.mtime, vo.etag, vo.size, vo.version_type,
@@ -126,32 +249,42 @@ bool SQLiteList::versions(
       LIMIT ?;)sql"
                  << ObjectState::COMMITTED << ObjectState::COMMITTED
                  << bucket_id << start_after_object_name
-                 << prefix_to_escaped_like(prefix, '\a') << query_limit;
-  out.reserve(max);
-  if (out_more_available) {
-    *out_more_available = false;
+                 << prefix_to_escaped_like(prefix, '\a')
+                 << static_cast<uint32_t>(query_limit - count);
+  if (!visit_version_rows(rows, max, count, visit) && out_more_available) {
+    *out_more_available = true;
   }
-  for (std::tuple<
-           std::string, std::string, ceph::real_time, std::string, int64_t,
-           VersionType, bool>
-           row : rows) {
-    if (out.size() >= max) {
-      if (out_more_available) {
-        *out_more_available = true;
-      }
-      break;
+
+  return true;
+}
+
+CommonPrefixRollup::CommonPrefixRollup(
+    const std::string& _find_after_prefix, const std::string& _delimiter,
+    std::map<std::string, bool>& _out_common_prefixes
+)
+    : find_after_prefix(_find_after_prefix),
+      delimiter(_delimiter),
+      out_common_prefixes(_out_common_prefixes) {}
+
+bool CommonPrefixRollup::add(const rgw_bucket_dir_entry& entry) {
+  const std::string& name = entry.key.name;
+  // Same prefix -> skip
+  if (prefix != nullptr && name.starts_with(*prefix)) {
+    return false;
+  }
+  if (name.starts_with(find_after_prefix)) {
+    // Found delim -> add, remember prefix
+    auto delim_pos = name.find(delimiter, find_after_prefix.length());
+    if (delim_pos != name.npos) {
+      const auto common_prefix =
+          name.substr(0, delim_pos + delimiter.length());
+      prefix = &out_common_prefixes.emplace(common_prefix, true).first->first;
+      next_marker = *prefix;
+      return false;
     }
-    rgw_bucket_dir_entry e;
-    e.key.name = std::get<0>(row);
-    e.key.instance = std::get<1>(row);
-    e.meta.mtime = std::get<2>(row);
-    e.meta.etag = std::get<3>(row);
-    e.meta.size = std::get<4>(row);
-    e.meta.accounted_size = e.meta.size;
-    e.flags = to_dentry_flag(std::get<5>(row), std::get<6>(row));
-    out.emplace_back(e);
   }
-
+  // Not found -> next
+  next_marker = name;
   return true;
 }
 
@@ -161,37 +294,17 @@ std::string SQLiteList::roll_up_common_prefixes(
     std::map<std::string, bool>& out_common_prefixes,
     std::vector<rgw_bucket_dir_entry>& out_objects
 ) const {
-  const size_t find_after_pos = find_after_prefix.length();
-  const size_t delim_len = delimiter.length();
-  std::string next_marker = "";
   if (delimiter.empty()) {
     out_objects = objects;
     return "";
   }
-  const std::string* prefix{nullptr};  // Last added prefix
-  for (size_t i = 0; i < objects.size(); i++) {
-    const std::string& name = objects[i].key.name;
-    // Same prefix -> skip
-    if (prefix != nullptr && name.starts_with(*prefix)) {
-      continue;
+  CommonPrefixRollup rollup(find_after_prefix, delimiter, out_common_prefixes);
+  for (const auto& object : objects) {
+    if (rollup.add(object)) {
+      out_objects.push_back(object);
     }
-    if (name.starts_with(find_after_prefix)) {
-      // Found delim -> add, remember prefix
-      auto delim_pos = name.find(delimiter, find_after_pos);
-      if (delim_pos != name.npos) {
-        prefix = &out_common_prefixes
-                      .emplace(name.substr(0, delim_pos + delim_len), true)
-                      .first->first;
-        next_marker = *prefix;
-        continue;
-      }
-    }
-    // Not found -> next
-    out_objects.push_back(objects[i]);
-    next_marker = objects[i].key.name;
   }
-
-  return next_marker;
+  return rollup.get_next_marker();
 }
 
 }  // namespace rgw::sal::sfs::sqlite
@@ -11,17 +11,43 @@
  */
 #pragma once
 
+#include <functional>
+
 #include "dbconn.h"
+#include "rgw/driver/sfs/metadata_backend.h"
 #include "rgw_sal.h"
 
 namespace rgw::sal::sfs::sqlite {
 
-class SQLiteList {
+/// CommonPrefixRollup is the incremental form of
+/// SQLiteList::roll_up_common_prefixes. Feed it entries in listing
+/// order; add() returns false for entries rolled up into a common
+/// prefix and true for those that are listed as they are.
+class CommonPrefixRollup {
+  const std::string& find_after_prefix;
+  const std::string& delimiter;
+  std::map<std::string, bool>& out_common_prefixes;
+  const std::string* prefix{nullptr};  // Last added prefix
+  std::string next_marker;
+
+ public:
+  CommonPrefixRollup(
+      const std::string& _find_after_prefix, const std::string& _delimiter,
+      std::map<std::string, bool>& _out_common_prefixes
+  );
+
+  bool add(const rgw_bucket_dir_entry& entry);
+
+  /// Name of the last entry or common prefix added
+  const std::string& get_next_marker() const { return next_marker; }
+};
+
+class SQLiteList : public ListBackend {
   DBConnRef conn;
 
  public:
   explicit SQLiteList(DBConnRef _conn);
-  virtual ~SQLiteList() = default;
+  ~SQLiteList() override = default;
 
   /// objects lists committed objects in bucket, with optional prefix
   /// search and pagination (max, start_after_object_name). Optionally
@@ -31,7 +57,14 @@ class SQLiteList {
       const std::string& bucket_id, const std::string& prefix,
       const std::string& start_after_object_name, size_t max,
       std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available = nullptr
-  ) const;
+  ) const override;
+
+  /// objects, handing each entry to visit instead of collecting them
+  bool objects(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name, size_t max,
+      const EntryVisitor& visit, bool* out_more_available = nullptr
+  ) const override;
 
   /// versions lists committed objects versions in bucket, with
   /// optional prefix search and pagination (max,
@@ -41,7 +74,31 @@ class SQLiteList {
       const std::string& bucket_id, const std::string& prefix,
       const std::string& start_after_object_name, size_t max,
       std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available = nullptr
-  ) const;
+  ) const override;
+
+  /// versions with a version id marker: resume after version
+  /// start_after_version_id of object start_after_object_name,
+  /// continuing with that object's older versions before moving on
+  /// to the following names. A "null" version id marker stands for the
+  /// version without version id.
+  bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name,
+      const std::string& start_after_version_id, size_t max,
+      std::vector<rgw_bucket_dir_entry>& out, bool* out_more_available = nullptr
+  ) const override;
+
+  /// versions, handing each entry to visit instead of collecting them.
+  /// The older versions of key_marker come first; the following names
+  /// start after start_after_object_name, which may be past key_marker
+  /// to skip the rest of a common prefix.
+  bool versions(
+      const std::string& bucket_id, const std::string& prefix,
+      const std::string& start_after_object_name,
+      const std::string& key_marker,
+      const std::string& start_after_version_id, size_t max,
+      const EntryVisitor& visit, bool* out_more_available = nullptr
+  ) const override;
 
   // roll_up_common_prefixes performs S3 common prefix compression to
   // objects and common_prefixes.
@@ -110,6 +110,40 @@ int SQLiteMultipart::abort_multiparts_by_bucket_id(const std::string& bucket_id
   return num_changes;
 }
 
+std::vector<std::string>
+SQLiteMultipart::abort_multiparts_initiated_before_transact(
+    const std::string& bucket_id, const std::string& prefix,
+    const ceph::real_time& cutoff, uint max
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<std::vector<std::string>> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    auto upload_ids = storage->select(
+        &DBMultipart::upload_id,
+        where(
+            is_equal(&DBMultipart::bucket_id, bucket_id) and
+            greater_or_equal(&DBMultipart::state, MultipartState::INIT) and
+            lesser_than(&DBMultipart::state, MultipartState::COMPLETE) and
+            lesser_or_equal(&DBMultipart::mtime, cutoff) and
+            prefix_to_like(&DBMultipart::object_name, prefix)
+        ),
+        order_by(&DBMultipart::id), limit(max)
+    );
+    if (!upload_ids.empty()) {
+      storage->update_all(
+          set(c(&DBMultipart::state) = MultipartState::ABORTED,
+              c(&DBMultipart::state_change_time) =
+                  ceph::real_time::clock::now()),
+          where(in(&DBMultipart::upload_id, upload_ids))
+      );
+    }
+    transaction.commit();
+    return upload_ids;
+  });
+  auto result = retry.run();
+  return result.has_value() ? result.value() : std::vector<std::string>{};
+}
+
 int SQLiteMultipart::abort_multiparts(const std::string& bucket_name) const {
   auto storage = conn->get_storage();
   auto bucket_ids_vec = storage->select(
@@ -266,6 +300,8 @@ std::optional<DBMultipartPart> SQLiteMultipart::create_or_reset_part(
       part.size = 0;
       part.etag = std::nullopt;
       part.mtime = std::nullopt;
+      part.compression = std::nullopt;
+      part.crc32c = std::nullopt;
       try {
         storage->replace(part);
       } catch (const std::system_error& e) {
@@ -282,6 +318,8 @@ std::optional<DBMultipartPart> SQLiteMultipart::create_or_reset_part(
           .size = 0,
           .etag = std::nullopt,
           .mtime = std::nullopt,
+          .compression = std::nullopt,
+          .crc32c = std::nullopt,
       };
       try {
         part.id = storage->insert(part);
@@ -304,14 +342,18 @@ std::optional<DBMultipartPart> SQLiteMultipart::create_or_reset_part(
 
 bool SQLiteMultipart::finish_part(
     const std::string& upload_id, uint32_t part_num, const std::string& etag,
-    uint64_t bytes_written
+    uint64_t bytes_written,
+    const std::optional<RGWCompressionInfo>& compression,
+    std::optional<uint32_t> crc32c
 ) const {
   auto storage = conn->get_storage();
   bool committed = storage->transaction([&]() mutable {
     storage->update_all(
         set(c(&DBMultipartPart::etag) = etag,
             c(&DBMultipartPart::mtime) = ceph::real_time::clock::now(),
-            c(&DBMultipartPart::size) = bytes_written),
+            c(&DBMultipartPart::size) = bytes_written,
+            c(&DBMultipartPart::compression) = compression,
+            c(&DBMultipartPart::crc32c) = crc32c),
         where(
             is_equal(&DBMultipartPart::upload_id, upload_id) and
             is_equal(&DBMultipartPart::part_num, part_num) and
@@ -576,4 +618,52 @@ SQLiteMultipart::remove_done_or_aborted_multiparts_transact(uint max_items
   return retry.run();
 }
 
+std::optional<DBDeletedMultipartItems>
+SQLiteMultipart::remove_done_or_aborted_multipart_transact(
+    const std::string& upload_id, uint max_items
+) const {
+  DBDeletedMultipartItems ret_parts;
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<DBDeletedMultipartItems> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    ret_parts = storage->select(
+        columns(
+            &DBMultipart::upload_id, &DBMultipart::path_uuid,
+            &DBMultipartPart::id
+        ),
+        inner_join<DBMultipart>(
+            on(is_equal(&DBMultipart::upload_id, &DBMultipartPart::upload_id))
+        ),
+        where(
+            is_equal(&DBMultipart::upload_id, upload_id) and
+            (is_equal(&DBMultipart::state, MultipartState::DONE) or
+             is_equal(&DBMultipart::state, MultipartState::ABORTED))
+        ),
+        order_by(&DBMultipartPart::id), limit(max_items)
+    );
+    std::vector<int> ids;
+    ids.reserve(ret_parts.size());
+    std::ranges::transform(
+        ret_parts, std::back_inserter(ids),
+        [](DBDeletedMultipartItem item) -> int { return get_part_id(item); }
+    );
+    storage->remove_all<DBMultipartPart>(where(in(&DBMultipartPart::id, ids)));
+
+    auto nb_parts = storage->count(
+        &DBMultipartPart::id,
+        where(is_equal(&DBMultipartPart::upload_id, upload_id))
+    );
+    if (nb_parts == 0) {
+      storage->remove_all<DBMultipart>(where(
+          is_equal(&DBMultipart::upload_id, upload_id) and
+          (is_equal(&DBMultipart::state, MultipartState::DONE) or
+           is_equal(&DBMultipart::state, MultipartState::ABORTED))
+      ));
+    }
+    transaction.commit();
+    return ret_parts;
+  });
+  return retry.run();
+}
+
 }  // namespace rgw::sal::sfs::sqlite
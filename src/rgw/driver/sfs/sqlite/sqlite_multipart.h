@@ -15,15 +15,16 @@
 #define RGW_DRIVER_SFS_SQLITE_SQLITE_MULTIPART_H
 
 #include "dbconn.h"
+#include "rgw/driver/sfs/metadata_backend.h"
 
 namespace rgw::sal::sfs::sqlite {
 
-class SQLiteMultipart {
+class SQLiteMultipart : public MultipartBackend {
   DBConnRef conn;
 
  public:
   explicit SQLiteMultipart(DBConnRef _conn);
-  virtual ~SQLiteMultipart() = default;
+  ~SQLiteMultipart() override = default;
 
   /**
    * @brief Obtain a vector of all multipart uploads on a given bucket,
@@ -43,7 +44,7 @@ class SQLiteMultipart {
       const std::string& bucket_name, const std::string& prefix,
       const std::string& marker, const std::string& delim,
       const int& max_uploads, bool* is_truncated
-  ) const;
+  ) const override;
 
   /**
    * @brief Obtain a vector of all multipart uploads on a given bucket,
@@ -63,7 +64,7 @@ class SQLiteMultipart {
       const std::string& bucket_id, const std::string& prefix,
       const std::string& marker, const std::string& delim,
       const int& max_uploads, bool* is_truncated, bool get_all
-  ) const;
+  ) const override;
 
   /**
    * @brief Abort on-going multipart uploads on a given bucket.
@@ -73,7 +74,7 @@ class SQLiteMultipart {
    * @return the number of aborted multipart uploads, or negative in case of
    * error.
    */
-  int abort_multiparts(const std::string& bucket_name) const;
+  int abort_multiparts(const std::string& bucket_name) const override;
 
   /**
    * @brief Abort on-going multipart uploads on a given bucket.
@@ -81,7 +82,20 @@ class SQLiteMultipart {
    * @param bucket_id The ID of the bucket for which multipart uploads will be aborted.
    * @return the number of aborted multipart uploads.
    */
-  int abort_multiparts_by_bucket_id(const std::string& bucket_id) const;
+  int abort_multiparts_by_bucket_id(const std::string& bucket_id
+  ) const override;
+
+  /**
+   * @brief Abort up to `max` on-going multipart uploads on a given bucket,
+   * for objects whose name starts with `prefix`, initiated at or before
+   * `cutoff`.
+   *
+   * @return the upload IDs of the aborted multipart uploads.
+   */
+  std::vector<std::string> abort_multiparts_initiated_before_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint max
+  ) const override;
 
   /**
    * @brief Get the converted Multipart entry from the database.
@@ -89,7 +103,8 @@ class SQLiteMultipart {
    * @param upload_id The Multipart Upload's ID to obtain.
    * @return Multipart Upload entry, or `nullopt` if not found.
    */
-  std::optional<DBMultipart> get_multipart(const std::string& upload_id) const;
+  std::optional<DBMultipart> get_multipart(const std::string& upload_id
+  ) const override;
 
   /**
    * @brief Get the converted Multipart entry from the database.
@@ -97,7 +112,7 @@ class SQLiteMultipart {
    * @param id The Multipart Upload's ID to obtain.
    * @return Multipart Upload entry, or `nullopt` if not found.
    */
-  std::optional<DBMultipart> get_multipart(int id) const;
+  std::optional<DBMultipart> get_multipart(int id) const override;
 
   /**
    * @brief Insert a new Multipart Upload entry into the database.
@@ -105,7 +120,7 @@ class SQLiteMultipart {
    * @param mp The Multipart Upload to insert.
    * @return The new entry's ID.
    */
-  uint insert(const DBMultipart& mp) const;
+  uint insert(const DBMultipart& mp) const override;
 
   /**
    * @brief Obtains a vector of DB multipart part entries.
@@ -120,7 +135,7 @@ class SQLiteMultipart {
   std::vector<DBMultipartPart> list_parts(
       const std::string& upload_id, int num_parts, int marker, int* next_marker,
       bool* truncated
-  ) const;
+  ) const override;
 
   /**
    * @brief Obtains a vector of a multipart upload's parts, ordered by part num.
@@ -128,7 +143,8 @@ class SQLiteMultipart {
    * @param upload_id The upload id for which to obtain parts.
    * @return std::vector<DBMultipartPart>
    */
-  std::vector<DBMultipartPart> get_parts(const std::string& upload_id) const;
+  std::vector<DBMultipartPart> get_parts(const std::string& upload_id
+  ) const override;
 
   /**
    * @brief Obtain a single part for a given multipart upload.
@@ -139,7 +155,7 @@ class SQLiteMultipart {
    */
   std::optional<DBMultipartPart> get_part(
       const std::string& upload_id, uint32_t part_num
-  ) const;
+  ) const override;
 
   /**
    * @brief Either creates a new part if it doesn't exist, or resets an existing
@@ -151,7 +167,7 @@ class SQLiteMultipart {
    */
   std::optional<DBMultipartPart> create_or_reset_part(
       const std::string& upload_id, uint32_t part_num, std::string* error_str
-  ) const;
+  ) const override;
 
   /**
    * @brief Finish a given individual part's upload.
@@ -160,13 +176,17 @@ class SQLiteMultipart {
    * @param part_num The part's number.
    * @param etag The part's etag.
    * @param bytes_written Number of bytes written during this part's upload.
+   * @param compression The part's compression info, if it was compressed.
+   * @param crc32c The crc32c of the part's data, if known.
    * @return true The database was properly updated with this information.
    * @return false The database was not updated.
    */
   bool finish_part(
       const std::string& upload_id, uint32_t part_num, const std::string& etag,
-      uint64_t bytes_written
-  ) const;
+      uint64_t bytes_written,
+      const std::optional<RGWCompressionInfo>& compression = std::nullopt,
+      std::optional<uint32_t> crc32c = std::nullopt
+  ) const override;
 
   /**
    * @brief Abort an on-going Multipart Upload.
@@ -174,7 +194,7 @@ class SQLiteMultipart {
    * @param upload_id The Multipart Upload's ID to abort.
    * @return Whether the Multipart Upload was aborted.
    */
-  bool abort(const std::string& upload_id) const;
+  bool abort(const std::string& upload_id) const override;
 
   /**
    * @brief Mark an on-going Multipart Upload as being complete.
@@ -185,7 +205,8 @@ class SQLiteMultipart {
    * @return true if a multipart upload was marked complete.
    * @return false if no multipart upload was found.
    */
-  bool mark_complete(const std::string& upload_id, bool* duplicate) const;
+  bool mark_complete(const std::string& upload_id, bool* duplicate
+  ) const override;
 
   /**
    * @brief Mark an on-going Multipart Upload as being aggregating its multiple
@@ -195,7 +216,7 @@ class SQLiteMultipart {
    * @return true if a multipart upload was marked as aggregating.
    * @return false if no multipart upload was found.
    */
-  bool mark_aggregating(const std::string& upload_id) const;
+  bool mark_aggregating(const std::string& upload_id) const override;
 
   /**
    * @brief Mark an on-going Multipart Upload as being done, nothing more to do.
@@ -204,21 +225,22 @@ class SQLiteMultipart {
    * @return true if a multipart upload was marked as done.
    * @return false if no multipart upload was found.
    */
-  bool mark_done(const std::string& upload_id) const;
+  bool mark_done(const std::string& upload_id) const override;
 
   /**
    * @brief Remove all parts for the specified multipart upload.
    *
    * @param upload_id The Multipart Upload's ID.
    */
-  void remove_parts(const std::string& upload_id) const;
+  void remove_parts(const std::string& upload_id) const override;
 
   /**
    * @brief Remove all multipart uploads from a specific bucket.
    *
    * @param bucket_id The bucket ID for which to remove multipart uploads.
    */
-  void remove_multiparts_by_bucket_id(const std::string& bucket_id) const;
+  void remove_multiparts_by_bucket_id(const std::string& bucket_id
+  ) const override;
 
   /**
   * @brief Removes multiparts and returns the IDs that identify those parts in the filesystem
@@ -228,7 +250,7 @@ class SQLiteMultipart {
   std::optional<DBDeletedMultipartItems>
   remove_multiparts_by_bucket_id_transact(
       const std::string& bucket_id, uint max_items
-  ) const;
+  ) const override;
 
   /**
   * @brief Removes multiparts that are done or aborted and returns the IDs that identify those parts in the filesystem
@@ -236,7 +258,18 @@ class SQLiteMultipart {
   * @return List of <object_uuid, part_id> that identifies the parts in the filesystem
   */
   std::optional<DBDeletedMultipartItems>
-  remove_done_or_aborted_multiparts_transact(uint max_items) const;
+  remove_done_or_aborted_multiparts_transact(uint max_items) const override;
+
+  /**
+  * @brief Like remove_done_or_aborted_multiparts_transact(), for upload
+  * `upload_id` only
+  * @param max_items Max parts to be deleted in this call
+  * @return List of <object_uuid, part_id> that identifies the parts in the filesystem
+  */
+  std::optional<DBDeletedMultipartItems>
+  remove_done_or_aborted_multipart_transact(
+      const std::string& upload_id, uint max_items
+  ) const override;
 };
 
 }  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,192 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "sqlite_notifications.h"
+
+#include "retry.h"
+
+using namespace sqlite_orm;
+namespace rgw::sal::sfs::sqlite {
+
+namespace {
+
+// Replace the row of type Row stored under key, checking its version
+// against expected_version first.
+template <typename Row>
+uint64_t store_versioned(
+    StorageRef storage, const std::string& key, const std::vector<char>& topics,
+    std::optional<uint64_t> expected_version
+) {
+  RetrySQLiteBusy<uint64_t> retry([&]() -> uint64_t {
+    auto transaction = storage->transaction_guard();
+    const auto row = storage->get_pointer<Row>(key);
+    const uint64_t version = row ? row->version : 0;
+    if (expected_version.has_value() && *expected_version != version) {
+      transaction.rollback();
+      return 0;
+    }
+    storage->replace(Row{key, topics, version + 1});
+    transaction.commit();
+    return version + 1;
+  });
+  const auto result = retry.run();
+  return result.has_value() ? result.value() : 0;
+}
+
+template <typename Row>
+bool remove_row(StorageRef storage, const std::string& key) {
+  RetrySQLiteBusy<bool> retry([&]() {
+    storage->remove<Row>(key);
+    return storage->changes() > 0;
+  });
+  const auto result = retry.run();
+  return result.has_value() && result.value();
+}
+
+}  // namespace
+
+SQLiteNotifications::SQLiteNotifications(DBConnRef _conn) : conn(_conn) {}
+
+std::optional<DBTopics> SQLiteNotifications::get_topics(
+    const std::string& tenant
+) const {
+  auto storage = conn->get_storage();
+  const auto row = storage->get_pointer<DBTopics>(tenant);
+  if (!row) {
+    return std::nullopt;
+  }
+  return *row;
+}
+
+uint64_t SQLiteNotifications::store_topics(
+    const std::string& tenant, const std::vector<char>& topics,
+    std::optional<uint64_t> expected_version
+) const {
+  return store_versioned<DBTopics>(
+      conn->get_storage(), tenant, topics, expected_version
+  );
+}
+
+bool SQLiteNotifications::remove_topics(const std::string& tenant) const {
+  return remove_row<DBTopics>(conn->get_storage(), tenant);
+}
+
+std::optional<DBBucketTopics> SQLiteNotifications::get_bucket_topics(
+    const std::string& bucket_id
+) const {
+  auto storage = conn->get_storage();
+  const auto row = storage->get_pointer<DBBucketTopics>(bucket_id);
+  if (!row) {
+    return std::nullopt;
+  }
+  return *row;
+}
+
+uint64_t SQLiteNotifications::store_bucket_topics(
+    const std::string& bucket_id, const std::vector<char>& topics,
+    std::optional<uint64_t> expected_version
+) const {
+  return store_versioned<DBBucketTopics>(
+      conn->get_storage(), bucket_id, topics, expected_version
+  );
+}
+
+bool SQLiteNotifications::remove_bucket_topics(const std::string& bucket_id
+) const {
+  return remove_row<DBBucketTopics>(conn->get_storage(), bucket_id);
+}
+
+void SQLiteNotifications::enqueue_events(const DBNotificationEvents& events
+) const {
+  if (events.empty()) {
+    return;
+  }
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    for (const auto& event : events) {
+      storage->insert(event);
+    }
+    transaction.commit();
+    return true;
+  });
+  retry.run();
+}
+
+DBNotificationEvents SQLiteNotifications::get_due_events(
+    const ceph::real_time& now, uint max
+) const {
+  auto storage = conn->get_storage();
+  return storage->get_all<DBNotificationEvent>(
+      where(lesser_or_equal(&DBNotificationEvent::next_attempt, now)),
+      order_by(&DBNotificationEvent::id), limit(max)
+  );
+}
+
+void SQLiteNotifications::remove_events(const std::vector<int64_t>& ids
+) const {
+  if (ids.empty()) {
+    return;
+  }
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    storage->remove_all<DBNotificationEvent>(
+        where(in(&DBNotificationEvent::id, ids))
+    );
+    return true;
+  });
+  retry.run();
+}
+
+void SQLiteNotifications::reschedule_events(
+    const std::vector<int64_t>& ids, const ceph::real_time& next_attempt
+) const {
+  if (ids.empty()) {
+    return;
+  }
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    storage->update_all(
+        set(c(&DBNotificationEvent::next_attempt) = next_attempt,
+            c(&DBNotificationEvent::attempts) =
+                c(&DBNotificationEvent::attempts) + 1),
+        where(in(&DBNotificationEvent::id, ids))
+    );
+    return true;
+  });
+  retry.run();
+}
+
+void SQLiteNotifications::postpone_events(
+    const std::vector<int64_t>& ids, const ceph::real_time& next_attempt
+) const {
+  if (ids.empty()) {
+    return;
+  }
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    storage->update_all(
+        set(c(&DBNotificationEvent::next_attempt) = next_attempt),
+        where(in(&DBNotificationEvent::id, ids))
+    );
+    return true;
+  });
+  retry.run();
+}
+
+uint64_t SQLiteNotifications::count_events() const {
+  auto storage = conn->get_storage();
+  return storage->count<DBNotificationEvent>();
+}
+
+}  // namespace rgw::sal::sfs::sqlite
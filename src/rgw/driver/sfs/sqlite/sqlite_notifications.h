@@ -0,0 +1,73 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "dbconn.h"
+#include "notifications/notification_definitions.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+class SQLiteNotifications {
+  DBConnRef conn;
+
+ public:
+  explicit SQLiteNotifications(DBConnRef _conn);
+  virtual ~SQLiteNotifications() = default;
+
+  SQLiteNotifications(const SQLiteNotifications&) = delete;
+  SQLiteNotifications& operator=(const SQLiteNotifications&) = delete;
+
+  std::optional<DBTopics> get_topics(const std::string& tenant) const;
+  /// Store the topics of tenant. If expected_version is given the
+  /// stored version must match it, 0 meaning nothing is stored yet.
+  /// Returns the new version, or 0 if the version did not match.
+  uint64_t store_topics(
+      const std::string& tenant, const std::vector<char>& topics,
+      std::optional<uint64_t> expected_version
+  ) const;
+  /// Returns false if tenant had no topics.
+  bool remove_topics(const std::string& tenant) const;
+
+  std::optional<DBBucketTopics> get_bucket_topics(const std::string& bucket_id
+  ) const;
+  /// As store_topics(), for the notification configuration of a bucket.
+  uint64_t store_bucket_topics(
+      const std::string& bucket_id, const std::vector<char>& topics,
+      std::optional<uint64_t> expected_version
+  ) const;
+  bool remove_bucket_topics(const std::string& bucket_id) const;
+
+  /// Queue events for delivery, in a single transaction. Ids are
+  /// assigned by the database.
+  void enqueue_events(const DBNotificationEvents& events) const;
+  /// Up to max events whose next attempt is due at now, oldest first.
+  DBNotificationEvents get_due_events(const ceph::real_time& now, uint max)
+      const;
+  void remove_events(const std::vector<int64_t>& ids) const;
+  /// Count a failed attempt for each event and retry at next_attempt.
+  void reschedule_events(
+      const std::vector<int64_t>& ids, const ceph::real_time& next_attempt
+  ) const;
+  /// Retry events at next_attempt without counting an attempt.
+  void postpone_events(
+      const std::vector<int64_t>& ids, const ceph::real_time& next_attempt
+  ) const;
+  uint64_t count_events() const;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
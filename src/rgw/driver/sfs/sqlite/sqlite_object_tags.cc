@@ -0,0 +1,157 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "sqlite_object_tags.h"
+
+#include <fmt/format.h>
+
+#include "rgw/driver/sfs/object_state.h"
+#include "rgw/driver/sfs/version_type.h"
+#include "rgw/rgw_tag.h"
+
+using namespace sqlite_orm;
+
+namespace rgw::sal::sfs::sqlite {
+
+static constexpr uint OBJECT_TAGS_BACKFILL_BATCH = 1000;
+
+DBObjectTagSet decode_object_tags(const rgw::sal::Attrs& attrs) {
+  DBObjectTagSet tags;
+  const auto it = attrs.find(RGW_ATTR_TAGS);
+  if (it == attrs.end()) {
+    return tags;
+  }
+  RGWObjTags obj_tags;
+  try {
+    auto bl_iter = it->second.cbegin();
+    obj_tags.decode(bl_iter);
+  } catch (const ceph::buffer::error&) {
+    return tags;
+  }
+  tags.reserve(obj_tags.count());
+  for (const auto& [key, value] : obj_tags.get_tags()) {
+    tags.emplace_back(key, value);
+  }
+  return tags;
+}
+
+void store_object_tags(StorageRef storage, const DBVersionedObject& version) {
+  storage->remove_all<DBObjectTag>(
+      where(is_equal(&DBObjectTag::version_id, version.id))
+  );
+  if (version.version_type != VersionType::REGULAR) {
+    return;
+  }
+  const auto tags = decode_object_tags(version.attrs);
+  if (tags.empty()) {
+    return;
+  }
+  const auto bucket_ids = storage->select(
+      &DBObject::bucket_id, where(is_equal(&DBObject::uuid, version.object_id))
+  );
+  if (bucket_ids.empty()) {
+    return;
+  }
+  for (const auto& [key, value] : tags) {
+    storage->replace(DBObjectTag{version.id, bucket_ids.front(), key, value});
+  }
+}
+
+void backfill_object_tags(DBConn& conn) {
+  auto storage = conn.get_storage();
+  auto transaction = storage->transaction_guard();
+  uint after = 0;
+  for (;;) {
+    const auto versions = storage->get_all<DBVersionedObject>(
+        where(
+            greater_than(&DBVersionedObject::id, after) and
+            is_equal(&DBVersionedObject::version_type, VersionType::REGULAR) and
+            is_not_equal(&DBVersionedObject::object_state, ObjectState::DELETED)
+        ),
+        order_by(&DBVersionedObject::id), limit(OBJECT_TAGS_BACKFILL_BATCH)
+    );
+    for (const auto& version : versions) {
+      store_object_tags(storage, version);
+    }
+    if (versions.size() < OBJECT_TAGS_BACKFILL_BATCH) {
+      break;
+    }
+    after = versions.back().id;
+  }
+  transaction.commit();
+}
+
+std::string object_tags_condition(
+    std::string_view version_id_column, size_t count
+) {
+  std::string condition;
+  for (size_t i = 0; i < count; i++) {
+    condition += fmt::format(
+        R"sql(
+      AND EXISTS (
+        SELECT 1 FROM object_tags AS t
+        WHERE t.version_id = {}
+        AND t.key = ? AND t.value = ?
+      ))sql",
+        version_id_column
+    );
+  }
+  return condition;
+}
+
+SQLiteObjectTags::SQLiteObjectTags(DBConnRef _conn) : conn(_conn) {}
+
+std::vector<SQLiteObjectTags::Match> SQLiteObjectTags::list_current_objects(
+    const std::string& bucket_id, const std::string& key,
+    const std::optional<std::string>& value, const std::string& start_after,
+    uint max
+) const {
+  dbapi::sqlite::database db = conn->get();
+  auto rows = db << fmt::format(
+                        R"sql(
+      SELECT o.name, vo.version_id, t.value
+      FROM object_tags AS t
+      INNER JOIN versioned_objects AS vo ON (vo.id = t.version_id)
+      INNER JOIN objects AS o ON (o.uuid = vo.object_id)
+      WHERE t.bucket_id = ?
+      AND t.key = ?{}
+      AND o.name > ?
+      AND vo.object_state = ?
+      AND vo.id = (
+        SELECT id FROM versioned_objects
+        WHERE object_id = vo.object_id
+        AND object_state = ?
+        ORDER BY commit_time DESC, id DESC
+        LIMIT 1
+      )
+      ORDER BY o.name ASC, t.value ASC
+      LIMIT ?;)sql",
+                        value.has_value() ? " AND t.value = ?" : ""
+                    );
+  rows << bucket_id << key;
+  if (value.has_value()) {
+    rows << *value;
+  }
+  rows << start_after << ObjectState::COMMITTED << ObjectState::COMMITTED
+       << max;
+  std::vector<Match> matches;
+  for (std::tuple<std::string, std::string, std::string> row : rows) {
+    auto& [name, version_id, tag_value] = row;
+    matches.push_back(
+        Match{std::move(name), std::move(version_id), std::move(tag_value)}
+    );
+  }
+  return matches;
+}
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,72 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dbconn.h"
+#include "object_tags/object_tags_definitions.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Tags stored in RGW_ATTR_TAGS of attrs. Empty if there are none or
+/// they don't decode.
+DBObjectTagSet decode_object_tags(const rgw::sal::Attrs& attrs);
+
+/// Replace the object_tags rows of version with the tags in its attrs.
+/// Delete markers get none. Runs in the caller's transaction, so the
+/// rows change together with the attrs.
+void store_object_tags(StorageRef storage, const DBVersionedObject& version);
+
+/// Fill object_tags from the attrs of every regular version not
+/// deleted yet. For databases that predate the table.
+void backfill_object_tags(DBConn& conn);
+
+/// SQL condition that holds if the version with id column
+/// `version_id_column` carries all of count tags. Binds a key and a
+/// value per tag.
+std::string object_tags_condition(
+    std::string_view version_id_column, size_t count
+);
+
+class SQLiteObjectTags {
+  DBConnRef conn;
+
+ public:
+  struct Match {
+    std::string name;
+    std::string version_id;
+    std::string value;
+  };
+
+  explicit SQLiteObjectTags(DBConnRef _conn);
+  virtual ~SQLiteObjectTags() = default;
+
+  SQLiteObjectTags(const SQLiteObjectTags&) = delete;
+  SQLiteObjectTags& operator=(const SQLiteObjectTags&) = delete;
+
+  /// Objects of bucket whose current version is tagged with key, and
+  /// value if given. Ordered by name, up to max of them with a name
+  /// after start_after.
+  std::vector<Match> list_current_objects(
+      const std::string& bucket_id, const std::string& key,
+      const std::optional<std::string>& value,
+      const std::string& start_after, uint max
+  ) const;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -14,29 +14,31 @@
 #pragma once
 
 #include "dbconn.h"
+#include "rgw/driver/sfs/metadata_backend.h"
 
 namespace rgw::sal::sfs::sqlite {
 
-class SQLiteObjects {
+class SQLiteObjects : public ObjectsBackend {
   DBConnRef conn;
 
  public:
   explicit SQLiteObjects(DBConnRef _conn);
-  virtual ~SQLiteObjects() = default;
+  ~SQLiteObjects() override = default;
 
   SQLiteObjects(const SQLiteObjects&) = delete;
   SQLiteObjects& operator=(const SQLiteObjects&) = delete;
 
-  std::vector<DBObject> get_objects(const std::string& bucket_id) const;
+  std::vector<DBObject> get_objects(const std::string& bucket_id
+  ) const override;
 
-  std::optional<DBObject> get_object(const uuid_d& uuid) const;
+  std::optional<DBObject> get_object(const uuid_d& uuid) const override;
 
   std::optional<DBObject> get_object(
       const std::string& bucket_id, const std::string& object_name
-  ) const;
+  ) const override;
 
-  void store_object(const DBObject& object) const;
-  void remove_object(const uuid_d& uuid) const;
+  void store_object(const DBObject& object) const override;
+  void remove_object(const uuid_d& uuid) const override;
 };
 
 }  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,290 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "sqlite_prefix_stats.h"
+
+#include <fmt/format.h>
+
+#include "rgw/driver/sfs/object_state.h"
+#include "rgw/driver/sfs/sqlite/conversion_utils.h"
+#include "rgw/driver/sfs/version_type.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+static constexpr int PREFIX_STATS_CONFIG_ID = 0;
+
+std::string prefix_at_depth(
+    std::string_view name, std::string_view delimiter, uint depth
+) {
+  if (delimiter.empty()) {
+    return "";
+  }
+  size_t end = 0;
+  for (uint level = 0; level < depth; level++) {
+    const auto pos = name.find(delimiter, end);
+    if (pos == name.npos) {
+      break;
+    }
+    end = pos + delimiter.size();
+  }
+  return std::string(name.substr(0, end));
+}
+
+namespace {
+
+struct PrefixFunctionConfig {
+  std::string delimiter;
+  uint depth;
+};
+
+void sfs_prefix_function(
+    sqlite3_context* ctx, int /*argc*/, sqlite3_value** argv
+) {
+  const auto* config =
+      static_cast<const PrefixFunctionConfig*>(sqlite3_user_data(ctx));
+  const unsigned char* text = sqlite3_value_text(argv[0]);
+  if (text == nullptr) {
+    sqlite3_result_null(ctx);
+    return;
+  }
+  const std::string_view name(
+      reinterpret_cast<const char*>(text),
+      static_cast<size_t>(sqlite3_value_bytes(argv[0]))
+  );
+  const auto prefix = prefix_at_depth(name, config->delimiter, config->depth);
+  sqlite3_result_text(
+      ctx, prefix.data(), static_cast<int>(prefix.size()), SQLITE_TRANSIENT
+  );
+}
+
+// An object counts towards its prefix, with the size of its latest
+// committed version, while that version is not a delete marker.
+// Noncurrent versions are not counted. Selects bucket_id, prefix and
+// size of object_id, or no row. `also` further restricts when it counts.
+std::string latest_regular_version(
+    std::string_view object_id, std::string_view also = "true"
+) {
+  return fmt::format(
+      R"sql(
+        SELECT o.bucket_id AS bucket_id, sfs_prefix(o.name) AS prefix,
+               latest.size AS size
+        FROM objects AS o, (
+          SELECT version_type, size FROM versioned_objects
+          WHERE object_id = {0} AND object_state = {2}
+          ORDER BY commit_time DESC, id DESC
+          LIMIT 1
+        ) AS latest
+        WHERE o.uuid = {0} AND latest.version_type = {3} AND {1})sql",
+      object_id, also, static_cast<int>(ObjectState::COMMITTED),
+      static_cast<int>(VersionType::REGULAR)
+  );
+}
+
+std::string add_statement(
+    std::string_view object_id, std::string_view also = "true"
+) {
+  return fmt::format(
+      R"sql(
+        INSERT INTO prefix_stats (bucket_id, prefix, obj_count, size)
+          SELECT bucket_id, prefix, 1, size FROM ({0}) WHERE true
+        ON CONFLICT (bucket_id, prefix) DO UPDATE
+          SET obj_count = obj_count + 1, size = size + excluded.size;)sql",
+      latest_regular_version(object_id, also)
+  );
+}
+
+std::string subtract_statements(
+    std::string_view object_id, std::string_view also = "true"
+) {
+  const auto latest = latest_regular_version(object_id, also);
+  const auto match = fmt::format(
+      "(bucket_id, prefix) = (SELECT bucket_id, prefix FROM ({}))", latest
+  );
+  return fmt::format(
+      R"sql(
+        UPDATE prefix_stats
+          SET obj_count = obj_count - 1,
+              size = size - (SELECT size FROM ({0}))
+          WHERE {1};
+        DELETE FROM prefix_stats WHERE obj_count <= 0 AND {1};)sql",
+      latest, match
+  );
+}
+
+std::string is_committed(std::string_view row) {
+  return fmt::format(
+      "{}.object_state = {}", row, static_cast<int>(ObjectState::COMMITTED)
+  );
+}
+
+}  // namespace
+
+void install_prefix_stats_triggers(
+    sqlite3* db, const std::string& delimiter, uint depth
+) {
+  sqlite3_create_function_v2(
+      db, "sfs_prefix", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+      new PrefixFunctionConfig{delimiter, depth}, &sfs_prefix_function,
+      nullptr, nullptr,
+      [](void* config) { delete static_cast<PrefixFunctionConfig*>(config); }
+  );
+  // Which version of an object is the latest depends on all its
+  // versions. BEFORE triggers take the object out of prefix_stats as
+  // it was counted, AFTER triggers put it back in as it is now.
+  const auto changed = fmt::format(
+      "({} OR {}) AND (OLD.object_id IS NOT NEW.object_id OR "
+      "OLD.object_state IS NOT NEW.object_state OR "
+      "OLD.version_type IS NOT NEW.version_type OR "
+      "OLD.size IS NOT NEW.size OR OLD.commit_time IS NOT NEW.commit_time)",
+      is_committed("OLD"), is_committed("NEW")
+  );
+  const std::string moved = "NEW.object_id IS NOT OLD.object_id";
+  const auto statement = fmt::format(
+      R"sql(
+      CREATE TEMP TRIGGER IF NOT EXISTS sfs_prefix_stats_before_insert
+      BEFORE INSERT ON main.{0}
+      WHEN {1}
+      BEGIN {3}
+      END;
+      CREATE TEMP TRIGGER IF NOT EXISTS sfs_prefix_stats_insert
+      AFTER INSERT ON main.{0}
+      WHEN {1}
+      BEGIN {4}
+      END;
+      CREATE TEMP TRIGGER IF NOT EXISTS sfs_prefix_stats_before_delete
+      BEFORE DELETE ON main.{0}
+      WHEN {2}
+      BEGIN {5}
+      END;
+      CREATE TEMP TRIGGER IF NOT EXISTS sfs_prefix_stats_delete
+      AFTER DELETE ON main.{0}
+      WHEN {2}
+      BEGIN {6}
+      END;
+      CREATE TEMP TRIGGER IF NOT EXISTS sfs_prefix_stats_before_update
+      BEFORE UPDATE OF object_id, object_state, version_type, size,
+        commit_time
+      ON main.{0}
+      WHEN {7}
+      BEGIN {5} {8}
+      END;
+      CREATE TEMP TRIGGER IF NOT EXISTS sfs_prefix_stats_update
+      AFTER UPDATE OF object_id, object_state, version_type, size,
+        commit_time
+      ON main.{0}
+      WHEN {7}
+      BEGIN {6} {9}
+      END;)sql",
+      VERSIONED_OBJECTS_TABLE, is_committed("NEW"), is_committed("OLD"),
+      subtract_statements("NEW.object_id"), add_statement("NEW.object_id"),
+      subtract_statements("OLD.object_id"), add_statement("OLD.object_id"),
+      changed, subtract_statements("NEW.object_id", moved),
+      add_statement("NEW.object_id", moved)
+  );
+  char* errmsg = nullptr;
+  const auto rc =
+      sqlite3_exec(db, statement.c_str(), nullptr, nullptr, &errmsg);
+  if (rc != SQLITE_OK) {
+    const std::string err = fmt::format(
+        "Error installing prefix stats triggers: {}",
+        errmsg ? errmsg : sqlite3_errstr(rc)
+    );
+    sqlite3_free(errmsg);
+    throw sqlite_sync_exception(err);
+  }
+}
+
+void sync_prefix_stats(DBConn& conn) {
+  const std::string& delimiter = conn.prefix_stats_delimiter;
+  const uint depth = conn.prefix_stats_depth;
+  auto storage = conn.get_storage();
+  auto transaction = storage->transaction_guard();
+  const auto config =
+      storage->get_pointer<DBPrefixStatsConfig>(PREFIX_STATS_CONFIG_ID);
+  if (config && config->delimiter == delimiter && config->depth == depth) {
+    return;
+  }
+  storage->remove_all<DBPrefixStats>();
+  if (depth > 0) {
+    dbapi::sqlite::database db = conn.get();
+    db << R"sql(
+        INSERT INTO prefix_stats (bucket_id, prefix, obj_count, size)
+          SELECT o.bucket_id, sfs_prefix(o.name), COUNT(*), SUM(vo.size)
+          FROM objects AS o
+          INNER JOIN versioned_objects AS vo ON vo.id = (
+            SELECT id FROM versioned_objects
+            WHERE object_id = o.uuid AND object_state = ?
+            ORDER BY commit_time DESC, id DESC
+            LIMIT 1
+          )
+          WHERE vo.version_type = ?
+          GROUP BY o.bucket_id, sfs_prefix(o.name);)sql"
+       << ObjectState::COMMITTED << VersionType::REGULAR;
+  }
+  storage->replace(
+      DBPrefixStatsConfig{PREFIX_STATS_CONFIG_ID, delimiter, depth}
+  );
+  transaction.commit();
+}
+
+SQLitePrefixStats::SQLitePrefixStats(DBConnRef _conn) : conn(_conn) {}
+
+std::optional<SQLitePrefixStats::Usage> SQLitePrefixStats::get_usage(
+    const std::string& bucket_id, const std::string& prefix
+) const {
+  const std::string& delimiter = conn->prefix_stats_delimiter;
+  const uint depth = conn->prefix_stats_depth;
+  if (depth == 0 || delimiter.empty()) {
+    return std::nullopt;
+  }
+  if (!prefix.empty() && !prefix.ends_with(delimiter)) {
+    return std::nullopt;
+  }
+  // rows are cut at depth, anything deeper is not broken down
+  if (prefix_at_depth(prefix, delimiter, depth).size() != prefix.size()) {
+    return std::nullopt;
+  }
+
+  Usage usage;
+  usage.prefix = prefix;
+  dbapi::sqlite::database db = conn->get();
+  auto rows = db << R"sql(
+      SELECT prefix, obj_count, size FROM prefix_stats
+      WHERE bucket_id = ?
+      AND prefix LIKE ? ESCAPE CHAR(7)
+      ORDER BY prefix ASC;)sql"
+                 << bucket_id << prefix_to_escaped_like(prefix, '\a');
+  for (std::tuple<std::string, int64_t, int64_t> row : rows) {
+    const auto& [row_prefix, obj_count, size] = row;
+    usage.obj_count += obj_count;
+    usage.size += size;
+    if (row_prefix.size() == prefix.size()) {
+      // objects right below prefix
+      continue;
+    }
+    const std::string child =
+        prefix + prefix_at_depth(
+                     std::string_view(row_prefix).substr(prefix.size()),
+                     delimiter, 1
+                 );
+    // rows are sorted, so rows of a child prefix are adjacent
+    if (usage.children.empty() || usage.children.back().prefix != child) {
+      usage.children.emplace_back(Usage{child, 0, 0, {}});
+    }
+    usage.children.back().obj_count += obj_count;
+    usage.children.back().size += size;
+  }
+  return usage;
+}
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,73 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dbconn.h"
+#include "prefix_stats/prefix_stats_definitions.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Cut name after the depth-th occurrence of delimiter, or after the
+/// last one if there are fewer. Names without delimiter map to "".
+std::string prefix_at_depth(
+    std::string_view name, std::string_view delimiter, uint depth
+);
+
+/// Register the sfs_prefix(name) SQL function and the temporary
+/// triggers that keep prefix_stats in step with versioned_objects on
+/// connection db. Triggers are per connection and not stored in the
+/// database, so other tools can write to it without knowing
+/// sfs_prefix().
+void install_prefix_stats_triggers(
+    sqlite3* db, const std::string& delimiter, uint depth
+);
+
+/// Recompute prefix_stats from versioned_objects if it was computed
+/// with a different delimiter or depth than configured on conn. Depth
+/// 0 clears it. Needs the triggers installed on the connection if
+/// depth > 0.
+void sync_prefix_stats(DBConn& conn);
+
+class SQLitePrefixStats {
+  DBConnRef conn;
+
+ public:
+  struct Usage {
+    std::string prefix;
+    uint64_t obj_count{0};
+    uint64_t size{0};
+    std::vector<Usage> children;
+  };
+
+  explicit SQLitePrefixStats(DBConnRef _conn);
+  virtual ~SQLitePrefixStats() = default;
+
+  SQLitePrefixStats(const SQLitePrefixStats&) = delete;
+  SQLitePrefixStats& operator=(const SQLitePrefixStats&) = delete;
+
+  /// Usage of prefix in bucket, with one entry per child prefix one
+  /// delimiter deeper. Empty if prefix stats are disabled, or prefix
+  /// is neither "" nor ends with the delimiter, or is deeper than the
+  /// configured depth.
+  std::optional<Usage> get_usage(
+      const std::string& bucket_id, const std::string& prefix
+  ) const;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -0,0 +1,39 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "sqlite_scrub.h"
+
+using namespace sqlite_orm;
+namespace rgw::sal::sfs::sqlite {
+
+static constexpr int SCRUB_STATE_ID = 0;
+
+SQLiteScrub::SQLiteScrub(DBConnRef _conn) : conn(_conn) {}
+
+DBScrubState SQLiteScrub::get_state() const {
+  auto storage = conn->get_storage();
+  auto state = storage->get_pointer<DBScrubState>(SCRUB_STATE_ID);
+  if (state) {
+    return *state;
+  }
+  return DBScrubState{SCRUB_STATE_ID, 0, ceph::real_time()};
+}
+
+void SQLiteScrub::store_state(const DBScrubState& state) const {
+  auto storage = conn->get_storage();
+  DBScrubState to_store = state;
+  to_store.id = SCRUB_STATE_ID;
+  storage->replace(to_store);
+}
+
+}  // namespace rgw::sal::sfs::sqlite
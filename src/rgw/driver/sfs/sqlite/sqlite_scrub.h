@@ -0,0 +1,36 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include "dbconn.h"
+#include "scrub/scrub_definitions.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+class SQLiteScrub {
+  DBConnRef conn;
+
+ public:
+  explicit SQLiteScrub(DBConnRef _conn);
+  virtual ~SQLiteScrub() = default;
+
+  SQLiteScrub(const SQLiteScrub&) = delete;
+  SQLiteScrub& operator=(const SQLiteScrub&) = delete;
+
+  /// Return the scrub state, a fresh one if none was stored yet.
+  DBScrubState get_state() const;
+  void store_state(const DBScrubState& state) const;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
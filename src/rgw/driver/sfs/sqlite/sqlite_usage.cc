@@ -0,0 +1,168 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#include "sqlite_usage.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <tuple>
+
+#include "retry.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+namespace {
+
+// epochs are signed in the database, callers pass (uint64_t)-1 for no end
+int64_t to_db_epoch(uint64_t epoch) {
+  return static_cast<int64_t>(
+      std::min<uint64_t>(epoch, std::numeric_limits<int64_t>::max())
+  );
+}
+
+// columns are qualified with table, if given
+std::string range_condition(
+    const SQLiteUsage::Range& range, std::string_view table = ""
+) {
+  const std::string column_prefix =
+      table.empty() ? "" : fmt::format("{}.", table);
+  std::string condition =
+      fmt::format("{0}epoch >= ? AND {0}epoch < ?", column_prefix);
+  if (range.owner.has_value()) {
+    condition += fmt::format(" AND {}owner = ?", column_prefix);
+  }
+  if (range.bucket.has_value()) {
+    condition += fmt::format(" AND {}bucket = ?", column_prefix);
+  }
+  return condition;
+}
+
+template <typename Statement>
+void bind_range(Statement& statement, const SQLiteUsage::Range& range) {
+  statement << to_db_epoch(range.start_epoch) << to_db_epoch(range.end_epoch);
+  if (range.owner.has_value()) {
+    statement << *range.owner;
+  }
+  if (range.bucket.has_value()) {
+    statement << *range.bucket;
+  }
+}
+
+}  // namespace
+
+SQLiteUsage::SQLiteUsage(DBConnRef _conn) : conn(_conn) {}
+
+void SQLiteUsage::add_usage(const DBUsageList& rows) const {
+  if (rows.empty()) {
+    return;
+  }
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    dbapi::sqlite::database db = conn->get();
+    for (const auto& row : rows) {
+      db << R"sql(
+          INSERT INTO usage (owner, bucket, epoch, payer, category,
+                             bytes_sent, bytes_received, ops, successful_ops)
+            VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)
+          ON CONFLICT (owner, bucket, epoch, payer, category) DO UPDATE
+            SET bytes_sent = bytes_sent + excluded.bytes_sent,
+                bytes_received = bytes_received + excluded.bytes_received,
+                ops = ops + excluded.ops,
+                successful_ops = successful_ops + excluded.successful_ops;)sql"
+         << row.owner << row.bucket << row.epoch << row.payer << row.category
+         << row.bytes_sent << row.bytes_received << row.ops
+         << row.successful_ops;
+    }
+    transaction.commit();
+    return true;
+  });
+  retry.run();
+}
+
+DBUsageList SQLiteUsage::read_usage(
+    const Range& range, const Marker& marker, uint32_t max, bool& truncated
+) const {
+  truncated = false;
+  if (max == 0) {
+    return {};
+  }
+  // one more pair than asked for tells whether there are more
+  dbapi::sqlite::database db = conn->get();
+  auto rows = db << fmt::format(
+                        R"sql(
+      WITH pairs AS (
+        SELECT DISTINCT owner, bucket FROM usage
+        WHERE {0} AND (owner, bucket) > (?, ?)
+        ORDER BY owner, bucket
+        LIMIT ?
+      )
+      SELECT u.owner, u.bucket, MIN(u.epoch), u.payer, u.category,
+             SUM(u.bytes_sent), SUM(u.bytes_received), SUM(u.ops),
+             SUM(u.successful_ops)
+      FROM usage AS u
+      INNER JOIN pairs AS p ON (u.owner = p.owner AND u.bucket = p.bucket)
+      WHERE {1}
+      GROUP BY u.owner, u.bucket, u.payer, u.category
+      ORDER BY u.owner, u.bucket, u.payer, u.category;)sql",
+                        range_condition(range), range_condition(range, "u")
+                    );
+  bind_range(rows, range);
+  rows << marker.first << marker.second << static_cast<int64_t>(max) + 1;
+  bind_range(rows, range);
+
+  DBUsageList usage;
+  uint32_t pairs = 0;
+  for (std::tuple<
+           std::string, std::string, int64_t, std::string, std::string,
+           int64_t, int64_t, int64_t, int64_t>
+           row : rows) {
+    auto& [owner, bucket, epoch, payer, category, bytes_sent, bytes_received,
+           ops, successful_ops] = row;
+    if (usage.empty() || usage.back().owner != owner ||
+        usage.back().bucket != bucket) {
+      if (pairs == max) {
+        truncated = true;
+        break;
+      }
+      pairs++;
+    }
+    usage.push_back(DBUsage{
+        std::move(owner), std::move(bucket), epoch, std::move(payer),
+        std::move(category), bytes_sent, bytes_received, ops,
+        successful_ops});
+  }
+  return usage;
+}
+
+uint64_t SQLiteUsage::trim_usage(const Range& range) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<uint64_t> retry([&]() -> uint64_t {
+    dbapi::sqlite::database db = conn->get();
+    {
+      // runs when it goes out of scope
+      auto statement = db << fmt::format(
+          "DELETE FROM usage WHERE {};", range_condition(range)
+      );
+      bind_range(statement, range);
+    }
+    return storage->changes();
+  });
+  const auto removed = retry.run();
+  return removed.has_value() ? removed.value() : 0;
+}
+
+}  // namespace rgw::sal::sfs::sqlite
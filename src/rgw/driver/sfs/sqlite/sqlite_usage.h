@@ -0,0 +1,44 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "dbconn.h"
+#include "rgw/driver/sfs/usage_backend.h"
+#include "usage/usage_definitions.h"
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Usage in the usage table of the metadata database. Writes are
+/// upserts, reads aggregate with SQL.
+class SQLiteUsage : public UsageBackend {
+  DBConnRef conn;
+
+ public:
+  explicit SQLiteUsage(DBConnRef _conn);
+  virtual ~SQLiteUsage() = default;
+
+  SQLiteUsage(const SQLiteUsage&) = delete;
+  SQLiteUsage& operator=(const SQLiteUsage&) = delete;
+
+  void add_usage(const DBUsageList& rows) const override;
+  DBUsageList read_usage(
+      const Range& range, const Marker& marker, uint32_t max,
+      bool& truncated
+  ) const override;
+  uint64_t trim_usage(const Range& range) const override;
+};
+
+}  // namespace rgw::sal::sfs::sqlite
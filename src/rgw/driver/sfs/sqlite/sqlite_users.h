@@ -14,27 +14,30 @@
 #pragma once
 
 #include "dbconn.h"
+#include "rgw/driver/sfs/metadata_backend.h"
 
 namespace rgw::sal::sfs::sqlite {
 
-class SQLiteUsers {
+class SQLiteUsers : public UsersBackend {
   DBConnRef conn;
 
  public:
   explicit SQLiteUsers(DBConnRef _conn);
-  virtual ~SQLiteUsers() = default;
+  ~SQLiteUsers() override = default;
 
   SQLiteUsers(const SQLiteUsers&) = delete;
   SQLiteUsers& operator=(const SQLiteUsers&) = delete;
 
-  std::optional<DBOPUserInfo> get_user_by_email(const std::string& email) const;
+  std::optional<DBOPUserInfo> get_user_by_email(const std::string& email
+  ) const override;
   std::optional<DBOPUserInfo> get_user_by_access_key(const std::string& key
-  ) const;
-  std::optional<DBOPUserInfo> get_user(const std::string& userid) const;
-  std::vector<std::string> get_user_ids() const;
+  ) const override;
+  std::optional<DBOPUserInfo> get_user(const std::string& userid
+  ) const override;
+  std::vector<std::string> get_user_ids() const override;
 
-  void store_user(const DBOPUserInfo& user) const;
-  void remove_user(const std::string& userid) const;
+  void store_user(const DBOPUserInfo& user) const override;
+  void remove_user(const std::string& userid) const override;
 
  private:
   void _store_access_keys(const DBOPUserInfo& user) const;
@@ -15,13 +15,21 @@
 
 #include <sqlite_orm/sqlite_orm.h>
 
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <optional>
+#include <ranges>
 #include <stdexcept>
+#include <string_view>
 #include <system_error>
 
+#include "conversion_utils.h"
 #include "driver/sfs/object_state.h"
 #include "driver/sfs/version_type.h"
 #include "retry.h"
+#include "rgw/driver/sfs/sqlite/sqlite_content.h"
+#include "rgw/driver/sfs/sqlite/sqlite_object_tags.h"
 #include "rgw/driver/sfs/uuid_path.h"
 #include "versioned_object/versioned_object_definitions.h"
 
@@ -29,6 +37,121 @@ using namespace sqlite_orm;
 
 namespace rgw::sal::sfs::sqlite {
 
+namespace {
+
+// Lifecycle candidates: the last committed version of the object, regular
+// and last modified at or before a cutoff.
+constexpr std::string_view LC_CURRENT_CONDITION = R"sql(vo.version_type = ?
+      AND vo.mtime <= ?
+      AND vo.id = (
+        SELECT id FROM versioned_objects
+        WHERE object_id = vo.object_id
+        AND object_state = ?
+        ORDER BY commit_time DESC, id DESC
+        LIMIT 1
+      ))sql";
+
+// Lifecycle candidates: a committed version whose successor was created at
+// or before a cutoff. The latest version has no successor and never matches.
+constexpr std::string_view LC_NONCURRENT_CONDITION = R"sql((
+        SELECT nv.mtime FROM versioned_objects AS nv
+        WHERE nv.object_id = vo.object_id
+        AND nv.object_state = ?
+        AND (nv.commit_time > vo.commit_time
+          OR (nv.commit_time = vo.commit_time AND nv.id > vo.id))
+        ORDER BY nv.commit_time ASC, nv.id ASC
+        LIMIT 1
+      ) <= ?)sql";
+
+// Lifecycle candidates: a delete marker nothing else is left behind.
+constexpr std::string_view LC_LONE_DELETE_MARKER_CONDITION =
+    R"sql(vo.version_type = ?
+      AND NOT EXISTS (
+        SELECT 1 FROM versioned_objects AS ov
+        WHERE ov.object_id = vo.object_id
+        AND ov.object_state <> ?
+        AND ov.id <> vo.id
+      ))sql";
+
+template <typename... Args>
+DBExpiredVersionItems select_lc_candidates(
+    dbapi::sqlite::database db, std::string_view condition,
+    const std::string& bucket_id, const std::string& prefix, uint after,
+    uint max, const DBObjectTagSet& tags, const Args&... condition_args
+) {
+  auto rows = db << fmt::format(
+                        R"sql(
+      SELECT vo.id, vo.object_id
+      FROM versioned_objects AS vo
+      INNER JOIN objects AS o
+      ON (o.uuid = vo.object_id)
+      WHERE o.bucket_id = ?
+      AND o.name LIKE ? ESCAPE CHAR(7)
+      AND vo.object_state = ?
+      AND vo.id > ?
+      AND {}{}
+      ORDER BY vo.id ASC
+      LIMIT ?;)sql",
+                        condition, object_tags_condition("vo.id", tags.size())
+                    );
+  rows << bucket_id << prefix_to_escaped_like(prefix, '\a')
+       << ObjectState::COMMITTED << after;
+  ((rows << condition_args), ...);
+  for (const auto& [key, value] : tags) {
+    rows << key << value;
+  }
+  rows << max;
+  DBExpiredVersionItems ret;
+  for (std::tuple<int64_t, uuid_d> row : rows) {
+    ret.emplace_back(static_cast<uint>(std::get<0>(row)), std::get<1>(row));
+  }
+  return ret;
+}
+
+std::vector<uint> get_version_ids(const DBExpiredVersionItems& items) {
+  std::vector<uint> ids;
+  ids.reserve(items.size());
+  std::ranges::transform(
+      items, std::back_inserter(ids),
+      [](const DBExpiredVersionItem& item) { return item.first; }
+  );
+  return ids;
+}
+
+void soft_delete_versions(
+    StorageRef storage, const DBExpiredVersionItems& items
+) {
+  if (items.empty()) {
+    return;
+  }
+  const auto now = ceph::real_clock::now();
+  storage->update_all(
+      set(c(&DBVersionedObject::object_state) = ObjectState::DELETED,
+          c(&DBVersionedObject::delete_time) = now,
+          c(&DBVersionedObject::mtime) = now),
+      where(
+          in(&DBVersionedObject::id, get_version_ids(items)) and
+          is_equal(&DBVersionedObject::object_state, ObjectState::COMMITTED)
+      )
+  );
+}
+
+// Replace the parts manifest of version `id` within the caller's
+// transaction.
+void replace_parts_manifest(
+    StorageRef storage, uint id, const std::vector<DBVersionedObjectPart>& parts
+) {
+  storage->remove_all<DBVersionedObjectPart>(
+      where(is_equal(&DBVersionedObjectPart::versioned_object_id, id))
+  );
+  for (auto part : parts) {
+    part.versioned_object_id = id;
+    storage->insert(part);
+  }
+}
+
+}  // namespace
+
 SQLiteVersionedObjects::SQLiteVersionedObjects(DBConnRef _conn) : conn(_conn) {}
 
 std::optional<DBVersionedObject> SQLiteVersionedObjects::get_versioned_object(
@@ -105,18 +228,28 @@ uint SQLiteVersionedObjects::insert_versioned_object(
     const DBVersionedObject& object
 ) const {
   auto storage = conn->get_storage();
-  return storage->insert(object);
+  auto transaction = storage->transaction_guard();
+  auto stored = object;
+  stored.id = storage->insert(object);
+  store_object_tags(storage, stored);
+  transaction.commit();
+  return stored.id;
 }
 
 void SQLiteVersionedObjects::store_versioned_object(
     const DBVersionedObject& object
 ) const {
   auto storage = conn->get_storage();
+  auto transaction = storage->transaction_guard();
   storage->update(object);
+  store_object_tags(storage, object);
+  transaction.commit();
 }
 
 bool SQLiteVersionedObjects::store_versioned_object_if_state(
-    const DBVersionedObject& object, std::vector<ObjectState> allowed_states
+    const DBVersionedObject& object, std::vector<ObjectState> allowed_states,
+    const std::vector<DBVersionedObjectPart>& parts,
+    const std::string& content_hash
 ) const {
   auto storage = conn->get_storage();
   auto transaction = storage->transaction_guard();
@@ -125,6 +258,7 @@ bool SQLiteVersionedObjects::store_versioned_object_if_state(
       set(c(&DBVersionedObject::object_id) = object.object_id,
           c(&DBVersionedObject::checksum) = object.checksum,
           c(&DBVersionedObject::size) = object.size,
+          c(&DBVersionedObject::physical_size) = object.physical_size,
           c(&DBVersionedObject::create_time) = object.create_time,
           c(&DBVersionedObject::delete_time) = object.delete_time,
           c(&DBVersionedObject::commit_time) = object.commit_time,
@@ -139,20 +273,37 @@ bool SQLiteVersionedObjects::store_versioned_object_if_state(
           in(&DBVersionedObject::object_state, allowed_states)
       )
   );
-  return storage->changes() > 0;
+  if (storage->changes() == 0) {
+    return false;
+  }
+  store_object_tags(storage, object);
+  if (!parts.empty()) {
+    replace_parts_manifest(storage, object.id, parts);
+  }
+  if (!content_hash.empty()) {
+    add_content_ref(storage, content_hash, object.physical_size);
+  }
+  return true;
 }
 
 bool SQLiteVersionedObjects::
     store_versioned_object_delete_committed_transact_if_state(
-        const DBVersionedObject& object, std::vector<ObjectState> allowed_states
+        const DBVersionedObject& object,
+        std::vector<ObjectState> allowed_states, uint* num_deleted,
+        const std::vector<DBVersionedObjectPart>& parts,
+        const std::string& content_hash
     ) const {
   auto storage = conn->get_storage();
   RetrySQLiteBusy<bool> retry([&]() {
+    if (num_deleted != nullptr) {
+      *num_deleted = 0;
+    }
     auto transaction = storage->transaction_guard();
     storage->update_all(
         set(c(&DBVersionedObject::object_id) = object.object_id,
             c(&DBVersionedObject::checksum) = object.checksum,
             c(&DBVersionedObject::size) = object.size,
+            c(&DBVersionedObject::physical_size) = object.physical_size,
             c(&DBVersionedObject::create_time) = object.create_time,
             c(&DBVersionedObject::delete_time) = object.delete_time,
             c(&DBVersionedObject::commit_time) = object.commit_time,
@@ -171,6 +322,13 @@ bool SQLiteVersionedObjects::
       transaction.rollback();
       return false;
     }
+    store_object_tags(storage, object);
+    if (!parts.empty()) {
+      replace_parts_manifest(storage, object.id, parts);
+    }
+    if (!content_hash.empty()) {
+      add_content_ref(storage, content_hash, object.physical_size);
+    }
 
     // soft delete all other _COMMITTED_ versions. Leave OPEN versions
     // alone, as they may be an in progress write racing us.
@@ -184,6 +342,9 @@ bool SQLiteVersionedObjects::
             is_not_equal(&DBVersionedObject::id, object.id)
         )
     );
+    if (num_deleted != nullptr) {
+      *num_deleted = storage->changes();
+    }
     transaction.commit();
     return true;
   });
@@ -486,6 +647,13 @@ SQLiteVersionedObjects::create_new_versioned_object_transact(
   return retry.run();
 }
 
+int SQLiteVersionedObjects::count_deleted_versions() const {
+  auto storage = conn->get_storage();
+  return storage->count<DBVersionedObject>(
+      where(is_equal(&DBVersionedObject::object_state, ObjectState::DELETED))
+  );
+}
+
 std::optional<DBDeletedObjectItems>
 SQLiteVersionedObjects::remove_deleted_versions_transact(uint max_objects
 ) const {
@@ -496,7 +664,13 @@ SQLiteVersionedObjects::remove_deleted_versions_transact(uint max_objects
     // get first the list of objects to be deleted up to max_objects
     // order by size so when we delete the versions data we are more efficient
     ret_objs = storage->select(
-        columns(&DBVersionedObject::object_id, &DBVersionedObject::id),
+        columns(
+            &DBVersionedObject::object_id, &DBVersionedObject::id,
+            &DBObject::bucket_id
+        ),
+        inner_join<DBObject>(
+            on(is_equal(&DBObject::uuid, &DBVersionedObject::object_id))
+        ),
         where(is_equal(&DBVersionedObject::object_state, ObjectState::DELETED)),
         order_by(&DBVersionedObject::size).desc(), limit(max_objects)
     );
@@ -505,10 +679,15 @@ SQLiteVersionedObjects::remove_deleted_versions_transact(uint max_objects
       // no need to commit the transaction as nothing was changed
       return ret_objs;
     }
-    // remove all deleted versions up to max_objects
+    // remove exactly the versions selected
+    std::vector<uint> ids;
+    ids.reserve(ret_objs.size());
+    std::ranges::transform(
+        ret_objs, std::back_inserter(ids),
+        [](const DBDeletedObjectItem& item) { return get_version_id(item); }
+    );
     storage->remove_all<DBVersionedObject>(
-        where(is_equal(&DBVersionedObject::object_state, ObjectState::DELETED)),
-        order_by(&DBVersionedObject::size).desc(), limit(max_objects)
+        where(in(&DBVersionedObject::id, ids))
     );
     // now check if the object is empty
     for (auto const& obj : ret_objs) {
@@ -538,6 +717,63 @@ SQLiteVersionedObjects::remove_deleted_versions_transact(uint max_objects
   return retry.run();
 }
 
+std::optional<DBDeletedObjectItems>
+SQLiteVersionedObjects::remove_deleted_object_versions_transact(
+    const uuid_d& object_id, uint max_objects
+) const {
+  DBDeletedObjectItems ret_objs;
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<DBDeletedObjectItems> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    ret_objs = storage->select(
+        columns(
+            &DBVersionedObject::object_id, &DBVersionedObject::id,
+            &DBObject::bucket_id
+        ),
+        inner_join<DBObject>(
+            on(is_equal(&DBObject::uuid, &DBVersionedObject::object_id))
+        ),
+        where(
+            is_equal(&DBVersionedObject::object_id, object_id) and
+            is_equal(&DBVersionedObject::object_state, ObjectState::DELETED)
+        ),
+        order_by(&DBVersionedObject::id), limit(max_objects)
+    );
+    if (ret_objs.size() == 0) {
+      return ret_objs;
+    }
+    std::vector<uint> ids;
+    ids.reserve(ret_objs.size());
+    std::ranges::transform(
+        ret_objs, std::back_inserter(ids),
+        [](const DBDeletedObjectItem& item) { return get_version_id(item); }
+    );
+    storage->remove_all<DBVersionedObject>(
+        where(in(&DBVersionedObject::id, ids))
+    );
+    // remove the object if this was its last version
+    auto nb_versions = storage->count(
+        &DBVersionedObject::id,
+        where(
+            is_equal(&DBVersionedObject::version_type, VersionType::REGULAR) and
+            is_equal(&DBVersionedObject::object_id, object_id)
+        )
+    );
+    if (nb_versions == 0) {
+      storage->remove_all<DBVersionedObject>(where(
+          is_equal(
+              &DBVersionedObject::version_type, VersionType::DELETE_MARKER
+          ) and
+          is_equal(&DBVersionedObject::object_id, object_id)
+      ));
+      storage->remove<DBObject>(object_id);
+    }
+    transaction.commit();
+    return ret_objs;
+  });
+  return retry.run();
+}
+
 int SQLiteVersionedObjects::set_all_open_versions_to_deleted() const {
   // This function is only for use when we want to deliberately garbage
   // collect open versions on startup.
@@ -553,4 +789,213 @@ int SQLiteVersionedObjects::set_all_open_versions_to_deleted() const {
   return storage->changes();
 }
 
+bool SQLiteVersionedObjects::store_parts_manifest(
+    uint id, const std::vector<DBVersionedObjectPart>& parts
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    replace_parts_manifest(storage, id, parts);
+    transaction.commit();
+    return true;
+  });
+  const auto result = retry.run();
+  return result.has_value() ? result.value() : false;
+}
+
+std::vector<DBVersionedObjectPart> SQLiteVersionedObjects::get_parts_manifest(
+    uint id
+) const {
+  auto storage = conn->get_storage();
+  return storage->get_all<DBVersionedObjectPart>(
+      where(is_equal(&DBVersionedObjectPart::versioned_object_id, id)),
+      order_by(&DBVersionedObjectPart::part_num)
+  );
+}
+
+std::vector<DBVersionedObject>
+SQLiteVersionedObjects::get_committed_versions_after(uint after, uint max)
+    const {
+  auto storage = conn->get_storage();
+  return storage->get_all<DBVersionedObject>(
+      where(
+          greater_than(&DBVersionedObject::id, after) and
+          is_equal(&DBVersionedObject::object_state, ObjectState::COMMITTED) and
+          is_equal(&DBVersionedObject::version_type, VersionType::REGULAR)
+      ),
+      order_by(&DBVersionedObject::id), limit(max)
+  );
+}
+
+bool SQLiteVersionedObjects::update_objects_transact(
+    const std::string& bucket_id, const std::vector<std::string>& names,
+    const std::function<DBObjectsUpdate(const DBObjectsCommittedVersions&)>&
+        plan
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<bool> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    std::map<uuid_d, DBObject> candidates;
+    for (auto& object : storage->get_all<DBObject>(where(
+             is_equal(&DBObject::bucket_id, bucket_id) and
+             in(&DBObject::name, names)
+         ))) {
+      candidates.emplace(object.uuid, std::move(object));
+    }
+    DBObjectsCommittedVersions objects;
+    if (!candidates.empty()) {
+      std::vector<uuid_d> uuids;
+      uuids.reserve(candidates.size());
+      std::ranges::copy(
+          std::views::keys(candidates), std::back_inserter(uuids)
+      );
+      auto versions = storage->get_all<DBVersionedObject>(
+          where(
+              in(&DBVersionedObject::object_id, uuids) and
+              is_equal(&DBVersionedObject::object_state, ObjectState::COMMITTED)
+          ),
+          multi_order_by(
+              order_by(&DBVersionedObject::commit_time).desc(),
+              order_by(&DBVersionedObject::id).desc()
+          )
+      );
+      for (auto& version : versions) {
+        const auto& object = candidates.at(version.object_id);
+        auto& entry = objects[object.name];
+        if (entry.versions.empty()) {
+          entry.object = object;
+        } else if (entry.object.uuid != object.uuid) {
+          // an older object of the same name, hidden by the newer one
+          continue;
+        }
+        entry.versions.push_back(std::move(version));
+      }
+    }
+
+    const auto update = plan(objects);
+    if (!update.delete_ids.empty()) {
+      const auto now = ceph::real_clock::now();
+      storage->update_all(
+          set(c(&DBVersionedObject::object_state) = ObjectState::DELETED,
+              c(&DBVersionedObject::delete_time) = now,
+              c(&DBVersionedObject::mtime) = now),
+          where(in(&DBVersionedObject::id, update.delete_ids))
+      );
+    }
+    if (!update.remove_ids.empty()) {
+      storage->remove_all<DBVersionedObject>(
+          where(in(&DBVersionedObject::id, update.remove_ids))
+      );
+    }
+    for (const auto& object : update.new_objects) {
+      storage->replace(object);
+    }
+    for (const auto& version : update.new_versions) {
+      storage->insert(version);
+    }
+    transaction.commit();
+    return true;
+  });
+  const auto result = retry.run();
+  return result.has_value() ? result.value() : false;
+}
+
+DBExpiredVersionItems SQLiteVersionedObjects::expire_current_versions_transact(
+    const std::string& bucket_id, const std::string& prefix,
+    const ceph::real_time& cutoff, uint after, uint max,
+    const DBObjectTagSet& tags
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<DBExpiredVersionItems> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    auto items = select_lc_candidates(
+        conn->get(), LC_CURRENT_CONDITION, bucket_id, prefix, after, max,
+        tags, VersionType::REGULAR, cutoff, ObjectState::COMMITTED
+    );
+    soft_delete_versions(storage, items);
+    transaction.commit();
+    return items;
+  });
+  auto result = retry.run();
+  return result.has_value() ? result.value() : DBExpiredVersionItems{};
+}
+
+DBExpiredVersionItems
+SQLiteVersionedObjects::add_delete_markers_to_expired_transact(
+    const std::string& bucket_id, const std::string& prefix,
+    const ceph::real_time& cutoff, uint after, uint max,
+    const std::function<std::string()>& new_version_id,
+    const DBObjectTagSet& tags
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<DBExpiredVersionItems> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    auto items = select_lc_candidates(
+        conn->get(), LC_CURRENT_CONDITION, bucket_id, prefix, after, max,
+        tags, VersionType::REGULAR, cutoff, ObjectState::COMMITTED
+    );
+    if (!items.empty()) {
+      auto versions = storage->get_all<DBVersionedObject>(
+          where(in(&DBVersionedObject::id, get_version_ids(items)))
+      );
+      const auto now = ceph::real_clock::now();
+      for (auto& delete_marker : versions) {
+        delete_marker.version_type = VersionType::DELETE_MARKER;
+        delete_marker.object_state = ObjectState::COMMITTED;
+        delete_marker.commit_time = now;
+        delete_marker.delete_time = now;
+        delete_marker.mtime = now;
+        delete_marker.version_id = new_version_id();
+        storage->insert(delete_marker);
+      }
+    }
+    transaction.commit();
+    return items;
+  });
+  auto result = retry.run();
+  return result.has_value() ? result.value() : DBExpiredVersionItems{};
+}
+
+DBExpiredVersionItems
+SQLiteVersionedObjects::expire_noncurrent_versions_transact(
+    const std::string& bucket_id, const std::string& prefix,
+    const ceph::real_time& cutoff, uint after, uint max,
+    const DBObjectTagSet& tags
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<DBExpiredVersionItems> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    auto items = select_lc_candidates(
+        conn->get(), LC_NONCURRENT_CONDITION, bucket_id, prefix, after, max,
+        tags, ObjectState::COMMITTED, cutoff
+    );
+    soft_delete_versions(storage, items);
+    transaction.commit();
+    return items;
+  });
+  auto result = retry.run();
+  return result.has_value() ? result.value() : DBExpiredVersionItems{};
+}
+
+DBExpiredVersionItems
+SQLiteVersionedObjects::expire_lone_delete_markers_transact(
+    const std::string& bucket_id, const std::string& prefix, uint after,
+    uint max
+) const {
+  auto storage = conn->get_storage();
+  RetrySQLiteBusy<DBExpiredVersionItems> retry([&]() {
+    auto transaction = storage->transaction_guard();
+    auto items = select_lc_candidates(
+        conn->get(), LC_LONE_DELETE_MARKER_CONDITION, bucket_id, prefix,
+        after, max, DBObjectTagSet{}, VersionType::DELETE_MARKER,
+        ObjectState::DELETED
+    );
+    soft_delete_versions(storage, items);
+    transaction.commit();
+    return items;
+  });
+  auto result = retry.run();
+  return result.has_value() ? result.value() : DBExpiredVersionItems{};
+}
+
 }  // namespace rgw::sal::sfs::sqlite
@@ -13,75 +13,160 @@
  */
 #pragma once
 
+#include <functional>
+
 #include "dbconn.h"
+#include "object_tags/object_tags_definitions.h"
+#include "rgw/driver/sfs/metadata_backend.h"
 #include "versioned_object/versioned_object_definitions.h"
 
 namespace rgw::sal::sfs::sqlite {
 
-class SQLiteVersionedObjects {
+class SQLiteVersionedObjects : public VersionedObjectsBackend {
   DBConnRef conn;
 
  public:
   explicit SQLiteVersionedObjects(DBConnRef _conn);
-  virtual ~SQLiteVersionedObjects() = default;
+  ~SQLiteVersionedObjects() override = default;
 
   SQLiteVersionedObjects(const SQLiteVersionedObjects&) = delete;
   SQLiteVersionedObjects& operator=(const SQLiteVersionedObjects&) = delete;
 
   std::optional<DBVersionedObject> get_versioned_object(
       uint id, bool filter_deleted = true
-  ) const;
+  ) const override;
   std::optional<DBVersionedObject> get_versioned_object(
       const std::string& version_id, bool filter_deleted = true
-  ) const;
+  ) const override;
   std::optional<DBVersionedObject> get_committed_versioned_object(
       const std::string& bucket_id, const std::string& object_name,
       const std::string& version_id
-  ) const;
+  ) const override;
   DBObjectsListItems list_last_versioned_objects(const std::string& bucket_id
-  ) const;
+  ) const override;
 
-  uint insert_versioned_object(const DBVersionedObject& object) const;
-  void store_versioned_object(const DBVersionedObject& object) const;
+  uint insert_versioned_object(const DBVersionedObject& object) const override;
+  void store_versioned_object(const DBVersionedObject& object) const override;
+  /// Store `object` if it is in one of `allowed_states`. A non-empty
+  /// `parts` manifest is stored in the same transaction, and so is a
+  /// reference to `content_hash` if the data is deduplicated.
   bool store_versioned_object_if_state(
-      const DBVersionedObject& object, std::vector<ObjectState> allowed_states
-  ) const;
-  void remove_versioned_object(uint id) const;
+      const DBVersionedObject& object, std::vector<ObjectState> allowed_states,
+      const std::vector<DBVersionedObjectPart>& parts = {},
+      const std::string& content_hash = ""
+  ) const override;
+  void remove_versioned_object(uint id) const override;
+  /// Store `object` if it is in one of `allowed_states` and soft delete
+  /// the other committed versions. `num_deleted` is set to the number of
+  /// versions deleted. A non-empty `parts` manifest is stored in the same
+  /// transaction, and so is a reference to `content_hash` if the data is
+  /// deduplicated.
   bool store_versioned_object_delete_committed_transact_if_state(
-      const DBVersionedObject& object, std::vector<ObjectState> allowed_states
-  ) const;
-
-  std::vector<uint> get_versioned_object_ids(bool filter_deleted = true) const;
+      const DBVersionedObject& object, std::vector<ObjectState> allowed_states,
+      uint* num_deleted = nullptr,
+      const std::vector<DBVersionedObjectPart>& parts = {},
+      const std::string& content_hash = ""
+  ) const override;
+
+  std::vector<uint> get_versioned_object_ids(bool filter_deleted = true
+  ) const override;
   std::vector<uint> get_versioned_object_ids(
       const uuid_d& object_id, bool filter_deleted = true
-  ) const;
+  ) const override;
   std::vector<DBVersionedObject> get_versioned_objects(
       const uuid_d& object_id, bool filter_deleted = true
-  ) const;
+  ) const override;
 
   std::optional<DBVersionedObject> get_last_versioned_object(
       const uuid_d& object_id, bool filter_deleted = true
-  ) const;
+  ) const override;
 
   std::optional<DBVersionedObject> delete_version_and_get_previous_transact(
       const uuid_d& object_id, uint id
-  ) const;
+  ) const override;
 
   std::optional<DBVersionedObject> create_new_versioned_object_transact(
       const std::string& bucket_id, const std::string& object_name,
       const std::string& version_id
-  ) const;
+  ) const override;
 
   bool add_delete_marker_transact(
       const uuid_d& object_id, const std::string& delete_marker_id,
       uint* out_id = nullptr
-  ) const;
+  ) const override;
 
   std::optional<DBDeletedObjectItems> remove_deleted_versions_transact(
       uint max_objects
-  ) const;
-
-  int set_all_open_versions_to_deleted() const;
+  ) const override;
+  /// Like remove_deleted_versions_transact(), for the versions of
+  /// object `object_id` only.
+  std::optional<DBDeletedObjectItems> remove_deleted_object_versions_transact(
+      const uuid_d& object_id, uint max_objects
+  ) const override;
+  /// Number of versions waiting for the garbage collector.
+  int count_deleted_versions() const override;
+
+  int set_all_open_versions_to_deleted() const override;
+
+  /// Store the parts manifest of version `id`, replacing any previous one.
+  /// Returns false if the database stayed busy.
+  bool store_parts_manifest(
+      uint id, const std::vector<DBVersionedObjectPart>& parts
+  ) const override;
+  /// Return the parts manifest of version `id` ordered by part number.
+  /// Empty if the version data is a single file.
+  std::vector<DBVersionedObjectPart> get_parts_manifest(uint id) const override;
+
+  /// Return up to `max` committed regular versions with an id greater
+  /// than `after`, ordered by id.
+  std::vector<DBVersionedObject> get_committed_versions_after(
+      uint after, uint max
+  ) const override;
+
+  /// Look up the committed versions of objects `names` of `bucket_id`,
+  /// let `plan` decide what to change and write that, all in one
+  /// transaction. `plan` runs again if the transaction is retried.
+  /// Returns false if the database stayed busy.
+  bool update_objects_transact(
+      const std::string& bucket_id, const std::vector<std::string>& names,
+      const std::function<DBObjectsUpdate(const DBObjectsCommittedVersions&)>&
+          plan
+  ) const override;
+
+  // Lifecycle expiration. Each call looks at the committed versions of
+  // objects in `bucket_id` whose name starts with `prefix`, changes up to
+  // `max` of those with an id greater than `after` in a single transaction
+  // and returns them ordered by id. Fewer than `max` means done. Where
+  // given, only versions carrying all of `tags` qualify.
+
+  /// Soft delete current regular versions last modified at or before
+  /// `cutoff`.
+  DBExpiredVersionItems expire_current_versions_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const DBObjectTagSet& tags = {}
+  ) const override;
+  /// Put a delete marker on top of current regular versions last modified
+  /// at or before `cutoff`. `new_version_id` names the delete markers.
+  DBExpiredVersionItems add_delete_markers_to_expired_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const std::function<std::string()>& new_version_id,
+      const DBObjectTagSet& tags = {}
+  ) const override;
+  /// Soft delete noncurrent versions whose successor was created at or
+  /// before `cutoff`.
+  DBExpiredVersionItems expire_noncurrent_versions_transact(
+      const std::string& bucket_id, const std::string& prefix,
+      const ceph::real_time& cutoff, uint after, uint max,
+      const DBObjectTagSet& tags = {}
+  ) const override;
+  /// Soft delete delete markers that are the only version of their object
+  /// left.
+  DBExpiredVersionItems expire_lone_delete_markers_transact(
+      const std::string& bucket_id, const std::string& prefix, uint after,
+      uint max
+  ) const override;
 
  private:
   std::optional<DBVersionedObject>
@@ -0,0 +1,39 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rgw::sal::sfs::sqlite {
+
+/// Usage of a bucket, charged to its owner, in the hour starting at
+/// epoch, for one category of operations (e.g. "put_obj"). Rows add up
+/// the flushes of the usage logger, see SQLiteUsage::add_usage.
+struct DBUsage {
+  std::string owner;
+  std::string bucket;
+  int64_t epoch;
+  std::string payer;
+  std::string category;
+  int64_t bytes_sent;
+  int64_t bytes_received;
+  int64_t ops;
+  int64_t successful_ops;
+};
+
+using DBUsageList = std::vector<DBUsage>;
+
+}  // namespace rgw::sal::sfs::sqlite
@@ -13,8 +13,10 @@
  */
 #pragma once
 
+#include <map>
 #include <ranges>
 #include <string>
+#include <vector>
 
 #include "common/iso_8601.h"
 #include "rgw/driver/sfs/object_state.h"
@@ -37,6 +39,8 @@ struct DBVersionedObject {
   uuid_d object_id;
   std::string checksum;
   size_t size;
+  // bytes stored on disk, smaller than size for compressed objects
+  size_t physical_size{0};
   ceph::real_time create_time;
   ceph::real_time delete_time;
   ceph::real_time commit_time;
@@ -48,6 +52,18 @@ struct DBVersionedObject {
   VersionType version_type = rgw::sal::sfs::VersionType::REGULAR;
 };
 
+/// One entry of the parts manifest of an object version whose data was
+/// not concatenated into a single file (see SFSMultipartUploadV2::complete).
+/// Part files live in the version's parts directory, named after part_id.
+struct DBVersionedObjectPart {
+  uint id;
+  uint versioned_object_id;
+  uint32_t part_num;
+  int part_id;
+  uint64_t offset;
+  uint64_t size;
+};
+
 using DBObjectsListItem = std::tuple<
     decltype(DBObject::uuid), decltype(DBObject::name),
     decltype(DBVersionedObject::version_id),
@@ -62,6 +78,32 @@ using DBObjectsListItem = std::tuple<
 
 using DBObjectsListItems = std::vector<DBObjectsListItem>;
 
+/// (version id, object uuid) of a version changed by lifecycle expiration
+using DBExpiredVersionItem =
+    std::pair<decltype(DBVersionedObject::id), decltype(DBObject::uuid)>;
+
+using DBExpiredVersionItems = std::vector<DBExpiredVersionItem>;
+
+/// An object and its committed versions, newest first
+struct DBObjectCommittedVersions {
+  DBObject object;
+  std::vector<DBVersionedObject> versions;
+};
+
+/// Objects of a bucket by name
+using DBObjectsCommittedVersions =
+    std::map<std::string, DBObjectCommittedVersions>;
+
+/// Changes written by SQLiteVersionedObjects::update_objects_transact()
+struct DBObjectsUpdate {
+  /// versions to mark deleted, for the garbage collector
+  std::vector<uint> delete_ids;
+  /// versions to remove right away (delete markers)
+  std::vector<uint> remove_ids;
+  std::vector<DBObject> new_objects;
+  std::vector<DBVersionedObject> new_versions;
+};
+
 /// DBObjectsListItem helpers
 inline decltype(DBObject::uuid) get_uuid(const DBObjectsListItem& item) {
   return std::get<0>(item);
@@ -14,12 +14,17 @@
 
 #include "rgw/driver/sfs/types.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <system_error>
 
+#include "rgw/driver/sfs/bucket_dirs.h"
+#include "rgw/driver/sfs/object_data.h"
 #include "rgw/driver/sfs/object_state.h"
+#include "rgw/driver/sfs/sfs_gc.h"
 #include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
 #include "rgw/driver/sfs/sqlite/sqlite_objects.h"
 #include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
@@ -49,10 +54,12 @@ Object* Object::create_for_immediate_deletion(const sqlite::DBObject& object) {
 }
 
 void Object::delete_version_data(
-    SFStore* store, const uuid_d& uuid, uint version_id
+    SFStore* store, const uuid_d& uuid, uint version_id,
+    const std::filesystem::path& data_root
 ) {
-  Object* result = new Object(rgw_obj_key(), uuid);
+  std::unique_ptr<Object> result(new Object(rgw_obj_key(), uuid));
   result->version_id = version_id;
+  result->data_root = data_root;
   result->delete_object_data(store);
 }
 
@@ -90,6 +97,7 @@ Object* Object::create_from_db_version(
       .delete_at = version.delete_time
   };
   result->attrs = version.attrs;
+  result->checksum = version.checksum;
   return result;
 }
 
@@ -129,7 +137,7 @@ Object* Object::create_commit_delete_marker(
   oinfo.bucket_id = bucket_id;
   oinfo.name = result->name;
 
-  sqlite::SQLiteObjects dbobjs(store->db_conn);
+  const auto& dbobjs = store->metadata->objects();
   dbobjs.store_object(oinfo);
   return result;
 }
@@ -143,7 +151,7 @@ Object* Object::try_fetch_from_database(
     // non versioned bucket and versionId = null --> ignore versionId
     version_id_query = "";
   }
-  sqlite::SQLiteVersionedObjects objs_versions(store->db_conn);
+  const auto& objs_versions = store->metadata->versioned_objects();
   // if version_id is empty it will get the last version for that object
   auto version = objs_versions.get_committed_versioned_object(
       bucket_id, name, version_id_query
@@ -169,6 +177,8 @@ Object* Object::try_fetch_from_database(
       .delete_at = version->delete_time
   };
   result->attrs = version->attrs;
+  result->checksum = version->checksum;
+  result->data_root = store->bucket_dirs->data_root(bucket_id);
 
   return result;
 }
@@ -176,7 +186,13 @@ Object* Object::try_fetch_from_database(
 std::filesystem::path Object::get_storage_path() const {
   std::string filename = std::to_string(version_id);
   filename.append(".v");
-  return path.to_path() / filename;
+  return data_root / path.to_path() / filename;
+}
+
+std::filesystem::path Object::get_parts_path() const {
+  std::string dirname = std::to_string(version_id);
+  dirname.append(".parts");
+  return data_root / path.to_path() / dirname;
 }
 
 const Object::Meta Object::get_meta() const {
@@ -217,29 +233,34 @@ void Object::update_attrs(const Attrs& update) {
 }
 
 void Object::metadata_flush_attrs(SFStore* store) const {
-  sqlite::SQLiteVersionedObjects db_versioned_objs(store->db_conn);
+  const auto& db_versioned_objs = store->metadata->versioned_objects();
   auto versioned_object = db_versioned_objs.get_versioned_object(version_id);
   ceph_assert(versioned_object.has_value());
   versioned_object->attrs = get_attrs();
   db_versioned_objs.store_versioned_object(*versioned_object);
 }
 
-bool Object::metadata_finish(SFStore* store, bool versioning_enabled) const {
-  sqlite::SQLiteObjects dbobjs(store->db_conn);
+bool Object::metadata_finish(
+    SFStore* store, bool versioning_enabled,
+    const std::vector<sqlite::DBVersionedObjectPart>& parts
+) const {
+  const auto& dbobjs = store->metadata->objects();
   auto db_object = dbobjs.get_object(path.get_uuid());
   ceph_assert(db_object.has_value());
   db_object->name = name;
   dbobjs.store_object(*db_object);
 
-  sqlite::SQLiteVersionedObjects db_versioned_objs(store->db_conn);
+  const auto& db_versioned_objs = store->metadata->versioned_objects();
   // get the object, even if it was deleted.
   // 2 threads could be creating and deleting the object in parallel.
   // last one finishing wins
   auto db_versioned_object =
       db_versioned_objs.get_versioned_object(version_id, false);
   ceph_assert(db_versioned_object.has_value());
-  // TODO calculate checksum. Is it already calculated while writing?
+  db_versioned_object->checksum = checksum;
   db_versioned_object->size = meta.size;
+  db_versioned_object->physical_size =
+      ObjectData::physical_size(get_attrs(), meta.size);
   db_versioned_object->create_time = meta.mtime;
   db_versioned_object->delete_time = meta.delete_at;
   db_versioned_object->mtime = meta.mtime;
@@ -249,34 +270,50 @@ bool Object::metadata_finish(SFStore* store, bool versioning_enabled) const {
   db_versioned_object->attrs = get_attrs();
   if (versioning_enabled) {
     return db_versioned_objs.store_versioned_object_if_state(
-        *db_versioned_object, {ObjectState::OPEN}
+        *db_versioned_object, {ObjectState::OPEN}, parts, content_hash
     );
 
   } else {
-    return db_versioned_objs
-        .store_versioned_object_delete_committed_transact_if_state(
-            *db_versioned_object, {ObjectState::OPEN}
-        );
+    uint num_deleted = 0;
+    const bool stored =
+        db_versioned_objs
+            .store_versioned_object_delete_committed_transact_if_state(
+                *db_versioned_object, {ObjectState::OPEN}, &num_deleted, parts,
+                content_hash
+            );
+    if (stored && num_deleted > 0) {
+      // the overwritten versions can go right away
+      store->gc->enqueue(
+          sqlite::GCJournalKind::OBJECT, path.get_uuid().to_string()
+      );
+    }
+    return stored;
   }
 }
 
 int Object::delete_object_version(SFStore* store) const {
   // remove metadata
-  sqlite::SQLiteVersionedObjects db_versioned_objs(store->db_conn);
+  const auto& db_versioned_objs = store->metadata->versioned_objects();
   db_versioned_objs.remove_versioned_object(version_id);
+  store->data_cache->erase(version_id);
   return 0;
 }
 
 void Object::delete_object_metadata(SFStore* store) const {
   // remove metadata
-  sqlite::SQLiteObjects db_objs(store->db_conn);
+  const auto& db_objs = store->metadata->objects();
   db_objs.remove_object(path.get_uuid());
 }
 
 void Object::delete_object_data(SFStore* store) const {
-  // remove object version data
-  std::filesystem::remove(store->get_data_path() / get_storage_path());
-  auto folder_path = store->get_data_path() / path.to_path();
+  // remove object version data, which may share content with others
+  store->content_store->remove(store->get_data_path() / get_storage_path());
+  // and the part files if the version was stored as a parts manifest
+  std::error_code delete_parts_error;
+  std::filesystem::remove_all(
+      store->get_data_path() / get_parts_path(), delete_parts_error
+  );
+  auto folder_path = store->get_data_path() / data_root / path.to_path();
   // try to delete the parent folder
   // it won't be deleted if it's not empty.
   std::error_code delete_folder_error;
@@ -292,7 +329,7 @@ ObjectRef Bucket::create_version(const rgw_obj_key& key) const {
     version_id = generate_new_version_id(store->ceph_context());
   }
   ObjectRef result;
-  sqlite::SQLiteVersionedObjects objs_versions(store->db_conn);
+  const auto& objs_versions = store->metadata->versioned_objects();
   // create objects in a transaction.
   // That way threads trying to create the same object in parallel will be
   // synchronised by the database without using extra mutexes.
@@ -301,10 +338,15 @@ ObjectRef Bucket::create_version(const rgw_obj_key& key) const {
   );
   if (new_version.has_value()) {
     result.reset(Object::create_from_db_version(key.name, *new_version));
+    result->data_root = get_data_root();
   }
   return result;
 }
 
+std::filesystem::path Bucket::get_data_root() const {
+  return store->bucket_dirs->data_root(get_bucket_id());
+}
+
 ObjectRef Bucket::get(const rgw_obj_key& key) const {
   auto maybe_result = Object::try_fetch_from_database(
       store, key.name, info.bucket.bucket_id, key.instance,
@@ -320,16 +362,18 @@ ObjectRef Bucket::get(const rgw_obj_key& key) const {
 
 std::vector<ObjectRef> Bucket::get_all() const {
   std::vector<ObjectRef> result;
-  sqlite::SQLiteVersionedObjects db_versioned_objs(store->db_conn);
+  const auto& db_versioned_objs = store->metadata->versioned_objects();
   // get the list of objects and its last version (filters deleted versions)
   // if an object has all versions deleted it is also filtered
   auto objects =
       db_versioned_objs.list_last_versioned_objects(info.bucket.bucket_id);
+  const auto data_root = get_data_root();
   for (const auto& db_obj : objects) {
     if (sqlite::get_object_state(db_obj) == ObjectState::COMMITTED) {
       result.push_back(std::shared_ptr<Object>(
           Object::create_from_db_version(sqlite::get_name(db_obj), db_obj)
       ));
+      result.back()->data_root = data_root;
     }
   }
   return result;
@@ -340,7 +384,7 @@ bool Bucket::delete_object(
     std::string& out_delete_marker_version_id
 ) const {
   out_delete_marker_version_id = "";
-  sqlite::SQLiteVersionedObjects db_versioned_objs(store->db_conn);
+  const auto& db_versioned_objs = store->metadata->versioned_objects();
 
   if (!versioned_bucket) {
     return _delete_object_non_versioned(obj, key, db_versioned_objs);
@@ -366,6 +410,130 @@ bool Bucket::delete_object(
   }
 }
 
+bool Bucket::delete_objects(
+    const std::vector<rgw_obj_key>& keys, bool versioned_bucket,
+    std::vector<DeleteResult>& results
+) const {
+  std::vector<std::string> names;
+  names.reserve(keys.size());
+  std::ranges::transform(
+      keys, std::back_inserter(names),
+      [](const rgw_obj_key& key) { return key.name; }
+  );
+  std::vector<std::string> deleted_objects;
+  std::vector<uint> deleted_versions;
+  const auto& db_versioned_objs = store->metadata->versioned_objects();
+  const bool ok = db_versioned_objs.update_objects_transact(
+      info.bucket.bucket_id, names,
+      [&](const sqlite::DBObjectsCommittedVersions& found) {
+        // keys may repeat, so plan against what earlier keys left behind
+        auto objects = found;
+        const auto now = ceph::real_clock::now();
+        sqlite::DBObjectsUpdate update;
+        results.assign(keys.size(), DeleteResult{});
+        deleted_objects.clear();
+        auto soft_delete = [&](std::vector<sqlite::DBVersionedObject>& versions,
+                               std::vector<sqlite::DBVersionedObject>::iterator
+                                   version) {
+          update.delete_ids.push_back(version->id);
+          deleted_objects.push_back(version->object_id.to_string());
+          versions.erase(version);
+        };
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+          const auto& key = keys[i];
+          auto& result = results[i];
+          auto entry = objects.find(key.name);
+          const bool exists =
+              entry != objects.end() && !entry->second.versions.empty();
+
+          if (!versioned_bucket) {
+            if (!exists) {
+              continue;
+            }
+            auto& versions = entry->second.versions;
+            if (!key.instance.empty() && key.instance != "null" &&
+                std::ranges::none_of(versions, [&](const auto& version) {
+                  return version.version_id == key.instance;
+                })) {
+              continue;
+            }
+            soft_delete(versions, versions.begin());
+            continue;
+          }
+
+          result.delete_marker = true;
+          if (!key.instance.empty()) {
+            result.version_id = key.instance;
+            if (!exists) {
+              continue;
+            }
+            auto& versions = entry->second.versions;
+            auto version = std::ranges::find_if(versions, [&](const auto& v) {
+              return v.version_id == key.instance;
+            });
+            if (version == versions.end()) {
+              continue;
+            }
+            if (version->version_type != VersionType::DELETE_MARKER) {
+              soft_delete(versions, version);
+            } else if (version == versions.begin() && version->id != 0) {
+              // like _undelete_object(): only the latest marker goes
+              update.remove_ids.push_back(version->id);
+              versions.erase(version);
+            }
+            continue;
+          }
+
+          if (exists && entry->second.versions.front().version_type ==
+                            VersionType::DELETE_MARKER) {
+            continue;
+          }
+          sqlite::DBVersionedObject delete_marker;
+          if (exists) {
+            delete_marker = entry->second.versions.front();
+          } else {
+            sqlite::DBObject object;
+            object.uuid = UUIDPath::create().get_uuid();
+            object.bucket_id = info.bucket.bucket_id;
+            object.name = key.name;
+            update.new_objects.push_back(object);
+            entry = objects
+                        .insert_or_assign(
+                            key.name,
+                            sqlite::DBObjectCommittedVersions{object, {}}
+                        )
+                        .first;
+            delete_marker.object_id = object.uuid;
+          }
+          delete_marker.id = 0;
+          delete_marker.object_state = ObjectState::COMMITTED;
+          delete_marker.version_type = VersionType::DELETE_MARKER;
+          delete_marker.version_id =
+              generate_new_version_id(store->ceph_context());
+          delete_marker.commit_time = now;
+          delete_marker.delete_time = now;
+          delete_marker.mtime = now;
+          result.version_id = delete_marker.version_id;
+          update.new_versions.push_back(delete_marker);
+          auto& versions = entry->second.versions;
+          versions.insert(versions.begin(), delete_marker);
+        }
+        deleted_versions = update.delete_ids;
+        return update;
+      }
+  );
+  if (ok && !deleted_objects.empty()) {
+    store->gc->enqueue(sqlite::GCJournalKind::OBJECT, deleted_objects);
+  }
+  if (ok) {
+    for (const auto id : deleted_versions) {
+      store->data_cache->erase(id);
+    }
+  }
+  return ok;
+}
+
 std::string Bucket::create_non_existing_object_delete_marker(
     const rgw_obj_key& key
 ) const {
@@ -381,15 +549,14 @@ std::string Bucket::create_non_existing_object_delete_marker(
   version_info.version_type = VersionType::DELETE_MARKER;
   version_info.version_id = new_version_id;
   version_info.delete_time = ceph::real_clock::now();
-  sqlite::SQLiteVersionedObjects db_versioned_objs(store->db_conn);
+  const auto& db_versioned_objs = store->metadata->versioned_objects();
   obj->version_id = db_versioned_objs.insert_versioned_object(version_info);
 
   return new_version_id;
 }
 
 bool Bucket::_undelete_object(
-    const rgw_obj_key& key,
-    const sqlite::SQLiteVersionedObjects& sqlite_versioned_objects,
+    const rgw_obj_key& key, const VersionedObjectsBackend& db_versioned_objs,
     const sqlite::DBVersionedObject& last_version
 ) const {
   if (!last_version.version_id.empty()) {
@@ -397,7 +564,7 @@ bool Bucket::_undelete_object(
     // only remove the delete marker if the requested version id is the last one
     if (!key.instance.empty() && (key.instance == last_version.version_id)) {
       // remove the delete marker and get the previous version in a transaction
-      sqlite_versioned_objects.delete_version_and_get_previous_transact(
+      db_versioned_objs.delete_version_and_get_previous_transact(
           last_version.object_id, last_version.id
       );
     }
@@ -407,7 +574,7 @@ bool Bucket::_undelete_object(
 
 bool Bucket::_delete_object_non_versioned(
     const Object& obj, const rgw_obj_key& /*key*/,
-    const sqlite::SQLiteVersionedObjects& db_versioned_objs
+    const VersionedObjectsBackend& db_versioned_objs
 ) const {
   auto version_to_delete =
       db_versioned_objs.get_last_versioned_object(obj.path.get_uuid());
@@ -415,7 +582,7 @@ bool Bucket::_delete_object_non_versioned(
 }
 
 bool Bucket::_delete_object_version(
-    const sqlite::SQLiteVersionedObjects& db_versioned_objs,
+    const VersionedObjectsBackend& db_versioned_objs,
     const sqlite::DBVersionedObject& version
 ) const {
   auto now = ceph::real_clock::now();
@@ -426,12 +593,18 @@ bool Bucket::_delete_object_version(
   const bool ret = db_versioned_objs.store_versioned_object_if_state(
       to_delete, {ObjectState::OPEN, ObjectState::COMMITTED}
   );
+  if (ret) {
+    store->data_cache->erase(to_delete.id);
+    store->gc->enqueue(
+        sqlite::GCJournalKind::OBJECT, to_delete.object_id.to_string()
+    );
+  }
   return ret;
 }
 
 std::string Bucket::_add_delete_marker(
     const Object& obj, const rgw_obj_key& /*key*/,
-    const sqlite::SQLiteVersionedObjects& db_versioned_objs
+    const VersionedObjectsBackend& db_versioned_objs
 ) const {
   std::string delete_marker_id = generate_new_version_id(store->ceph_context());
   const bool added = db_versioned_objs.add_delete_marker_transact(
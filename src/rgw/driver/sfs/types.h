@@ -15,12 +15,15 @@
 #define RGW_STORE_SFS_TYPES_H
 
 #include <exception>
+#include <filesystem>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "common/ceph_mutex.h"
+#include "rgw/driver/sfs/metadata_backend.h"
 #include "rgw/driver/sfs/sqlite/dbconn.h"
 #include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
 #include "rgw/driver/sfs/sqlite/sqlite_objects.h"
@@ -41,6 +44,9 @@ constexpr size_t S3_MAX_OBJECT_NAME_BYTES = 1024;
 
 struct UnknownObjectException : public std::exception {};
 
+/// Random version id for a new object version or delete marker.
+std::string generate_new_version_id(CephContext* ceph_context);
+
 class Object {
  public:
   struct Meta {
@@ -55,10 +61,18 @@ class Object {
   uint version_id{0};
   UUIDPath path;
   bool deleted;
+  /// Directory below the data path holding the fan-out of the object's
+  /// data. Empty for the shared fan-out (see BucketDirs).
+  std::filesystem::path data_root;
 
  private:
   Meta meta;
   std::map<std::string, bufferlist> attrs;
+  // data checksum (see checksum.h), empty if unknown
+  std::string checksum;
+  // hash of the shared content the data file links to (see
+  // ContentStore), empty if not deduplicated
+  std::string content_hash;
 
  protected:
   Object(const rgw_obj_key& _key, const uuid_d& _uuid);
@@ -76,7 +90,8 @@ class Object {
  public:
   static Object* create_for_immediate_deletion(const sqlite::DBObject& object);
   static void delete_version_data(
-      SFStore* store, const uuid_d& uuid, uint version_id
+      SFStore* store, const uuid_d& uuid, uint version_id,
+      const std::filesystem::path& data_root = {}
   );
   static Object* create_for_query(
       const std::string& name, const uuid_d& uuid, bool deleted, uint version_id
@@ -110,13 +125,27 @@ class Object {
   Attrs get_attrs() const;
   void update_attrs(const Attrs& update);
 
+  const std::string& get_checksum() const { return checksum; }
+  void set_checksum(const std::string& _checksum) { checksum = _checksum; }
+
+  /// The data file links to shared content `hash`. metadata_finish
+  /// counts the reference along with the version.
+  void set_content_hash(const std::string& hash) { content_hash = hash; }
+
   std::filesystem::path get_storage_path() const;
+  /// Directory holding the part files of a version stored as a parts
+  /// manifest instead of a single file.
+  std::filesystem::path get_parts_path() const;
 
   /// Commit all object state to database
   // Including meta and attrs
   // Sets obj version state to COMMITTED
   // For unversioned buckets it set the other versions state to DELETED
-  bool metadata_finish(SFStore* store, bool versioning_enabled) const;
+  // A non-empty `parts` manifest is committed along with the version
+  bool metadata_finish(
+      SFStore* store, bool versioning_enabled,
+      const std::vector<sqlite::DBVersionedObjectPart>& parts = {}
+  ) const;
 
   /// Commit attrs to database
   void metadata_flush_attrs(rgw::sal::SFStore* store) const;
@@ -145,24 +174,23 @@ class Bucket {
 
  private:
   bool _undelete_object(
-      const rgw_obj_key& key,
-      const sqlite::SQLiteVersionedObjects& sqlite_versioned_objects,
+      const rgw_obj_key& key, const VersionedObjectsBackend& db_versioned_objs,
       const sqlite::DBVersionedObject& last_version
   ) const;
 
   bool _delete_object_non_versioned(
       const Object& obj, const rgw_obj_key& key,
-      const sqlite::SQLiteVersionedObjects& sqlite_versioned_objects
+      const VersionedObjectsBackend& db_versioned_objs
   ) const;
 
   bool _delete_object_version(
-      const sqlite::SQLiteVersionedObjects& sqlite_versioned_objects,
+      const VersionedObjectsBackend& db_versioned_objs,
       const sqlite::DBVersionedObject& version
   ) const;
 
   std::string _add_delete_marker(
       const Object& obj, const rgw_obj_key& key,
-      const sqlite::SQLiteVersionedObjects& sqlite_versioned_objects
+      const VersionedObjectsBackend& db_versioned_objs
   ) const;
 
  public:
@@ -206,6 +234,9 @@ class Bucket {
 
   ceph::real_time get_mtime() const { return mtime; }
 
+  /// Directory below the data path holding the bucket's object data.
+  std::filesystem::path get_data_root() const;
+
   /// Create object version for key
   ObjectRef create_version(const rgw_obj_key& key) const;
 
@@ -222,6 +253,20 @@ class Bucket {
       std::string& delete_marker_version_id
   ) const;
 
+  struct DeleteResult {
+    bool delete_marker{false};
+    std::string version_id;
+  };
+
+  /// S3 multi-object delete: delete_object() semantics for every key,
+  /// applied in order within a single database transaction. `results`
+  /// matches `keys` by index. Returns false, having changed nothing, if
+  /// the transaction failed.
+  bool delete_objects(
+      const std::vector<rgw_obj_key>& keys, bool versioned_bucket,
+      std::vector<DeleteResult>& results
+  ) const;
+
   /// Delete a non-existing object. Creates object with toumbstone
   // version in database.
   std::string create_non_existing_object_delete_marker(const rgw_obj_key& key
@@ -237,12 +282,6 @@ class Bucket {
 
 using BucketRef = std::shared_ptr<Bucket>;
 
-using MetaBucketsRef = std::shared_ptr<sqlite::SQLiteBuckets>;
-
-static inline MetaBucketsRef get_meta_buckets(sqlite::DBConnRef conn) {
-  return std::make_shared<sqlite::SQLiteBuckets>(conn);
-}
-
 }  // namespace rgw::sal::sfs
 
 #endif  // RGW_STORE_SFS_TYPES_H
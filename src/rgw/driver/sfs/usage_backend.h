@@ -0,0 +1,64 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "rgw/driver/sfs/sqlite/usage/usage_definitions.h"
+
+namespace rgw::sal::sfs {
+
+/// Storage of usage logs, see sfs_usage.h. Kept in the SQLite metadata
+/// database (sqlite::SQLiteUsage) or in a separate KeyValueDB
+/// (KVUsage), as set by rgw_sfs_usage_backend. Implementations throw
+/// std::system_error on failure.
+///
+/// Users, buckets, objects and multipart uploads have a backend of their
+/// own, see MetadataBackend.
+class UsageBackend {
+ public:
+  /// Which usage to read or trim. Owner and bucket narrow it down if
+  /// set. Hours in [start_epoch, end_epoch) are included.
+  struct Range {
+    std::optional<std::string> owner;
+    std::optional<std::string> bucket;
+    uint64_t start_epoch{0};
+    uint64_t end_epoch{0};
+  };
+  /// Position after the last owner and bucket read
+  using Marker = std::pair<std::string, std::string>;
+
+  virtual ~UsageBackend() = default;
+
+  /// Add rows to the stored usage at once. Counters of rows for the
+  /// same owner, bucket, hour, payer and category are summed.
+  virtual void add_usage(const sqlite::DBUsageList& rows) const = 0;
+
+  /// Usage in range summed per owner, bucket, payer and category,
+  /// ordered the same way. Returns at most max owner/bucket pairs after
+  /// marker, and sets truncated if there are more. epoch is the first
+  /// hour with usage.
+  virtual sqlite::DBUsageList read_usage(
+      const Range& range, const Marker& marker, uint32_t max,
+      bool& truncated
+  ) const = 0;
+
+  /// Remove the usage in range. Returns the number of rows removed.
+  virtual uint64_t trim_usage(const Range& range) const = 0;
+};
+
+}  // namespace rgw::sal::sfs
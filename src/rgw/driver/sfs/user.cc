@@ -17,7 +17,8 @@
 
 #include "driver/sfs/bucket.h"
 #include "rgw/driver/sfs/sfs_log.h"
-#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sfs_usage.h"
+#include "rgw/driver/sfs/sqlite/db_users.h"
 #include "rgw_sal_sfs.h"
 
 #define dout_subsys ceph_subsys_rgw_sfs
@@ -66,28 +67,35 @@ int SFSUser::complete_flush_stats(
 }
 
 int SFSUser::read_usage(
-    const DoutPrefixProvider* dpp, uint64_t /*start_epoch*/,
-    uint64_t /*end_epoch*/, uint32_t /*max_entries*/, bool* /*is_truncated*/,
-    RGWUsageIter& /*usage_iter*/,
-    std::map<rgw_user_bucket, rgw_usage_log_entry>& /*usage*/
+    const DoutPrefixProvider* dpp, uint64_t start_epoch, uint64_t end_epoch,
+    uint32_t max_entries, bool* is_truncated, RGWUsageIter& usage_iter,
+    std::map<rgw_user_bucket, rgw_usage_log_entry>& usage
 ) {
   /** Read detailed usage stats for this User from the backing store */
-  lsfs_warn(dpp) << __func__ << ": TODO" << dendl;
-  return -ENOTSUP;
+  sfs::UsageBackend::Range range;
+  range.owner = info.user_id.to_str();
+  range.start_epoch = start_epoch;
+  range.end_epoch = end_epoch;
+  return sfs::read_usage(
+      dpp, *store->usage_backend, range, max_entries, is_truncated,
+      usage_iter, usage
+  );
 }
 
 int SFSUser::trim_usage(
-    const DoutPrefixProvider* dpp, uint64_t /*start_epoch*/,
-    uint64_t /*end_epoch*/
+    const DoutPrefixProvider* dpp, uint64_t start_epoch, uint64_t end_epoch
 ) {
-  lsfs_warn(dpp) << __func__ << ": TODO" << dendl;
-  return -ENOTSUP;
+  sfs::UsageBackend::Range range;
+  range.owner = info.user_id.to_str();
+  range.start_epoch = start_epoch;
+  range.end_epoch = end_epoch;
+  return sfs::trim_usage(dpp, *store->usage_backend, range);
 }
 
 int SFSUser::
     load_user(const DoutPrefixProvider* /*dpp*/, optional_yield /*y*/) {
-  rgw::sal::sfs::sqlite::SQLiteUsers sqlite_users(store->db_conn);
-  auto db_user = sqlite_users.get_user(info.user_id.id);
+  const auto& db_users = store->metadata->users();
+  auto db_user = db_users.get_user(info.user_id.id);
   if (db_user) {
     info = db_user->uinfo;
     attrs = db_user->user_attrs;
@@ -101,8 +109,8 @@ int SFSUser::store_user(
     const DoutPrefixProvider* dpp, optional_yield /*y*/, bool /*exclusive*/,
     RGWUserInfo* old_info
 ) {
-  rgw::sal::sfs::sqlite::SQLiteUsers sqlite_users(store->db_conn);
-  auto db_user = sqlite_users.get_user(info.user_id.id);
+  const auto& db_users = store->metadata->users();
+  auto db_user = db_users.get_user(info.user_id.id);
   if (db_user) {
     if (old_info) {
       *old_info = db_user->uinfo;
@@ -118,18 +126,18 @@ int SFSUser::store_user(
   user_version.ver++;
   user_version.tag =
       "user_version_tag";  // TODO Check if we need this to be stored
-  sqlite_users.store_user({info, user_version, attrs});
+  db_users.store_user({info, user_version, attrs});
   return 0;
 }
 
 int SFSUser::
     remove_user(const DoutPrefixProvider* /*dpp*/, optional_yield /*y*/) {
-  rgw::sal::sfs::sqlite::SQLiteUsers sqlite_users(store->db_conn);
-  auto db_user = sqlite_users.get_user(info.user_id.id);
+  const auto& db_users = store->metadata->users();
+  auto db_user = db_users.get_user(info.user_id.id);
   if (!db_user) {
     return -ECANCELED;
   }
-  sqlite_users.remove_user(info.user_id.id);
+  db_users.remove_user(info.user_id.id);
   return 0;
 }
 
@@ -14,6 +14,7 @@
 #include "driver/sfs/writer.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <fmt/ostream.h>
 #include <unistd.h>
 
@@ -25,6 +26,8 @@
 #include "common/ceph_time.h"
 #include "driver/sfs/bucket.h"
 #include "driver/sfs/writer.h"
+#include "include/intarith.h"
+#include "include/page.h"
 #include "rgw/driver/sfs/fmt.h"
 #include "rgw/driver/sfs/multipart_types.h"
 #include "rgw/driver/sfs/sfs_log.h"
@@ -96,7 +99,23 @@ SFSAtomicWriter::SFSAtomicWriter(
       unique_tag(_unique_tag),
       bytes_written(0),
       io_failed(false),
-      fd(-1) {
+      fd(-1),
+      size_hint(0),
+      preallocate(
+          _store->ctx()->_conf.get_val<bool>("rgw_sfs_write_preallocate")
+      ),
+      preallocate_max_step(_store->ctx()->_conf.get_val<Option::size_t>(
+          "rgw_sfs_write_preallocate_max_step"
+      )),
+      preallocated_end(0),
+      direct_io_threshold(_store->ctx()->_conf.get_val<Option::size_t>(
+          "rgw_sfs_write_direct_io_threshold"
+      )),
+      direct_fd(-1),
+      direct_offset(0),
+      data_crc_valid(true),
+      shares_content(false),
+      space_reservation(*_store->space_ledger) {
   lsfs_debug(dpp) << fmt::format(
                          "head_obj: {}, bucket: {}", _head_obj->get_key(),
                          _head_obj->get_bucket()->get_name()
@@ -131,8 +150,8 @@ SFSAtomicWriter::~SFSAtomicWriter() {
 }
 
 int SFSAtomicWriter::open() noexcept {
-  std::error_code ec;
-  std::filesystem::create_directories(object_path.parent_path(), ec);
+  const auto relpath = objref->get_storage_path();
+  std::error_code ec = store->data_dirs->ensure_parent(relpath);
   if (ec) {
     lsfs_err(dpp) << "failed to mkdir object path " << object_path << ": " << ec
                   << dendl;
@@ -145,8 +164,8 @@ int SFSAtomicWriter::open() noexcept {
   }
 
   int ret;
-  ret = ::open(
-      object_path.c_str(), O_CREAT | O_TRUNC | O_CLOEXEC | O_WRONLY, 0644
+  ret = store->data_dirs->open(
+      relpath, O_CREAT | O_TRUNC | O_CLOEXEC | O_WRONLY, 0644
   );
   if (ret < 0) {
     lsfs_err(dpp) << "error opening file " << object_path << ": "
@@ -159,9 +178,162 @@ int SFSAtomicWriter::open() noexcept {
 }
 
 int SFSAtomicWriter::close() noexcept {
+  if (direct_fd >= 0) {
+    // fsync on the buffered fd below covers data written through either
+    if (::close(direct_fd) < 0) {
+      lsfs_err(dpp) << fmt::format(
+                           "failed closing direct io fd:{}: {}. continuing.",
+                           direct_fd, cpp_strerror(errno)
+                       )
+                    << dendl;
+    }
+    direct_fd = -1;
+  }
   return close_fd_for(fd, dpp, get_cls_name(), &io_failed);
 }
 
+void SFSAtomicWriter::maybe_preallocate(uint64_t end) noexcept {
+  if (!preallocate || end <= preallocated_end) {
+    return;
+  }
+  // Preallocate the whole object if we know its size. Otherwise stay
+  // ahead of the writes, doubling the preallocated range up to
+  // preallocate_max_step at a time.
+  uint64_t target = end + std::min(end, preallocate_max_step);
+  if (size_hint >= end) {
+    target = size_hint;
+  }
+  const int ret = ::fallocate(
+      fd, FALLOC_FL_KEEP_SIZE, preallocated_end, target - preallocated_end
+  );
+  if (ret < 0) {
+    // Not fatal. Unsupported filesystems return EOPNOTSUPP. Out of
+    // space will be reported by the write itself.
+    lsfs_debug(dpp) << fmt::format(
+                           "fallocate fd:{} offset:{} len:{} failed: {}. "
+                           "disabling preallocation for this upload.",
+                           fd, preallocated_end, target - preallocated_end,
+                           cpp_strerror(errno)
+                       )
+                    << dendl;
+    preallocate = false;
+    return;
+  }
+  preallocated_end = target;
+}
+
+void SFSAtomicWriter::release_preallocated() noexcept {
+  if (preallocated_end <= bytes_written) {
+    return;
+  }
+  const int ret = ::fallocate(
+      fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, bytes_written,
+      preallocated_end - bytes_written
+  );
+  if (ret < 0) {
+    lsfs_debug(dpp) << fmt::format(
+                           "failed to release preallocated range {}-{} "
+                           "of fd:{}: {}. ignoring.",
+                           bytes_written, preallocated_end, fd,
+                           cpp_strerror(errno)
+                       )
+                    << dendl;
+  }
+  preallocated_end = bytes_written;
+}
+
+void SFSAtomicWriter::maybe_open_direct(uint64_t offset) noexcept {
+  if (direct_io_threshold == 0 || direct_fd >= 0 ||
+      offset < direct_io_threshold || offset != bytes_written ||
+      p2phase<uint64_t>(offset, CEPH_PAGE_SIZE) != 0) {
+    return;
+  }
+  const int ret =
+      ::open(object_path.c_str(), O_WRONLY | O_CLOEXEC | O_DIRECT);
+  if (ret < 0) {
+    // e.g. tmpfs does not support O_DIRECT. stay on buffered io.
+    lsfs_debug(dpp) << fmt::format(
+                           "failed to open {} with O_DIRECT: {}. "
+                           "continuing with buffered io.",
+                           object_path.string(), cpp_strerror(errno)
+                       )
+                    << dendl;
+    direct_io_threshold = 0;
+    return;
+  }
+  direct_fd = ret;
+  direct_offset = offset;
+}
+
+int SFSAtomicWriter::write_direct(bufferlist& data, uint64_t offset) noexcept {
+  ceph_assert(direct_fd >= 0);
+  if (offset != direct_offset + direct_pending.length() ||
+      p2phase<uint64_t>(direct_offset, CEPH_PAGE_SIZE) != 0) {
+    // Not a sequential write or the tail was already flushed. Flush
+    // what is queued and stay on buffered io for the rest of the upload.
+    int ret = flush_direct_tail();
+    if (ret < 0) {
+      return ret;
+    }
+    ::close(direct_fd);
+    direct_fd = -1;
+    direct_io_threshold = 0;
+    return data.write_fd(fd, offset);
+  }
+  direct_pending.claim_append(data);
+  const uint64_t aligned_len =
+      p2align<uint64_t>(direct_pending.length(), CEPH_PAGE_SIZE);
+  if (aligned_len == 0) {
+    return 0;
+  }
+  bufferlist out;
+  direct_pending.splice(0, aligned_len, &out);
+  out.rebuild_aligned_size_and_memory(CEPH_PAGE_SIZE, CEPH_PAGE_SIZE);
+  const int ret = out.write_fd(direct_fd, direct_offset);
+  if (ret < 0) {
+    return ret;
+  }
+  direct_offset += aligned_len;
+  return 0;
+}
+
+int SFSAtomicWriter::flush_direct_tail() noexcept {
+  if (direct_pending.length() == 0) {
+    return 0;
+  }
+  const int ret = direct_pending.write_fd(fd, direct_offset);
+  if (ret < 0) {
+    return ret;
+  }
+  direct_offset += direct_pending.length();
+  direct_pending.clear();
+  return 0;
+}
+
+int SFSAtomicWriter::handle_write_error(
+    int write_ret, size_t len, uint64_t offset
+) noexcept {
+  lsfs_err(dpp) << fmt::format(
+                       "failed to write size:{} offset:{} to fd:{}: {}. "
+                       "marking writer failed. "
+                       "failing future io. "
+                       "will delete partial data on completion. "
+                       "returning internal error.",
+                       len, offset, fd, cpp_strerror(write_ret)
+                   )
+                << dendl;
+  io_failed = true;
+  close();
+  cleanup();
+  switch (write_ret) {
+    case -EDQUOT:
+    case -ENOSPC:
+      return -ERR_QUOTA_EXCEEDED;
+    default:
+      return -ERR_INTERNAL_ERROR;
+  }
+}
+
 void SFSAtomicWriter::cleanup() noexcept {
   lsfs_err(dpp) << fmt::format(
                        "cleaning up failed upload to file {}. "
@@ -170,14 +342,33 @@ void SFSAtomicWriter::cleanup() noexcept {
                    )
                 << dendl;
 
-  std::error_code ec;
-  std::filesystem::remove(object_path, ec);
-  if (ec) {
-    lsfs_err(dpp) << fmt::format(
-                         "failed deleting file {}: {} {}. ignoring.",
-                         object_path.string(), ec.message(), ec.value()
-                     )
-                  << dendl;
+  // the reference is never committed, removal releases it
+  if (content_lock.owns_lock()) {
+    content_lock.unlock();
+  }
+  if (shares_content) {
+    // other versions may link to the same data
+    store->content_store->remove(object_path);
+  } else {
+    // Drop the data blocks right away, including preallocated ones, even
+    // if something still holds the file open.
+    if (::truncate(object_path.c_str(), 0) < 0 && errno != ENOENT) {
+      lsfs_debug(dpp) << fmt::format(
+                             "failed truncating file {}: {}. ignoring.",
+                             object_path.string(), cpp_strerror(errno)
+                         )
+                      << dendl;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(object_path, ec);
+    if (ec) {
+      lsfs_err(dpp) << fmt::format(
+                           "failed deleting file {}: {} {}. ignoring.",
+                           object_path.string(), ec.message(), ec.value()
+                       )
+                    << dendl;
+    }
   }
 
   const auto dir_fd = ::open(object_path.parent_path().c_str(), O_RDONLY);
@@ -205,12 +396,16 @@ void SFSAtomicWriter::cleanup() noexcept {
 }
 
 int SFSAtomicWriter::prepare(optional_yield /*y*/) {
-  if (store->filesystem_stats_avail_bytes.load() <
-      store->min_space_left_for_data_write_ops_bytes) {
+  // reserve the whole object if we know its size, a chunk otherwise
+  const bool reserved = size_hint > 0 ? space_reservation.reserve(size_hint)
+                                      : space_reservation.extend(1);
+  if (!reserved) {
     lsfs_debug(dpp) << fmt::format(
-                           "filesystem stat reservation check hit. "
+                           "filesystem space reservation check hit. "
+                           "size_hint:{} reservable_bytes:{} "
                            "avail_bytes:{} avail_pct:{} total_bytes:{}. "
                            "returning quota error.",
+                           size_hint, store->space_ledger->get_available(),
                            store->filesystem_stats_avail_bytes,
                            store->filesystem_stats_avail_percent,
                            store->filesystem_stats_total_bytes
@@ -235,7 +430,45 @@ int SFSAtomicWriter::prepare(optional_yield /*y*/) {
 
   lsfs_debug(dpp) << "creating file at " << object_path << dendl;
 
-  return open();
+  const int ret = open();
+  if (ret == 0 && store->content_store->is_enabled()) {
+    content_hasher = std::make_unique<sfs::ContentHasher>();
+  }
+  return ret;
+}
+
+std::string SFSAtomicWriter::maybe_share_content() noexcept {
+  if (!content_hasher || !store->content_store->wants(bytes_written)) {
+    content_hasher.reset();
+    return "";
+  }
+  std::string hash = content_hasher->final();
+  content_hasher.reset();
+
+  content_lock = store->content_store->lock();
+  if (store->content_store->link_existing(
+          dpp, objref->get_storage_path(), hash, bytes_written
+      )) {
+    shares_content = true;
+    objref->set_content_hash(hash);
+    // Our copy is unlinked now. Drop its dirty pages instead of syncing
+    // them on close.
+    if (::ftruncate(fd, 0) < 0) {
+      lsfs_debug(dpp) << fmt::format(
+                             "failed truncating replaced fd:{}: {}. ignoring.",
+                             fd, cpp_strerror(errno)
+                         )
+                      << dendl;
+    }
+    return "";
+  }
+  if (!store->content_store->tag(dpp, fd, hash)) {
+    content_lock.unlock();
+    return "";
+  }
+  // first of its kind. published once synced.
+  shares_content = true;
+  return hash;
 }
 
 int SFSAtomicWriter::process(bufferlist&& data, uint64_t offset) {
@@ -252,33 +485,48 @@ int SFSAtomicWriter::process(bufferlist&& data, uint64_t offset) {
   if (data.length() == 0) {
     lsfs_debug(dpp) << "final piece, wrote " << bytes_written << " bytes"
                     << dendl;
+    const int write_ret = flush_direct_tail();
+    if (write_ret < 0) {
+      return handle_write_error(write_ret, 0, direct_offset);
+    }
     return 0;
   }
 
   ceph_assert(fd >= 0);
-  int write_ret = data.write_fd(fd, offset);
-  if (write_ret < 0) {
-    lsfs_err(dpp) << fmt::format(
-                         "failed to write size:{} offset:{} to fd:{}: {}. "
-                         "marking writer failed. "
-                         "failing future io. "
-                         "will delete partial data on completion. "
-                         "returning internal error.",
-                         data.length(), offset, fd, cpp_strerror(errno)
-                     )
-                  << dendl;
+  const auto len = data.length();
+  if (!space_reservation.extend(offset + len)) {
+    lsfs_info(dpp) << fmt::format(
+                          "out of reservable space writing {} bytes at {} to "
+                          "{}. returning quota error.",
+                          len, offset, object_path.string()
+                      )
+                   << dendl;
     io_failed = true;
     close();
     cleanup();
-    switch (write_ret) {
-      case -EDQUOT:
-      case -ENOSPC:
-        return -ERR_QUOTA_EXCEEDED;
-      default:
-        return -ERR_INTERNAL_ERROR;
+    return -ERR_QUOTA_EXCEEDED;
+  }
+  if (offset == bytes_written) {
+    data_crc.update(data);
+    if (content_hasher) {
+      content_hasher->update(data);
     }
+  } else {
+    data_crc_valid = false;
+    content_hasher.reset();
+  }
+  maybe_preallocate(offset + len);
+  maybe_open_direct(offset);
+  int write_ret;
+  if (direct_fd >= 0) {
+    write_ret = write_direct(data, offset);
+  } else {
+    write_ret = data.write_fd(fd, offset);
+  }
+  if (write_ret < 0) {
+    return handle_write_error(write_ret, len, offset);
   }
-  bytes_written += data.length();
+  bytes_written += len;
   return 0;
 }
 
@@ -303,12 +551,16 @@ int SFSAtomicWriter::complete(
   if (real_clock::is_zero(set_mtime)) {
     set_mtime = now;
   }
-  if (bytes_written != accounted_size) {
+  // with compression we were handed compressed data; accounted_size is
+  // the object's logical size
+  const uint64_t expected_size =
+      ObjectData::physical_size(attrs, accounted_size);
+  if (bytes_written != expected_size) {
     lsfs_err(dpp)
         << fmt::format(
-               "data written != accounted size. {} vs. {}. failing operation. "
+               "data written != expected size. {} vs. {}. failing operation. "
                "returning internal error.",
-               bytes_written, accounted_size
+               bytes_written, expected_size
            )
         << dendl;
     close();
@@ -316,11 +568,25 @@ int SFSAtomicWriter::complete(
     return -ERR_INTERNAL_ERROR;
   }
 
+  const int write_ret = flush_direct_tail();
+  if (write_ret < 0) {
+    return handle_write_error(write_ret, 0, direct_offset);
+  }
+  release_preallocated();
+  const std::string content_hash = maybe_share_content();
+
   int result = close();
   if (io_failed) {
     cleanup();
     return result;
   }
+  space_reservation.commit(bytes_written);
+  if (!content_hash.empty() &&
+      store->content_store->publish(
+          dpp, objref->get_storage_path(), content_hash, bytes_written
+      )) {
+    objref->set_content_hash(content_hash);
+  }
 
   // for object-locking enabled buckets, set the bucket's object-locking
   // profile when not defined on the object itself
@@ -357,12 +623,18 @@ int SFSAtomicWriter::complete(
        .mtime = set_mtime,
        .delete_at = delete_at}
   );
+  if (data_crc_valid) {
+    objref->set_checksum(sfs::format_crc32c(data_crc.value()));
+  }
 
   if (out_mtime != nullptr) {
     *out_mtime = now;
   }
   try {
     objref->metadata_finish(store, bucketref->get_info().versioning_enabled());
+    if (content_lock.owns_lock()) {
+      content_lock.unlock();
+    }
   } catch (const std::system_error& e) {
     lsfs_err(dpp) << fmt::format(
                          "failed to update db object {}: {}. "
@@ -399,13 +671,14 @@ int SFSMultipartWriterV2::prepare(optional_yield /* y */) {
   lsfs_debug(dpp) << fmt::format("upload_id: {}, part: {}", upload_id, part_num)
                   << dendl;
 
-  // check if store has enough space.
-  if (store->filesystem_stats_avail_bytes.load() <
-      store->min_space_left_for_data_write_ops_bytes) {
+  // part sizes are unknown, start with a chunk.
+  if (!space_reservation.extend(1)) {
     lsfs_err(dpp)
         << fmt::format(
-               "filesystem stat reservation check hit. avail_bytes: {}, "
-               "avail_pct: {}, total_bytes: {} -- return quota error.",
+               "filesystem space reservation check hit. reservable_bytes: "
+               "{}, avail_bytes: {}, avail_pct: {}, total_bytes: {} -- "
+               "return quota error.",
+               store->space_ledger->get_available(),
                store->filesystem_stats_avail_bytes,
                store->filesystem_stats_avail_percent,
                store->filesystem_stats_total_bytes
@@ -414,7 +687,11 @@ int SFSMultipartWriterV2::prepare(optional_yield /* y */) {
     return -ERR_QUOTA_EXCEEDED;
   }
 
-  sqlite::SQLiteMultipart mpdb(store->db_conn);
+  // acquire before reading from the db, so any later abort or complete is
+  // seen through mp_state.
+  mp_state = store->multipart_states->acquire(upload_id);
+
+  const auto& mpdb = store->metadata->multipart();
 
   // create part entry if it doesn't exist. Will also move the upload to "in
   // progress" if it's still in "init".
@@ -444,14 +721,15 @@ int SFSMultipartWriterV2::prepare(optional_yield /* y */) {
                          upload_id
                      )
                   << dendl;
+    mp_state->set_state(mp->state);
     return -ERR_NO_SUCH_UPLOAD;
   }
+  store->multipart_states->set_bucket_id(mp_state, mp->bucket_id);
 
   MultipartPartPath partpath(mp->path_uuid, entry->id);
   std::filesystem::path path = store->get_data_path() / partpath.to_path();
 
-  std::error_code ec;
-  std::filesystem::create_directories(path.parent_path(), ec);
+  std::error_code ec = store->data_dirs->ensure_parent(partpath.to_path());
   if (ec) {
     lsfs_err(dpp) << fmt::format(
                          "error creating multipart upload's part paths: {}",
@@ -463,8 +741,9 @@ int SFSMultipartWriterV2::prepare(optional_yield /* y */) {
 
   // truncate file
 
-  int ret =
-      ::open(path.c_str(), O_CREAT | O_TRUNC | O_CLOEXEC | O_WRONLY, 0600);
+  int ret = store->data_dirs->open(
+      partpath.to_path(), O_CREAT | O_TRUNC | O_CLOEXEC | O_WRONLY, 0600
+  );
   if (ret < 0) {
     lsfs_err(dpp
     ) << fmt::format("error opening file {}: {}", path, cpp_strerror(errno))
@@ -495,14 +774,8 @@ int SFSMultipartWriterV2::process(bufferlist&& data, uint64_t offset) {
          )
       << dendl;
 
-  sqlite::SQLiteMultipart mpdb(store->db_conn);
-  auto mp = mpdb.get_multipart(upload_id);
-  if (!mp.has_value()) {
-    lsfs_err(dpp) << fmt::format("multipart upload {} not found!", upload_id)
-                  << dendl;
-    return -ERR_NO_SUCH_UPLOAD;
-  }
-  if (mp->state != MultipartState::INPROGRESS) {
+  ceph_assert(mp_state);
+  if (!mp_state->is_writable()) {
     lsfs_err(dpp) << fmt::format(
                          "multipart upload {} not available -- raced with "
                          "abort or complete!",
@@ -518,6 +791,20 @@ int SFSMultipartWriterV2::process(bufferlist&& data, uint64_t offset) {
   }
 
   ceph_assert(fd >= 0);
+  if (!space_reservation.extend(offset + len)) {
+    lsfs_err(dpp) << fmt::format(
+                         "out of reservable space writing {} bytes at {}, "
+                         "upload_id: {}, part: {}",
+                         len, offset, upload_id, part_num
+                     )
+                  << dendl;
+    return -ERR_QUOTA_EXCEEDED;
+  }
+  if (offset == bytes_written) {
+    data_crc.update(data);
+  } else {
+    data_crc_valid = false;
+  }
   int write_ret = data.write_fd(fd, offset);
   if (write_ret < 0) {
     lsfs_err(dpp) << fmt::format(
@@ -546,7 +833,6 @@ int SFSMultipartWriterV2::complete(
 ) {
   // NOTE(jecluis): ignored parameters:
   //  * set_mtime
-  //  * attrs
   //  * delete_at
   //  * if_match
   //  * if_nomatch
@@ -564,19 +850,39 @@ int SFSMultipartWriterV2::complete(
                   << dendl;
   lsfs_dout(dpp, 10) << "attrs: " << attrs << dendl;
 
-  if (bytes_written != accounted_size) {
+  const auto cs_info = ObjectData::compression_info(attrs);
+  const uint64_t expected_size = cs_info.has_value()
+                                     ? ObjectData::physical_size(*cs_info)
+                                     : accounted_size;
+  if (bytes_written != expected_size) {
     lsfs_err(dpp) << fmt::format(
-                         "bytes_written != accounted_size, expected {} "
+                         "bytes_written != expected size, expected {} "
                          "byte, found {} byte.",
-                         bytes_written, accounted_size
+                         expected_size, bytes_written
                      )
                   << dendl;
     return -ERR_INTERNAL_ERROR;
   }
 
+  // the cached state may miss a bucket-wide abort that raced with
+  // prepare(), so check the db before finishing the part.
+  const auto& mpdb = store->metadata->multipart();
+  auto mp = mpdb.get_multipart(upload_id);
+  if (!mp.has_value() || mp->state != MultipartState::INPROGRESS) {
+    lsfs_err(dpp) << fmt::format(
+                         "multipart upload {} not available -- raced with "
+                         "abort or complete!",
+                         upload_id
+                     )
+                  << dendl;
+    return -ERR_NO_SUCH_UPLOAD;
+  }
+
   // finish part in db
-  sqlite::SQLiteMultipart mpdb(store->db_conn);
-  auto res = mpdb.finish_part(upload_id, part_num, etag, bytes_written);
+  const auto crc = data_crc_valid ? std::optional<uint32_t>(data_crc.value())
+                                  : std::nullopt;
+  auto res =
+      mpdb.finish_part(upload_id, part_num, etag, bytes_written, cs_info, crc);
   if (!res) {
     lsfs_err(dpp) << fmt::format(
                          "unable to finish upload_id {}, part_num {}",
@@ -585,6 +891,7 @@ int SFSMultipartWriterV2::complete(
                   << dendl;
     return -ERR_INTERNAL_ERROR;
   }
+  space_reservation.commit(bytes_written);
   auto entry = mpdb.get_part(upload_id, part_num);
   ceph_assert(entry.has_value());
   ceph_assert(entry->mtime.has_value());
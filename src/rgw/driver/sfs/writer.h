@@ -15,9 +15,14 @@
 #define RGW_STORE_SFS_WRITER_H
 
 #include <memory>
+#include <mutex>
 
 #include "driver/sfs/bucket.h"
+#include "driver/sfs/checksum.h"
+#include "driver/sfs/content_store.h"
+#include "driver/sfs/multipart_state.h"
 #include "driver/sfs/object.h"
+#include "driver/sfs/space_ledger.h"
 #include "rgw_sal.h"
 #include "rgw_sal_store.h"
 
@@ -43,9 +48,49 @@ class SFSAtomicWriter : public StoreWriter {
   bool io_failed;
   int fd;
 
+  // Object size known before prepare() (set_size_hint), 0 if unknown.
+  // Used to reserve and preallocate the whole object in one go.
+  uint64_t size_hint;
+  bool preallocate;
+  uint64_t preallocate_max_step;
+  // End offset of the range preallocated with fallocate(). Extents past
+  // bytes_written are released on completion.
+  uint64_t preallocated_end;
+
+  // O_DIRECT fd, opened once bytes_written crosses direct_io_threshold.
+  // Data is queued in direct_pending and written in page-aligned
+  // blocks starting at direct_offset; the unaligned tail goes through
+  // the buffered fd.
+  uint64_t direct_io_threshold;
+  int direct_fd;
+  uint64_t direct_offset;
+  bufferlist direct_pending;
+
+  // crc32c of the data, invalid if the data is not written in order
+  sfs::Crc32c data_crc;
+  bool data_crc_valid;
+  // sha256 of the data for deduplication (rgw_sfs_dedup), dropped if
+  // the data is not written in order
+  std::unique_ptr<sfs::ContentHasher> content_hasher;
+  // the data file is linked to published content and must never be
+  // truncated
+  bool shares_content;
+  // ContentStore::lock(), held from linking to content until the
+  // version is committed with its reference
+  std::unique_lock<std::mutex> content_lock;
+  // disk space held for the data, see sfs::SpaceLedger
+  sfs::SpaceReservation space_reservation;
+
   int open() noexcept;
+  std::string maybe_share_content() noexcept;
   int close() noexcept;
   void cleanup() noexcept;
+  void maybe_preallocate(uint64_t end) noexcept;
+  void release_preallocated() noexcept;
+  void maybe_open_direct(uint64_t offset) noexcept;
+  int write_direct(bufferlist& data, uint64_t offset) noexcept;
+  int flush_direct_tail() noexcept;
+  int handle_write_error(int write_ret, size_t len, uint64_t offset) noexcept;
 
  public:
   SFSAtomicWriter(
@@ -56,6 +101,7 @@ class SFSAtomicWriter : public StoreWriter {
   );
   ~SFSAtomicWriter();
 
+  virtual void set_size_hint(uint64_t size) override { size_hint = size; }
   virtual int prepare(optional_yield y) override;
   virtual int process(bufferlist&& data, uint64_t offset) override;
   virtual int complete(
@@ -77,6 +123,13 @@ class SFSMultipartWriterV2 : public StoreWriter {
   uint32_t part_num;
   uint64_t bytes_written;
   int fd;
+  // crc32c of the part, invalid if the data is not written in order
+  Crc32c data_crc;
+  bool data_crc_valid;
+  // upload state shared with other writers of the same upload
+  MultipartUploadStateRef mp_state;
+  // disk space held for the part, see SpaceLedger
+  SpaceReservation space_reservation;
 
  public:
   SFSMultipartWriterV2(
@@ -89,7 +142,9 @@ class SFSMultipartWriterV2 : public StoreWriter {
         upload_id(_upload_id),
         part_num(_part_num),
         bytes_written(0),
-        fd(-1) {}
+        fd(-1),
+        data_crc_valid(true),
+        space_reservation(*_store->space_ledger) {}
   virtual ~SFSMultipartWriterV2();
 
   virtual int prepare(optional_yield y) override;
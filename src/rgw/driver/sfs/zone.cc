@@ -79,4 +79,17 @@ SFSZone::SFSZone(SFStore* _store) : store(_store) {
   zone_params->placement_pools["default"] = info;
 }
 
+void SFSZone::set_compression_type(const std::string& type) {
+  compression_type = type;
+  const bool enabled = !type.empty() && type != "none";
+  auto& info = zone_params->placement_pools["default"];
+  auto& storage_class =
+      info.storage_classes.get_all()[RGW_STORAGE_CLASS_STANDARD];
+  if (enabled) {
+    storage_class.compression_type = type;
+  } else {
+    storage_class.compression_type = boost::none;
+  }
+}
+
 }  // namespace rgw::sal
@@ -107,6 +107,7 @@ class SFSZone : public StoreZone {
   RGWZoneParams* zone_params{nullptr};
   RGWPeriod* current_period{nullptr};
   rgw_zone_id cur_zone_id;
+  std::string compression_type;
 
  public:
   SFSZone(const SFSZone&) = delete;
@@ -121,7 +122,9 @@ class SFSZone : public StoreZone {
   }
 
   virtual std::unique_ptr<Zone> clone() override {
-    return std::make_unique<SFSZone>(store);
+    auto zone = std::make_unique<SFSZone>(store);
+    zone->set_compression_type(compression_type);
+    return zone;
   }
   virtual ZoneGroup& get_zonegroup() override;
   virtual const std::string& get_id() override;
@@ -137,6 +140,10 @@ class SFSZone : public StoreZone {
   virtual RGWBucketSyncPolicyHandlerRef get_sync_policy_handler() override;
 
   const RGWZoneParams& get_params() { return *zone_params; }
+
+  /// Set the compression plugin of the default placement's STANDARD storage
+  /// class. "none" or an empty string disables compression.
+  void set_compression_type(const std::string& type);
 };
 
 }  // namespace rgw::sal
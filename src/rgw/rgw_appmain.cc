@@ -472,6 +472,8 @@ int rgw::AppMain::init_frontends2(RGWLib* rgwlib)
       if (driver && driver->get_name() == "sfs") {
         auto sfs = dynamic_cast<rgw::sal::SFStore*>(driver);
 	stat->register_status_page(sfs->make_status_page());
+	stat->register_status_page(sfs->make_prefix_stats_status_page());
+	stat->register_status_page(sfs->make_object_tags_status_page());
 	for (const auto& fn : sfs->custom_metric_fns()) {
 	  perf_counters->add_custom_metric_fn(fn);
 	  prometheus->add_custom_metric_fn(fn);
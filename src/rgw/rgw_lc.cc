@@ -1581,6 +1581,13 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
       return -1;
     }
 
+  /* let the store expire the whole bucket at once, if it can */
+  ret = sal_lc->expire_bucket(this, bucket.get(), config,
+			      [&]() { return worker_should_stop(stop_at, once); });
+  if (ret != -ENOTSUP) {
+    return ret;
+  }
+
   /* fetch information for zone checks */
   rgw::sal::Zone* zone = driver->get_zone();
 
@@ -3049,6 +3049,19 @@ void RGWListBucket::execute(optional_yield y)
   params.list_versions = list_versions;
   params.allow_unordered = allow_unordered;
   params.shard_id = shard_id;
+  if (stream_entries()) {
+    constexpr size_t stream_chunk = 100;
+    params.entry_cb = [this](rgw_bucket_dir_entry&& entry) {
+      objs.emplace_back(std::move(entry));
+      if (objs.size() >= stream_chunk) {
+        if (!sent_data) {
+          send_response_begin();
+        }
+        send_response_data();
+        objs.clear();
+      }
+    };
+  }
 
   rgw::sal::Bucket::ListResults results;
 
@@ -3056,7 +3069,8 @@ void RGWListBucket::execute(optional_yield y)
   if (op_ret >= 0) {
     next_marker = results.next_marker;
     is_truncated = results.is_truncated;
-    objs = std::move(results.objs);
+    objs.insert(objs.end(), std::make_move_iterator(results.objs.begin()),
+                std::make_move_iterator(results.objs.end()));
     common_prefixes = std::move(results.common_prefixes);
   }
 }
@@ -4110,6 +4124,9 @@ void RGWPutObj::execute(optional_yield y)
     processor = driver->get_atomic_writer(this, s->yield, s->object.get(),
 					 s->bucket_owner.get_id(),
 					 pdest_placement, olh_epoch, s->req_id);
+    if (!chunked_upload && copy_source.empty() && s->content_length > 0) {
+      processor->set_size_hint(s->content_length);
+    }
   }
 
   op_ret = processor->prepare(s->yield);
@@ -6967,10 +6984,10 @@ void RGWDeleteMultiObj::wait_flush(optional_yield y,
   }
 }
 
-void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_yield y,
-                                                 boost::asio::deadline_timer *formatter_flush_cond)
+std::optional<RGWDeleteMultiObj::prepared_delete>
+RGWDeleteMultiObj::prepare_individual_object(const rgw_obj_key& o, optional_yield y,
+                                             boost::asio::deadline_timer *formatter_flush_cond)
 {
-  std::string version_id;
   std::unique_ptr<rgw::sal::Object> obj = bucket->get_object(o);
   if (s->iam_policy || ! s->iam_user_policies.empty() || !s->session_policies.empty()) {
     auto identity_policy_res = eval_identity_or_session_policies(this, s->iam_user_policies, s->env,
@@ -6980,7 +6997,7 @@ void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_
                                                                  ARN(obj->get_obj()));
     if (identity_policy_res == Effect::Deny) {
       send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-      return;
+      return std::nullopt;
     }
 
     rgw::IAM::Effect e = Effect::Pass;
@@ -6997,7 +7014,7 @@ void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_
     }
     if (e == Effect::Deny) {
       send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-      return;
+      return std::nullopt;
     }
 
     if (!s->session_policies.empty()) {
@@ -7008,34 +7025,34 @@ void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_
                                                                   ARN(obj->get_obj()));
       if (session_policy_res == Effect::Deny) {
         send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-        return;
+        return std::nullopt;
       }
       if (princ_type == rgw::IAM::PolicyPrincipal::Role) {
         //Intersection of session policy and identity policy plus intersection of session policy and bucket policy
         if ((session_policy_res != Effect::Allow || identity_policy_res != Effect::Allow) &&
             (session_policy_res != Effect::Allow || e != Effect::Allow)) {
           send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-          return;
+          return std::nullopt;
         }
       } else if (princ_type == rgw::IAM::PolicyPrincipal::Session) {
         //Intersection of session policy and identity policy plus bucket policy
         if ((session_policy_res != Effect::Allow || identity_policy_res != Effect::Allow) && e != Effect::Allow) {
           send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-          return;
+          return std::nullopt;
         }
       } else if (princ_type == rgw::IAM::PolicyPrincipal::Other) {// there was no match in the bucket policy
         if (session_policy_res != Effect::Allow || identity_policy_res != Effect::Allow) {
           send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-          return;
+          return std::nullopt;
         }
       }
       send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-      return;
+      return std::nullopt;
     }
 
     if ((identity_policy_res == Effect::Pass && e == Effect::Pass && !acl_allowed)) {
       send_partial_response(o, false, "", -EACCES, formatter_flush_cond);
-      return;
+      return std::nullopt;
     }
   }
 
@@ -7054,7 +7071,7 @@ void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_
       } else {
         // Something went wrong.
         send_partial_response(o, false, "", ret, formatter_flush_cond);
-        return;
+        return std::nullopt;
       }
     } else {
       obj_size = astate->size;
@@ -7066,7 +7083,7 @@ void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_
       int object_lock_response = verify_object_lock(this, astate->attrset, bypass_perm, bypass_governance_mode);
       if (object_lock_response != 0) {
         send_partial_response(o, false, "", object_lock_response, formatter_flush_cond);
-        return;
+        return std::nullopt;
       }
     }
   }
@@ -7081,8 +7098,35 @@ void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_
   op_ret = res->publish_reserve(this);
   if (op_ret < 0) {
     send_partial_response(o, false, "", op_ret, formatter_flush_cond);
+    return std::nullopt;
+  }
+
+  return prepared_delete{o, std::move(obj), std::move(res), obj_size, etag};
+}
+
+void RGWDeleteMultiObj::complete_individual_object(prepared_delete& p, bool delete_marker,
+                                                   const std::string& marker_version_id, int ret,
+                                                   boost::asio::deadline_timer *formatter_flush_cond)
+{
+  std::string version_id;
+  send_partial_response(p.key, delete_marker, marker_version_id, ret, formatter_flush_cond);
+
+  // send request to notification manager
+  ret = p.res->publish_commit(this, p.obj_size, ceph::real_clock::now(), p.etag, version_id);
+  if (ret < 0) {
+    ldpp_dout(this, 1) << "ERROR: publishing notification failed, with error: " << ret << dendl;
+    // too late to rollback operation, hence op_ret is not set here
+  }
+}
+
+void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_yield y,
+                                                 boost::asio::deadline_timer *formatter_flush_cond)
+{
+  auto prepared = prepare_individual_object(o, y, formatter_flush_cond);
+  if (!prepared) {
     return;
   }
+  auto& obj = prepared->obj;
 
   obj->set_atomic();
 
@@ -7097,13 +7141,36 @@ void RGWDeleteMultiObj::handle_individual_object(const rgw_obj_key& o, optional_
     op_ret = 0;
   }
 
-  send_partial_response(o, del_op->result.delete_marker, del_op->result.version_id, op_ret, formatter_flush_cond);
+  complete_individual_object(*prepared, del_op->result.delete_marker,
+                             del_op->result.version_id, op_ret, formatter_flush_cond);
+}
 
-  // send request to notification manager
-  int ret = res->publish_commit(this, obj_size, ceph::real_clock::now(), etag, version_id);
-  if (ret < 0) {
-    ldpp_dout(this, 1) << "ERROR: publishing notification failed, with error: " << ret << dendl;
-    // too late to rollback operation, hence op_ret is not set here
+void RGWDeleteMultiObj::handle_objects_batch(const std::vector<rgw_obj_key>& objects,
+                                             optional_yield y,
+                                             boost::asio::deadline_timer *formatter_flush_cond)
+{
+  std::vector<prepared_delete> prepared;
+  std::vector<rgw::sal::Bucket::DeleteObjectsEntry> entries;
+  for (const auto& o : objects) {
+    auto p = prepare_individual_object(o, y, formatter_flush_cond);
+    if (!p) {
+      continue;
+    }
+    entries.emplace_back().key = o;
+    prepared.push_back(std::move(*p));
+  }
+  if (entries.empty()) {
+    return;
+  }
+
+  op_ret = bucket->delete_objects(this, entries, y);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    int ret = op_ret < 0 ? op_ret : entries[i].result;
+    if (ret == -ENOENT) {
+      ret = 0;
+    }
+    complete_individual_object(prepared[i], entries[i].delete_marker,
+                               entries[i].version_id, ret, formatter_flush_cond);
   }
 }
 
@@ -7176,21 +7243,25 @@ void RGWDeleteMultiObj::execute(optional_yield y)
     goto done;
   }
 
-  for (iter = multi_delete->objects.begin();
-        iter != multi_delete->objects.end();
-        ++iter) {
-    rgw_obj_key obj_key = *iter;
-    if (y && max_aio > 1) {
-      wait_flush(y, &*formatter_flush_cond, [&aio_count, max_aio] {
-        return aio_count < max_aio;
-      });
-      aio_count++;
-      spawn::spawn(y.get_yield_context(), [this, &y, &aio_count, obj_key, &formatter_flush_cond] (yield_context yield) {
-        handle_individual_object(obj_key, optional_yield { y.get_io_context(), yield }, &*formatter_flush_cond); 
-        aio_count--;
-      }); 
-    } else {
-      handle_individual_object(obj_key, y, &*formatter_flush_cond);
+  if (bucket->supports_delete_objects()) {
+    handle_objects_batch(multi_delete->objects, y, &*formatter_flush_cond);
+  } else {
+    for (iter = multi_delete->objects.begin();
+         iter != multi_delete->objects.end();
+         ++iter) {
+      rgw_obj_key obj_key = *iter;
+      if (y && max_aio > 1) {
+        wait_flush(y, &*formatter_flush_cond, [&aio_count, max_aio] {
+          return aio_count < max_aio;
+        });
+        aio_count++;
+        spawn::spawn(y.get_yield_context(), [this, &y, &aio_count, obj_key, &formatter_flush_cond] (yield_context yield) {
+          handle_individual_object(obj_key, optional_yield { y.get_io_context(), yield }, &*formatter_flush_cond);
+          aio_count--;
+        });
+      } else {
+        handle_individual_object(obj_key, y, &*formatter_flush_cond);
+      }
     }
   }
   if (formatter_flush_cond) {
@@ -7655,6 +7726,7 @@ int RGWBulkUploadOp::handle_file(const std::string_view path,
   processor = driver->get_atomic_writer(this, s->yield, obj.get(),
 				       bowner.get_id(),
 				       &s->dest_placement, 0, s->req_id);
+  processor->set_size_hint(size);
   op_ret = processor->prepare(s->yield);
   if (op_ret < 0) {
     ldpp_dout(this, 20) << "cannot prepare processor due to ret=" << op_ret << dendl;
@@ -924,13 +924,14 @@ protected:
   bool allow_unordered;
 
   int shard_id;
+  bool sent_data;
 
   int parse_max_keys();
 
 public:
   RGWListBucket() : list_versions(false), max(0),
                     default_max(0), is_truncated(false),
-		    allow_unordered(false), shard_id(-1) {}
+		    allow_unordered(false), shard_id(-1), sent_data(false) {}
   int verify_permission(optional_yield y) override;
   void pre_exec() override;
   void execute(optional_yield y) override;
@@ -939,6 +940,14 @@ public:
     RGWOp::init(driver, s, h);
   }
   virtual int get_params(optional_yield y) = 0;
+  /* If true, execute() asks the driver for the entries as they are read
+   * and hands them over in chunks: send_response_begin() once, then
+   * send_response_data() for every chunk in objs. send_response() gets
+   * the rest. Drivers that can't stream return everything at once and
+   * the response is sent as usual. */
+  virtual bool stream_entries() { return false; }
+  virtual void send_response_begin() {}
+  virtual void send_response_data() {}
   void send_response() override = 0;
   const char* name() const override { return "list_bucket"; }
   RGWOpType get_type() override { return RGW_OP_LIST_BUCKET; }
@@ -2033,6 +2042,36 @@ public:
 
 
 class RGWDeleteMultiObj : public RGWOp {
+  /**
+   * An object that passed the permission and object lock checks,
+   * with its notification reservation.
+   */
+  struct prepared_delete {
+    rgw_obj_key key;
+    std::unique_ptr<rgw::sal::Object> obj;
+    std::unique_ptr<rgw::sal::Notification> res;
+    uint64_t obj_size = 0;
+    std::string etag;
+  };
+
+  /**
+   * Checks whether an individual object may be deleted. Otherwise
+   * uses set_partial_response to record the outcome and returns
+   * nullopt.
+   */
+  std::optional<prepared_delete> prepare_individual_object(
+    const rgw_obj_key& o, optional_yield y,
+    boost::asio::deadline_timer *formatter_flush_cond);
+
+  /**
+   * Records the outcome of the deletion of a prepared object and
+   * sends its notification.
+   */
+  void complete_individual_object(
+    prepared_delete& p, bool delete_marker,
+    const std::string& marker_version_id, int ret,
+    boost::asio::deadline_timer *formatter_flush_cond);
+
   /**
    * Handles the deletion of an individual object and uses
    * set_partial_response to record the outcome.
@@ -2041,6 +2080,14 @@ class RGWDeleteMultiObj : public RGWOp {
 				optional_yield y,
                                 boost::asio::deadline_timer *formatter_flush_cond);
 
+  /**
+   * Deletes all objects that pass the checks with a single
+   * Bucket::delete_objects() call.
+   */
+  void handle_objects_batch(const std::vector<rgw_obj_key>& objects,
+			    optional_yield y,
+			    boost::asio::deadline_timer *formatter_flush_cond);
+
   /**
    * When the request is being executed in a coroutine, performs
    * the actual formatter flushing and is responsible for the
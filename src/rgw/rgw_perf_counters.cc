@@ -135,6 +135,21 @@ int rgw_perf_start(CephContext* cct) {
   plb.add_time_avg(l_rgw_sfs_gc_deleted_buckets_elapsed, "sfs_gc_deleted_buckets_elapsed", "GC step deleted buckets time");
   plb.add_time_avg(l_rgw_sfs_gc_done_aborted_multiparts_elapsed, "sfs_gc_pending_objects_data_elapsed", "GC step done+aborted multiparts time");
   plb.add_time_avg(l_rgw_sfs_gc_abort_bucket_multiparts_elapsed, "sfs_gc_pending_objects_data_elapsed", "GC abort bucket multiparts");
+  plb.add_u64_counter(l_rgw_sfs_gc_deleted_items, "sfs_gc_deleted_items", "Number of object versions and parts whose data GC deleted");
+  plb.add_u64(l_rgw_sfs_gc_delete_rate, "sfs_gc_delete_rate", "Data items deleted per second in the last GC run");
+  plb.add_u64(l_rgw_sfs_gc_backlog, "sfs_gc_backlog", "Object versions and parts waiting for GC after the last run");
+  plb.add_u64_counter(l_rgw_sfs_gc_journal_entries, "sfs_gc_journal_entries", "Number of GC journal entries processed");
+  plb.add_time_avg(l_rgw_sfs_gc_journal_elapsed, "sfs_gc_journal_elapsed", "Time spent processing the GC journal");
+
+  plb.add_u64_counter(l_rgw_sfs_scrub_passes, "sfs_scrub_passes", "Number of completed data scrub passes");
+  plb.add_u64_counter(l_rgw_sfs_scrub_objects, "sfs_scrub_objects", "Number of object versions scrubbed");
+  plb.add_u64_counter(l_rgw_sfs_scrub_bytes, "sfs_scrub_bytes", "Bytes read by the data scrubber");
+  plb.add_u64_counter(l_rgw_sfs_scrub_missing, "sfs_scrub_missing", "Object versions found without data");
+  plb.add_u64_counter(l_rgw_sfs_scrub_size_mismatch, "sfs_scrub_size_mismatch", "Object versions found with data of the wrong size");
+  plb.add_u64_counter(l_rgw_sfs_scrub_checksum_mismatch, "sfs_scrub_checksum_mismatch", "Object versions found with data not matching their checksum");
+  plb.add_u64_counter(l_rgw_sfs_scrub_backoffs, "sfs_scrub_backoffs", "Times the data scrubber backed off due to foreground latency");
+
+  plb.add_u64_counter(l_rgw_sfs_trash_files, "sfs_trash_files", "Number of data files removed from the trash of removed buckets");
 
   PerfCountersBuilder prom_plb_hist(
       cct, "rgw_prom_hist", l_rgw_prom_first, l_rgw_prom_last
@@ -77,6 +77,20 @@ enum {
   l_rgw_sfs_gc_deleted_objects_elapsed,
   l_rgw_sfs_gc_done_aborted_multiparts_elapsed,
   l_rgw_sfs_gc_abort_bucket_multiparts_elapsed,
+  l_rgw_sfs_gc_deleted_items,
+  l_rgw_sfs_gc_delete_rate,
+  l_rgw_sfs_gc_backlog,
+  l_rgw_sfs_gc_journal_entries,
+  l_rgw_sfs_gc_journal_elapsed,
+
+  l_rgw_sfs_scrub_passes,
+  l_rgw_sfs_scrub_objects,
+  l_rgw_sfs_scrub_bytes,
+  l_rgw_sfs_scrub_missing,
+  l_rgw_sfs_scrub_size_mismatch,
+  l_rgw_sfs_scrub_checksum_mismatch,
+  l_rgw_sfs_scrub_backoffs,
+  l_rgw_sfs_trash_files,
 
   l_rgw_last,
 };
@@ -103,7 +103,8 @@ class RGWPSCreateTopicOp : public RGWOp {
       // remove last separator
       dest.push_endpoint_args.pop_back();
     }
-    if (!dest.push_endpoint.empty() && dest.persistent) {
+    if (!dest.push_endpoint.empty() && dest.persistent &&
+        driver->has_persistent_topic_queues()) {
       const auto ret = rgw::notify::add_persistent_topic(topic_name, s->yield);
       if (ret < 0) {
         ldpp_dout(this, 1) << "CreateTopic Action failed to create queue for persistent topics. error:" << ret << dendl;
@@ -404,6 +405,10 @@ class RGWPSDeleteTopicOp : public RGWOp {
 
     topic_name = topic_arn->resource;
 
+    if (!driver->has_persistent_topic_queues()) {
+      return 0;
+    }
+
     // upon deletion it is not known if topic is persistent or not
     // will try to delete the persistent topic anyway
     const auto ret = rgw::notify::remove_persistent_topic(topic_name, s->yield);
@@ -1779,6 +1779,12 @@ void RGWListBucket_ObjStore_S3::send_versioned_response()
 
 
 void RGWListBucket_ObjStore_S3::send_common_response()
+{
+  send_common_response_head();
+  send_common_response_tail();
+}
+
+void RGWListBucket_ObjStore_S3::send_common_response_head()
 {
   if (!s->bucket_tenant.empty()) {
     s->formatter->dump_string("Tenant", s->bucket_tenant);
@@ -1793,6 +1799,10 @@ void RGWListBucket_ObjStore_S3::send_common_response()
       s->formatter->dump_string("Delimiter", delimiter);
     }
   }
+}
+
+void RGWListBucket_ObjStore_S3::send_common_response_tail()
+{
   s->formatter->dump_string("IsTruncated", (max && is_truncated ? "true"
               : "false"));
 
@@ -1811,8 +1821,98 @@ void RGWListBucket_ObjStore_S3::send_common_response()
     }
   }
 
+void RGWListBucket_ObjStore_S3::dump_entries()
+{
+  vector<rgw_bucket_dir_entry>::iterator iter;
+  for (iter = objs.begin(); iter != objs.end(); ++iter) {
+
+    rgw_obj_key key(iter->key);
+    std::string key_name;
+
+    if (encode_key) {
+      url_encode(key.name, key_name);
+    } else {
+      key_name = key.name;
+    }
+    /* conditionally format JSON in the obvious way--I'm unsure if
+     * AWS actually does this */
+    if (s->format == RGWFormat::XML) {
+      s->formatter->open_array_section("Contents");
+    } else {
+      // json
+      s->formatter->open_object_section("dummy");
+    }
+    s->formatter->dump_string("Key", key_name);
+    dump_time(s, "LastModified", iter->meta.mtime);
+    s->formatter->dump_format("ETag", "\"%s\"", iter->meta.etag.c_str());
+    s->formatter->dump_int("Size", iter->meta.accounted_size);
+    auto& storage_class = rgw_placement_rule::get_canonical_storage_class(iter->meta.storage_class);
+    s->formatter->dump_string("StorageClass", storage_class.c_str());
+    dump_owner(s, rgw_user(iter->meta.owner), iter->meta.owner_display_name);
+    if (s->system_request) {
+      s->formatter->dump_string("RgwxTag", iter->tag);
+    }
+    if (iter->meta.appendable) {
+      s->formatter->dump_string("Type", "Appendable");
+    } else {
+      s->formatter->dump_string("Type", "Normal");
+    }
+    // JSON has one extra section per element
+    s->formatter->close_section();
+  } // foreach obj
+}
+
+/* Called by execute() before the first chunk of a streamed listing.
+ * The listing has only started, so IsTruncated and CommonPrefixes
+ * follow the entries, see send_response(). */
+void RGWListBucket_ObjStore_S3::send_response_begin()
+{
+  sent_data = true;
+  dump_errno(s);
+  end_header(s, this, to_mime_type(s->format), CHUNKED_TRANSFER_ENCODING);
+  dump_start(s);
+
+  s->formatter->open_object_section_in_ns("ListBucketResult", XMLNS_AWS_S3);
+  if (strcasecmp(encoding_type.c_str(), "url") == 0) {
+    s->formatter->dump_string("EncodingType", "url");
+    encode_key = true;
+  }
+  send_common_response_head();
+  if (s->format == RGWFormat::JSON) {
+    s->formatter->open_array_section("Contents");
+  }
+}
+
+void RGWListBucket_ObjStore_S3::send_response_data()
+{
+  dump_entries();
+  rgw_flush_formatter(s, s->formatter);
+}
+
 void RGWListBucket_ObjStore_S3::send_response()
 {
+  if (sent_data) {
+    if (op_ret < 0) {
+      // The status went out with the first chunk. Leave the document
+      // unfinished, the client must not take it for a short listing.
+      ldpp_dout(this, 0) << "ERROR: bucket listing failed after streaming "
+                         << "started: " << op_ret << dendl;
+      return;
+    }
+    dump_entries();
+    if (s->format == RGWFormat::JSON) {
+      s->formatter->close_section();
+    }
+    send_common_response_tail();
+    s->formatter->dump_string("Marker", marker.name);
+    if (is_truncated && !next_marker.empty()) {
+      s->formatter->dump_string("NextMarker", next_marker.name);
+    }
+    s->formatter->close_section();
+    rgw_flush_formatter_and_reset(s, s->formatter);
+    return;
+  }
+
   if (op_ret < 0) {
     set_req_state_err(s, op_ret);
   }
@@ -1842,43 +1942,7 @@ void RGWListBucket_ObjStore_S3::send_response()
     if (s->format == RGWFormat::JSON) {
       s->formatter->open_array_section("Contents");
     }
-    vector<rgw_bucket_dir_entry>::iterator iter;
-    for (iter = objs.begin(); iter != objs.end(); ++iter) {
-
-      rgw_obj_key key(iter->key);
-      std::string key_name;
-
-      if (encode_key) {
-	url_encode(key.name, key_name);
-      } else {
-	key_name = key.name;
-      }
-      /* conditionally format JSON in the obvious way--I'm unsure if
-       * AWS actually does this */
-      if (s->format == RGWFormat::XML) {
-	s->formatter->open_array_section("Contents");
-      } else {
-	// json
-	s->formatter->open_object_section("dummy");
-      }
-      s->formatter->dump_string("Key", key_name);
-      dump_time(s, "LastModified", iter->meta.mtime);
-      s->formatter->dump_format("ETag", "\"%s\"", iter->meta.etag.c_str());
-      s->formatter->dump_int("Size", iter->meta.accounted_size);
-      auto& storage_class = rgw_placement_rule::get_canonical_storage_class(iter->meta.storage_class);
-      s->formatter->dump_string("StorageClass", storage_class.c_str());
-      dump_owner(s, rgw_user(iter->meta.owner), iter->meta.owner_display_name);
-      if (s->system_request) {
-	s->formatter->dump_string("RgwxTag", iter->tag);
-      }
-      if (iter->meta.appendable) {
-	s->formatter->dump_string("Type", "Appendable");
-	} else {
-	s->formatter->dump_string("Type", "Normal");
-      }
-      // JSON has one extra section per element
-      s->formatter->close_section();
-    } // foreach obj
+    dump_entries();
     if (s->format == RGWFormat::JSON) {
       s->formatter->close_section();
     }
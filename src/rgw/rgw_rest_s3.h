@@ -154,7 +154,10 @@ protected:
   bool encode_key {false};
   int get_common_params();
   void send_common_response();
+  void send_common_response_head();
+  void send_common_response_tail();
   void send_common_versioned_response();
+  void dump_entries();
   public:
   RGWListBucket_ObjStore_S3() : objs_container(false) {
     default_max = 1000;
@@ -162,6 +165,9 @@ protected:
   ~RGWListBucket_ObjStore_S3() override {}
 
   int get_params(optional_yield y) override;
+  bool stream_entries() override { return !list_versions; }
+  void send_response_begin() override;
+  void send_response_data() override;
   void send_response() override;
   void send_versioned_response();
 };
@@ -178,6 +184,7 @@ public:
   ~RGWListBucket_ObjStore_S3v2() override {}
 
   int get_params(optional_yield y) override;
+  bool stream_entries() override { return false; }
   void send_response() override;
   void send_versioned_response();
 };
@@ -26,6 +26,7 @@
 class RGWRESTMgr;
 class RGWAccessListFilter;
 class RGWLC;
+class RGWLifecycleConfiguration;
 struct rgw_user_bucket;
 class RGWUsageBatch;
 class RGWCoroutinesManagerRegistry;
@@ -338,6 +339,10 @@ class Driver {
     const DoutPrefixProvider* dpp, rgw::sal::Object* obj, rgw::sal::Object* src_obj,
     rgw::notify::EventType event_type, rgw::sal::Bucket* _bucket, std::string& _user_id, std::string& _user_tenant,
     std::string& _req_id, optional_yield y) = 0;
+    /** Whether persistent topics need a queue created with
+     * rgw::notify::add_persistent_topic().  Drivers that keep the events of
+     * all topics in their own store return false. */
+    virtual bool has_persistent_topic_queues() const { return false; }
     /** Read the topic config entry into @a data and (optionally) @a objv_tracker */
     virtual int read_topics(const std::string& tenant, rgw_pubsub_topics& topics, RGWObjVersionTracker* objv_tracker,
         optional_yield y, const DoutPrefixProvider *dpp) = 0;
@@ -615,6 +620,10 @@ class Bucket {
       bool list_versions{false};
       bool allow_unordered{false};
       int shard_id{RGW_NO_SHARD};
+      /** If set, drivers that support it pass each listed entry to this
+       * as soon as it is read, in listing order, instead of adding it to
+       * ListResults::objs. Other drivers ignore it. */
+      std::function<void(rgw_bucket_dir_entry&&)> entry_cb;
 
       friend std::ostream& operator<<(std::ostream& out, const ListParams& p) {
 	out << "rgw::sal::Bucket::ListParams{ prefix=\"" << p.prefix <<
@@ -640,6 +649,15 @@ class Bucket {
       rgw_obj_key next_marker;
     };
 
+    /** One object of a delete_objects() call and its outcome */
+    struct DeleteObjectsEntry {
+      rgw_obj_key key;
+      int result{0};
+      bool delete_marker{false};
+      /** Version deleted, or version of the delete marker created */
+      std::string version_id;
+    };
+
     Bucket() = default;
     virtual ~Bucket() = default;
 
@@ -647,6 +665,14 @@ class Bucket {
     virtual std::unique_ptr<Object> get_object(const rgw_obj_key& key) = 0;
     /** List the contents of this bucket */
     virtual int list(const DoutPrefixProvider* dpp, ListParams&, int, ListResults&, optional_yield y) = 0;
+    /** Whether delete_objects() is implemented.  Objects are deleted one
+     * at a time through Object::DeleteOp otherwise. */
+    virtual bool supports_delete_objects() const { return false; }
+    /** Delete several objects of this bucket at once, each as
+     * Object::DeleteOp would, and set the outcome of each entry */
+    virtual int delete_objects(const DoutPrefixProvider* dpp,
+			       std::vector<DeleteObjectsEntry>& entries,
+			       optional_yield y) { return -ENOTSUP; }
     /** Get the cached attributes associated with this bucket */
     virtual Attrs& get_attrs(void) = 0;
     /** Set the cached attributes on this bucket */
@@ -1384,6 +1410,15 @@ public:
   virtual std::unique_ptr<LCSerializer> get_serializer(const std::string& lock_name,
 						       const std::string& oid,
 						       const std::string& cookie) = 0;
+  /** Apply the expiration rules of @a config to @a bucket in the backing
+   * store directly, without listing the bucket.  Returns -ENOTSUP if the
+   * store cannot handle @a config, in which case RGWLC processes the bucket
+   * object by object.  @a should_stop is polled between batches. */
+  virtual int expire_bucket(const DoutPrefixProvider* dpp, Bucket* bucket,
+			    RGWLifecycleConfiguration& config,
+			    const std::function<bool()>& should_stop) {
+    return -ENOTSUP;
+  }
 };
 
 /**
@@ -1418,6 +1453,10 @@ public:
   Writer() {}
   virtual ~Writer() = default;
 
+  /** Let the writer know the size of the object data before prepare(),
+   * if known. Writers may use it to allocate space up front. */
+  virtual void set_size_hint(uint64_t size) {}
+
   /** prepare to start processing object data */
   virtual int prepare(optional_yield y) = 0;
 
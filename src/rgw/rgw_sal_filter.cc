@@ -1288,6 +1288,14 @@ std::unique_ptr<LCSerializer> FilterLifecycle::get_serializer(
   return std::make_unique<FilterLCSerializer>(std::move(ns));
 }
 
+int FilterLifecycle::expire_bucket(const DoutPrefixProvider* dpp,
+				   Bucket* bucket,
+				   RGWLifecycleConfiguration& config,
+				   const std::function<bool()>& should_stop)
+{
+  return next->expire_bucket(dpp, nextBucket(bucket), config, should_stop);
+}
+
 int FilterNotification::publish_reserve(const DoutPrefixProvider *dpp,
 					RGWObjTags* obj_tags)
 {
@@ -213,6 +213,9 @@ public:
     rgw::notify::EventType event_type, rgw::sal::Bucket* _bucket,
     std::string& _user_id, std::string& _user_tenant,
     std::string& _req_id, optional_yield y) override;
+  virtual bool has_persistent_topic_queues() const override {
+    return next->has_persistent_topic_queues();
+  }
 
   int read_topics(const std::string& tenant, rgw_pubsub_topics& topics, RGWObjVersionTracker* objv_tracker,
       optional_yield y, const DoutPrefixProvider *dpp) override {
@@ -422,6 +425,14 @@ public:
   virtual std::unique_ptr<Object> get_object(const rgw_obj_key& key) override;
   virtual int list(const DoutPrefixProvider* dpp, ListParams&, int,
 		   ListResults&, optional_yield y) override;
+  virtual bool supports_delete_objects() const override {
+    return next->supports_delete_objects();
+  }
+  virtual int delete_objects(const DoutPrefixProvider* dpp,
+			     std::vector<DeleteObjectsEntry>& entries,
+			     optional_yield y) override {
+    return next->delete_objects(dpp, entries, y);
+  }
   virtual Attrs& get_attrs(void) override { return next->get_attrs(); }
   virtual int set_attrs(Attrs a) override { return next->set_attrs(a); }
   virtual int remove_bucket(const DoutPrefixProvider* dpp, bool delete_children,
@@ -862,6 +873,9 @@ public:
   virtual std::unique_ptr<LCSerializer> get_serializer(const std::string& lock_name,
 						       const std::string& oid,
 						       const std::string& cookie) override;
+  virtual int expire_bucket(const DoutPrefixProvider* dpp, Bucket* bucket,
+			    RGWLifecycleConfiguration& config,
+			    const std::function<bool()>& should_stop) override;
 };
 
 class FilterNotification : public Notification {
@@ -890,6 +904,7 @@ public:
     next(std::move(_next)), obj(_obj) {}
   virtual ~FilterWriter() = default;
 
+  virtual void set_size_hint(uint64_t size) override { next->set_size_hint(size); }
   virtual int prepare(optional_yield y) { return next->prepare(y); }
   virtual int process(bufferlist&& data, uint64_t offset) override;
   virtual int complete(size_t accounted_size, const std::string& etag,
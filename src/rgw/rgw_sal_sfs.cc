@@ -15,10 +15,15 @@
 #include "rgw_sal_sfs.h"
 
 #include <errno.h>
+#include <fmt/format.h>
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <limits>
+#include <map>
+#include <optional>
 #include <sstream>
 #include <system_error>
 #include <thread>
@@ -26,15 +31,24 @@
 
 #include "cls/rgw/cls_rgw_client.h"
 #include "common/Clock.h"
+#include "common/Formatter.h"
 #include "common/ceph_mutex.h"
 #include "common/errno.h"
 #include "driver/sfs/notification.h"
+#include "driver/sfs/sfs_backup.h"
 #include "driver/sfs/sfs_gc.h"
 #include "driver/sfs/sfs_lc.h"
+#include "driver/sfs/sfs_notify.h"
+#include "driver/sfs/sfs_rest_prefix_stats.h"
+#include "driver/sfs/sfs_scrub.h"
+#include "driver/sfs/sfs_usage.h"
 #include "driver/sfs/sqlite/dbconn.h"
 #include "driver/sfs/writer.h"
 #include "include/util.h"
 #include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_object_tags.h"
+#include "rgw/driver/sfs/sqlite/sqlite_notifications.h"
+#include "rgw/driver/sfs/sqlite/sqlite_prefix_stats.h"
 #include "rgw/driver/sfs/sqlite/sqlite_users.h"
 #include "rgw_acl_s3.h"
 #include "rgw_aio.h"
@@ -85,8 +99,9 @@ std::unique_ptr<Notification> SFStore::get_notification(
     rgw::notify::EventType event_type, optional_yield y,
     const std::string* object_name
 ) {
-  ldout(ctx(), 10) << __func__ << ": return stub notification" << dendl;
-  return std::make_unique<SFSNotification>(obj, src_obj, event_type);
+  return std::make_unique<SFSNotification>(
+      this, obj, src_obj, s, event_type, object_name
+  );
 }
 
 std::unique_ptr<Notification> SFStore::get_notification(
@@ -95,8 +110,67 @@ std::unique_ptr<Notification> SFStore::get_notification(
     rgw::sal::Bucket* _bucket, std::string& _user_id, std::string& _user_tenant,
     std::string& _req_id, optional_yield y
 ) {
-  ldpp_dout(dpp, 10) << __func__ << ": return stub notification" << dendl;
-  return std::make_unique<SFSNotification>(obj, src_obj, event_type);
+  return std::make_unique<SFSNotification>(
+      this, obj, src_obj, event_type, _bucket, _user_id, _req_id
+  );
+}
+
+int SFStore::read_topics(
+    const std::string& tenant, rgw_pubsub_topics& topics,
+    RGWObjVersionTracker* objv_tracker, optional_yield y,
+    const DoutPrefixProvider* dpp
+) {
+  sfs::sqlite::SQLiteNotifications db_notifications(db_conn);
+  const auto db_topics = db_notifications.get_topics(tenant);
+  if (!db_topics.has_value()) {
+    return -ENOENT;
+  }
+  const int ret = decode_topics(db_topics->topics, topics);
+  if (ret < 0) {
+    ldpp_dout(dpp, 1) << __func__ << ": failed to decode topics of tenant '"
+                      << tenant << "'" << dendl;
+    return ret;
+  }
+  if (objv_tracker) {
+    objv_tracker->read_version.ver = db_topics->version;
+  }
+  return 0;
+}
+
+int SFStore::write_topics(
+    const std::string& tenant, const rgw_pubsub_topics& topics,
+    RGWObjVersionTracker* objv_tracker, optional_yield y,
+    const DoutPrefixProvider* dpp
+) {
+  // like RADOS, only check the version if one was read
+  std::optional<uint64_t> expected_version;
+  if (objv_tracker && objv_tracker->read_version.ver > 0) {
+    expected_version = objv_tracker->read_version.ver;
+  }
+  sfs::sqlite::SQLiteNotifications db_notifications(db_conn);
+  const auto version = db_notifications.store_topics(
+      tenant, encode_topics(topics), expected_version
+  );
+  if (version == 0) {
+    ldpp_dout(dpp, 10) << __func__ << ": topics of tenant '" << tenant
+                       << "' changed concurrently" << dendl;
+    return -ECANCELED;
+  }
+  if (objv_tracker) {
+    objv_tracker->read_version.ver = version;
+  }
+  return 0;
+}
+
+int SFStore::remove_topics(
+    const std::string& tenant, RGWObjVersionTracker* objv_tracker,
+    optional_yield y, const DoutPrefixProvider* dpp
+) {
+  sfs::sqlite::SQLiteNotifications db_notifications(db_conn);
+  if (!db_notifications.remove_topics(tenant)) {
+    return -ENOENT;
+  }
+  return 0;
 }
 
 // }}}
@@ -237,15 +311,28 @@ int SFStore::read_all_usage(
     uint32_t max_entries, bool* is_truncated, RGWUsageIter& usage_iter,
     map<rgw_user_bucket, rgw_usage_log_entry>& usage
 ) {
-  ldpp_dout(dpp, 10) << __func__ << ": TODO" << dendl;
-  return 0;
+  sfs::UsageBackend::Range range;
+  range.start_epoch = start_epoch;
+  range.end_epoch = end_epoch;
+  return sfs::read_usage(
+      dpp, *usage_backend, range, max_entries, is_truncated, usage_iter,
+      usage
+  );
 }
 
 int SFStore::trim_all_usage(
     const DoutPrefixProvider* dpp, uint64_t start_epoch, uint64_t end_epoch
 ) {
-  ldpp_dout(dpp, 10) << __func__ << ": TODO" << dendl;
-  return 0;
+  sfs::UsageBackend::Range range;
+  range.start_epoch = start_epoch;
+  range.end_epoch = end_epoch;
+  return sfs::trim_usage(dpp, *usage_backend, range);
+}
+
+int SFStore::clear_usage(const DoutPrefixProvider* dpp) {
+  sfs::UsageBackend::Range range;
+  range.end_epoch = std::numeric_limits<uint64_t>::max();
+  return sfs::trim_usage(dpp, *usage_backend, range);
 }
 
 int SFStore::get_config_key_val(string name, bufferlist* bl) {
@@ -261,9 +348,8 @@ int SFStore::get_config_key_val(string name, bufferlist* bl) {
  This would allow that as-yet-nonexistent class to keep track of max and
  truncated in meta_list_keys_next().  Instead, the immediate nasty hack is
  to make handle point at a const string which indicates what type of
- metadata we're dealing with, then check that value and call an instance
- of the appropriate rgw::sal::sfs::sqlite::SQLite* class to get the
- metadata we care about.
+ metadata we're dealing with, then check that value and ask the
+ matching part of the metadata backend for the metadata we care about.
 
  TODO: replace this nasty hack.
  */
@@ -289,12 +375,10 @@ int SFStore::meta_list_keys_next(
 ) {
   *truncated = false;
   if (handle == (void*)handle_user) {
-    rgw::sal::sfs::sqlite::SQLiteUsers sqlite_users(db_conn);
-    auto ids = sqlite_users.get_user_ids();
+    auto ids = metadata->users().get_user_ids();
     std::copy(ids.begin(), ids.end(), std::back_inserter(keys));
   } else if (handle == (void*)handle_bucket) {
-    rgw::sal::sfs::sqlite::SQLiteBuckets sqlite_buckets(db_conn);
-    auto ids = sqlite_buckets.get_bucket_ids();
+    auto ids = metadata->buckets().get_bucket_ids();
     std::copy(ids.begin(), ids.end(), std::back_inserter(keys));
   }
   return 0;
@@ -370,6 +454,7 @@ void SFStore::register_admin_apis(RGWRESTMgr* mgr) {
   /*Registering resource for /admin/metadata */
   mgr->register_resource("metadata", new RGWRESTMgr_Metadata);
   mgr->register_resource("log", new RGWRESTMgr_Log);
+  mgr->register_resource("prefix-stats", new RGWRESTMgr_SFS_PrefixStats);
 };
 
 // Store > Logging {{{
@@ -377,7 +462,13 @@ int SFStore::log_usage(
     const DoutPrefixProvider* dpp,
     map<rgw_user_bucket, RGWUsageBatch>& usage_info
 ) {
-  ldpp_dout(dpp, 10) << __func__ << ": TODO" << dendl;
+  try {
+    sfs::log_usage(*usage_backend, usage_info);
+  } catch (const std::system_error& e) {
+    ldpp_dout(dpp, 1) << __func__ << ": failed to store usage: " << e.what()
+                      << dendl;
+    return -EIO;
+  }
   return 0;
 }
 
@@ -465,9 +556,194 @@ http::status SFSStatusPage::render(std::ostream& os) {
 
   os << "</ul>";
 
+  const auto scrub = sfs->scrubber->get_status();
+  os << "<h2>Scrub</h2>\n"
+     << "<ul>\n"
+     << "<li> cursor: version " << scrub.last_version_id << "</li>\n"
+     << "<li> last pass end: " << scrub.last_pass_end << "</li>\n"
+     << "<li> recent findings: " << scrub.findings.size() << "<ul>\n";
+  for (const auto& finding : scrub.findings) {
+    os << "<li>" << finding.when << " version " << finding.version_id << " "
+       << finding.path << ": " << finding.result << "</li>\n";
+  }
+  os << "</ul></li>\n"
+     << "</ul>";
+
+  sfs::sqlite::SQLiteNotifications db_notifications(sfs->db_conn);
+  os << "<h2>Notifications</h2>\n"
+     << "<ul>\n"
+     << "<li> queued events: " << db_notifications.count_events() << "</li>\n"
+     << "</ul>";
+
+  if (sfs->backup) {
+    const auto backup = sfs->backup->get_status();
+    os << "<h2>Backup</h2>\n"
+       << "<ul>\n"
+       << "<li> generation: " << backup.generation << "</li>\n"
+       << "<li> snapshot: " << backup.last_snapshot << "</li>\n"
+       << "<li> WAL segments: " << backup.segments << " (" << backup.frames
+       << " frames)</li>\n"
+       << "<li> last WAL segment: " << backup.last_segment << "</li>\n"
+       << "</ul>";
+  }
+
   return boost::beast::http::status::ok;
 }
 
+// target is page, or page with a query string
+static bool serves_page(std::string_view page, std::string_view target) {
+  return target == page ||
+         (target.starts_with(page) && target.substr(page.size(), 1) == "?");
+}
+
+// url decoded key=value arguments of the query string of target
+static std::map<std::string, std::string> parse_query(std::string_view target
+) {
+  std::map<std::string, std::string> args;
+  const auto query_pos = target.find('?');
+  if (query_pos == target.npos) {
+    return args;
+  }
+  std::string_view query = target.substr(query_pos + 1);
+  while (!query.empty()) {
+    const auto arg = query.substr(0, query.find('&'));
+    query.remove_prefix(std::min(query.size(), arg.size() + 1));
+    const auto eq = arg.find('=');
+    args[std::string(arg.substr(0, eq))] =
+        eq == arg.npos ? std::string() : url_decode(arg.substr(eq + 1), true);
+  }
+  return args;
+}
+
+static http::status render_error(
+    std::ostream& os, http::status status, std::string_view message
+) {
+  JSONFormatter f(true);
+  f.open_object_section("error");
+  f.dump_string("message", message);
+  f.close_section();
+  f.flush(os);
+  return status;
+}
+
+SFSPrefixStatsStatusPage::SFSPrefixStatsStatusPage(SFStore* store)
+    : sfs(store) {}
+
+SFSPrefixStatsStatusPage::~SFSPrefixStatsStatusPage() {}
+
+bool SFSPrefixStatsStatusPage::serves(std::string_view target) const {
+  return serves_page(prefix(), target);
+}
+
+http::status SFSPrefixStatsStatusPage::render(std::ostream& os) {
+  return render_target(os, prefix());
+}
+
+http::status SFSPrefixStatsStatusPage::render_target(
+    std::ostream& os, std::string_view target
+) {
+  auto args = parse_query(target);
+  const std::string& bucket_name = args["bucket"];
+  const std::string& prefix = args["prefix"];
+
+  if (sfs->db_conn->prefix_stats_depth == 0) {
+    return render_error(
+        os, http::status::not_found,
+        "prefix stats are disabled, see rgw_sfs_prefix_stats_depth"
+    );
+  }
+  const auto bucket = sfs->get_bucket_ref(bucket_name);
+  if (!bucket) {
+    return render_error(os, http::status::not_found, "no such bucket");
+  }
+  sfs::sqlite::SQLitePrefixStats prefix_stats(sfs->db_conn);
+  const auto usage = prefix_stats.get_usage(bucket->get_bucket_id(), prefix);
+  if (!usage.has_value()) {
+    return render_error(
+        os, http::status::bad_request,
+        fmt::format(
+            "prefix must be empty or end with '{}' and be at most {} levels "
+            "deep",
+            sfs->db_conn->prefix_stats_delimiter,
+            sfs->db_conn->prefix_stats_depth
+        )
+    );
+  }
+
+  JSONFormatter f(true);
+  sfs::dump_prefix_usage(&f, bucket_name, *usage);
+  f.flush(os);
+  return http::status::ok;
+}
+
+SFSObjectTagsStatusPage::SFSObjectTagsStatusPage(SFStore* store)
+    : sfs(store) {}
+
+SFSObjectTagsStatusPage::~SFSObjectTagsStatusPage() {}
+
+bool SFSObjectTagsStatusPage::serves(std::string_view target) const {
+  return serves_page(prefix(), target);
+}
+
+http::status SFSObjectTagsStatusPage::render(std::ostream& os) {
+  return render_target(os, prefix());
+}
+
+http::status SFSObjectTagsStatusPage::render_target(
+    std::ostream& os, std::string_view target
+) {
+  static constexpr uint DEFAULT_MAX = 1000;
+  auto args = parse_query(target);
+  const std::string& bucket_name = args["bucket"];
+  const std::string& key = args["key"];
+  std::optional<std::string> value;
+  if (args.contains("value")) {
+    value = args["value"];
+  }
+  uint max = DEFAULT_MAX;
+  const auto requested_max = strtoul(args["max"].c_str(), nullptr, 10);
+  if (requested_max > 0 && requested_max < DEFAULT_MAX) {
+    max = requested_max;
+  }
+
+  if (key.empty()) {
+    return render_error(os, http::status::bad_request, "key is required");
+  }
+  if (!sfs->metadata->in_sqlite()) {
+    return render_error(
+        os, http::status::not_found,
+        "object tag indexes are not available with "
+        "rgw_sfs_metadata_backend=rocksdb"
+    );
+  }
+  const auto bucket = sfs->get_bucket_ref(bucket_name);
+  if (!bucket) {
+    return render_error(os, http::status::not_found, "no such bucket");
+  }
+  sfs::sqlite::SQLiteObjectTags object_tags(sfs->db_conn);
+  const auto matches = object_tags.list_current_objects(
+      bucket->get_bucket_id(), key, value, args["start-after"], max
+  );
+
+  JSONFormatter f(true);
+  f.open_object_section("object_tags");
+  f.dump_string("bucket", bucket_name);
+  f.dump_string("key", key);
+  f.open_array_section("objects");
+  for (const auto& match : matches) {
+    f.open_object_section("object");
+    f.dump_string("name", match.name);
+    f.dump_string("version_id", match.version_id);
+    f.dump_string("value", match.value);
+    f.close_section();
+  }
+  f.close_section();
+  f.dump_bool("truncated", matches.size() == max);
+  f.close_section();
+  f.flush(os);
+  return http::status::ok;
+}
+
 // }}}
 
 // Initialization {{{
@@ -475,6 +751,12 @@ http::status SFSStatusPage::render(std::ostream& os) {
 int SFStore::initialize(CephContext* cct, const DoutPrefixProvider* dpp) {
   ldpp_dout(dpp, 10) << __func__ << dendl;
   gc->initialize();
+  scrubber->initialize();
+  notification_sender->initialize();
+  if (backup) {
+    backup->initialize();
+  }
+  bucket_dirs->initialize();
   lc = new RGWLC();
   lc->initialize(cct, this);
   lc->start_processor();
@@ -490,6 +772,12 @@ void SFStore::maybe_init_store() {
   if (!std::filesystem::exists(data_path)) {
     std::filesystem::create_directories(data_path);
   }
+  data_dirs = std::make_unique<sfs::DataDirs>(
+      data_path, cctx->_conf.get_val<bool>("rgw_sfs_data_dirs_openat")
+  );
+  if (cctx->_conf.get_val<bool>("rgw_sfs_data_dirs_precreate")) {
+    data_dirs->precreate(cctx);
+  }
 }
 
 void SFStore::filesystem_stats_updater_main(
@@ -499,6 +787,7 @@ void SFStore::filesystem_stats_updater_main(
     std::unique_lock lock(filesystem_stats_updater_mutex);
     ldout(ctx(), 20) << __func__ << ": updating filesystem stats" << dendl;
 
+    const uint64_t written = space_ledger->get_written();
     ceph_data_stats_t stats;
     int ret = get_fs_stats(stats, data_path.c_str());
     ceph_assert(ret >= 0);
@@ -506,6 +795,7 @@ void SFStore::filesystem_stats_updater_main(
     filesystem_stats_avail_bytes = stats.byte_avail;
     filesystem_stats_avail_percent = stats.avail_percent;
     filesystem_stats_total_bytes = stats.byte_total;
+    space_ledger->update(stats.byte_avail, written);
 
     const auto shutdown_requested = filesystem_stats_updater_cvar.wait_for(
         lock, update_interval, [&] { return shutdown; }
@@ -579,6 +869,30 @@ SFStore::custom_metric_fns() {
             static_cast<double>(filesystem_stats_avail_bytes)
         );
       },
+      [&]() {
+        return std::make_tuple(
+            perfcounter_type_d::PERFCOUNTER_U64, "sfs_space_reserved_bytes",
+            static_cast<double>(space_ledger->get_reserved())
+        );
+      },
+      [&]() {
+        return std::make_tuple(
+            perfcounter_type_d::PERFCOUNTER_U64, "sfs_data_cache_bytes",
+            static_cast<double>(data_cache->get_bytes())
+        );
+      },
+      [&]() {
+        return std::make_tuple(
+            perfcounter_type_d::PERFCOUNTER_U64, "sfs_data_cache_hits",
+            static_cast<double>(data_cache->get_hits())
+        );
+      },
+      [&]() {
+        return std::make_tuple(
+            perfcounter_type_d::PERFCOUNTER_U64, "sfs_data_cache_misses",
+            static_cast<double>(data_cache->get_misses())
+        );
+      },
       [&]() {
         const auto sqlite_fds = std::ranges::count_if(
             std::filesystem::directory_iterator{"/proc/self/fd"},
@@ -611,12 +925,37 @@ SFStore::SFStore(CephContext* c, const std::filesystem::path& data_path)
           c->_conf.get_val<uint64_t>("rgw_sfs_min_space_left_for_write_ops")
       ) {
   maybe_init_store();
+  zone.set_compression_type(
+      cctx->_conf.get_val<std::string>("rgw_sfs_compression_type")
+  );
   db_conn = std::make_shared<sfs::sqlite::DBConn>(cctx);
-  sfs::sqlite::SQLiteVersionedObjects objs_versions(db_conn);
-  int num_deleted = objs_versions.set_all_open_versions_to_deleted();
+  metadata = sfs::make_metadata_backend(cctx, db_conn, data_path);
+  content_store =
+      std::make_unique<sfs::ContentStore>(cctx, data_path, db_conn);
+  data_cache = std::make_unique<sfs::DataCache>(
+      c->_conf.get_val<Option::size_t>("rgw_sfs_data_cache_size"),
+      c->_conf.get_val<Option::size_t>("rgw_sfs_data_cache_max_object_size"),
+      c->_conf.get_val<uint64_t>("rgw_sfs_data_cache_shards")
+  );
+  bucket_dirs = std::make_unique<sfs::BucketDirs>(cctx, this);
+  int num_deleted =
+      metadata->versioned_objects().set_all_open_versions_to_deleted();
   ldout(ctx(), 10) << "marked " << num_deleted << " open objects deleted"
                    << dendl;
   gc = std::make_shared<sfs::SFSGC>(cctx, this);
+  scrubber = std::make_shared<sfs::SFSScrubber>(cctx, this);
+  notification_sender =
+      std::make_unique<sfs::SFSNotificationSender>(cctx, this);
+  usage_backend = sfs::make_usage_backend(cctx, db_conn, data_path);
+  const auto backup_path =
+      cctx->_conf.get_val<std::string>("rgw_sfs_backup_path");
+  if (!backup_path.empty()) {
+    backup = std::make_unique<sfs::SFSBackup>(cctx, db_conn, backup_path);
+  }
+  space_ledger = std::make_unique<sfs::SpaceLedger>(
+      min_space_left_for_data_write_ops_bytes,
+      c->_conf.get_val<Option::size_t>("rgw_sfs_write_reservation_chunk")
+  );
 
   filesystem_stats_updater = make_named_thread(
       "sfs_stats_updater", &SFStore::filesystem_stats_updater_main, this,
@@ -22,10 +22,15 @@
 
 #include "common/ceph_mutex.h"
 #include "driver/sfs/bucket.h"
+#include "driver/sfs/bucket_dirs.h"
+#include "driver/sfs/content_store.h"
+#include "driver/sfs/data_cache.h"
+#include "driver/sfs/data_dirs.h"
+#include "driver/sfs/multipart_state.h"
 #include "driver/sfs/object.h"
+#include "driver/sfs/space_ledger.h"
+#include "driver/sfs/sfs_metadata.h"
 #include "driver/sfs/sqlite/dbconn.h"
-#include "driver/sfs/sqlite/sqlite_buckets.h"
-#include "driver/sfs/sqlite/sqlite_users.h"
 #include "driver/sfs/types.h"
 #include "driver/sfs/user.h"
 #include "driver/sfs/zone.h"
@@ -39,7 +44,11 @@
 #include "rgw_status_page.h"
 
 namespace rgw::sal::sfs {
+class SFSBackup;
 class SFSGC;
+class SFSNotificationSender;
+class SFSScrubber;
+class UsageBackend;
 }
 
 namespace rgw::sal {
@@ -103,6 +112,44 @@ class SFSStatusPage : public StatusPage {
   http::status render(std::ostream& os) override;
 };
 
+/// Object count and size of a bucket prefix and its child prefixes, as
+/// JSON: /sfs/prefix-stats?bucket=<name>&prefix=<prefix>. The admin API
+/// serves the same at /admin/prefix-stats, see sfs_rest_prefix_stats.h
+class SFSPrefixStatsStatusPage : public StatusPage {
+ private:
+  SFStore* sfs;
+
+ public:
+  SFSPrefixStatsStatusPage(SFStore* store);
+  ~SFSPrefixStatsStatusPage() override;
+  std::string name() const override { return "SFS Prefix Stats"; };
+  std::string prefix() const override { return "/sfs/prefix-stats"; };
+  std::string content_type() const override { return "application/json"; };
+  bool serves(std::string_view target) const override;
+  http::status render(std::ostream& os) override;
+  http::status render_target(std::ostream& os, std::string_view target)
+      override;
+};
+
+/// Objects of a bucket whose current version carries a tag, as JSON:
+/// /sfs/object-tags?bucket=<name>&key=<key>[&value=<value>]
+/// [&start-after=<name>][&max=<n>]
+class SFSObjectTagsStatusPage : public StatusPage {
+ private:
+  SFStore* sfs;
+
+ public:
+  SFSObjectTagsStatusPage(SFStore* store);
+  ~SFSObjectTagsStatusPage() override;
+  std::string name() const override { return "SFS Object Tags"; };
+  std::string prefix() const override { return "/sfs/object-tags"; };
+  std::string content_type() const override { return "application/json"; };
+  bool serves(std::string_view target) const override;
+  http::status render(std::ostream& os) override;
+  http::status render_target(std::ostream& os, std::string_view target)
+      override;
+};
+
 class SFStore : public StoreDriver {
  private:
   RGWSyncModuleInstanceRef sync_module;
@@ -122,7 +169,24 @@ class SFStore : public StoreDriver {
 
  public:
   sfs::sqlite::DBConnRef db_conn;
+  // users, buckets, objects and multipart uploads, in SQLite or RocksDB
+  // as rgw_sfs_metadata_backend says. Outlives the members using it.
+  std::unique_ptr<sfs::MetadataBackend> metadata;
+  // declared early so it outlives the other members that write to the
+  // database, and copies their last commits when destroyed
+  std::unique_ptr<sfs::SFSBackup> backup;
+  // outlives gc and scrubber, which look up data roots through it
+  std::unique_ptr<sfs::BucketDirs> bucket_dirs;
   std::shared_ptr<sfs::SFSGC> gc = nullptr;
+  std::unique_ptr<sfs::DataDirs> data_dirs;
+  std::unique_ptr<sfs::MultipartUploadStates> multipart_states =
+      std::make_unique<sfs::MultipartUploadStates>();
+  std::unique_ptr<sfs::ContentStore> content_store;
+  std::shared_ptr<sfs::SFSScrubber> scrubber;
+  std::unique_ptr<sfs::SFSNotificationSender> notification_sender;
+  std::unique_ptr<sfs::UsageBackend> usage_backend;
+  std::unique_ptr<sfs::SpaceLedger> space_ledger;
+  std::unique_ptr<sfs::DataCache> data_cache;
 
   std::atomic_uint64_t filesystem_stats_total_bytes;
   std::atomic_uint64_t filesystem_stats_avail_bytes;
@@ -144,6 +208,14 @@ class SFStore : public StoreDriver {
     return std::make_unique<SFSStatusPage>(this);
   }
 
+  std::unique_ptr<StatusPage> make_prefix_stats_status_page() {
+    return std::make_unique<SFSPrefixStatsStatusPage>(this);
+  }
+
+  std::unique_ptr<StatusPage> make_object_tags_status_page() {
+    return std::make_unique<SFSObjectTagsStatusPage>(this);
+  }
+
   std::vector<std::function<MetricsStatusPage::ScalarMetricFunction>>
   custom_metric_fns();
 
@@ -233,6 +305,20 @@ class SFStore : public StoreDriver {
       rgw::sal::Bucket* _bucket, std::string& _user_id,
       std::string& _user_tenant, std::string& _req_id, optional_yield y
   ) override;
+  virtual int read_topics(
+      const std::string& tenant, rgw_pubsub_topics& topics,
+      RGWObjVersionTracker* objv_tracker, optional_yield y,
+      const DoutPrefixProvider* dpp
+  ) override;
+  virtual int write_topics(
+      const std::string& tenant, const rgw_pubsub_topics& topics,
+      RGWObjVersionTracker* objv_tracker, optional_yield y,
+      const DoutPrefixProvider* dpp
+  ) override;
+  virtual int remove_topics(
+      const std::string& tenant, RGWObjVersionTracker* objv_tracker,
+      optional_yield y, const DoutPrefixProvider* dpp
+  ) override;
 
   /** Log usage data to the store.  Usage data is things like bytes
    * sent/received and op count */
@@ -281,7 +367,7 @@ class SFStore : public StoreDriver {
       boost::container::flat_map<
           int, boost::container::flat_set<rgw_data_notify_entry>>& shard_ids
   ) override;
-  virtual int clear_usage(const DoutPrefixProvider* dpp) override { return 0; }
+  virtual int clear_usage(const DoutPrefixProvider* dpp) override;
   virtual int read_all_usage(
       const DoutPrefixProvider* dpp, uint64_t start_epoch, uint64_t end_epoch,
       uint32_t max_entries, bool* is_truncated, RGWUsageIter& usage_iter,
@@ -421,8 +507,8 @@ class SFStore : public StoreDriver {
     db_binfo.battrs = attrs;
     db_binfo.mtime = ceph::real_time::clock::now();
 
-    auto meta_buckets = sfs::get_meta_buckets(db_conn);
-    meta_buckets->store_bucket(db_binfo);
+    metadata->buckets().store_bucket(db_binfo);
+    bucket_dirs->create(info.bucket.bucket_id);
 
     sfs::BucketRef b = std::make_shared<sfs::Bucket>(
         ctx(), this, db_binfo.binfo, owner, db_binfo.battrs, db_binfo.mtime
@@ -437,10 +523,9 @@ class SFStore : public StoreDriver {
   }
 
   void _refresh_buckets() {
-    auto meta_buckets = sfs::get_meta_buckets(db_conn);
-    auto existing = meta_buckets->get_buckets();
+    auto existing = metadata->buckets().get_buckets();
     buckets.clear();
-    sfs::sqlite::SQLiteUsers users(db_conn);
+    const auto& users = metadata->users();
     for (auto& b : existing) {
       if (!b.deleted) {
         auto user = users.get_user(b.binfo.owner.id);
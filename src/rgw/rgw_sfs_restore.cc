@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t
+// vim: ts=8 sw=2 smarttab ft=cpp
+/*
+ * Ceph - scalable distributed file system
+ * SFS SAL implementation
+ *
+ * Copyright (C) 2023 SUSE LLC
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ */
+
+/*
+ * Restores the SFS metadata database from a backup written with
+ * rgw_sfs_backup_path. Run it with the gateway stopped:
+ *
+ *   sfs-restore --backup-path /backup --data-path /data
+ */
+
+#include <boost/program_options.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "driver/sfs/sfs_backup.h"
+#include "driver/sfs/sqlite/dbconn.h"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv) {
+  fs::path backup_path;
+  fs::path data_path;
+  std::string generation;
+  bool force = false;
+  try {
+    using namespace boost::program_options;
+    options_description desc{"Options"};
+    desc.add_options()("help,h", "Help screen")(
+        "backup-path", value<std::string>()->required(),
+        "rgw_sfs_backup_path of the gateway"
+    )("data-path", value<std::string>()->required(),
+      "rgw_sfs_data_path of the gateway, the database is restored there"
+    )("generation", value<std::string>()->default_value(""),
+      "generation to restore, the newest complete one by default"
+    )("force", bool_switch(), "replace an existing database");
+    variables_map vm;
+    store(parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    notify(vm);
+    backup_path = vm["backup-path"].as<std::string>();
+    data_path = vm["data-path"].as<std::string>();
+    generation = vm["generation"].as<std::string>();
+    force = vm["force"].as<bool>();
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const auto db_path =
+      data_path / std::string(rgw::sal::sfs::sqlite::DB_FILENAME);
+  if (fs::exists(db_path) && !force) {
+    std::cerr << db_path.string()
+              << " exists, stop the gateway and use --force to replace it"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  try {
+    fs::create_directories(data_path);
+    generation =
+        rgw::sal::sfs::restore_backup(backup_path, db_path, generation);
+  } catch (const std::exception& ex) {
+    std::cerr << "restore failed: " << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "restored " << db_path.string() << " from generation "
+            << generation << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -126,13 +126,16 @@ void StatusHttpConnection::create_response() {
     os << "</ul>";
     render_html_footer(os);
   } else {
+    const std::string_view target(
+        request_.target().data(), request_.target().size()
+    );
     for (const auto& status_page : status_pages) {
-      if (status_page->prefix() == request_.target()) {
+      if (status_page->serves(target)) {
         response_.set(http::field::content_type, status_page->content_type());
         if (status_page->content_type() == "text/html") {
           render_html_header(os);
         }
-        response_.result(status_page->render(os));
+        response_.result(status_page->render_target(os, target));
         if (status_page->content_type() == "text/html") {
           render_html_footer(os);
         }
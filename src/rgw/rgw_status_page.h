@@ -23,6 +23,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include "common/perf_counters_collection.h"
 
@@ -35,6 +36,17 @@ class StatusPage {
   virtual std::string prefix() const = 0;
   virtual std::string content_type() const = 0;
   virtual http::status render(std::ostream& os) = 0;
+
+  /// Pages taking query arguments override these two. By default a
+  /// page serves exactly prefix().
+  virtual bool serves(std::string_view target) const {
+    return target == prefix();
+  }
+  virtual http::status render_target(
+      std::ostream& os, std::string_view /* target */
+  ) {
+    return render(os);
+  }
 };
 
 class MetricsStatusPage : public StatusPage {
@@ -0,0 +1,851 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Micro benchmarks for the SFS driver. Drives SFStore through the SAL,
+ * without HTTP in the way, and prints the results as JSON.
+ *
+ *   bench_rgw_sfs --benchmarks object,list --sizes 0,4096,1048576 \
+ *     --threads 1,8 --objects 2000 --output results.json
+ *
+ * Config options can be changed with --set, e.g. to compare runs with
+ * and without a feature: --set rgw_sfs_data_cache_size=0, or the usage
+ * backends: --set rgw_sfs_usage_backend=rocksdb. All benchmarks run
+ * against either metadata backend: --set rgw_sfs_metadata_backend=rocksdb
+ *
+ * The write benchmark compares the ways the atomic writer can write
+ * data, selected with --write-modes:
+ *
+ *   bench_rgw_sfs --benchmarks write --write-modes buffered,direct \
+ *     --sizes 1048576,67108864 --threads 1,4
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "common/Formatter.h"
+#include "common/ceph_context.h"
+#include "common/ceph_time.h"
+#include "global/global_context.h"
+#include "rgw/driver/sfs/multipart_types.h"
+#include "rgw/driver/sfs/object_state.h"
+#include "rgw/driver/sfs/sfs_gc.h"
+#include "rgw/driver/sfs/metadata_backend.h"
+#include "rgw/driver/sfs/sqlite/buckets/bucket_definitions.h"
+#include "rgw/driver/sfs/version_type.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+
+namespace fs = std::filesystem;
+using namespace rgw::sal::sfs::sqlite;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const std::string BENCH_USER = "bench_user";
+
+/// Atomic writer configurations of the write benchmark:
+/// buffered: page cache only
+/// preallocated: page cache, extents allocated ahead with fallocate()
+/// direct: O_DIRECT after the first chunk
+const std::set<std::string> WRITE_MODES = {
+    "buffered", "preallocated", "direct"};
+
+struct Params {
+  fs::path data_path;
+  uint64_t num_objects;
+  std::vector<uint64_t> object_sizes;
+  std::vector<uint64_t> threads;
+  uint64_t list_repeats;
+  uint64_t num_uploads;
+  uint64_t num_parts;
+  uint64_t part_size;
+  uint64_t usage_flushes;
+  uint64_t startup_objects;
+  uint64_t startup_repeats;
+  std::vector<std::string> write_modes;
+  uint64_t chunk_size;
+};
+
+struct Result {
+  std::string name;
+  std::map<std::string, std::string> args;
+  uint64_t ops{0};
+  uint64_t errors{0};
+  uint64_t bytes{0};
+  double seconds{0};
+  std::vector<double> latencies_us;
+};
+
+std::vector<std::string> split_list(const std::string& str) {
+  std::vector<std::string> items;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+std::vector<uint64_t> parse_list(const std::string& str) {
+  std::vector<uint64_t> values;
+  for (const auto& item : split_list(str)) {
+    values.push_back(std::stoull(item));
+  }
+  return values;
+}
+
+bufferlist make_data(uint64_t size) {
+  bufferlist bl;
+  bl.append(std::string(size, 'b'));
+  return bl;
+}
+
+std::string make_etag(bufferlist& data) {
+  rgw::sal::sfs::ETagBuilder etag;
+  etag.update(data);
+  return etag.final();
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const auto idx =
+      static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[idx];
+}
+
+class NullDataCB : public RGWGetDataCB {
+ public:
+  int handle_data(bufferlist& /*bl*/, off_t /*ofs*/, off_t /*len*/) override {
+    return 0;
+  }
+};
+
+class Bench {
+  CephContext* cct;
+  const Params& params;
+  NoDoutPrefix dpp;
+  const rgw_user owner{"", BENCH_USER, ""};
+  const rgw_placement_rule placement;
+  const std::string unique_tag{"bench_rgw_sfs"};
+  std::vector<Result> results;
+
+  void reset_data_path() const {
+    fs::remove_all(params.data_path);
+    fs::create_directories(params.data_path);
+  }
+
+  std::unique_ptr<rgw::sal::SFStore> open_store() const {
+    auto store =
+        std::make_unique<rgw::sal::SFStore>(cct, params.data_path);
+    // collected on demand by the gc benchmark only
+    store->gc->suspend();
+    return store;
+  }
+
+  void create_user(rgw::sal::SFStore& store) const {
+    const auto& users = store.metadata->users();
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = BENCH_USER;
+    user.uinfo.display_name = BENCH_USER;
+    users.store_user(user);
+  }
+
+  std::unique_ptr<rgw::sal::Bucket> create_bucket(
+      rgw::sal::SFStore& store, const std::string& name, bool versioned
+  ) {
+    const auto& db_buckets = store.metadata->buckets();
+    DBOPBucketInfo bucket;
+    bucket.binfo.bucket.name = name;
+    bucket.binfo.bucket.bucket_id = name;
+    bucket.binfo.owner.id = BENCH_USER;
+    bucket.binfo.creation_time = ceph::real_clock::now();
+    bucket.mtime = bucket.binfo.creation_time;
+    if (versioned) {
+      bucket.binfo.flags |= BUCKET_VERSIONED;
+    }
+    db_buckets.store_bucket(bucket);
+    store._refresh_buckets();
+
+    auto user = store.get_user(owner);
+    std::unique_ptr<rgw::sal::Bucket> result;
+    const int ret = store.get_bucket(
+        &dpp, user.get(), bucket.binfo.bucket, &result, null_yield
+    );
+    ceph_assert(ret == 0);
+    return result;
+  }
+
+  int put(
+      rgw::sal::SFStore& store, rgw::sal::Bucket& bucket,
+      const std::string& name, const bufferlist& data,
+      const std::string& etag
+  ) {
+    auto obj = bucket.get_object(rgw_obj_key(name));
+    auto writer = store.get_atomic_writer(
+        &dpp, null_yield, obj.get(), owner, &placement, 0, unique_tag
+    );
+    // as RGWPutObj does for requests with a content length
+    writer->set_size_hint(data.length());
+    int ret = writer->prepare(null_yield);
+    if (ret < 0) {
+      return ret;
+    }
+    // in chunks, as RGWPutObj hands them over
+    for (uint64_t ofs = 0; ofs < data.length(); ofs += params.chunk_size) {
+      bufferlist bl;
+      bl.substr_of(
+          data, ofs, std::min<uint64_t>(params.chunk_size, data.length() - ofs)
+      );
+      ret = writer->process(std::move(bl), ofs);
+      if (ret < 0) {
+        return ret;
+      }
+    }
+    ret = writer->process({}, data.length());
+    if (ret < 0) {
+      return ret;
+    }
+    rgw::sal::Attrs attrs;
+    ceph::real_time mtime;
+    return writer->complete(
+        data.length(), etag, &mtime, ceph::real_time(), attrs,
+        ceph::real_time(), nullptr, nullptr, nullptr, nullptr, nullptr,
+        null_yield
+    );
+  }
+
+  int get(rgw::sal::Bucket& bucket, const std::string& name, bool read_data) {
+    auto obj = bucket.get_object(rgw_obj_key(name));
+    auto read_op = obj->get_read_op();
+    int ret = read_op->prepare(null_yield, &dpp);
+    if (ret < 0 || !read_data || obj->get_obj_size() == 0) {
+      return ret;
+    }
+    NullDataCB cb;
+    const auto size = static_cast<int64_t>(obj->get_obj_size());
+    ret = read_op->iterate(&dpp, 0, size - 1, &cb, null_yield);
+    return ret < 0 ? ret : 0;
+  }
+
+  int del(rgw::sal::Bucket& bucket, const std::string& name) {
+    auto obj = bucket.get_object(rgw_obj_key(name));
+    return obj->get_delete_op()->delete_obj(&dpp, null_yield);
+  }
+
+  int list_all(
+      rgw::sal::Bucket& bucket, const std::string& delim, bool versions
+  ) {
+    rgw::sal::Bucket::ListParams list_params;
+    list_params.delim = delim;
+    list_params.list_versions = versions;
+    rgw::sal::Bucket::ListResults list_results;
+    do {
+      list_results = {};
+      const int ret =
+          bucket.list(&dpp, list_params, 1000, list_results, null_yield);
+      if (ret < 0) {
+        return ret;
+      }
+      list_params.marker = list_results.next_marker;
+    } while (list_results.is_truncated);
+    return 0;
+  }
+
+  /// Run `ops` calls of `op` on `threads` threads, timing each.
+  Result run(
+      const std::string& name, std::map<std::string, std::string> args,
+      uint64_t threads, uint64_t ops, uint64_t bytes_per_op,
+      const std::function<int(uint64_t)>& op
+  ) {
+    Result result;
+    result.name = name;
+    result.args = std::move(args);
+    result.args["threads"] = std::to_string(threads);
+    result.ops = ops;
+    result.bytes = ops * bytes_per_op;
+    result.latencies_us.resize(ops);
+
+    std::atomic_uint64_t next{0};
+    std::atomic_uint64_t errors{0};
+    const auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (uint64_t t = 0; t < std::max<uint64_t>(threads, 1); ++t) {
+      workers.emplace_back([&] {
+        for (uint64_t i = next++; i < ops; i = next++) {
+          const auto op_start = Clock::now();
+          if (op(i) < 0) {
+            ++errors;
+          }
+          result.latencies_us[i] =
+              std::chrono::duration<double, std::micro>(Clock::now() - op_start)
+                  .count();
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    result.seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    result.errors = errors;
+    if (result.errors > 0) {
+      std::cerr << name << ": " << result.errors << " of " << ops
+                << " operations failed" << std::endl;
+    }
+    std::cerr << name << " " << result.ops << " ops in " << result.seconds
+              << "s";
+    if (result.bytes > 0 && result.seconds > 0) {
+      std::cerr << fmt::format(
+          ", {:.1f} MiB/s",
+          static_cast<double>(result.bytes) / result.seconds / (1 << 20)
+      );
+    }
+    std::cerr << std::endl;
+    return result;
+  }
+
+  void add(Result result) { results.push_back(std::move(result)); }
+
+  /// Configure the atomic writer for one of WRITE_MODES. Writers read
+  /// the options when they are created.
+  void set_write_mode(const std::string& mode) const {
+    cct->_conf.set_val(
+        "rgw_sfs_write_preallocate", mode == "preallocated" ? "true" : "false"
+    );
+    // any threshold past offset 0 has the writer switch to O_DIRECT at
+    // the first page aligned chunk after it
+    cct->_conf.set_val(
+        "rgw_sfs_write_direct_io_threshold", mode == "direct" ? "1" : "0"
+    );
+  }
+
+ public:
+  Bench(CephContext* _cct, const Params& _params)
+      : cct(_cct), params(_params), dpp(_cct, 1) {}
+
+  /// PUT, HEAD, GET and DELETE of objects of each size, at each
+  /// concurrency level
+  void bench_object_ops() {
+    reset_data_path();
+    auto store = open_store();
+    create_user(*store);
+    for (const auto size : params.object_sizes) {
+      auto data = make_data(size);
+      const auto etag = make_etag(data);
+      for (const auto threads : params.threads) {
+        auto bucket = create_bucket(
+            *store, fmt::format("object-{}-{}", size, threads), false
+        );
+        auto name = [](uint64_t i) { return fmt::format("obj-{}", i); };
+        const std::map<std::string, std::string> args{
+            {"object_size", std::to_string(size)}};
+        add(run("put", args, threads, params.num_objects, size,
+                [&](uint64_t i) {
+                  return put(*store, *bucket, name(i), data, etag);
+                }));
+        add(run("head", args, threads, params.num_objects, 0,
+                [&](uint64_t i) { return get(*bucket, name(i), false); }));
+        add(run("get", args, threads, params.num_objects, size,
+                [&](uint64_t i) { return get(*bucket, name(i), true); }));
+        add(run("delete", args, threads, params.num_objects, 0,
+                [&](uint64_t i) { return del(*bucket, name(i)); }));
+      }
+    }
+  }
+
+  /// PUTs of objects of each size, at each concurrency level, in each
+  /// of the selected write modes
+  void bench_write() {
+    reset_data_path();
+    auto store = open_store();
+    create_user(*store);
+    for (const auto& mode : params.write_modes) {
+      set_write_mode(mode);
+      for (const auto size : params.object_sizes) {
+        auto data = make_data(size);
+        const auto etag = make_etag(data);
+        for (const auto threads : params.threads) {
+          auto bucket = create_bucket(
+              *store, fmt::format("write-{}-{}-{}", mode, size, threads), false
+          );
+          add(run("write",
+                  {{"write_mode", mode},
+                   {"object_size", std::to_string(size)},
+                   {"chunk_size", std::to_string(params.chunk_size)}},
+                  threads, params.num_objects, size, [&](uint64_t i) {
+                    return put(
+                        *store, *bucket, fmt::format("obj-{}", i), data, etag
+                    );
+                  }));
+        }
+      }
+    }
+  }
+
+  /// Full listings of versioned and unversioned buckets, with and
+  /// without delimiter
+  void bench_list() {
+    reset_data_path();
+    auto store = open_store();
+    create_user(*store);
+    auto data = make_data(0);
+    const auto etag = make_etag(data);
+    for (const bool versioned : {false, true}) {
+      auto bucket = create_bucket(
+          *store, versioned ? "list-versioned" : "list", versioned
+      );
+      // two versions each in the versioned bucket, 100 directories
+      const uint64_t puts = versioned ? 2 * params.num_objects
+                                      : params.num_objects;
+      for (uint64_t i = 0; i < puts; ++i) {
+        const auto n = i % params.num_objects;
+        const int ret = put(
+            *store, *bucket, fmt::format("dir-{}/obj-{}", n % 100, n), data,
+            etag
+        );
+        ceph_assert(ret == 0);
+      }
+      const std::map<std::string, std::string> base{
+          {"objects", std::to_string(params.num_objects)},
+          {"versioned", versioned ? "true" : "false"}};
+      for (const std::string delim : {"", "/"}) {
+        auto args = base;
+        args["delimiter"] = delim;
+        add(run("list", args, 1, params.list_repeats, 0, [&](uint64_t) {
+          return list_all(*bucket, delim, false);
+        }));
+        if (versioned) {
+          add(run("list_versions", args, 1, params.list_repeats, 0,
+                  [&](uint64_t) { return list_all(*bucket, delim, true); }));
+        }
+      }
+    }
+  }
+
+  /// Completing multipart uploads, parts written beforehand
+  void bench_multipart() {
+    reset_data_path();
+    auto store = open_store();
+    create_user(*store);
+    auto bucket = create_bucket(*store, "multipart", false);
+    auto part_data = make_data(params.part_size);
+    const auto part_etag = make_etag(part_data);
+
+    ACLOwner acl_owner;
+    acl_owner.set_id(owner);
+    std::vector<std::unique_ptr<rgw::sal::MultipartUpload>> uploads;
+    for (uint64_t u = 0; u < params.num_uploads; ++u) {
+      auto upload = bucket->get_multipart_upload(
+          fmt::format("mp-{}", u), fmt::format("bench-upload-{}", u), acl_owner
+      );
+      rgw::sal::Attrs attrs;
+      rgw_placement_rule dest_placement;
+      int ret =
+          upload->init(&dpp, null_yield, acl_owner, dest_placement, attrs);
+      ceph_assert(ret == 0);
+      for (uint64_t p = 1; p <= params.num_parts; ++p) {
+        auto obj = bucket->get_object(rgw_obj_key(fmt::format("mp-{}", u)));
+        auto writer = upload->get_writer(
+            &dpp, null_yield, obj.get(), owner, &placement, p,
+            std::to_string(p)
+        );
+        ret = writer->prepare(null_yield);
+        ceph_assert(ret == 0);
+        bufferlist bl = part_data;
+        ret = writer->process(std::move(bl), 0);
+        ceph_assert(ret == 0);
+        ret = writer->process({}, part_data.length());
+        ceph_assert(ret == 0);
+        rgw::sal::Attrs part_attrs;
+        ceph::real_time mtime;
+        ret = writer->complete(
+            part_data.length(), part_etag, &mtime, ceph::real_time(),
+            part_attrs, ceph::real_time(), nullptr, nullptr, nullptr, nullptr,
+            nullptr, null_yield
+        );
+        ceph_assert(ret == 0);
+      }
+      uploads.push_back(std::move(upload));
+    }
+
+    add(run("multipart_complete",
+            {{"parts", std::to_string(params.num_parts)},
+             {"part_size", std::to_string(params.part_size)}},
+            1, params.num_uploads, params.num_parts * params.part_size,
+            [&](uint64_t u) {
+              std::map<int, std::string> part_etags;
+              for (uint64_t p = 1; p <= params.num_parts; ++p) {
+                part_etags[static_cast<int>(p)] = part_etag;
+              }
+              std::list<rgw_obj_index_key> remove_objs;
+              uint64_t accounted_size = 0;
+              bool compressed = false;
+              RGWCompressionInfo cs_info;
+              off_t ofs = 0;
+              std::string tag;
+              auto target =
+                  bucket->get_object(rgw_obj_key(fmt::format("mp-{}", u)));
+              return uploads[u]->complete(
+                  &dpp, null_yield, cct, part_etags, remove_objs,
+                  accounted_size, compressed, cs_info, ofs, tag, acl_owner, 0,
+                  target.get()
+              );
+            }));
+  }
+
+  /// Garbage collection of deleted objects until all are gone
+  void bench_gc() {
+    reset_data_path();
+    auto store = open_store();
+    create_user(*store);
+    const uint64_t size = params.object_sizes.empty()
+                              ? 0
+                              : params.object_sizes.front();
+    auto data = make_data(size);
+    const auto etag = make_etag(data);
+    auto bucket = create_bucket(*store, "gc", false);
+    for (uint64_t i = 0; i < params.num_objects; ++i) {
+      const auto name = fmt::format("obj-{}", i);
+      ceph_assert(put(*store, *bucket, name, data, etag) == 0);
+      ceph_assert(del(*bucket, name) == 0);
+    }
+
+    const auto& db_objects = store->metadata->objects();
+    Result result = run(
+        "gc_drain", {{"object_size", std::to_string(size)}}, 1, 1,
+        params.num_objects * size,
+        [&](uint64_t) {
+          // the gc stops after rgw_gc_processor_max_time, resume until done
+          for (int round = 0; round < 10000; ++round) {
+            store->gc->process();
+            if (db_objects.get_objects("gc").empty()) {
+              return 0;
+            }
+          }
+          return -ETIMEDOUT;
+        }
+    );
+    result.args["objects"] = std::to_string(params.num_objects);
+    add(std::move(result));
+  }
+
+  /// Usage logger flushes of `objects` buckets each, one hour per
+  /// flush, then full reads of the usage. Compare the usage backends
+  /// with --set rgw_sfs_usage_backend=rocksdb
+  void bench_usage() {
+    reset_data_path();
+    auto store = open_store();
+    const uint64_t flushes = params.usage_flushes;
+    auto flush = [&](uint64_t hour) {
+      std::map<rgw_user_bucket, RGWUsageBatch> usage_info;
+      rgw_usage_data data(4096, 4096);
+      data.ops = 1;
+      data.successful_ops = 1;
+      for (uint64_t b = 0; b < params.num_objects; ++b) {
+        rgw_usage_log_entry entry;
+        entry.owner = rgw_user(BENCH_USER);
+        entry.bucket = fmt::format("bucket-{}", b);
+        entry.epoch = hour * 3600;
+        entry.add("put_obj", data);
+        entry.add("get_obj", data);
+        bool account = false;
+        usage_info[rgw_user_bucket(BENCH_USER, entry.bucket)].insert(
+            ceph::real_clock::from_time_t(static_cast<time_t>(entry.epoch)),
+            entry, &account
+        );
+      }
+      return store->log_usage(&dpp, usage_info);
+    };
+    const std::map<std::string, std::string> args{
+        {"buckets", std::to_string(params.num_objects)}};
+    for (const auto threads : params.threads) {
+      add(run("usage_flush", args, threads, flushes, 0, flush));
+    }
+    add(run("usage_read", args, 1, params.list_repeats, 0, [&](uint64_t) {
+      RGWUsageIter usage_iter;
+      bool truncated = false;
+      do {
+        std::map<rgw_user_bucket, rgw_usage_log_entry> usage;
+        const int ret = store->read_all_usage(
+            &dpp, 0, std::numeric_limits<uint64_t>::max(), 1000, &truncated,
+            usage_iter, usage
+        );
+        if (ret < 0) {
+          return ret;
+        }
+      } while (truncated);
+      return 0;
+    }));
+  }
+
+  /// Opening a store with a database of startup_objects objects
+  void bench_startup() {
+    reset_data_path();
+    {
+      auto store = open_store();
+      create_user(*store);
+      create_bucket(*store, "startup", false);
+      const auto now = ceph::real_clock::now();
+      // one transaction, whichever the metadata backend
+      store->metadata->versioned_objects().update_objects_transact(
+          "startup", {},
+          [&](const DBObjectsCommittedVersions&) {
+            DBObjectsUpdate update;
+            for (uint64_t i = 0; i < params.startup_objects; ++i) {
+              DBObject object;
+              object.uuid.generate_random();
+              object.bucket_id = "startup";
+              object.name = fmt::format("obj-{}", i);
+              DBVersionedObject version;
+              version.object_id = object.uuid;
+              version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+              version.version_type = rgw::sal::sfs::VersionType::REGULAR;
+              version.version_id = fmt::format("v-{}", i);
+              version.commit_time = now;
+              version.mtime = now;
+              update.new_objects.push_back(std::move(object));
+              update.new_versions.push_back(std::move(version));
+            }
+            return update;
+          }
+      );
+    }
+    add(run("startup",
+            {{"objects", std::to_string(params.startup_objects)}}, 1,
+            params.startup_repeats, 0, [&](uint64_t) {
+              auto store = open_store();
+              return 0;
+            }));
+  }
+
+  void dump(std::ostream& os) const {
+    JSONFormatter f(true);
+    f.open_object_section("");
+    f.open_object_section("context");
+    f.dump_string("date", ceph::to_iso_8601(ceph::real_clock::now()));
+    f.dump_string("data_path", params.data_path.string());
+    f.dump_string(
+        "metadata_backend",
+        cct->_conf.get_val<std::string>("rgw_sfs_metadata_backend")
+    );
+    f.dump_unsigned("num_cpus", std::thread::hardware_concurrency());
+    f.close_section();
+    f.open_array_section("benchmarks");
+    for (const auto& result : results) {
+      auto latencies = result.latencies_us;
+      std::sort(latencies.begin(), latencies.end());
+      const double total_us =
+          std::accumulate(latencies.begin(), latencies.end(), 0.0);
+      f.open_object_section("benchmark");
+      f.dump_string("name", result.name);
+      f.open_object_section("args");
+      for (const auto& [key, value] : result.args) {
+        f.dump_string(key.c_str(), value);
+      }
+      f.close_section();
+      f.dump_unsigned("ops", result.ops);
+      f.dump_unsigned("errors", result.errors);
+      f.dump_unsigned("bytes", result.bytes);
+      f.dump_float("seconds", result.seconds);
+      f.dump_float(
+          "ops_per_sec",
+          result.seconds > 0 ? static_cast<double>(result.ops) / result.seconds
+                             : 0
+      );
+      f.dump_float(
+          "bytes_per_sec", result.seconds > 0
+                               ? static_cast<double>(result.bytes) /
+                                     result.seconds
+                               : 0
+      );
+      f.open_object_section("latency_us");
+      f.dump_float(
+          "mean", latencies.empty()
+                      ? 0
+                      : total_us / static_cast<double>(latencies.size())
+      );
+      f.dump_float("p50", percentile(latencies, 0.5));
+      f.dump_float("p90", percentile(latencies, 0.9));
+      f.dump_float("p99", percentile(latencies, 0.99));
+      f.dump_float("max", latencies.empty() ? 0 : latencies.back());
+      f.close_section();
+      f.close_section();
+    }
+    f.close_section();
+    f.close_section();
+    f.flush(os);
+    os << std::endl;
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Params params;
+  std::set<std::string> benchmarks;
+  std::vector<std::string> config;
+  std::string output;
+  bool keep = false;
+  try {
+    using namespace boost::program_options;
+    options_description desc{"Options"};
+    desc.add_options()("help,h", "Help screen")(
+        "benchmarks",
+        value<std::string>()->default_value(
+            "object,list,multipart,gc,startup,usage,write"
+        ),
+        "comma separated benchmarks to run: object, list, multipart, gc, "
+        "startup, usage, write"
+    )("data-path",
+      value<std::string>()->default_value(
+          (fs::temp_directory_path() / "bench_rgw_sfs").string()
+      ),
+      "directory for the store, wiped before each benchmark"
+    )("objects", value<uint64_t>()->default_value(1000),
+      "objects per object, list and gc benchmark, buckets per usage flush"
+    )("sizes", value<std::string>()->default_value("0,4096,1048576"),
+      "comma separated object sizes in bytes"
+    )("threads", value<std::string>()->default_value("1,4,16"),
+      "comma separated concurrency levels for object operations"
+    )("list-repeats", value<uint64_t>()->default_value(10),
+      "full listings per list benchmark, full reads per usage benchmark"
+    )("uploads", value<uint64_t>()->default_value(10),
+      "multipart uploads to complete"
+    )("parts", value<uint64_t>()->default_value(4), "parts per upload")(
+        "part-size", value<uint64_t>()->default_value(5 * 1024 * 1024),
+        "part size in bytes"
+    )("usage-flushes", value<uint64_t>()->default_value(100),
+      "usage logger flushes per usage benchmark"
+    )("startup-objects", value<uint64_t>()->default_value(100000),
+      "objects in the database for the startup benchmark"
+    )("startup-repeats", value<uint64_t>()->default_value(3),
+      "store openings timed by the startup benchmark"
+    )("write-modes",
+      value<std::string>()->default_value("buffered,preallocated,direct"),
+      "comma separated write modes for the write benchmark: buffered, "
+      "preallocated, direct. Override the writer's --set options"
+    )("chunk-size", value<uint64_t>()->default_value(4 * 1024 * 1024),
+      "bytes handed to the writer at a time"
+    )("set", value<std::vector<std::string>>()->composing(),
+      "config option as key=value, may be repeated"
+    )("output,o", value<std::string>(),
+      "write JSON results here instead of stdout"
+    )("keep", bool_switch(), "keep the data path afterwards");
+    variables_map vm;
+    store(parse_command_line(argc, argv, desc), vm);
+    notify(vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    for (const auto& name : split_list(vm["benchmarks"].as<std::string>())) {
+      benchmarks.insert(name);
+    }
+    params.data_path = vm["data-path"].as<std::string>();
+    params.num_objects = vm["objects"].as<uint64_t>();
+    params.object_sizes = parse_list(vm["sizes"].as<std::string>());
+    params.threads = parse_list(vm["threads"].as<std::string>());
+    params.list_repeats = vm["list-repeats"].as<uint64_t>();
+    params.num_uploads = vm["uploads"].as<uint64_t>();
+    params.num_parts = vm["parts"].as<uint64_t>();
+    params.part_size = vm["part-size"].as<uint64_t>();
+    params.usage_flushes = vm["usage-flushes"].as<uint64_t>();
+    params.startup_objects = vm["startup-objects"].as<uint64_t>();
+    params.startup_repeats = vm["startup-repeats"].as<uint64_t>();
+    params.write_modes = split_list(vm["write-modes"].as<std::string>());
+    for (const auto& mode : params.write_modes) {
+      if (!WRITE_MODES.contains(mode)) {
+        std::cerr << "invalid write mode " << mode << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    params.chunk_size = vm["chunk-size"].as<uint64_t>();
+    if (params.chunk_size == 0) {
+      std::cerr << "chunk size must not be 0" << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (vm.count("set")) {
+      config = vm["set"].as<std::vector<std::string>>();
+    }
+    if (vm.count("output")) {
+      output = vm["output"].as<std::string>();
+    }
+    keep = vm["keep"].as<bool>();
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto cct = std::make_unique<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  if (!g_ceph_context) {
+    g_ceph_context = cct.get();
+  }
+  cct->_conf.set_val("rgw_sfs_data_path", params.data_path.string());
+  for (const auto& kv : config) {
+    const auto eq = kv.find('=');
+    if (eq == std::string::npos ||
+        cct->_conf.set_val(kv.substr(0, eq), kv.substr(eq + 1)) < 0) {
+      std::cerr << "invalid config option " << kv << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  cct->_log->start();
+  rgw_perf_start(cct.get());
+
+  Bench bench(cct.get(), params);
+  if (benchmarks.contains("object")) {
+    bench.bench_object_ops();
+  }
+  if (benchmarks.contains("list")) {
+    bench.bench_list();
+  }
+  if (benchmarks.contains("multipart")) {
+    bench.bench_multipart();
+  }
+  if (benchmarks.contains("gc")) {
+    bench.bench_gc();
+  }
+  if (benchmarks.contains("startup")) {
+    bench.bench_startup();
+  }
+  if (benchmarks.contains("usage")) {
+    bench.bench_usage();
+  }
+  if (benchmarks.contains("write")) {
+    bench.bench_write();
+  }
+
+  if (output.empty()) {
+    bench.dump(std::cout);
+  } else {
+    std::ofstream os(output);
+    bench.dump(os);
+  }
+  if (!keep) {
+    std::error_code ec;
+    fs::remove_all(params.data_path, ec);
+  }
+  rgw_perf_stop(cct.get());
+  return EXIT_SUCCESS;
+}
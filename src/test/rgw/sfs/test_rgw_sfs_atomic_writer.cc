@@ -0,0 +1,287 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "rgw/driver/sfs/sqlite/buckets/bucket_conversions.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/rgw_compression_types.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+
+/*
+  HINT
+  Creates sqlite and data files in /tmp/rgw_sfs_tests
+*/
+
+using namespace rgw::sal::sfs::sqlite;
+using namespace std::chrono_literals;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_USERNAME = "test_user";
+const static std::string TEST_BUCKET = "test_bucket";
+
+class CollectDataCB : public RGWGetDataCB {
+ public:
+  bufferlist data;
+
+  int handle_data(bufferlist& bl, off_t ofs, off_t len) override {
+    bufferlist piece;
+    piece.substr_of(bl, ofs, len);
+    data.append(piece);
+    return 0;
+  }
+};
+
+class TestSFSAtomicWriter : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  NoDoutPrefix dpp{cct.get(), 1};
+  const rgw_user owner{"", TEST_USERNAME, ""};
+  const rgw_placement_rule placement;
+  std::unique_ptr<rgw::sal::SFStore> store;
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+  }
+
+  void TearDown() override {
+    bucket.reset();
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  void openStore() {
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = TEST_USERNAME;
+    users.store_user(user);
+
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo db_bucket;
+    db_bucket.binfo.bucket.name = TEST_BUCKET;
+    db_bucket.binfo.bucket.bucket_id = TEST_BUCKET;
+    db_bucket.binfo.owner.id = TEST_USERNAME;
+    db_bucket.binfo.creation_time = ceph::real_clock::now();
+    db_bucket.mtime = db_bucket.binfo.creation_time;
+    db_buckets.store_bucket(db_bucket);
+    store->_refresh_buckets();
+
+    auto user = store->get_user(owner);
+    ASSERT_EQ(
+        store->get_bucket(
+            &dpp, user.get(), db_bucket.binfo.bucket, &bucket, null_yield
+        ),
+        0
+    );
+  }
+
+  /// Wait for the first statfs sample, so that the space ledger
+  /// works with the real free space.
+  void waitForFilesystemStats() {
+    for (int i = 0; i < 100; ++i) {
+      if (store->filesystem_stats_total_bytes !=
+          std::numeric_limits<uint64_t>::max()) {
+        return;
+      }
+      std::this_thread::sleep_for(10ms);
+    }
+    FAIL() << "no filesystem stats sample";
+  }
+
+  std::unique_ptr<rgw::sal::Writer> getWriter(
+      const std::string& name, uint64_t size_hint
+  ) {
+    auto obj = bucket->get_object(rgw_obj_key(name));
+    auto writer = store->get_atomic_writer(
+        &dpp, null_yield, obj.get(), owner, &placement, 0, "test"
+    );
+    writer->set_size_hint(size_hint);
+    return writer;
+  }
+
+  int writeAndComplete(
+      rgw::sal::Writer& writer, const bufferlist& data,
+      uint64_t accounted_size, rgw::sal::Attrs attrs = {}
+  ) {
+    bufferlist bl = data;
+    int ret = writer.process(std::move(bl), 0);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = writer.process({}, data.length());
+    if (ret < 0) {
+      return ret;
+    }
+    ceph::real_time mtime;
+    return writer.complete(
+        accounted_size, "etag", &mtime, ceph::real_time(), attrs,
+        ceph::real_time(), nullptr, nullptr, nullptr, nullptr, nullptr,
+        null_yield
+    );
+  }
+
+  int writeAndComplete(rgw::sal::Writer& writer, uint64_t size) {
+    bufferlist data;
+    data.append(std::string(size, 'x'));
+    return writeAndComplete(writer, data, size);
+  }
+
+  /// Attrs of an object of `orig_size` bytes compressed into a single
+  /// block of `len` bytes
+  static rgw::sal::Attrs compressionAttrs(uint64_t orig_size, uint64_t len) {
+    RGWCompressionInfo cs_info;
+    cs_info.compression_type = "zlib";
+    cs_info.orig_size = orig_size;
+    compression_block block;
+    block.old_ofs = 0;
+    block.new_ofs = 0;
+    block.len = len;
+    cs_info.blocks.push_back(block);
+    rgw::sal::Attrs attrs;
+    encode(cs_info, attrs[RGW_ATTR_COMPRESSION]);
+    return attrs;
+  }
+
+  std::optional<DBVersionedObject> getCommittedVersion(const std::string& name
+  ) const {
+    SQLiteVersionedObjects db_versions(store->db_conn);
+    return db_versions.get_committed_versioned_object(TEST_BUCKET, name, "");
+  }
+};
+
+TEST_F(TestSFSAtomicWriter, ReservesSizeHintAtPrepare) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  const uint64_t size = 1024 * 1024;
+  auto writer = getWriter("obj", size);
+  EXPECT_EQ(store->space_ledger->get_reserved(), 0);
+
+  // the whole object is reserved before any data arrives
+  ASSERT_EQ(writer->prepare(null_yield), 0);
+  EXPECT_EQ(store->space_ledger->get_reserved(), size);
+
+  ASSERT_EQ(writeAndComplete(*writer, size), 0);
+  EXPECT_EQ(store->space_ledger->get_reserved(), 0);
+}
+
+TEST_F(TestSFSAtomicWriter, ReservesChunkWithoutSizeHint) {
+  cct->_conf.set_val("rgw_sfs_write_reservation_chunk", "65536");
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  auto writer = getWriter("obj", 0);
+
+  ASSERT_EQ(writer->prepare(null_yield), 0);
+  EXPECT_EQ(store->space_ledger->get_reserved(), 65536);
+
+  // the reservation grows with the data
+  ASSERT_EQ(writeAndComplete(*writer, 100000), 0);
+  EXPECT_EQ(store->space_ledger->get_reserved(), 0);
+}
+
+TEST_F(TestSFSAtomicWriter, SizeHintBeyondFreeSpaceFailsAtPrepare) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  ASSERT_NO_FATAL_FAILURE(waitForFilesystemStats());
+  auto writer = getWriter("obj", store->filesystem_stats_avail_bytes + 1);
+
+  EXPECT_EQ(writer->prepare(null_yield), -ERR_QUOTA_EXCEEDED);
+  EXPECT_EQ(store->space_ledger->get_reserved(), 0);
+}
+
+TEST_F(TestSFSAtomicWriter, StoresPhysicalSize) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  auto writer = getWriter("obj", 0);
+  ASSERT_EQ(writer->prepare(null_yield), 0);
+  ASSERT_EQ(writeAndComplete(*writer, 4096), 0);
+
+  const auto version = getCommittedVersion("obj");
+  ASSERT_TRUE(version.has_value());
+  EXPECT_EQ(version->size, 4096);
+  EXPECT_EQ(version->physical_size, 4096);
+}
+
+TEST_F(TestSFSAtomicWriter, CompressedPut) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  bufferlist compressed;
+  compressed.append(std::string(100, 'z'));
+  auto writer = getWriter("obj", 0);
+  ASSERT_EQ(writer->prepare(null_yield), 0);
+  ASSERT_EQ(
+      writeAndComplete(*writer, compressed, 4096, compressionAttrs(4096, 100)),
+      0
+  );
+
+  // size is the logical size, physical_size what is on disk
+  const auto version = getCommittedVersion("obj");
+  ASSERT_TRUE(version.has_value());
+  EXPECT_EQ(version->size, 4096);
+  EXPECT_EQ(version->physical_size, 100);
+}
+
+TEST_F(TestSFSAtomicWriter, CompressedPutSizeMismatchFails) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  bufferlist compressed;
+  compressed.append(std::string(100, 'z'));
+  auto writer = getWriter("obj", 0);
+  ASSERT_EQ(writer->prepare(null_yield), 0);
+  EXPECT_EQ(
+      writeAndComplete(*writer, compressed, 4096, compressionAttrs(4096, 99)),
+      -ERR_INTERNAL_ERROR
+  );
+  EXPECT_FALSE(getCommittedVersion("obj").has_value());
+}
+
+TEST_F(TestSFSAtomicWriter, CompressedGet) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  bufferlist compressed;
+  compressed.append(std::string(60, 'y'));
+  compressed.append(std::string(40, 'z'));
+  auto writer = getWriter("obj", 0);
+  ASSERT_EQ(writer->prepare(null_yield), 0);
+  ASSERT_EQ(
+      writeAndComplete(*writer, compressed, 4096, compressionAttrs(4096, 100)),
+      0
+  );
+
+  // read ops see the compressed data, RGWGetObj_Decompress expands it
+  auto obj = bucket->get_object(rgw_obj_key("obj"));
+  auto read_op = obj->get_read_op();
+  ASSERT_EQ(read_op->prepare(null_yield, &dpp), 0);
+  EXPECT_EQ(obj->get_obj_size(), 100);
+  const auto& attrs = obj->get_attrs();
+  const auto cs_attr = attrs.find(RGW_ATTR_COMPRESSION);
+  ASSERT_NE(cs_attr, attrs.end());
+  RGWCompressionInfo cs_info;
+  auto it = cs_attr->second.cbegin();
+  decode(cs_info, it);
+  EXPECT_EQ(cs_info.orig_size, 4096);
+
+  CollectDataCB cb;
+  ASSERT_EQ(read_op->iterate(&dpp, 50, 69, &cb, null_yield), 20);
+  EXPECT_EQ(cb.data.to_str(), std::string(10, 'y') + std::string(10, 'z'));
+}
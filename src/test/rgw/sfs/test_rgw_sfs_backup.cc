@@ -0,0 +1,165 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/sfs_backup.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+
+using namespace rgw::sal::sfs::sqlite;
+using rgw::sal::sfs::SFSBackup;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+
+class TestSFSBackup : public ::testing::Test {
+ protected:
+  std::shared_ptr<CephContext> cct;
+  DBConnRef conn;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directories(getDataDir());
+    cct = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+    cct->_conf.set_val("rgw_sfs_data_path", getDataDir());
+    cct->_conf.set_val("rgw_sfs_backup_path", getBackupDir());
+    cct->_log->start();
+  }
+
+  void TearDown() override {
+    conn.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+  std::string getDataDir() const { return getTestDir() + "/data"; }
+  std::string getBackupDir() const { return getTestDir() + "/backup"; }
+  std::string getRestoreDir() const { return getTestDir() + "/restore"; }
+
+  void connect() { conn = std::make_shared<DBConn>(cct.get()); }
+
+  void add_user(const std::string& id) const {
+    SQLiteUsers users(conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = id;
+    user.uinfo.display_name = id;
+    users.store_user(user);
+  }
+
+  /// Restore the backup and open it instead of the database
+  void restore() {
+    fs::create_directories(getRestoreDir());
+    rgw::sal::sfs::restore_backup(
+        getBackupDir(), fs::path(getRestoreDir()) / std::string(DB_FILENAME)
+    );
+    conn.reset();
+    cct->_conf.set_val("rgw_sfs_data_path", getRestoreDir());
+    connect();
+  }
+
+  bool has_user(const std::string& id) const {
+    SQLiteUsers users(conn);
+    return users.get_user(id).has_value();
+  }
+
+  size_t count_generations() const {
+    size_t count = 0;
+    for (const auto& entry : fs::directory_iterator(getBackupDir())) {
+      if (entry.is_directory()) {
+        count++;
+      }
+    }
+    return count;
+  }
+};
+
+TEST_F(TestSFSBackup, snapshot_and_wal_are_restored) {
+  connect();
+  add_user("before");
+  {
+    SFSBackup backup(cct.get(), conn, getBackupDir());
+    backup.snapshot();
+    add_user("after");
+    backup.ship();
+    const auto status = backup.get_status();
+    EXPECT_FALSE(status.generation.empty());
+    EXPECT_GT(status.segments, 0U);
+    EXPECT_GT(status.frames, 0U);
+  }
+  add_user("not_shipped");
+  restore();
+  EXPECT_TRUE(has_user("before"));
+  EXPECT_TRUE(has_user("after"));
+  EXPECT_FALSE(has_user("not_shipped"));
+}
+
+TEST_F(TestSFSBackup, wal_restarts_are_followed) {
+  // checkpoint on every copy, so the WAL starts over all the time
+  cct->_conf.set_val("rgw_sfs_wal_checkpoint_passive_frames", "0");
+  connect();
+  SFSBackup backup(cct.get(), conn, getBackupDir());
+  backup.snapshot();
+  for (int i = 0; i < 20; i++) {
+    add_user("user" + std::to_string(i));
+    backup.ship();
+  }
+  EXPECT_EQ(count_generations(), 1U);
+  restore();
+  for (int i = 0; i < 20; i++) {
+    EXPECT_TRUE(has_user("user" + std::to_string(i))) << i;
+  }
+}
+
+TEST_F(TestSFSBackup, old_generations_are_removed) {
+  cct->_conf.set_val("rgw_sfs_backup_generations", "1");
+  connect();
+  SFSBackup backup(cct.get(), conn, getBackupDir());
+  for (int i = 0; i < 3; i++) {
+    add_user("user" + std::to_string(i));
+    backup.snapshot();
+  }
+  EXPECT_EQ(count_generations(), 1U);
+  restore();
+  EXPECT_TRUE(has_user("user2"));
+}
+
+TEST_F(TestSFSBackup, wal_past_max_frames_starts_a_new_generation) {
+  // the backup doesn't checkpoint, commits do once the WAL is too long
+  cct->_conf.set_val("rgw_sfs_wal_checkpoint_passive_frames", "1000000");
+  cct->_conf.set_val("rgw_sfs_backup_wal_max_frames", "10");
+  connect();
+  SFSBackup backup(cct.get(), conn, getBackupDir());
+  backup.snapshot();
+  const auto first = backup.get_status().generation;
+  for (int i = 0; i < 20; i++) {
+    add_user("user" + std::to_string(i));
+  }
+  EXPECT_GT(conn->forced_wal_checkpoints, 0U);
+  backup.ship();
+  EXPECT_NE(backup.get_status().generation, first);
+  restore();
+  for (int i = 0; i < 20; i++) {
+    EXPECT_TRUE(has_user("user" + std::to_string(i))) << i;
+  }
+}
+
+TEST_F(TestSFSBackup, restore_needs_a_complete_generation) {
+  fs::create_directories(fs::path(getBackupDir()) / "0000000000000001");
+  EXPECT_THROW(
+      rgw::sal::sfs::restore_backup(
+          getBackupDir(), fs::path(getRestoreDir()) / std::string(DB_FILENAME)
+      ),
+      std::runtime_error
+  );
+}
@@ -0,0 +1,203 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/bucket_dirs.h"
+#include "rgw/driver/sfs/sfs_gc.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_objects.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+
+using namespace rgw::sal::sfs::sqlite;
+using rgw::sal::sfs::BucketDirs;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_USERNAME = "test_user";
+
+class TestSFSBucketDirs : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  std::unique_ptr<rgw::sal::SFStore> store;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_conf.set_val("rgw_sfs_bucket_data_dirs", "true");
+    cct->_conf.set_val("rgw_sfs_trash_files_per_sec", "0");
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+    store->gc->suspend();
+
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = TEST_USERNAME;
+    users.store_user(user);
+  }
+
+  void TearDown() override {
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  void createBucket(const std::string& bucket_id, bool own_dir) {
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo bucket;
+    bucket.binfo.bucket.name = bucket_id;
+    bucket.binfo.bucket.bucket_id = bucket_id;
+    bucket.binfo.owner.id = TEST_USERNAME;
+    db_buckets.store_bucket(bucket);
+    if (own_dir) {
+      store->bucket_dirs->create(bucket_id);
+    }
+  }
+
+  void deleteBucket(const std::string& bucket_id) {
+    SQLiteBuckets db_buckets(store->db_conn);
+    auto bucket = db_buckets.get_bucket(bucket_id);
+    ASSERT_TRUE(bucket.has_value());
+    bucket->deleted = true;
+    db_buckets.store_bucket(*bucket);
+  }
+
+  // Store an object with one committed version and its data file below
+  // the bucket's data root.
+  std::shared_ptr<rgw::sal::sfs::Object> createObject(
+      const std::string& bucket_id, const std::string& name, uint version
+  ) {
+    std::shared_ptr<rgw::sal::sfs::Object> object(
+        rgw::sal::sfs::Object::create_for_testing(name)
+    );
+    object->version_id = version;
+    object->data_root = store->bucket_dirs->data_root(bucket_id);
+
+    SQLiteObjects db_objects(store->db_conn);
+    DBObject db_object;
+    db_object.uuid = object->path.get_uuid();
+    db_object.name = name;
+    db_object.bucket_id = bucket_id;
+    db_objects.store_object(db_object);
+
+    SQLiteVersionedObjects db_versions(store->db_conn);
+    DBVersionedObject db_version;
+    db_version.id = version;
+    db_version.object_id = object->path.get_uuid();
+    db_version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    db_version.version_id = std::to_string(version);
+    db_versions.insert_versioned_object(db_version);
+
+    const auto path = fs::path(getTestDir()) / object->get_storage_path();
+    fs::create_directories(path.parent_path());
+    std::ofstream ofs(path);
+    ofs << "data";
+    return object;
+  }
+
+  size_t countFiles(const fs::path& relpath) {
+    size_t count = 0;
+    const auto path = fs::path(getTestDir()) / relpath;
+    if (!fs::exists(path)) {
+      return 0;
+    }
+    for (const auto& entry : fs::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file()) {
+        ++count;
+      }
+    }
+    return count;
+  }
+};
+
+TEST_F(TestSFSBucketDirs, new_buckets_get_a_data_dir) {
+  createBucket("own", true);
+  createBucket("shared", false);
+
+  EXPECT_TRUE(store->bucket_dirs->has_own_dir("own"));
+  EXPECT_EQ(
+      fs::path(BucketDirs::BUCKETS_DIR) / "own",
+      store->bucket_dirs->data_root("own")
+  );
+  EXPECT_TRUE(fs::is_directory(fs::path(getTestDir()) / "buckets" / "own"));
+  EXPECT_FALSE(store->bucket_dirs->has_own_dir("shared"));
+  EXPECT_TRUE(store->bucket_dirs->data_root("shared").empty());
+
+  const auto own = createObject("own", "obj", 1);
+  const auto shared = createObject("shared", "obj", 2);
+  EXPECT_EQ(
+      store->bucket_dirs->data_root("own"),
+      store->bucket_dirs->object_data_root(own->path.get_uuid())
+  );
+  EXPECT_TRUE(
+      store->bucket_dirs->object_data_root(shared->path.get_uuid()).empty()
+  );
+  EXPECT_EQ(1, countFiles("buckets/own"));
+
+  // the layout of a bucket is kept across restarts
+  store.reset();
+  cct->_conf.set_val("rgw_sfs_bucket_data_dirs", "false");
+  store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+  EXPECT_TRUE(store->bucket_dirs->has_own_dir("own"));
+  EXPECT_FALSE(store->bucket_dirs->has_own_dir("shared"));
+}
+
+TEST_F(TestSFSBucketDirs, removed_bucket_goes_to_trash) {
+  createBucket("own", true);
+  for (uint version = 1; version <= 10; ++version) {
+    createObject("own", "obj" + std::to_string(version), version);
+  }
+  EXPECT_EQ(10, countFiles("buckets/own"));
+
+  deleteBucket("own");
+  store->bucket_dirs->trash("own");
+  EXPECT_FALSE(fs::exists(fs::path(getTestDir()) / "buckets" / "own"));
+  EXPECT_EQ(10, countFiles("trash"));
+
+  // the gc only drops the rows
+  store->gc->process();
+  SQLiteBuckets db_buckets(store->db_conn);
+  EXPECT_FALSE(db_buckets.get_bucket("own").has_value());
+  SQLiteObjects db_objects(store->db_conn);
+  EXPECT_TRUE(db_objects.get_objects("own").empty());
+  EXPECT_FALSE(store->bucket_dirs->has_own_dir("own"));
+  EXPECT_TRUE(db_buckets.get_bucket_data_dirs().empty());
+  EXPECT_EQ(10, countFiles("trash"));
+
+  EXPECT_TRUE(store->bucket_dirs->empty_trash());
+  EXPECT_EQ(0, countFiles("trash"));
+  EXPECT_TRUE(fs::is_empty(fs::path(getTestDir()) / "trash"));
+}
+
+TEST_F(TestSFSBucketDirs, gc_deletes_versions_below_bucket_dir) {
+  createBucket("own", true);
+  createObject("own", "obj1", 1);
+  createObject("own", "obj2", 2);
+
+  SQLiteVersionedObjects db_versions(store->db_conn);
+  auto version = db_versions.get_versioned_object(1);
+  ASSERT_TRUE(version.has_value());
+  version->object_state = rgw::sal::sfs::ObjectState::DELETED;
+  db_versions.store_versioned_object(*version);
+
+  store->gc->process();
+  EXPECT_EQ(1, countFiles("buckets/own"));
+}
@@ -0,0 +1,60 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include "rgw/driver/sfs/checksum.h"
+
+using namespace rgw::sal::sfs;
+
+TEST(TestSFSChecksum, Crc32cMatchesStandard) {
+  // the crc32c check value
+  Crc32c crc;
+  ceph::bufferlist bl;
+  bl.append("123456789");
+  crc.update(bl);
+  EXPECT_EQ(crc.value(), 0xe3069283);
+  EXPECT_EQ(format_crc32c(crc.value()), "crc32c:e3069283");
+}
+
+TEST(TestSFSChecksum, Crc32cIsIncremental) {
+  Crc32c whole;
+  ceph::bufferlist all;
+  all.append("123456789");
+  whole.update(all);
+
+  Crc32c pieces;
+  for (const auto piece : {"1234", "5", "6789"}) {
+    ceph::bufferlist bl;
+    bl.append(piece);
+    pieces.update(bl);
+  }
+  EXPECT_EQ(pieces.value(), whole.value());
+
+  Crc32c empty;
+  EXPECT_EQ(empty.value(), 0);
+}
+
+TEST(TestSFSChecksum, CompositeCrc32c) {
+  const std::vector<uint32_t> parts = {0xe3069283, 0x12345678};
+  const auto composite = format_composite_crc32c(parts);
+  EXPECT_TRUE(composite.starts_with("crc32c:"));
+  EXPECT_TRUE(composite.ends_with("-2"));
+
+  // crc32c of the big-endian part checksums
+  Crc32c expected;
+  ceph::bufferlist bl;
+  bl.append("\xe3\x06\x92\x83\x12\x34\x56\x78", 8);
+  expected.update(bl);
+  EXPECT_EQ(composite, format_crc32c(expected.value()) + "-2");
+}
+
+TEST(TestSFSChecksum, ParseCrc32c) {
+  EXPECT_EQ(parse_crc32c("crc32c:e3069283"), 0xe3069283);
+  EXPECT_EQ(parse_crc32c(format_crc32c(42)), 42);
+  EXPECT_FALSE(parse_crc32c("").has_value());
+  EXPECT_FALSE(parse_crc32c("test_checksum").has_value());
+  EXPECT_FALSE(parse_crc32c("crc32c:e3069283-2").has_value());
+  EXPECT_FALSE(parse_crc32c("crc32c:e30692").has_value());
+  EXPECT_FALSE(parse_crc32c("crc32c:xyz06928").has_value());
+}
@@ -0,0 +1,180 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <memory>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/content_store.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_content.h"
+
+using namespace rgw::sal::sfs;
+using namespace rgw::sal::sfs::sqlite;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+
+class TestSFSContentStore : public ::testing::Test {
+ protected:
+  std::shared_ptr<CephContext> cct;
+  DBConnRef conn;
+  std::unique_ptr<ContentStore> content_store;
+  std::unique_ptr<NoDoutPrefix> ndp;
+  const DoutPrefixProvider* dpp = nullptr;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_conf.set_val("rgw_sfs_dedup", "true");
+    cct->_conf.set_val("rgw_sfs_dedup_min_size", "1");
+    cct->_log->start();
+    conn = std::make_shared<DBConn>(cct.get());
+    content_store =
+        std::make_unique<ContentStore>(cct.get(), getTestDir(), conn);
+    ndp = std::make_unique<NoDoutPrefix>(cct.get(), 1);
+    dpp = ndp.get();
+  }
+
+  void TearDown() override {
+    content_store.reset();
+    conn.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  fs::path getTestDir() const { return fs::temp_directory_path() / TEST_DIR; }
+
+  // writes data to relpath and returns the still open fd
+  int write_file(const fs::path& relpath, const std::string& data) const {
+    const auto path = getTestDir() / relpath;
+    fs::create_directories(path.parent_path());
+    const int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(
+        ::write(fd, data.data(), data.size()),
+        static_cast<ssize_t>(data.size())
+    );
+    return fd;
+  }
+
+  ino_t inode(const fs::path& path) const {
+    struct stat st;
+    EXPECT_EQ(::stat(path.c_str(), &st), 0);
+    return st.st_ino;
+  }
+
+  /// Count a reference like Object::metadata_finish does
+  void commit(const std::string& hash, uint64_t size) const {
+    SQLiteContent dbcontent(conn);
+    dbcontent.add_ref(hash, size);
+  }
+
+  uint64_t refcount(const std::string& hash) const {
+    SQLiteContent dbcontent(conn);
+    auto content = dbcontent.get_content(hash);
+    return content.has_value() ? content->refcount : 0;
+  }
+};
+
+static std::string hash_of(const std::string& data) {
+  ContentHasher hasher;
+  bufferlist bl;
+  bl.append(data);
+  hasher.update(bl);
+  return hasher.final();
+}
+
+TEST_F(TestSFSContentStore, HashSpansBuffers) {
+  ContentHasher hasher;
+  bufferlist bl;
+  bufferlist tail;
+  bl.append("a");
+  tail.append("bc");
+  bl.claim_append(tail);
+  ASSERT_EQ(bl.get_num_buffers(), 2);
+  hasher.update(bl);
+  EXPECT_EQ(
+      hasher.final(),
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+  );
+}
+
+TEST_F(TestSFSContentStore, NothingToLinkTo) {
+  const std::string data = "some data";
+  const fs::path relpath = "aa/bb/first.v";
+  const int fd = write_file(relpath, data);
+  ::close(fd);
+  EXPECT_FALSE(content_store->link_existing(
+      dpp, relpath, hash_of(data), data.size()
+  ));
+  EXPECT_TRUE(fs::exists(getTestDir() / relpath));
+}
+
+TEST_F(TestSFSContentStore, SharedUntilLastReference) {
+  const std::string data = "shared data";
+  const std::string hash = hash_of(data);
+  const fs::path first = "aa/bb/first.v";
+  const fs::path second = "cc/dd/second.v";
+  const auto content = getTestDir() / ContentStore::content_path(hash);
+
+  int fd = write_file(first, data);
+  if (!content_store->tag(dpp, fd, hash)) {
+    ::close(fd);
+    GTEST_SKIP() << "no user xattrs on " << getTestDir();
+  }
+  ::fsync(fd);
+  ::close(fd);
+  {
+    auto lock = content_store->lock();
+    EXPECT_TRUE(content_store->publish(dpp, first, hash, data.size()));
+    // counted when the version is committed
+    EXPECT_EQ(refcount(hash), 0);
+    commit(hash, data.size());
+  }
+  ASSERT_TRUE(fs::exists(content));
+  EXPECT_EQ(inode(content), inode(getTestDir() / first));
+  EXPECT_EQ(refcount(hash), 1);
+
+  fd = write_file(second, data);
+  {
+    auto lock = content_store->lock();
+    // wrong size is not linked
+    EXPECT_FALSE(content_store->link_existing(dpp, second, hash, 1));
+    EXPECT_NE(inode(content), inode(getTestDir() / second));
+
+    EXPECT_TRUE(content_store->link_existing(dpp, second, hash, data.size())
+    );
+    commit(hash, data.size());
+  }
+  ::close(fd);
+  EXPECT_EQ(inode(content), inode(getTestDir() / second));
+  EXPECT_EQ(refcount(hash), 2);
+
+  content_store->remove(getTestDir() / first);
+  EXPECT_FALSE(fs::exists(getTestDir() / first));
+  EXPECT_TRUE(fs::exists(content));
+  EXPECT_EQ(refcount(hash), 1);
+
+  content_store->remove(getTestDir() / second);
+  EXPECT_FALSE(fs::exists(getTestDir() / second));
+  EXPECT_FALSE(fs::exists(content));
+  EXPECT_EQ(refcount(hash), 0);
+  SQLiteContent dbcontent(conn);
+  EXPECT_FALSE(dbcontent.get_content(hash).has_value());
+}
+
+TEST_F(TestSFSContentStore, RemoveUnsharedFile) {
+  const fs::path relpath = "aa/bb/plain.v";
+  const int fd = write_file(relpath, "plain");
+  ::close(fd);
+  content_store->remove(getTestDir() / relpath);
+  EXPECT_FALSE(fs::exists(getTestDir() / relpath));
+}
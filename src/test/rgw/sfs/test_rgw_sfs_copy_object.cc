@@ -0,0 +1,366 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "rgw/driver/sfs/checksum.h"
+#include "rgw/driver/sfs/file_copy.h"
+#include "rgw/driver/sfs/sqlite/buckets/bucket_conversions.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+
+/*
+  HINT
+  Creates sqlite and data files in /tmp/rgw_sfs_tests
+*/
+
+using namespace rgw::sal::sfs;
+using namespace rgw::sal::sfs::sqlite;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_USERNAME = "test_user";
+const static std::string TEST_BUCKET = "test_bucket";
+
+class CollectDataCB : public RGWGetDataCB {
+ public:
+  bufferlist data;
+
+  int handle_data(bufferlist& bl, off_t ofs, off_t len) override {
+    bufferlist piece;
+    piece.substr_of(bl, ofs, len);
+    data.append(piece);
+    return 0;
+  }
+};
+
+class TestSFSCopyObject : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  NoDoutPrefix dpp{cct.get(), 1};
+  const rgw_user owner{"", TEST_USERNAME, ""};
+  const rgw_placement_rule placement;
+  std::unique_ptr<rgw::sal::SFStore> store;
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    // reads must come from the data files
+    cct->_conf.set_val("rgw_sfs_data_cache_size", "0");
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+  }
+
+  void TearDown() override {
+    bucket.reset();
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  fs::path writeFile(const std::string& name, const std::string& content) {
+    const auto path = fs::path(getTestDir()) / name;
+    std::ofstream ofs(path, std::ios::binary);
+    ofs << content;
+    return path;
+  }
+
+  static std::string readFile(const fs::path& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+  }
+
+  void openStore() {
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+    store->gc->suspend();
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = TEST_USERNAME;
+    users.store_user(user);
+
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo db_bucket;
+    db_bucket.binfo.bucket.name = TEST_BUCKET;
+    db_bucket.binfo.bucket.bucket_id = TEST_BUCKET;
+    db_bucket.binfo.owner.id = TEST_USERNAME;
+    db_bucket.binfo.creation_time = ceph::real_clock::now();
+    db_bucket.binfo.flags |= BUCKET_VERSIONED;
+    db_bucket.mtime = db_bucket.binfo.creation_time;
+    db_buckets.store_bucket(db_bucket);
+    store->_refresh_buckets();
+
+    auto sal_user = store->get_user(owner);
+    ASSERT_EQ(
+        store->get_bucket(
+            &dpp, sal_user.get(), db_bucket.binfo.bucket, &bucket, null_yield
+        ),
+        0
+    );
+  }
+
+  std::vector<fs::path> getStoreDataFiles() const {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(getTestDir())) {
+      if (entry.is_regular_file() &&
+          !entry.path().filename().string().starts_with(DB_FILENAME)) {
+        files.push_back(entry.path());
+      }
+    }
+    return files;
+  }
+
+  /// Store a new version of `name`, returns its version id
+  std::string put(
+      const std::string& name, const std::string& content,
+      rgw::sal::Attrs attrs = {}
+  ) {
+    auto obj = bucket->get_object(rgw_obj_key(name));
+    obj->gen_rand_obj_instance_name();
+    auto writer = store->get_atomic_writer(
+        &dpp, null_yield, obj.get(), owner, &placement, 0, "test"
+    );
+    EXPECT_EQ(writer->prepare(null_yield), 0);
+    bufferlist data;
+    data.append(content);
+    EXPECT_EQ(writer->process(std::move(data), 0), 0);
+    EXPECT_EQ(writer->process({}, content.size()), 0);
+    ceph::real_time mtime;
+    EXPECT_EQ(
+        writer->complete(
+            content.size(), "etag", &mtime, ceph::real_time(), attrs,
+            ceph::real_time(), nullptr, nullptr, nullptr, nullptr, nullptr,
+            null_yield
+        ),
+        0
+    );
+    return obj->get_instance();
+  }
+
+  /// Copy version `src_version` of `src_name` to a new version of
+  /// `dst_name`, returns the new version id
+  std::string copy(
+      const std::string& src_name, const std::string& src_version,
+      const std::string& dst_name,
+      rgw::sal::AttrsMod attrs_mod = rgw::sal::ATTRSMOD_NONE,
+      rgw::sal::Attrs attrs = {}
+  ) {
+    auto src = bucket->get_object(rgw_obj_key(src_name, src_version));
+    auto dst = bucket->get_object(rgw_obj_key(dst_name));
+    dst->gen_rand_obj_instance_name();
+    ceph::real_time mtime;
+    std::string etag;
+    EXPECT_EQ(
+        src->copy_object(
+            nullptr, nullptr, rgw_zone_id(), dst.get(), bucket.get(),
+            bucket.get(), placement, nullptr, &mtime, nullptr, nullptr, false,
+            nullptr, nullptr, attrs_mod, false, attrs,
+            RGWObjCategory::Main, 0, boost::none, nullptr, nullptr, &etag,
+            nullptr, nullptr, &dpp, null_yield
+        ),
+        0
+    );
+    return dst->get_instance();
+  }
+
+  std::string read(const std::string& name, const std::string& version) {
+    auto obj = bucket->get_object(rgw_obj_key(name, version));
+    auto read_op = obj->get_read_op();
+    EXPECT_EQ(read_op->prepare(null_yield, &dpp), 0);
+    CollectDataCB cb;
+    const auto size = static_cast<int64_t>(obj->get_obj_size());
+    if (size > 0) {
+      EXPECT_EQ(read_op->iterate(&dpp, 0, size - 1, &cb, null_yield), size);
+    }
+    return cb.data.to_str();
+  }
+
+  void deleteVersion(const std::string& name, const std::string& version) {
+    auto obj = bucket->get_object(rgw_obj_key(name, version));
+    EXPECT_EQ(obj->delete_object(&dpp, null_yield, false), 0);
+    store->gc->process();
+  }
+};
+
+TEST_F(TestSFSCopyObject, CopyFileData) {
+  const auto src = writeFile("src", "0123456789");
+  const auto dst = writeFile("dst", "abc");
+  const int src_fd = ::open(src.c_str(), O_RDONLY);
+  const int dst_fd = ::open(dst.c_str(), O_WRONLY);
+  ASSERT_GE(src_fd, 0);
+  ASSERT_GE(dst_fd, 0);
+  EXPECT_EQ(copy_file_data(src_fd, dst_fd, 3, 10), 0);
+  // a source shorter than claimed is an error
+  EXPECT_EQ(copy_file_data(src_fd, dst_fd, 13, 11), -EIO);
+  ::close(src_fd);
+  ::close(dst_fd);
+  EXPECT_EQ(readFile(dst).substr(0, 13), "abc0123456789");
+
+  fs::remove(dst);
+  EXPECT_EQ(readFile(src), "0123456789");
+}
+
+TEST_F(TestSFSCopyObject, CloneFileRange) {
+  // clones need block aligned offsets
+  const std::string block(4096, 'x');
+  const auto src = writeFile("src", block + "0123456789");
+  const auto dst = writeFile("dst", block);
+  const int src_fd = ::open(src.c_str(), O_RDONLY);
+  const int dst_fd = ::open(dst.c_str(), O_WRONLY);
+  ASSERT_GE(src_fd, 0);
+  ASSERT_GE(dst_fd, 0);
+  const int ret = clone_file_range(src_fd, dst_fd, block.size());
+  ::close(src_fd);
+  ::close(dst_fd);
+  if (ret == -EOPNOTSUPP || ret == -EXDEV || ret == -EINVAL ||
+      ret == -ENOTTY) {
+    GTEST_SKIP() << "no reflink support in " << getTestDir();
+  }
+  ASSERT_EQ(ret, 0);
+  EXPECT_EQ(readFile(dst), block + block + "0123456789");
+
+  fs::remove(dst);
+  EXPECT_EQ(readFile(src), block + "0123456789");
+}
+
+TEST_F(TestSFSCopyObject, CloneOrCopyRangeFallsBack) {
+  // an unaligned destination offset can't be cloned on any filesystem
+  const auto src = writeFile("src", "0123456789");
+  const auto dst = writeFile("dst", "a");
+  const int src_fd = ::open(src.c_str(), O_RDONLY);
+  const int dst_fd = ::open(dst.c_str(), O_WRONLY);
+  ASSERT_GE(src_fd, 0);
+  ASSERT_GE(dst_fd, 0);
+  EXPECT_LT(clone_file_range(src_fd, dst_fd, 1), 0);
+  EXPECT_EQ(clone_or_copy_range(src_fd, dst_fd, 1, 10), 0);
+  ::close(src_fd);
+  ::close(dst_fd);
+  EXPECT_EQ(readFile(dst), "a0123456789");
+
+  fs::remove(dst);
+  EXPECT_EQ(readFile(src), "0123456789");
+}
+
+TEST_F(TestSFSCopyObject, SelfCopyLinksData) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  const std::string content = "some object data";
+  const auto src_version = put("obj", content);
+  const auto dst_version = copy("obj", src_version, "obj");
+  ASSERT_NE(src_version, dst_version);
+
+  // both versions share one inode
+  auto files = getStoreDataFiles();
+  ASSERT_EQ(files.size(), 2);
+  EXPECT_EQ(fs::hard_link_count(files[0]), 2);
+  EXPECT_TRUE(fs::equivalent(files[0], files[1]));
+  EXPECT_EQ(read("obj", dst_version), content);
+
+  deleteVersion("obj", dst_version);
+  files = getStoreDataFiles();
+  ASSERT_EQ(files.size(), 1);
+  EXPECT_EQ(fs::hard_link_count(files[0]), 1);
+  EXPECT_EQ(read("obj", src_version), content);
+}
+
+TEST_F(TestSFSCopyObject, CopyToOtherObjectCopiesData) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  const std::string content = "some object data";
+  const auto src_version = put("obj", content);
+  const auto dst_version = copy("obj", src_version, "copy");
+
+  auto files = getStoreDataFiles();
+  ASSERT_EQ(files.size(), 2);
+  EXPECT_FALSE(fs::equivalent(files[0], files[1]));
+  EXPECT_EQ(read("copy", dst_version), content);
+
+  deleteVersion("copy", dst_version);
+  files = getStoreDataFiles();
+  ASSERT_EQ(files.size(), 1);
+  EXPECT_EQ(read("obj", src_version), content);
+}
+
+TEST_F(TestSFSCopyObject, CopyKeepsChecksum) {
+  cct->_conf.set_val("rgw_sfs_verify_checksums", "true");
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  const std::string content = "some object data";
+  const auto src_version = put("obj", content);
+  const auto dst_version = copy("obj", src_version, "copy");
+
+  Crc32c crc;
+  bufferlist bl;
+  bl.append(content);
+  crc.update(bl);
+  SQLiteVersionedObjects db_versions(store->db_conn);
+  const auto dst = db_versions.get_committed_versioned_object(
+      TEST_BUCKET, "copy", dst_version
+  );
+  ASSERT_TRUE(dst.has_value());
+  EXPECT_EQ(dst->checksum, format_crc32c(crc.value()));
+
+  // whole object reads of the copy are verified against it
+  EXPECT_EQ(read("copy", dst_version), content);
+}
+
+TEST_F(TestSFSCopyObject, SelfCopyReplacesMetadata) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  const std::string content = "some object data";
+  const std::string old_key = RGW_ATTR_META_PREFIX "old";
+  const std::string new_key = RGW_ATTR_META_PREFIX "new";
+  rgw::sal::Attrs src_attrs;
+  src_attrs[old_key].append("old value");
+  src_attrs[RGW_ATTR_ETAG].append("etag");
+  const auto src_version = put("obj", content, src_attrs);
+
+  rgw::sal::Attrs new_attrs;
+  new_attrs[new_key].append("new value");
+  const auto dst_version = copy(
+      "obj", src_version, "obj", rgw::sal::ATTRSMOD_REPLACE, new_attrs
+  );
+
+  SQLiteVersionedObjects db_versions(store->db_conn);
+  const auto dst = db_versions.get_committed_versioned_object(
+      TEST_BUCKET, "obj", dst_version
+  );
+  ASSERT_TRUE(dst.has_value());
+  EXPECT_FALSE(dst->attrs.contains(old_key));
+  ASSERT_TRUE(dst->attrs.contains(new_key));
+  EXPECT_EQ(dst->attrs.at(new_key).to_str(), "new value");
+  // the etag describes the data and is kept
+  ASSERT_TRUE(dst->attrs.contains(RGW_ATTR_ETAG));
+  EXPECT_EQ(dst->attrs.at(RGW_ATTR_ETAG).to_str(), "etag");
+  EXPECT_EQ(read("obj", dst_version), content);
+
+  // the source version keeps its metadata
+  const auto src = db_versions.get_committed_versioned_object(
+      TEST_BUCKET, "obj", src_version
+  );
+  ASSERT_TRUE(src.has_value());
+  EXPECT_TRUE(src->attrs.contains(old_key));
+  EXPECT_FALSE(src->attrs.contains(new_key));
+}
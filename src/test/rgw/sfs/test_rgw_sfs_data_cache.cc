@@ -0,0 +1,97 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "rgw/driver/sfs/data_cache.h"
+
+using namespace rgw::sal::sfs;
+
+namespace {
+
+bufferlist make_data(size_t size, char c = 'x') {
+  bufferlist bl;
+  bl.append(std::string(size, c));
+  return bl;
+}
+
+uuid_d make_uuid() {
+  uuid_d uuid;
+  uuid.generate_random();
+  return uuid;
+}
+
+}  // namespace
+
+TEST(TestSFSDataCache, HitSharesData) {
+  DataCache cache(1024, 100, 1);
+  const auto uuid = make_uuid();
+  const auto mtime = ceph::real_clock::now();
+  const auto data = make_data(10);
+
+  EXPECT_FALSE(cache.get(1, uuid, mtime).has_value());
+  cache.put(1, uuid, mtime, data);
+  auto hit = cache.get(1, uuid, mtime);
+  ASSERT_TRUE(hit.has_value());
+  EXPECT_TRUE(hit->contents_equal(data));
+  EXPECT_EQ(hit->buffers().front().c_str(), data.buffers().front().c_str());
+  EXPECT_EQ(10, cache.get_bytes());
+  EXPECT_EQ(1, cache.get_hits());
+  EXPECT_EQ(1, cache.get_misses());
+}
+
+TEST(TestSFSDataCache, StaleEntriesMiss) {
+  DataCache cache(1024, 100, 2);
+  const auto uuid = make_uuid();
+  const auto mtime = ceph::real_clock::now();
+  cache.put(1, uuid, mtime, make_data(10));
+
+  // a reused version id of another object or commit
+  EXPECT_FALSE(cache.get(1, make_uuid(), mtime).has_value());
+  cache.put(1, uuid, mtime, make_data(10));
+  EXPECT_FALSE(cache.get(1, uuid, mtime + std::chrono::seconds(1)).has_value());
+  EXPECT_EQ(0, cache.get_bytes());
+
+  cache.put(2, uuid, mtime, make_data(10));
+  cache.erase(2);
+  EXPECT_FALSE(cache.get(2, uuid, mtime).has_value());
+  EXPECT_EQ(0, cache.get_bytes());
+}
+
+TEST(TestSFSDataCache, SizeLimits) {
+  DataCache cache(1024, 100, 1);
+  const auto uuid = make_uuid();
+  const auto mtime = ceph::real_clock::now();
+  EXPECT_TRUE(cache.wants(100));
+  EXPECT_FALSE(cache.wants(101));
+  cache.put(1, uuid, mtime, make_data(101));
+  EXPECT_FALSE(cache.get(1, uuid, mtime).has_value());
+
+  DataCache disabled(0, 100, 1);
+  EXPECT_FALSE(disabled.is_enabled());
+  disabled.put(1, uuid, mtime, make_data(10));
+  EXPECT_FALSE(disabled.get(1, uuid, mtime).has_value());
+}
+
+TEST(TestSFSDataCache, ClockEviction) {
+  DataCache cache(30, 10, 1);
+  const auto uuid = make_uuid();
+  const auto mtime = ceph::real_clock::now();
+  cache.put(1, uuid, mtime, make_data(10));
+  cache.put(2, uuid, mtime, make_data(10));
+  cache.put(3, uuid, mtime, make_data(10));
+  // sweeps clear every reference bit, then evict the oldest
+  cache.put(4, uuid, mtime, make_data(10));
+  EXPECT_EQ(30, cache.get_bytes());
+  EXPECT_FALSE(cache.get(1, uuid, mtime).has_value());
+
+  // 2 was used since the last sweep and gets a second chance
+  EXPECT_TRUE(cache.get(2, uuid, mtime).has_value());
+  cache.put(5, uuid, mtime, make_data(10));
+  EXPECT_TRUE(cache.get(2, uuid, mtime).has_value());
+  EXPECT_FALSE(cache.get(3, uuid, mtime).has_value());
+  EXPECT_TRUE(cache.get(4, uuid, mtime).has_value());
+  EXPECT_TRUE(cache.get(5, uuid, mtime).has_value());
+}
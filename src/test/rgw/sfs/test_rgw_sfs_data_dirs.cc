@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/data_dirs.h"
+#include "rgw/driver/sfs/multipart_types.h"
+#include "rgw/driver/sfs/uuid_path.h"
+
+using namespace rgw::sal::sfs;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+
+class TestSFSDataDirs : public ::testing::TestWithParam<bool> {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_log->start();
+  }
+
+  void TearDown() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  fs::path getTestDir() const { return fs::temp_directory_path() / TEST_DIR; }
+
+  void create_file(DataDirs& uut, const fs::path& relpath) {
+    ASSERT_FALSE(uut.ensure_parent(relpath));
+    const int fd = uut.open(relpath, O_CREAT | O_WRONLY | O_CLOEXEC, 0600);
+    ASSERT_GE(fd, 0);
+    ::close(fd);
+    ASSERT_TRUE(fs::is_regular_file(getTestDir() / relpath));
+  }
+};
+
+TEST_P(TestSFSDataDirs, creates_uuid_path_parents) {
+  DataDirs uut(getTestDir(), GetParam());
+  const UUIDPath path = UUIDPath::create();
+  create_file(uut, path.to_path() / "1.v");
+  // second file in the same leaf directory
+  create_file(uut, path.to_path() / "2.v");
+  // multipart parts share the layout
+  create_file(uut, MultipartPartPath(path.get_uuid(), 1).to_path());
+}
+
+TEST_P(TestSFSDataDirs, non_uuid_path_falls_back) {
+  DataDirs uut(getTestDir(), GetParam());
+  create_file(uut, fs::path("not") / "a" / "uuid" / "path" / "file");
+  create_file(uut, fs::path("file"));
+}
+
+TEST_P(TestSFSDataDirs, recovers_from_removed_fanout_dir) {
+  DataDirs uut(getTestDir(), GetParam());
+  const UUIDPath path = UUIDPath::create();
+  create_file(uut, path.to_path() / "1.v");
+
+  // remove the whole first level fan-out dir behind the cache's back
+  const auto first = *path.to_path().begin();
+  fs::remove_all(getTestDir() / first);
+
+  const UUIDPath other(path.get_uuid());
+  create_file(uut, other.to_path() / "2.v");
+}
+
+TEST_P(TestSFSDataDirs, precreate) {
+  DataDirs uut(getTestDir(), GetParam());
+  uut.precreate(cct.get());
+  EXPECT_TRUE(fs::is_directory(getTestDir() / "00" / "00"));
+  EXPECT_TRUE(fs::is_directory(getTestDir() / "ff" / "ff"));
+  EXPECT_TRUE(fs::is_directory(getTestDir() / "a5" / "5a"));
+  create_file(uut, UUIDPath::create().to_path() / "1.v");
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    OpenAt, TestSFSDataDirs, ::testing::Bool(),
+    [](const testing::TestParamInfo<TestSFSDataDirs::ParamType>& info) {
+      return info.param ? "openat" : "open";
+    }
+);
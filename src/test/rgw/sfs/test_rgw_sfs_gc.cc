@@ -21,6 +21,7 @@
 #include "rgw/driver/sfs/sqlite/buckets/bucket_conversions.h"
 #include "rgw/driver/sfs/sqlite/dbconn.h"
 #include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_gc_journal.h"
 #include "rgw/driver/sfs/sqlite/sqlite_users.h"
 #include "rgw/driver/sfs/uuid_path.h"
 #include "rgw/rgw_perf_counters.h"
@@ -474,6 +475,61 @@ TEST_F(TestSFSGC, TestDeletedObjects) {
   EXPECT_EQ(getStoreDataFileCount(), 0);
 }
 
+TEST_F(TestSFSGC, TestJournal) {
+  auto store = new rgw::sal::SFStore(cct.get(), getTestDir());
+  auto gc = store->gc;
+  gc->suspend();  // start suspended so we have control over processing
+
+  createTestUser(store->db_conn);
+  createTestBucket("test_bucket_1", store->db_conn);
+
+  uint version_id = 1;
+  auto object1 = createTestObject("test_bucket_1", "obj_1", store->db_conn);
+  createTestObjectVersion(object1, version_id++, store->db_conn);
+  createTestObjectVersion(object1, version_id++, store->db_conn);
+
+  auto object2 = createTestObject("test_bucket_1", "obj_2", store->db_conn);
+  createTestObjectVersion(object2, version_id++, store->db_conn);
+  createTestObjectVersion(object2, version_id++, store->db_conn);
+  EXPECT_EQ(getStoreDataFileCount(), 4);
+
+  // delete a version of each object but only journal object1
+  deleteTestObjectVersion(1, store->db_conn);
+  deleteTestObjectVersion(3, store->db_conn);
+  gc->enqueue(GCJournalKind::OBJECT, object1->path.get_uuid().to_string());
+
+  SQLiteGCJournal journal(store->db_conn);
+  EXPECT_EQ(journal.get_entries(10).size(), 1);
+  EXPECT_TRUE(gc->process_journal());
+  // only the journaled version is gone
+  EXPECT_EQ(getStoreDataFileCount(), 3);
+  EXPECT_TRUE(journal.get_entries(10).empty());
+  SQLiteVersionedObjects db_versions(store->db_conn);
+  EXPECT_FALSE(db_versions.get_versioned_object(1, false).has_value());
+  EXPECT_TRUE(db_versions.get_versioned_object(3, false).has_value());
+
+  // entries for work that is already done are harmless
+  gc->enqueue(GCJournalKind::OBJECT, object1->path.get_uuid().to_string());
+  gc->enqueue(GCJournalKind::OBJECT, "not an uuid");
+  gc->enqueue(GCJournalKind::MULTIPART, "no such upload");
+  EXPECT_TRUE(gc->process_journal());
+  EXPECT_EQ(getStoreDataFileCount(), 3);
+  EXPECT_TRUE(journal.get_entries(10).empty());
+
+  // the full scan picks up what was not journaled and clears the journal
+  gc->enqueue(GCJournalKind::OBJECT, object2->path.get_uuid().to_string());
+  gc->process();
+  EXPECT_EQ(getStoreDataFileCount(), 2);
+  EXPECT_TRUE(journal.get_entries(10).empty());
+
+  // deleting a bucket through the journal removes all its objects
+  deleteTestBucket("test_bucket_1", store->db_conn);
+  gc->enqueue(GCJournalKind::BUCKET, "test_bucket_1");
+  EXPECT_TRUE(gc->process_journal());
+  EXPECT_EQ(getStoreDataFileCount(), 0);
+  EXPECT_FALSE(bucketExists("test_bucket_1", store->db_conn));
+}
+
 TEST_F(TestSFSGC, TestDeletedObjectsAndDeletedBuckets) {
   auto store = new rgw::sal::SFStore(cct.get(), getTestDir());
   auto gc = store->gc;
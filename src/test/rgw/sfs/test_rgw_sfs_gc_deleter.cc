@@ -0,0 +1,109 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rgw/driver/sfs/gc_deleter.h"
+
+using rgw::sal::sfs::GCDataDeletion;
+using rgw::sal::sfs::GCDeleterPool;
+
+namespace {
+
+std::filesystem::path dir_of(const int& item) {
+  return std::filesystem::path(std::to_string(item % 10));
+}
+
+}  // namespace
+
+TEST(TestSFSGCDeleter, deletes_everything) {
+  GCDeleterPool pool(4);
+  std::vector<int> items;
+  for (int i = 0; i < 1000; ++i) {
+    items.push_back(i);
+  }
+  std::mutex lock;
+  std::vector<int> deleted;
+  GCDataDeletion<int> deletion(
+      pool, std::move(items), dir_of,
+      [&](const int& item) {
+        std::lock_guard l(lock);
+        deleted.push_back(item);
+      },
+      [] { return false; }
+  );
+  std::vector<int> remaining;
+  EXPECT_EQ(1000u, deletion.wait(remaining));
+  EXPECT_TRUE(remaining.empty());
+  std::sort(deleted.begin(), deleted.end());
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(i, deleted[i]);
+  }
+}
+
+TEST(TestSFSGCDeleter, directory_is_handled_by_one_thread_in_order) {
+  GCDeleterPool pool(4);
+  std::vector<int> items;
+  for (int i = 0; i < 1000; ++i) {
+    items.push_back(i);
+  }
+  std::mutex lock;
+  std::map<std::string, std::vector<std::pair<std::thread::id, int>>> by_dir;
+  GCDataDeletion<int> deletion(
+      pool, std::move(items), dir_of,
+      [&](const int& item) {
+        std::lock_guard l(lock);
+        by_dir[dir_of(item)].emplace_back(std::this_thread::get_id(), item);
+      },
+      [] { return false; }
+  );
+  std::vector<int> remaining;
+  deletion.wait(remaining);
+  ASSERT_EQ(10u, by_dir.size());
+  for (const auto& [dir, deletions] : by_dir) {
+    ASSERT_EQ(100u, deletions.size());
+    for (size_t i = 1; i < deletions.size(); ++i) {
+      EXPECT_EQ(deletions[0].first, deletions[i].first);
+      EXPECT_LT(deletions[i - 1].second, deletions[i].second);
+    }
+  }
+}
+
+TEST(TestSFSGCDeleter, stops_and_returns_the_rest) {
+  GCDeleterPool pool(4);
+  std::vector<int> items;
+  for (int i = 0; i < 1000; ++i) {
+    items.push_back(i);
+  }
+  std::atomic<int> count{0};
+  GCDataDeletion<int> deletion(
+      pool, std::move(items), dir_of, [&](const int&) { ++count; },
+      [&] { return count >= 100; }
+  );
+  std::vector<int> remaining;
+  const auto deleted = deletion.wait(remaining);
+  EXPECT_EQ(static_cast<size_t>(count.load()), deleted);
+  EXPECT_GE(deleted, 100u);
+  // each thread deletes at most one more item after the stop
+  EXPECT_LE(deleted, 100u + pool.size());
+  EXPECT_EQ(1000u, deleted + remaining.size());
+}
+
+TEST(TestSFSGCDeleter, empty_batch) {
+  GCDeleterPool pool(2);
+  GCDataDeletion<int> deletion(
+      pool, {}, dir_of, [](const int&) { FAIL(); }, [] { return false; }
+  );
+  std::vector<int> remaining;
+  EXPECT_EQ(0u, deletion.wait(remaining));
+  EXPECT_TRUE(remaining.empty());
+}
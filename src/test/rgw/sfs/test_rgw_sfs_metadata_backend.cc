@@ -0,0 +1,550 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/ceph_context.h"
+#include "common/ceph_time.h"
+#include "rgw/driver/sfs/metadata_backend.h"
+#include "rgw/driver/sfs/multipart_types.h"
+#include "rgw/driver/sfs/object_state.h"
+#include "rgw/driver/sfs/sfs_metadata.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/version_type.h"
+
+using namespace rgw::sal::sfs::sqlite;
+using rgw::sal::sfs::MetadataBackend;
+using rgw::sal::sfs::MultipartState;
+using rgw::sal::sfs::ObjectState;
+using rgw::sal::sfs::VersionType;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string USER = "user";
+const static std::string BUCKET = "bucket";
+
+// The same tests run against the SQLite and the RocksDB metadata
+// backends, through the interfaces the rest of the driver uses.
+class TestSFSMetadataBackend : public ::testing::TestWithParam<std::string> {
+ protected:
+  std::shared_ptr<CephContext> cct;
+  DBConnRef conn;
+  std::unique_ptr<MetadataBackend> backend;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_log->start();
+    cct->_conf.set_val("rgw_sfs_metadata_backend", GetParam());
+    conn = std::make_shared<DBConn>(cct.get());
+    open_backend();
+    create_user(USER);
+    create_bucket(BUCKET, USER);
+  }
+
+  void TearDown() override {
+    backend.reset();
+    conn.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  void open_backend() {
+    backend.reset();
+    backend = rgw::sal::sfs::make_metadata_backend(
+        cct.get(), conn, getTestDir()
+    );
+  }
+
+  void create_user(const std::string& id) {
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = id;
+    user.uinfo.display_name = "display " + id;
+    user.uinfo.user_email = id + "@example.com";
+    user.uinfo.access_keys["key-" + id] =
+        RGWAccessKey("key-" + id, "secret-" + id);
+    backend->users().store_user(user);
+  }
+
+  void create_bucket(const std::string& name, const std::string& owner) {
+    DBOPBucketInfo bucket;
+    bucket.binfo.bucket.name = name;
+    bucket.binfo.bucket.bucket_id = name + "-id";
+    bucket.binfo.owner.id = owner;
+    bucket.binfo.creation_time = ceph::real_clock::now();
+    bucket.mtime = bucket.binfo.creation_time;
+    backend->buckets().store_bucket(bucket);
+  }
+
+  static std::string bucket_id() { return BUCKET + "-id"; }
+
+  /// Add a committed version of `size` bytes to object `name`,
+  /// committed `age` ago. Returns its id.
+  uint commit_version(
+      const std::string& name, const std::string& version_id, size_t size,
+      std::chrono::seconds age = std::chrono::seconds(0)
+  ) {
+    const auto& versions = backend->versioned_objects();
+    auto version = versions.create_new_versioned_object_transact(
+        bucket_id(), name, version_id
+    );
+    EXPECT_TRUE(version.has_value());
+    const auto when = ceph::real_clock::now() - age;
+    version->object_state = ObjectState::COMMITTED;
+    version->commit_time = when;
+    version->mtime = when;
+    version->size = size;
+    version->physical_size = size;
+    version->etag = "etag-" + version_id;
+    EXPECT_TRUE(
+        versions.store_versioned_object_if_state(*version, {ObjectState::OPEN})
+    );
+    return version->id;
+  }
+
+  DBMultipart insert_multipart(
+      const std::string& upload_id, const std::string& object_name
+  ) {
+    DBMultipart mp;
+    mp.bucket_id = bucket_id();
+    mp.upload_id = upload_id;
+    mp.state = MultipartState::INIT;
+    mp.state_change_time = ceph::real_clock::now();
+    mp.object_name = object_name;
+    mp.path_uuid.generate_random();
+    mp.meta_str = object_name + "." + upload_id;
+    mp.mtime = ceph::real_clock::now();
+    mp.id = static_cast<int>(backend->multipart().insert(mp));
+    return mp;
+  }
+
+  std::vector<std::string> list_names(const std::string& prefix = "") {
+    std::vector<rgw_bucket_dir_entry> entries;
+    EXPECT_TRUE(
+        backend->list().objects(bucket_id(), prefix, "", 1000, entries)
+    );
+    std::vector<std::string> names;
+    for (const auto& e : entries) {
+      names.push_back(e.key.name);
+    }
+    return names;
+  }
+};
+
+TEST_P(TestSFSMetadataBackend, users_are_found_by_access_key_and_email) {
+  const auto& users = backend->users();
+  create_user("other");
+
+  auto user = users.get_user_by_access_key("key-other");
+  ASSERT_TRUE(user.has_value());
+  EXPECT_EQ(user->uinfo.user_id.id, "other");
+  user = users.get_user_by_email("other@example.com");
+  ASSERT_TRUE(user.has_value());
+  EXPECT_EQ(user->uinfo.display_name, "display other");
+  auto ids = users.get_user_ids();
+  std::ranges::sort(ids);
+  EXPECT_EQ(ids, (std::vector<std::string>{"other", USER}));
+
+  // a new access key replaces the old one
+  user->uinfo.access_keys.clear();
+  user->uinfo.access_keys["new-key"] = RGWAccessKey("new-key", "secret");
+  users.store_user(*user);
+  EXPECT_FALSE(users.get_user_by_access_key("key-other").has_value());
+  EXPECT_TRUE(users.get_user_by_access_key("new-key").has_value());
+
+  users.remove_user("other");
+  EXPECT_FALSE(users.get_user("other").has_value());
+  EXPECT_FALSE(users.get_user_by_access_key("new-key").has_value());
+  EXPECT_FALSE(users.get_user_by_email("other@example.com").has_value());
+}
+
+TEST_P(TestSFSMetadataBackend, buckets_are_found_by_owner_and_name) {
+  const auto& buckets = backend->buckets();
+  create_user("other");
+  create_bucket("other-bucket", "other");
+
+  auto names = buckets.get_bucket_ids();
+  std::ranges::sort(names);
+  EXPECT_EQ(names, (std::vector<std::string>{BUCKET, "other-bucket"}));
+  EXPECT_EQ(
+      buckets.get_bucket_ids("other"),
+      (std::vector<std::string>{"other-bucket"})
+  );
+  const auto found = buckets.get_bucket_by_name("other-bucket");
+  ASSERT_EQ(found.size(), 1U);
+  EXPECT_EQ(found[0].binfo.bucket.bucket_id, "other-bucket-id");
+  const auto owner = buckets.get_owner("other-bucket-id");
+  ASSERT_TRUE(owner.has_value());
+  EXPECT_EQ(owner->first, "other");
+  EXPECT_EQ(owner->second, "display other");
+
+  auto bucket = *buckets.get_bucket("other-bucket-id");
+  bucket.deleted = true;
+  buckets.store_bucket(bucket);
+  EXPECT_EQ(
+      buckets.get_deleted_buckets_ids(),
+      (std::vector<std::string>{"other-bucket-id"})
+  );
+}
+
+TEST_P(TestSFSMetadataBackend, latest_committed_version_wins) {
+  const auto& versions = backend->versioned_objects();
+  commit_version("obj", "v1", 10, std::chrono::seconds(20));
+  const auto v2 = commit_version("obj", "v2", 20, std::chrono::seconds(10));
+  // open versions are not visible
+  versions.create_new_versioned_object_transact(bucket_id(), "obj", "v3");
+
+  auto committed =
+      versions.get_committed_versioned_object(bucket_id(), "obj", "");
+  ASSERT_TRUE(committed.has_value());
+  EXPECT_EQ(committed->id, v2);
+  committed = versions.get_committed_versioned_object(bucket_id(), "obj", "v1");
+  ASSERT_TRUE(committed.has_value());
+  EXPECT_EQ(committed->size, 10U);
+  EXPECT_FALSE(
+      versions.get_committed_versioned_object(bucket_id(), "obj", "v3")
+          .has_value()
+  );
+  const auto by_version_id = versions.get_versioned_object("v2");
+  ASSERT_TRUE(by_version_id.has_value());
+  EXPECT_EQ(by_version_id->id, v2);
+
+  const auto object = backend->objects().get_object(bucket_id(), "obj");
+  ASSERT_TRUE(object.has_value());
+  EXPECT_EQ(versions.get_versioned_objects(object->uuid).size(), 3U);
+
+  // a restart marks open versions deleted
+  EXPECT_EQ(versions.set_all_open_versions_to_deleted(), 1);
+  EXPECT_EQ(versions.count_deleted_versions(), 1);
+}
+
+TEST_P(TestSFSMetadataBackend, gc_removes_deleted_versions_and_objects) {
+  const auto& versions = backend->versioned_objects();
+  const auto v1 = commit_version("obj", "v1", 10, std::chrono::seconds(10));
+  auto latest = *versions.get_versioned_object(
+      commit_version("obj", "v2", 20)
+  );
+  uint num_deleted = 0;
+  const bool stored =
+      versions.store_versioned_object_delete_committed_transact_if_state(
+          latest, {ObjectState::COMMITTED}, &num_deleted
+      );
+  ASSERT_TRUE(stored);
+  EXPECT_EQ(num_deleted, 1U);
+  EXPECT_FALSE(versions.get_versioned_object(v1).has_value());
+  EXPECT_EQ(versions.count_deleted_versions(), 1);
+
+  auto removed = versions.remove_deleted_versions_transact(10);
+  ASSERT_TRUE(removed.has_value());
+  ASSERT_EQ(removed->size(), 1U);
+  EXPECT_EQ(get_version_id(removed->front()), v1);
+  EXPECT_EQ(versions.count_deleted_versions(), 0);
+  EXPECT_TRUE(backend->objects().get_object(bucket_id(), "obj").has_value());
+
+  // once the last regular version goes, so does the object
+  latest.object_state = ObjectState::DELETED;
+  versions.store_versioned_object(latest);
+  removed = versions.remove_deleted_versions_transact(10);
+  ASSERT_TRUE(removed.has_value());
+  EXPECT_EQ(removed->size(), 1U);
+  EXPECT_FALSE(backend->objects().get_object(bucket_id(), "obj").has_value());
+}
+
+TEST_P(TestSFSMetadataBackend, list_objects_by_prefix_and_page) {
+  for (const auto& name : {"a/1", "a/2", "b/1", "c"}) {
+    commit_version(name, "", 1);
+  }
+  EXPECT_EQ(list_names(), (std::vector<std::string>{"a/1", "a/2", "b/1", "c"}));
+  EXPECT_EQ(list_names("a/"), (std::vector<std::string>{"a/1", "a/2"}));
+
+  std::vector<rgw_bucket_dir_entry> entries;
+  bool more = false;
+  ASSERT_TRUE(backend->list().objects(bucket_id(), "", "a/1", 2, entries, &more)
+  );
+  EXPECT_TRUE(more);
+  ASSERT_EQ(entries.size(), 2U);
+  EXPECT_EQ(entries[0].key.name, "a/2");
+  EXPECT_EQ(entries[1].key.name, "b/1");
+  EXPECT_EQ(entries[1].meta.size, 1U);
+  EXPECT_EQ(entries[1].meta.etag, "etag-");
+
+  entries.clear();
+  ASSERT_TRUE(backend->list().objects(bucket_id(), "", "b/1", 2, entries, &more)
+  );
+  EXPECT_FALSE(more);
+  ASSERT_EQ(entries.size(), 1U);
+  EXPECT_EQ(entries[0].key.name, "c");
+}
+
+TEST_P(TestSFSMetadataBackend, delete_markers_hide_objects_from_listings) {
+  const auto& versions = backend->versioned_objects();
+  commit_version("obj", "v1", 10, std::chrono::seconds(10));
+  commit_version("other", "o1", 10, std::chrono::seconds(10));
+  const auto object = backend->objects().get_object(bucket_id(), "obj");
+  ASSERT_TRUE(object.has_value());
+  uint marker_id = 0;
+  ASSERT_TRUE(
+      versions.add_delete_marker_transact(object->uuid, "dm", &marker_id)
+  );
+  EXPECT_NE(marker_id, 0U);
+
+  EXPECT_EQ(list_names(), (std::vector<std::string>{"other"}));
+
+  std::vector<rgw_bucket_dir_entry> entries;
+  ASSERT_TRUE(backend->list().versions(bucket_id(), "", "", 1000, entries));
+  ASSERT_EQ(entries.size(), 3U);
+  EXPECT_EQ(entries[0].key.name, "obj");
+  EXPECT_EQ(entries[0].key.instance, "dm");
+  EXPECT_EQ(
+      entries[0].flags, rgw_bucket_dir_entry::FLAG_VER |
+                            rgw_bucket_dir_entry::FLAG_CURRENT |
+                            rgw_bucket_dir_entry::FLAG_DELETE_MARKER
+  );
+  EXPECT_EQ(entries[1].key.instance, "v1");
+  EXPECT_EQ(entries[1].flags, rgw_bucket_dir_entry::FLAG_VER);
+  EXPECT_EQ(entries[2].key.name, "other");
+  EXPECT_TRUE(entries[2].flags & rgw_bucket_dir_entry::FLAG_CURRENT);
+
+  // removing the delete marker brings the object back
+  const auto previous = versions.delete_version_and_get_previous_transact(
+      object->uuid, marker_id
+  );
+  ASSERT_TRUE(previous.has_value());
+  EXPECT_EQ(previous->version_id, "v1");
+  EXPECT_EQ(list_names(), (std::vector<std::string>{"obj", "other"}));
+}
+
+TEST_P(TestSFSMetadataBackend, list_versions_resumes_after_version) {
+  commit_version("a", "v1", 1, std::chrono::seconds(30));
+  commit_version("a", "v2", 1, std::chrono::seconds(20));
+  commit_version("a", "v3", 1, std::chrono::seconds(10));
+  commit_version("b", "w1", 1);
+
+  std::vector<rgw_bucket_dir_entry> entries;
+  bool more = true;
+  ASSERT_TRUE(
+      backend->list().versions(bucket_id(), "", "a", "v3", 2, entries, &more)
+  );
+  EXPECT_TRUE(more);
+  ASSERT_EQ(entries.size(), 2U);
+  EXPECT_EQ(entries[0].key.instance, "v2");
+  EXPECT_EQ(entries[1].key.instance, "v1");
+
+  entries.clear();
+  ASSERT_TRUE(
+      backend->list().versions(bucket_id(), "", "a", "v1", 2, entries, &more)
+  );
+  EXPECT_FALSE(more);
+  ASSERT_EQ(entries.size(), 1U);
+  EXPECT_EQ(entries[0].key.name, "b");
+}
+
+TEST_P(TestSFSMetadataBackend, parts_manifest_is_replaced_and_ordered) {
+  const auto& versions = backend->versioned_objects();
+  const auto id = commit_version("obj", "", 30);
+  std::vector<DBVersionedObjectPart> parts;
+  for (uint32_t part_num : {3, 1, 2}) {
+    DBVersionedObjectPart part{};
+    part.part_num = part_num;
+    part.part_id = static_cast<int>(part_num);
+    part.offset = (part_num - 1) * 10;
+    part.size = 10;
+    parts.push_back(part);
+  }
+  ASSERT_TRUE(versions.store_parts_manifest(id, parts));
+  auto manifest = versions.get_parts_manifest(id);
+  ASSERT_EQ(manifest.size(), 3U);
+  for (uint32_t i = 0; i < manifest.size(); ++i) {
+    EXPECT_EQ(manifest[i].part_num, i + 1);
+    EXPECT_EQ(manifest[i].versioned_object_id, id);
+  }
+
+  parts.resize(1);
+  ASSERT_TRUE(versions.store_parts_manifest(id, parts));
+  manifest = versions.get_parts_manifest(id);
+  ASSERT_EQ(manifest.size(), 1U);
+  EXPECT_EQ(manifest[0].part_num, 3U);
+}
+
+TEST_P(TestSFSMetadataBackend, multipart_upload_from_init_to_done) {
+  const auto& multipart = backend->multipart();
+  const auto mp = insert_multipart("upload", "obj");
+  ASSERT_TRUE(multipart.get_multipart(mp.id).has_value());
+
+  for (uint32_t part_num = 1; part_num <= 3; ++part_num) {
+    std::string error;
+    ASSERT_TRUE(
+        multipart.create_or_reset_part("upload", part_num, &error).has_value()
+    );
+    ASSERT_TRUE(multipart.finish_part(
+        "upload", part_num, fmt::format("etag-{}", part_num), 10
+    ));
+  }
+  EXPECT_EQ(
+      multipart.get_multipart("upload")->state, MultipartState::INPROGRESS
+  );
+  // finished parts are not finished again
+  EXPECT_FALSE(multipart.finish_part("upload", 1, "etag", 10));
+
+  int next_marker = 0;
+  bool truncated = false;
+  auto parts = multipart.list_parts("upload", 2, 0, &next_marker, &truncated);
+  ASSERT_EQ(parts.size(), 2U);
+  EXPECT_TRUE(truncated);
+  truncated = false;
+  parts = multipart.list_parts(
+      "upload", 2, next_marker, &next_marker, &truncated
+  );
+  ASSERT_EQ(parts.size(), 1U);
+  EXPECT_FALSE(truncated);
+  EXPECT_EQ(parts[0].part_num, 3U);
+  EXPECT_EQ(parts[0].etag, "etag-3");
+
+  bool duplicate = true;
+  EXPECT_TRUE(multipart.mark_complete("upload", &duplicate));
+  EXPECT_FALSE(duplicate);
+  EXPECT_TRUE(multipart.mark_complete("upload", &duplicate));
+  EXPECT_TRUE(duplicate);
+  EXPECT_FALSE(multipart.mark_done("upload"));
+  EXPECT_TRUE(multipart.mark_aggregating("upload"));
+  EXPECT_TRUE(multipart.mark_done("upload"));
+
+  auto removed = multipart.remove_done_or_aborted_multiparts_transact(2);
+  ASSERT_TRUE(removed.has_value());
+  EXPECT_EQ(removed->size(), 2U);
+  EXPECT_TRUE(multipart.get_multipart("upload").has_value());
+  removed = multipart.remove_done_or_aborted_multiparts_transact(2);
+  ASSERT_TRUE(removed.has_value());
+  EXPECT_EQ(removed->size(), 1U);
+  EXPECT_FALSE(multipart.get_multipart("upload").has_value());
+}
+
+TEST_P(TestSFSMetadataBackend, multipart_uploads_list_and_abort) {
+  const auto& multipart = backend->multipart();
+  insert_multipart("u1", "a/1");
+  insert_multipart("u2", "a/2");
+  insert_multipart("u3", "b/1");
+
+  bool truncated = false;
+  auto uploads = multipart.list_multiparts(BUCKET, "a/", "", "", 1, &truncated);
+  ASSERT_TRUE(uploads.has_value());
+  ASSERT_EQ(uploads->size(), 1U);
+  EXPECT_EQ(uploads->front().upload_id, "u1");
+  EXPECT_TRUE(truncated);
+  EXPECT_FALSE(
+      multipart.list_multiparts("missing", "", "", "", 10, &truncated)
+          .has_value()
+  );
+  EXPECT_EQ(multipart.abort_multiparts("missing"), -ERR_NO_SUCH_BUCKET);
+
+  EXPECT_TRUE(multipart.abort("u3"));
+  EXPECT_FALSE(multipart.abort("u3"));
+  EXPECT_EQ(multipart.abort_multiparts(BUCKET), 2);
+  truncated = false;
+  uploads = multipart.list_multiparts(BUCKET, "", "", "", 10, &truncated);
+  ASSERT_TRUE(uploads.has_value());
+  EXPECT_TRUE(uploads->empty());
+  EXPECT_EQ(
+      multipart
+          .list_multiparts_by_bucket_id(
+              bucket_id(), "", "", "", 10, &truncated, true
+          )
+          .size(),
+      3U
+  );
+}
+
+TEST_P(TestSFSMetadataBackend, lifecycle_expires_current_versions) {
+  const auto& versions = backend->versioned_objects();
+  const auto& buckets = backend->buckets();
+  commit_version("logs/old", "", 10, std::chrono::hours(48));
+  commit_version("logs/new", "", 20);
+  commit_version("data/old", "", 30, std::chrono::hours(48));
+
+  auto stats = buckets.get_stats(bucket_id());
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->obj_count, 3U);
+  EXPECT_EQ(stats->size, 60U);
+  EXPECT_FALSE(buckets.bucket_empty(bucket_id()));
+
+  const auto cutoff = ceph::real_clock::now() - std::chrono::hours(24);
+  const auto expired = versions.expire_current_versions_transact(
+      bucket_id(), "logs/", cutoff, 0, 10
+  );
+  ASSERT_EQ(expired.size(), 1U);
+  EXPECT_EQ(list_names(), (std::vector<std::string>{"data/old", "logs/new"}));
+  EXPECT_EQ(versions.count_deleted_versions(), 1);
+  stats = buckets.get_stats(bucket_id());
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->obj_count, 2U);
+  EXPECT_EQ(stats->size, 50U);
+}
+
+TEST_P(TestSFSMetadataBackend, deleted_bucket_is_emptied_and_removed) {
+  const auto& buckets = backend->buckets();
+  commit_version("a", "", 10);
+  commit_version("b", "", 20);
+
+  bool bucket_deleted = true;
+  auto removed = buckets.delete_bucket_transact(bucket_id(), 1, bucket_deleted);
+  ASSERT_TRUE(removed.has_value());
+  EXPECT_EQ(removed->size(), 1U);
+  EXPECT_FALSE(bucket_deleted);
+  // largest first
+  EXPECT_FALSE(backend->objects().get_object(bucket_id(), "b").has_value());
+
+  removed = buckets.delete_bucket_transact(bucket_id(), 10, bucket_deleted);
+  ASSERT_TRUE(removed.has_value());
+  EXPECT_EQ(removed->size(), 1U);
+  EXPECT_TRUE(bucket_deleted);
+  EXPECT_FALSE(buckets.get_bucket(bucket_id()).has_value());
+  EXPECT_TRUE(backend->objects().get_objects(bucket_id()).empty());
+}
+
+TEST_P(TestSFSMetadataBackend, records_survive_reopening) {
+  commit_version("obj", "v1", 10);
+  insert_multipart("upload", "obj");
+  open_backend();
+
+  EXPECT_TRUE(backend->users().get_user(USER).has_value());
+  EXPECT_TRUE(backend->buckets().get_bucket(bucket_id()).has_value());
+  EXPECT_EQ(list_names(), (std::vector<std::string>{"obj"}));
+  EXPECT_TRUE(backend->multipart().get_multipart("upload").has_value());
+  // ids keep counting up
+  const auto id = commit_version("obj", "v2", 10);
+  EXPECT_EQ(
+      backend->versioned_objects()
+          .get_committed_versioned_object(bucket_id(), "obj", "")
+          ->id,
+      id
+  );
+}
+
+TEST_P(TestSFSMetadataBackend, sql_features_follow_the_backend) {
+  EXPECT_EQ(backend->in_sqlite(), GetParam() == "sqlite");
+  EXPECT_EQ(
+      rgw::sal::sfs::metadata_in_sqlite(cct.get()), GetParam() == "sqlite"
+  );
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Backends, TestSFSMetadataBackend, ::testing::Values("sqlite", "rocksdb"),
+    [](const testing::TestParamInfo<TestSFSMetadataBackend::ParamType>& info) {
+      return info.param;
+    }
+);
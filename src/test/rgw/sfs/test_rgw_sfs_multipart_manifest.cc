@@ -0,0 +1,330 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "rgw/driver/sfs/sqlite/buckets/bucket_conversions.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/rgw_compression_types.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+
+/*
+  HINT
+  Creates sqlite and data files in /tmp/rgw_sfs_tests
+*/
+
+using namespace rgw::sal::sfs::sqlite;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_USERNAME = "test_user";
+const static std::string TEST_BUCKET = "test_bucket";
+const static std::string TEST_OBJECT = "test_object";
+// all parts but the last need at least 5 MiB
+const static uint64_t PART_SIZE = 5 * 1024 * 1024;
+
+class CollectDataCB : public RGWGetDataCB {
+ public:
+  bufferlist data;
+
+  int handle_data(bufferlist& bl, off_t ofs, off_t len) override {
+    bufferlist piece;
+    piece.substr_of(bl, ofs, len);
+    data.append(piece);
+    return 0;
+  }
+};
+
+class TestSFSMultipartManifest : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  NoDoutPrefix dpp{cct.get(), 1};
+  const rgw_user owner{"", TEST_USERNAME, ""};
+  const rgw_placement_rule placement;
+  std::unique_ptr<rgw::sal::SFStore> store;
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_conf.set_val("rgw_sfs_multipart_manifest", "true");
+    // one statfs sample only, so that the written bytes stay put
+    cct->_conf.set_val("rgw_sfs_stats_update_interval", "3600000");
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+    store->gc->suspend();
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = TEST_USERNAME;
+    users.store_user(user);
+
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo db_bucket;
+    db_bucket.binfo.bucket.name = TEST_BUCKET;
+    db_bucket.binfo.bucket.bucket_id = TEST_BUCKET;
+    db_bucket.binfo.owner.id = TEST_USERNAME;
+    db_bucket.binfo.creation_time = ceph::real_clock::now();
+    db_bucket.mtime = db_bucket.binfo.creation_time;
+    db_buckets.store_bucket(db_bucket);
+    store->_refresh_buckets();
+
+    auto sal_user = store->get_user(owner);
+    ASSERT_EQ(
+        store->get_bucket(
+            &dpp, sal_user.get(), db_bucket.binfo.bucket, &bucket, null_yield
+        ),
+        0
+    );
+  }
+
+  void TearDown() override {
+    bucket.reset();
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  std::size_t getStoreDataFileCount() const {
+    return std::count_if(
+        fs::recursive_directory_iterator(getTestDir()),
+        fs::recursive_directory_iterator{},
+        [](const fs::path& path) {
+          return fs::is_regular_file(path) &&
+                 !path.filename().string().starts_with(DB_FILENAME);
+        }
+    );
+  }
+
+  /// Wait for the statfs sample taken at startup
+  void waitForFilesystemStats() {
+    for (int i = 0; i < 100; ++i) {
+      if (store->space_ledger->get_available() !=
+          std::numeric_limits<uint64_t>::max()) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    FAIL() << "no filesystem stats sample";
+  }
+
+  int writePart(
+      rgw::sal::MultipartUpload& upload, int part_num, const bufferlist& data,
+      std::optional<uint64_t> orig_size = std::nullopt
+  ) {
+    auto obj = bucket->get_object(rgw_obj_key(TEST_OBJECT));
+    auto writer = upload.get_writer(
+        &dpp, null_yield, obj.get(), owner, &placement, part_num,
+        std::to_string(part_num)
+    );
+    int ret = writer->prepare(null_yield);
+    if (ret < 0) {
+      return ret;
+    }
+    bufferlist bl = data;
+    ret = writer->process(std::move(bl), 0);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = writer->process({}, data.length());
+    if (ret < 0) {
+      return ret;
+    }
+    // compressed parts are written as a single compressed block
+    rgw::sal::Attrs attrs;
+    if (orig_size.has_value()) {
+      RGWCompressionInfo cs_info;
+      cs_info.compression_type = "zlib";
+      cs_info.orig_size = *orig_size;
+      compression_block block;
+      block.old_ofs = 0;
+      block.new_ofs = 0;
+      block.len = data.length();
+      cs_info.blocks.push_back(block);
+      encode(cs_info, attrs[RGW_ATTR_COMPRESSION]);
+    }
+    ceph::real_time mtime;
+    return writer->complete(
+        orig_size.value_or(data.length()), "etag" + std::to_string(part_num),
+        &mtime, ceph::real_time(), attrs, ceph::real_time(), nullptr, nullptr,
+        nullptr, nullptr, nullptr, null_yield
+    );
+  }
+
+  int read(int64_t ofs, int64_t end, bufferlist& out) {
+    auto obj = bucket->get_object(rgw_obj_key(TEST_OBJECT));
+    auto read_op = obj->get_read_op();
+    int ret = read_op->prepare(null_yield, &dpp);
+    if (ret < 0) {
+      return ret;
+    }
+    CollectDataCB cb;
+    ret = read_op->iterate(&dpp, ofs, end, &cb, null_yield);
+    if (ret < 0) {
+      return ret;
+    }
+    out = std::move(cb.data);
+    return 0;
+  }
+
+  std::unique_ptr<rgw::sal::MultipartUpload> initUpload() {
+    ACLOwner acl_owner;
+    acl_owner.set_id(owner);
+    auto upload =
+        bucket->get_multipart_upload(TEST_OBJECT, "test_upload", acl_owner);
+    rgw::sal::Attrs attrs;
+    rgw_placement_rule dest_placement;
+    EXPECT_EQ(
+        upload->init(&dpp, null_yield, acl_owner, dest_placement, attrs), 0
+    );
+    return upload;
+  }
+
+  int complete(
+      rgw::sal::MultipartUpload& upload, int num_parts,
+      uint64_t& accounted_size, bool& compressed, RGWCompressionInfo& cs_info
+  ) {
+    ACLOwner acl_owner;
+    acl_owner.set_id(owner);
+    std::map<int, std::string> part_etags;
+    for (int part_num = 1; part_num <= num_parts; ++part_num) {
+      part_etags[part_num] = "etag" + std::to_string(part_num);
+    }
+    std::list<rgw_obj_index_key> remove_objs;
+    off_t ofs = 0;
+    std::string tag;
+    auto target = bucket->get_object(rgw_obj_key(TEST_OBJECT));
+    return upload.complete(
+        &dpp, null_yield, cct.get(), part_etags, remove_objs, accounted_size,
+        compressed, cs_info, ofs, tag, acl_owner, 0, target.get()
+    );
+  }
+};
+
+TEST_F(TestSFSMultipartManifest, CompleteReadDeleteCollect) {
+  auto upload = initUpload();
+
+  bufferlist part1;
+  part1.append(std::string(PART_SIZE, 'a'));
+  bufferlist part2;
+  part2.append(std::string(1024, 'b'));
+  ASSERT_EQ(writePart(*upload, 1, part1), 0);
+  ASSERT_EQ(writePart(*upload, 2, part2), 0);
+  EXPECT_EQ(getStoreDataFileCount(), 2);
+
+  uint64_t accounted_size = 0;
+  bool compressed = false;
+  RGWCompressionInfo cs_info;
+  ASSERT_EQ(complete(*upload, 2, accounted_size, compressed, cs_info), 0);
+  EXPECT_EQ(accounted_size, PART_SIZE + 1024);
+  EXPECT_FALSE(compressed);
+  // the part files were linked into the object, not copied
+  EXPECT_EQ(getStoreDataFileCount(), 2);
+
+  // a range spanning both parts
+  bufferlist data;
+  ASSERT_EQ(read(PART_SIZE - 10, PART_SIZE + 9, data), 0);
+  EXPECT_EQ(data.to_str(), std::string(10, 'a') + std::string(10, 'b'));
+
+  // the last bytes come from the second part only
+  ASSERT_EQ(read(PART_SIZE + 1000, PART_SIZE + 1023, data), 0);
+  EXPECT_EQ(data.to_str(), std::string(24, 'b'));
+
+  auto obj = bucket->get_object(rgw_obj_key(TEST_OBJECT));
+  ASSERT_EQ(obj->delete_object(&dpp, null_yield, false), 0);
+  EXPECT_EQ(getStoreDataFileCount(), 2);
+
+  store->gc->process();
+  EXPECT_EQ(getStoreDataFileCount(), 0);
+}
+
+TEST_F(TestSFSMultipartManifest, CompressedPartsAreChained) {
+  auto upload = initUpload();
+  bufferlist part1;
+  part1.append(std::string(100, 'a'));
+  bufferlist part2;
+  part2.append(std::string(50, 'b'));
+  ASSERT_EQ(writePart(*upload, 1, part1, PART_SIZE), 0);
+  ASSERT_EQ(writePart(*upload, 2, part2, 1024), 0);
+
+  uint64_t accounted_size = 0;
+  bool compressed = false;
+  RGWCompressionInfo cs_info;
+  ASSERT_EQ(complete(*upload, 2, accounted_size, compressed, cs_info), 0);
+  EXPECT_TRUE(compressed);
+  EXPECT_EQ(accounted_size, PART_SIZE + 1024);
+  EXPECT_EQ(cs_info.compression_type, "zlib");
+  EXPECT_EQ(cs_info.orig_size, PART_SIZE + 1024);
+  // the second part's block follows the first in both address spaces
+  ASSERT_EQ(cs_info.blocks.size(), 2);
+  EXPECT_EQ(cs_info.blocks[0].old_ofs, 0);
+  EXPECT_EQ(cs_info.blocks[0].new_ofs, 0);
+  EXPECT_EQ(cs_info.blocks[0].len, 100);
+  EXPECT_EQ(cs_info.blocks[1].old_ofs, PART_SIZE);
+  EXPECT_EQ(cs_info.blocks[1].new_ofs, 100);
+  EXPECT_EQ(cs_info.blocks[1].len, 50);
+
+  SQLiteVersionedObjects db_versions(store->db_conn);
+  const auto version =
+      db_versions.get_committed_versioned_object(TEST_BUCKET, TEST_OBJECT, "");
+  ASSERT_TRUE(version.has_value());
+  EXPECT_EQ(version->size, PART_SIZE + 1024);
+  EXPECT_EQ(version->physical_size, 150);
+
+  // compressed offsets cross from the first part into the second
+  bufferlist data;
+  ASSERT_EQ(read(90, 109, data), 0);
+  EXPECT_EQ(data.to_str(), std::string(10, 'a') + std::string(10, 'b'));
+}
+
+TEST_F(TestSFSMultipartManifest, CopiedPartsAreAccounted) {
+  cct->_conf.set_val("rgw_sfs_multipart_manifest", "false");
+  ASSERT_NO_FATAL_FAILURE(waitForFilesystemStats());
+  auto upload = initUpload();
+  bufferlist part1;
+  part1.append(std::string(PART_SIZE, 'a'));
+  bufferlist part2;
+  part2.append(std::string(1024, 'b'));
+  ASSERT_EQ(writePart(*upload, 1, part1), 0);
+  ASSERT_EQ(writePart(*upload, 2, part2), 0);
+
+  // the copy is reserved as a whole and counted as written afterwards
+  const uint64_t written = store->space_ledger->get_written();
+  const uint64_t available = store->space_ledger->get_available();
+  uint64_t accounted_size = 0;
+  bool compressed = false;
+  RGWCompressionInfo cs_info;
+  ASSERT_EQ(complete(*upload, 2, accounted_size, compressed, cs_info), 0);
+  EXPECT_EQ(store->space_ledger->get_reserved(), 0);
+  EXPECT_EQ(store->space_ledger->get_written() - written, PART_SIZE + 1024);
+  EXPECT_EQ(available - store->space_ledger->get_available(), PART_SIZE + 1024);
+
+  bufferlist data;
+  ASSERT_EQ(read(PART_SIZE - 10, PART_SIZE + 9, data), 0);
+  EXPECT_EQ(data.to_str(), std::string(10, 'a') + std::string(10, 'b'));
+}
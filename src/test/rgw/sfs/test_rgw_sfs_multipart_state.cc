@@ -0,0 +1,56 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "rgw/driver/sfs/multipart_state.h"
+
+using namespace rgw::sal::sfs;
+
+TEST(TestSFSMultipartUploadStates, SharedBetweenWriters) {
+  MultipartUploadStates states;
+  auto a = states.acquire("upload1");
+  auto b = states.acquire("upload1");
+  ASSERT_EQ(a, b);
+  EXPECT_TRUE(a->is_writable());
+
+  states.set_state("upload1", MultipartState::ABORTED);
+  EXPECT_FALSE(b->is_writable());
+  EXPECT_EQ(MultipartState::ABORTED, a->get_state());
+}
+
+TEST(TestSFSMultipartUploadStates, UntrackedUploadsAreIgnored) {
+  MultipartUploadStates states;
+  states.set_state("nope", MultipartState::ABORTED);
+  EXPECT_EQ(0, states.size());
+
+  // an entry no writer holds anymore is recreated fresh
+  states.acquire("upload1")->set_state(MultipartState::COMPLETE);
+  states.set_state("upload1", MultipartState::ABORTED);
+  EXPECT_TRUE(states.acquire("upload1")->is_writable());
+}
+
+TEST(TestSFSMultipartUploadStates, BucketState) {
+  MultipartUploadStates states;
+  auto a = states.acquire("upload1");
+  auto b = states.acquire("upload2");
+  auto c = states.acquire("upload3");
+  states.set_bucket_id(a, "bucket1");
+  states.set_bucket_id(b, "bucket1");
+  states.set_bucket_id(c, "bucket2");
+
+  states.set_bucket_state("bucket1", MultipartState::ABORTED);
+  EXPECT_FALSE(a->is_writable());
+  EXPECT_FALSE(b->is_writable());
+  EXPECT_TRUE(c->is_writable());
+}
+
+TEST(TestSFSMultipartUploadStates, ExpiredEntriesArePruned) {
+  MultipartUploadStates states;
+  for (int i = 0; i < 1000; ++i) {
+    states.acquire("upload" + std::to_string(i));
+  }
+  EXPECT_LE(states.size(), 130);
+}
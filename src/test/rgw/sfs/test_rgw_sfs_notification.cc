@@ -0,0 +1,320 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "rgw/driver/sfs/sfs_notify.h"
+#include "rgw/driver/sfs/sqlite/buckets/bucket_conversions.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_notifications.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_pubsub.h"
+#include "rgw/rgw_sal_sfs.h"
+#include "rgw/rgw_tag.h"
+
+/*
+  HINT
+  Creates sqlite and data files in /tmp/rgw_sfs_tests
+*/
+
+using namespace rgw::sal::sfs::sqlite;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_USERNAME = "test_user";
+const static std::string TEST_BUCKET = "test_bucket";
+const static std::string TEST_ENDPOINT = "http://localhost:10900";
+
+class TestSFSNotification : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  NoDoutPrefix dpp{cct.get(), 1};
+  const rgw_user owner{"", TEST_USERNAME, ""};
+  const rgw_placement_rule placement;
+  std::unique_ptr<rgw::sal::SFStore> store;
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+  }
+
+  void TearDown() override {
+    bucket.reset();
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  // the sender's worker is not started, tests call send_batch()
+  void openStore() {
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+    store->gc->suspend();
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = TEST_USERNAME;
+    users.store_user(user);
+
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo db_bucket;
+    db_bucket.binfo.bucket.name = TEST_BUCKET;
+    db_bucket.binfo.bucket.bucket_id = TEST_BUCKET;
+    db_bucket.binfo.owner.id = TEST_USERNAME;
+    db_bucket.binfo.creation_time = ceph::real_clock::now();
+    db_bucket.mtime = db_bucket.binfo.creation_time;
+    db_buckets.store_bucket(db_bucket);
+    store->_refresh_buckets();
+
+    auto user = store->get_user(owner);
+    ASSERT_EQ(
+        store->get_bucket(
+            &dpp, user.get(), db_bucket.binfo.bucket, &bucket, null_yield
+        ),
+        0
+    );
+  }
+
+  static rgw_pubsub_topic_filter makeFilter(
+      const std::string& id, rgw::notify::EventType event,
+      const std::string& endpoint = TEST_ENDPOINT
+  ) {
+    rgw_pubsub_topic_filter filter;
+    filter.s3_id = id;
+    filter.events.push_back(event);
+    filter.topic.name = "topic";
+    filter.topic.dest.push_endpoint = endpoint;
+    filter.topic.dest.arn_topic = "topic";
+    filter.topic.opaque_data = "opaque_" + id;
+    return filter;
+  }
+
+  void configure(const std::vector<rgw_pubsub_topic_filter>& filters) {
+    rgw_pubsub_bucket_topics bucket_topics;
+    for (const auto& filter : filters) {
+      bucket_topics.topics[filter.s3_id] = filter;
+    }
+    ASSERT_EQ(
+        bucket->write_topics(bucket_topics, nullptr, null_yield, &dpp), 0
+    );
+  }
+
+  void publish(
+      const std::string& key, rgw::notify::EventType event_type,
+      RGWObjTags* tags = nullptr
+  ) {
+    auto obj = bucket->get_object(rgw_obj_key(key));
+    std::string user_id = TEST_USERNAME;
+    std::string tenant;
+    std::string req_id = "req";
+    auto notification = store->get_notification(
+        &dpp, obj.get(), nullptr, event_type, bucket.get(), user_id, tenant,
+        req_id, null_yield
+    );
+    ASSERT_EQ(notification->publish_reserve(&dpp, tags), 0);
+    ASSERT_EQ(
+        notification->publish_commit(
+            &dpp, 123, ceph::real_clock::now(), "etag", ""
+        ),
+        0
+    );
+  }
+
+  std::vector<rgw_pubsub_s3_event> queued() const {
+    SQLiteNotifications db_notifications(store->db_conn);
+    std::vector<rgw_pubsub_s3_event> events;
+    for (const auto& db_event :
+         db_notifications.get_due_events(ceph::real_clock::now(), 100)) {
+      bufferlist bl;
+      bl.append(db_event.event.data(), db_event.event.size());
+      auto it = bl.cbegin();
+      rgw_pubsub_s3_event event;
+      decode(event, it);
+      events.push_back(event);
+    }
+    return events;
+  }
+
+  void writeObject(const std::string& key, const rgw::sal::Attrs& attrs) {
+    auto obj = bucket->get_object(rgw_obj_key(key));
+    auto writer = store->get_atomic_writer(
+        &dpp, null_yield, obj.get(), owner, &placement, 0, "test"
+    );
+    ASSERT_EQ(writer->prepare(null_yield), 0);
+    bufferlist data;
+    data.append("data");
+    ASSERT_EQ(writer->process(std::move(data), 0), 0);
+    ASSERT_EQ(writer->process({}, 4), 0);
+    ceph::real_time mtime;
+    ASSERT_EQ(
+        writer->complete(
+            4, "etag", &mtime, ceph::real_time(), attrs, ceph::real_time(),
+            nullptr, nullptr, nullptr, nullptr, nullptr, null_yield
+        ),
+        0
+    );
+  }
+};
+
+TEST_F(TestSFSNotification, MatchesEventTypes) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  ASSERT_NO_FATAL_FAILURE(configure(
+      {makeFilter("created", rgw::notify::ObjectCreated),
+       makeFilter("deleted", rgw::notify::ObjectRemovedDelete)}
+  ));
+
+  // ObjectCreated covers all created events
+  ASSERT_NO_FATAL_FAILURE(publish("obj", rgw::notify::ObjectCreatedPut));
+  auto events = queued();
+  ASSERT_EQ(events.size(), 1U);
+  EXPECT_EQ(events[0].configurationId, "created");
+  EXPECT_EQ(events[0].eventName, "ObjectCreated:Put");
+  EXPECT_EQ(events[0].bucket_name, TEST_BUCKET);
+  EXPECT_EQ(events[0].object_key, "obj");
+  EXPECT_EQ(events[0].object_size, 123U);
+  EXPECT_EQ(events[0].object_etag, "etag");
+  EXPECT_EQ(events[0].opaque_data, "opaque_created");
+  EXPECT_EQ(events[0].x_amz_request_id, "req");
+
+  // a delete marker is not a delete
+  ASSERT_NO_FATAL_FAILURE(
+      publish("obj", rgw::notify::ObjectRemovedDeleteMarkerCreated)
+  );
+  EXPECT_EQ(queued().size(), 1U);
+
+  ASSERT_NO_FATAL_FAILURE(publish("obj", rgw::notify::ObjectRemovedDelete));
+  events = queued();
+  ASSERT_EQ(events.size(), 2U);
+  EXPECT_EQ(events[1].configurationId, "deleted");
+  EXPECT_EQ(events[1].eventName, "ObjectRemoved:Delete");
+}
+
+TEST_F(TestSFSNotification, MatchesKeyFilter) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  auto filter = makeFilter("jpg", rgw::notify::ObjectCreated);
+  filter.s3_filter.key_filter.prefix_rule = "photos/";
+  filter.s3_filter.key_filter.suffix_rule = ".jpg";
+  ASSERT_NO_FATAL_FAILURE(configure({filter}));
+
+  ASSERT_NO_FATAL_FAILURE(
+      publish("photos/a.png", rgw::notify::ObjectCreatedPut)
+  );
+  ASSERT_NO_FATAL_FAILURE(publish("docs/a.jpg", rgw::notify::ObjectCreatedPut)
+  );
+  EXPECT_TRUE(queued().empty());
+
+  ASSERT_NO_FATAL_FAILURE(
+      publish("photos/a.jpg", rgw::notify::ObjectCreatedPut)
+  );
+  const auto events = queued();
+  ASSERT_EQ(events.size(), 1U);
+  EXPECT_EQ(events[0].object_key, "photos/a.jpg");
+}
+
+TEST_F(TestSFSNotification, MatchesTagFilter) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  auto filter = makeFilter("red", rgw::notify::ObjectCreated);
+  filter.s3_filter.tag_filter.kv.emplace("color", "red");
+  ASSERT_NO_FATAL_FAILURE(configure({filter}));
+
+  RGWObjTags blue;
+  blue.add_tag("color", "blue");
+  ASSERT_NO_FATAL_FAILURE(
+      publish("obj", rgw::notify::ObjectCreatedPut, &blue)
+  );
+  EXPECT_TRUE(queued().empty());
+
+  RGWObjTags red;
+  red.add_tag("color", "red");
+  red.add_tag("size", "large");
+  ASSERT_NO_FATAL_FAILURE(publish("obj", rgw::notify::ObjectCreatedPut, &red)
+  );
+  EXPECT_EQ(queued().size(), 1U);
+}
+
+TEST_F(TestSFSNotification, MatchesMetadataFilter) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  auto filter = makeFilter("red", rgw::notify::ObjectCreated);
+  filter.s3_filter.metadata_filter.kv.emplace("x-amz-meta-color", "red");
+  ASSERT_NO_FATAL_FAILURE(configure({filter}));
+
+  // metadata comes from the stored object
+  rgw::sal::Attrs blue;
+  blue[RGW_ATTR_META_PREFIX "color"].append("blue");
+  ASSERT_NO_FATAL_FAILURE(writeObject("blue", blue));
+  rgw::sal::Attrs red;
+  red[RGW_ATTR_META_PREFIX "color"].append("red");
+  ASSERT_NO_FATAL_FAILURE(writeObject("red", red));
+
+  ASSERT_NO_FATAL_FAILURE(publish("blue", rgw::notify::ObjectCreatedPut));
+  EXPECT_TRUE(queued().empty());
+  ASSERT_NO_FATAL_FAILURE(publish("red", rgw::notify::ObjectCreatedPut));
+  const auto events = queued();
+  ASSERT_EQ(events.size(), 1U);
+  EXPECT_EQ(events[0].object_key, "red");
+  const auto color = events[0].x_meta_map.find("x-amz-meta-color");
+  ASSERT_NE(color, events[0].x_meta_map.end());
+  EXPECT_EQ(color->second, "red");
+}
+
+TEST_F(TestSFSNotification, TopicWithoutEndpointQueuesNothing) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  ASSERT_NO_FATAL_FAILURE(
+      configure({makeFilter("none", rgw::notify::ObjectCreated, "")})
+  );
+  ASSERT_NO_FATAL_FAILURE(publish("obj", rgw::notify::ObjectCreatedPut));
+  EXPECT_TRUE(queued().empty());
+}
+
+TEST_F(TestSFSNotification, SendBatchDropsUnusableEndpoints) {
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  ASSERT_NO_FATAL_FAILURE(configure(
+      {makeFilter("a", rgw::notify::ObjectCreated, "bogus://a"),
+       makeFilter("b", rgw::notify::ObjectCreated, "bogus://b")}
+  ));
+  ASSERT_NO_FATAL_FAILURE(publish("obj", rgw::notify::ObjectCreatedPut));
+  ASSERT_EQ(queued().size(), 2U);
+
+  // endpoints that cannot be created are not retried
+  EXPECT_EQ(store->notification_sender->send_batch(), 2U);
+  SQLiteNotifications db_notifications(store->db_conn);
+  EXPECT_EQ(db_notifications.count_events(), 0U);
+}
+
+TEST_F(TestSFSNotification, SendBatchPostponesAfterTimeout) {
+  cct->_conf.set_val("rgw_sfs_notification_timeout", "0");
+  ASSERT_NO_FATAL_FAILURE(openStore());
+  ASSERT_NO_FATAL_FAILURE(configure(
+      {makeFilter("a", rgw::notify::ObjectCreated, "bogus://a"),
+       makeFilter("b", rgw::notify::ObjectCreated, "bogus://b")}
+  ));
+  ASSERT_NO_FATAL_FAILURE(publish("obj", rgw::notify::ObjectCreatedPut));
+
+  // nothing is tried, the events stay queued without a counted attempt
+  EXPECT_EQ(store->notification_sender->send_batch(), 2U);
+  SQLiteNotifications db_notifications(store->db_conn);
+  EXPECT_EQ(db_notifications.count_events(), 2U);
+  EXPECT_TRUE(queued().empty());
+  const auto later = ceph::real_clock::now() + std::chrono::hours(1);
+  for (const auto& event : db_notifications.get_due_events(later, 100)) {
+    EXPECT_EQ(event.attempts, 0U);
+  }
+}
@@ -0,0 +1,241 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_object_tags.h"
+#include "rgw/driver/sfs/sqlite/sqlite_objects.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/rgw_lc.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+#include "rgw/rgw_tag.h"
+#include "test/rgw/sfs/rgw_sfs_utils.h"
+
+using namespace rgw::sal::sfs::sqlite;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_BUCKET = "test_bucket";
+
+static void set_tags(
+    rgw::sal::Attrs& attrs,
+    const std::vector<std::pair<std::string, std::string>>& tags
+) {
+  RGWObjTags obj_tags;
+  for (const auto& [key, value] : tags) {
+    obj_tags.add_tag(key, value);
+  }
+  bufferlist bl;
+  obj_tags.encode(bl);
+  attrs[RGW_ATTR_TAGS] = bl;
+}
+
+TEST(TestSFSDecodeObjectTags, decodes_tag_attr) {
+  rgw::sal::Attrs attrs;
+  EXPECT_TRUE(decode_object_tags(attrs).empty());
+  set_tags(attrs, {{"class", "tmp"}, {"owner", "ops"}});
+  const auto tags = decode_object_tags(attrs);
+  ASSERT_EQ(tags.size(), 2U);
+  EXPECT_EQ(tags[0], std::make_pair(std::string("class"), std::string("tmp")));
+  EXPECT_EQ(tags[1], std::make_pair(std::string("owner"), std::string("ops")));
+
+  // garbage is treated as untagged
+  attrs[RGW_ATTR_TAGS].clear();
+  attrs[RGW_ATTR_TAGS].append("garbage");
+  EXPECT_TRUE(decode_object_tags(attrs).empty());
+}
+
+class TestSFSObjectTags : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  std::unique_ptr<rgw::sal::SFStore> store;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = "test_user";
+    users.store_user(user);
+
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo bucket;
+    bucket.binfo.bucket.name = TEST_BUCKET;
+    bucket.binfo.bucket.bucket_id = TEST_BUCKET;
+    bucket.binfo.owner.id = "test_user";
+    db_buckets.store_bucket(bucket);
+  }
+
+  void TearDown() override {
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  DBObject add_object(const std::string& name) {
+    const auto object = create_test_object(TEST_BUCKET, name);
+    SQLiteObjects objects(store->db_conn);
+    objects.store_object(object);
+    return object;
+  }
+
+  DBVersionedObject add_version(
+      const DBObject& object, const std::string& version_id,
+      const std::vector<std::pair<std::string, std::string>>& tags,
+      ceph::real_time mtime = ceph::real_clock::now()
+  ) {
+    auto version = create_test_versionedobject(object.uuid, version_id);
+    version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    version.mtime = mtime;
+    if (!tags.empty()) {
+      set_tags(version.attrs, tags);
+    }
+    SQLiteVersionedObjects versions(store->db_conn);
+    version.id = versions.insert_versioned_object(version);
+    return version;
+  }
+
+  size_t count_tag_rows() {
+    return store->db_conn->get_storage()->count<DBObjectTag>();
+  }
+};
+
+TEST_F(TestSFSObjectTags, index_follows_attrs) {
+  const auto a = add_object("a");
+  const auto b = add_object("b");
+  auto a1 = add_version(a, "a1", {{"class", "tmp"}});
+  add_version(b, "b1", {{"class", "keep"}, {"owner", "ops"}});
+  EXPECT_EQ(count_tag_rows(), 3U);
+
+  SQLiteObjectTags object_tags(store->db_conn);
+  auto matches =
+      object_tags.list_current_objects(TEST_BUCKET, "class", {}, "", 10);
+  ASSERT_EQ(matches.size(), 2U);
+  EXPECT_EQ(matches[0].name, "a");
+  EXPECT_EQ(matches[0].version_id, "a1");
+  EXPECT_EQ(matches[0].value, "tmp");
+  EXPECT_EQ(matches[1].name, "b");
+  EXPECT_EQ(matches[1].value, "keep");
+  matches =
+      object_tags.list_current_objects(TEST_BUCKET, "class", "tmp", "", 10);
+  ASSERT_EQ(matches.size(), 1U);
+  EXPECT_EQ(matches[0].name, "a");
+  matches = object_tags.list_current_objects(TEST_BUCKET, "class", {}, "a", 10);
+  ASSERT_EQ(matches.size(), 1U);
+  EXPECT_EQ(matches[0].name, "b");
+
+  // DeleteObjectTagging rewrites the attrs without the tags
+  SQLiteVersionedObjects versions(store->db_conn);
+  a1.attrs.erase(RGW_ATTR_TAGS);
+  versions.store_versioned_object(a1);
+  EXPECT_EQ(count_tag_rows(), 2U);
+  EXPECT_TRUE(
+      object_tags.list_current_objects(TEST_BUCKET, "class", "tmp", "", 10)
+          .empty()
+  );
+
+  // only the current version of an object counts
+  set_tags(a1.attrs, {{"class", "tmp"}});
+  versions.store_versioned_object(a1);
+  add_version(a, "a2", {});
+  EXPECT_TRUE(
+      object_tags.list_current_objects(TEST_BUCKET, "class", "tmp", "", 10)
+          .empty()
+  );
+
+  // tag rows go away with their version
+  versions.remove_versioned_object(a1.id);
+  EXPECT_EQ(count_tag_rows(), 2U);
+}
+
+TEST_F(TestSFSObjectTags, lifecycle_filters_on_tags) {
+  add_version(
+      add_object("tagged"), "t1", {{"class", "tmp"}, {"owner", "ops"}}
+  );
+  add_version(add_object("partly"), "p1", {{"class", "tmp"}});
+  add_version(add_object("plain"), "x1", {});
+
+  SQLiteVersionedObjects versions(store->db_conn);
+  const auto cutoff = ceph::real_clock::now() + std::chrono::hours(1);
+  auto items = versions.expire_current_versions_transact(
+      TEST_BUCKET, "", cutoff, 0, 10, {{"class", "tmp"}, {"owner", "ops"}}
+  );
+  ASSERT_EQ(items.size(), 1U);
+  EXPECT_EQ(versions.get_versioned_object(items[0].first)->version_id, "t1");
+
+  items = versions.expire_current_versions_transact(
+      TEST_BUCKET, "", cutoff, 0, 10, {{"class", "tmp"}}
+  );
+  ASSERT_EQ(items.size(), 1U);
+  EXPECT_EQ(versions.get_versioned_object(items[0].first)->version_id, "p1");
+
+  // without a tag filter the rest goes
+  items =
+      versions.expire_current_versions_transact(TEST_BUCKET, "", cutoff, 0, 10);
+  ASSERT_EQ(items.size(), 1U);
+  EXPECT_EQ(versions.get_versioned_object(items[0].first)->version_id, "x1");
+}
+
+TEST_F(TestSFSObjectTags, native_lifecycle_expires_tagged_objects) {
+  const auto old = ceph::real_clock::now() - std::chrono::hours(24 * 10);
+  add_version(add_object("tagged"), "t1", {{"class", "tmp"}}, old);
+  add_version(add_object("other"), "o1", {{"class", "keep"}}, old);
+  add_version(add_object("plain"), "x1", {}, old);
+
+  store->_refresh_buckets();
+  NoDoutPrefix dpp(cct.get(), 1);
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+  ASSERT_EQ(
+      store->get_bucket(&dpp, nullptr, "", TEST_BUCKET, &bucket, null_yield),
+      0
+  );
+
+  // a tag filter alone keeps the rule on the native path
+  RGWLifecycleConfiguration config(cct.get());
+  lc_op op("tmp-rule");
+  op.status = true;
+  op.expiration = 1;
+  op.rule_flags = 0;
+  RGWObjTags filter;
+  filter.add_tag("class", "tmp");
+  op.obj_tags = filter;
+  config.get_prefix_map().emplace("", op);
+
+  auto lifecycle = store->get_lifecycle();
+  ASSERT_EQ(
+      lifecycle->expire_bucket(
+          &dpp, bucket.get(), config, [] { return false; }
+      ),
+      0
+  );
+
+  SQLiteVersionedObjects versions(store->db_conn);
+  const auto committed = [&](const std::string& name) {
+    return versions.get_committed_versioned_object(TEST_BUCKET, name, "")
+        .has_value();
+  };
+  EXPECT_FALSE(committed("tagged"));
+  EXPECT_TRUE(committed("other"));
+  EXPECT_TRUE(committed("plain"));
+}
@@ -0,0 +1,219 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_objects.h"
+#include "rgw/driver/sfs/sqlite/sqlite_prefix_stats.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+#include "test/rgw/sfs/rgw_sfs_utils.h"
+
+using namespace rgw::sal::sfs::sqlite;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_BUCKET = "test_bucket";
+
+TEST(TestSFSPrefixAtDepth, cuts_after_delimiter) {
+  EXPECT_EQ(prefix_at_depth("a/b/c", "/", 0), "");
+  EXPECT_EQ(prefix_at_depth("a/b/c", "/", 1), "a/");
+  EXPECT_EQ(prefix_at_depth("a/b/c", "/", 2), "a/b/");
+  EXPECT_EQ(prefix_at_depth("a/b/c", "/", 3), "a/b/");
+  EXPECT_EQ(prefix_at_depth("a/b/", "/", 2), "a/b/");
+  EXPECT_EQ(prefix_at_depth("abc", "/", 2), "");
+  EXPECT_EQ(prefix_at_depth("a--b--c", "--", 1), "a--");
+  EXPECT_EQ(prefix_at_depth("a/b", "", 1), "");
+}
+
+class TestSFSPrefixStats : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  std::unique_ptr<rgw::sal::SFStore> store;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+    open_store(2);
+
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = "test_user";
+    users.store_user(user);
+
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo bucket;
+    bucket.binfo.bucket.name = TEST_BUCKET;
+    bucket.binfo.bucket.bucket_id = TEST_BUCKET;
+    bucket.binfo.owner.id = "test_user";
+    db_buckets.store_bucket(bucket);
+  }
+
+  void TearDown() override {
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  void open_store(uint depth) {
+    store.reset();
+    cct->_conf.set_val("rgw_sfs_prefix_stats_depth", std::to_string(depth));
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+  }
+
+  DBVersionedObject add_version(
+      const std::string& name, uint64_t size,
+      rgw::sal::sfs::ObjectState state = rgw::sal::sfs::ObjectState::COMMITTED
+  ) {
+    const auto object = create_test_object(TEST_BUCKET, name);
+    SQLiteObjects objects(store->db_conn);
+    objects.store_object(object);
+    auto version = create_test_versionedobject(object.uuid, name);
+    version.object_state = state;
+    version.size = size;
+    SQLiteVersionedObjects versions(store->db_conn);
+    version.id = versions.insert_versioned_object(version);
+    return version;
+  }
+
+  DBVersionedObject add_version_of(
+      const DBObject& object, const std::string& version_id, uint64_t size,
+      rgw::sal::sfs::VersionType type = rgw::sal::sfs::VersionType::REGULAR
+  ) {
+    auto version = create_test_versionedobject(object.uuid, version_id);
+    version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    version.version_type = type;
+    version.size = size;
+    SQLiteVersionedObjects versions(store->db_conn);
+    version.id = versions.insert_versioned_object(version);
+    return version;
+  }
+
+  void expect_usage(
+      const std::string& prefix, uint64_t obj_count, uint64_t size
+  ) {
+    const auto usage =
+        SQLitePrefixStats(store->db_conn).get_usage(TEST_BUCKET, prefix);
+    ASSERT_TRUE(usage.has_value());
+    EXPECT_EQ(usage->obj_count, obj_count);
+    EXPECT_EQ(usage->size, size);
+  }
+};
+
+TEST_F(TestSFSPrefixStats, follows_commits_and_deletes) {
+  auto open = add_version("a/b/c/d", 10, rgw::sal::sfs::ObjectState::OPEN);
+  add_version("a/b/x", 20);
+  auto top = add_version("a/y", 30);
+  add_version("z", 40);
+
+  SQLitePrefixStats stats(store->db_conn);
+  auto root = stats.get_usage(TEST_BUCKET, "");
+  ASSERT_TRUE(root.has_value());
+  EXPECT_EQ(root->obj_count, 3U);
+  EXPECT_EQ(root->size, 90U);
+  ASSERT_EQ(root->children.size(), 1U);
+  EXPECT_EQ(root->children[0].prefix, "a/");
+  EXPECT_EQ(root->children[0].obj_count, 2U);
+  EXPECT_EQ(root->children[0].size, 50U);
+
+  // committing the open version counts it, at its depth 2 ancestor
+  SQLiteVersionedObjects versions(store->db_conn);
+  open.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  versions.store_versioned_object(open);
+  auto a = stats.get_usage(TEST_BUCKET, "a/");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(a->obj_count, 3U);
+  EXPECT_EQ(a->size, 60U);
+  ASSERT_EQ(a->children.size(), 1U);
+  EXPECT_EQ(a->children[0].prefix, "a/b/");
+  EXPECT_EQ(a->children[0].obj_count, 2U);
+  EXPECT_EQ(a->children[0].size, 30U);
+
+  top.object_state = rgw::sal::sfs::ObjectState::DELETED;
+  versions.store_versioned_object(top);
+  versions.remove_versioned_object(open.id);
+  a = stats.get_usage(TEST_BUCKET, "a/");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(a->obj_count, 1U);
+  EXPECT_EQ(a->size, 20U);
+
+  // not a directory, or deeper than the configured depth
+  EXPECT_FALSE(stats.get_usage(TEST_BUCKET, "a").has_value());
+  EXPECT_FALSE(stats.get_usage(TEST_BUCKET, "a/b/c/").has_value());
+}
+
+TEST_F(TestSFSPrefixStats, recomputed_when_depth_changes) {
+  add_version("a/b/c", 10);
+  add_version("a/d/e", 20);
+
+  open_store(1);
+  SQLitePrefixStats stats(store->db_conn);
+  auto a = stats.get_usage(TEST_BUCKET, "a/");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(a->obj_count, 2U);
+  EXPECT_TRUE(a->children.empty());
+  EXPECT_FALSE(stats.get_usage(TEST_BUCKET, "a/b/").has_value());
+
+  open_store(0);
+  EXPECT_FALSE(
+      SQLitePrefixStats(store->db_conn).get_usage(TEST_BUCKET, "").has_value()
+  );
+  add_version("a/f/g", 30);
+
+  open_store(2);
+  a = SQLitePrefixStats(store->db_conn).get_usage(TEST_BUCKET, "a/");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(a->obj_count, 3U);
+  EXPECT_EQ(a->size, 60U);
+  EXPECT_EQ(a->children.size(), 3U);
+}
+
+TEST_F(TestSFSPrefixStats, counts_latest_version_only) {
+  SQLiteObjects objects(store->db_conn);
+  const auto x = create_test_object(TEST_BUCKET, "a/x");
+  objects.store_object(x);
+  const auto y = create_test_object(TEST_BUCKET, "a/y");
+  objects.store_object(y);
+
+  // an overwrite replaces the size of the object
+  add_version_of(x, "x1", 10);
+  auto x2 = add_version_of(x, "x2", 20);
+  add_version_of(y, "y1", 5);
+  expect_usage("a/", 2, 25);
+
+  // a delete marker hides the object
+  const auto marker =
+      add_version_of(y, "y2", 0, rgw::sal::sfs::VersionType::DELETE_MARKER);
+  expect_usage("a/", 1, 20);
+
+  // the noncurrent version becomes current again
+  SQLiteVersionedObjects versions(store->db_conn);
+  x2.object_state = rgw::sal::sfs::ObjectState::DELETED;
+  versions.store_versioned_object(x2);
+  expect_usage("a/", 1, 10);
+  versions.remove_versioned_object(marker.id);
+  expect_usage("a/", 2, 15);
+
+  // recomputing agrees with the triggers
+  add_version_of(y, "y3", 0, rgw::sal::sfs::VersionType::DELETE_MARKER);
+  expect_usage("a/", 1, 10);
+  open_store(1);
+  expect_usage("a/", 1, 10);
+}
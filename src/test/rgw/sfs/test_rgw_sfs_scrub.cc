@@ -0,0 +1,191 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/checksum.h"
+#include "rgw/driver/sfs/sfs_scrub.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_objects.h"
+#include "rgw/driver/sfs/sqlite/sqlite_scrub.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
+#include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
+#include "rgw/rgw_perf_counters.h"
+#include "rgw/rgw_sal_sfs.h"
+
+using namespace rgw::sal::sfs::sqlite;
+using rgw::sal::sfs::SFSScrubber;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+const static std::string TEST_USERNAME = "test_user";
+const static std::string TEST_BUCKET = "test_bucket";
+
+class TestSFSScrub : public ::testing::Test {
+ protected:
+  const std::unique_ptr<CephContext> cct =
+      std::unique_ptr<CephContext>(new CephContext(CEPH_ENTITY_TYPE_ANY));
+  std::unique_ptr<rgw::sal::SFStore> store;
+  std::shared_ptr<rgw::sal::sfs::Object> object;
+  uint next_version{1};
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_conf.set_val("rgw_sfs_scrub_bytes_per_sec", "0");
+    cct->_conf.set_val("rgw_sfs_scrub_max_request_latency", "0");
+    cct->_conf.set_val("rgw_sfs_scrub_batch_size", "2");
+    cct->_log->start();
+    rgw_perf_start(cct.get());
+    store = std::make_unique<rgw::sal::SFStore>(cct.get(), getTestDir());
+
+    SQLiteUsers users(store->db_conn);
+    DBOPUserInfo user;
+    user.uinfo.user_id.id = TEST_USERNAME;
+    users.store_user(user);
+
+    SQLiteBuckets db_buckets(store->db_conn);
+    DBOPBucketInfo bucket;
+    bucket.binfo.bucket.name = TEST_BUCKET;
+    bucket.binfo.bucket.bucket_id = TEST_BUCKET;
+    bucket.binfo.owner.id = TEST_USERNAME;
+    db_buckets.store_bucket(bucket);
+
+    object.reset(rgw::sal::sfs::Object::create_for_testing("obj"));
+    SQLiteObjects db_objects(store->db_conn);
+    DBObject db_object;
+    db_object.uuid = object->path.get_uuid();
+    db_object.name = "obj";
+    db_object.bucket_id = TEST_BUCKET;
+    db_objects.store_object(db_object);
+  }
+
+  void TearDown() override {
+    store.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  fs::path versionPath(uint version) {
+    object->version_id = version;
+    return fs::path(getTestDir()) / object->get_storage_path();
+  }
+
+  // Store a committed version holding `data`, recording its size and
+  // crc32c.
+  DBVersionedObject createVersion(const std::string& data) {
+    const uint version = next_version++;
+    const auto path = versionPath(version);
+    fs::create_directories(path.parent_path());
+    std::ofstream ofs(path, std::ofstream::binary);
+    ofs << data;
+    ofs.close();
+
+    ceph::bufferlist bl;
+    bl.append(data);
+    rgw::sal::sfs::Crc32c crc;
+    crc.update(bl);
+
+    SQLiteVersionedObjects db_versions(store->db_conn);
+    DBVersionedObject db_version;
+    db_version.id = version;
+    db_version.object_id = object->path.get_uuid();
+    db_version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    db_version.version_id = std::to_string(version);
+    db_version.size = data.size();
+    db_version.physical_size = data.size();
+    db_version.checksum = rgw::sal::sfs::format_crc32c(crc.value());
+    db_versions.insert_versioned_object(db_version);
+    return db_version;
+  }
+};
+
+TEST_F(TestSFSScrub, scrub_version_detects_damage) {
+  auto& scrubber = *store->scrubber;
+
+  const auto ok = createVersion("some object data");
+  EXPECT_EQ(SFSScrubber::Result::OK, scrubber.scrub_version(ok));
+
+  const auto missing = createVersion("some object data");
+  fs::remove(versionPath(missing.id));
+  EXPECT_EQ(SFSScrubber::Result::MISSING, scrubber.scrub_version(missing));
+
+  const auto truncated = createVersion("some object data");
+  fs::resize_file(versionPath(truncated.id), 4);
+  EXPECT_EQ(
+      SFSScrubber::Result::SIZE_MISMATCH, scrubber.scrub_version(truncated)
+  );
+
+  const auto corrupted = createVersion("some object data");
+  {
+    std::fstream file(
+        versionPath(corrupted.id),
+        std::ios::binary | std::ios::in | std::ios::out
+    );
+    file.seekp(0);
+    file << 'S';
+  }
+  EXPECT_EQ(
+      SFSScrubber::Result::CHECKSUM_MISMATCH,
+      scrubber.scrub_version(corrupted)
+  );
+
+  // versions without a checksum only get the size check
+  auto unknown = createVersion("some object data");
+  unknown.checksum.clear();
+  EXPECT_EQ(SFSScrubber::Result::OK, scrubber.scrub_version(unknown));
+}
+
+TEST_F(TestSFSScrub, pass_persists_cursor_and_reports_findings) {
+  auto& scrubber = *store->scrubber;
+  createVersion("one");
+  const auto missing = createVersion("two");
+  createVersion("three");
+  fs::remove(versionPath(missing.id));
+
+  const SQLiteScrub db_scrub(store->db_conn);
+  const auto missing_before = perfcounter->get(l_rgw_sfs_scrub_missing);
+  const auto passes_before = perfcounter->get(l_rgw_sfs_scrub_passes);
+
+  // batch size is 2
+  EXPECT_TRUE(scrubber.scrub_batch());
+  EXPECT_EQ(2u, db_scrub.get_state().last_version_id);
+  EXPECT_TRUE(scrubber.scrub_batch());
+  EXPECT_EQ(3u, db_scrub.get_state().last_version_id);
+  EXPECT_FALSE(scrubber.scrub_batch());
+  const auto state = db_scrub.get_state();
+  EXPECT_EQ(0u, state.last_version_id);
+  EXPECT_NE(ceph::real_time(), state.last_pass_end);
+
+  EXPECT_EQ(missing_before + 1, perfcounter->get(l_rgw_sfs_scrub_missing));
+  EXPECT_EQ(passes_before + 1, perfcounter->get(l_rgw_sfs_scrub_passes));
+  const auto status = scrubber.get_status();
+  ASSERT_EQ(1u, status.findings.size());
+  EXPECT_EQ(missing.id, status.findings.front().version_id);
+  EXPECT_EQ(SFSScrubber::Result::MISSING, status.findings.front().result);
+}
+
+TEST_F(TestSFSScrub, deleted_versions_are_not_reported) {
+  auto& scrubber = *store->scrubber;
+  auto version = createVersion("data");
+  fs::remove(versionPath(version.id));
+  version.object_state = rgw::sal::sfs::ObjectState::DELETED;
+  SQLiteVersionedObjects db_versions(store->db_conn);
+  db_versions.store_versioned_object(version);
+
+  EXPECT_FALSE(scrubber.scrub_batch());
+  EXPECT_TRUE(scrubber.get_status().findings.empty());
+}
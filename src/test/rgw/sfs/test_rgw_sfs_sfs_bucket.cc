@@ -1322,6 +1322,117 @@ TEST_F(TestSFSBucket, TestListObjectVersionsDelimiter) {
   );
 }
 
+TEST_F(TestSFSBucket, TestListObjectVersionsMarkerWithDelimiter) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+  auto store = std::make_unique<rgw::sal::SFStore>(
+      ceph_context.get(), getTestDir()
+  );
+  NoDoutPrefix ndp(ceph_context.get(), 1);
+
+  createUser("test_user", store->db_conn);
+  createTestBucket("test_bucket", "test_user", store->db_conn, true);
+  // versions of an object list newest (highest id) first
+  auto file = createTestObject("test_bucket", "directory/file", store->db_conn);
+  createTestObjectVersion(file, 1, store->db_conn);
+  createTestObjectVersion(file, 2, store->db_conn);
+  createTestObjectVersion(file, 3, store->db_conn);
+  auto other =
+      createTestObject("test_bucket", "directory/other", store->db_conn);
+  createTestObjectVersion(other, 4, store->db_conn);
+  auto sub =
+      createTestObject("test_bucket", "directory/sub/file", store->db_conn);
+  createTestObjectVersion(sub, 5, store->db_conn);
+  store->_refresh_buckets();
+
+  rgw_user arg_user("", "test_user", "");
+  auto user = store->get_user(arg_user);
+  RGWBucketInfo arg_info = get_binfo();
+  arg_info.bucket.name = "test_bucket_name";
+  arg_info.bucket.bucket_id = "test_bucket";
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+  ASSERT_EQ(
+      store->get_bucket(&ndp, user.get(), arg_info.bucket, &bucket, null_yield),
+      0
+  );
+
+  // resuming inside directory/file, the delimiter in the prefix doesn't
+  // make the marker a common prefix to skip
+  rgw::sal::Bucket::ListParams params;
+  params.prefix = "directory/";
+  params.delim = "/";
+  params.list_versions = true;
+  params.marker = rgw_obj_key("directory/file", "3");
+  rgw::sal::Bucket::ListResults results;
+  ASSERT_EQ(bucket->list(&ndp, params, 1000, results, null_yield), 0);
+  ASSERT_EQ(results.objs.size(), 3);
+  EXPECT_EQ(results.objs[0].key, rgw_obj_key("directory/file", "2"));
+  EXPECT_EQ(results.objs[1].key, rgw_obj_key("directory/file", "1"));
+  EXPECT_EQ(results.objs[2].key, rgw_obj_key("directory/other", "4"));
+  ASSERT_EQ(results.common_prefixes.size(), 1);
+  EXPECT_EQ(results.common_prefixes.begin()->first, "directory/sub/");
+  EXPECT_FALSE(results.is_truncated);
+}
+
+TEST_F(TestSFSBucket, TestListObjectsEntryCallback) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+  auto store = std::make_unique<rgw::sal::SFStore>(
+      ceph_context.get(), getTestDir()
+  );
+  NoDoutPrefix ndp(ceph_context.get(), 1);
+
+  createUser("test_user", store->db_conn);
+  createTestBucket("test_bucket", "test_user", store->db_conn);
+  uint version_id = 1;
+  for (const auto& name : {"c", "a", "dir/x", "b"}) {
+    auto object = createTestObject("test_bucket", name, store->db_conn);
+    createTestObjectVersion(object, version_id++, store->db_conn);
+  }
+  store->_refresh_buckets();
+
+  rgw_user arg_user("", "test_user", "");
+  auto user = store->get_user(arg_user);
+  RGWBucketInfo arg_info = get_binfo();
+  arg_info.bucket.name = "test_bucket_name";
+  arg_info.bucket.bucket_id = "test_bucket";
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+  ASSERT_EQ(
+      store->get_bucket(&ndp, user.get(), arg_info.bucket, &bucket, null_yield),
+      0
+  );
+
+  // entries go to the callback in order, not to results.objs, and the
+  // next marker still points after the last one
+  std::vector<rgw_bucket_dir_entry> entries;
+  rgw::sal::Bucket::ListParams params;
+  params.delim = "/";
+  params.entry_cb = [&](rgw_bucket_dir_entry&& e) {
+    EXPECT_EQ(e.meta.owner, "test_user");
+    entries.emplace_back(std::move(e));
+  };
+  rgw::sal::Bucket::ListResults results;
+  ASSERT_EQ(bucket->list(&ndp, params, 3, results, null_yield), 0);
+  EXPECT_TRUE(results.objs.empty());
+  ASSERT_EQ(entries.size(), 3);
+  EXPECT_EQ(entries[0].key.name, "a");
+  EXPECT_EQ(entries[1].key.name, "b");
+  EXPECT_EQ(entries[2].key.name, "c");
+  EXPECT_TRUE(results.is_truncated);
+  EXPECT_EQ(results.next_marker, rgw_obj_key("c"));
+
+  entries.clear();
+  params.marker = results.next_marker;
+  results = {};
+  ASSERT_EQ(bucket->list(&ndp, params, 3, results, null_yield), 0);
+  EXPECT_TRUE(entries.empty());
+  ASSERT_EQ(results.common_prefixes.size(), 1);
+  EXPECT_EQ(results.common_prefixes.begin()->first, "dir/");
+  EXPECT_FALSE(results.is_truncated);
+}
+
 TEST_F(TestSFSBucket, UserCreateBucketObjectLockEnabled) {
   auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
   ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
@@ -1488,3 +1599,133 @@ TEST_F(TestSFSBucket, ListNamespaceMultipartsBasics) {
   EXPECT_EQ(results.objs[0].key.name, std::to_string(id));
   EXPECT_EQ(results.objs[0].meta.mtime, now);
 }
+
+TEST_F(TestSFSBucket, DeleteObjectsVersioned) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+  auto store = new rgw::sal::SFStore(ceph_context.get(), getTestDir());
+  NoDoutPrefix ndp(ceph_context.get(), 1);
+
+  createUser("test_user", store->db_conn);
+  createTestBucket("test_bucket", "test_user", store->db_conn, true);
+  uint version_id = 1;
+  auto object1 = createTestObject("test_bucket", "obj1", store->db_conn);
+  createTestObjectVersion(object1, version_id++, store->db_conn);
+  createTestObjectVersion(object1, version_id++, store->db_conn);
+  auto object2 = createTestObject("test_bucket", "obj2", store->db_conn);
+  createTestObjectVersion(object2, version_id++, store->db_conn);
+  createTestObjectVersion(object2, version_id++, store->db_conn);
+  store->_refresh_buckets();
+
+  rgw_user arg_user("", "test_user", "");
+  auto user = store->get_user(arg_user);
+  RGWBucketInfo arg_info = get_binfo();
+  arg_info.bucket.name = "test_bucket_name";
+  arg_info.bucket.bucket_id = "test_bucket";
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+  ASSERT_EQ(
+      store->get_bucket(&ndp, user.get(), arg_info.bucket, &bucket, null_yield),
+      0
+  );
+  ASSERT_TRUE(bucket->supports_delete_objects());
+
+  std::vector<rgw::sal::Bucket::DeleteObjectsEntry> entries(4);
+  entries[0].key = rgw_obj_key("obj1");
+  entries[1].key = rgw_obj_key("obj2", "3");
+  entries[2].key = rgw_obj_key("missing");
+  entries[3].key = rgw_obj_key("obj1");
+  ASSERT_EQ(bucket->delete_objects(&ndp, entries, null_yield), 0);
+
+  SQLiteVersionedObjects db_versioned_objects(store->db_conn);
+  // a delete marker on top of obj1, once: it is already deleted the
+  // second time around
+  EXPECT_EQ(entries[0].result, 0);
+  EXPECT_TRUE(entries[0].delete_marker);
+  ASSERT_FALSE(entries[0].version_id.empty());
+  auto marker =
+      db_versioned_objects.get_versioned_object(entries[0].version_id);
+  ASSERT_TRUE(marker.has_value());
+  EXPECT_EQ(marker->object_id, object1->path.get_uuid());
+  EXPECT_EQ(marker->version_type, rgw::sal::sfs::VersionType::DELETE_MARKER);
+  EXPECT_TRUE(entries[3].delete_marker);
+  EXPECT_TRUE(entries[3].version_id.empty());
+  EXPECT_EQ(
+      db_versioned_objects.get_versioned_object_ids(object1->path.get_uuid())
+          .size(),
+      3u
+  );
+
+  // a specific version is deleted for the garbage collector
+  EXPECT_EQ(entries[1].version_id, "3");
+  EXPECT_FALSE(db_versioned_objects.get_versioned_object(3).has_value());
+  auto deleted = db_versioned_objects.get_versioned_object(3, false);
+  ASSERT_TRUE(deleted.has_value());
+  EXPECT_EQ(deleted->object_state, rgw::sal::sfs::ObjectState::DELETED);
+  EXPECT_TRUE(db_versioned_objects.get_versioned_object(4).has_value());
+
+  // a key that doesn't exist gets an object holding a delete marker
+  ASSERT_FALSE(entries[2].version_id.empty());
+  auto missing = db_versioned_objects.get_committed_versioned_object(
+      "test_bucket", "missing", entries[2].version_id
+  );
+  ASSERT_TRUE(missing.has_value());
+  EXPECT_EQ(missing->version_type, rgw::sal::sfs::VersionType::DELETE_MARKER);
+
+  // deleting the delete marker by version id brings obj1 back
+  std::vector<rgw::sal::Bucket::DeleteObjectsEntry> undelete(1);
+  undelete[0].key = rgw_obj_key("obj1", entries[0].version_id);
+  ASSERT_EQ(bucket->delete_objects(&ndp, undelete, null_yield), 0);
+  EXPECT_FALSE(db_versioned_objects.get_versioned_object(entries[0].version_id)
+                   .has_value());
+  EXPECT_EQ(
+      db_versioned_objects.get_versioned_object_ids(object1->path.get_uuid())
+          .size(),
+      2u
+  );
+}
+
+TEST_F(TestSFSBucket, DeleteObjectsNonVersioned) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+  auto store = new rgw::sal::SFStore(ceph_context.get(), getTestDir());
+  NoDoutPrefix ndp(ceph_context.get(), 1);
+
+  createUser("test_user", store->db_conn);
+  createTestBucket("test_bucket", "test_user", store->db_conn);
+  auto object1 = createTestObject("test_bucket", "obj1", store->db_conn);
+  createTestObjectVersion(object1, 1, store->db_conn);
+  auto object2 = createTestObject("test_bucket", "obj2", store->db_conn);
+  createTestObjectVersion(object2, 2, store->db_conn);
+  store->_refresh_buckets();
+
+  rgw_user arg_user("", "test_user", "");
+  auto user = store->get_user(arg_user);
+  RGWBucketInfo arg_info = get_binfo();
+  arg_info.bucket.name = "test_bucket_name";
+  arg_info.bucket.bucket_id = "test_bucket";
+  std::unique_ptr<rgw::sal::Bucket> bucket;
+  ASSERT_EQ(
+      store->get_bucket(&ndp, user.get(), arg_info.bucket, &bucket, null_yield),
+      0
+  );
+
+  std::vector<rgw::sal::Bucket::DeleteObjectsEntry> entries(3);
+  entries[0].key = rgw_obj_key("obj1");
+  entries[1].key = rgw_obj_key("obj1");
+  entries[2].key = rgw_obj_key("missing");
+  ASSERT_EQ(bucket->delete_objects(&ndp, entries, null_yield), 0);
+  for (const auto& entry : entries) {
+    EXPECT_EQ(entry.result, 0);
+    EXPECT_FALSE(entry.delete_marker);
+    EXPECT_TRUE(entry.version_id.empty());
+  }
+
+  SQLiteVersionedObjects db_versioned_objects(store->db_conn);
+  EXPECT_FALSE(db_versioned_objects.get_versioned_object(1).has_value());
+  EXPECT_TRUE(db_versioned_objects.get_versioned_object(2).has_value());
+  EXPECT_FALSE(db_versioned_objects
+                   .get_committed_versioned_object("test_bucket", "missing", "")
+                   .has_value());
+}
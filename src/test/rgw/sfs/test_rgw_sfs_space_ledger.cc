@@ -0,0 +1,78 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <utility>
+
+#include "rgw/driver/sfs/space_ledger.h"
+
+using namespace rgw::sal::sfs;
+
+TEST(TestSFSSpaceLedger, ReservationsShareAvailableSpace) {
+  SpaceLedger ledger(100, 10);
+  ledger.update(1000, 0);
+
+  SpaceReservation a(ledger);
+  SpaceReservation b(ledger);
+  EXPECT_TRUE(a.reserve(500));
+  // only 400 left above the minimum
+  EXPECT_FALSE(b.reserve(500));
+  EXPECT_TRUE(b.reserve(400));
+  EXPECT_EQ(100, ledger.get_available());
+
+  a.release();
+  EXPECT_TRUE(b.reserve(900));
+  EXPECT_FALSE(b.reserve(901));
+  EXPECT_EQ(900, ledger.get_reserved());
+}
+
+TEST(TestSFSSpaceLedger, ExtendGrowsInChunks) {
+  SpaceLedger ledger(0, 64);
+  ledger.update(100, 0);
+
+  SpaceReservation r(ledger);
+  EXPECT_TRUE(r.extend(1));
+  EXPECT_EQ(64, r.get_bytes());
+  EXPECT_TRUE(r.extend(64));
+  EXPECT_EQ(64, r.get_bytes());
+  // a full chunk doesn't fit anymore, the write itself does
+  EXPECT_TRUE(r.extend(90));
+  EXPECT_EQ(90, r.get_bytes());
+  EXPECT_FALSE(r.extend(101));
+}
+
+TEST(TestSFSSpaceLedger, ReleasedOnDestruction) {
+  SpaceLedger ledger(0, 1);
+  ledger.update(100, 0);
+  {
+    SpaceReservation r(ledger);
+    EXPECT_TRUE(r.reserve(60));
+    SpaceReservation moved(std::move(r));
+    EXPECT_EQ(0, r.get_bytes());
+    EXPECT_EQ(60, ledger.get_reserved());
+  }
+  EXPECT_EQ(0, ledger.get_reserved());
+  EXPECT_EQ(100, ledger.get_available());
+}
+
+TEST(TestSFSSpaceLedger, CommittedUntilNextSample) {
+  SpaceLedger ledger(0, 1);
+  ledger.update(100, 0);
+
+  SpaceReservation r(ledger);
+  EXPECT_TRUE(r.reserve(50));
+  r.commit(30);
+  EXPECT_EQ(0, ledger.get_reserved());
+  EXPECT_EQ(30, ledger.get_written());
+  EXPECT_EQ(70, ledger.get_available());
+
+  // written before the sample is part of it, later writes aren't
+  const auto written = ledger.get_written();
+  SpaceReservation late(ledger);
+  EXPECT_TRUE(late.reserve(10));
+  late.commit(10);
+  ledger.update(70, written);
+  EXPECT_EQ(10, ledger.get_written());
+  EXPECT_EQ(60, ledger.get_available());
+}
@@ -673,3 +673,41 @@ TEST_F(TestSFSSQLiteBuckets, TestBucketEmpty) {
   // now bucket should be empty (all versions are deleted)
   EXPECT_TRUE(db_buckets->bucket_empty("bucket1_id"));
 }
+
+TEST_F(TestSFSSQLiteBuckets, TestBucketStatsPhysicalSize) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+
+  DBConnRef conn = std::make_shared<DBConn>(ceph_context.get());
+  createUser("usertest", conn);
+  createDBBucketBasic("usertest", "bucket1", "bucket1_id", conn);
+
+  auto db_buckets = std::make_shared<SQLiteBuckets>(conn);
+  auto db_versions = std::make_shared<SQLiteVersionedObjects>(conn);
+
+  // a compressed and an uncompressed object
+  auto version1 = db_versions->create_new_versioned_object_transact(
+      "bucket1_id", "object_1", "version1"
+  );
+  ASSERT_TRUE(version1.has_value());
+  version1->object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  version1->size = 1000;
+  version1->physical_size = 100;
+  db_versions->store_versioned_object(*version1);
+
+  auto version2 = db_versions->create_new_versioned_object_transact(
+      "bucket1_id", "object_2", "version2"
+  );
+  ASSERT_TRUE(version2.has_value());
+  version2->object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  version2->size = 10;
+  version2->physical_size = 10;
+  db_versions->store_versioned_object(*version2);
+
+  auto stats = db_buckets->get_stats("bucket1_id");
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(2, stats->obj_count);
+  EXPECT_EQ(1010, stats->size);
+  EXPECT_EQ(110, stats->physical_size);
+}
@@ -16,7 +16,10 @@
 #include <filesystem>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "common/ceph_context.h"
 #include "common/ceph_time.h"
@@ -27,6 +30,7 @@
 #include "driver/sfs/version_type.h"
 #include "gtest/gtest.h"
 #include "rgw/driver/sfs/sqlite/sqlite_list.h"
+#include "rgw/driver/sfs/sqlite/sqlite_users.h"
 #include "rgw/rgw_perf_counters.h"
 #include "test/rgw/sfs/rgw_sfs_utils.h"
 
@@ -542,6 +546,86 @@ TEST_F(TestSFSList, versions__delete_marker_is_not_latest) {
   EXPECT_FALSE(results[2].is_current());
 }
 
+TEST_F(TestSFSList, versions__version_id_marker_resumes_within_object) {
+  const auto uut = make_uut();
+  SQLiteObjects os(store->db_conn);
+  SQLiteVersionedObjects vos(store->db_conn);
+  for (const auto& name : {"a", "b"}) {
+    const auto obj = create_test_object("testbucket", name);
+    os.store_object(obj);
+    for (int i = 0; i < 3; i++) {
+      auto vo = create_test_versionedobject(
+          obj.uuid, std::string(name) + "-" + std::to_string(i)
+      );
+      vo.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+      // two versions share a commit time, the id breaks the tie
+      vo.commit_time = ceph::real_time(std::chrono::seconds(i == 2 ? 1 : i));
+      vos.insert_versioned_object(vo);
+    }
+  }
+
+  std::vector<rgw_bucket_dir_entry> all;
+  ASSERT_TRUE(uut.versions("testbucket", "", "", 1000, all));
+  ASSERT_EQ(all.size(), 6);
+
+  std::vector<rgw_bucket_dir_entry> paged;
+  std::string marker_name;
+  std::string marker_version;
+  bool more = true;
+  while (more) {
+    std::vector<rgw_bucket_dir_entry> page;
+    ASSERT_TRUE(uut.versions(
+        "testbucket", "", marker_name, marker_version, 2, page, &more
+    ));
+    ASSERT_LE(page.size(), 2);
+    ASSERT_FALSE(page.empty());
+    marker_name = page.back().key.name;
+    marker_version = page.back().key.instance;
+    paged.insert(paged.end(), page.begin(), page.end());
+  }
+  ASSERT_EQ(paged.size(), all.size());
+  for (size_t i = 0; i < all.size(); i++) {
+    EXPECT_EQ(paged[i].key.name, all[i].key.name);
+    EXPECT_EQ(paged[i].key.instance, all[i].key.instance);
+    EXPECT_EQ(paged[i].is_current(), all[i].is_current());
+  }
+
+  // an unknown version id continues after the marker name
+  std::vector<rgw_bucket_dir_entry> results;
+  ASSERT_TRUE(uut.versions("testbucket", "", "a", "nonexistent", 10, results));
+  ASSERT_EQ(results.size(), 3);
+  EXPECT_EQ(results[0].key.name, "b");
+}
+
+TEST_F(TestSFSList, versions__null_version_id_marker) {
+  const auto uut = make_uut();
+  SQLiteObjects os(store->db_conn);
+  SQLiteVersionedObjects vos(store->db_conn);
+  const auto a = create_test_object("testbucket", "a");
+  os.store_object(a);
+  // the middle version has no version id, listings show it as "null"
+  for (const auto& [version_id, commit] :
+       std::vector<std::pair<std::string, int>>{
+           {"a-0", 0}, {"", 1}, {"a-2", 2}}) {
+    auto vo = create_test_versionedobject(a.uuid, version_id);
+    vo.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    vo.commit_time = ceph::real_time(std::chrono::seconds(commit));
+    vos.insert_versioned_object(vo);
+  }
+  const auto b = create_test_object("testbucket", "b");
+  os.store_object(b);
+  auto vo = create_test_versionedobject(b.uuid, "b-0");
+  vo.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  vos.insert_versioned_object(vo);
+
+  std::vector<rgw_bucket_dir_entry> results;
+  ASSERT_TRUE(uut.versions("testbucket", "", "a", "null", 10, results));
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].key.name, "a");
+  EXPECT_EQ(results[0].key.instance, "a-0");
+  EXPECT_EQ(results[1].key.name, "b");
+}
+
 TEST_F(TestSFSList, roll_up_example) {
   // https://docs.aws.amazon.com/AmazonS3/latest/userguide/using-prefixes.html
   const auto uut = make_uut();
@@ -709,3 +793,40 @@ TEST_F(TestSFSList, roll_up_delim_must_follow_prefix) {
   EXPECT_EQ(out[0].key.name, "prefix");
   EXPECT_EQ(out[1].key.name, "prefixSOMETHING");
 }
+
+TEST_F(TestSFSList, objects_visitor_with_rollup_streams_in_order) {
+  const auto uut = make_uut();
+  for (const auto& name : {"a/1", "a/2", "b", "c/1", "d"}) {
+    const auto obj = create_test_object("testbucket", name);
+    SQLiteObjects os(store->db_conn);
+    os.store_object(obj);
+    auto ver = create_test_versionedobject(obj.uuid, "v");
+    ver.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    SQLiteVersionedObjects vos(store->db_conn);
+    vos.insert_versioned_object(ver);
+  }
+
+  const std::string prefix;
+  const std::string delimiter("/");
+  std::map<std::string, bool> prefixes;
+  CommonPrefixRollup rollup(prefix, delimiter, prefixes);
+  std::vector<std::string> names;
+  bool more = true;
+  ASSERT_TRUE(uut.objects(
+      "testbucket", "", "", 4,
+      [&](rgw_bucket_dir_entry&& e) {
+        if (rollup.add(e)) {
+          names.emplace_back(std::move(e.key.name));
+        }
+      },
+      &more
+  ));
+  EXPECT_TRUE(more);
+  EXPECT_THAT(names, ::testing::ElementsAre("b"));
+  EXPECT_THAT(
+      prefixes, ::testing::ElementsAre(
+                    ::testing::Pair("a/", true), ::testing::Pair("c/", true)
+                )
+  );
+  EXPECT_EQ(rollup.get_next_marker(), "c/");
+}
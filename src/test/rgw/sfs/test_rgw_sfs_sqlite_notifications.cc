@@ -0,0 +1,151 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/notification.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/sqlite/sqlite_notifications.h"
+#include "rgw/rgw_pubsub.h"
+
+using namespace rgw::sal::sfs::sqlite;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+
+class TestSFSSQLiteNotifications : public ::testing::Test {
+ protected:
+  std::shared_ptr<CephContext> cct;
+  DBConnRef conn;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_log->start();
+    conn = std::make_shared<DBConn>(cct.get());
+  }
+
+  void TearDown() override {
+    conn.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  static DBNotificationEvent make_event(
+      const std::string& endpoint, const ceph::real_time& when
+  ) {
+    DBNotificationEvent event;
+    event.id = 0;
+    event.push_endpoint = endpoint;
+    event.arn_topic = "topic";
+    event.event = {'e', 'v'};
+    event.enqueue_time = when;
+    event.next_attempt = when;
+    event.attempts = 0;
+    return event;
+  }
+};
+
+TEST_F(TestSFSSQLiteNotifications, topics_are_versioned) {
+  SQLiteNotifications db(conn);
+  EXPECT_FALSE(db.get_topics("tenant").has_value());
+
+  // nothing stored yet, so only version 0 is expected
+  EXPECT_EQ(db.store_topics("tenant", {'a'}, 1U), 0U);
+  EXPECT_EQ(db.store_topics("tenant", {'a'}, 0U), 1U);
+  EXPECT_EQ(db.store_topics("tenant", {'b'}, std::nullopt), 2U);
+  // stale version
+  EXPECT_EQ(db.store_topics("tenant", {'c'}, 1U), 0U);
+
+  const auto topics = db.get_topics("tenant");
+  ASSERT_TRUE(topics.has_value());
+  EXPECT_EQ(topics->topics, std::vector<char>{'b'});
+  EXPECT_EQ(topics->version, 2U);
+  EXPECT_FALSE(db.get_topics("other").has_value());
+
+  EXPECT_TRUE(db.remove_topics("tenant"));
+  EXPECT_FALSE(db.remove_topics("tenant"));
+  EXPECT_FALSE(db.get_topics("tenant").has_value());
+}
+
+TEST_F(TestSFSSQLiteNotifications, bucket_topics_roundtrip) {
+  SQLiteNotifications db(conn);
+  rgw_pubsub_bucket_topics notifications;
+  rgw_pubsub_topic_filter filter;
+  filter.s3_id = "notif1";
+  filter.topic.name = "topic";
+  filter.events.push_back(rgw::notify::ObjectCreated);
+  notifications.topics["topic"] = filter;
+
+  EXPECT_EQ(
+      db.store_bucket_topics(
+          "bucket_id", rgw::sal::encode_topics(notifications), std::nullopt
+      ),
+      1U
+  );
+  const auto stored = db.get_bucket_topics("bucket_id");
+  ASSERT_TRUE(stored.has_value());
+  rgw_pubsub_bucket_topics decoded;
+  ASSERT_EQ(rgw::sal::decode_topics(stored->topics, decoded), 0);
+  ASSERT_EQ(decoded.topics.size(), 1U);
+  EXPECT_EQ(decoded.topics["topic"].s3_id, "notif1");
+  ASSERT_EQ(decoded.topics["topic"].events.size(), 1U);
+  EXPECT_EQ(decoded.topics["topic"].events[0], rgw::notify::ObjectCreated);
+
+  EXPECT_EQ(rgw::sal::decode_topics({'x'}, decoded), -EIO);
+
+  EXPECT_TRUE(db.remove_bucket_topics("bucket_id"));
+  EXPECT_FALSE(db.get_bucket_topics("bucket_id").has_value());
+}
+
+TEST_F(TestSFSSQLiteNotifications, events_are_delivered_in_order) {
+  SQLiteNotifications db(conn);
+  const auto now = ceph::real_clock::now();
+  db.enqueue_events(
+      {make_event("http://a", now), make_event("http://b", now),
+       make_event("http://c", now + std::chrono::hours(1))}
+  );
+  EXPECT_EQ(db.count_events(), 3U);
+
+  auto due = db.get_due_events(now, 10);
+  ASSERT_EQ(due.size(), 2U);
+  EXPECT_EQ(due[0].push_endpoint, "http://a");
+  EXPECT_EQ(due[1].push_endpoint, "http://b");
+  EXPECT_LT(due[0].id, due[1].id);
+  EXPECT_EQ(due[0].event, (std::vector<char>{'e', 'v'}));
+
+  // batches are limited
+  EXPECT_EQ(db.get_due_events(now, 1).size(), 1U);
+
+  db.remove_events({due[0].id});
+  EXPECT_EQ(db.count_events(), 2U);
+
+  // a failed event waits for its next attempt
+  const auto later = now + std::chrono::minutes(1);
+  db.reschedule_events({due[1].id}, later);
+  EXPECT_TRUE(db.get_due_events(now, 10).empty());
+  due = db.get_due_events(later, 10);
+  ASSERT_EQ(due.size(), 1U);
+  EXPECT_EQ(due[0].push_endpoint, "http://b");
+  EXPECT_EQ(due[0].attempts, 1U);
+
+  due = db.get_due_events(now + std::chrono::hours(2), 10);
+  ASSERT_EQ(due.size(), 2U);
+  EXPECT_EQ(due[1].push_endpoint, "http://c");
+  db.remove_events({due[0].id, due[1].id});
+  EXPECT_EQ(db.count_events(), 0U);
+}
@@ -14,6 +14,7 @@
 #include "rgw/driver/sfs/object_state.h"
 #include "rgw/driver/sfs/sqlite/dbconn.h"
 #include "rgw/driver/sfs/sqlite/sqlite_buckets.h"
+#include "rgw/driver/sfs/sqlite/sqlite_content.h"
 #include "rgw/driver/sfs/sqlite/sqlite_objects.h"
 #include "rgw/driver/sfs/sqlite/sqlite_users.h"
 #include "rgw/driver/sfs/sqlite/sqlite_versioned_objects.h"
@@ -1873,3 +1874,314 @@ TEST_F(TestSFSSQLiteVersionedObjects, TestSetAllOpenVersionsToDeleted) {
   EXPECT_EQ(1, committed);
   EXPECT_EQ(2, deleted);
 }
+
+TEST_F(TestSFSSQLiteVersionedObjects, TestPartsManifest) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+
+  EXPECT_FALSE(fs::exists(getDBFullPath()));
+  DBConnRef conn = std::make_shared<DBConn>(ceph_context.get());
+
+  auto db_versioned_objects = std::make_shared<SQLiteVersionedObjects>(conn);
+
+  // Create the object, we need it because of foreign key constrains
+  createObject(
+      TEST_USERNAME, TEST_BUCKET, TEST_OBJECT_ID, ceph_context.get(), conn
+  );
+
+  auto object = createTestVersionedObject(1, TEST_OBJECT_ID, "1");
+  auto id = db_versioned_objects->insert_versioned_object(object);
+  EXPECT_TRUE(db_versioned_objects->get_parts_manifest(id).empty());
+
+  std::vector<DBVersionedObjectPart> parts;
+  // stored out of order on purpose
+  parts.push_back({0, 0, 2, 20, 100, 50});
+  parts.push_back({0, 0, 1, 10, 0, 100});
+  EXPECT_TRUE(db_versioned_objects->store_parts_manifest(id, parts));
+
+  auto stored = db_versioned_objects->get_parts_manifest(id);
+  ASSERT_EQ(2, stored.size());
+  EXPECT_EQ(id, stored[0].versioned_object_id);
+  EXPECT_EQ(1, stored[0].part_num);
+  EXPECT_EQ(10, stored[0].part_id);
+  EXPECT_EQ(0, stored[0].offset);
+  EXPECT_EQ(100, stored[0].size);
+  EXPECT_EQ(2, stored[1].part_num);
+  EXPECT_EQ(20, stored[1].part_id);
+  EXPECT_EQ(100, stored[1].offset);
+  EXPECT_EQ(50, stored[1].size);
+
+  // storing again replaces the manifest
+  parts.pop_back();
+  EXPECT_TRUE(db_versioned_objects->store_parts_manifest(id, parts));
+  EXPECT_EQ(1, db_versioned_objects->get_parts_manifest(id).size());
+
+  // manifest rows go away with the version
+  db_versioned_objects->remove_versioned_object(id);
+  EXPECT_TRUE(db_versioned_objects->get_parts_manifest(id).empty());
+}
+
+TEST_F(TestSFSSQLiteVersionedObjects, TestPartsManifestCommittedWithVersion) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+
+  DBConnRef conn = std::make_shared<DBConn>(ceph_context.get());
+  auto db_versioned_objects = std::make_shared<SQLiteVersionedObjects>(conn);
+  createObject(
+      TEST_USERNAME, TEST_BUCKET, TEST_OBJECT_ID, ceph_context.get(), conn
+  );
+
+  std::vector<DBVersionedObjectPart> parts;
+  parts.push_back({0, 0, 1, 10, 0, 100});
+  parts.push_back({0, 0, 2, 20, 100, 50});
+
+  auto object = createTestVersionedObject(1, TEST_OBJECT_ID, "1");
+  object.version_type = rgw::sal::sfs::VersionType::REGULAR;
+  object.id = db_versioned_objects->insert_versioned_object(object);
+  object.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  EXPECT_TRUE(db_versioned_objects->store_versioned_object_if_state(
+      object, {rgw::sal::sfs::ObjectState::OPEN}, parts
+  ));
+  EXPECT_EQ(2, db_versioned_objects->get_parts_manifest(object.id).size());
+
+  // a version no longer in an allowed state gets no manifest either
+  auto other = createTestVersionedObject(2, TEST_OBJECT_ID, "2");
+  other.version_type = rgw::sal::sfs::VersionType::REGULAR;
+  other.id = db_versioned_objects->insert_versioned_object(other);
+  other.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  EXPECT_FALSE(db_versioned_objects
+                   ->store_versioned_object_delete_committed_transact_if_state(
+                       other, {rgw::sal::sfs::ObjectState::DELETED}, nullptr,
+                       parts
+                   ));
+  EXPECT_TRUE(db_versioned_objects->get_parts_manifest(other.id).empty());
+
+  uint num_deleted = 0;
+  EXPECT_TRUE(db_versioned_objects
+                  ->store_versioned_object_delete_committed_transact_if_state(
+                      other, {rgw::sal::sfs::ObjectState::OPEN}, &num_deleted,
+                      parts
+                  ));
+  EXPECT_EQ(1, num_deleted);
+  EXPECT_EQ(2, db_versioned_objects->get_parts_manifest(other.id).size());
+}
+
+TEST_F(TestSFSSQLiteVersionedObjects, TestContentRefCommittedWithVersion) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+
+  DBConnRef conn = std::make_shared<DBConn>(ceph_context.get());
+  auto db_versioned_objects = std::make_shared<SQLiteVersionedObjects>(conn);
+  SQLiteContent db_content(conn);
+  createObject(
+      TEST_USERNAME, TEST_BUCKET, TEST_OBJECT_ID, ceph_context.get(), conn
+  );
+  const std::string hash = "content_hash";
+
+  auto object = createTestVersionedObject(1, TEST_OBJECT_ID, "1");
+  object.version_type = rgw::sal::sfs::VersionType::REGULAR;
+  object.id = db_versioned_objects->insert_versioned_object(object);
+  object.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  object.physical_size = 123;
+  EXPECT_TRUE(db_versioned_objects->store_versioned_object_if_state(
+      object, {rgw::sal::sfs::ObjectState::OPEN}, {}, hash
+  ));
+  auto content = db_content.get_content(hash);
+  ASSERT_TRUE(content.has_value());
+  EXPECT_EQ(1, content->refcount);
+  EXPECT_EQ(123, content->size);
+
+  // a version no longer in an allowed state counts no reference
+  auto other = createTestVersionedObject(2, TEST_OBJECT_ID, "2");
+  other.version_type = rgw::sal::sfs::VersionType::REGULAR;
+  other.id = db_versioned_objects->insert_versioned_object(other);
+  other.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  other.physical_size = 123;
+  EXPECT_FALSE(db_versioned_objects->store_versioned_object_if_state(
+      other, {rgw::sal::sfs::ObjectState::DELETED}, {}, hash
+  ));
+  EXPECT_FALSE(db_versioned_objects
+                   ->store_versioned_object_delete_committed_transact_if_state(
+                       other, {rgw::sal::sfs::ObjectState::DELETED}, nullptr,
+                       {}, hash
+                   ));
+  EXPECT_EQ(1, db_content.get_content(hash)->refcount);
+
+  EXPECT_TRUE(db_versioned_objects
+                  ->store_versioned_object_delete_committed_transact_if_state(
+                      other, {rgw::sal::sfs::ObjectState::OPEN}, nullptr, {},
+                      hash
+                  ));
+  EXPECT_EQ(2, db_content.get_content(hash)->refcount);
+}
+
+TEST_F(TestSFSSQLiteVersionedObjects, TestLifecycleExpireCurrent) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+
+  DBConnRef conn = std::make_shared<DBConn>(ceph_context.get());
+  auto db_versioned_objects = std::make_shared<SQLiteVersionedObjects>(conn);
+
+  const auto now = ceph::real_clock::now();
+  const auto old = now - std::chrono::hours(24 * 10);
+  uint id = 1;
+  for (const auto& object_id :
+       {TEST_OBJECT_ID_1, TEST_OBJECT_ID_2, TEST_OBJECT_ID_3}) {
+    createObject(
+        TEST_USERNAME, TEST_BUCKET, object_id, ceph_context.get(), conn
+    );
+    auto version =
+        createTestVersionedObject(id, object_id, std::to_string(id));
+    version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    version.version_type = rgw::sal::sfs::VersionType::REGULAR;
+    // the last object is too young to expire
+    version.mtime = object_id == TEST_OBJECT_ID_3 ? now : old;
+    EXPECT_EQ(id, db_versioned_objects->insert_versioned_object(version));
+    id++;
+  }
+
+  const auto cutoff = now - std::chrono::hours(24);
+  // the prefix matches no object
+  EXPECT_TRUE(db_versioned_objects
+                  ->expire_current_versions_transact(
+                      TEST_BUCKET, "zz", cutoff, 0, 10
+                  )
+                  .empty());
+  // one version per batch
+  auto items = db_versioned_objects->expire_current_versions_transact(
+      TEST_BUCKET, "", cutoff, 0, 1
+  );
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(1, items[0].first);
+  EXPECT_EQ(TEST_OBJECT_ID_1, items[0].second.to_string());
+  items = db_versioned_objects->expire_current_versions_transact(
+      TEST_BUCKET, "", cutoff, items.back().first, 1
+  );
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(2, items[0].first);
+  EXPECT_TRUE(db_versioned_objects
+                  ->expire_current_versions_transact(
+                      TEST_BUCKET, "", cutoff, items.back().first, 1
+                  )
+                  .empty());
+
+  EXPECT_EQ(
+      rgw::sal::sfs::ObjectState::DELETED,
+      db_versioned_objects->get_versioned_object(1)->object_state
+  );
+  EXPECT_EQ(
+      rgw::sal::sfs::ObjectState::DELETED,
+      db_versioned_objects->get_versioned_object(2)->object_state
+  );
+  EXPECT_EQ(
+      rgw::sal::sfs::ObjectState::COMMITTED,
+      db_versioned_objects->get_versioned_object(3)->object_state
+  );
+}
+
+TEST_F(TestSFSSQLiteVersionedObjects, TestLifecycleExpireNoncurrent) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+
+  DBConnRef conn = std::make_shared<DBConn>(ceph_context.get());
+  auto db_versioned_objects = std::make_shared<SQLiteVersionedObjects>(conn);
+  createObject(
+      TEST_USERNAME, TEST_BUCKET, TEST_OBJECT_ID, ceph_context.get(), conn
+  );
+
+  // versions created 10 days ago, 5 days ago and now
+  const auto now = ceph::real_clock::now();
+  uint id = 1;
+  for (int days : {10, 5, 0}) {
+    auto version =
+        createTestVersionedObject(id, TEST_OBJECT_ID, std::to_string(id));
+    version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+    version.version_type = rgw::sal::sfs::VersionType::REGULAR;
+    version.mtime = now - std::chrono::hours(24 * days);
+    version.commit_time = version.mtime;
+    EXPECT_EQ(id, db_versioned_objects->insert_versioned_object(version));
+    id++;
+  }
+
+  // only the first version became noncurrent more than 3 days ago
+  auto items = db_versioned_objects->expire_noncurrent_versions_transact(
+      TEST_BUCKET, "", now - std::chrono::hours(24 * 3), 0, 10
+  );
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(1, items[0].first);
+
+  // the latest version never expires as noncurrent
+  items = db_versioned_objects->expire_noncurrent_versions_transact(
+      TEST_BUCKET, "", now + std::chrono::hours(1), 0, 10
+  );
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(2, items[0].first);
+  EXPECT_EQ(
+      rgw::sal::sfs::ObjectState::COMMITTED,
+      db_versioned_objects->get_versioned_object(3)->object_state
+  );
+}
+
+TEST_F(TestSFSSQLiteVersionedObjects, TestLifecycleDeleteMarkers) {
+  auto ceph_context = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+  ceph_context->_conf.set_val("rgw_sfs_data_path", getTestDir());
+  ceph_context->_log->start();
+
+  DBConnRef conn = std::make_shared<DBConn>(ceph_context.get());
+  auto db_versioned_objects = std::make_shared<SQLiteVersionedObjects>(conn);
+  createObject(
+      TEST_USERNAME, TEST_BUCKET, TEST_OBJECT_ID, ceph_context.get(), conn
+  );
+
+  const auto now = ceph::real_clock::now();
+  auto version = createTestVersionedObject(1, TEST_OBJECT_ID, "1");
+  version.object_state = rgw::sal::sfs::ObjectState::COMMITTED;
+  version.version_type = rgw::sal::sfs::VersionType::REGULAR;
+  version.mtime = now - std::chrono::hours(24 * 10);
+  EXPECT_EQ(1, db_versioned_objects->insert_versioned_object(version));
+
+  auto items = db_versioned_objects->add_delete_markers_to_expired_transact(
+      TEST_BUCKET, "", now, 0, 10, []() { return "lc_delete_marker"; }
+  );
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(1, items[0].first);
+  auto delete_marker = db_versioned_objects->get_versioned_object(2);
+  ASSERT_TRUE(delete_marker.has_value());
+  EXPECT_EQ(
+      rgw::sal::sfs::VersionType::DELETE_MARKER, delete_marker->version_type
+  );
+  EXPECT_EQ("lc_delete_marker", delete_marker->version_id);
+  // the version is not current anymore
+  EXPECT_TRUE(db_versioned_objects
+                  ->add_delete_markers_to_expired_transact(
+                      TEST_BUCKET, "", now, 0, 10,
+                      []() { return "lc_delete_marker_2"; }
+                  )
+                  .empty());
+
+  // the delete marker still hides a version
+  EXPECT_TRUE(db_versioned_objects
+                  ->expire_lone_delete_markers_transact(TEST_BUCKET, "", 0, 10)
+                  .empty());
+  EXPECT_EQ(
+      1, db_versioned_objects
+             ->expire_noncurrent_versions_transact(
+                 TEST_BUCKET, "", now + std::chrono::hours(1), 0, 10
+             )
+             .size()
+  );
+  items = db_versioned_objects->expire_lone_delete_markers_transact(
+      TEST_BUCKET, "", 0, 10
+  );
+  ASSERT_EQ(1, items.size());
+  EXPECT_EQ(2, items[0].first);
+  EXPECT_EQ(
+      rgw::sal::sfs::ObjectState::DELETED,
+      db_versioned_objects->get_versioned_object(2)->object_state
+  );
+}
@@ -0,0 +1,212 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "common/ceph_context.h"
+#include "rgw/driver/sfs/sfs_usage.h"
+#include "rgw/driver/sfs/sqlite/dbconn.h"
+#include "rgw/driver/sfs/usage_backend.h"
+
+using namespace rgw::sal::sfs::sqlite;
+using rgw::sal::sfs::UsageBackend;
+
+namespace fs = std::filesystem;
+const static std::string TEST_DIR = "rgw_sfs_tests";
+constexpr uint64_t NO_END = std::numeric_limits<uint64_t>::max();
+
+class TestSFSUsage : public ::testing::TestWithParam<std::string> {
+ protected:
+  std::shared_ptr<CephContext> cct;
+  DBConnRef conn;
+  std::unique_ptr<UsageBackend> backend;
+
+  void SetUp() override {
+    fs::current_path(fs::temp_directory_path());
+    fs::create_directory(TEST_DIR);
+    cct = std::make_shared<CephContext>(CEPH_ENTITY_TYPE_CLIENT);
+    cct->_conf.set_val("rgw_sfs_data_path", getTestDir());
+    cct->_log->start();
+    cct->_conf.set_val("rgw_sfs_usage_backend", GetParam());
+    conn = std::make_shared<DBConn>(cct.get());
+    backend =
+        rgw::sal::sfs::make_usage_backend(cct.get(), conn, getTestDir());
+  }
+
+  void TearDown() override {
+    backend.reset();
+    conn.reset();
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(TEST_DIR);
+  }
+
+  std::string getTestDir() const {
+    auto test_dir = fs::temp_directory_path() / TEST_DIR;
+    return test_dir.string();
+  }
+
+  static DBUsage make_usage(
+      const std::string& owner, const std::string& bucket, int64_t epoch,
+      const std::string& category, int64_t bytes_sent
+  ) {
+    return DBUsage{owner, bucket, epoch, "", category, bytes_sent, 1, 1, 1};
+  }
+
+  static UsageBackend::Range all() {
+    UsageBackend::Range range;
+    range.end_epoch = NO_END;
+    return range;
+  }
+};
+
+TEST_P(TestSFSUsage, flushes_are_summed_per_hour) {
+  const UsageBackend& db = *backend;
+  db.add_usage(
+      {make_usage("u1", "b1", 3600, "put_obj", 10),
+       make_usage("u1", "b1", 7200, "put_obj", 5),
+       make_usage("u1", "b1", 3600, "get_obj", 7)}
+  );
+  db.add_usage({make_usage("u1", "b1", 3600, "put_obj", 20)});
+
+  bool truncated = true;
+  auto rows = db.read_usage(all(), {}, 10, truncated);
+  EXPECT_FALSE(truncated);
+  ASSERT_EQ(rows.size(), 2U);
+  EXPECT_EQ(rows[0].category, "get_obj");
+  EXPECT_EQ(rows[0].bytes_sent, 7);
+  EXPECT_EQ(rows[1].category, "put_obj");
+  EXPECT_EQ(rows[1].bytes_sent, 35);
+  EXPECT_EQ(rows[1].ops, 3);
+  EXPECT_EQ(rows[1].epoch, 3600);
+
+  // only the first hour
+  auto range = all();
+  range.end_epoch = 7200;
+  rows = db.read_usage(range, {}, 10, truncated);
+  ASSERT_EQ(rows.size(), 2U);
+  EXPECT_EQ(rows[1].bytes_sent, 30);
+}
+
+TEST_P(TestSFSUsage, reads_are_paginated_by_owner_and_bucket) {
+  const UsageBackend& db = *backend;
+  db.add_usage(
+      {make_usage("u1", "b1", 3600, "put_obj", 1),
+       make_usage("u1", "b1", 3600, "get_obj", 1),
+       make_usage("u1", "b2", 3600, "put_obj", 1),
+       make_usage("u2", "b1", 3600, "put_obj", 1)}
+  );
+
+  bool truncated = false;
+  auto rows = db.read_usage(all(), {}, 1, truncated);
+  EXPECT_TRUE(truncated);
+  // both categories of the first pair
+  ASSERT_EQ(rows.size(), 2U);
+  EXPECT_EQ(rows[1].bucket, "b1");
+
+  rows = db.read_usage(all(), {"u1", "b1"}, 1, truncated);
+  EXPECT_TRUE(truncated);
+  ASSERT_EQ(rows.size(), 1U);
+  EXPECT_EQ(rows[0].bucket, "b2");
+
+  rows = db.read_usage(all(), {"u1", "b2"}, 1, truncated);
+  EXPECT_FALSE(truncated);
+  ASSERT_EQ(rows.size(), 1U);
+  EXPECT_EQ(rows[0].owner, "u2");
+
+  auto range = all();
+  range.bucket = "b1";
+  rows = db.read_usage(range, {}, 10, truncated);
+  EXPECT_EQ(rows.size(), 3U);
+  range.owner = "u2";
+  rows = db.read_usage(range, {}, 10, truncated);
+  EXPECT_EQ(rows.size(), 1U);
+}
+
+TEST_P(TestSFSUsage, payers_are_summed_separately) {
+  const UsageBackend& db = *backend;
+  auto paid = make_usage("u1", "b1", 3600, "get_obj", 10);
+  paid.payer = "requester";
+  db.add_usage(
+      {make_usage("u1", "b1", 3600, "get_obj", 1), paid,
+       make_usage("u1", "b1", 7200, "get_obj", 2)}
+  );
+
+  bool truncated = true;
+  auto rows = db.read_usage(all(), {}, 10, truncated);
+  EXPECT_FALSE(truncated);
+  ASSERT_EQ(rows.size(), 2U);
+  EXPECT_EQ(rows[0].payer, "");
+  EXPECT_EQ(rows[0].bytes_sent, 3);
+  EXPECT_EQ(rows[1].payer, "requester");
+  EXPECT_EQ(rows[1].bytes_sent, 10);
+}
+
+TEST_P(TestSFSUsage, trim_removes_range) {
+  const UsageBackend& db = *backend;
+  db.add_usage(
+      {make_usage("u1", "b1", 3600, "put_obj", 1),
+       make_usage("u1", "b1", 7200, "put_obj", 1),
+       make_usage("u2", "b1", 3600, "put_obj", 1)}
+  );
+  auto range = all();
+  range.owner = "u1";
+  range.end_epoch = 7200;
+  EXPECT_EQ(db.trim_usage(range), 1U);
+  EXPECT_EQ(db.trim_usage(range), 0U);
+  EXPECT_EQ(db.trim_usage(all()), 2U);
+  bool truncated = false;
+  EXPECT_TRUE(db.read_usage(all(), {}, 10, truncated).empty());
+}
+
+TEST_P(TestSFSUsage, usage_log_roundtrip) {
+  rgw_usage_log_entry entry;
+  entry.owner = rgw_user("tenant", "u1");
+  entry.bucket = "b1";
+  entry.epoch = 3600;
+  rgw_usage_data data(100, 10);
+  data.ops = 2;
+  data.successful_ops = 1;
+  entry.add("put_obj", data);
+  std::map<rgw_user_bucket, RGWUsageBatch> usage_info;
+  auto time = ceph::real_clock::from_time_t(3600);
+  bool account = false;
+  usage_info[rgw_user_bucket(entry.owner.to_str(), entry.bucket)].insert(
+      time, entry, &account
+  );
+  rgw::sal::sfs::log_usage(*backend, usage_info);
+  rgw::sal::sfs::log_usage(*backend, usage_info);
+
+  NoDoutPrefix dpp(cct.get(), 1);
+  RGWUsageIter usage_iter;
+  bool truncated = true;
+  std::map<rgw_user_bucket, rgw_usage_log_entry> usage;
+  ASSERT_EQ(
+      rgw::sal::sfs::read_usage(
+          &dpp, *backend, all(), 10, &truncated, usage_iter, usage
+      ),
+      0
+  );
+  EXPECT_FALSE(truncated);
+  ASSERT_EQ(usage.size(), 1U);
+  const auto& read = usage.begin()->second;
+  EXPECT_EQ(read.owner, entry.owner);
+  EXPECT_EQ(read.bucket, "b1");
+  EXPECT_EQ(read.epoch, 3600U);
+  EXPECT_EQ(read.total_usage.bytes_sent, 200U);
+  EXPECT_EQ(read.total_usage.bytes_received, 20U);
+  EXPECT_EQ(read.usage_map.at("put_obj").ops, 4U);
+  EXPECT_EQ(read.usage_map.at("put_obj").successful_ops, 2U);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Backends, TestSFSUsage, ::testing::Values("sqlite", "rocksdb"),
+    [](const testing::TestParamInfo<TestSFSUsage::ParamType>& info) {
+      return info.param;
+    }
+);
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 
 #include "driver/sfs/sqlite/dbconn.h"
+#include "driver/sfs/sqlite/sqlite_users.h"
 #include "rgw/rgw_sal_sfs.h"
 
 using namespace rgw::sal::sfs;